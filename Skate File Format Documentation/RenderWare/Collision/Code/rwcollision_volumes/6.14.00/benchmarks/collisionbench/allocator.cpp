@@ -0,0 +1,64 @@
+// (c) Electronic Arts. All Rights Reserved.
+#include <stdlib.h>
+
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+
+namespace EA
+{
+namespace Allocator
+{
+
+/**
+An allocator on the system heap. The benchmarks allocate their data and queries once, before anything is
+timed, so the harness uses the system heap rather than a fixed size heap which might not hold the largest
+data files.
+*/
+class BenchmarkAllocator : public EA::Allocator::ICoreAllocator
+{
+public:
+    virtual ~BenchmarkAllocator()
+    {
+    }
+
+    // The collision library never asks for an alignment offset
+    virtual void* Alloc(size_t size, const char * /* name */, unsigned int  /* flags */, unsigned int align, unsigned int /* alignOffset */)
+    {
+        void *block = NULL;
+        if (align < sizeof(void *))
+        {
+            align = sizeof(void *);
+        }
+        if (posix_memalign(&block, align, size ? size : 1) != 0)
+        {
+            return NULL;
+        }
+        return block;
+    }
+
+    virtual void* Alloc(size_t size, const char *name, unsigned int flags)
+    {
+        return Alloc(size, name, flags, 16, 0);
+    }
+
+    virtual void Free(void *block, size_t)
+    {
+        free(block);
+    }
+};
+
+
+// ***********************************************************************************************************
+/// The user is responsible for providing an implementation of
+/// EA::Allocator::ICoreAllocator::GetDefaultAllocator in their
+/// applications' codebase.
+ICoreAllocator* ICoreAllocator::GetDefaultAllocator()
+{
+    static BenchmarkAllocator s_benchmarkAllocator;
+    return &s_benchmarkAllocator;
+}
+
+
+} // namespace EA
+} // namespace Allocator
@@ -0,0 +1,510 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: benchcases.cpp
+
+ Purpose: The benchmarks run by the standalone benchmark harness, against the unit test data files.
+
+ The data files are the high level serialized objects in tests/rwunittestdata, which are created by the
+ tool build of the unit tests. They are loaded here with the serialization package directly, rather than
+ through eaphysics_unitframework, so that the harness has no dependency on the unit test framework.
+ */
+
+#include "benchcases.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+#include <rw/collision/libcore.h>
+
+#include <serialization/serialization.h>
+#include <serialization/binary_stream_iarchive.h>
+#include <eaphysics/hlserializable.h>
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace collisionbench
+{
+
+
+namespace
+{
+
+const uint32_t NUM_PROBES = 1024;
+const uint32_t STACKSIZE = 16;
+const uint32_t RESULTSSIZE = 64;
+
+/// The clustered meshes, all of which are queried by every aggregate benchmark.
+const char *g_clusteredMeshFilenames[] =
+{
+    "skatemesh.dat",
+    "skatemesh_ids.dat",
+    "skatemesh_compressed_ids.dat",
+    "skatemesh_compressed_quads_ids.dat",
+    "courtyard.dat",
+    "mesh_leaves_spanning_clusters.dat"
+};
+
+/// A point which can be held in a std::vector without alignment requirements.
+struct Point
+{
+    float x, y, z;
+};
+
+
+template <class T>
+T *
+LoadHLSerialized(const std::string &filename)
+{
+    std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!stream)
+    {
+        return NULL;
+    }
+
+    T *object = NULL;
+    EA::Serialization::basic_binary_stream_iarchive<std::istream,
+        EA::Serialization::Endian::LittleEndianConverter> iArchive(stream);
+    iArchive & EAPHYSICS_HL_SERIALIZABLE_WITH_ALLOCATOR(T, object, *EA::Allocator::ICoreAllocator::GetDefaultAllocator());
+
+    return iArchive.good() ? object : NULL;
+}
+
+
+/**
+Gets points spread over the top face of a bounding box, from a fixed pseudo random sequence so that
+every run queries the same places.
+*/
+void
+GenerateProbes(const AABBox &bbox, std::vector<Point> &points)
+{
+    const Vector3 extent = bbox.Max() - bbox.Min();
+    uint32_t seed = 12345u;
+    points.resize(NUM_PROBES);
+    for (uint32_t i = 0; i < NUM_PROBES; ++i)
+    {
+        float r[2];
+        for (uint32_t k = 0; k < 2; ++k)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            r[k] = float(seed >> 8) / float(1u << 24);
+        }
+        points[i].x = float(bbox.Min().GetX()) + r[0] * float(extent.GetX());
+        points[i].y = float(bbox.Max().GetY());
+        points[i].z = float(bbox.Min().GetZ()) + r[1] * float(extent.GetZ());
+    }
+}
+
+} // namespace
+
+
+/**
+\internal
+A loaded data file, which is either an aggregate wrapped in an AggregateVolume or an octree.
+*/
+class DataSet
+{
+public:
+    explicit DataSet(const std::string &name)
+        : m_name(name),
+          m_aggregate(NULL),
+          m_volume(NULL),
+          m_octree(NULL)
+    {
+    }
+
+    ~DataSet()
+    {
+        EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+        if (m_volume)
+        {
+            allocator->Free(m_volume);
+        }
+        if (m_aggregate)
+        {
+            allocator->Free(m_aggregate);
+        }
+        if (m_octree)
+        {
+            allocator->Free(m_octree);
+        }
+    }
+
+    bool
+    SetAggregate(Aggregate *aggregate)
+    {
+        if (!aggregate)
+        {
+            return false;
+        }
+        m_aggregate = aggregate;
+
+        EA::Physics::SizeAndAlignment resDesc = AggregateVolume::GetResourceDescriptor(aggregate);
+        void *memory = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+        m_volume = AggregateVolume::Initialize(EA::Physics::MemoryPtr(memory), aggregate);
+        m_volume->GetBBox(0, TRUE, m_bbox);
+        GenerateProbes(m_bbox, m_probes);
+        return true;
+    }
+
+    bool
+    SetOctree(Octree *octree)
+    {
+        if (!octree)
+        {
+            return false;
+        }
+        m_octree = octree;
+        m_bbox = octree->GetObjectDescriptor().m_extent;
+        GenerateProbes(m_bbox, m_probes);
+        return true;
+    }
+
+    std::string         m_name;
+    Aggregate           *m_aggregate;
+    AggregateVolume     *m_volume;
+    Octree              *m_octree;
+    AABBox              m_bbox;
+    std::vector<Point>  m_probes;
+};
+
+
+namespace
+{
+
+/// Casts a line down through the data from each probe and finds the nearest intersection.
+class LineNearestBenchmark : public Benchmark
+{
+public:
+    explicit LineNearestBenchmark(const DataSet &data)
+        : Benchmark(data.m_name + "/LineNearest", NUM_PROBES),
+          m_data(data)
+    {
+        EA::Physics::SizeAndAlignment resDesc = VolumeLineQuery::GetResourceDescriptor(STACKSIZE, RESULTSSIZE);
+        m_memory = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+        m_query = VolumeLineQuery::Initialize(EA::Physics::MemoryPtr(m_memory), STACKSIZE, RESULTSSIZE);
+    }
+
+    virtual ~LineNearestBenchmark()
+    {
+        VolumeLineQuery::Release(m_query);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(m_memory);
+    }
+
+    virtual uint64_t
+    Run()
+    {
+        const Volume *volumes[] = { m_data.m_volume };
+        const float depth = float(m_data.m_bbox.Max().GetY() - m_data.m_bbox.Min().GetY());
+
+        uint64_t checksum = 0;
+        for (uint32_t i = 0; i < NUM_PROBES; ++i)
+        {
+            const Point &p = m_data.m_probes[i];
+            m_query->InitQuery(volumes, NULL, 1, Vector3(p.x, p.y, p.z), Vector3(p.x, p.y - depth, p.z));
+            const VolumeLineSegIntersectResult *result = m_query->GetNearestIntersection();
+            if (result)
+            {
+                checksum += 1u + result->vRef.tag;
+            }
+        }
+        return checksum;
+    }
+
+private:
+    const DataSet   &m_data;
+    void            *m_memory;
+    VolumeLineQuery *m_query;
+};
+
+
+/// Casts a line down through the data from each probe and finds every intersection.
+class LineAllBenchmark : public Benchmark
+{
+public:
+    explicit LineAllBenchmark(const DataSet &data)
+        : Benchmark(data.m_name + "/LineAll", NUM_PROBES),
+          m_data(data)
+    {
+        EA::Physics::SizeAndAlignment resDesc = VolumeLineQuery::GetResourceDescriptor(STACKSIZE, RESULTSSIZE);
+        m_memory = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+        m_query = VolumeLineQuery::Initialize(EA::Physics::MemoryPtr(m_memory), STACKSIZE, RESULTSSIZE);
+    }
+
+    virtual ~LineAllBenchmark()
+    {
+        VolumeLineQuery::Release(m_query);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(m_memory);
+    }
+
+    virtual uint64_t
+    Run()
+    {
+        const Volume *volumes[] = { m_data.m_volume };
+        const float depth = float(m_data.m_bbox.Max().GetY() - m_data.m_bbox.Min().GetY());
+
+        uint64_t checksum = 0;
+        for (uint32_t i = 0; i < NUM_PROBES; ++i)
+        {
+            const Point &p = m_data.m_probes[i];
+            m_query->InitQuery(volumes, NULL, 1, Vector3(p.x, p.y, p.z), Vector3(p.x, p.y - depth, p.z));
+            while (!m_query->Finished())
+            {
+                const uint32_t numRes = m_query->GetAllIntersections();
+                const VolumeLineSegIntersectResult *results = m_query->GetIntersectionResultsBuffer();
+                for (uint32_t r = 0; r < numRes; ++r)
+                {
+                    checksum += 1u + results[r].vRef.tag;
+                }
+            }
+        }
+        return checksum;
+    }
+
+private:
+    const DataSet   &m_data;
+    void            *m_memory;
+    VolumeLineQuery *m_query;
+};
+
+
+/// Finds every primitive overlapping a box around each probe, a thirty second of the width of the data.
+class BBoxOverlapBenchmark : public Benchmark
+{
+public:
+    explicit BBoxOverlapBenchmark(const DataSet &data)
+        : Benchmark(data.m_name + "/BBoxOverlaps", NUM_PROBES),
+          m_data(data)
+    {
+        EA::Physics::SizeAndAlignment resDesc = VolumeBBoxQuery::GetResourceDescriptor(STACKSIZE, RESULTSSIZE);
+        m_memory = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+        m_query = VolumeBBoxQuery::Initialize(EA::Physics::MemoryPtr(m_memory), STACKSIZE, RESULTSSIZE);
+    }
+
+    virtual ~BBoxOverlapBenchmark()
+    {
+        VolumeBBoxQuery::Release(m_query);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(m_memory);
+    }
+
+    virtual uint64_t
+    Run()
+    {
+        const Volume *volumes[] = { m_data.m_volume };
+        const Vector3 extent = m_data.m_bbox.Max() - m_data.m_bbox.Min();
+        const float width = (float(extent.GetX()) > float(extent.GetZ())) ? float(extent.GetX()) : float(extent.GetZ());
+        const float halfSize = 0.5f / 32.0f * width;
+        const float height = float(extent.GetY());
+
+        uint64_t checksum = 0;
+        for (uint32_t i = 0; i < NUM_PROBES; ++i)
+        {
+            const Point &p = m_data.m_probes[i];
+            const AABBox box(Vector3(p.x - halfSize, p.y - height, p.z - halfSize), Vector3(p.x + halfSize, p.y, p.z + halfSize));
+            m_query->InitQuery(volumes, NULL, 1, box);
+            while (!m_query->Finished())
+            {
+                const uint32_t numRes = m_query->GetOverlaps();
+                const VolRef *results = m_query->GetOverlapResultsBuffer();
+                for (uint32_t r = 0; r < numRes; ++r)
+                {
+                    checksum += 1u + results[r].tag;
+                }
+            }
+        }
+        return checksum;
+    }
+
+private:
+    const DataSet   &m_data;
+    void            *m_memory;
+    VolumeBBoxQuery *m_query;
+};
+
+
+/// Finds the octree entries overlapping a box around each probe.
+class OctreeBBoxBenchmark : public Benchmark
+{
+public:
+    explicit OctreeBBoxBenchmark(const DataSet &data)
+        : Benchmark(data.m_name + "/BBoxEntries", NUM_PROBES),
+          m_data(data)
+    {
+    }
+
+    virtual uint64_t
+    Run()
+    {
+        const Vector3 extent = m_data.m_bbox.Max() - m_data.m_bbox.Min();
+        const Vector3 halfSize = extent * (0.5f / 8.0f);
+
+        uint64_t checksum = 0;
+        for (uint32_t i = 0; i < NUM_PROBES; ++i)
+        {
+            const Point &p = m_data.m_probes[i];
+            const Vector3 centre(p.x, float(m_data.m_bbox.Min().GetY()) + 0.5f * float(extent.GetY()), p.z);
+            Octree::BBoxQuery query(m_data.m_octree, AABBox(centre - halfSize, centre + halfSize));
+            uint32_t entry;
+            while (query.GetNext(entry))
+            {
+                checksum += 1u + entry;
+            }
+        }
+        return checksum;
+    }
+
+private:
+    const DataSet &m_data;
+};
+
+
+/// Finds the octree entries intersected by a line down through the data from each probe.
+class OctreeLineBenchmark : public Benchmark
+{
+public:
+    explicit OctreeLineBenchmark(const DataSet &data)
+        : Benchmark(data.m_name + "/LineEntries", NUM_PROBES),
+          m_data(data)
+    {
+    }
+
+    virtual uint64_t
+    Run()
+    {
+        const float depth = float(m_data.m_bbox.Max().GetY() - m_data.m_bbox.Min().GetY());
+
+        uint64_t checksum = 0;
+        for (uint32_t i = 0; i < NUM_PROBES; ++i)
+        {
+            const Point &p = m_data.m_probes[i];
+            Octree::LineQuery query(m_data.m_octree, Vector3(p.x, p.y, p.z), Vector3(p.x, p.y - depth, p.z));
+            uint32_t entry;
+            while (query.GetNext(entry))
+            {
+                checksum += 1u + entry;
+            }
+        }
+        return checksum;
+    }
+
+private:
+    const DataSet &m_data;
+};
+
+
+bool
+MatchesFilter(const std::string &name, const char *filter)
+{
+    return !filter || strstr(name.c_str(), filter);
+}
+
+} // namespace
+
+
+BenchmarkSet::BenchmarkSet()
+{
+}
+
+
+BenchmarkSet::~BenchmarkSet()
+{
+    for (size_t i = 0; i < m_benchmarks.size(); ++i)
+    {
+        delete m_benchmarks[i];
+    }
+    for (size_t i = 0; i < m_dataSets.size(); ++i)
+    {
+        delete m_dataSets[i];
+    }
+}
+
+
+/**
+\brief Loads the data files and creates the benchmarks. Data files which are missing are reported and
+skipped, so that the harness can run against a partial set of data.
+
+\param dataDirectory The directory holding the unit test data, normally tests/rwunittestdata.
+\param filter Only benchmarks with names containing this string are created, or NULL for all.
+
+\return The number of benchmarks created.
+*/
+uint32_t
+BenchmarkSet::Load(const char *dataDirectory,
+                   const char *filter)
+{
+    const std::string directory = std::string(dataDirectory) + "/";
+
+    for (uint32_t i = 0; i < sizeof(g_clusteredMeshFilenames) / sizeof(g_clusteredMeshFilenames[0]); ++i)
+    {
+        DataSet *data = new DataSet(g_clusteredMeshFilenames[i]);
+        if (!data->SetAggregate(LoadHLSerialized<ClusteredMesh>(directory + data->m_name)))
+        {
+            fprintf(stderr, "collisionbench: Unable to load %s%s, skipping.\n", directory.c_str(), data->m_name.c_str());
+            delete data;
+            continue;
+        }
+        m_dataSets.push_back(data);
+    }
+
+    {
+        DataSet *data = new DataSet("kdtreemappedarray.dat");
+        if (data->SetAggregate(LoadHLSerialized<KDTreeMappedArray>(directory + data->m_name)))
+        {
+            m_dataSets.push_back(data);
+        }
+        else
+        {
+            fprintf(stderr, "collisionbench: Unable to load %s%s, skipping.\n", directory.c_str(), data->m_name.c_str());
+            delete data;
+        }
+    }
+
+    {
+        DataSet *data = new DataSet("octree.dat");
+        if (data->SetOctree(LoadHLSerialized<Octree>(directory + data->m_name)))
+        {
+            m_dataSets.push_back(data);
+        }
+        else
+        {
+            fprintf(stderr, "collisionbench: Unable to load %s%s, skipping.\n", directory.c_str(), data->m_name.c_str());
+            delete data;
+        }
+    }
+
+    for (size_t i = 0; i < m_dataSets.size(); ++i)
+    {
+        const DataSet &data = *m_dataSets[i];
+        Benchmark *candidates[3] = { NULL, NULL, NULL };
+        if (data.m_volume)
+        {
+            candidates[0] = new LineNearestBenchmark(data);
+            candidates[1] = new LineAllBenchmark(data);
+            candidates[2] = new BBoxOverlapBenchmark(data);
+        }
+        else
+        {
+            candidates[0] = new OctreeLineBenchmark(data);
+            candidates[1] = new OctreeBBoxBenchmark(data);
+        }
+
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            if (candidates[c] && MatchesFilter(candidates[c]->GetName(), filter))
+            {
+                m_benchmarks.push_back(candidates[c]);
+            }
+            else
+            {
+                delete candidates[c];
+            }
+        }
+    }
+
+    return static_cast<uint32_t>(m_benchmarks.size());
+}
+
+
+} // namespace collisionbench
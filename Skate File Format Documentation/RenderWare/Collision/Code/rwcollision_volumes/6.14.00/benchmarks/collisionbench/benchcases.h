@@ -0,0 +1,109 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: benchcases.h
+
+ Purpose: The benchmarks run by the standalone benchmark harness, against the unit test data files.
+ */
+
+#ifndef RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHCASES_H
+#define RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHCASES_H
+
+#include <EABase/eabase.h>
+
+#include <string>
+#include <vector>
+
+namespace collisionbench
+{
+
+
+/**
+\brief A benchmark, which runs a fixed set of queries against data loaded when it is created.
+*/
+class Benchmark
+{
+public:
+    virtual ~Benchmark()
+    {
+    }
+
+    /**
+    \brief Gets the name of the benchmark, which is the data file and the queries run against it.
+    \return The name of the benchmark.
+    */
+    const std::string &
+    GetName() const
+    {
+        return m_name;
+    }
+
+    /**
+    \brief Gets the number of queries run by each call to Run.
+    \return The number of queries.
+    */
+    uint32_t
+    GetNumOperations() const
+    {
+        return m_numOperations;
+    }
+
+    /**
+    \brief Runs the queries once.
+    \return A checksum of the results of the queries, which is the same for every run.
+    */
+    virtual uint64_t
+    Run() = 0;
+
+protected:
+    Benchmark(const std::string &name, uint32_t numOperations)
+        : m_name(name),
+          m_numOperations(numOperations)
+    {
+    }
+
+private:
+    std::string m_name;
+    uint32_t    m_numOperations;
+};
+
+
+class DataSet;
+
+
+/**
+\brief Loads the unit test data files and creates the benchmarks which run against them.
+*/
+class BenchmarkSet
+{
+public:
+    BenchmarkSet();
+
+    ~BenchmarkSet();
+
+    uint32_t
+    Load(const char *dataDirectory,
+         const char *filter);
+
+    /**
+    \brief Gets the benchmarks created by Load.
+    \return The benchmarks, in the order they should be run.
+    */
+    const std::vector<Benchmark *> &
+    GetBenchmarks() const
+    {
+        return m_benchmarks;
+    }
+
+private:
+    BenchmarkSet(const BenchmarkSet &);
+    BenchmarkSet &operator=(const BenchmarkSet &);
+
+    std::vector<DataSet *>   m_dataSets;
+    std::vector<Benchmark *> m_benchmarks;
+};
+
+
+} // namespace collisionbench
+
+#endif // RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHCASES_H
@@ -0,0 +1,263 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: benchplatform.cpp
+
+ Purpose: Timing, CPU pinning, cache eviction and hardware counters for the standalone benchmark harness.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // For sched_setaffinity
+#endif
+
+#include "benchplatform.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(EA_PLATFORM_LINUX) || defined(__linux__)
+#define COLLISIONBENCH_LINUX 1
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#else
+#define COLLISIONBENCH_LINUX 0
+#endif
+
+namespace collisionbench
+{
+
+
+namespace
+{
+
+// Larger than the last level cache of the machines the benchmarks are run on
+const size_t EVICTION_BUFFER_SIZE = 64u * 1024u * 1024u;
+
+uint8_t *g_evictionBuffer = NULL;
+
+volatile uint32_t g_evictionSink = 0;
+
+#if COLLISIONBENCH_LINUX
+
+int
+OpenCounter(uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The group is enabled through the leader
+    attr.disabled = (groupFd == -1) ? 1 : 0;
+
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+#endif // COLLISIONBENCH_LINUX
+
+} // namespace
+
+
+uint64_t
+ReadNanoseconds()
+{
+#if defined(CLOCK_MONOTONIC_RAW)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+#elif defined(CLOCK_MONOTONIC)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+#else
+    return static_cast<uint64_t>(clock()) * (1000000000u / CLOCKS_PER_SEC);
+#endif
+}
+
+
+bool
+PinToCpu(uint32_t cpu)
+{
+#if COLLISIONBENCH_LINUX
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return 0 == sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+
+void
+EvictCaches()
+{
+    if (!g_evictionBuffer)
+    {
+        g_evictionBuffer = static_cast<uint8_t *>(malloc(EVICTION_BUFFER_SIZE));
+        if (!g_evictionBuffer)
+        {
+            return;
+        }
+        memset(g_evictionBuffer, 1, EVICTION_BUFFER_SIZE);
+    }
+
+    // Write every line so that dirty lines of the benchmark data are also written back
+    uint32_t sum = 0;
+    for (size_t i = 0; i < EVICTION_BUFFER_SIZE; i += 64u)
+    {
+        g_evictionBuffer[i] = static_cast<uint8_t>(g_evictionBuffer[i] + 1u);
+        sum += g_evictionBuffer[i];
+    }
+    g_evictionSink = sum;
+}
+
+
+HardwareCounters::HardwareCounters()
+    : m_available(false)
+{
+    for (uint32_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        m_fds[i] = -1;
+    }
+}
+
+
+HardwareCounters::~HardwareCounters()
+{
+    Close();
+}
+
+
+/**
+\brief Opens the counters for the calling thread.
+\return True if every counter could be opened. This fails if the kernel does not support perf events for
+        the CPU, or if /proc/sys/kernel/perf_event_paranoid does not allow user space measurement.
+*/
+bool
+HardwareCounters::Open()
+{
+    Close();
+
+#if COLLISIONBENCH_LINUX
+    static const uint64_t configs[NUM_COUNTERS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (uint32_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        m_fds[i] = OpenCounter(configs[i], (i == 0) ? -1 : m_fds[0]);
+        if (m_fds[i] < 0)
+        {
+            Close();
+            return false;
+        }
+    }
+    m_available = true;
+#endif // COLLISIONBENCH_LINUX
+
+    return m_available;
+}
+
+
+void
+HardwareCounters::Close()
+{
+#if COLLISIONBENCH_LINUX
+    for (uint32_t i = NUM_COUNTERS; i > 0; --i)
+    {
+        if (m_fds[i - 1] >= 0)
+        {
+            close(m_fds[i - 1]);
+        }
+    }
+#endif // COLLISIONBENCH_LINUX
+
+    for (uint32_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        m_fds[i] = -1;
+    }
+    m_available = false;
+}
+
+
+/**
+\brief Resets and starts the counters.
+*/
+void
+HardwareCounters::Start()
+{
+#if COLLISIONBENCH_LINUX
+    if (m_available)
+    {
+        ioctl(m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif // COLLISIONBENCH_LINUX
+}
+
+
+/**
+\brief Stops the counters and reads them.
+\param counts Receives the count of each counter since Start, or zero if the counters are not available.
+*/
+void
+HardwareCounters::Stop(uint64_t counts[NUM_COUNTERS])
+{
+    for (uint32_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        counts[i] = 0;
+    }
+
+#if COLLISIONBENCH_LINUX
+    if (m_available)
+    {
+        ioctl(m_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // With PERF_FORMAT_GROUP the leader reads the number of counters followed by each value
+        uint64_t values[1 + NUM_COUNTERS];
+        const ssize_t bytes = read(m_fds[0], values, sizeof(values));
+        if (bytes == static_cast<ssize_t>(sizeof(values)) && values[0] == NUM_COUNTERS)
+        {
+            for (uint32_t i = 0; i < NUM_COUNTERS; ++i)
+            {
+                counts[i] = values[1 + i];
+            }
+        }
+    }
+#endif // COLLISIONBENCH_LINUX
+}
+
+
+/**
+\brief Gets the name of a counter, as used in the JSON results.
+\param counter The counter.
+\return The name of the counter.
+*/
+const char *
+HardwareCounters::GetName(Counter counter)
+{
+    static const char *names[NUM_COUNTERS] =
+    {
+        "cycles",
+        "instructions",
+        "cacheMisses",
+        "branchMisses"
+    };
+    return names[counter];
+}
+
+
+} // namespace collisionbench
@@ -0,0 +1,104 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: benchplatform.h
+
+ Purpose: Timing, CPU pinning, cache eviction and hardware counters for the standalone benchmark harness.
+
+ On Linux the hardware counters are read through perf_event_open. On other platforms, or when the kernel
+ does not allow access to the counters, HardwareCounters::IsAvailable returns false and only times are
+ reported.
+ */
+
+#ifndef RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHPLATFORM_H
+#define RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHPLATFORM_H
+
+#include <EABase/eabase.h>
+
+namespace collisionbench
+{
+
+
+/**
+\brief Reads a monotonic clock.
+\return The time in nanoseconds from an arbitrary start.
+*/
+uint64_t
+ReadNanoseconds();
+
+
+/**
+\brief Pins the calling thread to a single CPU so that timings are not disturbed by migration.
+\param cpu The index of the CPU.
+\return True if the thread was pinned.
+*/
+bool
+PinToCpu(uint32_t cpu);
+
+
+/**
+\brief Evicts the benchmark data from the caches, by streaming through a buffer larger than the last
+level cache, before a cold iteration.
+*/
+void
+EvictCaches();
+
+
+/**
+\brief A group of hardware counters which are read around each timed iteration.
+*/
+class HardwareCounters
+{
+public:
+
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        NUM_COUNTERS
+    };
+
+    HardwareCounters();
+
+    ~HardwareCounters();
+
+    bool
+    Open();
+
+    void
+    Close();
+
+    /**
+    \brief Gets whether the counters were opened.
+    \return True if the counters are read by Start and Stop.
+    */
+    bool
+    IsAvailable() const
+    {
+        return m_available;
+    }
+
+    void
+    Start();
+
+    void
+    Stop(uint64_t counts[NUM_COUNTERS]);
+
+    static const char *
+    GetName(Counter counter);
+
+private:
+
+    HardwareCounters(const HardwareCounters &);
+    HardwareCounters &operator=(const HardwareCounters &);
+
+    int  m_fds[NUM_COUNTERS];   ///< perf_event file descriptor of each counter, the first is the group leader.
+    bool m_available;           ///< Whether every counter was opened.
+};
+
+
+} // namespace collisionbench
+
+#endif // RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHPLATFORM_H
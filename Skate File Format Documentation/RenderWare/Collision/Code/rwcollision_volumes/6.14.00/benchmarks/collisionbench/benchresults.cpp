@@ -0,0 +1,552 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: benchresults.cpp
+
+ Purpose: Benchmark results, their summary statistics, JSON files and the comparison of two result files.
+ */
+
+#include "benchresults.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace collisionbench
+{
+
+
+namespace
+{
+
+/**
+Reads the JSON written by WriteResults. This is not a general JSON parser: it handles the objects, arrays,
+strings and numbers of the results file, and skips any members it does not know.
+*/
+class JSONReader
+{
+public:
+    explicit JSONReader(const char *text)
+        : m_text(text),
+          m_failed(false)
+    {
+    }
+
+    bool
+    Failed() const
+    {
+        return m_failed;
+    }
+
+    /// Consumes the character if it is next, ignoring white space.
+    bool
+    Accept(char c)
+    {
+        SkipWhitespace();
+        if (*m_text == c)
+        {
+            ++m_text;
+            return true;
+        }
+        return false;
+    }
+
+    void
+    Expect(char c)
+    {
+        if (!Accept(c))
+        {
+            m_failed = true;
+        }
+    }
+
+    std::string
+    ReadString()
+    {
+        std::string value;
+        Expect('"');
+        while (!m_failed && *m_text && *m_text != '"')
+        {
+            if (*m_text == '\\' && m_text[1])
+            {
+                ++m_text;
+            }
+            value += *m_text++;
+        }
+        Expect('"');
+        return value;
+    }
+
+    double
+    ReadNumber()
+    {
+        SkipWhitespace();
+        char *end = NULL;
+        const double value = strtod(m_text, &end);
+        if (end == m_text)
+        {
+            m_failed = true;
+        }
+        m_text = end;
+        return value;
+    }
+
+    void
+    SkipValue()
+    {
+        SkipWhitespace();
+        if (*m_text == '"')
+        {
+            ReadString();
+        }
+        else if (Accept('{'))
+        {
+            if (!Accept('}'))
+            {
+                do
+                {
+                    ReadString();
+                    Expect(':');
+                    SkipValue();
+                }
+                while (!m_failed && Accept(','));
+                Expect('}');
+            }
+        }
+        else if (Accept('['))
+        {
+            if (!Accept(']'))
+            {
+                do
+                {
+                    SkipValue();
+                }
+                while (!m_failed && Accept(','));
+                Expect(']');
+            }
+        }
+        else if (!strncmp(m_text, "true", 4) || !strncmp(m_text, "null", 4))
+        {
+            m_text += 4;
+        }
+        else if (!strncmp(m_text, "false", 5))
+        {
+            m_text += 5;
+        }
+        else
+        {
+            ReadNumber();
+        }
+    }
+
+private:
+    void
+    SkipWhitespace()
+    {
+        while (*m_text == ' ' || *m_text == '\t' || *m_text == '\n' || *m_text == '\r')
+        {
+            ++m_text;
+        }
+    }
+
+    const char *m_text;
+    bool        m_failed;
+};
+
+
+void
+ReadResult(JSONReader &reader, Result &result)
+{
+    result.m_operations = 0;
+    result.m_checksum = 0;
+    result.m_hasCounters = false;
+    for (uint32_t i = 0; i < HardwareCounters::NUM_COUNTERS; ++i)
+    {
+        result.m_counters[i] = 0.0;
+    }
+
+    reader.Expect('{');
+    if (reader.Accept('}'))
+    {
+        return;
+    }
+    do
+    {
+        const std::string key = reader.ReadString();
+        reader.Expect(':');
+        if (key == "name")
+        {
+            result.m_name = reader.ReadString();
+        }
+        else if (key == "mode")
+        {
+            result.m_mode = reader.ReadString();
+        }
+        else if (key == "operations")
+        {
+            result.m_operations = static_cast<uint32_t>(reader.ReadNumber());
+        }
+        else if (key == "checksum")
+        {
+            result.m_checksum = static_cast<uint64_t>(reader.ReadNumber());
+        }
+        else if (key == "samplesNs")
+        {
+            reader.Expect('[');
+            if (!reader.Accept(']'))
+            {
+                do
+                {
+                    result.m_samples.push_back(reader.ReadNumber());
+                }
+                while (!reader.Failed() && reader.Accept(','));
+                reader.Expect(']');
+            }
+        }
+        else
+        {
+            reader.SkipValue();
+        }
+    }
+    while (!reader.Failed() && reader.Accept(','));
+    reader.Expect('}');
+}
+
+
+double
+Percentile(const std::vector<double> &sorted, double fraction)
+{
+    // Nearest rank
+    size_t rank = static_cast<size_t>(ceil(fraction * static_cast<double>(sorted.size())));
+    rank = (rank > 0) ? rank - 1 : 0;
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+
+double
+Median(const std::vector<double> &samples)
+{
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    if (n == 0)
+    {
+        return 0.0;
+    }
+    return (n & 1) ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+}
+
+} // namespace
+
+
+/**
+\brief Computes the summary statistics of a set of samples.
+\param samples The samples, which need not be sorted.
+\return The minimum, median, 99th percentile, mean and standard deviation of the samples.
+*/
+Summary
+Summarize(const std::vector<double> &samples)
+{
+    Summary summary;
+    memset(&summary, 0, sizeof(summary));
+    if (samples.empty())
+    {
+        return summary;
+    }
+
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        sum += sorted[i];
+    }
+    const double mean = sum / static_cast<double>(sorted.size());
+
+    double sumSquares = 0.0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        sumSquares += (sorted[i] - mean) * (sorted[i] - mean);
+    }
+
+    summary.m_min = sorted.front();
+    summary.m_median = Median(sorted);
+    summary.m_p99 = Percentile(sorted, 0.99);
+    summary.m_mean = mean;
+    summary.m_stddev = (sorted.size() > 1) ? sqrt(sumSquares / static_cast<double>(sorted.size() - 1)) : 0.0;
+    return summary;
+}
+
+
+/**
+\brief Writes results as JSON. The samples are written as well as their summary, so that two files can be
+compared with a significance test.
+\param filename The file to write, or "-" for stdout.
+\param config The settings of the harness.
+\param results The results to write.
+\return True if the file was written.
+*/
+bool
+WriteResults(const char *filename,
+             const Config &config,
+             const std::vector<Result> &results)
+{
+    FILE *file = strcmp(filename, "-") ? fopen(filename, "w") : stdout;
+    if (!file)
+    {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"harness\": \"collisionbench\",\n  \"version\": 1,\n");
+    fprintf(file, "  \"config\": {\"cpu\": %d, \"warmIterations\": %u, \"coldIterations\": %u},\n",
+        config.m_cpu, config.m_warmIterations, config.m_coldIterations);
+    fprintf(file, "  \"results\": [");
+
+    for (size_t r = 0; r < results.size(); ++r)
+    {
+        const Result &result = results[r];
+        const Summary summary = Summarize(result.m_samples);
+
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"mode\": \"%s\", \"operations\": %u, \"checksum\": %llu,\n",
+            r ? "," : "", result.m_name.c_str(), result.m_mode.c_str(), result.m_operations,
+            static_cast<unsigned long long>(result.m_checksum));
+        fprintf(file, "     \"minNs\": %.0f, \"medianNs\": %.0f, \"p99Ns\": %.0f, \"meanNs\": %.1f, \"stddevNs\": %.1f,\n",
+            summary.m_min, summary.m_median, summary.m_p99, summary.m_mean, summary.m_stddev);
+
+        if (result.m_hasCounters)
+        {
+            fprintf(file, "     \"counters\": {");
+            for (uint32_t i = 0; i < HardwareCounters::NUM_COUNTERS; ++i)
+            {
+                fprintf(file, "%s\"%s\": %.0f", i ? ", " : "",
+                    HardwareCounters::GetName(static_cast<HardwareCounters::Counter>(i)), result.m_counters[i]);
+            }
+            fprintf(file, "},\n");
+        }
+
+        fprintf(file, "     \"samplesNs\": [");
+        for (size_t i = 0; i < result.m_samples.size(); ++i)
+        {
+            fprintf(file, "%s%.0f", i ? ", " : "", result.m_samples[i]);
+        }
+        fprintf(file, "]}");
+    }
+    fprintf(file, "\n  ]\n}\n");
+
+    const bool ok = !ferror(file);
+    if (file != stdout)
+    {
+        fclose(file);
+    }
+    return ok;
+}
+
+
+/**
+\brief Reads results written by WriteResults.
+\param filename The file to read.
+\param results Receives the results.
+\return True if the file was read.
+*/
+bool
+ReadResults(const char *filename,
+            std::vector<Result> &results)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    std::string text;
+    char buffer[4096];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        text.append(buffer, bytes);
+    }
+    fclose(file);
+
+    JSONReader reader(text.c_str());
+    reader.Expect('{');
+    if (!reader.Accept('}'))
+    {
+        do
+        {
+            const std::string key = reader.ReadString();
+            reader.Expect(':');
+            if (key == "results")
+            {
+                reader.Expect('[');
+                if (!reader.Accept(']'))
+                {
+                    do
+                    {
+                        results.push_back(Result());
+                        ReadResult(reader, results.back());
+                    }
+                    while (!reader.Failed() && reader.Accept(','));
+                    reader.Expect(']');
+                }
+            }
+            else
+            {
+                reader.SkipValue();
+            }
+        }
+        while (!reader.Failed() && reader.Accept(','));
+        reader.Expect('}');
+    }
+
+    return !reader.Failed();
+}
+
+
+/**
+\brief Tests whether two sets of samples come from the same distribution, with the Mann-Whitney U test.
+
+Benchmark times are not normally distributed, having a long tail from interrupts and other processes, so a
+rank test is used rather than a t-test. The normal approximation of U is used, with a correction for ties,
+which is accurate for ten or more samples in each set.
+
+\param a The first set of samples.
+\param b The second set of samples.
+\return The two sided p value, the probability of a difference at least this large if the two sets of
+        samples come from the same distribution.
+*/
+double
+MannWhitneyPValue(const std::vector<double> &a,
+                  const std::vector<double> &b)
+{
+    const size_t na = a.size();
+    const size_t nb = b.size();
+    if (na == 0 || nb == 0)
+    {
+        return 1.0;
+    }
+
+    // Rank the combined samples, remembering which set each came from
+    std::vector< std::pair<double, uint32_t> > all;
+    all.reserve(na + nb);
+    for (size_t i = 0; i < na; ++i)
+    {
+        all.push_back(std::make_pair(a[i], 0u));
+    }
+    for (size_t i = 0; i < nb; ++i)
+    {
+        all.push_back(std::make_pair(b[i], 1u));
+    }
+    std::sort(all.begin(), all.end());
+
+    const double n = static_cast<double>(na + nb);
+    double rankSumA = 0.0;
+    double tieCorrection = 0.0;
+    for (size_t i = 0; i < all.size(); )
+    {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first)
+        {
+            ++j;
+        }
+        // Tied samples share the mean of their ranks, which are 1 based
+        const double rank = 0.5 * static_cast<double>(i + 1 + j);
+        const double ties = static_cast<double>(j - i);
+        tieCorrection += ties * ties * ties - ties;
+        for (size_t k = i; k < j; ++k)
+        {
+            if (all[k].second == 0)
+            {
+                rankSumA += rank;
+            }
+        }
+        i = j;
+    }
+
+    const double u = rankSumA - 0.5 * static_cast<double>(na) * static_cast<double>(na + 1);
+    const double meanU = 0.5 * static_cast<double>(na) * static_cast<double>(nb);
+    const double varianceU = static_cast<double>(na) * static_cast<double>(nb) / 12.0 *
+        ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+    if (varianceU <= 0.0)
+    {
+        return 1.0;
+    }
+
+    // Continuity correction
+    const double z = (fabs(u - meanU) - 0.5) / sqrt(varianceU);
+    return (z > 0.0) ? erfc(z / sqrt(2.0)) : 1.0;
+}
+
+
+/**
+\brief Compares two sets of results and prints a line for each benchmark.
+
+A benchmark is flagged as a regression when its median is more than \a threshold slower than the baseline
+and the Mann-Whitney test shows the difference is significant at level \a alpha. Both conditions are
+needed: a small but consistent change is real but not worth failing a build for, and a large change in a
+noisy benchmark may not be real.
+
+\param baseline The results to compare against.
+\param current The new results.
+\param threshold The fractional change of the median which is flagged, such as 0.02 for 2%.
+\param alpha The significance level, such as 0.01.
+\return The number of regressions.
+*/
+uint32_t
+CompareResults(const std::vector<Result> &baseline,
+               const std::vector<Result> &current,
+               double threshold,
+               double alpha)
+{
+    uint32_t numRegressions = 0;
+
+    printf("%-48s %-5s %14s %14s %8s %9s  %s\n", "benchmark", "mode", "baseline(ns)", "current(ns)", "change", "p", "status");
+    for (size_t c = 0; c < current.size(); ++c)
+    {
+        const Result &cur = current[c];
+        const Result *base = NULL;
+        for (size_t b = 0; b < baseline.size() && !base; ++b)
+        {
+            if (baseline[b].m_name == cur.m_name && baseline[b].m_mode == cur.m_mode)
+            {
+                base = &baseline[b];
+            }
+        }
+
+        const double currentMedian = Median(cur.m_samples);
+        if (!base)
+        {
+            printf("%-48s %-5s %14s %14.0f %8s %9s  new\n", cur.m_name.c_str(), cur.m_mode.c_str(), "-", currentMedian, "-", "-");
+            continue;
+        }
+
+        const double baselineMedian = Median(base->m_samples);
+        const double change = (baselineMedian > 0.0) ? currentMedian / baselineMedian - 1.0 : 0.0;
+        const double p = MannWhitneyPValue(base->m_samples, cur.m_samples);
+
+        const char *status = "ok";
+        if (base->m_checksum != cur.m_checksum || base->m_operations != cur.m_operations)
+        {
+            // The benchmark no longer does the same work so the times are not comparable
+            status = "results differ";
+        }
+        else if (p < alpha && change > threshold)
+        {
+            status = "REGRESSION";
+            ++numRegressions;
+        }
+        else if (p < alpha && change < -threshold)
+        {
+            status = "improved";
+        }
+
+        printf("%-48s %-5s %14.0f %14.0f %+7.1f%% %9.2g  %s\n", cur.m_name.c_str(), cur.m_mode.c_str(),
+            baselineMedian, currentMedian, 100.0 * change, p, status);
+    }
+
+    return numRegressions;
+}
+
+
+} // namespace collisionbench
@@ -0,0 +1,87 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: benchresults.h
+
+ Purpose: Benchmark results, their summary statistics, JSON files and the comparison of two result files.
+ */
+
+#ifndef RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHRESULTS_H
+#define RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHRESULTS_H
+
+#include <EABase/eabase.h>
+
+#include <string>
+#include <vector>
+
+#include "benchplatform.h"
+
+namespace collisionbench
+{
+
+
+/**
+\brief Summary statistics of the samples of one benchmark.
+*/
+struct Summary
+{
+    double m_min;
+    double m_median;
+    double m_p99;
+    double m_mean;
+    double m_stddev;
+};
+
+
+/**
+\brief The result of running one benchmark in one mode.
+*/
+struct Result
+{
+    std::string           m_name;           ///< Data file and benchmark, such as "courtyard.dat/LineNearest".
+    std::string           m_mode;           ///< "warm" or "cold".
+    uint32_t              m_operations;     ///< Queries run by each iteration.
+    uint64_t              m_checksum;       ///< Checksum of the query results, which should not change.
+    std::vector<double>   m_samples;        ///< Duration of each iteration in nanoseconds.
+    bool                  m_hasCounters;    ///< Whether m_counters were measured.
+    double                m_counters[HardwareCounters::NUM_COUNTERS];   ///< Mean of each counter per iteration.
+};
+
+
+/**
+\brief The harness settings written with the results.
+*/
+struct Config
+{
+    int32_t  m_cpu;                 ///< The CPU the harness was pinned to, or -1.
+    uint32_t m_warmIterations;
+    uint32_t m_coldIterations;
+};
+
+
+Summary
+Summarize(const std::vector<double> &samples);
+
+bool
+WriteResults(const char *filename,
+             const Config &config,
+             const std::vector<Result> &results);
+
+bool
+ReadResults(const char *filename,
+            std::vector<Result> &results);
+
+double
+MannWhitneyPValue(const std::vector<double> &a,
+                  const std::vector<double> &b);
+
+uint32_t
+CompareResults(const std::vector<Result> &baseline,
+               const std::vector<Result> &current,
+               double threshold,
+               double alpha);
+
+
+} // namespace collisionbench
+
+#endif // RWCOLLISION_VOLUMES_BENCHMARKS_COLLISIONBENCH_BENCHRESULTS_H
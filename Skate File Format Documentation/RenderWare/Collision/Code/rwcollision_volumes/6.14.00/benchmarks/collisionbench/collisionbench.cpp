@@ -0,0 +1,277 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+
+#include <rw/collision/common.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rw/collision/initialize.h>
+
+#include "benchplatform.h"
+#include "benchresults.h"
+#include "benchcases.h"
+
+#include "EAMain/EAEntryPointMain.inl" // For EAMain
+
+
+/*
+A standalone benchmark harness for the collision queries, which does not depend on the benchmarkenvironment
+or eaphysics_unitframework packages used by the benchmarks in the tests folder.
+
+The harness loads the unit test data files and runs line and bbox queries against each of them. Every
+benchmark is run for a number of warm iterations, after an untimed iteration which brings the data into
+the caches, and a number of cold iterations, each of which follows an eviction of the caches. The thread is
+pinned to one CPU, and on Linux the cycles, instructions, cache misses and branch misses of each iteration
+are read with perf_event_open where the kernel allows it.
+
+Usage:
+
+    collisionbench run [--data <dir>] [--out <file>] [--cpu <n>] [--warm <n>] [--cold <n>] [--filter <str>]
+
+        Runs the benchmarks and writes JSON with the min, median, p99, mean and standard deviation of
+        each, the mean hardware counters of an iteration, and every sample.
+
+    collisionbench compare <baseline.json> <current.json> [--threshold <percent>] [--alpha <p>]
+
+        Compares two result files and exits with a non zero status if any benchmark is a statistically
+        significant regression: its median is more than the threshold slower (default 2%) and a Mann-Whitney
+        U test of the samples is significant at alpha (default 0.01).
+
+For stable results, run on an otherwise idle machine with frequency scaling disabled, for example with
+"cpupower frequency-set -g performance", and with /proc/sys/kernel/perf_event_paranoid set to 2 or lower
+to allow the hardware counters to be read.
+*/
+
+
+namespace
+{
+
+void
+PrintUsage()
+{
+    fprintf(stderr,
+        "usage: collisionbench run [--data <dir>] [--out <file>] [--cpu <n>] [--warm <n>] [--cold <n>] [--filter <str>]\n"
+        "       collisionbench compare <baseline.json> <current.json> [--threshold <percent>] [--alpha <p>]\n");
+}
+
+
+/// Times every iteration of a benchmark in one mode and adds the result.
+void
+RunBenchmark(collisionbench::Benchmark &benchmark,
+             bool cold,
+             uint32_t numIterations,
+             collisionbench::HardwareCounters &counters,
+             std::vector<collisionbench::Result> &results)
+{
+    using collisionbench::HardwareCounters;
+
+    collisionbench::Result result;
+    result.m_name = benchmark.GetName();
+    result.m_mode = cold ? "cold" : "warm";
+    result.m_operations = benchmark.GetNumOperations();
+    result.m_hasCounters = counters.IsAvailable();
+    for (uint32_t i = 0; i < HardwareCounters::NUM_COUNTERS; ++i)
+    {
+        result.m_counters[i] = 0.0;
+    }
+
+    // Untimed run to load the data, and to get the checksum every timed run should match
+    result.m_checksum = benchmark.Run();
+
+    for (uint32_t it = 0; it < numIterations; ++it)
+    {
+        if (cold)
+        {
+            collisionbench::EvictCaches();
+        }
+
+        uint64_t counts[HardwareCounters::NUM_COUNTERS];
+        counters.Start();
+        const uint64_t start = collisionbench::ReadNanoseconds();
+        const uint64_t checksum = benchmark.Run();
+        const uint64_t end = collisionbench::ReadNanoseconds();
+        counters.Stop(counts);
+
+        if (checksum != result.m_checksum)
+        {
+            fprintf(stderr, "collisionbench: %s gave different results on iteration %u.\n", result.m_name.c_str(), it);
+        }
+
+        result.m_samples.push_back(static_cast<double>(end - start));
+        for (uint32_t i = 0; i < HardwareCounters::NUM_COUNTERS; ++i)
+        {
+            result.m_counters[i] += static_cast<double>(counts[i]) / static_cast<double>(numIterations);
+        }
+    }
+
+    const collisionbench::Summary summary = collisionbench::Summarize(result.m_samples);
+    fprintf(stderr, "%-48s %s  min %10.3f ms  median %10.3f ms  p99 %10.3f ms\n", result.m_name.c_str(),
+        result.m_mode.c_str(), summary.m_min * 1e-6, summary.m_median * 1e-6, summary.m_p99 * 1e-6);
+
+    results.push_back(result);
+}
+
+
+int
+Run(int argc, char **argv)
+{
+    const char *dataDirectory = "tests/rwunittestdata";
+    const char *outFilename = "-";
+    const char *filter = NULL;
+    collisionbench::Config config;
+    config.m_cpu = 0;
+    config.m_warmIterations = 30;
+    config.m_coldIterations = 10;
+
+    for (int i = 0; i < argc; ++i)
+    {
+        const bool hasValue = (i + 1 < argc);
+        if (!strcmp(argv[i], "--data") && hasValue)
+        {
+            dataDirectory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--out") && hasValue)
+        {
+            outFilename = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cpu") && hasValue)
+        {
+            config.m_cpu = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--warm") && hasValue)
+        {
+            config.m_warmIterations = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--cold") && hasValue)
+        {
+            config.m_coldIterations = static_cast<uint32_t>(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--filter") && hasValue)
+        {
+            filter = argv[++i];
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (config.m_cpu >= 0 && !collisionbench::PinToCpu(static_cast<uint32_t>(config.m_cpu)))
+    {
+        fprintf(stderr, "collisionbench: Unable to pin to CPU %d, timings may be noisy.\n", config.m_cpu);
+        config.m_cpu = -1;
+    }
+
+    // Opened after pinning so that the counters follow the pinned thread
+    collisionbench::HardwareCounters counters;
+    if (!counters.Open())
+    {
+        fprintf(stderr, "collisionbench: Hardware counters are not available, only times are reported.\n");
+    }
+
+    // We have to initialize the vtables before using any volume features.
+    rw::collision::InitializeVTables();
+
+    std::vector<collisionbench::Result> results;
+    {
+        collisionbench::BenchmarkSet benchmarks;
+        if (0 == benchmarks.Load(dataDirectory, filter))
+        {
+            fprintf(stderr, "collisionbench: No benchmarks to run from %s.\n", dataDirectory);
+            return 1;
+        }
+
+        const std::vector<collisionbench::Benchmark *> &list = benchmarks.GetBenchmarks();
+        for (size_t b = 0; b < list.size(); ++b)
+        {
+            if (config.m_warmIterations > 0)
+            {
+                RunBenchmark(*list[b], false, config.m_warmIterations, counters, results);
+            }
+            if (config.m_coldIterations > 0)
+            {
+                RunBenchmark(*list[b], true, config.m_coldIterations, counters, results);
+            }
+        }
+    }
+
+    if (!collisionbench::WriteResults(outFilename, config, results))
+    {
+        fprintf(stderr, "collisionbench: Unable to write %s.\n", outFilename);
+        return 1;
+    }
+    return 0;
+}
+
+
+int
+Compare(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    double threshold = 0.02;
+    double alpha = 0.01;
+    for (int i = 2; i < argc; ++i)
+    {
+        const bool hasValue = (i + 1 < argc);
+        if (!strcmp(argv[i], "--threshold") && hasValue)
+        {
+            threshold = atof(argv[++i]) / 100.0;
+        }
+        else if (!strcmp(argv[i], "--alpha") && hasValue)
+        {
+            alpha = atof(argv[++i]);
+        }
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    std::vector<collisionbench::Result> baseline;
+    std::vector<collisionbench::Result> current;
+    if (!collisionbench::ReadResults(argv[0], baseline))
+    {
+        fprintf(stderr, "collisionbench: Unable to read %s.\n", argv[0]);
+        return 2;
+    }
+    if (!collisionbench::ReadResults(argv[1], current))
+    {
+        fprintf(stderr, "collisionbench: Unable to read %s.\n", argv[1]);
+        return 2;
+    }
+
+    const uint32_t numRegressions = collisionbench::CompareResults(baseline, current, threshold, alpha);
+    if (numRegressions > 0)
+    {
+        printf("%u regression%s found.\n", numRegressions, (numRegressions == 1) ? "" : "s");
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+
+int EAMain(int argc, char **argv)
+{
+    if (argc >= 2 && !strcmp(argv[1], "run"))
+    {
+        return Run(argc - 2, argv + 2);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "compare"))
+    {
+        return Compare(argc - 2, argv + 2);
+    }
+
+    PrintUsage();
+    return 2;
+}
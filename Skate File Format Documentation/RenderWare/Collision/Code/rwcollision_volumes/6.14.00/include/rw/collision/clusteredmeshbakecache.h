@@ -0,0 +1,255 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#ifndef PUBLIC_RW_COLLISION_CLUSTEREDMESHBAKECACHE_H
+#define PUBLIC_RW_COLLISION_CLUSTEREDMESHBAKECACHE_H
+
+
+#include <rw/collision/common.h>
+
+#if !defined EA_PLATFORM_PS3_SPU
+
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/clusteredmeshofflinebuilder.h>
+
+
+// Forward declarations
+namespace rw
+{
+    namespace collision
+    {
+        class ClusteredMesh;
+    }
+}
+
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\class ClusteredMeshBakeCache
+\brief Cache of built ClusteredMeshes, addressed by a hash of the builder input and parameters, so that
+an offline bake of many collision models only rebuilds those whose input has changed.
+
+The key of a build is a 128 bit hash of the raw bits of the vertices, triangle vertex indices, group and
+surface IDs and merge planes of the input, of every field of the Parameters other than the
+parallelDispatcher, which does not change the built mesh, of the cache FORMAT_VERSION, of the builder
+BUILDER_VERSION and of the serialization versions of ClusteredMesh and ClusteredMeshCluster. The same
+input and parameters always build the same ClusteredMesh with the same builder, so a mesh returned from
+the cache is identical to one built afresh, and entries stored by an older builder or serialization are
+never returned.
+
+The built meshes are held by a Store implemented by the application, typically as files named by the
+key in a local directory. The cache keeps an index of the entries of the Store, with the size each was
+stored with and when each was last used, and evicts the least recently used entries from the Store when
+the number of entries or their total size exceeds the limits of the cache. The index is not persistent:
+an application with a persistent Store saves the entries read back with GetEntry after a bake, and
+registers them with RegisterEntry, with their saved times of last use, when the cache is next created.
+*/
+class ClusteredMeshBakeCache
+{
+public:
+
+    typedef ClusteredMeshOfflineBuilder::Parameters Parameters;
+
+    /// Version of the cache keys, included in each key. Changing it invalidates all stored entries.
+    enum
+    {
+        FORMAT_VERSION = 1
+    };
+
+    /**
+    \brief The 128 bit key of a build.
+    */
+    struct Key
+    {
+        /// Size of the string written by ToString, including the terminator.
+        enum
+        {
+            STRING_SIZE = 33
+        };
+
+        bool operator == (const Key &other) const;
+
+        bool operator < (const Key &other) const;
+
+        /// Writes the key as 32 hexadecimal digits, suitable as a file name, into a buffer of STRING_SIZE.
+        void ToString(char *buffer) const;
+
+        /// Reads a key written by ToString, returning false if the string is not 32 hexadecimal digits.
+        bool FromString(const char *string);
+
+        uint32_t words[4];
+    };
+
+    /**
+    \brief The input of a build, in buffers owned by the application.
+    */
+    struct Input
+    {
+        Input()
+            : numTriangles(0)
+            , numVertices(0)
+            , numMergePlanes(0)
+            , triangleVertexIndices(NULL)
+            , triangleGroupIDs(NULL)
+            , triangleSurfaceIDs(NULL)
+            , vertices(NULL)
+            , mergePlaneNormals(NULL)
+            , mergePlaneDistances(NULL)
+        {
+        }
+
+        /// Number of triangles.
+        uint32_t numTriangles;
+        /// Number of vertices.
+        uint32_t numVertices;
+        /// Number of merge planes.
+        uint32_t numMergePlanes;
+        /// Three vertex indices for each triangle.
+        const uint32_t *triangleVertexIndices;
+        /// Group ID of each triangle, or NULL for a group ID of zero.
+        const uint32_t *triangleGroupIDs;
+        /// Surface ID of each triangle, or NULL for a surface ID of zero.
+        const uint32_t *triangleSurfaceIDs;
+        /// Vertex positions.
+        const rw::math::fpu::Vector3U_32 *vertices;
+        /// Normal of each merge plane.
+        const rwpmath::Vector3 *mergePlaneNormals;
+        /// Distance of each merge plane.
+        const rwpmath::VecFloat *mergePlaneDistances;
+    };
+
+    /**
+    \brief Interface through which the cache loads, saves and removes the built meshes.
+    */
+    class Store
+    {
+    public:
+
+        virtual ~Store()
+        {
+        }
+
+        /// Loads the ClusteredMesh stored with a key, allocated from the allocator, returning NULL if it cannot be loaded.
+        virtual ClusteredMesh *Load(const Key &key, EA::Allocator::ICoreAllocator &allocator) = 0;
+
+        /// Saves a ClusteredMesh with a key, setting the size it was stored with, returning false if it cannot be saved.
+        virtual bool Save(const Key &key, ClusteredMesh &clusteredMesh, uint32_t &storedSize) = 0;
+
+        /// Removes the ClusteredMesh stored with a key.
+        virtual void Remove(const Key &key) = 0;
+    };
+
+    /**
+    \brief An entry of the cache index.
+    */
+    struct Entry
+    {
+        /// The key of the entry.
+        Key key;
+        /// The size the entry was stored with.
+        uint32_t size;
+        /// The time of the last use of the entry, counted in cache lookups.
+        uint32_t lastUse;
+    };
+
+    /**
+    \brief Counts of the cache operations since the cache was created or the statistics last reset.
+    */
+    struct Statistics
+    {
+        Statistics()
+            : numLookups(0)
+            , numHits(0)
+            , numMisses(0)
+            , numStores(0)
+            , numEvictions(0)
+            , numFailedLoads(0)
+            , numFailedStores(0)
+        {
+        }
+
+        /// Number of builds requested.
+        uint32_t numLookups;
+        /// Number of builds loaded from the Store.
+        uint32_t numHits;
+        /// Number of builds run, including those whose entry could not be loaded.
+        uint32_t numMisses;
+        /// Number of built meshes saved to the Store.
+        uint32_t numStores;
+        /// Number of entries evicted from the Store.
+        uint32_t numEvictions;
+        /// Number of entries which could not be loaded, and were removed.
+        uint32_t numFailedLoads;
+        /// Number of built meshes which could not be saved.
+        uint32_t numFailedStores;
+    };
+
+    ClusteredMeshBakeCache(Store &store,
+                           uint32_t maxEntries,
+                           uint32_t maxTotalSize,
+                           EA::Allocator::ICoreAllocator *allocator);
+
+    ~ClusteredMeshBakeCache();
+
+    static void ComputeKey(Key &key, const Input &input, const Parameters &builderParams);
+
+    rw::collision::ClusteredMesh * BuildClusteredMesh(const Input &input, Parameters &builderParams);
+
+    bool RegisterEntry(const Key &key, uint32_t size, uint32_t lastUse);
+
+    uint32_t GetNumEntries() const;
+
+    const Entry &GetEntry(uint32_t entryIndex) const;
+
+    uint32_t GetTotalSize() const;
+
+    const Statistics &GetStatistics() const;
+
+    void ResetStatistics();
+
+private:
+
+    bool FindEntry(const Key &key, uint32_t &entryIndex) const;
+
+    void InsertEntry(const Key &key, uint32_t size, uint32_t entryIndex);
+
+    void RemoveEntry(uint32_t entryIndex);
+
+    void EvictEntries();
+
+    /// The Store of the built meshes.
+    Store                     &m_store;
+    /// The Allocator of the index and of the built meshes.
+    EA::Allocator::ICoreAllocator *m_allocator;
+    /// The index entries, sorted by key, with room for one more than the maximum.
+    Entry                     *m_entries;
+    /// Number of index entries.
+    uint32_t                   m_numEntries;
+    /// Maximum number of index entries.
+    uint32_t                   m_maxEntries;
+    /// Maximum total size of the entries, or zero for no limit.
+    uint32_t                   m_maxTotalSize;
+    /// Total size of the entries.
+    uint32_t                   m_totalSize;
+    /// The time, counted in cache lookups.
+    uint32_t                   m_time;
+    /// Counts of the cache operations.
+    Statistics                 m_statistics;
+
+    /// Private copy constructor.
+    ClusteredMeshBakeCache(const ClusteredMeshBakeCache & other);
+    /// Private assignment constructor.
+    ClusteredMeshBakeCache & operator = (const ClusteredMeshBakeCache & other);
+};
+
+} // namespace collision
+} // namespace rw
+
+#endif // !defined EA_PLATFORM_PS3_SPU
+
+#endif // PUBLIC_RW_COLLISION_CLUSTEREDMESHBAKECACHE_H
@@ -18,6 +18,7 @@
 #include "rw/collision/clusteredmeshunit.h"
 #include "rw/collision/kdtree.h"
 #include "rw/collision/kdtreewithsubtrees.h"
+#include "rw/collision/clusterunitbounds.h"
 
 // Alignment must be 16 to support loading legacy data
 #define rwcCLUSTEREDMESH_ALIGNMENT 16
@@ -34,6 +35,13 @@ namespace collision
     // that it can be used in method arguments
     class TriangleVolume;
 
+    // Forward declare the shape cast types used by ClusteredMesh::ShapeCast
+    struct CastShape;
+    struct ShapeCastResult;
+
+    // Forward declare the result type used by the ClusteredMesh closest point queries
+    struct DistanceQueryResult;
+
 } // namespace collision
 } // namespace rw
 
@@ -42,7 +50,10 @@ namespace collision
 // Version 2 fixed arithmetic for vertex array address.
 // Version 3 changed mKDTree to be a KDTreeWithSubTrees pointer and the cluster offsets to be 
 // relative to mCluster array rather than the ClusteredMesh.
-EA_SERIALIZATION_CLASS_VERSION(rw::collision::ClusteredMesh, 5)
+// Version 6 added the optional mUnitBounds.
+// Version 7 added clusters with 8-bit and 10-bit vertex compression.
+#define rwcCLUSTEREDMESH_SERIALIZATION_VERSION 7
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::ClusteredMesh, rwcCLUSTEREDMESH_SERIALIZATION_VERSION)
 // These macro provide the type name used in text-based archives' serialization.
 EA_SERIALIZATION_CLASS_NAME(rw::collision::ClusteredMesh, "rw::collision::ClusteredMesh")
 
@@ -83,7 +94,8 @@ public:
                           const rw::collision::AABBox &bbox,
                           float vertexCompressionGranularity = 0.01f,
                           uint32_t classSize = sizeof(ClusteredMesh),
-                          RwpBool includeKDSubTrees = FALSE);
+                          RwpBool includeKDSubTrees = FALSE,
+                          uint32_t unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE);
 
     static ClusteredMesh *
     Initialize(const EA::Physics::MemoryPtr & memoryResource,
@@ -94,7 +106,8 @@ public:
                const rw::collision::AABBox &bbox,
                float vertexCompressionGranularity = 0.01f,
                uint32_t classSize = sizeof(ClusteredMesh),
-               RwpBool includeKDSubTrees = FALSE);
+               RwpBool includeKDSubTrees = FALSE,
+               uint32_t unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE);
 
     void
     Release();
@@ -120,6 +133,9 @@ public:
     const KDSubTree *
     GetClusterKDTree(uint32_t clusterIndex) const;
 
+    const ClusterUnitBounds *
+    GetClusterUnitBounds() const;
+
     uint32_t
     GetNumCluster() const;
 
@@ -218,6 +234,12 @@ public:
 
     void CreateClusterKDTrees(const EA::Physics::MemoryPtr &workspaceRes);
 
+    void SetClusterUnitBounds(ClusterUnitBounds * unitBounds);
+
+    void CreateClusterUnitBounds();
+
+    void UpdateClusterUnitBounds(uint32_t clusterIndex);
+
     void
     GetVolumeFromChildIndex(rw::collision::TriangleVolume & volume, uint32_t childIndex) const;
 
@@ -230,6 +252,32 @@ public:
     uint32_t
     GetTriangleIndexWithinUnitFromChildIndex(uint32_t childIndex) const;
 
+    RwpBool
+    ShapeCast(ShapeCastResult &result,
+              const CastShape &shape,
+              rwpmath::Vector3::InParam delta,
+              const rwpmath::Matrix44Affine *tm) const;
+
+    RwpBool
+    ClosestPointQuery(DistanceQueryResult &result,
+                      rwpmath::Vector3::InParam point,
+                      float maxDistance,
+                      const rwpmath::Matrix44Affine *tm) const;
+
+    uint32_t
+    ClosestPointsQuery(DistanceQueryResult *results,
+                       uint32_t maxResults,
+                       rwpmath::Vector3::InParam point,
+                       float maxDistance,
+                       const rwpmath::Matrix44Affine *tm) const;
+
+    uint32_t
+    ClosestPointQueryBatch(DistanceQueryResult *results,
+                           const rwpmath::Vector3 *points,
+                           uint32_t numPoints,
+                           float maxDistance,
+                           const rwpmath::Matrix44Affine *tm) const;
+
     // *****************************************************************************************************
     // Virtual functions required by the Aggregate interface
 
@@ -270,6 +318,16 @@ public:
         {
             bytes += sizeof(rw::collision::ClusteredMeshCluster::Vertex32) * cluster.vertexCount;
         }
+        else if (cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED)
+        {
+            bytes += sizeof(rw::collision::ClusteredMeshCluster::VertexHeader);
+            bytes += sizeof(rw::collision::ClusteredMeshCluster::Vertex8) * cluster.vertexCount;
+        }
+        else if (cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED)
+        {
+            bytes += sizeof(rw::collision::ClusteredMeshCluster::VertexHeader);
+            bytes += sizeof(uint32_t) * cluster.vertexCount;
+        }
         else
         {
             bytes += rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT * cluster.vertexCount;
@@ -334,6 +392,8 @@ protected:
 
     uint32_t mNumClusterTagBits;          ///<The number of bits required to store the cluster tags
 
+    ClusterUnitBounds * mUnitBounds;      ///<The optional quantized bounds of the units in each cluster, or NULL
+
     static VTable sm_vTable;
 
     /* inherited from Aggregate
@@ -652,7 +712,8 @@ ClusteredMesh::SetOneSided(RwpBool onesided)
 // We need to specify the class serialization version prior to the class definition
 // due to a problem with ps2 gcc.
 // Version 2 added m_includeKDSubTrees
-EA_SERIALIZATION_CLASS_VERSION(rw::collision::ClusteredMesh::ObjectDescriptor, 2)
+// Version 3 added m_unitBoundsFormat
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::ClusteredMesh::ObjectDescriptor, 3)
 
 namespace rw {
 namespace collision {
@@ -664,7 +725,8 @@ struct ClusteredMesh::ObjectDescriptor
         uint32_t numBranchNodes,
         uint32_t maxUnits,
         const rw::collision::AABBox& bbox,
-        RwpBool includeKDSubTrees = FALSE)
+        RwpBool includeKDSubTrees = FALSE,
+        uint32_t unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE)
     {
         m_maxClusters = maxClusters;
         m_clusterDataSize = clusterDataSize;
@@ -672,6 +734,7 @@ struct ClusteredMesh::ObjectDescriptor
         m_maxUnits = maxUnits;
         m_bbox = bbox;
         m_includeKDSubTrees = includeKDSubTrees;
+        m_unitBoundsFormat = unitBoundsFormat;
     }
 
     ObjectDescriptor()
@@ -682,6 +745,7 @@ struct ClusteredMesh::ObjectDescriptor
         m_maxUnits = 0;
         m_bbox = AABBox(rwpmath::GetVector3_Zero(), rwpmath::GetVector3_Zero());
         m_includeKDSubTrees = FALSE;
+        m_unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE;
     }
 
     uint32_t m_maxClusters;
@@ -690,6 +754,7 @@ struct ClusteredMesh::ObjectDescriptor
     uint32_t m_maxUnits;
     rw::collision::AABBox m_bbox;
     RwpBool m_includeKDSubTrees;
+    uint32_t m_unitBoundsFormat;
 
     // NOTE: If any changes to this object affecting its LL-Serialization, you'll also need to
     // make identical changes to its FPU version here: ".\include\cmn\rw\collision\detail\fpu\"
@@ -709,6 +774,14 @@ struct ClusteredMesh::ObjectDescriptor
         {
             m_includeKDSubTrees = false;
         }
+        if (version > 2)
+        {
+            ar & EA_SERIALIZATION_NAMED_VALUE(m_unitBoundsFormat);
+        }
+        else
+        {
+            m_unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE;
+        }
     }
 };
 
@@ -719,7 +792,8 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource, const ObjectDe
     return (Initialize(resource, objDesc.m_maxClusters,
                        objDesc.m_clusterDataSize, objDesc.m_numBranchNodes,
                        objDesc.m_maxUnits, objDesc.m_bbox,
-                       0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees));
+                       0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees,
+                       objDesc.m_unitBoundsFormat));
 }
 
 
@@ -729,7 +803,8 @@ ClusteredMesh::GetResourceDescriptor(const ObjectDescriptor & objDesc)
     return (GetResourceDescriptor(objDesc.m_maxClusters,
                                   objDesc.m_clusterDataSize, objDesc.m_numBranchNodes,
                                   objDesc.m_maxUnits, objDesc.m_bbox,
-                                  0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees));
+                                  0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees,
+                                  objDesc.m_unitBoundsFormat));
 }
 
 
@@ -745,7 +820,8 @@ inline const ClusteredMesh::ObjectDescriptor ClusteredMesh::GetObjectDescriptor(
     }
 
     return ObjectDescriptor(mMaxClusters, clusterdatasize,  mKDTree->m_numBranchNodes, mMaxUnits, m_AABB,
-        (RwpBool) (mKDTree->GetNumKDSubTrees() > 0));
+        (RwpBool) (mKDTree->GetNumKDSubTrees() > 0),
+        mUnitBounds ? mUnitBounds->GetFormat() : static_cast<uint32_t>(ClusterUnitBounds::FORMAT_NONE));
 }
 
 /**
@@ -763,6 +839,9 @@ ClusteredMesh::Release()
 EA::Physics::SizeAndAlignment
 GetKDSubTreeWorkSpaceResourceDescriptor(rw::collision::ClusteredMesh &clusteredMesh);
 
+EA::Physics::SizeAndAlignment
+GetKDSubTreeWorkSpaceResourceDescriptor(const uint32_t numBranchNodes);
+
 void
 CreateKDSubTreeArray(rw::collision::KDSubTree *kdSubTreeArray, const EA::Physics::MemoryPtr &workspaceRes, rw::collision::ClusteredMesh &clusteredMesh);
 
@@ -780,6 +859,52 @@ inline void ClusteredMesh::SetClusterKDTrees(KDSubTree * subtrees)
     mKDTree->SetKDSubTrees(subtrees, GetNumCluster());
 }
 
+/**
+\brief Sets the quantized bounds of the units in each cluster, used by the line and bbox queries to skip units.
+
+The bounds may be held in memory managed by the caller, for a mesh which was created without them.
+\param unitBounds Bounds built from this mesh with ClusterUnitBounds::Build, or NULL to stop using bounds.
+*/
+inline void ClusteredMesh::SetClusterUnitBounds(ClusterUnitBounds * unitBounds)
+{
+    EA_ASSERT(!unitBounds || unitBounds->GetNumClusters() == GetNumCluster());
+    mUnitBounds = unitBounds;
+}
+
+/**
+\brief Fills in the unit bounds reserved when the mesh was created with a unitBoundsFormat.
+Call this once all the clusters have been added.
+*/
+inline void ClusteredMesh::CreateClusterUnitBounds()
+{
+    if (mUnitBounds)
+    {
+        mUnitBounds->Build(*this);
+    }
+}
+
+/**
+\brief Refills the unit bounds of one cluster after it has been rewritten in place with the same units.
+\param clusterIndex The index of the rewritten cluster.
+*/
+inline void ClusteredMesh::UpdateClusterUnitBounds(uint32_t clusterIndex)
+{
+    if (mUnitBounds)
+    {
+        mUnitBounds->UpdateCluster(*this, clusterIndex);
+    }
+}
+
+/**
+\brief Gets the quantized bounds of the units in each cluster.
+\return The unit bounds, or NULL if the mesh has none.
+*/
+inline const ClusterUnitBounds *
+ClusteredMesh::GetClusterUnitBounds() const
+{
+    return mUnitBounds;
+}
+
 inline const KDSubTree *
 ClusteredMesh::GetClusterKDTree(uint32_t clusterIndex) const
 {
@@ -889,6 +1014,29 @@ inline void ClusteredMesh::Serialize(Archive &ar, uint32_t version)
             int32_t* vertexArray = const_cast<int32_t *>(vdUnion.m_asInt32Ptr);
             ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, cluster.vertexCount * 3u);
         }
+        else if ((cluster.compressionMode == ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED) ||
+                 (cluster.compressionMode == ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED))
+        {
+            EA_ASSERT_MSG(version > 6, ("8-bit and 10-bit vertex compression requires version 7."));
+
+            rw::collision::ClusteredMeshCluster::CompressedVertexDataUnion vdUnion;
+            vdUnion.m_as_rwpmathVector3Ptr = cluster.vertexArray;
+
+            // The header holds the offset and the granularity shift
+            uint32_t* vertexArrayHeader = const_cast<uint32_t *>(vdUnion.m_asUInt32Ptr);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArrayHeader, 4u);
+
+            if (cluster.compressionMode == ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED)
+            {
+                uint8_t* vertexArray = reinterpret_cast<uint8_t *>(vertexArrayHeader + 4);
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, cluster.vertexCount * 3u);
+            }
+            else
+            {
+                uint32_t* vertexArray = vertexArrayHeader + 4;
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, cluster.vertexCount);
+            }
+        }
         else
         {
             if (version == 1)
@@ -932,6 +1080,24 @@ inline void ClusteredMesh::Serialize(Archive &ar, uint32_t version)
         }
     }
 
+    if (version > 5)
+    {
+        // The unit bounds are only present when the mesh was created with a unit bounds format
+        ar.TrackInternalPointer(mUnitBounds);
+        if (mUnitBounds)
+        {
+            ar & EA_SERIALIZATION_NAMED_VALUE(*mUnitBounds);
+        }
+    }
+    else
+    {
+        EA_ASSERT(ar.IsLoading());  // Should only try to load older versions
+        if (ar.IsLoading())
+        {
+            mUnitBounds = NULL;
+        }
+    }
+
     if(ar.IsLoading())
     {
         // Initialize the Aggregate v-table
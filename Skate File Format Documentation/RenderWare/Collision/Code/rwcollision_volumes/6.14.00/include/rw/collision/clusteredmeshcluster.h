@@ -28,6 +28,9 @@ namespace collision
 #define rwcCLUSTEREDMESHCLUSTER_ALIGNMENT 16
 #define rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT 16
 
+// Serialization version of ClusteredMeshCluster, also used by the fpu layout and the keys of ClusteredMeshBakeCache
+#define rwcCLUSTEREDMESHCLUSTER_SERIALIZATION_VERSION 6
+
 namespace rw
 {
 namespace collision
@@ -43,7 +46,7 @@ namespace collision
 
 // We need to specify the class serialization version prior to the class definition
 // due to a problem with ps2 gcc.
-EA_SERIALIZATION_CLASS_VERSION(rw::collision::ClusteredMeshCluster, 5)
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::ClusteredMeshCluster, rwcCLUSTEREDMESHCLUSTER_SERIALIZATION_VERSION)
 // These macro provide the type name used in text-based archives' serialization.
 EA_SERIALIZATION_CLASS_NAME(rw::collision::ClusteredMeshCluster, "rw::collision::ClusteredMeshCluster")
 
@@ -231,7 +234,9 @@ public:
     {
         VERTICES_UNCOMPRESSED = 0,        ///<Uncompressed
         VERTICES_16BIT_COMPRESSED = 1,    ///<Compressed to 16 bit
-        VERTICES_32BIT_COMPRESSED = 2    ///<Compressed to 32 bit
+        VERTICES_32BIT_COMPRESSED = 2,    ///<Compressed to 32 bit
+        VERTICES_8BIT_COMPRESSED = 3,     ///<Compressed to 8 bit, with a per cluster granularity shift
+        VERTICES_10BIT_COMPRESSED = 4     ///<Compressed to 10 bit packed in 32 bits, with a per cluster granularity shift
     };
     /// Used to indicate to templated methods that the compression mode is not known statically and 
     /// should be read from the cluster at runtime. Only for use as parameter to templated GetVertex() methods.
@@ -260,6 +265,30 @@ public:
         int32_t z;
     };
 
+    /// Compressed vertex data, with 8-bit xyz components
+    struct Vertex8
+    {
+        uint8_t x;
+        uint8_t y;
+        uint8_t z;
+    };
+
+    /**
+    Header of the vertex data of clusters with 8-bit or 10-bit compression. A vertex decodes to
+    (offset + (component << granularityShift)) * vertexGranularity, so the cluster granularity is the
+    mesh granularity scaled by a power of two.
+    */
+    struct VertexHeader
+    {
+        Vertex32 offset;
+        uint32_t granularityShift;
+    };
+
+    /// Number of bits of each component of a vertex with 10-bit compression, packed as x | y << 10 | z << 20
+    static const uint32_t VERTEX10_BITS = 10u;
+    /// Mask of a component of a vertex with 10-bit compression
+    static const uint32_t VERTEX10_MASK = (1u << VERTEX10_BITS) - 1u;
+
     /// union to gain access to the vertex data using any form of compression
     union CompressedVertexDataUnion
     {
@@ -267,9 +296,13 @@ public:
         const Vertex32         *m_asVertex32Ptr;        ///< Vertex data as ClusteredMeshCluster::Vertex32*
         const Vertex16         *m_asVertex16Ptr;        ///< Vertex data as ClusteredMeshCluster::Vertex16*
         const int32_t          *m_asInt32Ptr;           ///< Vertex data as int32_t*
+        const VertexHeader     *m_asVertexHeaderPtr;    ///< Vertex data as ClusteredMeshCluster::VertexHeader*
+        const Vertex8          *m_asVertex8Ptr;         ///< Vertex data as ClusteredMeshCluster::Vertex8*
+        const uint32_t         *m_asUInt32Ptr;          ///< Vertex data as uint32_t*
     };
 
-    void SetVertexOffset(const rw::collision::ClusteredMeshCluster::Vertex32 clusterOffset);
+    void SetVertexOffset(const rw::collision::ClusteredMeshCluster::Vertex32 clusterOffset,
+                         const uint32_t granularityShift = 0u);
 
     void SetVertex(rwpmath::Vector3::InParam v,
                    const float vertexCompressionGranularity);
@@ -369,6 +402,33 @@ public:
             // Serialize the vertices
             ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, vertexCount * 3u);
         }
+        else if ((compressionMode == ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED) ||
+                 (compressionMode == ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED))
+        {
+            EA_ASSERT_MSG(version > 5, ("8-bit and 10-bit vertex compression requires version 6."));
+
+            // Access the vertex array as a collection of uint32_t
+            rw::collision::ClusteredMeshCluster::CompressedVertexDataUnion vdUnion;
+            vdUnion.m_as_rwpmathVector3Ptr = vertexArray;
+            uint32_t* vertexArrayHeader = const_cast<uint32_t *>(vdUnion.m_asUInt32Ptr);
+            // Serialize the vertex array header, the offset and the granularity shift
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArrayHeader, 4u);
+
+            if (compressionMode == ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED)
+            {
+                // Access the vertex array as a collection of uint8_t and offset the pointer to the end of the header
+                uint8_t* vertexArray = reinterpret_cast<uint8_t *>(vertexArrayHeader + 4);
+                // Serialize the vertices
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, vertexCount * 3u);
+            }
+            else
+            {
+                // Access the vertex array as a collection of packed uint32_t and offset the pointer to the end of the header
+                uint32_t* vertexArray = vertexArrayHeader + 4;
+                // Serialize the vertices
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, vertexCount);
+            }
+        }
         else
         {
             if (version == 1)
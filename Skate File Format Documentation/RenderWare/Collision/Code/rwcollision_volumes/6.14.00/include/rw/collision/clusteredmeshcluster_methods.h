@@ -144,6 +144,42 @@ ClusteredMeshCluster::GetVertexBase<ClusteredMeshCluster::VERTICES_32BIT_COMPRES
 #endif
         }
 
+// Specialization for 8-bit compression
+template <>
+RW_COLLISION_FORCE_INLINE rwpmath::Vector3
+ClusteredMeshCluster::GetVertexBase<ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED>(uint8_t vertid, const float &vertexGranularity) const
+{
+    EA_ASSERT(vertid < vertexCount);
+    EA_ASSERT(compressionMode == VERTICES_8BIT_COMPRESSED);
+    CompressedVertexDataUnion vdUnion;
+    vdUnion.m_as_rwpmathVector3Ptr = vertexArray;
+    const VertexHeader *header = vdUnion.m_asVertexHeaderPtr;
+    const Vertex8 *vertData = reinterpret_cast<const Vertex8 *>(header + 1); // skip the 16 byte header
+    const uint32_t shift = header->granularityShift;
+
+    return rwpmath::Vector3( (header->offset.x + static_cast<int32_t>(uint32_t(vertData[vertid].x) << shift)) * vertexGranularity,
+        (header->offset.y + static_cast<int32_t>(uint32_t(vertData[vertid].y) << shift)) * vertexGranularity,
+        (header->offset.z + static_cast<int32_t>(uint32_t(vertData[vertid].z) << shift)) * vertexGranularity );
+}
+
+// Specialization for 10-bit compression
+template <>
+RW_COLLISION_FORCE_INLINE rwpmath::Vector3
+ClusteredMeshCluster::GetVertexBase<ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED>(uint8_t vertid, const float &vertexGranularity) const
+{
+    EA_ASSERT(vertid < vertexCount);
+    EA_ASSERT(compressionMode == VERTICES_10BIT_COMPRESSED);
+    CompressedVertexDataUnion vdUnion;
+    vdUnion.m_as_rwpmathVector3Ptr = vertexArray;
+    const VertexHeader *header = vdUnion.m_asVertexHeaderPtr;
+    const uint32_t packed = vdUnion.m_asUInt32Ptr[4 + vertid]; // skip the 16 byte header
+    const uint32_t shift = header->granularityShift;
+
+    return rwpmath::Vector3( (header->offset.x + static_cast<int32_t>((packed & VERTEX10_MASK) << shift)) * vertexGranularity,
+        (header->offset.y + static_cast<int32_t>(((packed >> VERTEX10_BITS) & VERTEX10_MASK) << shift)) * vertexGranularity,
+        (header->offset.z + static_cast<int32_t>(((packed >> (2u * VERTEX10_BITS)) & VERTEX10_MASK) << shift)) * vertexGranularity );
+}
+
 /**
 \brief Decompresses and returns single vertex based on the vertex ID.
 
@@ -165,6 +201,10 @@ ClusteredMeshCluster::GetVertexBase<ClusteredMeshCluster::COMPRESSION_DYNAMIC>(u
         return GetVertexBase<VERTICES_16BIT_COMPRESSED>(vertid, vertexGranularity);
     case VERTICES_32BIT_COMPRESSED:
         return GetVertexBase<VERTICES_32BIT_COMPRESSED>(vertid, vertexGranularity);
+    case VERTICES_8BIT_COMPRESSED:
+        return GetVertexBase<VERTICES_8BIT_COMPRESSED>(vertid, vertexGranularity);
+    case VERTICES_10BIT_COMPRESSED:
+        return GetVertexBase<VERTICES_10BIT_COMPRESSED>(vertid, vertexGranularity);
     }
 }
 
@@ -415,6 +455,12 @@ ClusteredMeshCluster::Get3VerticesBase<ClusteredMeshCluster::COMPRESSION_DYNAMIC
     case VERTICES_16BIT_COMPRESSED:
         Get3VerticesBase<VERTICES_16BIT_COMPRESSED>(out0, out1, out2, v0, v1, v2, g);
         break;
+    case VERTICES_8BIT_COMPRESSED:
+        Get3VerticesBase<VERTICES_8BIT_COMPRESSED>(out0, out1, out2, v0, v1, v2, g);
+        break;
+    case VERTICES_10BIT_COMPRESSED:
+        Get3VerticesBase<VERTICES_10BIT_COMPRESSED>(out0, out1, out2, v0, v1, v2, g);
+        break;
     }
 }
 
@@ -697,6 +743,12 @@ void ClusteredMeshCluster::Get4VerticesBase<ClusteredMeshCluster::COMPRESSION_DY
     case VERTICES_32BIT_COMPRESSED:
         Get4VerticesBase<VERTICES_32BIT_COMPRESSED>(out0, out1, out2, out3, v0, v1, v2, v3, g);
         break;
+    case VERTICES_8BIT_COMPRESSED:
+        Get4VerticesBase<VERTICES_8BIT_COMPRESSED>(out0, out1, out2, out3, v0, v1, v2, v3, g);
+        break;
+    case VERTICES_10BIT_COMPRESSED:
+        Get4VerticesBase<VERTICES_10BIT_COMPRESSED>(out0, out1, out2, out3, v0, v1, v2, v3, g);
+        break;
     }
 
     }
@@ -71,6 +71,10 @@ public:
 
     rw::collision::ClusteredMesh * BuildClusteredMesh();
 
+    bool UpdateClusteredMesh(rw::collision::ClusteredMesh &clusteredMesh,
+                             const uint32_t *changedTriangles,
+                             uint32_t numChangedTriangles);
+
     void Release();
 
 private:
@@ -36,6 +36,9 @@ namespace collision
 The helper takes a block of memory, on construction, which is used to efficiently deal with memory allocation
 throughout the ClusteredMesh build process. The helper also takes an allocator, on construction, which is used
 to allocate the final ClusteredMesh.
+
+The size of the block of memory needed by a build can be found beforehand with GetRequiredBufferSize, and the
+memory actually used by each stage of a build with GetMemoryReport.
 */
 class ClusteredMeshRuntimeBuilder
 {
@@ -43,6 +46,13 @@ public:
 
     typedef meshbuilder::detail::ClusteredMeshBuilder::Parameters Parameters;
 
+    typedef meshbuilder::detail::ClusteredMeshBuilder::MemoryReport MemoryReport;
+
+    static uint32_t GetRequiredBufferSize(uint32_t           numPrim,
+                                          uint32_t           numVert,
+                                          uint32_t           numMergePlanes,
+                                          const Parameters   &builderParams);
+
     ClusteredMeshRuntimeBuilder(uint32_t           numPrim,
                                 uint32_t           numVert,
                                 uint32_t           numMergePlanes,
@@ -71,6 +81,10 @@ public:
 
     rw::collision::ClusteredMesh * BuildClusteredMesh();
 
+    void GetMemoryReport(MemoryReport &report) const;
+
+    uint32_t GetPeakMemoryUsed() const;
+
     void Release();
 
 private:
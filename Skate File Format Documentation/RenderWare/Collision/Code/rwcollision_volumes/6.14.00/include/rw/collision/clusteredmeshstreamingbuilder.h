@@ -0,0 +1,182 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#ifndef PUBLIC_RW_COLLISION_CLUSTEREDMESHSTREAMINGBUILDER_H
+#define PUBLIC_RW_COLLISION_CLUSTEREDMESHSTREAMINGBUILDER_H
+
+
+#include <rw/collision/common.h>
+
+#if !defined EA_PLATFORM_PS3_SPU
+
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/meshbuilder/detail/clusteredmeshbuilder.h>
+#include <rw/collision/meshbuilder/detail/linearallocator.h>
+#include <rw/collision/meshbuilder/detail/generalallocator.h>
+
+
+// Forward declarations
+namespace rw
+{
+    namespace collision
+    {
+        class ClusteredMesh;
+    }
+}
+
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\class ClusteredMeshStreamingBuilder
+\brief Helper class for building a mesh too large to hold in memory as a collection of ClusteredMeshes,
+one for each spatial chunk of the input.
+
+The input is read a chunk at a time from a ChunkReader, and each chunk is built into a ClusteredMesh which is
+passed to a ChunkWriter, to be written out, then freed. Every chunk is read twice. The first pass collects
+the boundary edges of each chunk, those not shared by two triangles of the chunk, which are matched across
+chunks by the positions of their vertices. The second pass builds each chunk together with copies of the
+triangles of the other chunks sharing its boundary edges, as border triangles. The edge cosines and edge
+codes of the triangles on the chunk boundaries are so the same as those of a build of the whole mesh.
+
+All build workspace, including the chunk input and the boundary edges, is taken from a single buffer of a
+fixed size, the memory budget. The build fails if the budget is too small for the largest chunk. The
+ClusteredMesh of each chunk is allocated from the mesh allocator, and freed once it has been written.
+
+Chunks should share bit identical vertex positions along their boundaries. Vertex smoothing and unmatched
+edge correction only see the triangles of a chunk and its border triangles.
+
+Quads are never formed across chunk boundaries. Two triangles on either side of a boundary always stay
+separate units, one in the ClusteredMesh of each chunk, even where a build of the whole mesh would pair them
+as a quad. Quads are formed within each chunk as usual.
+*/
+class ClusteredMeshStreamingBuilder
+{
+public:
+
+    typedef meshbuilder::detail::ClusteredMeshBuilder::Parameters Parameters;
+
+    /**
+    \brief The input of a chunk, in buffers provided by the builder and filled by the ChunkReader.
+    */
+    struct Chunk
+    {
+        /// Number of triangles in the chunk.
+        uint32_t numTriangles;
+        /// Number of vertices in the chunk.
+        uint32_t numVertices;
+        /// Three vertex indices, into the vertices of the chunk, for each triangle.
+        uint32_t *triangleVertexIndices;
+        /// Group ID of each triangle.
+        uint32_t *triangleGroupIDs;
+        /// Surface ID of each triangle.
+        uint32_t *triangleSurfaceIDs;
+        /// Position of each vertex.
+        rw::math::fpu::Vector3U_32 *vertices;
+    };
+
+    /**
+    \brief Interface through which the builder reads the input, a chunk at a time.
+    */
+    class ChunkReader
+    {
+    public:
+
+        virtual ~ChunkReader()
+        {
+        }
+
+        /// Returns the number of chunks.
+        virtual uint32_t GetNumChunks() = 0;
+
+        /// Returns the number of triangles and vertices in a chunk.
+        virtual void GetChunkSize(uint32_t chunkIndex, uint32_t &numTriangles, uint32_t &numVertices) = 0;
+
+        /// Fills the buffers of the chunk with the input of a chunk, returning false if it cannot be read.
+        virtual bool ReadChunk(uint32_t chunkIndex, Chunk &chunk) = 0;
+    };
+
+    /**
+    \brief Interface through which the builder writes out the ClusteredMesh of each chunk.
+    */
+    class ChunkWriter
+    {
+    public:
+
+        virtual ~ChunkWriter()
+        {
+        }
+
+        /// Writes the ClusteredMesh of a chunk, returning false if it cannot be written.
+        virtual bool WriteChunkMesh(uint32_t chunkIndex, const ClusteredMesh &clusteredMesh) = 0;
+    };
+
+    ClusteredMeshStreamingBuilder(Parameters         &builderParams,
+                                  uint8_t            *builderBuffer,
+                                  uint32_t           builderBufferSize,
+                                  EA::Allocator::ICoreAllocator *clusteredMeshAllocator);
+
+    ~ClusteredMeshStreamingBuilder();
+
+    bool BuildClusteredMeshes(ChunkReader &reader, ChunkWriter &writer);
+
+    uint32_t GetPeakMemoryUsed() const;
+
+    uint32_t GetNumBoundaryEdges() const;
+
+    uint32_t GetNumBorderTriangles() const;
+
+private:
+
+    struct BoundaryEdge;
+    struct EdgeRef;
+    struct BorderTriangleRef;
+
+    bool AllocateChunkBuffers(ChunkReader &reader);
+
+    bool CollectBoundaryEdges(ChunkReader &reader);
+
+    bool MatchBoundaryEdges();
+
+    bool BuildChunk(ChunkReader &reader, ChunkWriter &writer, const uint32_t chunkIndex);
+
+    /// The ParamBlock used to control the build of each chunk.
+    Parameters                 m_buildParams;
+    /// The Allocator of all build workspace, within the memory budget.
+    meshbuilder::detail::LinearAllocator m_allocator;
+    /// The Allocator used to deal with the ClusteredMesh of each chunk.
+    meshbuilder::detail::GeneralAllocator m_clusteredMeshAllocator;
+
+    /// Number of chunks.
+    uint32_t                   m_numChunks;
+    /// Chunk input buffers, sized for the largest chunk.
+    Chunk                      m_chunk;
+    /// Boundary edges of each chunk.
+    BoundaryEdge             **m_chunkBoundaryEdges;
+    /// Number of boundary edges of each chunk.
+    uint32_t                  *m_chunkNumBoundaryEdges;
+    /// Border triangle references, sorted by the chunk they border.
+    BorderTriangleRef         *m_borderTriangles;
+    /// Index of the first border triangle reference of each chunk, then the number of references.
+    uint32_t                  *m_chunkFirstBorderTriangles;
+    /// Total number of boundary edges.
+    uint32_t                   m_numBoundaryEdges;
+    /// Total number of border triangles, over all chunks.
+    uint32_t                   m_numBorderTriangles;
+
+    /// Private copy constructor.
+    ClusteredMeshStreamingBuilder(const ClusteredMeshStreamingBuilder & other);
+    /// Private assignment constructor.
+    ClusteredMeshStreamingBuilder & operator = (const ClusteredMeshStreamingBuilder & other);
+};
+
+} // namespace collision
+} // namespace rw
+
+#endif // !defined EA_PLATFORM_PS3_SPU
+
+#endif // PUBLIC_RW_COLLISION_CLUSTEREDMESHSTREAMINGBUILDER_H
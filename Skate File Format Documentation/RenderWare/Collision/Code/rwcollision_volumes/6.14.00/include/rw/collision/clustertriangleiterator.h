@@ -122,6 +122,13 @@ public:
             EA_ASSERT(AtEnd() || (mNumTrisLeft > 0));
         }
     }
+    /// Make the current triangle the last in its unit, so that the next call to Next() moves onto the next unit
+    /// without visiting the remaining triangles of this one.
+    RW_COLLISION_FORCE_INLINE void SkipRemainingTrianglesInUnit()
+    {
+        EA_ASSERT(!AtEnd());
+        mNumTrisLeft = 1u;
+    }
     /// For debugging purposes, expose method to check that the iterator is in a state in which it can return a triangle.
     RW_COLLISION_FORCE_INLINE bool IsValid() const
     {
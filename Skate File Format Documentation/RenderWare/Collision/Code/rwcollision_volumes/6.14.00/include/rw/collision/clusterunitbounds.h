@@ -0,0 +1,411 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_CLUSTERUNITBOUNDS_H
+#define PUBLIC_RW_COLLISION_CLUSTERUNITBOUNDS_H
+
+/*************************************************************************************************************
+
+ File: clusterunitbounds.h
+
+ Purpose: Quantized bounding boxes of the units in each cluster of a ClusteredMesh.
+ */
+
+#include "rw/collision/common.h"
+#include "rw/collision/aabbox.h"
+
+// The line and bbox queries of a ClusteredMesh use its unit bounds, when it has them, unless
+// RW_COLLISION_DISABLE_CLUSTER_UNIT_BOUNDS is defined. The ClusterUnitBounds class and its serialization are
+// always available, so that data is the same whichever way the library is built.
+#if defined(RW_COLLISION_ENABLE_CLUSTER_UNIT_BOUNDS) && defined(RW_COLLISION_DISABLE_CLUSTER_UNIT_BOUNDS)
+#error The RW_COLLISION_ENABLE_CLUSTER_UNIT_BOUNDS and RW_COLLISION_DISABLE_CLUSTER_UNIT_BOUNDS macros are mutually exclusive.
+#endif
+
+#if defined(RW_COLLISION_DISABLE_CLUSTER_UNIT_BOUNDS)
+#define RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS 0
+#else
+#define RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS 1
+#endif
+
+namespace rw
+{
+namespace collision
+{
+    // Forward declare ClusterUnitBounds in the rw::collision namespace so
+    // that we can use it in the EA_SERIALIZATION_CLASS_* macros
+    class ClusterUnitBounds;
+
+    class ClusteredMesh;
+
+} // namespace collision
+} // namespace rw
+
+// We need to specify the class serialization version prior to the class definition due to a problem with ps2 gcc.
+// This version MUST be updated if the Serialize function is modified.
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::ClusterUnitBounds, 1)
+// These macro provide the type name used in text-based archives' serialization.
+EA_SERIALIZATION_CLASS_NAME(rw::collision::ClusterUnitBounds, "rw::collision::ClusterUnitBounds")
+
+namespace rw
+{
+namespace collision
+{
+
+/**
+\brief Quantized bounding boxes of the units in each cluster of a ClusteredMesh.
+
+A KDTree leaf of a ClusteredMesh refers to a run of units in a cluster, and the queries decode the vertices of
+every triangle in the run even when the query only touches one corner of the leaf. The unit bounds allow the
+queries to find the units which cannot be hit before decoding any vertices.
+
+The bounds of each unit are stored as 8 or 16 bit integers on a grid spanning the bounds of its cluster. The
+minimum and maximum on each axis are held in six separate arrays, so that the units of a leaf are tested
+with a few compares per unit on contiguous memory. Each bound is rounded outwards and padded by one grid step,
+so the test never rejects a unit which overlaps the query.
+
+A ClusteredMesh holds its unit bounds between the cluster offset table and the cluster data when it is
+created with a unitBoundsFormat other than FORMAT_NONE. The bounds are filled in by
+ClusteredMesh::CreateClusterUnitBounds once the clusters are complete. Bounds can also be created for a
+mesh which was built without them, and attached with ClusteredMesh::SetClusterUnitBounds.
+
+The memory used is 32 bytes per cluster and, per unit, 2 bytes for the unit offset and 6 bytes (8 bit) or
+12 bytes (16 bit) for the bounds.
+
+\importlib rwccore
+*/
+class ClusterUnitBounds
+{
+public:
+
+    /// The precision of the stored bounds.
+    enum Format
+    {
+        FORMAT_NONE = 0,    ///< No unit bounds
+        FORMAT_8BIT = 1,    ///< Bounds are stored in 8 bits on each axis, relative to the cluster bounds
+        FORMAT_16BIT = 2,   ///< Bounds are stored in 16 bits on each axis, relative to the cluster bounds
+
+        FORMAT_FORCEENUMSIZEINT = EAPHYSICS_FORCEENUMSIZEINT
+    };
+
+    /// The number of units tested together by GetBBoxOverlapMask and GetLineOverlapMask.
+    static const uint32_t MAX_MASK_UNITS = 32u;
+
+    /// The grid of one cluster and the position of its units in the unit arrays.
+    struct ClusterEntry
+    {
+        float m_origin[3];      ///< The minimum corner of the cluster bounds
+        float m_cellSize[3];    ///< The size of one grid step on each axis
+        uint32_t m_firstUnit;   ///< The index of the first unit of the cluster in the unit arrays
+        uint32_t m_numUnits;    ///< The number of units in the cluster
+
+        template <class Archive>
+        void Serialize(Archive &ar, uint32_t version);
+    };
+
+    /// Short, fixed-size structure used to define memory requirements for a ClusterUnitBounds.
+    struct ObjectDescriptor
+    {
+        ObjectDescriptor(uint32_t maxClusters = 0, uint32_t maxUnits = 0, uint32_t format = FORMAT_NONE)
+            : m_maxClusters(maxClusters), m_maxUnits(maxUnits), m_format(format)
+        {
+        }
+
+        template <class Archive>
+        void Serialize(Archive &ar, uint32_t version);
+
+        uint32_t m_maxClusters;     ///< The maximum number of clusters
+        uint32_t m_maxUnits;        ///< The maximum number of units in all clusters
+        uint32_t m_format;          ///< The precision of the bounds, see Format
+    };
+
+    static EA::Physics::SizeAndAlignment GetResourceDescriptor(const ObjectDescriptor &objDesc);
+
+    static ClusterUnitBounds * Initialize(const EA::Physics::MemoryPtr &resource, const ObjectDescriptor &objDesc);
+
+    /// Release object when finished with
+    void Release() { }
+
+    ObjectDescriptor GetObjectDescriptor() const;
+
+    void Build(const ClusteredMesh &mesh);
+
+    void UpdateCluster(const ClusteredMesh &mesh, uint32_t clusterIndex);
+
+    uint32_t GetFormat() const;
+
+    uint32_t GetNumClusters() const;
+
+    uint32_t GetNumUnits() const;
+
+    const ClusterEntry & GetClusterEntry(uint32_t clusterIndex) const;
+
+    uint32_t FindUnit(uint32_t clusterIndex, uint32_t unitOffset) const;
+
+    uint32_t GetBBoxOverlapMask(uint32_t clusterIndex,
+                                uint32_t unitIndex,
+                                uint32_t numUnits,
+                                const AABBox &bbox) const;
+
+    uint32_t GetLineOverlapMask(uint32_t clusterIndex,
+                                uint32_t unitIndex,
+                                uint32_t numUnits,
+                                rwpmath::Vector3::InParam lineStart,
+                                rwpmath::Vector3::InParam lineDelta,
+                                float lineEnd,
+                                float fatness) const;
+
+    RwpBool IsValid() const;
+
+    template <class Archive>
+    void Serialize(Archive &ar, uint32_t version);
+
+private:
+
+    ClusterUnitBounds(const ObjectDescriptor &objDesc, ClusterEntry *clusters, uint16_t *unitOffsets, uint8_t *bounds);
+
+    uint32_t GetComponentSize() const;
+
+    void BuildCluster(const ClusteredMesh &mesh, uint32_t clusterIndex, uint32_t firstUnit);
+
+    uint32_t m_format;              ///< The precision of the bounds, see Format
+    uint32_t m_maxClusters;         ///< The number of entries allocated in m_clusters
+    uint32_t m_maxUnits;            ///< The number of units allocated in each of the unit arrays
+    uint32_t m_numClusters;         ///< The number of clusters with bounds
+    uint32_t m_numUnits;            ///< The number of units with bounds
+    ClusterEntry * m_clusters;      ///< The grid of each cluster
+    uint16_t * m_unitOffsets;       ///< The byte offset of each unit in its cluster unit data, ascending in each cluster
+    uint8_t * m_bounds;             ///< The minimum x, y, z then maximum x, y, z of each unit, each array m_maxUnits long
+};
+
+
+// ***********************************************************************************************************
+// Inline Methods
+
+template <class Archive>
+inline void
+ClusterUnitBounds::ClusterEntry::Serialize(Archive &ar, uint32_t /*version*/)
+{
+    float *origin = m_origin;
+    ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(origin, 3u);
+    float *cellSize = m_cellSize;
+    ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(cellSize, 3u);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_firstUnit);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_numUnits);
+}
+
+
+template <class Archive>
+inline void
+ClusterUnitBounds::ObjectDescriptor::Serialize(Archive &ar, uint32_t /*version*/)
+{
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_maxClusters);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_maxUnits);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_format);
+}
+
+
+/**
+\brief Gets the size of one stored bound in bytes.
+\return 1 for FORMAT_8BIT, 2 for FORMAT_16BIT.
+*/
+inline uint32_t
+ClusterUnitBounds::GetComponentSize() const
+{
+    return (m_format == FORMAT_16BIT) ? 2u : 1u;
+}
+
+
+/**
+\brief Gets the resource requirements of a ClusterUnitBounds.
+\param objDesc The maximum number of clusters and units, and the precision of the bounds.
+\return The size and alignment of the memory needed.
+*/
+inline EA::Physics::SizeAndAlignment
+ClusterUnitBounds::GetResourceDescriptor(const ObjectDescriptor &objDesc)
+{
+    EA_ASSERT(objDesc.m_format == FORMAT_8BIT || objDesc.m_format == FORMAT_16BIT);
+    const uint32_t componentSize = (objDesc.m_format == FORMAT_16BIT) ? 2u : 1u;
+
+    uint32_t size = EA::Physics::SizeAlign<uint32_t>(sizeof(ClusterUnitBounds), 16u);
+    size += EA::Physics::SizeAlign<uint32_t>(objDesc.m_maxClusters * sizeof(ClusterEntry), 16u);
+    size += EA::Physics::SizeAlign<uint32_t>(objDesc.m_maxUnits * sizeof(uint16_t), 16u);
+    size += EA::Physics::SizeAlign<uint32_t>(6u * objDesc.m_maxUnits * componentSize, 16u);
+
+    return EA::Physics::SizeAndAlignment(size, 16u);
+}
+
+
+/**
+\brief Creates an empty ClusterUnitBounds in the given memory. Use Build to fill it in.
+\param resource Memory matching GetResourceDescriptor(objDesc).
+\param objDesc The maximum number of clusters and units, and the precision of the bounds.
+\return The new ClusterUnitBounds.
+*/
+inline ClusterUnitBounds *
+ClusterUnitBounds::Initialize(const EA::Physics::MemoryPtr &resource, const ObjectDescriptor &objDesc)
+{
+    rwcASSERTALIGN(resource.GetMemory(), 16u);
+    EA_ASSERT(objDesc.m_format == FORMAT_8BIT || objDesc.m_format == FORMAT_16BIT);
+    const uint32_t componentSize = (objDesc.m_format == FORMAT_16BIT) ? 2u : 1u;
+
+    uintptr_t addr = reinterpret_cast<uintptr_t>(resource.GetMemory());
+    addr += EA::Physics::SizeAlign<uint32_t>(sizeof(ClusterUnitBounds), 16u);
+
+    ClusterEntry *clusters = reinterpret_cast<ClusterEntry *>(addr);
+    addr += EA::Physics::SizeAlign<uint32_t>(objDesc.m_maxClusters * sizeof(ClusterEntry), 16u);
+
+    uint16_t *unitOffsets = reinterpret_cast<uint16_t *>(addr);
+    addr += EA::Physics::SizeAlign<uint32_t>(objDesc.m_maxUnits * sizeof(uint16_t), 16u);
+
+    uint8_t *bounds = reinterpret_cast<uint8_t *>(addr);
+    EA_ASSERT(addr + 6u * objDesc.m_maxUnits * componentSize <=
+        reinterpret_cast<uintptr_t>(resource.GetMemory()) + GetResourceDescriptor(objDesc).GetSize());
+
+    return new (resource.GetMemory()) ClusterUnitBounds(objDesc, clusters, unitOffsets, bounds);
+}
+
+
+inline
+ClusterUnitBounds::ClusterUnitBounds(const ObjectDescriptor &objDesc,
+                                     ClusterEntry *clusters,
+                                     uint16_t *unitOffsets,
+                                     uint8_t *bounds)
+: m_format(objDesc.m_format),
+  m_maxClusters(objDesc.m_maxClusters),
+  m_maxUnits(objDesc.m_maxUnits),
+  m_numClusters(0),
+  m_numUnits(0),
+  m_clusters(clusters),
+  m_unitOffsets(unitOffsets),
+  m_bounds(bounds)
+{
+}
+
+
+/**
+\brief Gets the object descriptor needed to allocate a copy of this object.
+\return The object descriptor.
+*/
+inline ClusterUnitBounds::ObjectDescriptor
+ClusterUnitBounds::GetObjectDescriptor() const
+{
+    return ObjectDescriptor(m_maxClusters, m_maxUnits, m_format);
+}
+
+
+/**
+\brief Gets the precision of the bounds.
+\return FORMAT_8BIT or FORMAT_16BIT.
+*/
+inline uint32_t
+ClusterUnitBounds::GetFormat() const
+{
+    return m_format;
+}
+
+
+/**
+\brief Gets the number of clusters with bounds, which is zero until Build is called.
+\return The number of clusters.
+*/
+inline uint32_t
+ClusterUnitBounds::GetNumClusters() const
+{
+    return m_numClusters;
+}
+
+
+/**
+\brief Gets the number of units with bounds, which is zero until Build is called.
+\return The number of units.
+*/
+inline uint32_t
+ClusterUnitBounds::GetNumUnits() const
+{
+    return m_numUnits;
+}
+
+
+/**
+\brief Gets the grid of a cluster.
+\param clusterIndex The index of the cluster in the mesh.
+\return The grid of the cluster.
+*/
+inline const ClusterUnitBounds::ClusterEntry &
+ClusterUnitBounds::GetClusterEntry(uint32_t clusterIndex) const
+{
+    EA_ASSERT(clusterIndex < m_numClusters);
+    return m_clusters[clusterIndex];
+}
+
+
+/**
+\brief Finds the index of a unit in its cluster from its byte offset, as stored in the KDTree leaves.
+\param clusterIndex The index of the cluster in the mesh.
+\param unitOffset The byte offset of the unit in the cluster unit data.
+\return The index of the unit in the cluster, or the number of units in the cluster if there is no unit
+at the offset.
+*/
+inline uint32_t
+ClusterUnitBounds::FindUnit(uint32_t clusterIndex, uint32_t unitOffset) const
+{
+    const ClusterEntry &entry = GetClusterEntry(clusterIndex);
+    const uint16_t *offsets = m_unitOffsets + entry.m_firstUnit;
+
+    uint32_t lo = 0;
+    uint32_t hi = entry.m_numUnits;
+    while (lo < hi)
+    {
+        const uint32_t mid = (lo + hi) >> 1;
+        if (offsets[mid] < unitOffset)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return (lo < entry.m_numUnits && offsets[lo] == unitOffset) ? lo : entry.m_numUnits;
+}
+
+
+// NOTE: This class only holds integers and floats, so its layout is the same with fpu rwmath and it is used
+// unchanged by the FPU version of the ClusteredMesh in ".\include\cmn\rw\collision\detail\fpu\"
+template <class Archive>
+inline void
+ClusterUnitBounds::Serialize(Archive &ar, uint32_t /*version*/)
+{
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_format);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_maxClusters);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_maxUnits);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_numClusters);
+    ar & EA_SERIALIZATION_NAMED_VALUE(m_numUnits);
+
+    ar.TrackInternalPointer(m_clusters);
+    ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_clusters, m_numClusters);
+
+    ar.TrackInternalPointer(m_unitOffsets);
+    ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_unitOffsets, m_numUnits);
+
+    // Each of the six arrays of bounds is m_maxUnits long, but only the first m_numUnits are in use
+    ar.TrackInternalPointer(m_bounds);
+    for (uint32_t component = 0; component < 6u; ++component)
+    {
+        if (m_format == FORMAT_16BIT)
+        {
+            uint16_t *bounds = reinterpret_cast<uint16_t *>(m_bounds) + component * m_maxUnits;
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(bounds, m_numUnits);
+        }
+        else
+        {
+            uint8_t *bounds = m_bounds + component * m_maxUnits;
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(bounds, m_numUnits);
+        }
+    }
+}
+
+
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_CLUSTERUNITBOUNDS_H
@@ -0,0 +1,666 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_COMPACTKDTREE_H
+#define PUBLIC_RW_COLLISION_COMPACTKDTREE_H
+
+/*************************************************************************************************************
+
+ File: compactkdtree.h
+
+ Purpose: Read only KDTree spatial map with 16 byte quantized branch nodes, and its queries.
+ */
+
+#include "rw/collision/common.h"
+#include "rw/collision/kdtreebase.h"
+
+namespace rw
+{
+    namespace collision
+    {
+        // Forward declare CompactKDTree in the rw::collision namespace so
+        // that we can use it in the EA_SERIALIZATION_CLASS_* macros
+        class CompactKDTree;
+
+    } // namespace collision
+} // namespace rw
+
+// We need to specify the class serialization version prior to the class definition
+// due to a problem with ps2 gcc.
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::CompactKDTree, 1)
+// These macro provide the type name used in text-based archives' serialization.
+EA_SERIALIZATION_CLASS_NAME(rw::collision::CompactKDTree, "rw::collision::CompactKDTree")
+
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\internal
+This is the special value of a child content field in a compact branch node for a child that is a branch.
+Leaf nodes of a compacted KDTree must reference fewer entries than this.
+*/
+#define rwcCOMPACTKDTREE_BRANCH_NODE    0x7fff
+
+
+/**
+\internal
+Number of steps across the bounding box of the tree used for the quantized extents of a compact branch node.
+*/
+#define rwcCOMPACTKDTREE_EXTENT_STEPS   0xffff
+
+
+// ***********************************************************************************************************
+//                                       rw::collision::CompactKDTree CLASS
+// ***********************************************************************************************************
+
+/**
+\brief
+A read only copy of a KDTree whose branch nodes are half the size.
+
+A CompactKDTree is made from any KDTreeBase with full branch nodes, including the trees of
+KDTreeMappedArray, TriangleKDTreeProcedural and ClusteredMesh, and returns the same entry indices.
+It is a separate type so that the aggregates, their KDSubTrees and the KDTree queries keep reading the
+full BranchNode array directly.  It has its own queries, CompactKDTreeBBoxQuery and CompactKDTreeLineQuery,
+and its own serialization.
+
+Each branch node packs the split axis and the contents of both children into one word, and quantizes the
+branch planes to rwcCOMPACTKDTREE_EXTENT_STEPS steps across the bounding box of the whole tree rather than
+the parent region, so the traversal does not need to carry per node boxes.  The left plane is rounded up
+and the right plane rounded down, so the decoded child regions always contain the original ones and
+queries can return extra leaves but never miss one.  There are no parent indices.
+
+\see KDTreeBase, CompactKDTreeBBoxQuery, CompactKDTreeLineQuery
+
+\importlib rwccore
+*/
+class CompactKDTree
+{
+public:
+
+    /**
+    \internal
+    The compact branch node is a 16 byte encoding of a KDTreeBase::BranchNode.
+
+    \importlib rwccore
+    */
+    struct BranchNode
+    {
+        uint32_t    m_axisAndContents;  ///< axis in bits 0-1, left child content in bits 2-16, right child content in bits 17-31.
+        uint16_t    m_extents[2];       ///< quantized location of the branch planes.
+        uint32_t    m_childIndices[2];  ///< index of branch node or start index of entries of each child.
+
+        /// Split axis of the branch node.
+        uint32_t GetAxis() const
+        {
+            return m_axisAndContents & 3u;
+        }
+
+        /// Content of a child, rwcKDTREE_BRANCH_NODE for a branch or the number of entries of a leaf.
+        uint32_t GetContent(uint32_t child) const
+        {
+            const uint32_t content = (m_axisAndContents >> (2 + 15 * child)) & rwcCOMPACTKDTREE_BRANCH_NODE;
+            return (content == rwcCOMPACTKDTREE_BRANCH_NODE) ? uint32_t(rwcKDTREE_BRANCH_NODE) : content;
+        }
+
+        // NOTE: If any changes to this object affecting its LL-Serialization, you'll also need to
+        // make identical changes to its FPU version here: ".\include\cmn\rw\collision\detail\fpu\"
+        template <class Archive>
+            void Serialize(Archive &ar, uint32_t /*version*/)
+        {
+            ar & EA_SERIALIZATION_NAMED_VALUE(m_axisAndContents);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_extents, 2);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_childIndices, 2);
+        }
+    };
+
+    BranchNode *      m_branchNodes;    ///< Array of compact branch nodes
+    uint32_t          m_numBranchNodes; ///< Size of node array
+    uint32_t          m_numEntries;     ///< Total number of 'entries' referenced by leaf nodes of tree
+    AABBox            m_bbox;           ///< Outer extent of the kd tree contents
+
+    RwpBool
+        IsValid() const;
+
+    static RwpBool
+        CanCompactBranchNodes(const KDTreeBase & source);
+
+    void
+        CompactBranchNodes(const KDTreeBase & source);
+
+    /**
+    Get the resource requirements of a CompactKDTree
+
+    \param numBranchNodes        Number of branch nodes required.
+    \param numEntries            Total number of entries reference by leaf nodes of the tree.
+    \param bbox                  Outer extent of the kd tree contents.
+
+    \return The EA::Physics::SizeAndAlignment.
+    */
+    static EA::Physics::SizeAndAlignment
+        GetResourceDescriptor(uint32_t numBranchNodes,
+        uint32_t /*numEntries*/,
+        const rw::collision::AABBox &/*bbox*/)
+    {
+        uint32_t size = EA::Physics::SizeAlign<uint32_t>(sizeof(CompactKDTree), rwcKDTREE_ALIGNMENT) + numBranchNodes * sizeof(BranchNode);
+        return EA::Physics::SizeAndAlignment(size, rwcKDTREE_ALIGNMENT);
+    }
+
+    /**
+    \brief
+    Initializes a CompactKDTree at the given memory location.
+
+    The node data is not initialized by this method.  You must call CompactBranchNodes with the source
+    tree to complete the initialization.
+
+    \param resource              Memory resource for CompactKDTree
+    \param numBranchNodes        Number of branch nodes required.
+    \param numEntries            Total number of entries reference by leaf nodes of the tree.
+    \param bbox                  Outer extent of the kd tree contents.
+
+    \see CompactBranchNodes
+    */
+    static CompactKDTree *
+        Initialize(const EA::Physics::MemoryPtr& resource,
+        uint32_t numBranchNodes,
+        uint32_t numEntries,
+        const rw::collision::AABBox &bbox)
+    {
+        rwcASSERTALIGN(resource.GetMemory(), rwcKDTREE_ALIGNMENT);
+        CompactKDTree *kdtree = static_cast<CompactKDTree *>(resource.GetMemory());
+        BranchNode * branchNodes = 0;
+        if (numBranchNodes > 0)
+        {
+            branchNodes = (BranchNode *)EA::Physics::MemAlign(reinterpret_cast<void *>(kdtree + 1), rwcKDTREE_ALIGNMENT);
+        }
+        return new (resource.GetMemory()) CompactKDTree(numBranchNodes, numEntries, bbox, branchNodes);
+    }
+
+    /**
+    Gets the number of branch nodes in the CompactKDTree.
+    \return the number of branch nodes in the tree
+    */
+    uint32_t
+    GetNumBranchNodes() const
+    {
+        return m_numBranchNodes;
+    }
+
+    /**
+    Gets the number of entries indexed by the CompactKDTree.
+    \return the number of entries in the tree
+    */
+    uint32_t
+    GetNumEntries() const
+    {
+        return m_numEntries;
+    }
+
+    /**
+    Gets the outer extent of the CompactKDTree.
+    \return the bounding box of the tree
+    */
+    const AABBox &
+    GetBBox() const
+    {
+        return m_bbox;
+    }
+
+    /**
+    \internal
+    Decodes a quantized extent of a compact branch node.
+    The first and last steps decode exactly to the bounding box of the tree.
+    \param axis Split axis of the branch node.
+    \param step Quantized extent.
+    \return The location of the branch plane.
+    */
+    RW_COLLISION_FORCE_INLINE float
+    DecodeExtent(uint32_t axis, uint32_t step) const
+    {
+        const float minExtent = static_cast<float>(m_bbox.Min().GetComponent(static_cast<uint16_t>(axis)));
+        const float maxExtent = static_cast<float>(m_bbox.Max().GetComponent(static_cast<uint16_t>(axis)));
+        const float value = minExtent + (maxExtent - minExtent) * (static_cast<float>(step) * (1.0f / float(rwcCOMPACTKDTREE_EXTENT_STEPS)));
+        return (step == rwcCOMPACTKDTREE_EXTENT_STEPS) ? maxExtent : value;
+    }
+
+    /**
+    \internal
+    Decodes a compact branch node into the full encoding.  The parent index is set to
+    rwcKDTREE_INVALID_INDEX since it is not stored.
+    \param index Index of the node in the branch node array.
+    \param decoded Receives the decoded branch node.
+    */
+    void
+    DecodeBranchNode(uint32_t index, KDTreeBase::BranchNode & decoded) const
+    {
+        EA_ASSERT(index < m_numBranchNodes);
+        const BranchNode & node = m_branchNodes[index];
+        const uint32_t axis = node.GetAxis();
+        decoded.m_parent = rwcKDTREE_INVALID_INDEX;
+        decoded.m_axis = axis;
+        for (uint32_t child = 0; child < 2; ++child)
+        {
+            decoded.m_childRefs[child].m_content = node.GetContent(child);
+            decoded.m_childRefs[child].m_index = node.m_childIndices[child];
+            decoded.m_extents[child] = DecodeExtent(axis, node.m_extents[child]);
+        }
+    }
+
+    // NOTE: If any changes to this object affecting its LL-Serialization, you'll also need to
+    // make identical changes to its FPU version here: ".\include\cmn\rw\collision\detail\fpu\"
+    template <class Archive>
+    void Serialize(Archive &ar, uint32_t /*version*/)
+    {
+        ar.TrackInternalPointer(m_branchNodes);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numBranchNodes);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numEntries);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_bbox);
+        ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_branchNodes, m_numBranchNodes);
+    }
+
+private:
+
+    // Private constructor - use Initialize() instead
+    CompactKDTree(uint32_t numBranchNodes,
+        uint32_t numEntries,
+        const rw::collision::AABBox &bbox,
+        BranchNode * branchNodes)
+        : m_branchNodes(branchNodes)
+        , m_numBranchNodes(numBranchNodes)
+        , m_numEntries(numEntries)
+        , m_bbox(bbox)
+    {
+    }
+};
+
+
+// ***********************************************************************************************************
+//                                   rw::collision::CompactKDTreeBBoxQuery CLASS
+// ***********************************************************************************************************
+
+/**
+\brief
+A bounding box query on a CompactKDTree, which is used in the same way as a KDTreeBBoxQuery.
+
+The results include every entry that a KDTreeBBoxQuery on the source tree returns, and possibly some
+more from leaves whose quantized regions just reach the box.
+
+\importlib rwccore
+*/
+class CompactKDTreeBBoxQuery
+{
+public:
+
+    CompactKDTreeBBoxQuery(const CompactKDTree *kdtree, const AABBox &bbox);
+
+    RwpBool GetNext(uint32_t &entry);
+    RwpBool GetNext(uint32_t &entry, uint32_t &count);
+
+private:
+
+    void ProcessBranchNode();
+
+    const CompactKDTree *m_kdtree;                      ///< CompactKDTree we're querying
+    float           m_min[3];                           ///< Minimum of the query box, in steps across the tree bbox
+    float           m_max[3];                           ///< Maximum of the query box, in steps across the tree bbox
+    uint32_t        m_stack[rwcKDTREE_STACK_SIZE];      ///< Stack for recursive tree traversal
+    uint32_t        m_top;                              ///< The index of the top of the stack
+
+    // Contiguous block of results from leaf node
+    uint32_t        m_resultCount;                      ///< The number of results
+    uint32_t        m_nextEntry;                        ///< The next result
+};
+
+
+/**
+\brief Construct a CompactKDTree bounding box query.
+
+The query box is converted once into steps across the bounding box of the tree, so that the branch
+nodes are tested without decoding their extents.  The box is widened by half a step to cover the float
+rounding of the conversion.
+\param kdtree Spatial map to be queried
+\param bbox The query bounding box
+*/
+inline
+CompactKDTreeBBoxQuery::CompactKDTreeBBoxQuery(const CompactKDTree *kdtree, const AABBox &bbox)
+    : m_kdtree(kdtree),
+      m_resultCount(0),
+      m_nextEntry(0)
+{
+    for (uint16_t axis = 0; axis < 3; ++axis)
+    {
+        const float minExtent = static_cast<float>(kdtree->m_bbox.Min().GetComponent(axis));
+        const float range = static_cast<float>(kdtree->m_bbox.Max().GetComponent(axis)) - minExtent;
+        const float scale = (range > 0.0f) ? float(rwcCOMPACTKDTREE_EXTENT_STEPS) / range : 0.0f;
+        m_min[axis] = (static_cast<float>(bbox.Min().GetComponent(axis)) - minExtent) * scale - 0.5f;
+        m_max[axis] = (static_cast<float>(bbox.Max().GetComponent(axis)) - minExtent) * scale + 0.5f;
+        if (range <= 0.0f)
+        {
+            // A flat tree touches the box if the box reaches its plane
+            m_min[axis] = (static_cast<float>(bbox.Min().GetComponent(axis)) <= minExtent) ? 0.0f : float(rwcCOMPACTKDTREE_EXTENT_STEPS) + 1.0f;
+            m_max[axis] = (static_cast<float>(bbox.Max().GetComponent(axis)) >= minExtent) ? float(rwcCOMPACTKDTREE_EXTENT_STEPS) : -1.0f;
+        }
+    }
+
+    if (kdtree->m_numBranchNodes > 0)
+    {
+        m_stack[0] = 0; // Start at root
+        m_top = 1;
+    }
+    else
+    {
+        // Treat as single leaf
+        m_resultCount = kdtree->m_numEntries;
+        m_top = 0;
+    }
+}
+
+
+/**
+\internal
+Process node at top of stack. Branch nodes are pushed onto the stack, and leaf nodes are added to the
+results set, joining the left and right leaves of the same branch as one slice of the entry array.
+
+The quantized extents are compared with the query box in steps, so no extents are decoded.
+*/
+RW_COLLISION_FORCE_INLINE void
+CompactKDTreeBBoxQuery::ProcessBranchNode()
+{
+    EA_ASSERT(m_top > 0);
+
+    uint32_t top = m_top;
+    const CompactKDTree::BranchNode & node = m_kdtree->m_branchNodes[m_stack[--top]];
+    uint32_t resultCount = 0;
+    uint32_t nextEntry = m_nextEntry;
+    const uint32_t axis = node.GetAxis();
+
+    // Right child
+    if (m_max[axis] >= static_cast<float>(node.m_extents[1]))
+    {
+        const uint32_t content = node.GetContent(1);
+        if (rwcKDTREE_BRANCH_NODE == content)
+        {
+            EA_ASSERT(top < rwcKDTREE_STACK_SIZE);
+            m_stack[top++] = node.m_childIndices[1];
+        }
+        else
+        {
+            resultCount += content;
+            nextEntry = node.m_childIndices[1];
+        }
+    }
+
+    // Left child
+    if (m_min[axis] <= static_cast<float>(node.m_extents[0]))
+    {
+        const uint32_t content = node.GetContent(0);
+        if (rwcKDTREE_BRANCH_NODE == content)
+        {
+            EA_ASSERT(top < rwcKDTREE_STACK_SIZE);
+            m_stack[top++] = node.m_childIndices[0];
+        }
+        else
+        {
+            resultCount += content;
+            nextEntry = node.m_childIndices[0]; // Right leaf entries follow on
+        }
+    }
+
+    m_top = top;
+    m_resultCount = resultCount;
+    m_nextEntry = nextEntry;
+}
+
+
+/**
+\brief Find next entry from the leaf nodes that are intersected by the query box.
+\param  entry  Reference to variable that will receive the next entry index.
+\return FALSE if there are no more results
+\see KDTreeBBoxQuery::GetNext
+*/
+RW_COLLISION_FORCE_INLINE RwpBool
+CompactKDTreeBBoxQuery::GetNext(uint32_t &entry)
+{
+    while (m_resultCount == 0)
+    {
+        if (m_top == 0)
+        {
+            return FALSE; // No more nodes to process - end of query
+        }
+        ProcessBranchNode();
+    }
+
+    entry = m_nextEntry++;
+    m_resultCount--;
+
+    return TRUE;
+}
+
+
+/**
+\brief Gets the next set of entries from the same leaf nodes that are intersected by the query box.
+\param entry output variable that will receive the index of the first entry.
+\param count output number of entries found
+\return FALSE if there are no more results
+\see KDTreeBBoxQuery::GetNext
+*/
+RW_COLLISION_FORCE_INLINE RwpBool
+CompactKDTreeBBoxQuery::GetNext(uint32_t &entry, uint32_t &count)
+{
+    if (!GetNext(entry))
+    {
+        return FALSE; // No more nodes to process - end of query
+    }
+    count = m_resultCount + 1;
+    m_resultCount = 0;
+
+    return TRUE;
+}
+
+
+// ***********************************************************************************************************
+//                                   rw::collision::CompactKDTreeLineQuery CLASS
+// ***********************************************************************************************************
+
+/**
+\brief
+A line query on a CompactKDTree, which is used in the same way as a KDTreeLineQuery.
+
+Leaves are visited nearest first.  The results include every entry that a KDTreeLineQuery on the source
+tree returns, and possibly some more from leaves whose quantized regions just reach the line.
+
+\importlib rwccore
+*/
+class CompactKDTreeLineQuery
+{
+public:
+
+    CompactKDTreeLineQuery(const CompactKDTree *kdtree,
+                           rwpmath::Vector3::InParam start,
+                           rwpmath::Vector3::InParam end,
+                           const float fatness = 0.0f);
+
+    RwpBool GetNext(uint32_t &entry);
+    RwpBool GetNext(uint32_t &entry, uint32_t &count);
+
+private:
+
+    void ProcessBranchNode();
+
+    /**
+    \internal
+    \brief Used to cache tree nodes and relevant line segment parameters for later processing.
+    */
+    struct StackElement
+    {
+        KDTreeBase::NodeRef     m_nodeRef;
+        float   m_pa;
+        float   m_pb;
+    };
+
+    const CompactKDTree *m_kdtree;                      ///< Spatial map to be queried
+    AALineClipper       m_lineClipper;                  ///< Parametric line
+
+    StackElement        m_stack[rwcKDTREE_STACK_SIZE];  ///< Stack for hierarchy traversal
+    uint32_t            m_top;                          ///< next free stack index
+
+    uint32_t            m_leafCount;                    ///< number of entries in the next batch
+    uint32_t            m_nextEntry;                    ///< index of the first entry in the next batch
+};
+
+
+/**
+\brief Constructor for a line query.
+
+\param kdtree   The CompactKDTree to query against.
+\param start    Start point of the line.
+\param end      End point of the line.
+\param fatness  Padding of the line on all axes.
+*/
+inline
+CompactKDTreeLineQuery::CompactKDTreeLineQuery(const CompactKDTree *kdtree,
+                                               rwpmath::Vector3::InParam start,
+                                               rwpmath::Vector3::InParam end,
+                                               const float fatness /* = 0.0f */)
+    : m_kdtree(kdtree),
+      m_lineClipper(start, end, rwpmath::Vector3(fatness, fatness, fatness), kdtree->m_bbox),
+      m_leafCount(0),
+      m_nextEntry(0)
+{
+    m_stack[0].m_pa = 0.0f;
+    m_stack[0].m_pb = 1.0f;
+    if (!m_lineClipper.ClipToAABBox(m_stack[0].m_pa, m_stack[0].m_pb, kdtree->m_bbox))
+    {
+        // Line does not overlap extent of KDTree.
+        m_top = 0;
+    }
+    else if (kdtree->m_numBranchNodes > 0)
+    {
+        // Start at root
+        m_stack[0].m_nodeRef.m_content = rwcKDTREE_BRANCH_NODE;
+        m_stack[0].m_nodeRef.m_index = 0;
+        m_top = 1;
+    }
+    else
+    {
+        // Consider tree as single leaf
+        m_leafCount = kdtree->m_numEntries;
+        m_top = 0;
+    }
+}
+
+
+/**
+\internal
+Pops the branch node at the top of the stack and pushes the children intersected by the line, the far
+child first so that the near child is processed next.
+*/
+RW_COLLISION_FORCE_INLINE void
+CompactKDTreeLineQuery::ProcessBranchNode()
+{
+    uint32_t top = m_top - 1;
+    const StackElement & cur = m_stack[top];
+    const float pa = cur.m_pa;
+    const float pb = cur.m_pb;
+    EA_ASSERT(cur.m_nodeRef.m_content == rwcKDTREE_BRANCH_NODE);
+    const CompactKDTree::BranchNode &node = m_kdtree->m_branchNodes[cur.m_nodeRef.m_index];
+
+    const uint32_t axis = node.GetAxis();
+
+    // Clip to child regions
+    const float origin = m_lineClipper.m_origin.GetComponent(static_cast<int32_t>(axis));
+    const float pad    = m_lineClipper.m_padding.GetComponent(static_cast<int32_t>(axis));
+    const float recip  = m_lineClipper.m_recip.GetComponent(static_cast<int32_t>(axis));
+    const float p0 = (m_kdtree->DecodeExtent(axis, node.m_extents[0]) + pad - origin) * recip;
+    const float p1 = (m_kdtree->DecodeExtent(axis, node.m_extents[1]) - pad - origin) * recip;
+
+    const uint32_t farBranch = m_lineClipper.m_farBranch[axis];
+    const float pfar  = (farBranch != 0) ? p1 : p0;
+    const float pnear = (farBranch != 0) ? p0 : p1;
+
+    if (pb > pfar)
+    {
+        EA_ASSERT(top < rwcKDTREE_STACK_SIZE);
+        m_stack[top].m_nodeRef.m_content = node.GetContent(farBranch);
+        m_stack[top].m_nodeRef.m_index = node.m_childIndices[farBranch];
+        m_stack[top].m_pa = rwpmath::Max(pa, pfar);
+        m_stack[top].m_pb = pb;
+        top++;
+    }
+
+    const uint32_t nearBranch = uint32_t(!farBranch);
+    if (pa < pnear)
+    {
+        EA_ASSERT(top < rwcKDTREE_STACK_SIZE);
+        m_stack[top].m_nodeRef.m_content = node.GetContent(nearBranch);
+        m_stack[top].m_nodeRef.m_index = node.m_childIndices[nearBranch];
+        m_stack[top].m_pa = pa;
+        m_stack[top].m_pb = rwpmath::Min(pb, pnear);
+        top++;
+    }
+
+    m_top = top;
+}
+
+
+/**
+\brief Find next entry from the leaf nodes that are intersected by the query line.
+\param  entry  Reference to variable that will receive the next entry index.
+\return FALSE if there are no more results
+\see KDTreeLineQuery::GetNext
+*/
+RW_COLLISION_FORCE_INLINE RwpBool
+CompactKDTreeLineQuery::GetNext(uint32_t &entry)
+{
+    while (m_leafCount == 0)
+    {
+        for ( ;; )
+        {
+            if (m_top == 0)
+            {
+                return FALSE; // No more nodes to process - end of query
+            }
+            if (m_stack[m_top-1].m_nodeRef.m_content != rwcKDTREE_BRANCH_NODE)
+            {
+                break; // Found leaf
+            }
+            ProcessBranchNode();
+        }
+        --m_top;
+        m_leafCount = m_stack[m_top].m_nodeRef.m_content;
+        m_nextEntry = m_stack[m_top].m_nodeRef.m_index;
+    }
+
+    entry = m_nextEntry++;
+    m_leafCount--;
+
+    return TRUE;
+}
+
+
+/**
+\brief Gets the next set of entries from the same leaf node that is intersected by the query line.
+\param  entry  Reference to variable that will receive the index of the first entry.
+\param count output number of entries found
+\return FALSE if there are no more results
+\see KDTreeLineQuery::GetNext
+*/
+RW_COLLISION_FORCE_INLINE RwpBool
+CompactKDTreeLineQuery::GetNext(uint32_t &entry, uint32_t &count)
+{
+    if (!GetNext(entry))
+    {
+        return FALSE; // No more nodes to process - end of query
+    }
+    count = m_leafCount + 1;
+    m_leafCount = 0;
+
+    return TRUE;
+}
+
+
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_COMPACTKDTREE_H
@@ -44,6 +44,41 @@ ComputeContacts(const GPInstance& gp1, const GPInstance& gp2,
                 rwpmath::VecFloatInParam clippingLengthTolerance = COMPUTECONTACTS_DEFAULT_ClippingLengthTolerance);
 
 
+/**
+\brief A pair of gp instances to be passed to ComputeContactsBatch.
+*/
+struct GPInstancePair
+{
+    const GPInstance *a;
+    const GPInstance *b;
+};
+
+/**
+\brief The number of uint32_t entries of workspace ComputeContactsBatch needs for a batch of numPairs pairs.
+*/
+inline uint32_t
+ComputeContactsBatchWorkspaceSize(uint32_t numPairs)
+{
+    return numPairs;
+}
+
+uint32_t
+ComputeContactsBatch(const GPInstancePair *pairs,
+                     uint32_t numPairs,
+                     GPInstance::ContactPoints *results,
+                     uint32_t *resultPairIndices,
+                     uint32_t maxResults,
+                     uint32_t *workspace,
+                     rwpmath::VecFloatInParam minimumSeparatingDistance = COMPUTECONTACTS_DEFAULT_MinimumSeparatingDistance,
+                     rwpmath::VecFloatInParam edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
+                     rwpmath::VecFloatInParam convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                     rwpmath::VecFloatInParam triangleFaceNormalTolerance = COMPUTECONTACTS_DEFAULT_TriangleFaceNormalTolerance,
+                     rwpmath::VecFloatInParam featureSimplificationThreshold = COMPUTECONTACTS_DEFAULT_FeatureSimplificationThreshold,
+                     rwpmath::VecFloatInParam cosSquaredMaximumAngleConsideredParallel = COMPUTECONTACTS_DEFAULT_CosSquaredMaximumAngleConsideredParallel,
+                     rwpmath::VecFloatInParam validDirectionMinimumLengthSquared = COMPUTECONTACTS_DEFAULT_ValidDirectionMinimumLengthSquared,
+                     rwpmath::VecFloatInParam clippingLengthTolerance = COMPUTECONTACTS_DEFAULT_ClippingLengthTolerance);
+
+
 } // namespace collision
 } // namespace rw
 
@@ -14,6 +14,7 @@
 #if !defined(EA_PLATFORM_PS3_SPU)
 
 #include "rw/collision/clusteredmesh.h"
+#include "rw/collision/clusterunitbounds.h"
 #include "aabbox.h"
 #include "procedural.h"
 #include "kdtreewithsubtrees.h"
@@ -38,7 +39,7 @@ namespace fpu
 
 // We need to specify the class serialization version prior to the class definition
 // due to a problem with ps2 gcc.
-EA_SERIALIZATION_CLASS_VERSION(rw::collision::detail::fpu::ClusteredMesh, 5)
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::detail::fpu::ClusteredMesh, rwcCLUSTEREDMESH_SERIALIZATION_VERSION)
 
 
 namespace rw
@@ -124,7 +125,8 @@ public:
                           const AABBox &bbox,
                           float vertexCompressionGranularity = 0.01f,
                           uint32_t classSize = sizeof(ClusteredMesh),
-                          RwpBool includeKDSubTrees = false);
+                          RwpBool includeKDSubTrees = false,
+                          uint32_t unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE);
     static ClusteredMesh*
     Initialize(const EA::Physics::MemoryPtr& resource,
                uint32_t maxClusters,
@@ -134,7 +136,8 @@ public:
                const AABBox &bbox,
                float vertexCompressionGranularity = 0.01f,
                uint32_t classSize = sizeof(ClusteredMesh),
-               RwpBool includeKDSubTrees = false);
+               RwpBool includeKDSubTrees = false,
+               uint32_t unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE);
 
     struct ObjectDescriptor;
     const ObjectDescriptor GetObjectDescriptor();
@@ -162,6 +165,8 @@ public:
     uint8_t mDefaultEdgeAngle;
 
     uint32_t mNumClusterTagBits;
+
+    ClusterUnitBounds * mUnitBounds;
 };
 
 
@@ -186,6 +191,16 @@ ClusteredMesh::GetClusterSize(ClusteredMeshCluster& cluster) const
     {
         bytes += sizeof(rw::collision::ClusteredMeshCluster::Vertex32) * cluster.vertexCount;
     }
+    else if (cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED)
+    {
+        bytes += sizeof(rw::collision::ClusteredMeshCluster::VertexHeader);
+        bytes += sizeof(rw::collision::ClusteredMeshCluster::Vertex8) * cluster.vertexCount;
+    }
+    else if (cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED)
+    {
+        bytes += sizeof(rw::collision::ClusteredMeshCluster::VertexHeader);
+        bytes += sizeof(uint32_t) * cluster.vertexCount;
+    }
     else
     {
         bytes += rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT * cluster.vertexCount;
@@ -203,11 +218,12 @@ inline EA::Physics::SizeAndAlignment
 ClusteredMesh::GetResourceDescriptor(uint32_t maxClusters,
                                      uint32_t clusterDataSize,
                                      uint32_t numBranchNodes,
-                                     uint32_t /*maxUnits*/,
+                                     uint32_t maxUnits,
                                      const AABBox & /*bbox*/,
                                      float /*vertexCompressionGranularity*/,
                                      uint32_t classSize,
-                                     RwpBool includeKDSubTrees)
+                                     RwpBool includeKDSubTrees,
+                                     uint32_t unitBoundsFormat)
 {
     uint32_t numSubTrees = includeKDSubTrees ? maxClusters : 0u;
     KDTreeWithSubTrees::ObjectDescriptor kdtreeParams(numBranchNodes, numSubTrees);
@@ -218,6 +234,12 @@ ClusteredMesh::GetResourceDescriptor(uint32_t maxClusters,
     uint32_t size = EA::Physics::SizeAlign<uint32_t>(classSize, rwcCLUSTEREDMESH_ALIGNMENT);
     size += EA::Physics::SizeAlign<uint32_t>(kdtree.GetSize(), rwcCLUSTEREDMESH_ALIGNMENT);
     size += EA::Physics::SizeAlign<uint32_t>(maxClusters*sizeof(ClusteredMeshCluster*), rwcCLUSTEREDMESH_ALIGNMENT);
+    if (unitBoundsFormat != ClusterUnitBounds::FORMAT_NONE)
+    {
+        ClusterUnitBounds::ObjectDescriptor unitBoundsParams(maxClusters, maxUnits, unitBoundsFormat);
+        size += EA::Physics::SizeAlign<uint32_t>(ClusterUnitBounds::GetResourceDescriptor(unitBoundsParams).GetSize(),
+                                                 rwcCLUSTEREDMESH_ALIGNMENT);
+    }
     size += clusterDataSize;
 
     // TODO : The following code suggests we may be counting the space required for KDSubTrees twice.
@@ -240,7 +262,8 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource,
                           const AABBox &bbox,
                           float vertexCompressionGranularity,
                           uint32_t classSize,
-                          RwpBool includeKDSubTrees)
+                          RwpBool includeKDSubTrees,
+                          uint32_t unitBoundsFormat)
 {
     AllocationHelper heap(resource);
 
@@ -262,6 +285,17 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource,
     // round up the heap pointer to correct alignment
     heap.SubAlloc(0, rwcCLUSTEREDMESH_ALIGNMENT);
 
+    // allocate unit bounds
+    mesh->mUnitBounds = NULL;
+    if (unitBoundsFormat != ClusterUnitBounds::FORMAT_NONE)
+    {
+        ClusterUnitBounds::ObjectDescriptor unitBoundsParams(maxClusters, maxUnits, unitBoundsFormat);
+        EA::Physics::SizeAndAlignment unitBounds = ClusterUnitBounds::GetResourceDescriptor(unitBoundsParams);
+        mesh->mUnitBounds = ClusterUnitBounds::Initialize(
+            EA::Physics::MemoryPtr(heap.SubAlloc(unitBounds.GetSize(), unitBounds.GetAlignment())), unitBoundsParams);
+        heap.SubAlloc(0, rwcCLUSTEREDMESH_ALIGNMENT);
+    }
+
     // reserve space for all clusters
     heap.SubAlloc(clusterDataSize, rwcCLUSTEREDMESH_ALIGNMENT);
 
@@ -269,7 +303,8 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource,
     mesh->mSizeOfThis = ClusteredMesh::GetResourceDescriptor(maxClusters, clusterDataSize, numBranchNodes,
                                                              maxUnits, bbox,
                                                              vertexCompressionGranularity,
-                                                             classSize, includeKDSubTrees).GetSize();
+                                                             classSize, includeKDSubTrees,
+                                                             unitBoundsFormat).GetSize();
 
     // assert that the memory allocated from the heap is not greater than the size allowed.
     EA_ASSERT(mesh->mSizeOfThis >= heap.mem - reinterpret_cast<uintptr_t>(mesh));
@@ -285,7 +320,8 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource,
 // We need to specify the class serialization version prior to the class definition
 // due to a problem with ps2 gcc.
 // Version 2 added m_includeKDSubTrees
-EA_SERIALIZATION_CLASS_VERSION(rw::collision::detail::fpu::ClusteredMesh::ObjectDescriptor, 2)
+// Version 3 added m_unitBoundsFormat
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::detail::fpu::ClusteredMesh::ObjectDescriptor, 3)
 
 namespace rw {
 namespace collision {
@@ -299,7 +335,8 @@ struct ClusteredMesh::ObjectDescriptor
                      uint32_t numBranchNodes,
                      uint32_t maxUnits,
                      const AABBox& bbox,
-                     RwpBool includeKDSubTrees = false)
+                     RwpBool includeKDSubTrees = false,
+                     uint32_t unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE)
     {
         m_maxClusters = maxClusters;
         m_clusterDataSize = clusterDataSize;
@@ -307,6 +344,7 @@ struct ClusteredMesh::ObjectDescriptor
         m_maxUnits = maxUnits;
         m_bbox = bbox;
         m_includeKDSubTrees = includeKDSubTrees;
+        m_unitBoundsFormat = unitBoundsFormat;
     }
 
     ObjectDescriptor()
@@ -317,6 +355,7 @@ struct ClusteredMesh::ObjectDescriptor
         m_maxUnits = 0;
         m_bbox = AABBox();
         m_includeKDSubTrees = false;
+        m_unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE;
     }
 
     template <class Archive>
@@ -335,6 +374,14 @@ struct ClusteredMesh::ObjectDescriptor
         {
             m_includeKDSubTrees = false;
         }
+        if (version > 2)
+        {
+            ar & EA_SERIALIZATION_NAMED_VALUE(m_unitBoundsFormat);
+        }
+        else
+        {
+            m_unitBoundsFormat = ClusterUnitBounds::FORMAT_NONE;
+        }
     }
 
     uint32_t m_maxClusters;
@@ -343,6 +390,7 @@ struct ClusteredMesh::ObjectDescriptor
     uint32_t m_maxUnits;
     AABBox m_bbox;
     RwpBool m_includeKDSubTrees;
+    uint32_t m_unitBoundsFormat;
 };
 
 
@@ -359,7 +407,8 @@ ClusteredMesh::GetObjectDescriptor()
     }
 
     return ObjectDescriptor(mMaxClusters, clusterdatasize,  mKDTree->m_numBranchNodes, mMaxUnits, m_AABB,
-        (RwpBool) (mKDTree->GetNumKDSubTrees() > 0));
+        (RwpBool) (mKDTree->GetNumKDSubTrees() > 0),
+        mUnitBounds ? mUnitBounds->GetFormat() : static_cast<uint32_t>(ClusterUnitBounds::FORMAT_NONE));
 }
 
 
@@ -369,7 +418,8 @@ ClusteredMesh::GetResourceDescriptor(const ClusteredMesh::ObjectDescriptor & obj
     return GetResourceDescriptor(objDesc.m_maxClusters, 
                                  objDesc.m_clusterDataSize, objDesc.m_numBranchNodes,
                                  objDesc.m_maxUnits, objDesc.m_bbox,
-                                 0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees);
+                                 0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees,
+                                 objDesc.m_unitBoundsFormat);
 }
 
 
@@ -379,7 +429,8 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource, const Clustere
     return Initialize(resource, objDesc.m_maxClusters,
                       objDesc.m_clusterDataSize, objDesc.m_numBranchNodes,
                       objDesc.m_maxUnits, objDesc.m_bbox,
-                      0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees);
+                      0.01f, sizeof(ClusteredMesh), objDesc.m_includeKDSubTrees,
+                      objDesc.m_unitBoundsFormat);
 }
 
 
@@ -491,6 +542,26 @@ void ClusteredMesh::Serialize(Archive &ar, uint32_t version)
             int32_t* vertexArray = reinterpret_cast<int32_t*>(cluster.vertexArray);
             ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, cluster.vertexCount * 3u);
         }
+        else if ( cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED ||
+                  cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED )
+        {
+            EA_ASSERT_MSG(version > 6, ("8-bit and 10-bit vertex compression requires version 7."));
+
+            // The header holds the offset and the granularity shift
+            uint32_t* vertexArrayHeader = reinterpret_cast<uint32_t*>(cluster.vertexArray);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArrayHeader, 4u);
+
+            if ( cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED )
+            {
+                uint8_t* vertexArray = reinterpret_cast<uint8_t*>(vertexArrayHeader + 4);
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, cluster.vertexCount * 3u);
+            }
+            else
+            {
+                uint32_t* vertexArray = vertexArrayHeader + 4;
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArray, cluster.vertexCount);
+            }
+        }
         else
         {
             if (version == 1)
@@ -534,6 +605,23 @@ void ClusteredMesh::Serialize(Archive &ar, uint32_t version)
         }
     }
 
+    if (version > 5)
+    {
+        ar.TrackInternalPointer(mUnitBounds);
+        if (mUnitBounds)
+        {
+            ar & EA_SERIALIZATION_NAMED_VALUE(*mUnitBounds);
+        }
+    }
+    else
+    {
+        EA_ASSERT(ar.IsLoading());  // Should only try to load older versions
+        if (ar.IsLoading())
+        {
+            mUnitBounds = NULL;
+        }
+    }
+
     if (ar.IsLoading())
     {
         // Initialize the mSizeOfThis member
@@ -32,7 +32,7 @@ namespace fpu
 
 // We need to specify the class serialization version prior to the class definition
 // due to a problem with ps2 gcc.
-EA_SERIALIZATION_CLASS_VERSION(rw::collision::detail::fpu::ClusteredMeshCluster, 5)
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::detail::fpu::ClusteredMeshCluster, rwcCLUSTEREDMESHCLUSTER_SERIALIZATION_VERSION)
 // These macro provide the type name used in text-based archives' serialization.
 EA_SERIALIZATION_CLASS_NAME(rw::collision::detail::fpu::ClusteredMeshCluster, "rw::collision::ClusteredMeshCluster")
 
@@ -96,6 +96,31 @@ public:
             // Serialize the vertices
             ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArrayPointer, vertexCount * 3u);
         }
+        else if ( compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED ||
+                  compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED )
+        {
+            EA_ASSERT_MSG(version > 5, ("8-bit and 10-bit vertex compression requires version 6."));
+
+            // Access the vertex array as a collection of uint32_t
+            uint32_t* vertexArrayHeader = reinterpret_cast<uint32_t*>(vertexArray);
+            // Serialize the vertex array header, the offset and the granularity shift
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArrayHeader, 4u);
+
+            if ( compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED )
+            {
+                // Access the vertex array as a collection of uint8_t and offset the pointer to the end of the header
+                uint8_t* vertexArrayPointer = reinterpret_cast<uint8_t*>(vertexArrayHeader + 4);
+                // Serialize the vertices
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArrayPointer, vertexCount * 3u);
+            }
+            else
+            {
+                // Access the vertex array as a collection of packed uint32_t and offset the pointer to the end of the header
+                uint32_t* vertexArrayPointer = vertexArrayHeader + 4;
+                // Serialize the vertices
+                ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(vertexArrayPointer, vertexCount);
+            }
+        }
         else
         {
             // If the vertices are uncompressed
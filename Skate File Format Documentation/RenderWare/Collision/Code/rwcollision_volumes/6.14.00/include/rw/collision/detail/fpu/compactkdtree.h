@@ -0,0 +1,127 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_DETAIL_FPU_COMPACTKDTREE_H
+#define PUBLIC_RW_COLLISION_DETAIL_FPU_COMPACTKDTREE_H
+
+#include "rw/collision/common.h"
+#include "rw/collision/compactkdtree.h"
+#include "aabbox.h"
+
+namespace rw
+{
+    namespace collision
+    {
+        namespace detail
+        {
+            namespace fpu
+            {
+                // Forward declare CompactKDTree in the rw::collision namespace so
+                // that we can use it in the EA_SERIALIZATION_CLASS_* macros
+                class CompactKDTree;
+            } // namspace fpu
+        } // namespace detail 
+    } // namespace collision
+} // namespace rw
+
+// We need to specify the class serialization version prior to the class definition
+// due to a problem with ps2 gcc.
+EA_SERIALIZATION_CLASS_VERSION(rw::collision::detail::fpu::CompactKDTree, 1)
+// These macro provide the type name used in text-based archives' serialization.
+EA_SERIALIZATION_CLASS_NAME(rw::collision::detail::fpu::CompactKDTree, "rw::collision::CompactKDTree")
+
+namespace rw
+{
+namespace collision
+{
+namespace detail
+{
+namespace fpu
+{
+
+/** \brief This class mimics the layout of rw::collision::CompactKDTree when built using fpu
+* rwmath.
+*
+* This class can be used for creating memory imaged fpu versions of rw::collision::CompactKDTree
+* which can be deserialized using the LLSerializable framework for loading on platforms
+* using fpu rwmath.
+*
+* As the serialization function matches that of rw::collision::CompactKDTree it is possible to
+* convert between the two using the Serialization framework.
+*
+* Changes to data members in rw::collision::CompactKDTree or its serialization function should be
+* mirrored in this class.
+*/
+class CompactKDTree
+{
+public:
+
+    struct BranchNode
+    {
+        uint32_t    m_axisAndContents;
+        uint16_t    m_extents[2];
+        uint32_t    m_childIndices[2];
+
+        template <class Archive>
+            void Serialize(Archive &ar, uint32_t /*version*/)
+        {
+            ar & EA_SERIALIZATION_NAMED_VALUE(m_axisAndContents);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_extents, 2);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_childIndices, 2);
+        }
+    };
+
+    static EA::Physics::SizeAndAlignment
+    GetResourceDescriptor(uint32_t numBranchNodes,
+                          uint32_t /*numEntries*/,
+                          const AABBox& /*bbox*/)
+    {
+        uint32_t size = EA::Physics::SizeAlign<uint32_t>(sizeof(CompactKDTree), rwcKDTREE_ALIGNMENT) + numBranchNodes * sizeof(BranchNode);
+        return EA::Physics::SizeAndAlignment(size, rwcKDTREE_ALIGNMENT);
+    }
+
+    static CompactKDTree *
+    Initialize(const EA::Physics::MemoryPtr& resource,
+               uint32_t numBranchNodes,
+               uint32_t numEntries,
+               const AABBox &bbox)
+    {
+        CompactKDTree *kdtree = static_cast<CompactKDTree *>(resource.GetMemory());
+        BranchNode * branchNodes = 0;
+        if (numBranchNodes > 0)
+        {
+            branchNodes = (BranchNode *)EA::Physics::MemAlign(reinterpret_cast<void *>(kdtree + 1), rwcKDTREE_ALIGNMENT);
+        }
+        return new (resource.GetMemory()) CompactKDTree(numBranchNodes, numEntries, bbox, branchNodes);
+    }
+
+    CompactKDTree(uint32_t numBranchNodes,
+        uint32_t numEntries,
+        const AABBox &bbox,
+        BranchNode * branchNodes)
+        : m_branchNodes(branchNodes)
+        , m_numBranchNodes(numBranchNodes)
+        , m_numEntries(numEntries)
+        , m_bbox(bbox)
+    {
+    }
+
+    template <class Archive>
+    void Serialize(Archive &ar, uint32_t /*version*/)
+    {
+        ar.TrackInternalPointer(m_branchNodes);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numBranchNodes);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numEntries);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_bbox);
+        ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_branchNodes, m_numBranchNodes);
+    }
+
+    BranchNode *      m_branchNodes;
+    uint32_t          m_numBranchNodes;
+    uint32_t          m_numEntries;
+    AABBox            m_bbox;
+};
+} // namespace fpu
+} // namespace detail
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_DETAIL_FPU_COMPACTKDTREE_H
@@ -0,0 +1,232 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_DETAIL_FPU_HEIGHTFIELDPROCEDURAL_H
+#define PUBLIC_RW_COLLISION_DETAIL_FPU_HEIGHTFIELDPROCEDURAL_H
+
+/*************************************************************************************************************
+
+File: heightfieldprocedural.h
+
+Purpose: Procedural aggregate of the triangles implied by a regular grid of quantized heights.
+*/
+
+
+#include "rw/collision/common.h"
+#include "rw/collision/detail/fpu/procedural.h"
+#include "rw/collision/heightfieldprocedural.h"
+
+
+namespace rw
+{
+namespace collision
+{
+namespace detail
+{
+namespace fpu
+{
+
+
+/**
+\brief This class mimics the layout of rw::collision::HeightFieldProcedural when built using fpu rwmath.
+
+This class can be used for creating memory imaged fpu versions of rw::collision::HeightFieldProcedural
+which can be deserialized using the LLSerializable framework for loading on platforms using fpu rwmath.
+
+As the serialization function matches that of rw::collision::HeightFieldProcedural it is possible to
+convert between the two using the Serialization framework.
+
+Changes to data members in rw::collision::HeightFieldProcedural or its serialization function should be
+mirrored in this class.
+
+\importlib rwccore
+*/
+class HeightFieldProcedural : public Procedural
+{
+public:
+
+    typedef rw::collision::HeightFieldProcedural::ObjectDescriptor ObjectDescriptor;
+
+    static EA::Physics::SizeAndAlignment
+    GetResourceDescriptor(uint32_t numCellsX,
+                          uint32_t numCellsZ,
+                          uint32_t flags);
+
+    static HeightFieldProcedural *
+    Initialize(const EA::Physics::MemoryPtr &resource,
+               uint32_t numCellsX,
+               uint32_t numCellsZ,
+               uint32_t flags);
+
+    static HeightFieldProcedural * Initialize(const EA::Physics::MemoryPtr& resource, const ObjectDescriptor & objDesc);
+
+    static EA::Physics::SizeAndAlignment GetResourceDescriptor(const ObjectDescriptor & objDesc);
+
+    const ObjectDescriptor GetObjectDescriptor() const;
+
+    template <class Archive>
+    void Serialize(Archive &ar, uint32_t /*version*/)
+    {
+        // Serialize base class
+        ar & EA::Serialization::MakeNamedValue(*static_cast<Procedural*>(this), "Procedural");
+
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numCellsX);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numCellsZ);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_flags);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_originX);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_originZ);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_cellSizeX);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_cellSizeZ);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_heightOffset);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_heightScale);
+
+        ar.TrackInternalPointer(m_heights);
+        ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_heights, (m_numCellsX + 1) * (m_numCellsZ + 1));
+
+        if (m_flags & rw::collision::HeightFieldProcedural::FLAG_HASSURFACEIDS)
+        {
+            ar.TrackInternalPointer(m_surfaceIDs);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_surfaceIDs, m_numCellsX * m_numCellsZ);
+        }
+
+        if (m_flags & rw::collision::HeightFieldProcedural::FLAG_HASDIAGONALFLAGS)
+        {
+            ar.TrackInternalPointer(m_diagonalFlags);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_diagonalFlags, ((m_numCellsX * m_numCellsZ + 31) >> 5));
+        }
+    }
+
+private:
+
+    HeightFieldProcedural(uint32_t numCellsX,
+                          uint32_t numCellsZ,
+                          uint32_t flags);
+
+    uint32_t                m_numCellsX;
+    uint32_t                m_numCellsZ;
+    uint32_t                m_flags;
+
+    float                   m_originX;
+    float                   m_originZ;
+    float                   m_cellSizeX;
+    float                   m_cellSizeZ;
+    float                   m_heightOffset;
+    float                   m_heightScale;
+
+    // (numCellsX + 1) * (numCellsZ + 1) quantized heights, row by row along x
+    uint16_t *              m_heights;
+
+    // One surface ID per cell, or NULL
+    uint16_t *              m_surfaceIDs;
+
+    // One bit per cell, or NULL
+    uint32_t *              m_diagonalFlags;
+};
+
+
+/**
+\brief Constructor, laying out the cell data after the object as rw::collision::HeightFieldProcedural does.
+The data is filled by deserialization.
+*/
+inline
+HeightFieldProcedural::HeightFieldProcedural(uint32_t numCellsX,
+                                             uint32_t numCellsZ,
+                                             uint32_t flags)
+    : m_numCellsX(numCellsX)
+    , m_numCellsZ(numCellsZ)
+    , m_flags(flags)
+    , m_originX(0.0f)
+    , m_originZ(0.0f)
+    , m_cellSizeX(1.0f)
+    , m_cellSizeZ(1.0f)
+    , m_heightOffset(0.0f)
+    , m_heightScale(1.0f)
+    , m_surfaceIDs(NULL)
+    , m_diagonalFlags(NULL)
+{
+    uintptr_t addr = reinterpret_cast<uintptr_t>(this) + sizeof(HeightFieldProcedural);
+
+    // The diagonal flags come first to keep them aligned
+    if (flags & rw::collision::HeightFieldProcedural::FLAG_HASDIAGONALFLAGS)
+    {
+        m_diagonalFlags = reinterpret_cast<uint32_t *>(addr);
+        addr += ((numCellsX * numCellsZ + 31) >> 5) * sizeof(uint32_t);
+    }
+
+    m_heights = reinterpret_cast<uint16_t *>(addr);
+    addr += (numCellsX + 1) * (numCellsZ + 1) * sizeof(uint16_t);
+
+    if (flags & rw::collision::HeightFieldProcedural::FLAG_HASSURFACEIDS)
+    {
+        m_surfaceIDs = reinterpret_cast<uint16_t *>(addr);
+    }
+}
+
+
+inline EA::Physics::SizeAndAlignment
+HeightFieldProcedural::GetResourceDescriptor(uint32_t numCellsX,
+                                             uint32_t numCellsZ,
+                                             uint32_t flags)
+{
+    const uint32_t numCells = numCellsX * numCellsZ;
+
+    // Class structure
+    uint32_t size = sizeof(HeightFieldProcedural);
+
+    // m_diagonalFlags
+    if (flags & rw::collision::HeightFieldProcedural::FLAG_HASDIAGONALFLAGS)
+    {
+        size += ((numCells + 31) >> 5) * sizeof(uint32_t);
+    }
+
+    // m_heights
+    size += (numCellsX + 1) * (numCellsZ + 1) * sizeof(uint16_t);
+
+    // m_surfaceIDs
+    if (flags & rw::collision::HeightFieldProcedural::FLAG_HASSURFACEIDS)
+    {
+        size += numCells * sizeof(uint16_t);
+    }
+
+    return EA::Physics::SizeAndAlignment(size, rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT);
+}
+
+
+inline HeightFieldProcedural *
+HeightFieldProcedural::Initialize(const EA::Physics::MemoryPtr &resource,
+                                  uint32_t numCellsX,
+                                  uint32_t numCellsZ,
+                                  uint32_t flags)
+{
+    // Check the alignment of the resource
+    rwcASSERTALIGN(resource.GetMemory(), rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT);
+
+    return new (resource.GetMemory()) HeightFieldProcedural(numCellsX, numCellsZ, flags);
+}
+
+
+inline HeightFieldProcedural *
+HeightFieldProcedural::Initialize(const EA::Physics::MemoryPtr& resource, const ObjectDescriptor & objDesc)
+{
+    return Initialize(resource, objDesc.m_numCellsX, objDesc.m_numCellsZ, objDesc.m_flags);
+}
+
+
+inline EA::Physics::SizeAndAlignment
+HeightFieldProcedural::GetResourceDescriptor(const ObjectDescriptor & objDesc)
+{
+    return GetResourceDescriptor(objDesc.m_numCellsX, objDesc.m_numCellsZ, objDesc.m_flags);
+}
+
+
+inline const HeightFieldProcedural::ObjectDescriptor
+HeightFieldProcedural::GetObjectDescriptor() const
+{
+    return ObjectDescriptor(m_numCellsX, m_numCellsZ, m_flags);
+}
+
+
+} // namespace fpu
+} // namespace detail
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_DETAIL_FPU_HEIGHTFIELDPROCEDURAL_H
@@ -113,6 +113,16 @@ TriangleClusterProcedural::GetClusterSize(ClusteredMeshCluster& cluster) const
     {
         bytes += sizeof(rw::collision::ClusteredMeshCluster::Vertex32) * cluster.vertexCount;
     }
+    else if (cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED)
+    {
+        bytes += sizeof(rw::collision::ClusteredMeshCluster::VertexHeader);
+        bytes += sizeof(rw::collision::ClusteredMeshCluster::Vertex8) * cluster.vertexCount;
+    }
+    else if (cluster.compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED)
+    {
+        bytes += sizeof(rw::collision::ClusteredMeshCluster::VertexHeader);
+        bytes += sizeof(uint32_t) * cluster.vertexCount;
+    }
     else
     {
         bytes += RWMATH_VECTOR3_ALIGNMENT * cluster.vertexCount;
@@ -0,0 +1,64 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_DISTANCEQUERY_H
+#define PUBLIC_RW_COLLISION_DISTANCEQUERY_H
+
+/*************************************************************************************************************
+
+ File: distancequery.h
+
+ Purpose: Closest point queries against triangles.
+ */
+
+#include "rw/collision/common.h"
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\brief The result of a closest point query.
+
+\importlib rwccore
+*/
+struct DistanceQueryResult
+{
+    /**
+    \brief The feature of the triangle on which the closest point lies.
+
+    Edge i runs from vertex i to vertex (i+1)%3, matching the order of the triangle edge cosines.
+    */
+    enum Feature
+    {
+        FEATURE_FACE,
+        FEATURE_EDGE0,
+        FEATURE_EDGE1,
+        FEATURE_EDGE2,
+        FEATURE_VERTEX0,
+        FEATURE_VERTEX1,
+        FEATURE_VERTEX2
+    };
+
+    rwpmath::Vector3 position;      ///< Closest point on the surface of the triangle.
+    rwpmath::Vector3 normal;        ///< Face normal of the triangle.
+    float            distance;      ///< Distance from the query point to the closest point.
+    uint32_t         childIndex;    ///< Child index of the triangle, when querying an aggregate.
+    uint32_t         surfaceID;     ///< Surface ID of the triangle, when querying an aggregate.
+    uint32_t         groupID;       ///< Group ID of the triangle, when querying an aggregate.
+    Feature          feature;       ///< Feature of the triangle on which the closest point lies.
+};
+
+
+DistanceQueryResult::Feature
+TriangleClosestPoint(rwpmath::Vector3 &closestPoint,
+                     rwpmath::Vector3::InParam point,
+                     rwpmath::Vector3::InParam v0,
+                     rwpmath::Vector3::InParam v1,
+                     rwpmath::Vector3::InParam v2);
+
+
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_DISTANCEQUERY_H
@@ -0,0 +1,437 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_HEIGHTFIELDPROCEDURAL_H
+#define PUBLIC_RW_COLLISION_HEIGHTFIELDPROCEDURAL_H
+
+/*************************************************************************************************************
+
+ File: heightfieldprocedural.h
+
+ Purpose: Procedural aggregate of the triangles implied by a regular grid of quantized heights.
+ */
+
+
+#include "rw/collision/common.h"
+#include "rw/collision/aabbox.h"
+#include "rw/collision/volumedata.h"
+#include "rw/collision/procedural.h"
+
+
+#define rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT RWMATH_VECTOR3_ALIGNMENT
+
+
+namespace rw
+{
+namespace collision
+{
+    class VolumeBBoxQuery;
+    class VolumeLineQuery;
+    class TriangleVolume;
+}
+}
+
+
+namespace rw
+{
+namespace collision
+{
+
+
+// Structure below has padding inserted by the compiler, which produces a warning.
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable: 4324)
+#endif
+
+/**
+\brief A procedural aggregate of the triangles implied by a regular grid of quantized heights.
+
+The grid lies in the local x-z plane with y up. It has numCellsX by numCellsZ cells, the vertex at grid
+position (x, z) being at
+
+\code
+(originX + x * cellSizeX, heightOffset + height(x, z) * heightScale, originZ + z * cellSizeZ)
+\endcode
+
+where height(x, z) is a 16 bit quantized height. Each cell is split into two triangles along the
+diagonal from vertex (x, z) to vertex (x + 1, z + 1), or, if the optional diagonal flag of the cell is
+set, along the other diagonal. Each cell may optionally have a surface ID, which is given to both of
+its triangles.
+
+No vertex, index or edge data is stored: the triangles are generated as they are needed by the line and
+bbox queries, which find the cells they touch directly from the grid. Line queries without fatness walk
+the cells crossed by the line with a 2D DDA. The triangles returned by the bbox queries have their edge
+cosines and convex edge flags computed from the neighboring triangles, so that they can be used to
+generate contacts in the same way as the triangles of a ClusteredMesh.
+
+The child index of a triangle, which is used in the tags of the query results, is twice the index
+(z * numCellsX + x) of its cell plus the index of the triangle within the cell.
+
+\importlib rwccore
+*/
+class HeightFieldProcedural : public Procedural
+{
+public:
+
+    /**
+    \brief Flags describing the optional data and behavior of a HeightFieldProcedural.
+    */
+    enum Flags
+    {
+        FLAG_ONESIDED = 0x01,               ///< The triangles are one sided, facing up.
+        FLAG_HASSURFACEIDS = 0x02,          ///< Each cell has a surface ID.
+        FLAG_HASDIAGONALFLAGS = 0x04        ///< Each cell has a flag selecting its diagonal.
+    };
+
+    struct ObjectDescriptor;
+
+    static EA::Physics::SizeAndAlignment
+    GetResourceDescriptor(uint32_t numCellsX,
+                          uint32_t numCellsZ,
+                          uint32_t flags);
+
+    static HeightFieldProcedural *
+    Initialize(const EA::Physics::MemoryPtr &resource,
+               uint32_t numCellsX,
+               uint32_t numCellsZ,
+               uint32_t flags);
+
+    static HeightFieldProcedural * Initialize(const EA::Physics::MemoryPtr& resource, const ObjectDescriptor & objDesc);
+    static EA::Physics::SizeAndAlignment GetResourceDescriptor(const ObjectDescriptor & objDesc);
+
+    // Return the information needed to allocate this object when deserializing
+    const ObjectDescriptor GetObjectDescriptor() const;
+
+    void
+    Release();
+
+    /**
+    \brief Sets the position of grid vertex (0, 0) in the x-z plane and the size of the cells.
+    */
+    void
+    SetGrid(float originX, float originZ, float cellSizeX, float cellSizeZ)
+    {
+        EA_ASSERT_MSG(cellSizeX > 0.0f && cellSizeZ > 0.0f, ("Cell sizes must be positive."));
+        m_originX = originX;
+        m_originZ = originZ;
+        m_cellSizeX = cellSizeX;
+        m_cellSizeZ = cellSizeZ;
+    }
+
+    /**
+    \brief Sets the height of a quantized height of zero and the height of each quantization step.
+    */
+    void
+    SetHeightQuantization(float heightOffset, float heightScale)
+    {
+        EA_ASSERT_MSG(heightScale > 0.0f, ("Height scale must be positive."));
+        m_heightOffset = heightOffset;
+        m_heightScale = heightScale;
+    }
+
+    /**
+    \return The quantized height nearest to a height, clamped to the quantized range.
+    */
+    uint16_t
+    QuantizeHeight(float height) const
+    {
+        const float q = (height - m_heightOffset) / m_heightScale + 0.5f;
+        return static_cast<uint16_t>(q <= 0.0f ? 0.0f : (q >= 65535.0f ? 65535.0f : q));
+    }
+
+    /**
+    \brief Sets the quantized height of a grid vertex.
+    */
+    void
+    SetHeight(uint32_t x, uint32_t z, uint16_t height)
+    {
+        EA_ASSERT(x <= m_numCellsX && z <= m_numCellsZ);
+        m_heights[z * (m_numCellsX + 1) + x] = height;
+    }
+
+    /**
+    \return The quantized height of a grid vertex.
+    */
+    uint16_t
+    GetHeight(uint32_t x, uint32_t z) const
+    {
+        EA_ASSERT(x <= m_numCellsX && z <= m_numCellsZ);
+        return m_heights[z * (m_numCellsX + 1) + x];
+    }
+
+    /**
+    \brief Sets the surface ID of a cell. Only available with FLAG_HASSURFACEIDS.
+    */
+    void
+    SetCellSurfaceID(uint32_t x, uint32_t z, uint16_t surfaceID)
+    {
+        EA_ASSERT_MSG(m_surfaceIDs != NULL, ("HeightFieldProcedural was initialized without surface IDs."));
+        EA_ASSERT(x < m_numCellsX && z < m_numCellsZ);
+        m_surfaceIDs[z * m_numCellsX + x] = surfaceID;
+    }
+
+    /**
+    \return The surface ID of a cell, which is zero without FLAG_HASSURFACEIDS.
+    */
+    uint32_t
+    GetCellSurfaceID(uint32_t cellIndex) const
+    {
+        EA_ASSERT(cellIndex < m_numCellsX * m_numCellsZ);
+        return (NULL != m_surfaceIDs) ? m_surfaceIDs[cellIndex] : 0u;
+    }
+
+    /**
+    \brief Selects the diagonal of a cell. Only available with FLAG_HASDIAGONALFLAGS.
+
+    \param x,z The cell.
+    \param flip FALSE to split the cell from vertex (x, z) to vertex (x + 1, z + 1), TRUE to split it from
+    vertex (x + 1, z) to vertex (x, z + 1).
+    */
+    void
+    SetCellDiagonal(uint32_t x, uint32_t z, RwpBool flip)
+    {
+        EA_ASSERT_MSG(m_diagonalFlags != NULL, ("HeightFieldProcedural was initialized without diagonal flags."));
+        EA_ASSERT(x < m_numCellsX && z < m_numCellsZ);
+        const uint32_t cellIndex = z * m_numCellsX + x;
+        const uint32_t bit = 1u << (cellIndex & 31);
+        m_diagonalFlags[cellIndex >> 5] = flip ? (m_diagonalFlags[cellIndex >> 5] | bit) : (m_diagonalFlags[cellIndex >> 5] & ~bit);
+    }
+
+    /**
+    \return Whether a cell is split from vertex (x + 1, z) to vertex (x, z + 1).
+    */
+    RwpBool
+    GetCellDiagonal(uint32_t cellIndex) const
+    {
+        EA_ASSERT(cellIndex < m_numCellsX * m_numCellsZ);
+        return static_cast<RwpBool>((NULL != m_diagonalFlags) && (0 != (m_diagonalFlags[cellIndex >> 5] & (1u << (cellIndex & 31)))));
+    }
+
+    /// \return The number of cells along x.
+    uint32_t
+    GetNumCellsX() const
+    {
+        return m_numCellsX;
+    }
+
+    /// \return The number of cells along z.
+    uint32_t
+    GetNumCellsZ() const
+    {
+        return m_numCellsZ;
+    }
+
+    /// \return The flags the HeightFieldProcedural was initialized with.
+    uint32_t
+    GetFlags() const
+    {
+        return m_flags;
+    }
+
+    void
+    GetTriangleVertices(uint32_t childIndex,
+                        rwpmath::Vector3 &v0,
+                        rwpmath::Vector3 &v1,
+                        rwpmath::Vector3 &v2) const;
+
+    void
+    GetVolumeFromChildIndex(rw::collision::TriangleVolume &volume, uint32_t childIndex) const;
+
+    // Check validity (only available in debug).
+    RwpBool
+    IsValid() const;
+
+    // Functions used to fill in vtable
+    uint32_t
+    GetSizeThis();
+
+    void
+    UpdateThis(void);
+
+    RwpBool
+    LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
+                              const rwpmath::Matrix44Affine *tm);
+
+    RwpBool
+    BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
+                         const rwpmath::Matrix44Affine *tm);
+
+    template <class Archive>
+    void Serialize(Archive &ar, uint32_t /*version*/)
+    {
+        // Serialize base class
+        ar & EA::Serialization::MakeNamedValue(*static_cast<Procedural*>(this), "Procedural");
+
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numCellsX);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numCellsZ);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_flags);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_originX);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_originZ);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_cellSizeX);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_cellSizeZ);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_heightOffset);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_heightScale);
+
+        ar.TrackInternalPointer(m_heights);
+        ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_heights, (m_numCellsX + 1) * (m_numCellsZ + 1));
+
+        if (m_flags & FLAG_HASSURFACEIDS)
+        {
+            ar.TrackInternalPointer(m_surfaceIDs);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_surfaceIDs, m_numCellsX * m_numCellsZ);
+        }
+
+        if (m_flags & FLAG_HASDIAGONALFLAGS)
+        {
+            ar.TrackInternalPointer(m_diagonalFlags);
+            ar & EA_SERIALIZATION_NAMED_STATIC_ARRAY(m_diagonalFlags, ((m_numCellsX * m_numCellsZ + 31) >> 5));
+        }
+
+        if(ar.IsLoading())
+        {
+            m_vTable = &sm_vTable;
+            EA_ASSERT(m_vTable != NULL);
+        }
+    }
+
+private:
+
+    HeightFieldProcedural(uint32_t numCellsX,
+                          uint32_t numCellsZ,
+                          uint32_t flags,
+                          VTable *vTable);
+
+    rwpmath::Vector3
+    GetVertex(uint32_t x, uint32_t z) const;
+
+    void
+    GetCellTriangle(uint32_t cellX,
+                    uint32_t cellZ,
+                    uint32_t triangle,
+                    rwpmath::Vector3 &v0,
+                    rwpmath::Vector3 &v1,
+                    rwpmath::Vector3 &v2) const;
+
+    RwpBool
+    GetEdgeOppositeVertex(rwpmath::Vector3 &vertex,
+                          uint32_t cellX,
+                          uint32_t cellZ,
+                          uint32_t edge) const;
+
+    uint32_t
+    GetCellTriangleEdgeCosines(uint32_t cellX,
+                               uint32_t cellZ,
+                               uint32_t triangle,
+                               rwpmath::Vector3 &edgeCosines) const;
+
+    void
+    InitializeTriangleVolume(rw::collision::TriangleVolume &volume,
+                             uint32_t cellX,
+                             uint32_t cellZ,
+                             uint32_t triangle,
+                             RwpBool withEdgeCosines) const;
+
+    void
+    GetCellHeightRange(uint32_t cellX, uint32_t cellZ, float &minHeight, float &maxHeight) const;
+
+    RwpBool
+    LineIntersectCell(VolumeLineQuery *lineQuery,
+                      const rwpmath::Matrix44Affine *tm,
+                      rwpmath::Vector3::InParam localLineStart,
+                      rwpmath::Vector3::InParam localLineDelta,
+                      uint32_t cellX,
+                      uint32_t cellZ,
+                      uint32_t trianglesLeft) const;
+
+    static VTable           sm_vTable;
+
+    uint32_t                m_numCellsX;
+    uint32_t                m_numCellsZ;
+    uint32_t                m_flags;
+
+    float                   m_originX;
+    float                   m_originZ;
+    float                   m_cellSizeX;
+    float                   m_cellSizeZ;
+    float                   m_heightOffset;
+    float                   m_heightScale;
+
+    // (numCellsX + 1) * (numCellsZ + 1) quantized heights, row by row along x
+    uint16_t *              m_heights;
+
+    // One surface ID per cell, or NULL
+    uint16_t *              m_surfaceIDs;
+
+    // One bit per cell, or NULL
+    uint32_t *              m_diagonalFlags;
+
+    /**
+        The following data is inherited from Aggregate.
+
+    AABBox             m_AABB;
+    VTable            *m_vTable;
+    uint32_t           m_numTagBits;
+    uint32_t           m_numVolumes;
+    */
+};
+
+
+struct HeightFieldProcedural::ObjectDescriptor
+{
+    ObjectDescriptor(uint32_t numCellsX,
+                     uint32_t numCellsZ,
+                     uint32_t flags)
+    {
+        m_numCellsX = numCellsX;
+        m_numCellsZ = numCellsZ;
+        m_flags = flags;
+    }
+
+    ObjectDescriptor()
+    {
+        m_numCellsX = 0;
+        m_numCellsZ = 0;
+        m_flags = 0;
+    }
+
+    uint32_t m_numCellsX;
+    uint32_t m_numCellsZ;
+    uint32_t m_flags;
+
+    template <class Archive>
+        void Serialize(Archive &ar, uint32_t /*version*/)
+    {
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numCellsX);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_numCellsZ);
+        ar & EA_SERIALIZATION_NAMED_VALUE(m_flags);
+    }
+};
+
+
+inline HeightFieldProcedural *
+HeightFieldProcedural::Initialize(const EA::Physics::MemoryPtr& resource, const ObjectDescriptor & objDesc)
+{
+    return Initialize(resource, objDesc.m_numCellsX, objDesc.m_numCellsZ, objDesc.m_flags);
+}
+
+
+inline EA::Physics::SizeAndAlignment
+HeightFieldProcedural::GetResourceDescriptor(const ObjectDescriptor & objDesc)
+{
+    return GetResourceDescriptor(objDesc.m_numCellsX, objDesc.m_numCellsZ, objDesc.m_flags);
+}
+
+
+inline const HeightFieldProcedural::ObjectDescriptor HeightFieldProcedural::GetObjectDescriptor() const
+{
+    return ObjectDescriptor(m_numCellsX, m_numCellsZ, m_flags);
+}
+
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_HEIGHTFIELDPROCEDURAL_H
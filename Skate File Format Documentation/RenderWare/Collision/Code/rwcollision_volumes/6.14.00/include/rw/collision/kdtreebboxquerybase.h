@@ -12,6 +12,7 @@ Purpose: Base class for KDTree AABB queries.
 
 #include "rw/collision/common.h"
 #include "rw/collision/kdtreebase.h"
+#include "rw/collision/metrics.h"
 
 namespace rw
 {
@@ -33,6 +34,12 @@ public:
     /// Access the copy of the bounding passed to the constructor
     const AABBox & GetBBox() const;
 
+    /// The number of branch nodes processed since construction or the last ResetNumNodesVisited
+    uint32_t GetNumNodesVisited() const;
+
+    /// Restart the count of branch nodes processed
+    void ResetNumNodesVisited();
+
 protected:
 
     void ProcessBranchNode();
@@ -53,12 +60,13 @@ protected:
     uint32_t        m_resultCount;                   ///< The number of results
     uint32_t        m_nextEntry;                     ///< The next result
 
+    uint32_t        m_numNodesVisited;               ///< The number of branch nodes processed, for query statistics
 };
 
 /**
 Construct a KDTree bounding box query.
 */
-RW_COLLISION_FORCE_INLINE KDTreeBBoxQueryBase::KDTreeBBoxQueryBase():m_kdtree(0)
+RW_COLLISION_FORCE_INLINE KDTreeBBoxQueryBase::KDTreeBBoxQueryBase():m_kdtree(0), m_numNodesVisited(0)
 {
 }
 
@@ -82,7 +90,8 @@ KDTreeBBoxQueryBase::KDTreeBBoxQueryBase(const KDTreeBase *kdtree,
                                          m_kdtree(kdtree),
                                          m_branchIndexOffset(branchIndexOffset),
                                          m_resultCount(0),
-                                         m_nextEntry(defaultEntry)
+                                         m_nextEntry(defaultEntry),
+                                         m_numNodesVisited(0)
 {
     if (kdtree->m_numBranchNodes > 0)
     {
@@ -109,6 +118,18 @@ const AABBox & KDTreeBBoxQueryBase::GetBBox() const
     return m_bbox;
 }
 
+RW_COLLISION_FORCE_INLINE
+uint32_t KDTreeBBoxQueryBase::GetNumNodesVisited() const
+{
+    return m_numNodesVisited;
+}
+
+RW_COLLISION_FORCE_INLINE
+void KDTreeBBoxQueryBase::ResetNumNodesVisited()
+{
+    m_numNodesVisited = 0;
+}
+
 
 
 /**
@@ -142,6 +163,7 @@ KDTreeBBoxQueryBase::ProcessBranchNode()
 {
     EA_ASSERT(m_kdtree);
     EA_ASSERT(m_top > 0);
+    rwcQUERYSTATS(++m_numNodesVisited);
 
     // Writes to the stack won't alias with reads from the node array
     uint32_t * EA_RESTRICT stack = m_stack;
@@ -189,6 +189,9 @@ public:
               const uint32_t maxEntriesPerNode = rwcKDTREEBUILER_DEFAULTMAXENTRIESPERNODE,
               const float minSimilarAreaThreshold = rwcKDTREEBUILDER_DEFAULTMINSIMILARSIZETHRESHOLD);
 
+    static uint32_t
+    GetBuildMemoryRequirements(uint32_t numEntries, uint32_t numNodes);
+
     uint32_t
     GetNumNodes() const
     {
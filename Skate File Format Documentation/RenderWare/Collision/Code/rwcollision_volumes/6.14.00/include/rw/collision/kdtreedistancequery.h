@@ -0,0 +1,448 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_KDTREE_DISTANCE_QUERY_H
+#define PUBLIC_RW_COLLISION_KDTREE_DISTANCE_QUERY_H
+
+/*************************************************************************************************************
+
+File: kdtreedistancequery.h
+
+Purpose: Nearest first KDTree query for finding entries within a distance of a point.
+
+*/
+
+#include "rw/collision/common.h"
+#include "rw/collision/kdtreebase.h"
+#include "rw/collision/kdsubtree.h"
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\internal
+Maximum number of nodes kept in nearest first order by a KDTreeDistanceQuery.
+*/
+#define rwcKDTREE_DISTANCEQUERY_HEAP_SIZE   (4 * rwcKDTREE_STACK_SIZE)
+
+/**
+\internal
+Maximum number of nodes waiting to be visited by a KDTreeDistanceQuery. Once the heap is full the remaining
+nodes are visited depth first, which needs at most one node per level of the tree on top of the heap.
+*/
+#define rwcKDTREE_DISTANCEQUERY_STACK_SIZE  (rwcKDTREE_DISTANCEQUERY_HEAP_SIZE + rwcKDTREE_STACK_SIZE + 1)
+
+
+/**
+\brief
+A KDTree distance query returns the leaf nodes of the kd tree that lie within a distance of a point, nearest
+leaf first.
+
+The nodes waiting to be visited are kept in a priority queue keyed by the squared distance from the point to
+the node box. The box of each child is found from the box of its parent and the branch extents, so only the
+per axis separation of the point from the box needs to be kept for each node. Leaves are returned in order
+of increasing box distance, and nodes further away than the maximum distance are never visited.
+
+As the caller finds entries closer than the maximum distance it should call ClipDistance, so that leaves
+which cannot contain a closer entry are skipped. Once the distance to the next leaf is greater than the
+maximum distance GetNext returns FALSE.
+
+The heap holds rwcKDTREE_DISTANCEQUERY_HEAP_SIZE nodes, which is enough for compact queries. A query with a
+large maximum distance on a large tree can have more nodes pending than that, in which case the query falls
+back to visiting the remaining nodes depth first. Every leaf within the maximum distance is still returned,
+and GetLeafDistanceSquared is still exact, but the leaves are no longer returned in order of distance.
+
+\par Usage
+\code
+KDTreeDistanceQuery query(kdtree, point, maxDistance);
+uint32_t entry, count;
+
+while (query.GetNext(entry, count))
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float distance = DistanceToYourObject(point, yourObject[entry + i]);
+        if (distance < query.GetMaxDistance())
+        {
+            closest = entry + i;
+            query.ClipDistance(distance);
+        }
+    }
+}
+\endcode
+
+\importlib rwccore
+*/
+class KDTreeDistanceQuery
+{
+public:
+
+    KDTreeDistanceQuery(const KDTreeBase *kdtree,
+                        rwpmath::Vector3::InParam point,
+                        float maxDistance,
+                        float padding = 0.0f);
+
+    KDTreeDistanceQuery(const KDSubTree *kdtree,
+                        rwpmath::Vector3::InParam point,
+                        float maxDistance,
+                        float padding = 0.0f);
+
+    RwpBool GetNext(uint32_t &entry, uint32_t &count);
+
+    void    ClipDistance(float maxDistance);
+
+    float   GetMaxDistance() const;
+
+    float   GetLeafDistanceSquared() const;
+
+    /**
+    \internal
+    \brief A node waiting to be visited, with the separation of the query point from the node box.
+
+    \importlib rwccore
+    */
+    struct HeapElement
+    {
+        KDTreeBase::NodeRef m_nodeRef;      ///< The node, which can be a branch or a leaf.
+        float               m_distSq;       ///< Squared distance from the query point to the node box.
+        float               m_offset[3];    ///< Per axis distance from the query point to the node box.
+    };
+
+private:
+
+    void    Start(const uint32_t branchIndexOffset, const uint32_t defaultEntry);
+    void    ProcessBranchNode(const HeapElement &cur);
+    void    Push(const HeapElement &element);
+    void    Pop(HeapElement &element);
+
+    const KDTreeBase   *m_kdtree;                                       ///< Spatial map to be queried
+    float               m_point[3];                                     ///< The query point
+    float               m_padding;                                      ///< Amount each node box is expanded by
+    float               m_maxDistance;                                  ///< Current maximum distance
+    float               m_maxDistSq;                                    ///< Square of m_maxDistance
+    float               m_leafDistSq;                                   ///< Squared distance to the last leaf returned
+    uint32_t            m_branchIndexOffset;                            ///< Start offset into branchnode array
+    uint32_t            m_size;                                         ///< Number of nodes in the heap
+    RwpBool             m_depthFirst;                                   ///< TRUE once the heap has overflowed
+    HeapElement         m_heap[rwcKDTREE_DISTANCEQUERY_STACK_SIZE];     ///< Binary min-heap of nodes by distance, or a stack once m_depthFirst is set
+};
+
+
+/**
+\brief Constructs a distance query.
+
+\param kdtree       The KDTree spatial map to query against.
+\param point        The query point.
+\param maxDistance  Leaves further than this from the point are not returned.
+\param padding      Each leaf box is expanded by this amount, to allow for entries which extend slightly
+                    outside the tree extents, such as compressed vertices.
+*/
+inline
+KDTreeDistanceQuery::KDTreeDistanceQuery(const KDTreeBase *kdtree,
+                                         rwpmath::Vector3::InParam point,
+                                         float maxDistance,
+                                         float padding /* = 0.0f */)
+    : m_kdtree(kdtree),
+      m_padding(padding),
+      m_maxDistance(maxDistance),
+      m_maxDistSq(maxDistance * maxDistance),
+      m_leafDistSq(0.0f),
+      m_branchIndexOffset(0),
+      m_size(0),
+      m_depthFirst(FALSE)
+{
+    m_point[0] = point.GetX();
+    m_point[1] = point.GetY();
+    m_point[2] = point.GetZ();
+    Start(0, 0);
+}
+
+
+/**
+\brief Constructs a distance query against a KDSubTree.
+
+\param kdtree       The KDSubTree spatial map to query against.
+\param point        The query point.
+\param maxDistance  Leaves further than this from the point are not returned.
+\param padding      Each leaf box is expanded by this amount.
+*/
+inline
+KDTreeDistanceQuery::KDTreeDistanceQuery(const KDSubTree *kdtree,
+                                         rwpmath::Vector3::InParam point,
+                                         float maxDistance,
+                                         float padding /* = 0.0f */)
+    : m_kdtree(kdtree),
+      m_padding(padding),
+      m_maxDistance(maxDistance),
+      m_maxDistSq(maxDistance * maxDistance),
+      m_leafDistSq(0.0f),
+      m_branchIndexOffset(kdtree->GetBranchNodeOffset()),
+      m_size(0),
+      m_depthFirst(FALSE)
+{
+    m_point[0] = point.GetX();
+    m_point[1] = point.GetY();
+    m_point[2] = point.GetZ();
+    Start(kdtree->GetBranchNodeOffset(), kdtree->GetDefaultEntry());
+}
+
+
+/**
+\internal
+Pushes the root node if it is within the maximum distance.
+
+\param branchIndexOffset Start offset into branchnode array.
+\param defaultEntry      Entry returned when the tree has no branch nodes.
+*/
+inline void
+KDTreeDistanceQuery::Start(const uint32_t branchIndexOffset, const uint32_t defaultEntry)
+{
+    const rwpmath::Vector3 bboxMin = m_kdtree->m_bbox.Min();
+    const rwpmath::Vector3 bboxMax = m_kdtree->m_bbox.Max();
+
+    HeapElement root;
+    root.m_distSq = 0.0f;
+    for (int32_t axis = 0; axis < 3; ++axis)
+    {
+        const float below = static_cast<float>(bboxMin.GetComponent(axis)) - m_padding - m_point[axis];
+        const float above = m_point[axis] - static_cast<float>(bboxMax.GetComponent(axis)) - m_padding;
+        root.m_offset[axis] = rwpmath::Max(0.0f, rwpmath::Max(below, above));
+        root.m_distSq += root.m_offset[axis] * root.m_offset[axis];
+    }
+
+    if (m_kdtree->m_numBranchNodes > 0)
+    {
+        // Start at root
+        root.m_nodeRef.m_content = rwcKDTREE_BRANCH_NODE;
+        root.m_nodeRef.m_index = branchIndexOffset;
+    }
+    else
+    {
+        // Consider tree as single leaf
+        root.m_nodeRef.m_content = m_kdtree->m_numEntries;
+        root.m_nodeRef.m_index = defaultEntry;
+    }
+
+    if (root.m_distSq <= m_maxDistSq)
+    {
+        Push(root);
+    }
+}
+
+
+/**
+\brief Gets the next leaf within the maximum distance, nearest first unless the heap has overflowed.
+
+\param entry Receives the index of the first entry in the leaf.
+\param count Receives the number of entries in the leaf.
+
+\return TRUE if a leaf was returned, FALSE if there are no more leaves within the maximum distance.
+*/
+inline RwpBool
+KDTreeDistanceQuery::GetNext(uint32_t &entry, uint32_t &count)
+{
+    while (m_size > 0)
+    {
+        HeapElement cur;
+        Pop(cur);
+
+        if (cur.m_distSq > m_maxDistSq)
+        {
+            if (m_depthFirst)
+            {
+                // The stack is not ordered, so nearer nodes may remain
+                continue;
+            }
+
+            // Every remaining node is at least this far away
+            m_size = 0;
+            break;
+        }
+
+        if (cur.m_nodeRef.m_content == rwcKDTREE_BRANCH_NODE)
+        {
+            ProcessBranchNode(cur);
+        }
+        else if (cur.m_nodeRef.m_content > 0)
+        {
+            entry = cur.m_nodeRef.m_index;
+            count = cur.m_nodeRef.m_content;
+            m_leafDistSq = cur.m_distSq;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/**
+\brief Reduces the maximum distance of the query.
+
+Leaves further than the new distance will not be returned. Increasing the distance has no effect since
+nodes beyond the previous distance may already have been discarded.
+
+\param maxDistance The new maximum distance.
+*/
+inline void
+KDTreeDistanceQuery::ClipDistance(float maxDistance)
+{
+    if (maxDistance < m_maxDistance)
+    {
+        m_maxDistance = maxDistance;
+        m_maxDistSq = maxDistance * maxDistance;
+    }
+}
+
+
+/**
+\brief Gets the current maximum distance of the query.
+*/
+inline float
+KDTreeDistanceQuery::GetMaxDistance() const
+{
+    return m_maxDistance;
+}
+
+
+/**
+\brief Gets the squared distance from the query point to the box of the last leaf returned by GetNext.
+
+No entry in the leaf is closer than this.
+*/
+inline float
+KDTreeDistanceQuery::GetLeafDistanceSquared() const
+{
+    return m_leafDistSq;
+}
+
+
+/**
+\internal
+Pushes the children of a branch node that are within the maximum distance.
+
+The child box differs from the parent box on the split axis only, where the left child is bounded above by
+m_extents[0] and the right child is bounded below by m_extents[1].
+
+\param cur The branch node.
+*/
+inline void
+KDTreeDistanceQuery::ProcessBranchNode(const HeapElement &cur)
+{
+    const KDTreeBase::BranchNode &node = m_kdtree->m_branchNodes[cur.m_nodeRef.m_index - m_branchIndexOffset];
+    const uint32_t axis = node.m_axis;
+    const float parentOffset = cur.m_offset[axis];
+    const float parentDistSq = cur.m_distSq - parentOffset * parentOffset;
+
+    HeapElement child;
+    child.m_offset[0] = cur.m_offset[0];
+    child.m_offset[1] = cur.m_offset[1];
+    child.m_offset[2] = cur.m_offset[2];
+
+    // Left child
+    float offset = rwpmath::Max(parentOffset, m_point[axis] - node.m_extents[0] - m_padding);
+    child.m_distSq = parentDistSq + offset * offset;
+    if (child.m_distSq <= m_maxDistSq)
+    {
+        child.m_nodeRef = node.m_childRefs[0];
+        child.m_offset[axis] = offset;
+        Push(child);
+    }
+
+    // Right child
+    offset = rwpmath::Max(parentOffset, node.m_extents[1] - m_padding - m_point[axis]);
+    child.m_distSq = parentDistSq + offset * offset;
+    if (child.m_distSq <= m_maxDistSq)
+    {
+        child.m_nodeRef = node.m_childRefs[1];
+        child.m_offset[axis] = offset;
+        Push(child);
+    }
+}
+
+
+/**
+\internal
+Adds a node to the heap.
+
+When the heap is full the query switches to depth first order, and the heap array is used as a stack from
+then on. No node is dropped: the nodes already in the heap stay in the array, and the stack only grows by
+one node per level of the tree below them.
+*/
+inline void
+KDTreeDistanceQuery::Push(const HeapElement &element)
+{
+    if (!m_depthFirst && m_size == rwcKDTREE_DISTANCEQUERY_HEAP_SIZE)
+    {
+        m_depthFirst = TRUE;
+    }
+
+    if (m_depthFirst)
+    {
+        EA_ASSERT_MSG(m_size < rwcKDTREE_DISTANCEQUERY_STACK_SIZE, ("Stack overflow, KDTree is deeper than rwcKDTREE_MAX_DEPTH."));
+        m_heap[m_size++] = element;
+        return;
+    }
+
+    uint32_t i = m_size++;
+    while (i > 0)
+    {
+        const uint32_t parent = (i - 1) >> 1;
+        if (m_heap[parent].m_distSq <= element.m_distSq)
+        {
+            break;
+        }
+        m_heap[i] = m_heap[parent];
+        i = parent;
+    }
+    m_heap[i] = element;
+}
+
+
+/**
+\internal
+Removes the nearest node from the heap, or the last node pushed once the query is depth first. The heap must
+not be empty.
+*/
+inline void
+KDTreeDistanceQuery::Pop(HeapElement &element)
+{
+    EA_ASSERT(m_size > 0);
+
+    if (m_depthFirst)
+    {
+        element = m_heap[--m_size];
+        return;
+    }
+
+    element = m_heap[0];
+    const HeapElement last = m_heap[--m_size];
+
+    uint32_t i = 0;
+    for (;;)
+    {
+        uint32_t child = 2 * i + 1;
+        if (child >= m_size)
+        {
+            break;
+        }
+        if (child + 1 < m_size && m_heap[child + 1].m_distSq < m_heap[child].m_distSq)
+        {
+            ++child;
+        }
+        if (last.m_distSq <= m_heap[child].m_distSq)
+        {
+            break;
+        }
+        m_heap[i] = m_heap[child];
+        i = child;
+    }
+    m_heap[i] = last;
+}
+
+
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_KDTREE_DISTANCE_QUERY_H
@@ -96,6 +96,12 @@ public:
         rwpmath::Vector3::InParam end,
         const float fatness = 0.0f);
 
+    KDTreeLineQuery(const KDTreeBase *kdtree,
+        rwpmath::Vector3::InParam start,
+        rwpmath::Vector3::InParam end,
+        rwpmath::Vector3::InParam padding,
+        const float fatness);
+
 
     RwpBool GetNext(uint32_t &entry);
     RwpBool GetNext(uint32_t &entry, uint32_t &count);
@@ -184,6 +190,29 @@ KDTreeLineQuery::KDTreeLineQuery(const KDSubTree *kdtree,
 
 }
 
+/**
+\brief Constructs a query for an axis aligned box swept along a line.
+
+Every leaf touched by a box with half extents \a padding, centred on the line, is returned. This is
+used by shape casts where the swept shape is wider on some axes than others.
+
+\param kdtree   The KDTree to query.
+\param start    Start of the line swept by the box centre.
+\param end      End of the line swept by the box centre.
+\param padding  Half extents of the swept box.
+\param fatness  Additional padding on all axes.
+*/
+RW_COLLISION_FORCE_INLINE
+KDTreeLineQuery::KDTreeLineQuery(const KDTreeBase *kdtree,
+                                 rwpmath::Vector3::InParam start,
+                                 rwpmath::Vector3::InParam end,
+                                 rwpmath::Vector3::InParam padding,
+                                 const float fatness)
+                                 :KDTreeLineQueryBase(kdtree, start, end, padding, fatness, 0, 0)
+{
+
+}
+
 /**
 Find next kdtree entry from the leaf nodes that are intersected by the query line.
 
@@ -23,6 +23,7 @@ Purpose: Base class for KDTree line queries.
 #endif // defined(RWC_KDTREELINEQUERYBASE_OPT) && (defined(EA_PLATFORM_XENON) || defined(EA_PLATFORM_PS3) || defined(EA_PLATFORM_PS3_SPU))
 
 #include "rw/collision/kdtreebase.h"
+#include "rw/collision/metrics.h"
 
 namespace rw
 {
@@ -47,8 +48,23 @@ public:
                     const float fatness = 0.0f,
                     const uint32_t branchIndexOffset = 0,
                     const uint32_t defaultEntry = 0);
+
+    KDTreeLineQueryBase(const KDTreeBase *kdtree,
+                    rwpmath::Vector3::InParam start,
+                    rwpmath::Vector3::InParam end,
+                    rwpmath::Vector3::InParam padding,
+                    const float fatness,
+                    const uint32_t branchIndexOffset,
+                    const uint32_t defaultEntry);
     
     void   ProcessBranchNode();
+    void   Start(const uint32_t branchIndexOffset);
+
+    /// The number of branch nodes processed since construction or the last ResetNumNodesVisited
+    uint32_t GetNumNodesVisited() const;
+
+    /// Restart the count of branch nodes processed
+    void   ResetNumNodesVisited();
 
     /**
     \brief Used to cache tree nodes and relevant line segment parameters for later processing.
@@ -72,6 +88,8 @@ public:
 
     uint32_t            m_leafCount;                    ///< number of entries in the next batch
     uint32_t            m_nextEntry;                    ///< index of the first entry in the next batch
+
+    uint32_t            m_numNodesVisited;              ///< number of branch nodes processed, for query statistics
 };
 
 
@@ -94,7 +112,55 @@ KDTreeLineQueryBase::KDTreeLineQueryBase(const KDTreeBase *kdtree,
                                          m_lineClipper(start, end, rwpmath::Vector3(fatness, fatness, fatness), kdtree->m_bbox),
                                          m_branchIndexOffset(branchIndexOffset),
                                          m_leafCount(0),
-                                         m_nextEntry(defaultEntry)
+                                         m_nextEntry(defaultEntry),
+                                         m_numNodesVisited(0)
+{
+    Start(branchIndexOffset);
+}
+
+
+/**
+\internal
+\brief Constructor for a swept box query.
+
+The line is padded by a different amount on each axis, so that the query visits every leaf touched by an
+axis aligned box with half extents \a padding swept from \a start to \a end.
+
+\param kdtree            The KDTree spatial map to query against.
+\param start             Start point of the line.
+\param end               End point of the line.
+\param padding           Per axis padding of the line, the half extents of the swept box.
+\param fatness           Additional padding applied equally on all axes.
+\param branchIndexOffset Start offset into branchnode array.
+\param defaultEntry      Entry returned when the tree has no branch nodes.
+*/
+RW_COLLISION_FORCE_INLINE 
+KDTreeLineQueryBase::KDTreeLineQueryBase(const KDTreeBase *kdtree,
+                                         rwpmath::Vector3::InParam start,
+                                         rwpmath::Vector3::InParam end,
+                                         rwpmath::Vector3::InParam padding,
+                                         const float fatness,
+                                         const uint32_t branchIndexOffset,
+                                         const uint32_t defaultEntry)
+                                         :   m_kdtree(kdtree),
+                                         m_lineClipper(start, end, padding + rwpmath::Vector3(fatness, fatness, fatness), kdtree->m_bbox),
+                                         m_branchIndexOffset(branchIndexOffset),
+                                         m_leafCount(0),
+                                         m_nextEntry(defaultEntry),
+                                         m_numNodesVisited(0)
+{
+    Start(branchIndexOffset);
+}
+
+
+/**
+\internal
+Clips the line to the extent of the KDTree and pushes the root node.
+
+\param branchIndexOffset Start offset into branchnode array.
+*/
+RW_COLLISION_FORCE_INLINE void
+KDTreeLineQueryBase::Start(const uint32_t branchIndexOffset)
 {
     m_stack[0].m_pa = 0.0f;
     m_stack[0].m_pb = 1.0f;
@@ -103,7 +169,7 @@ KDTreeLineQueryBase::KDTreeLineQueryBase(const KDTreeBase *kdtree,
         // Line does not overlap extent of KDTree.
         m_top = 0;
     }
-    else if (kdtree->m_numBranchNodes > 0)
+    else if (m_kdtree->m_numBranchNodes > 0)
     {
         // Start at root
         m_stack[0].m_nodeRef.m_content = rwcKDTREE_BRANCH_NODE;
@@ -113,10 +179,23 @@ KDTreeLineQueryBase::KDTreeLineQueryBase(const KDTreeBase *kdtree,
     else
     {
         // Consider tree as single leaf
-        m_leafCount = kdtree->m_numEntries;
+        m_leafCount = m_kdtree->m_numEntries;
         m_top = 0;
     }
+}
+
 
+RW_COLLISION_FORCE_INLINE uint32_t
+KDTreeLineQueryBase::GetNumNodesVisited() const
+{
+    return m_numNodesVisited;
+}
+
+
+RW_COLLISION_FORCE_INLINE void
+KDTreeLineQueryBase::ResetNumNodesVisited()
+{
+    m_numNodesVisited = 0;
 }
 
 
@@ -131,6 +210,8 @@ tests the two children nodes and if the line intersects either, they are push on
 RW_COLLISION_FORCE_INLINE void
 KDTreeLineQueryBase::ProcessBranchNode()
 {
+    rwcQUERYSTATS(++m_numNodesVisited);
+
 #if defined(RWC_KDTREELINEQUERYBASE_OPT) && (defined(EA_PLATFORM_XENON) || defined(EA_PLATFORM_PS3) || defined(EA_PLATFORM_PS3_SPU))
 
     const StackElement& cur = m_stack[--m_top];
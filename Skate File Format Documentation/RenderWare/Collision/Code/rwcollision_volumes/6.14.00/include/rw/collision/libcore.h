@@ -24,6 +24,8 @@ including
 #include "rw/collision/aabbox.h"
 #include "rw/collision/aalineclipper.h"
 #include "rw/collision/kdtree.h"
+#include "rw/collision/kdtreedistancequery.h"
+#include "rw/collision/compactkdtree.h"
 #include "rw/collision/volumedata.h"
 #include "rw/collision/volume.h"
 #include "rw/collision/plane.h"
@@ -43,15 +45,19 @@ including
 #include "rw/collision/metrics.h"
 #include "rw/collision/simplemappedarray.h"
 #include "rw/collision/volumevolumequery.h"
+#include "rw/collision/querycontext.h"
 #include "rw/collision/triangle.h"
 #include "rw/collision/box.h"
 #include "rw/collision/aggregatevolume.h"
 #include "rw/collision/procedural.h"
 #include "rw/collision/triangleclusterprocedural.h"
 #include "rw/collision/trianglekdtreeprocedural.h"
+#include "rw/collision/heightfieldprocedural.h"
 #include "rw/collision/clusteredmesh.h"
 #include "rw/collision/scaledclusteredmesh.h"
 #include "rw/collision/trianglequery.h"
+#include "rw/collision/shapecast.h"
+#include "rw/collision/distancequery.h"
 #include "rw/collision/initialize.h"
 
 #else // defined(EA_PLATFORM_PS3_SPU)
@@ -77,7 +77,8 @@ private:
     \param cluster destination cluster.
     \param vertexIDs collection of vertex IDs.
     \param vertices collection of vertices.
-    \param clusterOffset the offset of the clusters vertices, used by clusters with 16bit vertex compression.
+    \param clusterOffset the offset of the clusters vertices, used by clusters with 16bit, 10bit and 8bit vertex compression.
+    \param granularityShift the granularity shift of the clusters vertices, used by clusters with 10bit and 8bit vertex compression.
     \param vertexCompressionGranularity vertex compression granularity.
     */
     static void WriteVertexDataToCluster(
@@ -86,6 +87,7 @@ private:
         const uint32_t vertexCount,
         const VertexList & vertices,
         const rw::collision::ClusteredMeshCluster::Vertex32 & clusterOffset,
+        const uint32_t granularityShift,
         const rwpmath::VecFloat & vertexCompressionGranularity);
 
     /**
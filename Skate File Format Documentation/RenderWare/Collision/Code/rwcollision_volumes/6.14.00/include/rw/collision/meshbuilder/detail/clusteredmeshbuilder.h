@@ -22,6 +22,7 @@
 #include <rw/collision/meshbuilder/detail/unitclusterstack.h>
 #include <rw/collision/meshbuilder/detail/iallocator.h>
 #include <rw/collision/meshbuilder/detail/generalallocator.h>
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
 
 
 namespace rw
@@ -33,6 +34,8 @@ namespace meshbuilder
 namespace detail
 {
 
+class VertexTriangleMap;
+
 /**
 \class ClusteredMeshBuilder
 
@@ -174,6 +177,8 @@ public:
         Parameters()
             : vertexCompression_Enable(false)
             , vertexCompression_Granularity(0.001f)
+            , vertexCompression_Adaptive(false)
+            , vertexCompression_MaxError(0.0f)
             , oldTriangles_Enable(false)
             , edgeAngles_Enable(true)
             , quads_Enable(false)
@@ -192,6 +197,10 @@ public:
             , internalTriangleRemoval_Enabled(false)
             , edgeCosineCorrection_Enabled(false)
             , vertexSmoothing_Enabled(false)
+            , parallelDispatcher(NULL)
+            , parallelDispatcher_WorkerArenaSize(0)
+            , incrementalUpdate_Enable(false)
+            , unitOrdering_Enable(false)
         {
         }
 
@@ -199,6 +208,17 @@ public:
         bool    vertexCompression_Enable;
         /// Specifies the requested vertex compression granularity.
         float vertexCompression_Granularity;
+        /**
+        \brief Allows clusters with a small enough extent to compress their vertices to 8 or 10 bits per component.
+        Meshes with such clusters can only be read by runtimes supporting ClusteredMesh version 7 and later.
+        */
+        bool    vertexCompression_Adaptive;
+        /**
+        \brief The additional error allowed in each vertex component when adaptive vertex compression rounds a cluster
+        to a coarser granularity. Zero keeps the vertices exact to vertexCompression_Granularity. Vertices shared by
+        clusters of different granularities may differ by up to this distance, leaving small cracks between them.
+        */
+        float vertexCompression_MaxError;
         /// Determines whether or not the ClusteredMesh will consist of "old triangles".
         bool    oldTriangles_Enable;
         /// Determines whether or not edge cosine data will be encoded in the ClusteredMesh.
@@ -250,6 +270,101 @@ public:
         bool    edgeCosineCorrection_Enabled;
         /// Enables/Disables vertex smoothing
         bool    vertexSmoothing_Enabled;
+        /**
+        \brief Optional dispatcher used to run the data parallel build stages across worker threads.
+        NULL builds every stage on the calling thread. The built mesh does not depend on the dispatcher.
+        */
+        IParallelDispatcher *parallelDispatcher;
+        /**
+        \brief The size in bytes of the scratch arena given to each worker of the parallelDispatcher, taken
+        from the builder temporary heap. Zero shares half of the free builder memory between the workers.
+        */
+        uint32_t parallelDispatcher_WorkerArenaSize;
+        /**
+        \brief Keeps the triangle adjacency, units and unit clusters after the build, so that the mesh can later
+        be patched with UpdateClusteredMesh. The data is freed by Release or the next build. It is not kept when
+        the build uses merge planes, edge cosine correction, vertex smoothing or internal triangle removal.
+        */
+        bool incrementalUpdate_Enable;
+        /**
+        \brief Reorders the units within each KDTree leaf of a cluster along a Morton curve, and numbers the
+        cluster vertices in the order the units use them, so that the units of a leaf use a small range of
+        the cluster vertices. The KDTree and the units in each leaf are unchanged.
+        */
+        bool unitOrdering_Enable;
+    };
+
+    /// Version of the build process. It must be increased whenever the same input and parameters would build a different ClusteredMesh.
+    enum
+    {
+        BUILDER_VERSION = 1
+    };
+
+    /**
+    \brief The stages of the build process, for which the peak use of the builder allocator is reported.
+    */
+    enum BuildStage
+    {
+        /// Construction of the builder, with the input vertex and triangle containers.
+        BUILDSTAGE_INPUT = 0,
+        /// Vertex merging.
+        BUILDSTAGE_VERTEXMERGE,
+        /// Triangle validation and the search for neighboring triangles.
+        BUILDSTAGE_ADJACENCY,
+        /// Unmatched edge correction, edge code generation and vertex smoothing.
+        BUILDSTAGE_EDGECODES,
+        /// Construction of the units and their bounding boxes.
+        BUILDSTAGE_UNITS,
+        /// Construction of the KDTree of the units.
+        BUILDSTAGE_KDTREE,
+        /// Grouping of the units into clusters.
+        BUILDSTAGE_CLUSTERS,
+        /// Writing of the clusters and KDSubTrees of the ClusteredMesh.
+        BUILDSTAGE_CLUSTEREDMESH,
+        /// Number of build stages.
+        BUILDSTAGE_COUNT
+    };
+
+    /**
+    \struct MemoryReport
+    \brief The peak use of the builder allocator, over both heaps, during each stage of the build process.
+
+    Each peak excludes the memory in use before the builder was constructed, but includes the memory held
+    from earlier stages, so the largest peak is the builder memory needed by the whole build. Only allocators
+    which track their peak use, such as the LinearAllocator, report non-zero peaks.
+    */
+    struct MemoryReport
+    {
+        /**
+        \brief Constructor
+        Initializes all peaks to zero.
+        */
+        MemoryReport()
+        {
+            for (uint32_t stage = 0; stage < BUILDSTAGE_COUNT; ++stage)
+            {
+                stagePeaks[stage] = 0;
+            }
+        }
+
+        /**
+        \brief Returns the largest peak over all stages.
+        */
+        uint32_t GetPeak() const
+        {
+            uint32_t peak = 0;
+            for (uint32_t stage = 0; stage < BUILDSTAGE_COUNT; ++stage)
+            {
+                if (stagePeaks[stage] > peak)
+                {
+                    peak = stagePeaks[stage];
+                }
+            }
+            return peak;
+        }
+
+        /// Peak memory use in bytes of each BuildStage.
+        uint32_t stagePeaks[BUILDSTAGE_COUNT];
     };
 
     // Constructor
@@ -296,6 +411,12 @@ public:
         const rwpmath::VecFloat *const mergePlaneDistances,
         IAllocator *const clusteredMeshAllocator);
 
+    bool UpdateClusteredMesh(
+        rw::collision::ClusteredMesh &clusteredMesh,
+        const Parameters &buildParams,
+        const uint32_t *const changedTriangles,
+        const uint32_t numChangedTriangles);
+
     void SetTriangle(
         uint32_t i,
         uint32_t v0,
@@ -310,16 +431,20 @@ public:
 
     void SetEdgeCosConcaveAngleTolerance(float edgecosAngle);
 
+    void SetFirstBorderTriangle(uint32_t triangleIndex);
+
     void SetClusterOptions(
         const bool vertexCompression_Enable,
         const float vertexCompression_Granularity,
         const uint16_t flagsDefault,
         const uint8_t groupId_NumBytes,
-        const uint8_t surfaceId_NumBytes);
+        const uint8_t surfaceId_NumBytes,
+        const bool vertexCompression_Adaptive = false,
+        const float vertexCompression_MaxError = 0.0f);
 
     void AdjustVertexMergeDistanceToleranceUsingEdgeScale();
 
-    void MergeVertexGroups(bool mergeVertices = true);
+    void MergeVertexGroups(bool mergeVertices = true, IParallelDispatcher *dispatcher = NULL);
 
     bool FixUnmatchedEdges(const uint32_t maxInputLimit);
 
@@ -330,13 +455,16 @@ public:
     float CalculateMinimumGranularityForCluster(
         const UnitCluster & unitCluster) const;
 
+    float GetAdaptiveCompressionError() const;
+
     uint32_t BuildUnitList(
         bool findQuads);
 
     AABBoxType * GetAllUnitBBoxes() const;
 
     uint32_t CreateClustersUsingKDTree(
-        rw::collision::KDTreeBuilder& kdtreeBuilder);
+        rw::collision::KDTreeBuilder& kdtreeBuilder,
+        const bool unitOrdering_Enable);
 
     void InitializeCluster(
         rw::collision::ClusteredMeshCluster *cluster,
@@ -357,8 +485,115 @@ public:
 
     bool IsBuilderValid();
 
+    void GetMemoryReport(MemoryReport &report) const;
+
+    static uint32_t GetMemoryRequirements(
+        MemoryReport &requirements,
+        const uint32_t numTri,
+        const uint32_t numVert,
+        const Parameters &buildParams);
+
 protected:
 
+    void BeginBuildStage(const BuildStage stage);
+
+    void EndBuildStage();
+
+    uint32_t GetBuildStageMemoryUsed() const;
+
+    bool FindTriangleNeighborsParallel(
+        const Parameters & buildParams,
+        const VertexTriangleMap & vertexTriangleMap);
+
+    // Incremental update
+
+    bool InitializeIncrementalUpdateData(
+        const rw::collision::ClusteredMesh &clusteredMesh);
+
+    void GetKDTreeLeafBBox(
+        rw::collision::AABBox &bbox,
+        const rw::collision::KDTreeBase::NodeRef &leafRef) const;
+
+    void GetKDTreeChildBBox(
+        rw::collision::AABBox &bbox,
+        const rw::collision::KDTreeBase::NodeRef &childRef) const;
+
+    void RefitKDTreeBranchExtents(
+        rw::collision::KDTreeBase &kdtree,
+        const uint32_t leaf);
+
+    void ReleaseIncrementalUpdateData();
+
+    bool CanUpdateClusteredMesh(
+        const rw::collision::ClusteredMesh &clusteredMesh) const;
+
+    uint32_t FindUnitPosition(
+        const uint32_t entry) const;
+
+    uint32_t GetUnitAtPosition(
+        const uint32_t position) const;
+
+    uint32_t FindUnitLeaf(
+        const rw::collision::ClusteredMesh &clusteredMesh,
+        const uint32_t unitID) const;
+
+    uint32_t FindUnitLeafInRange(
+        const rw::collision::KDTreeBase &kdtree,
+        const uint32_t position,
+        const uint32_t firstNode,
+        const uint32_t endNode) const;
+
+    bool GatherUnitTriangles(
+        IDList *&triangles,
+        const rw::collision::ClusteredMesh &clusteredMesh,
+        const rw::collision::AABBox &bbox,
+        const IDList *const includedTriangles = NULL);
+
+    bool SortChangedTriangles(
+        IDList *&changed,
+        const uint32_t *const changedTriangles,
+        const uint32_t numChangedTriangles);
+
+    bool WeldChangedTriangleVertices(
+        const rw::collision::ClusteredMesh &clusteredMesh,
+        const IDList &changed,
+        const bool mergeVertices);
+
+    bool ValidateChangedTriangles(
+        const IDList &changed);
+
+    bool FindHaloTriangles(
+        IDList *&halo,
+        const rw::collision::ClusteredMesh &clusteredMesh,
+        const IDList &changed);
+
+    bool UpdateHaloTriangleAdjacency(
+        const rw::collision::ClusteredMesh &clusteredMesh,
+        const IDList &halo);
+
+    bool UpdateHaloTriangleEdgeCodes(
+        IDList *&dirtyClusters,
+        const IDList &halo,
+        const IDList &changed);
+
+    bool PrepareUpdatedClusters(
+        UnitCluster *&updatedClusters,
+        const rw::collision::ClusteredMesh &clusteredMesh,
+        const IDList &dirtyClusters);
+
+    bool FindChangedUnitLeaves(
+        IDList *&changedUnits,
+        IDList *&unitLeaves,
+        const rw::collision::ClusteredMesh &clusteredMesh,
+        const IDList &changed);
+
+    void ApplyClusteredMeshUpdate(
+        rw::collision::ClusteredMesh &clusteredMesh,
+        const IDList &dirtyClusters,
+        const UnitCluster *const updatedClusters,
+        const IDList &changedUnits,
+        const IDList &unitLeaves);
+
     // Accessors
 
     uint32_t GetTriangleCount();
@@ -417,6 +652,8 @@ protected:
     evaluated during the triangle data building step.
     */
     uint32_t                m_numTriangles;
+    /// Index of the first border triangle. See SetFirstBorderTriangle.
+    uint32_t                m_firstBorderTriangle;
     /// Vertex collection AABBox
     AABBoxType              m_vertAABBox;
     /// Tolerance distance used to determine when two vertices should be merged during vertex merging.
@@ -441,9 +678,39 @@ protected:
     UnitParameters          m_unitParameters;
     /// The vertex compression granularity, used during compression
     float                   m_vertexCompressionGranularity;
+    /// Flag to determine whether or not clusters may use 8-bit and 10-bit vertex compression.
+    bool                    m_adaptiveCompression;
+    /// The largest granularity shift allowed to 8-bit and 10-bit compressed clusters, from vertexCompression_MaxError.
+    uint32_t                m_maxGranularityShift;
     /// Builder Validity flag. Used to determine whether or not the builder is in a valid state.
     bool                    m_isBuilderValid;
 
+    // Incremental update data, kept after a build with Parameters::incrementalUpdate_Enable.
+
+    /// Index of the unit of each triangle, or CLUSTEREDMESHBUILDER_NOUNIT if the triangle is in no unit.
+    IDList                  *m_triangleUnits;
+    /// KDTree entry of each unit, the cluster ID shifted by m_unitClusterIDShift plus the unit offset.
+    IDList                  *m_unitEntries;
+    /// Position of the first unit of each cluster in the sequence of units of all clusters, then the unit count.
+    IDList                  *m_clusterFirstUnits;
+    /// UnitCluster of each cluster, indexed by cluster ID.
+    UnitCluster             **m_unitClusters;
+    /// Shift of the cluster ID in the KDTree entries.
+    uint32_t                m_unitClusterIDShift;
+    /// Bounds of the left then the right child of each KDTree branch node, refitted by each update.
+    rw::collision::AABBox   *m_kdTreeChildBBoxes;
+    /// Flag indicating that the adjacency data, unit list and unit clusters have been kept after the build.
+    bool                    m_incrementalUpdateDataRetained;
+
+    // Memory use tracking.
+
+    /// Peak memory use of each build stage completed.
+    MemoryReport            m_memoryReport;
+    /// The current build stage, or BUILDSTAGE_COUNT between stages.
+    BuildStage              m_buildStage;
+    /// Memory in use by the allocator when the builder was constructed.
+    uint32_t                m_memoryBaseline;
+
     /// Main allocator. Used to deal with long term memory allocation.
     IAllocator *m_allocator;
 };
@@ -17,6 +17,7 @@
 #include <rw/collision/meshbuilder/detail/containers.h>
 #include <rw/collision/meshbuilder/detail/unitcluster.h>
 #include <rw/collision/meshbuilder/detail/vertextrianglemap.h>
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
 
 
 namespace rw
@@ -87,7 +88,15 @@ public:
     static uint32_t ValidateTriangles(
         TriangleFlagsList & triangleFlags,
         const TriangleList & triangles,
-        const VertexList & vertices);
+        const VertexList & vertices,
+        IParallelDispatcher * dispatcher = NULL);
+
+    static uint32_t ValidateTriangles(
+        TriangleFlagsList & triangleFlags,
+        const TriangleList & triangles,
+        const VertexList & vertices,
+        const uint32_t begin,
+        const uint32_t end);
 
     static void DisableInternalTriangles(
         TriangleFlagsList & triangleFlags,
@@ -147,7 +156,8 @@ public:
         AABBoxType * const unitAABBoxList,
         const UnitList & unitList,
         const TriangleList & triangles,
-        const VertexList & vertices);
+        const VertexList & vertices,
+        const float padding = 0.0f);
 
     static void InitializeUnitClustersUsingKDTree(
         LeafMap & leafMap,
@@ -189,6 +199,13 @@ public:
         const uint32_t unitClusterID,
         const uint32_t unitClusterIDShift);
 
+    static void OrderUnitsInCluster(
+        UnitCluster & unitCluster,
+        const LeafMap & leafMap,
+        const TriangleList & triangles,
+        const UnitList & unitList,
+        const VertexList & vertices);
+
 private:
 
     static void FindQuadVertex(
@@ -117,6 +117,8 @@ public:
 	// Static methods
 	static uint32_t MaxNumInputs( const uint32_t memoryBufferSize, const uint32_t gridResolution );
 
+	static uint32_t GetMemoryRequirements( const uint32_t numInputs, const uint32_t gridResolution );
+
 	/// \param minPoint The minimum coordinates of the axis-aligned bounding box of the contained data
 	/// \param maxPoint The maximum coordinates of the axis-aligned bounding box of the contained data
 	/// \param resolution The number of boxes on each side of the 3D grid
@@ -258,6 +260,14 @@ inline uint32_t GridSpatialMap::MaxNumInputs(
 	return remainingMemory / sizeof(BoxEntry);
 }
 
+inline uint32_t GridSpatialMap::GetMemoryRequirements(
+	const uint32_t numInputs,
+	const uint32_t gridResolution)
+{
+	// The space required for the boxes given the resolution, and for the entries
+	return static_cast<uint32_t>(GetBoxCount(gridResolution) * sizeof(Box) + numInputs * sizeof(BoxEntry));
+}
+
 inline bool GridSpatialMap::Initialize(
 	const VectorType &minPoint,
 	const VectorType &maxPoint,
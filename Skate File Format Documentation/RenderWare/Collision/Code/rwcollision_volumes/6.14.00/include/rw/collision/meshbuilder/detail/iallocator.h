@@ -77,6 +77,23 @@ public:
     which is generally not known at the time of this call.
     */
     virtual uint32_t LargestAllocatableSize(const unsigned int flags, const uint32_t alignment = 4) const = 0;
+
+    /**
+    Starts tracking the peak memory usage afresh, from the current usage.
+    \note Allocators which do not track their memory usage can ignore this.
+    */
+    virtual void ResetTrackedPeakMemoryUsed()
+    {
+    }
+
+    /**
+    Returns the maximum total memory usage seen since the last call to \ref ResetTrackedPeakMemoryUsed,
+    or zero if the allocator does not track its memory usage.
+    */
+    virtual uint32_t GetTrackedPeakMemoryUsed() const
+    {
+        return 0;
+    }
 };
 
 
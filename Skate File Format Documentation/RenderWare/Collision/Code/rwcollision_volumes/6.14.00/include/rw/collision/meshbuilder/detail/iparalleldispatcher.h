@@ -0,0 +1,120 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#ifndef PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_IPARALLELDISPATCHER_H
+#define PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_IPARALLELDISPATCHER_H
+
+
+#include <rw/collision/common.h>
+
+
+#if !defined EA_PLATFORM_PS3_SPU
+
+
+namespace rw
+{
+namespace collision
+{
+namespace meshbuilder
+{
+namespace detail
+{
+
+
+/**
+Interface used by the ClusteredMeshBuilder to run data parallel build stages across worker threads.
+
+The builder has no threading dependency of its own. A client wishing to build in parallel implements
+this interface over its own job system or thread pool and passes it to the builder in the build parameters.
+
+The work of each stage is split into a fixed partition of ranges which depends only on the item count
+and the grain size, never on the number of workers or the timing of the threads. Each range only writes
+data owned by the items in that range, so the build output is identical whichever worker runs each range.
+*/
+class IParallelDispatcher
+{
+
+public:
+
+    /**
+    Function called for each range of a parallel stage.
+
+    \param context The context pointer passed to ParallelFor.
+    \param workerIndex Index of the calling worker, less than GetNumWorkers().
+    \param begin Index of the first item in the range.
+    \param end Index one past the last item in the range.
+    */
+    typedef void (*RangeFunction)(void *context, uint32_t workerIndex, uint32_t begin, uint32_t end);
+
+    /**
+    Default constructor.
+    */
+    IParallelDispatcher()
+    {
+    }
+
+    /**
+    Destructor
+    */
+    virtual ~IParallelDispatcher()
+    {
+    }
+
+    /**
+    Returns the number of workers which may call range functions concurrently.
+    */
+    virtual uint32_t GetNumWorkers() const = 0;
+
+    /**
+    Calls the function once for each range [begin, end) of the partition of [0, count) into consecutive
+    ranges of grainSize items, the last of which may be shorter, and returns once every call has completed.
+
+    Calls may be made concurrently and in any order, but two concurrent calls never share a worker index,
+    so per worker scratch data indexed by the worker index needs no locking.
+    */
+    virtual void ParallelFor(RangeFunction function, void *context, uint32_t count, uint32_t grainSize) = 0;
+
+    /**
+    Runs a parallel stage on the given dispatcher, or serially on the calling thread, as worker zero and
+    in range order, if no dispatcher is given.
+    */
+    static void Run(IParallelDispatcher *const dispatcher,
+                    RangeFunction function,
+                    void *context,
+                    const uint32_t count,
+                    const uint32_t grainSize)
+    {
+        EA_ASSERT(grainSize > 0);
+
+        if (dispatcher && dispatcher->GetNumWorkers() > 1)
+        {
+            dispatcher->ParallelFor(function, context, count, grainSize);
+            return;
+        }
+
+        for (uint32_t begin = 0; begin < count; begin += grainSize)
+        {
+            const uint32_t end = (count - begin > grainSize) ? (begin + grainSize) : count;
+            function(context, 0, begin, end);
+        }
+    }
+
+    /**
+    Returns the number of ranges in the partition of count items into ranges of grainSize items.
+    */
+    static uint32_t GetNumRanges(const uint32_t count, const uint32_t grainSize)
+    {
+        EA_ASSERT(grainSize > 0);
+        return (count + grainSize - 1) / grainSize;
+    }
+};
+
+
+} // namespace detail
+} // namespace meshbuilder
+} // namespace collision
+} // namespace rw
+
+
+#endif // !defined EA_PLATFORM_PS3_SPU
+
+#endif // defined PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_IPARALLELDISPATCHER_H
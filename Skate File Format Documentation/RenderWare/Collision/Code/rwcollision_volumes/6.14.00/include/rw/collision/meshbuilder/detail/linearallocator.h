@@ -93,7 +93,8 @@ public:
       m_highMark(0),
       m_lowPeak(0),
       m_highPeak(0),
-      m_minFree(0)
+      m_minFree(0),
+      m_trackedMinFree(0)
     {
     }
 
@@ -110,7 +111,8 @@ public:
       m_highMark(0),
       m_lowPeak(m_lowPosition),
       m_highPeak(m_highPosition),
-      m_minFree(static_cast<uint32_t>(m_highPosition - m_lowPosition))
+      m_minFree(static_cast<uint32_t>(m_highPosition - m_lowPosition)),
+      m_trackedMinFree(m_minFree)
     {
     }
 
@@ -128,6 +130,7 @@ public:
         m_lowPeak = 0;
         m_highPeak = 0;
         m_minFree = 0;
+        m_trackedMinFree = 0;
     }
 
     //
@@ -262,6 +265,24 @@ public:
         return static_cast<uint32_t>(m_highPosition - allocation);
     }
 
+    /**
+    Starts tracking the peak memory usage afresh, from the current usage.
+    */
+    virtual void ResetTrackedPeakMemoryUsed()
+    {
+        m_trackedMinFree = static_cast<uint32_t>(m_highPosition - m_lowPosition);
+    }
+
+    /**
+    Returns the maximum total memory usage seen since the last call to \ref ResetTrackedPeakMemoryUsed, for both heaps.
+    \note The peak memory usage may include memory used internally for alignment padding and allocation tracking.
+    */
+    virtual uint32_t GetTrackedPeakMemoryUsed() const
+    {
+        const uint32_t blockSize(static_cast<uint32_t>(m_end - m_start));
+        return blockSize - m_trackedMinFree;
+    }
+
     //
     // ICoreAllocator implementation
     //
@@ -341,6 +362,10 @@ public:
         {
             m_minFree = freeSize;
         }
+        if (freeSize < m_trackedMinFree)
+        {
+            m_trackedMinFree = freeSize;
+        }
 
 #ifdef EA_DEBUG
         // Clear the allocated block to known marker values.
@@ -422,6 +447,14 @@ public:
         return peakUsedSize;
     }
 
+    /**
+    Returns the memory used by each call to \ref Mark, on the heap indicated by its flags.
+    */
+    static uint32_t GetMarkSize()
+    {
+        return static_cast<uint32_t>(sizeof(MarkRecord));
+    }
+
 private:
 
     /**
@@ -472,6 +505,7 @@ private:
     uint8_t *m_lowPeak;
     uint8_t *m_highPeak;
     uint32_t m_minFree;
+    uint32_t m_trackedMinFree;
 };
 
 
@@ -0,0 +1,104 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#ifndef PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_RADIXSORT_H
+#define PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_RADIXSORT_H
+
+
+#include <rw/collision/common.h>
+
+
+#if !defined EA_PLATFORM_PS3_SPU
+
+#include <string.h> // For memcpy
+
+
+namespace rw
+{
+namespace collision
+{
+namespace meshbuilder
+{
+namespace detail
+{
+
+
+/**
+Static helper class implementing a stable least significant digit radix sort on 32 bit keys.
+
+Keys are extracted from the items by a functor, so items may be sorted on several keys by sorting
+on the least significant key first; since each sort is stable the order of earlier sorts is
+preserved between items with equal later keys.
+*/
+class RadixSort
+{
+
+public:
+
+    /**
+    \brief Sorts an array of items on the 32 bit key returned by the given functor.
+
+    The sort makes one pass per byte of the key, skipping bytes which are the same for all items.
+
+    \param items Array of items to sort. Holds the sorted items on return.
+    \param scratch Array of at least count items used during the sort.
+    \param count Number of items.
+    \param key Functor returning the uint32_t key of an item.
+    */
+    template <typename ItemType, typename KeyFunction>
+    static void Sort(ItemType *items, ItemType *scratch, const uint32_t count, const KeyFunction &key)
+    {
+        ItemType *source = items;
+        ItemType *destination = scratch;
+
+        for (uint32_t shift = 0; shift < 32; shift += 8)
+        {
+            uint32_t histogram[256];
+            memset(histogram, 0, sizeof(histogram));
+
+            for (uint32_t itemIndex = 0; itemIndex < count; ++itemIndex)
+            {
+                ++histogram[(key(source[itemIndex]) >> shift) & 0xff];
+            }
+
+            // Skip the pass if every item has the same digit
+            if (count == 0 || histogram[(key(source[0]) >> shift) & 0xff] == count)
+            {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (uint32_t digit = 0; digit < 256; ++digit)
+            {
+                const uint32_t digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+
+            for (uint32_t itemIndex = 0; itemIndex < count; ++itemIndex)
+            {
+                const ItemType &item = source[itemIndex];
+                destination[histogram[(key(item) >> shift) & 0xff]++] = item;
+            }
+
+            ItemType *const swap = source;
+            source = destination;
+            destination = swap;
+        }
+
+        if (source != items)
+        {
+            memcpy(items, source, count * sizeof(ItemType));
+        }
+    }
+};
+
+
+} // namespace detail
+} // namespace meshbuilder
+} // namespace collision
+} // namespace rw
+
+
+#endif // !defined EA_PLATFORM_PS3_SPU
+
+#endif // defined PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_RADIXSORT_H
@@ -16,6 +16,9 @@
 #include <rw/collision/meshbuilder/detail/containers.h>
 #include <rw/collision/meshbuilder/detail/vertextrianglemap.h>
 #include <rw/collision/meshbuilder/detail/trianglenormal.h>
+#include <rw/collision/meshbuilder/detail/iallocator.h>
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
+#include <rw/collision/meshbuilder/detail/workerallocators.h>
 
 
 namespace rw
@@ -41,6 +44,23 @@ public:
     typedef detail::TriangleFlagsList TriangleFlagsList;
     typedef detail::TriangleNeighborsList TriangleNeighborsList;
 
+    /**
+    \brief A matching pair of edges found between two triangles, and the extended edge cosine between them.
+    */
+    struct EdgeMate
+    {
+        /// Index of the first triangle.
+        uint32_t triangle1Index;
+        /// Index of the second triangle.
+        uint32_t triangle2Index;
+        /// Index of the matching edge of the first triangle.
+        uint32_t edge1Index;
+        /// Index of the matching edge of the second triangle.
+        uint32_t edge2Index;
+        /// Extended edge cosine of the shared edge.
+        float edgeCosine;
+    };
+
     /**
     \brief Initializes triangle edge cosine data.
 
@@ -85,30 +105,131 @@ public:
         const VertexList & vertices,
         const detail::VertexTriangleMap & vertexTriangleMap);
 
-private:
+    /**
+    \brief Builds triangle neighboring connectivity information by sorting the triangle edges.
+
+    Each edge of each enabled triangle is recorded against its pair of vertex indices and the records
+    are radix sorted so that coincident edges are adjacent. Each triangle normal is computed once. A match
+    only changes the edges of its own run of coincident edges, so the runs are mated independently, each
+    in the same order as FindTriangleNeighbors. This gives the same result without visiting every pair of
+    triangles around each vertex, a cost which grows with the square of the vertex valence. The only
+    exception is a pair of triangles over the same three vertices, where a replaced match is unmatched
+    on the edge of the run rather than on the first edge of the replaced triangle with that neighbor.
+
+    \param triangles collection of triangles
+    \param triangleEdgeCosines collection of triangle edge cosines
+    \param triangleNeighbors collection of triangle neighbors
+    \param triangleFlags collection of triangle flags
+    \param vertices collection of vertices
+    \param allocator allocator used for the temporary edge records and normals, with MEM_TEMP
+    \param dispatcher optional dispatcher used to record the edges and normals, and to mate the runs, in parallel
+
+    \return false if the temporary data could not be allocated, in which case the neighbor data is unchanged.
+    */
+    static bool FindTriangleNeighborsByEdgeSort(
+        const TriangleList & triangles,
+        TriangleEdgeCosinesList & triangleEdgeCosines,
+        TriangleNeighborsList & triangleNeighbors,
+        const TriangleFlagsList & triangleFlags,
+        const VertexList & vertices,
+        EA::Allocator::ICoreAllocator * allocator,
+        IParallelDispatcher * dispatcher = NULL);
 
     /**
-    \brief Attempt to mate two triangles along a given edge.
+    \brief Returns the size of the temporary memory allocated by FindTriangleNeighborsByEdgeSort, with MEM_TEMP.
 
-    Mate edge (edgeAIndex) on triangle (triangleAIndex) with any edge on triangle (triangleBIndex)
+    The size allows for the alignment of the triangle normals, from a position aligned to four bytes.
+
+    \param numTriangles number of triangles
+
+    \return The size in bytes of the temporary memory.
+    */
+    static uint32_t GetEdgeSortWorkspaceSize(
+        const uint32_t numTriangles);
+
+    /**
+    \brief Returns the size of the temporary memory allocated by the parallel FindTriangleNeighbors from its
+    allocator, with MEM_TEMP, excluding the worker arenas.
+
+    \param numTriangles number of triangles
+
+    \return The size in bytes of the temporary memory.
+    */
+    static uint32_t GetParallelWorkspaceSize(
+        const uint32_t numTriangles);
+
+    /**
+    \brief Returns a worker arena size with which the parallel FindTriangleNeighbors does not run out of memory,
+    whichever worker runs each range, when each edge is shared by at most two triangles.
+
+    \param numTriangles number of triangles
+
+    \return The size in bytes of each worker arena.
+    */
+    static uint32_t GetParallelWorkerArenaSize(
+        const uint32_t numTriangles);
+
+    /**
+    \brief Builds triangle neighboring connectivity information using a parallel dispatcher.
+
+    The search for matching edges, which includes the computation of the edge cosines, is split into
+    ranges of triangles run by the dispatcher. The matches found by each range are kept in the arena of
+    the worker which ran it, and are then applied serially in triangle order, which gives exactly the
+    same result as FindTriangleNeighbors.
 
     \param triangles collection of triangles
     \param triangleEdgeCodes collection of triangle edge cosine codes
+    \param triangleFlags collection of triangle flags
     \param vertices collection of vertices
-    \param edgeAIndex The edge number 0,1,2 on i1
-    \param triangleAIndex A triangle index
-    \param triangleBIndex A triangle index
+    \param vertexTriangleMap map from vertex indices to triangle indices
+    \param dispatcher dispatcher used to run the edge search
+    \param workerAllocators scratch arenas of the dispatcher workers
+    \param allocator allocator used for the temporary per range match lists
 
-    \return True if mate found, false otherwise.
+    \return false if a worker ran out of memory, in which case the neighbor data is unchanged.
     */
-    static bool MateEdge(
+    static bool FindTriangleNeighbors(
         const TriangleList & triangles,
         TriangleEdgeCosinesList & triangleEdgeCosines,
         TriangleNeighborsList & triangleNeighbors,
+        const TriangleFlagsList & triangleFlags,
+        const VertexList & vertices,
+        const detail::VertexTriangleMap & vertexTriangleMap,
+        IParallelDispatcher * dispatcher,
+        WorkerAllocators & workerAllocators,
+        IAllocator * allocator);
+
+    /**
+    \brief Finds the edge of a second triangle which matches a given edge of a first triangle.
+
+    \param triangles collection of triangles
+    \param vertices collection of vertices
+    \param edge1Index The edge number 0,1,2 on triangle1Index
+    \param triangle1Index A triangle index
+    \param triangle2Index A triangle index
+    \param mate The match, if found
+
+    \return True if mate found, false otherwise.
+    */
+    static bool FindEdgeMate(
+        const TriangleList & triangles,
         const VertexList & vertices,
         const uint32_t edge1Index,
         const uint32_t triangle1Index,
-        const uint32_t triangle2Index);
+        const uint32_t triangle2Index,
+        EdgeMate & mate);
+
+    /**
+    \brief Applies an edge match to the neighbor data, replacing any existing match which is more convex.
+
+    \param triangleEdgeCosines collection of triangle edge cosines
+    \param triangleNeighbors collection of triangle neighbors
+    \param mate The match found by FindEdgeMate
+    */
+    static void ApplyEdgeMate(
+        TriangleEdgeCosinesList & triangleEdgeCosines,
+        TriangleNeighborsList & triangleNeighbors,
+        const EdgeMate & mate);
 
     /**
     \brief Finds an edge index given a two triangle indices.
@@ -121,6 +242,31 @@ private:
     static uint32_t FindEdgeByNeighbor(
         const uint32_t *const neighbors,
         const uint32_t n);
+
+private:
+
+    /**
+    \brief Attempt to mate two triangles along a given edge.
+
+    Mate edge (edgeAIndex) on triangle (triangleAIndex) with any edge on triangle (triangleBIndex)
+
+    \param triangles collection of triangles
+    \param triangleEdgeCodes collection of triangle edge cosine codes
+    \param vertices collection of vertices
+    \param edgeAIndex The edge number 0,1,2 on i1
+    \param triangleAIndex A triangle index
+    \param triangleBIndex A triangle index
+
+    \return True if mate found, false otherwise.
+    */
+    static bool MateEdge(
+        const TriangleList & triangles,
+        TriangleEdgeCosinesList & triangleEdgeCosines,
+        TriangleNeighborsList & triangleNeighbors,
+        const VertexList & vertices,
+        const uint32_t edge1Index,
+        const uint32_t triangle1Index,
+        const uint32_t triangle2Index);
 };
 
 
@@ -12,6 +12,8 @@ Purpose: UnitCluster struct.
 
 A structure representing a UnitCluster, containing the list of clusters vertices,
 a list of unitIds, a compressionMode indicator and a buffer for the final unit data.
+The vertices are numbered within the cluster in vertex ID order, unless they have
+been given codes in the order of the units, see UnitClusterBuilder::AssignVertexCodesInUnitOrder.
 */
 
 
@@ -59,7 +61,9 @@ struct UnitCluster
         , unitIDs(NULL)
         , numUnits(0)
         , numVertices(0)
+        , hasVertexCodes(0)
         , compressionMode(rw::collision::ClusteredMeshCluster::VERTICES_UNCOMPRESSED)
+        , granularityShift(0)
     {
         clusterOffset.x = 0;
         clusterOffset.y = 0;
@@ -74,8 +78,10 @@ struct UnitCluster
         clusterOffset.x = 0;
         clusterOffset.y = 0;
         clusterOffset.z = 0;
+        granularityShift = 0;
 
         numVertices = 0;
+        hasVertexCodes = 0;
 
         numUnits = 0;
         unitIDs = IdList;
@@ -112,6 +118,13 @@ struct UnitCluster
 
     // Given a global vertex index, returns the cluster vertex index
     uint8_t GetVertexCode(const uint32_t vertexIndex) const
+    {
+        const uint8_t vertexSetIndex = GetVertexSetIndex(vertexIndex);
+        return (hasVertexCodes && vertexSetIndex != 0xFF) ? vertexCodes[vertexSetIndex] : vertexSetIndex;
+    }
+
+    // Given a global vertex index, returns its index in the sorted vertex set
+    uint8_t GetVertexSetIndex(const uint32_t vertexIndex) const
     {
         uint8_t start = 0;
         uint8_t end = static_cast<uint8_t>(numVertices - 1u);
@@ -146,7 +159,7 @@ struct UnitCluster
     // UnitCluster ID
     uint32_t clusterID;
 
-    // Used in 16-bit compression mode only
+    // Used in 16-bit, 10-bit and 8-bit compression modes only
     rw::collision::ClusteredMeshCluster::Vertex32 clusterOffset; 
 
     // UnitId collection
@@ -159,11 +172,19 @@ struct UnitCluster
     // Count of entries in vertex set
     uint32_t numVertices;
 
+    // Cluster vertex code of each entry in the vertex set, used if hasVertexCodes is set
+    uint8_t vertexCodes[ClusteredMeshCluster::MAX_VERTEX_COUNT];
+    // Set if the vertices have been given codes other than their position in the vertex set
+    uint8_t hasVertexCodes;
+
     // Compression mode
     uint8_t compressionMode;
 
+    // Power of two by which the cluster granularity exceeds the mesh granularity, used in 10-bit and 8-bit compression modes only
+    uint8_t granularityShift;
+
     // Used to ensure the struct is padded to with a 4 byte alignment
-    uint8_t m_padding[3];
+    uint8_t m_padding[2];
 };
 
 
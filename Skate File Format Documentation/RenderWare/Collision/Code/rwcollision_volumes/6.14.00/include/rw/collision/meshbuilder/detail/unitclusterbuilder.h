@@ -89,6 +89,22 @@ public:
         const TriangleList & triangles,
         const UnitList & unitList,
         const uint32_t maxVerticesPerUnit);
+
+    /**
+    \brief Numbers the vertices of a cluster in the order they are first used by its units.
+
+    The vertices of each unit are then close together in the cluster vertex array, and those of
+    neighboring units overlap, so that a query decoding a run of units touches a small range of
+    the vertices. The vertex set itself remains sorted on vertex ID.
+
+    \param unitCluster the unit cluster, with its final vertex set and unit order.
+    \param triangles collection of triangles.
+    \param unitList collection of units.
+    */
+    static void AssignVertexCodesInUnitOrder(
+        UnitCluster & unitCluster,
+        const TriangleList & triangles,
+        const UnitList & unitList);
 };
 
 
@@ -318,6 +318,15 @@ public:
         m_isValid = true;
     }
 
+    /*
+    Returns the size of the memory allocated by Initialize, given a number of input triangles
+    */
+    static uint32_t GetMemoryRequirements(uint32_t numTri)
+    {
+        return numTri * 3 * static_cast<uint32_t>(sizeof(VertexTrianglePairVector::value_type)) +
+               numTri * 3 * static_cast<uint32_t>(sizeof(VertexTrianglePairIndexVector::value_type));
+    }
+
     /*
     Releases the memory used by the internal containers
     */
@@ -0,0 +1,155 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#ifndef PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_WORKERALLOCATORS_H
+#define PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_WORKERALLOCATORS_H
+
+
+#include <rw/collision/common.h>
+
+
+#if !defined EA_PLATFORM_PS3_SPU
+
+#include <new>
+
+#include <rw/collision/meshbuilder/detail/iallocator.h>
+#include <rw/collision/meshbuilder/detail/linearallocator.h>
+
+
+namespace rw
+{
+namespace collision
+{
+namespace meshbuilder
+{
+namespace detail
+{
+
+
+/**
+A set of per worker scratch arenas carved out of the temporary heap of a parent allocator.
+
+The builder allocators are not thread-safe, so workers of a parallel build stage must not allocate from
+them directly. Instead each worker is given its own LinearAllocator over a private block of the parent
+temporary heap, indexed by the worker index passed to IParallelDispatcher range functions.
+
+The arenas are intended to live for a single stage. The caller should Mark the parent temporary heap
+before Initialize and Release it after Release, as with any other temporary allocation.
+*/
+class WorkerAllocators
+{
+
+public:
+
+    /**
+    Default constructor.
+    Constructs an empty set of arenas.
+    */
+    WorkerAllocators() :
+      m_allocators(0),
+      m_buffer(0),
+      m_numWorkers(0)
+    {
+    }
+
+    /**
+    Destructor
+    */
+    ~WorkerAllocators()
+    {
+        EA_ASSERT_MSG(m_allocators == 0, "WorkerAllocators should be released before destruction");
+    }
+
+    /**
+    Allocates an arena of the given size for each worker from the temporary heap of the parent allocator.
+
+    \param parent Allocator from which the arenas are allocated.
+    \param numWorkers Number of arenas to allocate.
+    \param arenaSize Size in bytes of each arena.
+    \return false if the parent allocator ran out of memory, in which case no arenas are held.
+    */
+    bool Initialize(IAllocator *const parent, const uint32_t numWorkers, const uint32_t arenaSize)
+    {
+        EA_ASSERT(m_allocators == 0);
+        EA_ASSERT(numWorkers > 0);
+
+        void *const allocatorMemory = parent->Alloc(numWorkers * sizeof(LinearAllocator), "WorkerAllocators", EA::Allocator::MEM_TEMP, EA_ALIGN_OF(LinearAllocator));
+        if (!allocatorMemory)
+        {
+            return false;
+        }
+
+        void *const bufferMemory = parent->Alloc(numWorkers * arenaSize, "WorkerAllocatorsBuffer", EA::Allocator::MEM_TEMP, 16);
+        if (!bufferMemory)
+        {
+            parent->Free(allocatorMemory);
+            return false;
+        }
+
+        m_allocators = static_cast<LinearAllocator *>(allocatorMemory);
+        m_buffer = static_cast<uint8_t *>(bufferMemory);
+        m_numWorkers = numWorkers;
+
+        for (uint32_t workerIndex = 0; workerIndex < m_numWorkers; ++workerIndex)
+        {
+            new (&m_allocators[workerIndex]) LinearAllocator(m_buffer + workerIndex * arenaSize, arenaSize);
+        }
+
+        return true;
+    }
+
+    /**
+    Frees the arenas back to the parent allocator.
+    \note The caller should still Release the parent temporary heap, in case the parent is a linear allocator.
+    */
+    void Release(IAllocator *const parent)
+    {
+        if (m_allocators)
+        {
+            for (uint32_t workerIndex = 0; workerIndex < m_numWorkers; ++workerIndex)
+            {
+                m_allocators[workerIndex].~LinearAllocator();
+            }
+
+            parent->Free(m_buffer);
+            parent->Free(m_allocators);
+        }
+
+        m_allocators = 0;
+        m_buffer = 0;
+        m_numWorkers = 0;
+    }
+
+    /**
+    Returns the number of arenas held.
+    */
+    uint32_t GetNumWorkers() const
+    {
+        return m_numWorkers;
+    }
+
+    /**
+    Returns the arena of the given worker.
+    */
+    LinearAllocator & GetAllocator(const uint32_t workerIndex)
+    {
+        EA_ASSERT(workerIndex < m_numWorkers);
+        return m_allocators[workerIndex];
+    }
+
+private:
+
+    LinearAllocator *m_allocators;
+    uint8_t *m_buffer;
+    uint32_t m_numWorkers;
+};
+
+
+} // namespace detail
+} // namespace meshbuilder
+} // namespace collision
+} // namespace rw
+
+
+#endif // !defined EA_PLATFORM_PS3_SPU
+
+#endif // defined PUBLIC_RW_COLLISION_MESHBUILDER_DETAIL_WORKERALLOCATORS_H
@@ -75,6 +75,27 @@ public:
         const TriangleNeighborsList &triangleNeighbors,
         const rwpmath::VecFloat &minConcaveEdgeCosine);
 
+    /**
+    \brief Computes edge cosine codes for the edges of a range of triangles.
+
+    As GenerateTriangleEdgeCodes, but only for triangles in [begin, end). The edge codes of each
+    triangle depend only on its own data, so disjoint ranges may be generated concurrently.
+
+    \param triangleEdgeCodes        Collection of triangle edge cosine codes to be filled.
+    \param triangleEdgeCosines      Collection of per-triangle edge cosine triples.
+    \param triangleNeighbors        Collection of per-triangle edge neighbor triples.
+    \param minConcaveEdgeCosine     Threshold edge cosine below which concave edges are disabled.
+    \param begin                    Index of the first triangle.
+    \param end                      Index one past the last triangle.
+    */
+    static void GenerateTriangleEdgeCodes(
+        TriangleEdgeCodesList &triangleEdgeCodes,
+        const TriangleEdgeCosinesList &triangleEdgeCosines,
+        const TriangleNeighborsList &triangleNeighbors,
+        const rwpmath::VecFloat &minConcaveEdgeCosine,
+        const uint32_t begin,
+        const uint32_t end);
+
     /**
     \brief Encodes an "extended" edge cosine value and "matched" flag of a triangle edge into a single byte.
 
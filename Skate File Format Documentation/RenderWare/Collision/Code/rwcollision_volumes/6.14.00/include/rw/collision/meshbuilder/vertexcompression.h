@@ -75,6 +75,52 @@ public:
         const int32_t yMax,
         const int32_t zMin,
         const int32_t zMax);
+
+    /**
+    \brief Determines the largest power of two by which the granularity of a cluster can exceed the
+    mesh granularity while keeping the error of each compressed vertex within the given bound.
+
+    Rounding to a cluster granularity of (granularity << shift) moves a vertex by at most half of it.
+
+    \param granularity              Vertex compression granularity of the mesh.
+    \param maxError                 Maximum additional error allowed in each vertex component.
+
+    \return The maximum granularity shift, zero if the error bound allows no loss of precision.
+    */
+    static uint32_t CalculateMaximumGranularityShift(
+        const float granularity,
+        const float maxError);
+
+    /**
+    \brief Determines the smallest compression mode of a cluster, including the 8-bit and 10-bit modes,
+    and the geometric offset and granularity shift used.
+
+    The 8-bit and 10-bit modes are tried with each granularity shift up to the given maximum, smallest
+    first. When neither fits the range the mode is chosen by \ref DetermineCompressionModeAndOffsetForRange
+    and the returned granularity shift is zero.
+
+    \param compressionMode          Returned compression mode indicated for use with the range.
+    \param offset                   Returned base offset translation to be subtracted from the vertex positions.
+    \param granularityShift         Returned power of two by which the cluster granularity exceeds the mesh granularity.
+    \param xMin                     Minimum integer extent of x range.
+    \param xMax                     Maximum integer extent of x range.
+    \param yMin                     Minimum integer extent of y range.
+    \param yMax                     Maximum integer extent of y range.
+    \param zMin                     Minimum integer extent of z range.
+    \param zMax                     Maximum integer extent of z range.
+    \param maxGranularityShift      Maximum granularity shift allowed, from \ref CalculateMaximumGranularityShift.
+    */
+    static void DetermineAdaptiveCompressionModeAndOffsetForRange(
+        uint8_t &compressionMode,
+        rw::collision::ClusteredMeshCluster::Vertex32 &offset,
+        uint32_t &granularityShift,
+        const int32_t xMin,
+        const int32_t xMax,
+        const int32_t yMin,
+        const int32_t yMax,
+        const int32_t zMin,
+        const int32_t zMax,
+        const uint32_t maxGranularityShift);
 };
 
 
@@ -14,7 +14,7 @@
 #include <rw/collision/meshbuilder/common.h>
 
 #include <rw/collision/meshbuilder/detail/containers.h>
-#include <rw/collision/meshbuilder/detail/spatialmap.h>
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
 
 
 namespace rw
@@ -48,8 +48,18 @@ This utility can be used to merge coincident vertices in a collection of triangl
 The merging is fuzzy and controlled by a supplied tolerance distance within which vertex
 positions are considered practically identical.
 
-The merging is performed using a spatial map data structure which is allocated internally
-using an allocator supplied by the caller. The spatial map is freed before return.
+The vertices are binned into a grid of cells at least twice the tolerance in size, which
+are ordered along a 64 bit Morton curve. The vertex cell keys are radix sorted, so that the
+vertices of each cell are adjacent and in vertex index order, and each vertex is compared
+only against the vertices of the cells its tolerance sphere touches. The cell size grows
+with the extent of the vertices, so there is no limit on the extent of the mesh. The temporary
+data is allocated using an allocator supplied by the caller, and freed before return.
+
+Vertices are merged in index order: each vertex is merged to the lowest indexed remaining
+vertex within the tolerance of it, or remains if there is none. So coincident vertices are
+merged to the lowest index among them, and no two remaining vertices are within the tolerance
+of one another. The search for nearby vertices can be spread across the workers of an optional
+parallel dispatcher, which does not change the result.
 
 The process is phrased in two parts, each corresponding to a method. In the first part a
 vertex map is built up describing which vertices are to be replaced by which other
@@ -84,18 +94,32 @@ public:
     with duplicate vertices "removed" by the merging simply remaining unreferenced in the
     collection.
 
-    \param vertexGroup                      Returned vertex index map.
-    \param spatialMapAllocator              An allocator to be used for internal allocation of a temporary spatial map.
+    \param vertexGroup                      Returned vertex index map, which should be initialized to the identity.
+    \param allocator                        An allocator to be used for internal temporary allocations.
     \param aabbox                           A caller-calculated tight axis-aligned bounding box containing all vertices.
     \param vertexMergeDistanceTolerance     Tolerance separating distance within which vertices are considered coincident.
     \param vertices                         The collection of vertices to be merged.
+    \param dispatcher                       Optional dispatcher used to search for nearby vertices in parallel.
+
+    \return false if the temporary data could not be allocated.
     */
     static bool MergeVertexGroups(
         IDList &vertexGroup,
-        EA::Allocator::ICoreAllocator &spatialMapAllocator,
+        EA::Allocator::ICoreAllocator &allocator,
         const AABBoxType &aabbox,
         const rwpmath::VecFloat &vertexMergeDistanceTolerance,
-        const VertexList &vertices);
+        const VertexList &vertices,
+        detail::IParallelDispatcher *dispatcher = NULL);
+
+    /**
+    \brief Returns the size of the temporary memory allocated by MergeVertexGroups, with MEM_TEMP.
+
+    \param numVertices                      The number of vertices to be merged.
+
+    \return The size in bytes of the temporary memory, allocated as blocks aligned to four bytes.
+    */
+    static uint32_t GetMergeVertexGroupsWorkspaceSize(
+        const uint32_t numVertices);
 
     /**
     \brief Updates the vertex indices of a collection of triangles with a vertex index mapping
@@ -111,125 +135,6 @@ public:
 private:
 
     typedef meshbuilder::VectorType VectorType;
-
-    /**
-    \brief Computes 1+log2 of an integer.
-
-    \param val Integer in question.
-
-    \return 1+log2 of integer
-    */
-    static uint32_t HowManyBits(uint32_t val);
-
-    /*
-    \brief Merges a range of SpatialMap Cell entries.
-
-    \TODO should be a method of SpatialMap
-
-    \param spatialMap The SpatialMap containing the entries.
-    \param vertexGroup The grouped vertex indices.
-    \param startEntry the start of the group of entries to compare.
-    \param endEntry the end of the group of entries to compare.
-    \param vertices The collection of input vertices.
-    \param toleranceSquared The vertex merge distance tolerance squared.
-    **/
-    static void MergeRangeOfEntries(
-        IDList &vertexGroup,
-        const detail::SpatialMap &spatialMap,
-        const uint32_t startEntry,
-        const uint32_t endEntry,
-        const VertexList &vertices,
-        const rwpmath::VecFloat &toleranceSquared);
-
-    /**
-    \brief Compares a given SpatialMap entry against entries in a SpatialMap cell.
-
-    Used to merge the given entry with any cell entries which are withing the vertex
-    merge distance tolerance.
-
-    \param spatialMap The SpatialMap containing the entries.
-    \param vertexGroup The grouped vertex indices.
-    \param vertices The collection of input vertices.
-    \param x The X coordinate of the cell ID.
-    \param y The Y coordinate of the cell ID.
-    \param z The Z coordinate of the cell ID.
-    \param comparisonEntry The entry to compare against the cell.
-    \param toleranceSquared the vertex merge distance tolerance squared.
-    */
-    static void CompareEntryAgainstCell(
-        IDList &vertexGroup,
-        const detail::SpatialMap &spatialMap,
-        const VertexList &vertices,
-        const uint32_t x,
-        const uint32_t y,
-        const uint32_t z,
-        const uint32_t comparisonEntry,
-        const rwpmath::VecFloat &toleranceSquared);
-
-    /*
-    \brief Merges a spatial map entry with a range of other entries with higher vertex indices.
-
-    \TODO should be a method of SpatialMap
-
-    \param spatialMap The SpatialMap containing the entries.
-    \param vertexGroup The grouped vertex indices.
-    \param comparisonEntry The comparison entry.
-    \param startEntry the start of the group of entries to compare.
-    \param endEntry the end of the group of entries to compare.
-    \param vertices The collection of input vertices.
-    \param toleranceSquared The vertex merge distance tolerance squared.
-    **/
-    static bool MergeEntryWithHigherEntries(
-        IDList &vertexGroup,
-        const detail::SpatialMap &spatialMap,
-        const uint32_t comparisonEntry,
-        const uint32_t startEntry,
-        const uint32_t endEntry,
-        const VertexList &vertices,
-        const rwpmath::VecFloat &toleranceSquared);
-
-    /*
-    \brief Merges a spatial map entry with a range of other entries with lower vertex indices.
-
-    \TODO should be a method of SpatialMap
-
-    \param spatialMap The SpatialMap containing the entries.
-    \param vertexGroup The grouped vertex indices.
-    \param comparisonEntry The comparison entry.
-    \param startEntry the start of the group of entries to compare.
-    \param endEntry the end of the group of entries to compare.
-    \param vertices The collection of input vertices.
-    \param toleranceSquared The vertex merge distance tolerance squared.
-    **/
-    static void MergeEntryWithLowerEntries(
-        IDList &vertexGroup,
-        const detail::SpatialMap &spatialMap,
-        const uint32_t comparisonEntry,
-        const uint32_t startEntry,
-        const uint32_t endEntry,
-        const VertexList &vertices,
-        const rwpmath::VecFloat &toleranceSquared);
-
-    /*
-    \brief Merges a range of spatial map entries which may have already been merged
-
-    \TODO should be a method of SpatialMap
-
-    \param spatialMap The SpatialMap containing the entries.
-    \param vertexGroup The grouped vertex indices.
-    \param comparisonEntry The comparison entry.
-    \param startEntry the start of the group of entries to compare.
-    \param endEntry the end of the group of entries to compare.
-    \param vertices The collection of input vertices.
-    \param toleranceSquared The vertex merge distance tolerance squared.
-    **/
-    static void MergeHigherRangeOfEntries(
-        IDList &vertexGroup,
-        const detail::SpatialMap &spatialMap,
-        const uint32_t startEntry,
-        const uint32_t endEntry,
-        const VertexList &vertices,
-        const rwpmath::VecFloat &toleranceSquared);
 };
 
 
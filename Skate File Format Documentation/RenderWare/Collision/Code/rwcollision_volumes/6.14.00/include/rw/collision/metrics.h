@@ -6,7 +6,7 @@
 
  File: rwcmetrics.hpp
 
- Purpose: Collision metrics services.
+ Purpose: Collision metrics services and query statistics.
  */
 
 #include "rw/collision/common.h"
@@ -111,6 +111,214 @@ rw::collision::Timer::SetQueryFunction(QueryFn fn)
 
 #endif /* RWMETRICS */
 
+
+// Query statistics are counted unless RW_COLLISION_DISABLE_QUERY_STATS is defined. The QueryCounters and
+// QueryStats classes are always available, but the counters are left at zero when counting is disabled.
+#if defined(RW_COLLISION_DISABLE_QUERY_STATS)
+#define RW_COLLISION_DETAIL_QUERY_STATS 0
+#else
+#define RW_COLLISION_DETAIL_QUERY_STATS 1
+#endif
+
+#if RW_COLLISION_DETAIL_QUERY_STATS
+
+/**
+\internal
+*/
+#define rwcQUERYSTATS(_code) _code
+
+#else // RW_COLLISION_DETAIL_QUERY_STATS
+
+/**
+\internal
+*/
+#define rwcQUERYSTATS(_code)
+
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+
+
+/**
+\brief Counts of the work done by a single query.
+
+Each of VolumeLineQuery, VolumeBBoxQuery and VolumeVolumeQuery holds a QueryCounters, which is reset by
+InitQuery and accumulates over every call until the query is initialized again. The PrimitiveBatchIntersect
+functions add their primitive tests to an optional QueryCounters passed by the caller.
+
+\importlib rwccore
+*/
+struct QueryCounters
+{
+    /**
+    \brief The work counted for a query.
+    */
+    enum Counter
+    {
+        KDTREE_NODES,       ///< KDTree branch nodes visited.
+        KDTREE_LEAVES,      ///< KDTree leaves touched.
+        CLUSTERS,           ///< ClusteredMesh clusters decoded.
+        UNITS,              ///< ClusteredMesh units tested.
+        TRIANGLES,          ///< Triangles tested.
+        PRIMITIVE_TESTS,    ///< Primitive volumes or primitive pairs tested.
+        RESTARTS,           ///< Calls which resumed a query after its buffers overflowed.
+        INSTANCED_VOLUMES,  ///< Volumes instanced by aggregates.
+        CHILD_VOLUMES,      ///< Child volumes of mapped arrays tested against the query.
+        NUM_COUNTERS
+    };
+
+    /**
+    \brief Sets all counters to zero.
+    */
+    void
+    Reset()
+    {
+        for (uint32_t i = 0; i < NUM_COUNTERS; ++i)
+        {
+            m_counts[i] = 0;
+        }
+    }
+
+    /**
+    \brief Adds the counts of another query.
+    \param other The counts to add.
+    */
+    void
+    Add(const QueryCounters &other)
+    {
+        for (uint32_t i = 0; i < NUM_COUNTERS; ++i)
+        {
+            m_counts[i] += other.m_counts[i];
+        }
+    }
+
+    /**
+    \brief Gets the total of the counters which measure intersection work, which are the KDTree nodes,
+    triangles, primitive tests and child volumes.
+    \return The work done by the query.
+    */
+    uint32_t
+    GetWork() const
+    {
+        return m_counts[KDTREE_NODES] + m_counts[TRIANGLES] + m_counts[PRIMITIVE_TESTS] + m_counts[CHILD_VOLUMES];
+    }
+
+    static const char *
+    GetName(Counter counter);
+
+    uint32_t m_counts[NUM_COUNTERS];    ///< Count of each Counter.
+};
+
+
+/**
+\brief Query statistics accumulated over many queries.
+
+A QueryStats is not thread safe. Each thread which runs queries should record them into its own
+QueryStats, and these can be merged for reporting:
+\code
+lineQuery->InitQuery(volumes, NULL, numVolumes, start, end);
+const uint64_t startTicks = ReadTicks();
+lineQuery->GetNearestIntersection();
+threadStats.Record(QueryStats::LINE_QUERY, lineQuery->GetCounters(), ReadTicks() - startTicks);
+
+// Once per frame, after the physics jobs
+frameStats.Merge(threadStats);
+threadStats.Reset();
+\endcode
+
+Latency and work are kept in histograms with power of two buckets, and the counters are totalled for
+each type of query. The statistics can be written as JSON with QueryStats::WriteJSON.
+
+\importlib rwccore
+*/
+class QueryStats
+{
+public:
+
+    /**
+    \brief The types of query recorded separately.
+    */
+    enum QueryType
+    {
+        LINE_QUERY,
+        BBOX_QUERY,
+        VOLUMEVOLUME_QUERY,
+        NUM_QUERY_TYPES
+    };
+
+    /**
+    \brief A histogram with power of two buckets. Bucket 0 counts the value 0, and bucket i counts values
+    from 2^(i-1) to 2^i - 1. The last bucket also counts all larger values.
+    */
+    struct Histogram
+    {
+        enum
+        {
+            NUM_BUCKETS = 40
+        };
+
+        void
+        Reset();
+
+        void
+        Add(uint64_t value);
+
+        void
+        Add(const Histogram &other);
+
+        uint64_t
+        GetPercentile(float fraction) const;
+
+        uint32_t m_buckets[NUM_BUCKETS];    ///< Number of values in each bucket.
+    };
+
+    /**
+    \brief The statistics of one type of query.
+    */
+    struct QueryTypeStats
+    {
+        uint32_t  m_numQueries;                             ///< Number of queries recorded.
+        uint64_t  m_totals[QueryCounters::NUM_COUNTERS];    ///< Sum of each counter over the queries.
+        uint64_t  m_totalTicks;                             ///< Sum of the latency of the queries.
+        Histogram m_latency;                                ///< Histogram of the latency in ticks.
+        Histogram m_work;                                   ///< Histogram of QueryCounters::GetWork.
+    };
+
+    QueryStats();
+
+    void
+    Reset();
+
+    void
+    Record(QueryType type,
+           const QueryCounters &counters,
+           uint64_t ticks);
+
+    void
+    Merge(const QueryStats &other);
+
+    /**
+    \brief Gets the statistics of one type of query.
+    \param type The type of query.
+    \return The statistics of the query type.
+    */
+    const QueryTypeStats &
+    GetQueryTypeStats(QueryType type) const
+    {
+        EA_ASSERT(type < NUM_QUERY_TYPES);
+        return m_types[type];
+    }
+
+    uint32_t
+    WriteJSON(char *buffer,
+              uint32_t bufferSize) const;
+
+    static const char *
+    GetName(QueryType type);
+
+private:
+
+    QueryTypeStats m_types[NUM_QUERY_TYPES];
+};
+
 } // namespace collision
 } // namespace rw
 
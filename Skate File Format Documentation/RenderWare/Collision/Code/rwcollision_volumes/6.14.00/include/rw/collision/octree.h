@@ -685,6 +685,9 @@ public:
         // Next entry in leaf node list (terminated by rwOCTREE_END_OF_LIST).
         uint32_t          m_nextEntry;
 
+        // Number of nodes processed, for query statistics.
+        uint32_t          m_numNodesVisited;
+
         /**
         \internal
         */
@@ -698,6 +701,25 @@ public:
                   rwpmath::Vector3::InParam end,
                   const float fatness = 0.0f);
 
+        /**
+        \brief Gets the number of octree nodes processed since construction or the last ResetNumNodesVisited.
+        \return The number of nodes processed.
+        */
+        uint32_t
+        GetNumNodesVisited() const
+        {
+            return m_numNodesVisited;
+        }
+
+        /**
+        \brief Restarts the count of octree nodes processed.
+        */
+        void
+        ResetNumNodesVisited()
+        {
+            m_numNodesVisited = 0;
+        }
+
         /**
         \brief
 
@@ -850,6 +872,9 @@ public:
         // Current entry in leaf node list (terminated by rwOCTREE_END_OF_LIST).
         uint32_t                m_nextEntry;
 
+        // Number of nodes processed, for query statistics.
+        uint32_t                m_numNodesVisited;
+
         /**
         \internal
          */
@@ -861,6 +886,25 @@ public:
         BBoxQuery(const Octree *octree,
                   const AABBox  &bbox);
 
+        /**
+        \brief Gets the number of octree nodes processed since construction or the last ResetNumNodesVisited.
+        \return The number of nodes processed.
+        */
+        uint32_t
+        GetNumNodesVisited() const
+        {
+            return m_numNodesVisited;
+        }
+
+        /**
+        \brief Restarts the count of octree nodes processed.
+        */
+        void
+        ResetNumNodesVisited()
+        {
+            m_numNodesVisited = 0;
+        }
+
         /**
         \brief
         Find next octree entry from the leaf nodes that are intersected by the query box. This will
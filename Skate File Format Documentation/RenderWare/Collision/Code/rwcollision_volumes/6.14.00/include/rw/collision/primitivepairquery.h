@@ -20,6 +20,7 @@ namespace collision
 
 struct PrimitivePairIntersectResult;
 struct GPInstance;
+struct QueryCounters;
 
 // Default values for all the tolerance parameters
 
@@ -148,7 +149,8 @@ PrimitiveBatchIntersect1xN( PrimitivePairIntersectResult *res,
                             const Volume *v1, const rwpmath::Matrix44Affine *tm1,
                             const Volume *vN, const rwpmath::Matrix44Affine *tmN, int32_t num,
                             float edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
-                            float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon);
+                            float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                            QueryCounters *counters = NULL);
 
 /**
 \internal
@@ -165,7 +167,8 @@ PrimitiveBatchIntersect1xN( PrimitivePairIntersectResult *res,
                             const Volume *v1, const rwpmath::Matrix44Affine *tm1,
                             const Volume **vN, const rwpmath::Matrix44Affine **tmN, int32_t num,
                             float edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
-                            float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon );
+                            float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                            QueryCounters *counters = NULL );
 
 /**
 \internal
@@ -182,7 +185,80 @@ PrimitiveBatchIntersectNxM( PrimitivePairIntersectResult *res,
                             const Volume **vN, const rwpmath::Matrix44Affine **tmN, int32_t numN,
                             const Volume **vM, const rwpmath::Matrix44Affine **tmM, int32_t numM,
                             float edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
-                            float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon );
+                            float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                            QueryCounters *counters = NULL );
+
+/**
+\internal
+Default edge length, in instances, of the tiles the NxM test is split into by PrimitiveBatchIntersectNxMTile.
+Two tiles' worth of GPInstances fit comfortably in the L1 data cache.
+*/
+#define PRIMITIVEBATCHINTERSECT_DEFAULT_TileSize 32
+
+/**
+\internal
+Instance both batches of an NxM test into instancingSPR, the N volumes first followed by the M volumes.
+instancingSPR must have room for (numN + numM) GPInstances.
+*/
+void
+PrimitiveBatchInstanceNxM( GPInstance *instancingSPR,
+                           const Volume **vN, const rwpmath::Matrix44Affine **tmN, int32_t numN,
+                           const Volume **vM, const rwpmath::Matrix44Affine **tmM, int32_t numM );
+
+/**
+\internal
+Returns the number of tiles an NxM test is split into.
+*/
+int32_t
+PrimitiveBatchIntersectNxMGetNumTiles( int32_t numN, int32_t numM,
+                                       int32_t tileSize = PRIMITIVEBATCHINTERSECT_DEFAULT_TileSize );
+
+/**
+\internal
+Test a single tile of an NxM batch instanced by PrimitiveBatchInstanceNxM. Tiles only read the instances,
+so different tiles may be run at the same time on different threads, each with its own result buffer
+and, if counting, its own QueryCounters.
+Returns the number of intersections found in the tile, which is more than resBufMaxSize if results were lost.
+*/
+int32_t
+PrimitiveBatchIntersectNxMTile( PrimitivePairIntersectResult *resBuf,
+                                int32_t resBufMaxSize,
+                                const GPInstance *instancingSPR,
+                                int32_t numN, int32_t numM,
+                                int32_t tileIndex,
+                                int32_t tileSize = PRIMITIVEBATCHINTERSECT_DEFAULT_TileSize,
+                                float edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
+                                float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                                QueryCounters *counters = NULL );
+
+/**
+\internal
+Gather the results of all the tiles of an NxM batch into resBuf in tile order.
+Returns the total number of intersections found, including any lost to overflow.
+*/
+int32_t
+PrimitiveBatchIntersectNxMMergeTiles( PrimitivePairIntersectResult *resBuf,
+                                      int32_t resBufMaxSize,
+                                      PrimitivePairIntersectResult * const *tileResBufs,
+                                      const int32_t *tileResBufMaxSizes,
+                                      const int32_t *tileNumIntersections,
+                                      int32_t numTiles,
+                                      int32_t *numWritten = NULL );
+
+/**
+\internal
+Serial version of the tiled NxM test. Gives the same results as running every tile and merging them.
+*/
+int32_t
+PrimitiveBatchIntersectNxMTiled( PrimitivePairIntersectResult *res,
+                                 int32_t resBufMaxSize,
+                                 GPInstance *instancingSPR,
+                                 const Volume **vN, const rwpmath::Matrix44Affine **tmN, int32_t numN,
+                                 const Volume **vM, const rwpmath::Matrix44Affine **tmM, int32_t numM,
+                                 int32_t tileSize = PRIMITIVEBATCHINTERSECT_DEFAULT_TileSize,
+                                 float edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
+                                 float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                                 QueryCounters *counters = NULL );
 
 /**
 \internal
@@ -195,7 +271,8 @@ PrimitiveBatchIntersect( PrimitivePairIntersectResult *resBuf,
                          int32_t numPairs,
                          float padding = COMPUTECONTACTS_DEFAULT_MinimumSeparatingDistance,
                          float edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
-                         float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon );
+                         float convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                         QueryCounters *counters = NULL );
 
 
 #endif // !defined(EA_PLATFORM_PS3_SPU)
@@ -0,0 +1,247 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_QUERYCONTEXT_H
+#define PUBLIC_RW_COLLISION_QUERYCONTEXT_H
+
+/*************************************************************************************************************
+
+ File: querycontext.h
+
+ Purpose: Scratch arena handing out line, bbox and volume queries without heap allocation.
+ */
+
+#include "rw/collision/common.h"
+
+namespace rw
+{
+namespace collision
+{
+
+class VolumeLineQuery;
+class VolumeBBoxQuery;
+class VolumeVolumeQuery;
+
+
+#define rwcQUERYCONTEXT_ALIGNMENT 16
+
+
+/**
+\brief A scratch arena from which query objects are created.
+
+A QueryContext owns a single block of memory, given to it when it is initialized, from which
+VolumeLineQuery, VolumeBBoxQuery and VolumeVolumeQuery objects, and any other scratch memory, are
+allocated by bumping an offset. Queries are released in stack order by returning to a marker, or all at
+once with QueryContext::Reset, so creating and releasing a query never touches the heap.
+
+A QueryContext is not thread safe. Each thread that runs queries should own its own context, typically
+created once at startup and reset at the start of each frame or job.
+
+The arena records the highest offset it has reached, and the highest offset that would have been
+reached by requests it was too small for, so that it can be sized from observed peak usage:
+\code
+QueryContext::Scope scope(*context);
+VolumeLineQuery *lineQuery = context->CreateLineQuery(stackMax, resBufferSize);
+if (lineQuery)
+{
+    lineQuery->InitQuery(volumes, NULL, numVolumes, start, end);
+    ...
+}
+// lineQuery is released when scope goes out of scope.
+
+// At shutdown, or in a tools build:
+EAPHYSICS_MESSAGE("Query arena peak %u of %u bytes", context->GetRequiredSize(), context->GetCapacity());
+\endcode
+
+\importlib rwccore
+*/
+class QueryContext
+{
+public:
+
+    /**
+    \brief Releases everything allocated from a context since the scope was entered.
+    */
+    class Scope
+    {
+    public:
+        /**
+        \brief Records the current marker of the context.
+        \param context The context to release to the marker when the scope exits.
+        */
+        explicit Scope(QueryContext &context)
+            : m_context(context),
+              m_marker(context.GetMarker())
+        {
+        }
+
+        /**
+        \brief Releases everything allocated from the context within the scope.
+        */
+        ~Scope()
+        {
+            m_context.ReleaseToMarker(m_marker);
+        }
+
+    private:
+        Scope &operator=(const Scope &);
+
+        QueryContext &m_context;
+        uint32_t m_marker;
+    };
+
+    // See .cpp file for docs
+    explicit QueryContext(uint32_t arenaSize);
+
+    static EA::Physics::SizeAndAlignment
+    GetResourceDescriptor(uint32_t arenaSize);
+
+    static QueryContext *
+    Initialize(const EA::Physics::MemoryPtr &resource,
+               uint32_t arenaSize);
+
+    /**
+    \brief
+    Releases a QueryContext object. The memory block that this object was initialized
+    with is not freed by this function.
+    */
+    static void
+    Release(QueryContext * /*context*/)
+    {
+    }
+
+    void *
+    Allocate(const EA::Physics::SizeAndAlignment &resourceDescriptor);
+
+    VolumeLineQuery *
+    CreateLineQuery(uint32_t stackMax,
+                    uint32_t resBufferSize);
+
+    VolumeBBoxQuery *
+    CreateBBoxQuery(uint32_t stackMax,
+                    uint32_t resBufferSize);
+
+    VolumeVolumeQuery *
+    CreateVolumeVolumeQuery(uint32_t stackSize,
+                            uint32_t resBufferSize);
+
+    /**
+    \brief Gets a marker which everything allocated after it can be released back to.
+    \return The current offset into the arena.
+    */
+    uint32_t
+    GetMarker() const
+    {
+        return m_used;
+    }
+
+    /**
+    \brief Releases everything allocated after the marker was taken. Queries created after the marker
+    must no longer be used.
+    \param marker A marker returned by QueryContext::GetMarker.
+    */
+    void
+    ReleaseToMarker(uint32_t marker)
+    {
+        EA_ASSERT_MSG(marker <= m_used, ("Marker is beyond the current offset of the query context."));
+        m_used = marker;
+    }
+
+    /**
+    \brief Releases everything allocated from the context. The high water marks are kept.
+    */
+    void
+    Reset()
+    {
+        m_used = 0;
+    }
+
+    /**
+    \brief Gets the size of the arena.
+    \return The number of bytes in the arena.
+    */
+    uint32_t
+    GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+    \brief Gets the number of bytes currently allocated, including alignment padding. Failed requests
+    are not included.
+    \return The number of bytes in use.
+    */
+    uint32_t
+    GetUsed() const
+    {
+        return m_used;
+    }
+
+    /**
+    \brief Gets the highest number of bytes that have been in use at once.
+    \return The high water mark of the arena.
+    */
+    uint32_t
+    GetHighWaterMark() const
+    {
+        return m_highWaterMark;
+    }
+
+    /**
+    \brief Gets the largest offset requested so far, including requests that failed. Each failed request
+    is measured from where it would have been placed, so an arena of this size satisfies the largest
+    failure seen; any requests made after it in the same scope may then need more.
+    \return The required arena size in bytes.
+    */
+    uint32_t
+    GetRequiredSize() const
+    {
+        return m_requiredSize;
+    }
+
+    /**
+    \brief Gets the number of requests which failed because the arena was full.
+    \return The number of failed requests.
+    */
+    uint32_t
+    GetNumFailedRequests() const
+    {
+        return m_numFailedRequests;
+    }
+
+    /**
+    \brief Gets the total number of successful requests.
+    \return The number of allocations made from the arena.
+    */
+    uint32_t
+    GetNumRequests() const
+    {
+        return m_numRequests;
+    }
+
+    /**
+    \brief Clears the high water marks and request counts, so that they can be measured over a new period.
+    */
+    void
+    ResetStatistics()
+    {
+        m_highWaterMark = m_used;
+        m_requiredSize = m_used;
+        m_numFailedRequests = 0;
+        m_numRequests = 0;
+    }
+
+private:
+
+    uint8_t  *m_arena;              ///< Start of the arena, which follows the context in memory.
+    uint32_t m_capacity;            ///< Size of the arena.
+    uint32_t m_used;                ///< Offset of the next free byte.
+    uint32_t m_highWaterMark;       ///< Highest offset reached by successful requests.
+    uint32_t m_requiredSize;        ///< Highest offset requested, including failed requests.
+    uint32_t m_numFailedRequests;   ///< Number of requests which did not fit.
+    uint32_t m_numRequests;         ///< Number of successful requests.
+};
+
+
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_QUERYCONTEXT_H
@@ -0,0 +1,231 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifndef PUBLIC_RW_COLLISION_SHAPECAST_H
+#define PUBLIC_RW_COLLISION_SHAPECAST_H
+
+/*************************************************************************************************************
+
+ File: shapecast.h
+
+ Purpose: Swept sphere, capsule and box queries against triangles.
+ */
+
+#include "rw/collision/common.h"
+#include "rw/collision/aabbox.h"
+#include "rw/collision/primitivepairquery.h"
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\brief A convex shape swept by a shape cast.
+
+The shape is described in the frame of the query. The centre of the shape is the translation of
+m_transform. For a capsule the axis is the first column of m_transform, for a box the columns of
+m_transform are the box axes.
+
+\importlib rwccore
+*/
+struct CastShape
+{
+    /**
+    \brief The type of shape being cast.
+    */
+    enum Type
+    {
+        SPHERE,
+        CAPSULE,
+        BOX
+    };
+
+    static CastShape
+    Sphere(rwpmath::Vector3::InParam center,
+           float radius);
+
+    static CastShape
+    Capsule(rwpmath::Vector3::InParam center,
+            rwpmath::Vector3::InParam unitAxis,
+            float halfHeight,
+            float radius);
+
+    static CastShape
+    Box(const rwpmath::Matrix44Affine &transform,
+        rwpmath::Vector3::InParam halfExtents);
+
+    CastShape
+    Transform(const rwpmath::Matrix44Affine &transform) const;
+
+    rwpmath::Vector3
+    GetCenter() const;
+
+    rwpmath::Vector3
+    GetHalfExtents() const;
+
+    rwpmath::Matrix44Affine m_transform;    ///< Centre and orientation of the shape.
+    rwpmath::Vector3        m_halfExtents;  ///< Half extents of a box.
+    float                   m_radius;       ///< Radius of a sphere or capsule.
+    float                   m_halfHeight;   ///< Half height of a capsule, excluding the end caps.
+    Type                    m_type;         ///< The type of the shape.
+};
+
+
+/**
+\brief The result of a shape cast.
+
+\importlib rwccore
+*/
+struct ShapeCastResult
+{
+    rwpmath::Vector3 position;      ///< Point of first contact, on the surface of the triangle.
+    rwpmath::Vector3 normal;        ///< Contact normal at the first contact, pointing from the triangle to the shape.
+    float            lineParam;     ///< Fraction of the sweep at which first contact happens.
+    uint32_t         childIndex;    ///< Child index of the triangle hit, when casting against an aggregate.
+};
+
+
+RwpBool
+TriangleShapeCast(ShapeCastResult &result,
+                  const CastShape &shape,
+                  rwpmath::Vector3::InParam delta,
+                  rwpmath::Vector3::InParam v0,
+                  rwpmath::Vector3::InParam v1,
+                  rwpmath::Vector3::InParam v2,
+                  rwpmath::Vector3::InParam edgeCosines,
+                  uint32_t flags,
+                  rwpmath::VecFloatInParam edgeCosBendNormalThreshold = COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold,
+                  rwpmath::VecFloatInParam convexityEpsilon = COMPUTECONTACTS_DEFAULT_ConvexityEpsilon,
+                  rwpmath::VecFloatInParam triangleFaceNormalTolerance = COMPUTECONTACTS_DEFAULT_TriangleFaceNormalTolerance,
+                  rwpmath::VecFloatInParam featureSimplificationThreshold = COMPUTECONTACTS_DEFAULT_FeatureSimplificationThreshold);
+
+
+// ***********************************************************************************************************
+// Inline functions
+
+
+/**
+\brief Creates a sphere to cast.
+
+\param center The centre of the sphere.
+\param radius The radius of the sphere.
+*/
+inline CastShape
+CastShape::Sphere(rwpmath::Vector3::InParam center,
+                  float radius)
+{
+    CastShape shape;
+    shape.m_transform = rwpmath::Matrix44Affine(rwpmath::GetVector3_XAxis(), rwpmath::GetVector3_YAxis(),
+        rwpmath::GetVector3_ZAxis(), center);
+    shape.m_halfExtents = rwpmath::GetVector3_Zero();
+    shape.m_radius = radius;
+    shape.m_halfHeight = 0.0f;
+    shape.m_type = SPHERE;
+    return shape;
+}
+
+
+/**
+\brief Creates a capsule to cast.
+
+\param center     The centre of the capsule.
+\param unitAxis   The unit direction of the capsule axis.
+\param halfHeight The half length of the capsule axis, excluding the end caps.
+\param radius     The radius of the capsule.
+*/
+inline CastShape
+CastShape::Capsule(rwpmath::Vector3::InParam center,
+                   rwpmath::Vector3::InParam unitAxis,
+                   float halfHeight,
+                   float radius)
+{
+    EA_ASSERT_MSG(rwpmath::IsSimilar(rwpmath::Magnitude(unitAxis), rwpmath::GetVecFloat_One()),
+        "Capsule axis must be a unit vector.");
+
+    // Only the first column is used for a capsule, the others are set so the transform stays orthonormal.
+    rwpmath::Vector3 y, z;
+    rwpmath::VecFloat absX = rwpmath::Abs(unitAxis.GetX());
+    y = rwpmath::Normalize(rwpmath::Cross(unitAxis, absX < rwpmath::VecFloat(0.9f) ?
+        rwpmath::GetVector3_XAxis() : rwpmath::GetVector3_YAxis()));
+    z = rwpmath::Cross(unitAxis, y);
+
+    CastShape shape;
+    shape.m_transform = rwpmath::Matrix44Affine(unitAxis, y, z, center);
+    shape.m_radius = radius;
+    shape.m_halfHeight = halfHeight;
+    shape.m_halfExtents = rwpmath::GetVector3_Zero();
+    shape.m_type = CAPSULE;
+    return shape;
+}
+
+
+/**
+\brief Creates a box to cast.
+
+\param transform   The centre and orthonormal orientation of the box.
+\param halfExtents The half extents of the box along its axes.
+*/
+inline CastShape
+CastShape::Box(const rwpmath::Matrix44Affine &transform,
+               rwpmath::Vector3::InParam halfExtents)
+{
+    CastShape shape;
+    shape.m_transform = transform;
+    shape.m_halfExtents = halfExtents;
+    shape.m_radius = 0.0f;
+    shape.m_halfHeight = 0.0f;
+    shape.m_type = BOX;
+    return shape;
+}
+
+
+/**
+\brief Returns a copy of the shape with \a transform applied.
+
+\param transform An orthonormal transform.
+*/
+inline CastShape
+CastShape::Transform(const rwpmath::Matrix44Affine &transform) const
+{
+    CastShape shape(*this);
+    shape.m_transform = rwpmath::Mult(m_transform, transform);
+    return shape;
+}
+
+
+/**
+\brief Returns the centre of the shape.
+*/
+inline rwpmath::Vector3
+CastShape::GetCenter() const
+{
+    return m_transform.GetW();
+}
+
+
+/**
+\brief Returns the half extents of the axis aligned bounding box of the shape, about its centre.
+*/
+inline rwpmath::Vector3
+CastShape::GetHalfExtents() const
+{
+    if (m_type == BOX)
+    {
+        const rwpmath::Vector3 e = m_halfExtents;
+        return rwpmath::Abs(m_transform.GetX()) * e.GetX() +
+               rwpmath::Abs(m_transform.GetY()) * e.GetY() +
+               rwpmath::Abs(m_transform.GetZ()) * e.GetZ();
+    }
+    else if (m_type == CAPSULE)
+    {
+        return rwpmath::Abs(m_transform.GetX()) * rwpmath::VecFloat(m_halfHeight) +
+               rwpmath::Vector3(m_radius, m_radius, m_radius);
+    }
+    return rwpmath::Vector3(m_radius, m_radius, m_radius);
+}
+
+
+} // namespace collision
+} // namespace rw
+
+#endif // PUBLIC_RW_COLLISION_SHAPECAST_H
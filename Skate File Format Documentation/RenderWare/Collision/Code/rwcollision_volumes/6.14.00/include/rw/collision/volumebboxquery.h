@@ -13,6 +13,7 @@
 #include "rw/collision/volumedata.h"
 #include "rw/collision/volume.h"
 #include "rw/collision/aabbox.h"
+#include "rw/collision/metrics.h"
 #include "rw/collision/detail/querydata.h"
 
 namespace rw
@@ -143,6 +144,11 @@ public:
     uint32_t
     GetOverlaps();
 
+    template <class VISITOR>
+    uint32_t
+    VisitOverlaps(VISITOR &visitor,
+                  uint32_t batchSize = 1);
+
     /**
     \brief Get the bbox overlap results buffer
     \return A ptr to the internally asigned results buffer
@@ -183,6 +189,17 @@ public:
     {
     };
 
+    /**
+    \brief Gets the work done by the query since it was initialized.
+    \return The counters of the query, which are zero if query statistics are disabled.
+    \see QueryStats
+    */
+    const QueryCounters &
+    GetCounters() const
+    {
+        return m_counters;
+    }
+
     /**
     \brief
     Initializes a new bounding box query with the input volumes to test and the query bbox.
@@ -225,6 +242,8 @@ public:
         //reset status
         m_flags = 0;
 
+        m_counters.Reset();
+
     }
 
     /**
@@ -310,6 +329,9 @@ public:
     //Flags used to track things like stack and result buffer overflow
     uint32_t    m_flags;
 
+    //Work done by the query
+    QueryCounters m_counters;
+
     // Space for storing state to allow restarting when the result buffer is full.
     union
     {
@@ -317,6 +339,77 @@ public:
     };
 };
 
+
+/**
+\brief Streams the overlapping primitives to a visitor, without a caller side results buffer.
+
+The visitor is a function object, inlined by the compiler, which is called for each overlapping
+primitive as it is found:
+\code
+RwpBool operator()(const VolRef &vRef);
+\endcode
+Returning FALSE stops the query immediately. The VolRef, and any instanced volume it refers to, is only
+valid for the duration of the call.
+
+Overlaps are produced in batches of \a batchSize using the internal buffers of the query, which are
+reused for each batch, and any buffer overflow is resumed using the query restart data. A batch size of
+one gives the earliest stop, which suits "any overlap" probes. Larger batches reduce the cost of resuming
+the traversal when every overlap is wanted. Since results are consumed as they are produced, a query
+initialized with small buffers can visit any number of overlaps.
+
+\code
+struct AnySolid
+{
+    RwpBool operator()(const VolRef &vRef)
+    {
+        m_found = IsSolid(vRef);
+        return !m_found;
+    }
+    RwpBool m_found;
+};
+
+bboxQuery->InitQuery(volumeArray, volumeMtxPtrArray, numVols, aabb);
+AnySolid visitor = { FALSE };
+bboxQuery->VisitOverlaps(visitor);
+\endcode
+
+To restart with a new query, call VolumeBBoxQuery::InitQuery.
+
+\param visitor   Function object called for each overlapping primitive.
+\param batchSize Maximum number of overlaps found before the visitor is called, clamped to the size of the
+                 results buffer of the query.
+
+\return The number of overlaps visited.
+*/
+template <class VISITOR>
+uint32_t
+VolumeBBoxQuery::VisitOverlaps(VISITOR &visitor,
+                               uint32_t batchSize /* = 1 */)
+{
+    // Limit each batch by shrinking the results buffer for the duration of the query
+    const uint32_t primBufferSize = m_primBufferSize;
+    m_primBufferSize = (batchSize == 0) ? 1u : ((batchSize < primBufferSize) ? batchSize : primBufferSize);
+
+    uint32_t numVisited = 0;
+    while (!Finished())
+    {
+        const uint32_t numRes = GetOverlaps();
+        for (uint32_t i = 0; i < numRes; ++i)
+        {
+            ++numVisited;
+            if (!visitor(m_primVRefBuffer[i]))
+            {
+                m_primBufferSize = primBufferSize;
+                return numVisited;
+            }
+        }
+    }
+
+    m_primBufferSize = primBufferSize;
+    return numVisited;
+}
+
+
 } // namespace collision
 } // namespace rw
 
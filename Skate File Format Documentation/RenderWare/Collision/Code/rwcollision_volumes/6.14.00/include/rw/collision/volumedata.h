@@ -71,6 +71,7 @@ enum ObjectType
     RWCOBJECTTYPE_TRIANGLECLUSTERPROCEDURAL= RWCOLLISION_VOLUMES_MAKEOBJECTTYPE(RWCOLLISION_VOLUMES_COMPONENTID, 0x0F), ///< Clustered Mesh Cluster Procedural Aggregate
 
     RWCOBJECTTYPE_SCALEDCLUSTEREDMESH      = RWCOLLISION_VOLUMES_MAKEOBJECTTYPE(RWCOLLISION_VOLUMES_COMPONENTID, 0x10), ///< Scaled Clustered Mesh Procedural Aggregate \ref rw::collision::ScaledClusteredMesh
+    RWCOBJECTTYPE_HEIGHTFIELDPROCEDURAL    = RWCOLLISION_VOLUMES_MAKEOBJECTTYPE(RWCOLLISION_VOLUMES_COMPONENTID, 0x11), ///< HeightField Procedural Aggregate \ref rw::collision::HeightFieldProcedural
 
     // note: When adding a new type here, remember to update rw::collision::GetCollisionTypeName
     //       in rwcgraphcollisionobject.hpp
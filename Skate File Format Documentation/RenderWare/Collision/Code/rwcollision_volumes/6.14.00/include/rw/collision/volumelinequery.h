@@ -13,6 +13,7 @@
 #include "rw/collision/volumedata.h"
 #include "rw/collision/volume.h"
 #include "rw/collision/aabbox.h"
+#include "rw/collision/metrics.h"
 #include "rw/collision/detail/querydata.h"
 
 namespace rw
@@ -200,6 +201,11 @@ public:
     VolumeLineSegIntersectResult *
     GetNearestIntersection();
 
+    template <class VISITOR>
+    uint32_t
+    VisitIntersections(VISITOR &visitor,
+                       uint32_t batchSize = 1);
+
     /**
     \brief Get intersection result buffer.
 
@@ -250,6 +256,17 @@ public:
     };
 
 
+    /**
+    \brief Gets the work done by the query since it was initialized.
+    \return The counters of the query, which are zero if query statistics are disabled.
+    \see QueryStats
+    */
+    const QueryCounters &
+    GetCounters() const
+    {
+        return m_counters;
+    }
+
     /**
     \brief Initialize a line segment query.
 
@@ -301,6 +318,8 @@ public:
         m_tag = 0;
         m_numTagBits = 0;
 
+        m_counters.Reset();
+
     }
 
 
@@ -392,6 +411,9 @@ public:
     uint32_t    m_tag;
     uint8_t    m_numTagBits;
 
+    //Work done by the query
+    QueryCounters m_counters;
+
     // Space for storing state to allow restarting when the result buffer is full.
     union
     {
@@ -400,7 +422,105 @@ public:
 };
 
 
+/**
+\brief Streams the intersections of the line to a visitor, without a caller side results buffer.
+
+The visitor is a function object, inlined by the compiler, which is called for each intersection as
+it is found:
+\code
+RwpBool operator()(const VolumeLineSegIntersectResult &result, float &endClip);
+\endcode
+Returning FALSE stops the query immediately. Reducing \a endClip clips the end of the line, as a line
+parameter, so that the remaining traversal of spatial maps skips anything beyond it and later
+intersections beyond it are not visited. The result, and any volume it refers to, is only valid for the
+duration of the call.
+
+Intersections are produced in batches of \a batchSize using the internal buffers of the query, which are
+reused for each batch, and any buffer overflow is resumed using the query restart data. A batch size of
+one gives the earliest stop and clipping, which suits "any hit" probes and nearest hit searches, at the
+cost of resuming the traversal after every intersection. Larger batches reduce that cost when every
+intersection is wanted. Since results are consumed as they are produced, a query initialized with small
+buffers can visit any number of intersections.
+
+\code
+struct NearestSolidHit
+{
+    RwpBool operator()(const VolumeLineSegIntersectResult &result, float &endClip)
+    {
+        if (IsSolid(result.vRef))
+        {
+            m_lineParam = result.lineParam;
+            endClip = result.lineParam;
+        }
+        return TRUE;
+    }
+    float m_lineParam;
+};
+
+volLineQuery->InitQuery(volumeArray, volumeMtxPtrArray, numVols, lineStart, lineEnd);
+NearestSolidHit visitor;
+volLineQuery->VisitIntersections(visitor);
+\endcode
+
+The results mode and buffer limit of the query are restored on return, so a query stopped by the visitor
+can be resumed with the buffered methods, such as GetAllIntersections. To restart with a new query, call
+VolumeLineQuery::InitQuery.
+
+\param visitor   Function object called for each intersection.
+\param batchSize Maximum number of intersections found before the visitor is called, clamped to the size
+                 of the results buffer of the query.
+
+\return The number of intersections visited.
+*/
+template <class VISITOR>
+uint32_t
+VolumeLineQuery::VisitIntersections(VISITOR &visitor,
+                                    uint32_t batchSize /* = 1 */)
+{
+    // Limit each batch by changing the results mode for the duration of the query
+    const QueryResultsSet resultsSet = m_resultsSet;
+    const uint32_t resMax = m_resMax;
+    m_resultsSet = ALLLINEINTERSECTIONS;
+    m_resMax = (batchSize == 0) ? 1u : ((batchSize < m_resBufferSize) ? batchSize : m_resBufferSize);
+
+    uint32_t numVisited = 0;
+    while (!Finished())
+    {
+        const uint32_t numRes = GetIntersections();
+        for (uint32_t i = 0; i < numRes; ++i)
+        {
+            const VolumeLineSegIntersectResult &res = m_resBuffer[i];
+
+            // Drop intersections found before the line was clipped
+            if (res.lineParam > m_endClipVal)
+            {
+                continue;
+            }
+
+            ++numVisited;
+            float endClip = m_endClipVal;
+            const RwpBool more = visitor(res, endClip);
+            if (endClip < m_endClipVal)
+            {
+                m_endClipVal = endClip;
+            }
+            if (!more)
+            {
+                m_resultsSet = resultsSet;
+                m_resMax = resMax;
+                return numVisited;
+            }
+        }
+    }
+
+    m_resultsSet = resultsSet;
+    m_resMax = resMax;
+    return numVisited;
+}
+
+
 } // namespace collision
 } // namespace rw
 
 #endif // PUBLIC_RW_COLLISION_VOLUMELINEQUERY_H
+
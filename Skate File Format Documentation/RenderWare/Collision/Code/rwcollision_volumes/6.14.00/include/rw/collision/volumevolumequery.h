@@ -15,6 +15,7 @@
 #include "rw/collision/volumedata.h"
 #include "rw/collision/volume.h"
 #include "rw/collision/aabbox.h"
+#include "rw/collision/metrics.h"
 
 namespace rw
 {
@@ -102,6 +103,17 @@ public:
     }
 
 
+    /**
+    \brief Gets the work done by the query since it was initialized.
+    \return The counters of the query, which are zero if query statistics are disabled.
+    \see QueryStats
+    */
+    const QueryCounters &
+    GetCounters() const
+    {
+        return m_counters;
+    }
+
     /**
     \brief Initializes a specific volume-volume query.
 
@@ -156,6 +168,8 @@ public:
 
         m_cullTable = cullTable;
 
+        m_counters.Reset();
+
     }
 
     //Input buffer
@@ -195,6 +209,9 @@ public:
     VolumeBBoxQuery *m_bBoxQueryBtoA;
 
 
+    // Work done by the query
+    QueryCounters m_counters;
+
 #ifdef RWMETRICS
 public:
     /**
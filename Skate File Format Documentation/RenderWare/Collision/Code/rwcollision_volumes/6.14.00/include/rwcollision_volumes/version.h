@@ -54,5 +54,6 @@ Major, minor and patch versions are defined and updated each release.
     RW_COLLISION_VOLUMES_CREATE_VERSION_NUMBER( RW_COLLISION_VOLUMES_VERSION_MAJOR, RW_COLLISION_VOLUMES_VERSION_MINOR, RW_COLLISION_VOLUMES_VERSION_PATCH )
 
 #define RWCOLLISION_VOLUMES_HASSCALEDCLUSTEREDMESH 1
+#define RWCOLLISION_VOLUMES_HASHEIGHTFIELDPROCEDURAL 1
 
 #endif // RW_COLLISION_VOLUMES_VERSION_H
@@ -31,12 +31,27 @@ void ClusterDataBuilder::Build(
     const UnitParameters & unitParameters,
     const float vertexCompressionGranularity)
 {
+    // Write the vertices in the order of their codes, if they have been given codes other than their vertex set order
+    UnitCluster::VertexSet orderedVertexIDs;
+    const UnitCluster::VertexSet *vertexIDs = &unitCluster.vertexIDs;
+
+    if (unitCluster.hasVertexCodes)
+    {
+        for (uint32_t vertexSetIndex = 0 ; vertexSetIndex < unitCluster.numVertices ; ++vertexSetIndex)
+        {
+            orderedVertexIDs[unitCluster.vertexCodes[vertexSetIndex]] = unitCluster.vertexIDs[vertexSetIndex];
+        }
+
+        vertexIDs = &orderedVertexIDs;
+    }
+
     WriteVertexDataToCluster(
         cluster,
-        unitCluster.vertexIDs,
+        *vertexIDs,
         unitCluster.numVertices,
         vertices,
         unitCluster.clusterOffset,
+        unitCluster.granularityShift,
         vertexCompressionGranularity);
 
     WriteUnitDataToCluster(
@@ -57,10 +72,11 @@ void ClusterDataBuilder::WriteVertexDataToCluster(
     const uint32_t vertexCount,
     const VertexList & vertices,
     const rw::collision::ClusteredMeshCluster::Vertex32 & clusterOffset,
+    const uint32_t granularityShift,
     const rwpmath::VecFloat & vertexCompressionGranularity)
 {
     // Write the vertex offset to the cluster
-    cluster.SetVertexOffset(clusterOffset);
+    cluster.SetVertexOffset(clusterOffset, granularityShift);
 
     // Write the UnitCluster's vertex collection to the cluster
     for (uint32_t vertexIndex = 0 ; vertexIndex < vertexCount ; ++vertexIndex)
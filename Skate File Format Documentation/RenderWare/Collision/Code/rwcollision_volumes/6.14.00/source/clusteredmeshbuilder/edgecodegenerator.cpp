@@ -39,8 +39,26 @@ void EdgeCodeGenerator::GenerateTriangleEdgeCodes(
     const TriangleNeighborsList & triangleNeighbors,
     const rwpmath::VecFloat & minConcaveEdgeCosine)
 {
-    const uint32_t numTriangles(triangleEdgeCodes.size());
-    for(uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+    GenerateTriangleEdgeCodes(
+        triangleEdgeCodes,
+        triangleEdgeCosines,
+        triangleNeighbors,
+        minConcaveEdgeCosine,
+        0u,
+        triangleEdgeCodes.size());
+}
+
+
+void EdgeCodeGenerator::GenerateTriangleEdgeCodes(
+    TriangleEdgeCodesList & triangleEdgeCodes,
+    const TriangleEdgeCosinesList & triangleEdgeCosines,
+    const TriangleNeighborsList & triangleNeighbors,
+    const rwpmath::VecFloat & minConcaveEdgeCosine,
+    const uint32_t begin,
+    const uint32_t end)
+{
+    EA_ASSERT(end <= triangleEdgeCodes.size());
+    for(uint32_t triangleIndex = begin; triangleIndex < end; ++triangleIndex)
     {
         TriangleEdgeCodes &edgeCodes = triangleEdgeCodes[triangleIndex];
         const TriangleEdgeCosines & tEdgeCosines = triangleEdgeCosines[triangleIndex];
@@ -0,0 +1,640 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+
+#include "rw/collision/clusteredmeshbakecache.h"
+
+#include "rw/collision/clusteredmeshofflinebuilder.h"
+
+#include "rw/collision/clusteredmesh.h"
+
+#include "coreallocator/icoreallocator_interface.h"
+
+
+namespace rw
+{
+namespace collision
+{
+
+
+namespace
+{
+
+
+/// The xxHash32 primes.
+const uint32_t PRIME1 = 2654435761u;
+const uint32_t PRIME2 = 2246822519u;
+const uint32_t PRIME3 = 3266489917u;
+const uint32_t PRIME4 = 668265263u;
+const uint32_t PRIME5 = 374761393u;
+
+
+/**
+\brief A 128 bit hash of a sequence of 32 bit words, computed as four interleaved lanes in the manner of
+xxHash32, each lane taking every fourth word, so that the lanes of a block of four words can be computed
+in parallel. The words are hashed as values, so the hash does not depend on the byte order of the host.
+*/
+class KeyHasher
+{
+public:
+
+    explicit KeyHasher(const uint32_t seed)
+        : m_numBufferedWords(0)
+        , m_numWords(0)
+    {
+        m_lanes[0] = seed + PRIME1 + PRIME2;
+        m_lanes[1] = seed + PRIME2;
+        m_lanes[2] = seed;
+        m_lanes[3] = seed - PRIME1;
+    }
+
+    void AddWord(const uint32_t word)
+    {
+        m_buffer[m_numBufferedWords++] = word;
+        ++m_numWords;
+        if (4u == m_numBufferedWords)
+        {
+            m_lanes[0] = Round(m_lanes[0], m_buffer[0]);
+            m_lanes[1] = Round(m_lanes[1], m_buffer[1]);
+            m_lanes[2] = Round(m_lanes[2], m_buffer[2]);
+            m_lanes[3] = Round(m_lanes[3], m_buffer[3]);
+            m_numBufferedWords = 0;
+        }
+    }
+
+    void AddFloat(const float value)
+    {
+        union
+        {
+            float f;
+            uint32_t u;
+        } bits;
+        bits.f = value;
+        AddWord(bits.u);
+    }
+
+    void AddBool(const bool value)
+    {
+        AddWord(value ? 1u : 0u);
+    }
+
+    void Finalize(ClusteredMeshBakeCache::Key &key)
+    {
+        // The words of a partial block are taken by the lanes in turn, and the total number of words,
+        // mixed into every lane, distinguishes them from a block padded with zeros.
+        for (uint32_t i = 0 ; i < m_numBufferedWords ; ++i)
+        {
+            m_lanes[i] = Round(m_lanes[i], m_buffer[i]);
+        }
+
+        uint32_t mixed[4];
+        for (uint32_t i = 0 ; i < 4u ; ++i)
+        {
+            mixed[i] = Avalanche(m_lanes[i] + m_numWords * PRIME5 + i * PRIME4);
+        }
+
+        // Mix the lanes, so that a change of any input word changes every word of the key.
+        for (uint32_t i = 0 ; i < 4u ; ++i)
+        {
+            key.words[i] = Avalanche(mixed[i]
+                ^ RotateLeft(mixed[(i + 1u) & 3u], 7u)
+                ^ RotateLeft(mixed[(i + 2u) & 3u], 13u)
+                ^ RotateLeft(mixed[(i + 3u) & 3u], 19u));
+        }
+    }
+
+private:
+
+    static uint32_t RotateLeft(const uint32_t value, const uint32_t shift)
+    {
+        return (value << shift) | (value >> (32u - shift));
+    }
+
+    static uint32_t Round(uint32_t accumulator, const uint32_t word)
+    {
+        accumulator += word * PRIME2;
+        accumulator = RotateLeft(accumulator, 13u);
+        return accumulator * PRIME1;
+    }
+
+    static uint32_t Avalanche(uint32_t hash)
+    {
+        hash ^= hash >> 15;
+        hash *= PRIME2;
+        hash ^= hash >> 13;
+        hash *= PRIME3;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    /// The four lane accumulators.
+    uint32_t m_lanes[4];
+    /// The words of the current partial block.
+    uint32_t m_buffer[4];
+    /// Number of words in the current partial block.
+    uint32_t m_numBufferedWords;
+    /// Total number of words hashed.
+    uint32_t m_numWords;
+};
+
+
+} // namespace
+
+
+/**
+\brief Tests whether two keys are equal.
+*/
+bool
+ClusteredMeshBakeCache::Key::operator == (const Key &other) const
+{
+    return (words[0] == other.words[0]) &&
+           (words[1] == other.words[1]) &&
+           (words[2] == other.words[2]) &&
+           (words[3] == other.words[3]);
+}
+
+
+/**
+\brief Orders keys by their words, most significant first.
+*/
+bool
+ClusteredMeshBakeCache::Key::operator < (const Key &other) const
+{
+    for (uint32_t i = 0 ; i < 4u ; ++i)
+    {
+        if (words[i] != other.words[i])
+        {
+            return words[i] < other.words[i];
+        }
+    }
+
+    return false;
+}
+
+
+/**
+\brief Writes the key as 32 lower case hexadecimal digits followed by a terminator.
+
+\param buffer the output, of at least STRING_SIZE characters.
+*/
+void
+ClusteredMeshBakeCache::Key::ToString(char *buffer) const
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (uint32_t i = 0 ; i < 4u ; ++i)
+    {
+        for (uint32_t digit = 0 ; digit < 8u ; ++digit)
+        {
+            buffer[i * 8u + digit] = digits[(words[i] >> (28u - 4u * digit)) & 0xfu];
+        }
+    }
+
+    buffer[STRING_SIZE - 1] = '\0';
+}
+
+
+/**
+\brief Reads a key from the 32 hexadecimal digits written by ToString, in either case.
+
+\param string the input, terminated after the digits.
+\return true if the string was a key, false if not, in which case the key is unchanged.
+*/
+bool
+ClusteredMeshBakeCache::Key::FromString(const char *string)
+{
+    uint32_t readWords[4] = { 0, 0, 0, 0 };
+
+    for (uint32_t i = 0 ; i < STRING_SIZE - 1u ; ++i)
+    {
+        const char c = string[i];
+        uint32_t value = 0;
+        if (c >= '0' && c <= '9')
+        {
+            value = static_cast<uint32_t>(c - '0');
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            value = static_cast<uint32_t>(c - 'a') + 10u;
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            value = static_cast<uint32_t>(c - 'A') + 10u;
+        }
+        else
+        {
+            return false;
+        }
+
+        readWords[i / 8u] = (readWords[i / 8u] << 4u) | value;
+    }
+
+    if (string[STRING_SIZE - 1] != '\0')
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0 ; i < 4u ; ++i)
+    {
+        words[i] = readWords[i];
+    }
+
+    return true;
+}
+
+
+/**
+\brief Constructs a cache of the meshes held by a Store.
+
+\param store the Store of the built meshes.
+\param maxEntries the maximum number of entries, at least one.
+\param maxTotalSize the maximum total stored size of the entries, or zero for no limit.
+\param allocator the allocator of the cache index and of the meshes returned by BuildClusteredMesh.
+*/
+ClusteredMeshBakeCache::ClusteredMeshBakeCache(Store &store,
+                                               uint32_t maxEntries,
+                                               uint32_t maxTotalSize,
+                                               EA::Allocator::ICoreAllocator *allocator)
+    : m_store(store)
+    , m_allocator(allocator)
+    , m_entries(NULL)
+    , m_numEntries(0)
+    , m_maxEntries(maxEntries)
+    , m_maxTotalSize(maxTotalSize)
+    , m_totalSize(0)
+    , m_time(0)
+{
+    EA_ASSERT_MSG(maxEntries > 0, ("The cache must allow at least one entry."));
+
+    m_entries = reinterpret_cast<Entry *>(m_allocator->Alloc(sizeof(Entry) * (m_maxEntries + 1u), NULL, 0, 4u));
+    if (NULL == m_entries)
+    {
+        EAPHYSICS_MESSAGE("Unable to allocate the bake cache index.");
+        m_maxEntries = 0;
+    }
+}
+
+
+/**
+\brief Destructor. The entries remain in the Store.
+*/
+ClusteredMeshBakeCache::~ClusteredMeshBakeCache()
+{
+    if (NULL != m_entries)
+    {
+        m_allocator->Free(m_entries);
+    }
+}
+
+
+/**
+\brief Computes the key of a build.
+
+The parallelDispatcher of the parameters is not included, since the built mesh does not depend on it. The
+versions of the builder and of the serialization of the mesh are included, so that changing either gives
+new keys.
+
+\param key the computed key.
+\param input the input of the build.
+\param builderParams the parameters of the build.
+*/
+void
+ClusteredMeshBakeCache::ComputeKey(Key &key, const Input &input, const Parameters &builderParams)
+{
+    KeyHasher hasher(FORMAT_VERSION);
+
+    hasher.AddWord(meshbuilder::detail::ClusteredMeshBuilder::BUILDER_VERSION);
+    hasher.AddWord(rwcCLUSTEREDMESH_SERIALIZATION_VERSION);
+    hasher.AddWord(rwcCLUSTEREDMESHCLUSTER_SERIALIZATION_VERSION);
+
+    hasher.AddWord(input.numTriangles);
+    hasher.AddWord(input.numVertices);
+    hasher.AddWord(input.numMergePlanes);
+
+    for (uint32_t vertexIndex = 0 ; vertexIndex < input.numVertices ; ++vertexIndex)
+    {
+        const rw::math::fpu::Vector3U_32 &vertex = input.vertices[vertexIndex];
+        hasher.AddFloat(vertex.GetX());
+        hasher.AddFloat(vertex.GetY());
+        hasher.AddFloat(vertex.GetZ());
+    }
+
+    for (uint32_t triangleIndex = 0 ; triangleIndex < input.numTriangles ; ++triangleIndex)
+    {
+        hasher.AddWord(input.triangleVertexIndices[3u * triangleIndex]);
+        hasher.AddWord(input.triangleVertexIndices[3u * triangleIndex + 1u]);
+        hasher.AddWord(input.triangleVertexIndices[3u * triangleIndex + 2u]);
+        hasher.AddWord((NULL != input.triangleGroupIDs) ? input.triangleGroupIDs[triangleIndex] : 0u);
+        hasher.AddWord((NULL != input.triangleSurfaceIDs) ? input.triangleSurfaceIDs[triangleIndex] : 0u);
+    }
+
+    for (uint32_t planeIndex = 0 ; planeIndex < input.numMergePlanes ; ++planeIndex)
+    {
+        const rwpmath::Vector3 &normal = input.mergePlaneNormals[planeIndex];
+        hasher.AddFloat(static_cast<float>(normal.GetX()));
+        hasher.AddFloat(static_cast<float>(normal.GetY()));
+        hasher.AddFloat(static_cast<float>(normal.GetZ()));
+        hasher.AddFloat(static_cast<float>(input.mergePlaneDistances[planeIndex]));
+    }
+
+    hasher.AddBool(builderParams.vertexCompression_Enable);
+    hasher.AddFloat(builderParams.vertexCompression_Granularity);
+    hasher.AddBool(builderParams.vertexCompression_Adaptive);
+    hasher.AddFloat(builderParams.vertexCompression_MaxError);
+    hasher.AddBool(builderParams.oldTriangles_Enable);
+    hasher.AddBool(builderParams.edgeAngles_Enable);
+    hasher.AddBool(builderParams.quads_Enable);
+    hasher.AddWord(builderParams.kdTreeBuilder_SplitThreshold);
+    hasher.AddFloat(builderParams.kdTreeBuilder_LargeItemThreshold);
+    hasher.AddFloat(builderParams.kdTreeBuilder_MinChildEntriesThreshold);
+    hasher.AddWord(builderParams.kdTreeBuilder_MaxEntriesPerNode);
+    hasher.AddFloat(builderParams.kdTreeBuilder_MinSimilarAreaThreshold);
+    hasher.AddWord(builderParams.groupId_NumBytes);
+    hasher.AddWord(builderParams.groupId_Default);
+    hasher.AddWord(builderParams.surfaceId_NumBytes);
+    hasher.AddWord(builderParams.surfaceId_Default);
+    hasher.AddBool(builderParams.vertexMerge_Enable);
+    hasher.AddFloat(builderParams.vertexMerge_DistanceTolerance);
+    hasher.AddBool(builderParams.vertexMerge_ScaleTolerance);
+    hasher.AddBool(builderParams.internalTriangleRemoval_Enabled);
+    hasher.AddBool(builderParams.edgeCosineCorrection_Enabled);
+    hasher.AddBool(builderParams.vertexSmoothing_Enabled);
+    hasher.AddWord(builderParams.parallelDispatcher_WorkerArenaSize);
+    hasher.AddBool(builderParams.incrementalUpdate_Enable);
+    hasher.AddBool(builderParams.unitOrdering_Enable);
+
+    hasher.Finalize(key);
+}
+
+
+/**
+\brief Returns the ClusteredMesh of a build, loaded from the Store if the build is cached, and otherwise
+built and saved to the Store, evicting the least recently used entries as needed.
+
+An entry which cannot be loaded is removed from the Store and rebuilt. A mesh which cannot be saved is
+still returned.
+
+\param input the input of the build.
+\param builderParams the parameters of the build.
+\return the ClusteredMesh, allocated from the cache allocator, or NULL if it could not be built.
+*/
+rw::collision::ClusteredMesh *
+ClusteredMeshBakeCache::BuildClusteredMesh(const Input &input, Parameters &builderParams)
+{
+    Key key;
+    ComputeKey(key, input, builderParams);
+
+    ++m_time;
+    ++m_statistics.numLookups;
+
+    uint32_t entryIndex = 0;
+    if (FindEntry(key, entryIndex))
+    {
+        ClusteredMesh *clusteredMesh = m_store.Load(key, *m_allocator);
+        if (NULL != clusteredMesh)
+        {
+            ++m_statistics.numHits;
+            m_entries[entryIndex].lastUse = m_time;
+            return clusteredMesh;
+        }
+
+        EAPHYSICS_MESSAGE("A bake cache entry could not be loaded, and will be rebuilt.");
+        ++m_statistics.numFailedLoads;
+        m_store.Remove(key);
+        RemoveEntry(entryIndex);
+    }
+
+    ++m_statistics.numMisses;
+
+    // Build the mesh
+    ClusteredMeshOfflineBuilder offlineBuilder(input.numTriangles,
+                                               input.numVertices,
+                                               input.numMergePlanes,
+                                               builderParams,
+                                               m_allocator);
+
+    for (uint32_t vertexIndex = 0 ; vertexIndex < input.numVertices ; ++vertexIndex)
+    {
+        offlineBuilder.SetVertex(vertexIndex, input.vertices[vertexIndex]);
+    }
+
+    for (uint32_t triangleIndex = 0 ; triangleIndex < input.numTriangles ; ++triangleIndex)
+    {
+        offlineBuilder.SetTriangle(triangleIndex,
+                                   input.triangleVertexIndices[3u * triangleIndex],
+                                   input.triangleVertexIndices[3u * triangleIndex + 1u],
+                                   input.triangleVertexIndices[3u * triangleIndex + 2u],
+                                   (NULL != input.triangleGroupIDs) ? input.triangleGroupIDs[triangleIndex] : 0u,
+                                   (NULL != input.triangleSurfaceIDs) ? input.triangleSurfaceIDs[triangleIndex] : 0u);
+    }
+
+    for (uint32_t planeIndex = 0 ; planeIndex < input.numMergePlanes ; ++planeIndex)
+    {
+        offlineBuilder.SetMergePlane(planeIndex, input.mergePlaneNormals[planeIndex], input.mergePlaneDistances[planeIndex]);
+    }
+
+    ClusteredMesh *clusteredMesh = offlineBuilder.BuildClusteredMesh();
+    offlineBuilder.Release();
+
+    if (NULL == clusteredMesh)
+    {
+        return NULL;
+    }
+
+    // Save it to the Store
+    uint32_t storedSize = 0;
+    if (m_maxEntries > 0 && m_store.Save(key, *clusteredMesh, storedSize))
+    {
+        ++m_statistics.numStores;
+        FindEntry(key, entryIndex);
+        InsertEntry(key, storedSize, entryIndex);
+        EvictEntries();
+    }
+    else
+    {
+        ++m_statistics.numFailedStores;
+    }
+
+    return clusteredMesh;
+}
+
+
+/**
+\brief Adds an entry of the Store to the cache index, with the time of its last use, evicting the least
+recently used entries as needed. Used to restore the index of a persistent Store.
+
+The time of last use is that read from GetEntry when the index was saved. The cache time continues from the
+latest time registered, so that the entries used after they are registered are the most recently used.
+
+\param key the key of the entry.
+\param size the size the entry was stored with.
+\param lastUse the time of the last use of the entry.
+\return true if the entry was added, false if it was already indexed.
+*/
+bool
+ClusteredMeshBakeCache::RegisterEntry(const Key &key, uint32_t size, uint32_t lastUse)
+{
+    uint32_t entryIndex = 0;
+    if (m_maxEntries == 0 || FindEntry(key, entryIndex))
+    {
+        return false;
+    }
+
+    if (lastUse > m_time)
+    {
+        m_time = lastUse;
+    }
+
+    InsertEntry(key, size, entryIndex);
+    m_entries[entryIndex].lastUse = lastUse;
+    EvictEntries();
+
+    return true;
+}
+
+
+/**
+\brief Returns the number of entries in the cache index.
+*/
+uint32_t
+ClusteredMeshBakeCache::GetNumEntries() const
+{
+    return m_numEntries;
+}
+
+
+/**
+\brief Returns an entry of the cache index. The entries are sorted by key.
+*/
+const ClusteredMeshBakeCache::Entry &
+ClusteredMeshBakeCache::GetEntry(uint32_t entryIndex) const
+{
+    EA_ASSERT(entryIndex < m_numEntries);
+    return m_entries[entryIndex];
+}
+
+
+/**
+\brief Returns the total stored size of the entries of the cache index.
+*/
+uint32_t
+ClusteredMeshBakeCache::GetTotalSize() const
+{
+    return m_totalSize;
+}
+
+
+/**
+\brief Returns the counts of the cache operations.
+*/
+const ClusteredMeshBakeCache::Statistics &
+ClusteredMeshBakeCache::GetStatistics() const
+{
+    return m_statistics;
+}
+
+
+/**
+\brief Resets the counts of the cache operations to zero.
+*/
+void
+ClusteredMeshBakeCache::ResetStatistics()
+{
+    m_statistics = Statistics();
+}
+
+
+/**
+\brief Finds the entry of a key by binary search of the sorted entries.
+
+\param key the key to find.
+\param entryIndex the index of the entry, or the index at which it would be inserted if not found.
+\return true if the key was found.
+*/
+bool
+ClusteredMeshBakeCache::FindEntry(const Key &key, uint32_t &entryIndex) const
+{
+    uint32_t first = 0;
+    uint32_t last = m_numEntries;
+    while (first < last)
+    {
+        const uint32_t middle = first + (last - first) / 2u;
+        if (m_entries[middle].key < key)
+        {
+            first = middle + 1u;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    entryIndex = first;
+    return (first < m_numEntries) && (m_entries[first].key == key);
+}
+
+
+/**
+\brief Inserts an entry, used now, at its sorted index.
+*/
+void
+ClusteredMeshBakeCache::InsertEntry(const Key &key, uint32_t size, uint32_t entryIndex)
+{
+    EA_ASSERT(m_numEntries <= m_maxEntries);
+
+    for (uint32_t i = m_numEntries ; i > entryIndex ; --i)
+    {
+        m_entries[i] = m_entries[i - 1u];
+    }
+
+    m_entries[entryIndex].key = key;
+    m_entries[entryIndex].size = size;
+    m_entries[entryIndex].lastUse = m_time;
+
+    ++m_numEntries;
+    m_totalSize += size;
+}
+
+
+/**
+\brief Removes an entry from the cache index.
+*/
+void
+ClusteredMeshBakeCache::RemoveEntry(uint32_t entryIndex)
+{
+    m_totalSize -= m_entries[entryIndex].size;
+    --m_numEntries;
+
+    for (uint32_t i = entryIndex ; i < m_numEntries ; ++i)
+    {
+        m_entries[i] = m_entries[i + 1u];
+    }
+}
+
+
+/**
+\brief Evicts the least recently used entries, removing them from the Store, until the number and the
+total size of the entries are within the limits of the cache.
+*/
+void
+ClusteredMeshBakeCache::EvictEntries()
+{
+    while ((m_numEntries > m_maxEntries) || ((m_maxTotalSize > 0) && (m_totalSize > m_maxTotalSize)))
+    {
+        uint32_t oldestIndex = 0;
+        for (uint32_t i = 1 ; i < m_numEntries ; ++i)
+        {
+            if (m_entries[i].lastUse < m_entries[oldestIndex].lastUse)
+            {
+                oldestIndex = i;
+            }
+        }
+
+        m_store.Remove(m_entries[oldestIndex].key);
+        RemoveEntry(oldestIndex);
+        ++m_statistics.numEvictions;
+    }
+}
+
+
+} // namespace collision
+} // namespace rw
@@ -3,6 +3,12 @@
 
 #include <stdio.h>
 
+#include <EASTL/sort.h>
+#include <EASTL/algorithm.h>
+
+#include <rw/collision/kdtreebboxquery.h>
+#include <rw/collision/kdsubtree.h>
+
 #include <rw/collision/meshbuilder/detail/clusteredmeshbuilder.h>
 
 #include <rw/collision/meshbuilder/vertexmerger.h>
@@ -14,8 +20,11 @@
 #include <rw/collision/meshbuilder/detail/clusterparametersbuilder.h>
 #include <rw/collision/meshbuilder/detail/gridspatialmap.h>
 #include <rw/collision/meshbuilder/detail/clusteredmeshbuildermethods.h>
+#include <rw/collision/meshbuilder/detail/unitclusterbuilder.h>
 #include <rw/collision/meshbuilder/detail/vertextrianglemap.h>
 #include <rw/collision/meshbuilder/detail/triangleneighborfinder.h>
+#include <rw/collision/meshbuilder/detail/workerallocators.h>
+#include <rw/collision/meshbuilder/detail/linearallocator.h>
 
 
 namespace rw
@@ -34,6 +43,152 @@ These are used internally.
 */
 #define CLUSTEREDMESHBUILDER_NOGROUP 0xfffffffe  // default box-group id
 #define CLUSTEREDMESHBUILDER_TRIMMED 0xfffffffd  // flag to remove a triangle from a box-group
+#define CLUSTEREDMESHBUILDER_NOUNIT  0xffffffff  // unit index of a triangle which is in no unit
+#define CLUSTEREDMESHBUILDER_NOLEAF  0xffffffff  // leaf reference of a unit not found in the KDTree
+
+
+namespace
+{
+
+/// Number of triangles in each range of the parallel edge code generation.
+const uint32_t EDGECODES_GRAINSIZE = 4096u;
+
+/// Number of clusters in each range of the parallel cluster writing.
+const uint32_t CLUSTERS_GRAINSIZE = 4u;
+
+// TODO: This value is arbitary, needs to be replaced with an estimate or user set value.
+/// Maximum number of entries of the grid spatial map used to fix unmatched edges.
+const uint32_t FIXUNMATCHEDEDGES_MAXINPUTS = 3000u;
+
+/// Resolution of the grid spatial map used to fix unmatched edges.
+const uint32_t FIXUNMATCHEDEDGES_GRIDRESOLUTION = 16u;
+
+struct EdgeCodesContext
+{
+    TriangleEdgeCodesList *triangleEdgeCodes;
+    const TriangleEdgeCosinesList *triangleEdgeCosines;
+    const TriangleNeighborsList *triangleNeighbors;
+    float minConcaveEdgeCosine;
+};
+
+void GenerateEdgeCodesInRange(void *contextPtr, uint32_t /*workerIndex*/, uint32_t begin, uint32_t end)
+{
+    const EdgeCodesContext &context = *static_cast<const EdgeCodesContext *>(contextPtr);
+    EdgeCodeGenerator::GenerateTriangleEdgeCodes(
+        *context.triangleEdgeCodes,
+        *context.triangleEdgeCosines,
+        *context.triangleNeighbors,
+        rwpmath::VecFloat(context.minConcaveEdgeCosine),
+        begin,
+        end);
+}
+
+/**
+A runtime cluster and the unit cluster from which it is written.
+*/
+struct ClusterToWrite
+{
+    rw::collision::ClusteredMeshCluster *cluster;
+    const UnitCluster *unitCluster;
+};
+
+struct WriteClustersContext
+{
+    const ClusteredMeshBuilder *builder;
+    const ClusterToWrite *clusters;
+};
+
+void WriteClustersInRange(void *contextPtr, uint32_t /*workerIndex*/, uint32_t begin, uint32_t end)
+{
+    const WriteClustersContext &context = *static_cast<const WriteClustersContext *>(contextPtr);
+    for (uint32_t clusterIndex = begin; clusterIndex < end; ++clusterIndex)
+    {
+        context.builder->InitializeCluster(context.clusters[clusterIndex].cluster, *context.clusters[clusterIndex].unitCluster);
+    }
+}
+
+/**
+Sorts a list of IDs into ascending order and removes the duplicates.
+*/
+void SortAndRemoveDuplicateIDs(IDList &ids)
+{
+    const uint32_t numIDs = ids.size();
+    if (numIDs < 2u)
+    {
+        return;
+    }
+
+    uint32_t *const first = &ids[0];
+    eastl::sort(first, first + numIDs);
+
+    uint32_t numUnique = 1u;
+    for (uint32_t index = 1u; index < numIDs; ++index)
+    {
+        if (first[index] != first[numUnique - 1u])
+        {
+            first[numUnique++] = first[index];
+        }
+    }
+
+    ids.resize(numUnique);
+}
+
+/**
+Returns the index of an ID in a sorted list of IDs, or the size of the list if it is not there.
+*/
+uint32_t FindSortedID(const IDList &ids, const uint32_t id)
+{
+    const uint32_t numIDs = ids.size();
+    if (numIDs == 0u)
+    {
+        return 0u;
+    }
+
+    const uint32_t *const first = &ids[0];
+    const uint32_t *const found = eastl::lower_bound(first, first + numIDs, id);
+    return (found != first + numIDs && *found == id) ? static_cast<uint32_t>(found - first) : numIDs;
+}
+
+bool ContainsSortedID(const IDList &ids, const uint32_t id)
+{
+    return FindSortedID(ids, id) != ids.size();
+}
+
+/**
+Returns a key identifying the edge between two vertices, independent of the direction of the edge.
+*/
+uint64_t GetEdgeKey(const uint32_t vertex0, const uint32_t vertex1)
+{
+    return (vertex0 < vertex1) ?
+        ((static_cast<uint64_t>(vertex0) << 32) | vertex1) :
+        ((static_cast<uint64_t>(vertex1) << 32) | vertex0);
+}
+
+rw::collision::AABBox GetEmptyBBox()
+{
+    return rw::collision::AABBox(
+        rwpmath::Vector3(rwpmath::MAX_FLOAT, rwpmath::MAX_FLOAT, rwpmath::MAX_FLOAT),
+        rwpmath::Vector3(-rwpmath::MAX_FLOAT, -rwpmath::MAX_FLOAT, -rwpmath::MAX_FLOAT));
+}
+
+void AddTriangleToBBox(rw::collision::AABBox &bbox, const Triangle &triangle, const VertexList &vertices)
+{
+    for (uint32_t corner = 0; corner < 3; ++corner)
+    {
+        const VectorType &vertex = vertices[triangle.vertices[corner]];
+        bbox.Union(rwpmath::Vector3(vertex.GetX(), vertex.GetY(), vertex.GetZ()));
+    }
+}
+
+/**
+Returns the memory used by a block allocated from a LinearAllocator, from a position aligned to four bytes.
+*/
+uint32_t GetAllocationSize(const uint32_t size, const uint32_t alignment = 4u)
+{
+    return EA::Physics::SizeAlign<uint32_t>(size, 4u) + (alignment - 4u);
+}
+
+} // namespace
 
 
 /**
@@ -65,6 +220,7 @@ ClusteredMeshBuilder::ClusteredMeshBuilder(
   m_unitAABBoxList(NULL),
   m_unitAABBoxListBuffer(NULL),
   m_numTriangles(numTri),
+  m_firstBorderTriangle(numTri),
   m_vertAABBox(
       0.0f, 0.0f, 0.0f,
       0.0f, 0.0f, 0.0f),
@@ -75,9 +231,25 @@ ClusteredMeshBuilder::ClusteredMeshBuilder(
   m_maximumEdgeCosineMergeTolerance(0.1f),
   m_concaveCosineTolerance(0.15f),
   m_cosineTolerance(0.05f),
+  m_adaptiveCompression(false),
+  m_maxGranularityShift(0),
   m_isBuilderValid(true),
+  m_triangleUnits(0),
+  m_unitEntries(0),
+  m_clusterFirstUnits(0),
+  m_unitClusters(NULL),
+  m_unitClusterIDShift(16u),
+  m_kdTreeChildBBoxes(NULL),
+  m_incrementalUpdateDataRetained(false),
+  m_memoryReport(),
+  m_buildStage(BUILDSTAGE_INPUT),
+  m_memoryBaseline(0),
   m_allocator(allocator)
 {
+    // Track the memory used by the builder from here on
+    m_allocator->ResetTrackedPeakMemoryUsed();
+    m_memoryBaseline = m_allocator->GetTrackedPeakMemoryUsed();
+
     // Initialize the vertex bounding box to an inverted box
     const rwpmath::VecFloat max = rwpmath::GetVecFloat_MaxValue();
     m_vertAABBox.m_min = AABBoxType::Vector3Type(max, max, max);
@@ -127,6 +299,8 @@ ClusteredMeshBuilder::ClusteredMeshBuilder(
     m_triangleSurfaceIDs->resize(m_numTriangles);
     m_triangleGroupIDs->resize(m_numTriangles);
     m_triangleEdgeCodes->resize(m_numTriangles);
+
+    EndBuildStage();
 }
 
 
@@ -146,6 +320,9 @@ ClusteredMeshBuilder::~ClusteredMeshBuilder()
 void
 ClusteredMeshBuilder::Release()
 {
+    // Free any data kept for incremental updates
+    ReleaseIncrementalUpdateData();
+
     // Free long-term vertex and triangle containers
     TriangleEdgeCodesList::Free(m_allocator, m_triangleEdgeCodes);
     TriangleGroupIDList::Free(m_allocator, m_triangleGroupIDs);
@@ -168,6 +345,28 @@ ClusteredMeshBuilder::BuildClusteredMesh(
 {
     rw::collision::ClusteredMesh *clusteredMesh = NULL;
 
+    // Free any data kept for incremental updates of a previously built mesh
+    ReleaseIncrementalUpdateData();
+
+    // The incremental update does not repeat the passes which look beyond the neighbors of a triangle
+    if (buildParams.incrementalUpdate_Enable &&
+        (mergePlaneCount > 0u ||
+         buildParams.edgeCosineCorrection_Enabled ||
+         buildParams.vertexSmoothing_Enabled ||
+         buildParams.internalTriangleRemoval_Enabled))
+    {
+        EAPHYSICS_MESSAGE("Incremental update is not supported with merge planes, edge cosine correction, vertex smoothing or internal triangle removal.");
+        buildParams.incrementalUpdate_Enable = false;
+    }
+
+    // Forget the memory use of any previous build
+    for (uint32_t stage = BUILDSTAGE_VERTEXMERGE; stage < BUILDSTAGE_COUNT; ++stage)
+    {
+        m_memoryReport.stagePeaks[stage] = 0;
+    }
+    m_buildStage = BUILDSTAGE_COUNT;
+    BeginBuildStage(BUILDSTAGE_VERTEXMERGE);
+
     // Set Cluster Options
 
     // Set unit flags
@@ -186,7 +385,9 @@ ClusteredMeshBuilder::BuildClusteredMesh(
         buildParams.vertexCompression_Granularity,
         static_cast<uint16_t>(unitFlags),
         static_cast<uint8_t>(buildParams.groupId_NumBytes),
-        static_cast<uint8_t>(buildParams.surfaceId_NumBytes));
+        static_cast<uint8_t>(buildParams.surfaceId_NumBytes),
+        buildParams.vertexCompression_Adaptive,
+        buildParams.vertexCompression_MaxError);
 
     // Adjust Edge Length Tolerance
     if (buildParams.vertexMerge_ScaleTolerance)
@@ -198,11 +399,13 @@ ClusteredMeshBuilder::BuildClusteredMesh(
     }
 
     // Merge Vertices
-    MergeVertexGroups(buildParams.vertexMerge_Enable);
+    MergeVertexGroups(buildParams.vertexMerge_Enable, buildParams.parallelDispatcher);
 
     if (!IsBuilderValid())
         return clusteredMesh;
 
+    BeginBuildStage(BUILDSTAGE_ADJACENCY);
+
     // Mark permanent heap and allocate triangle adjacency data containers
     m_allocator->Mark(EA::Allocator::MEM_PERM);
 
@@ -235,7 +438,8 @@ ClusteredMeshBuilder::BuildClusteredMesh(
     const uint32_t numValidTriangles = ClusteredMeshBuilderMethods::ValidateTriangles(
                                            *m_triangleFlags,
                                            *m_triangles,
-                                           *m_vertices);
+                                           *m_vertices,
+                                           buildParams.parallelDispatcher);
 
     // Check that not all triangles have been removed.
     if (0u == numValidTriangles)
@@ -278,14 +482,30 @@ ClusteredMeshBuilder::BuildClusteredMesh(
             vertexTriangleMap);
     }
 
-    // Determine triangle connectivity, finding neighboring triangles and edgecosines
-    detail::TriangleNeighborFinder::FindTriangleNeighbors(
+    // Determine triangle connectivity, finding neighboring triangles and edgecosines.
+    // Matching sorted edges is fastest, in parallel when a dispatcher is given, but needs temporary memory,
+    // without which the vertex triangle map is walked instead.
+    m_allocator->Mark(EA::Allocator::MEM_TEMP);
+    const bool foundNeighborsByEdgeSort = detail::TriangleNeighborFinder::FindTriangleNeighborsByEdgeSort(
         *m_triangles,
         *m_triangleEdgeCosines,
         *m_triangleNeighbors,
         *m_triangleFlags,
         *m_vertices,
-        vertexTriangleMap);
+        m_allocator,
+        buildParams.parallelDispatcher);
+    m_allocator->Release(EA::Allocator::MEM_TEMP);
+
+    if (!foundNeighborsByEdgeSort && !FindTriangleNeighborsParallel(buildParams, vertexTriangleMap))
+    {
+        detail::TriangleNeighborFinder::FindTriangleNeighbors(
+            *m_triangles,
+            *m_triangleEdgeCosines,
+            *m_triangleNeighbors,
+            *m_triangleFlags,
+            *m_vertices,
+            vertexTriangleMap);
+    }
 
     if (!IsBuilderValid())
         return clusteredMesh;
@@ -304,217 +524,1933 @@ ClusteredMeshBuilder::BuildClusteredMesh(
         m_coplanarHeightTolerance,
         m_maximumEdgeCosineMergeTolerance);
 
+    BeginBuildStage(BUILDSTAGE_EDGECODES);
+
     // Fix unmatched edges, correcting edge cosine values
     if (buildParams.edgeCosineCorrection_Enabled)
     {
-        // TODO: This value is arbitary, needs to be replaced with an estimate or user set value.
-        const uint32_t maxInputLimit(3000u);
-        FixUnmatchedEdges(maxInputLimit);
+        FixUnmatchedEdges(FIXUNMATCHEDEDGES_MAXINPUTS);
+    }
+
+    if (!IsBuilderValid())
+        return clusteredMesh;
+
+    // Encode the triangle data
+    // The edge codes are reset first, since they are ORed in and the builder may be rebuilt after an incremental update.
+    EdgeCodeGenerator::InitializeTriangleEdgeCodes(*m_triangleEdgeCodes);
+
+    EdgeCodesContext edgeCodesContext;
+    edgeCodesContext.triangleEdgeCodes = m_triangleEdgeCodes;
+    edgeCodesContext.triangleEdgeCosines = m_triangleEdgeCosines;
+    edgeCodesContext.triangleNeighbors = m_triangleNeighbors;
+    edgeCodesContext.minConcaveEdgeCosine = m_edgeCosConcaveAngleTolerance;
+
+    IParallelDispatcher::Run(
+        buildParams.parallelDispatcher,
+        GenerateEdgeCodesInRange,
+        &edgeCodesContext,
+        m_triangleEdgeCodes->size(),
+        EDGECODES_GRAINSIZE);
+
+    if (buildParams.vertexSmoothing_Enabled)
+    {
+        ClusteredMeshBuilderMethods::SmoothVertices(
+            vertexTriangleMap,
+            *m_triangles,
+            *m_triangleEdgeCodes,
+            *m_triangleFlags,
+            *m_vertices,
+            m_coplanarCosineTolerance,
+            m_cosineTolerance,
+            m_concaveCosineTolerance);
+    }
+
+    vertexTriangleMap.Release();
+
+    // Release temporary heap after freeing of the vertex triangle map
+    m_allocator->Release(EA::Allocator::MEM_TEMP);
+
+    BeginBuildStage(BUILDSTAGE_UNITS);
+
+    // Disable the border triangles, which have given the edge codes of their neighbors but are not built into units
+    for (uint32_t triangleIndex = m_firstBorderTriangle; triangleIndex < m_numTriangles; ++triangleIndex)
+    {
+        (*m_triangleFlags)[triangleIndex].enabled = false;
+    }
+
+    // Allocate the unit list on the temporary heap
+    m_unitList = UnitList::Allocate(m_allocator, m_numTriangles, EA::Allocator::MEM_TEMP);
+    if (!m_unitList)
+    {
+        m_isBuilderValid = FALSE;
+        return clusteredMesh;
+    }
+
+    // Create lists of units on which the clusters will be based
+    const uint32_t numUnits = BuildUnitList(buildParams.quads_Enable);
+
+    if (buildParams.incrementalUpdate_Enable)
+    {
+        // Keep the triangle adjacency data containers, with the unit list and unit clusters, for incremental
+        // updates. These are freed, and the permanent heap released, by ReleaseIncrementalUpdateData().
+        m_incrementalUpdateDataRetained = true;
+    }
+    else
+    {
+        // Free triangle adjacency data containers
+        TriangleNeighborsList::Free(m_allocator, m_triangleNeighbors);
+        TriangleEdgeCosinesList::Free(m_allocator, m_triangleEdgeCosines);
+        TriangleFlagsList::Free(m_allocator, m_triangleFlags);
+
+        // Release the permanent heap; done with triangle adjacency data containers
+        m_allocator->Release(EA::Allocator::MEM_PERM);
+    }
+
+    if (!IsBuilderValid())
+        return clusteredMesh;
+
+    BeginBuildStage(BUILDSTAGE_KDTREE);
+
+    // Build the KDTree, implicitly using the temporary heap
+    rw::collision::AABBoxU *unitAABBoxes = GetAllUnitBBoxes();
+    KDTreeBuilder kdTreeBuilder(*m_allocator);
+
+    kdTreeBuilder.BuildTree(
+        numUnits,
+        unitAABBoxes,
+        buildParams.kdTreeBuilder_SplitThreshold,
+        buildParams.kdTreeBuilder_LargeItemThreshold,
+        buildParams.kdTreeBuilder_MinChildEntriesThreshold,
+        buildParams.kdTreeBuilder_MaxEntriesPerNode,
+        buildParams.kdTreeBuilder_MinSimilarAreaThreshold);
+
+    if (!kdTreeBuilder.SuccessfulBuild())
+        return clusteredMesh;
+
+    BeginBuildStage(BUILDSTAGE_CLUSTERS);
+
+    // Create the Clusters using the KDTree
+    uint32_t numBranchNodes = kdTreeBuilder.GetNumBranchNodes();
+    rw::collision::AABBox rootBBox = kdTreeBuilder.GetRootBBox();
+    uint32_t numClusters = CreateClustersUsingKDTree(kdTreeBuilder, buildParams.unitOrdering_Enable);
+
+    if (!IsBuilderValid())
+        return clusteredMesh;
+
+    BeginBuildStage(BUILDSTAGE_CLUSTEREDMESH);
+
+    UnitClusterStack & unitClusterStack = GetUnitClusterStack();
+    UnitClusterStack::ClusterIterator it = unitClusterStack.Begin();
+    const UnitClusterStack::ClusterIterator itEnd = unitClusterStack.End();
+
+    // Determine the Cluster Compression modes
+    while (it != itEnd)
+    {
+        UnitCluster * unitCluster = *it;
+        DetermineClusterCompressionMode(buildParams.vertexCompression_Enable, *unitCluster);
+        ++it;
+    }
+
+    // Determine required granularity
+    float granularityNeeded = 0.0f;
+    if (buildParams.vertexCompression_Enable)
+    {
+        it = unitClusterStack.Begin();
+
+        while (it != itEnd)
+        {
+            UnitCluster * unitCluster = *it;
+
+            float minGranularityForThis = CalculateMinimumGranularityForCluster(*unitCluster);
+            if ( unitCluster->clusterID == 0 || ( minGranularityForThis > granularityNeeded ) )
+            {
+                granularityNeeded = minGranularityForThis;
+            }
+            ++it;
+        }
+
+        granularityNeeded *= 2.0f;
+        EAPHYSICS_MESSAGE( "Granularity needed to fit all clusters in 16 bits: %f", granularityNeeded );
+
+        if (granularityNeeded > buildParams.vertexCompression_Granularity)
+        {
+            EAPHYSICS_MESSAGE("Vertex compression granularity exceeded: needed %f, allowed %f",
+                       granularityNeeded,
+                       buildParams.vertexCompression_Granularity);
+        }
+
+        granularityNeeded = buildParams.vertexCompression_Granularity;
+    }
+
+    // Allocate and Create the runtime ClusteredMesh
+    EA::Physics::SizeAndAlignment resDesc = ClusteredMesh::GetResourceDescriptor(numClusters,
+                                                                                 GetClusterTotalSize(),
+                                                                                 numBranchNodes,
+                                                                                 numUnits,
+                                                                                 rootBBox,
+                                                                                 granularityNeeded,
+                                                                                 sizeof(ClusteredMesh),
+                                                                                 TRUE);
+
+    // Allocate the resource
+    void * resource = clusteredMeshAllocator->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+    EA::Physics::MemoryPtr rwResource(resource);
+
+    // Initialize the ClusteredMesh
+    clusteredMesh = ClusteredMesh::Initialize(rwResource,
+                                              numClusters,
+                                              GetClusterTotalSize(),
+                                              numBranchNodes,
+                                              numUnits,
+                                              rootBBox,
+                                              granularityNeeded,
+                                              sizeof(ClusteredMesh),
+                                              TRUE);
+
+    // Check that the allocation and initialization were successful
+    if (!clusteredMesh)
+    {
+        clusteredMeshAllocator->Free(resource);
+        return clusteredMesh;
+    }
+
+    clusteredMesh->SetGroupIdSize(static_cast<uint8_t>(buildParams.groupId_NumBytes));
+    clusteredMesh->SetSurfaceIdSize(static_cast<uint8_t>(buildParams.surfaceId_NumBytes));
+
+    // Populate each Cluster of the runtime ClusteredMesh
+    // With a dispatcher the clusters are allocated in order and then written in parallel,
+    // since each cluster is written only from its own unit cluster.
+    ClusterToWrite *clustersToWrite = NULL;
+    if (buildParams.parallelDispatcher)
+    {
+        m_allocator->Mark(EA::Allocator::MEM_TEMP);
+        clustersToWrite = static_cast<ClusterToWrite *>(
+            m_allocator->Alloc(numClusters * sizeof(ClusterToWrite), "ClustersToWrite", EA::Allocator::MEM_TEMP, 4));
+    }
+
+    it = unitClusterStack.Begin();
+    uint32_t clusterIndex = 0;
+
+    while (it != itEnd)
+    {
+        UnitCluster * unitCluster = *it;
+
+        ClusterConstructionParameters parameters;
+
+        InitializeClusterConstructionParameters(parameters, *unitCluster);
+
+        ClusteredMeshCluster *newcluster = clusteredMesh->AllocateNextCluster(parameters);
+
+        if (clustersToWrite)
+        {
+            clustersToWrite[clusterIndex].cluster = newcluster;
+            clustersToWrite[clusterIndex].unitCluster = unitCluster;
+        }
+        else
+        {
+            InitializeCluster(newcluster, *unitCluster);
+        }
+
+        ++clusterIndex;
+        ++it;
+    }
+
+    if (clustersToWrite)
+    {
+        WriteClustersContext writeClustersContext;
+        writeClustersContext.builder = this;
+        writeClustersContext.clusters = clustersToWrite;
+
+        IParallelDispatcher::Run(
+            buildParams.parallelDispatcher,
+            WriteClustersInRange,
+            &writeClustersContext,
+            clusterIndex,
+            CLUSTERS_GRAINSIZE);
+
+        m_allocator->Free(clustersToWrite);
+    }
+
+    if (buildParams.parallelDispatcher)
+    {
+        m_allocator->Release(EA::Allocator::MEM_TEMP);
+    }
+
+    // Initialize the runtime KDTree
+    kdTreeBuilder.InitializeRuntimeKDTree(clusteredMesh->GetKDTree());
+
+    // Update the ClusteredMesh after having populated each cluster and initalizing the KDTree
+    clusteredMesh->Update();
+
+    // Create the workspace for KDSubTree array creation
+    m_allocator->Mark(EA::Allocator::MEM_TEMP);
+    EA::Physics::SizeAndAlignment workspaceDesc(rw::collision::GetKDSubTreeWorkSpaceResourceDescriptor(*clusteredMesh));
+    void *workspace = m_allocator->Alloc(workspaceDesc.size, NULL, EA::Allocator::MEM_TEMP, workspaceDesc.alignment);
+    if (NULL == workspace)
+    {
+        EAPHYSICS_MESSAGE("While generating the KDSubTree the builder allocator ran out of memory.");
+        m_isBuilderValid = FALSE;
+        return clusteredMesh;
+    }
+
+    EA::Physics::MemoryPtr workspaceRes(workspace);
+     
+    // Create KDSubTree array from ClusteredMesh
+    KDTreeWithSubTrees *kdSubTreeArray = static_cast<KDTreeWithSubTrees *>(static_cast<KDTreeBase *>(clusteredMesh->GetKDTree()));
+    rw::collision::CreateKDSubTreeArray(kdSubTreeArray->GetKDSubTrees(), workspaceRes, *clusteredMesh);
+
+    // Free KDSubTree workspace as it is no longer needed
+    m_allocator->Free(workspace);
+    m_allocator->Release(EA::Allocator::MEM_TEMP);
+
+    EndBuildStage();
+
+    // Deallocate workspace data, unless it is kept for incremental updates
+    if (m_incrementalUpdateDataRetained)
+    {
+        if (!InitializeIncrementalUpdateData(*clusteredMesh))
+        {
+            EAPHYSICS_MESSAGE("Out of memory for the incremental update data, the mesh can only be rebuilt in full.");
+            ReleaseIncrementalUpdateData();
+        }
+    }
+    else
+    {
+        UnitList::Free(m_allocator, m_unitList);
+        m_unitClusterStack.Release();
+    }
+
+    // Return the ClusteredMesh
+    return clusteredMesh;
+}
+
+
+/**
+\brief Returns the peak use of the builder allocator during each stage of the last build.
+
+The builder construction is reported as the first stage. If the last build failed, the stage in which it
+failed is reported with the memory used up to the failure, and the later stages are reported as zero.
+
+\param report Returned peak memory use of each stage.
+*/
+void
+ClusteredMeshBuilder::GetMemoryReport(MemoryReport &report) const
+{
+    report = m_memoryReport;
+
+    // Include the stage in progress, in which a failed build stopped
+    if (m_buildStage != BUILDSTAGE_COUNT)
+    {
+        report.stagePeaks[m_buildStage] = GetBuildStageMemoryUsed();
+    }
+}
+
+
+/**
+\brief Returns the builder memory needed to build a ClusteredMesh with a LinearAllocator, from the construction
+of the builder.
+
+The requirement of each stage is given in the same form as the MemoryReport of a build, including the mark
+points of the allocator and assuming allocator positions aligned to four bytes. The requirements up to the
+units stage are exact. Later stages depend on the numbers of units, KDTree nodes and clusters, which are only
+known during the build, so they are bounded by the worst case:
+- every triangle forms a unit;
+- the KDTree nodes which split their entries between both children form a binary tree with at most one
+leaf per unit, and each of its nodes is preceded by at most six splits which cut off an empty leaf, one for
+each face of its bounding box;
+- at most one cluster is started per leaf holding units, so there are no more clusters than units.
+
+The bound on the KDTree is only approached by sparse or skewed input, for which the KDTree builder cuts off
+many empty leaves, so typical meshes use much less memory in the later stages.
+
+The adjacency stage allows for the edge sort workspace, with which the neighbor search never falls back to
+the parallel search of the vertex triangle map and its worker arenas.
+
+The data kept for incremental updates after a build is not included.
+
+\param requirements Returned memory requirement of each stage.
+\param numTri Input triangle count.
+\param numVert Input vertex count.
+\param buildParams Parameters of the build.
+\return The largest requirement of all stages, the builder memory needed by the whole build.
+*/
+uint32_t
+ClusteredMeshBuilder::GetMemoryRequirements(
+    MemoryReport &requirements,
+    const uint32_t numTri,
+    const uint32_t numVert,
+    const Parameters &buildParams)
+{
+    const uint32_t markSize = GetAllocationSize(LinearAllocator::GetMarkSize());
+
+    // Input vertex and triangle containers, on the permanent heap
+    const uint32_t inputSize = markSize +
+        GetAllocationSize(VertexList::GetSize(VertexList::Parameters(numVert))) +
+        GetAllocationSize(TriangleList::GetSize(TriangleList::Parameters(numTri))) +
+        GetAllocationSize(TriangleSurfaceIDList::GetSize(TriangleSurfaceIDList::Parameters(numTri))) +
+        GetAllocationSize(TriangleGroupIDList::GetSize(TriangleGroupIDList::Parameters(numTri))) +
+        GetAllocationSize(TriangleEdgeCodesList::GetSize(TriangleEdgeCodesList::Parameters(numTri)));
+
+    requirements.stagePeaks[BUILDSTAGE_INPUT] = inputSize;
+
+    // Vertex groups and vertex merger workspace, on the temporary heap
+    uint32_t vertexMergeSize = 0;
+    if (buildParams.vertexMerge_Enable)
+    {
+        vertexMergeSize = markSize +
+            GetAllocationSize(IDList::GetSize(IDList::Parameters(numVert))) +
+            VertexMerger::GetMergeVertexGroupsWorkspaceSize(numVert);
+    }
+
+    requirements.stagePeaks[BUILDSTAGE_VERTEXMERGE] = inputSize + vertexMergeSize;
+
+    // Triangle adjacency containers on the permanent heap, with the vertex triangle map and the edge sort
+    // workspace on the temporary heap
+    const uint32_t adjacencySize = markSize +
+        GetAllocationSize(TriangleFlagsList::GetSize(TriangleFlagsList::Parameters(numTri))) +
+        GetAllocationSize(TriangleEdgeCosinesList::GetSize(TriangleEdgeCosinesList::Parameters(numTri))) +
+        GetAllocationSize(TriangleNeighborsList::GetSize(TriangleNeighborsList::Parameters(numTri)));
+    const uint32_t vertexTriangleMapSize = markSize + VertexTriangleMap::GetMemoryRequirements(numTri);
+    const uint32_t edgeSortSize = markSize + TriangleNeighborFinder::GetEdgeSortWorkspaceSize(numTri);
+
+    requirements.stagePeaks[BUILDSTAGE_ADJACENCY] = inputSize + adjacencySize + vertexTriangleMapSize + edgeSortSize;
+
+    // Grid spatial map of the unmatched edge correction, on the temporary heap
+    uint32_t edgeCorrectionSize = 0;
+    if (buildParams.edgeCosineCorrection_Enabled)
+    {
+        edgeCorrectionSize = markSize + GetAllocationSize(GridSpatialMap::GetMemoryRequirements(
+            FIXUNMATCHEDEDGES_MAXINPUTS,
+            FIXUNMATCHEDEDGES_GRIDRESOLUTION));
+    }
+
+    requirements.stagePeaks[BUILDSTAGE_EDGECODES] = inputSize + adjacencySize + vertexTriangleMapSize + edgeCorrectionSize;
+
+    // Unit list and unit bounding boxes on the temporary heap, with the quad search list released before the boxes
+    const uint32_t unitListSize = GetAllocationSize(UnitList::GetSize(UnitList::Parameters(numTri)));
+    const uint32_t unitAABBoxesSize = GetAllocationSize(static_cast<uint32_t>(numTri * sizeof(AABBoxType) + sizeof(rwpmath::Vector3)));
+    uint32_t quadsSize = 0;
+    if (buildParams.quads_Enable)
+    {
+        quadsSize = markSize + GetAllocationSize(IDList::GetSize(IDList::Parameters(numTri)));
+    }
+
+    requirements.stagePeaks[BUILDSTAGE_UNITS] = inputSize + adjacencySize + unitListSize +
+        ((quadsSize > unitAABBoxesSize) ? quadsSize : unitAABBoxesSize);
+
+    // The triangle adjacency containers are released after the units, unless kept for incremental updates
+    const uint32_t unitsSize = inputSize + (buildParams.incrementalUpdate_Enable ? adjacencySize : 0u) +
+        unitListSize + unitAABBoxesSize;
+
+    // KDTree build nodes and entries, on the temporary heap, which the KDTreeBuilder holds to the end of the build.
+    // Each node holding entries may follow a chain of six empty leaf splits, each adding an empty leaf and a node.
+    const uint32_t numUnits = (numTri > 0) ? numTri : 1u;
+    const uint32_t numKDTreeNodes = (2u * numUnits - 1u) * (1u + 2u * 6u);
+    const uint32_t numLeaves = (numKDTreeNodes + 1u) / 2u;
+    const uint32_t kdTreeSize = KDTreeBuilder::GetBuildMemoryRequirements(numUnits, numKDTreeNodes);
+
+    requirements.stagePeaks[BUILDSTAGE_KDTREE] = unitsSize + kdTreeSize;
+
+    // Leaf map, unit ID lists and unit clusters, on the temporary heap. At most one cluster is started per leaf
+    // holding units.
+    const uint32_t numClusters = numUnits;
+    const uint32_t clustersSize =
+        GetAllocationSize(static_cast<uint32_t>(numLeaves * sizeof(LeafMap::node_type))) +
+        GetAllocationSize(static_cast<uint32_t>(numTri * sizeof(uint32_t))) +
+        numClusters * GetAllocationSize(static_cast<uint32_t>(sizeof(UnitClusterStack::UnitClusterListNode)));
+
+    requirements.stagePeaks[BUILDSTAGE_CLUSTERS] = unitsSize + kdTreeSize + clustersSize;
+
+    // The clusters to write in parallel are released before the KDSubTree workspace is allocated
+    uint32_t clustersToWriteSize = 0;
+    if (buildParams.parallelDispatcher)
+    {
+        clustersToWriteSize = markSize + GetAllocationSize(static_cast<uint32_t>(numClusters * sizeof(ClusterToWrite)));
+    }
+    const EA::Physics::SizeAndAlignment workspaceDesc(rw::collision::GetKDSubTreeWorkSpaceResourceDescriptor(numLeaves - 1u));
+    const uint32_t workspaceSize = markSize + GetAllocationSize(workspaceDesc.size, workspaceDesc.alignment);
+
+    requirements.stagePeaks[BUILDSTAGE_CLUSTEREDMESH] = unitsSize + kdTreeSize + clustersSize +
+        ((clustersToWriteSize > workspaceSize) ? clustersToWriteSize : workspaceSize);
+
+    return requirements.GetPeak();
+}
+
+
+/**
+\brief Starts a build stage, ending any stage in progress.
+
+\param stage The stage to start.
+*/
+void
+ClusteredMeshBuilder::BeginBuildStage(const BuildStage stage)
+{
+    EndBuildStage();
+    m_buildStage = stage;
+}
+
+
+/**
+\brief Ends any build stage in progress, recording its peak memory use, and starts tracking the peak afresh.
+*/
+void
+ClusteredMeshBuilder::EndBuildStage()
+{
+    if (m_buildStage != BUILDSTAGE_COUNT)
+    {
+        m_memoryReport.stagePeaks[m_buildStage] = GetBuildStageMemoryUsed();
+        m_buildStage = BUILDSTAGE_COUNT;
+    }
+
+    m_allocator->ResetTrackedPeakMemoryUsed();
+}
+
+
+/**
+\brief Returns the peak memory use of the builder allocator since the build stage in progress started,
+excluding the memory in use before the builder was constructed.
+*/
+uint32_t
+ClusteredMeshBuilder::GetBuildStageMemoryUsed() const
+{
+    const uint32_t peak = m_allocator->GetTrackedPeakMemoryUsed();
+    return (peak > m_memoryBaseline) ? (peak - m_memoryBaseline) : 0u;
+}
+
+
+/**
+\brief Finds triangle neighbors using the parallel dispatcher of the build parameters, if there is one.
+
+Each worker is given a scratch arena from the temporary heap for the edge matches it finds.
+
+\param buildParams build parameters holding the dispatcher and worker arena size.
+\param vertexTriangleMap map from vertex indices to triangle indices.
+\return false if there is no dispatcher or the workers ran out of memory, in which case the neighbors have not been found.
+*/
+bool
+ClusteredMeshBuilder::FindTriangleNeighborsParallel(
+    const Parameters & buildParams,
+    const VertexTriangleMap & vertexTriangleMap)
+{
+    IParallelDispatcher *const dispatcher = buildParams.parallelDispatcher;
+    if (!dispatcher || dispatcher->GetNumWorkers() < 2)
+    {
+        return false;
+    }
+
+    const uint32_t numWorkers = dispatcher->GetNumWorkers();
+    uint32_t arenaSize = buildParams.parallelDispatcher_WorkerArenaSize;
+    if (arenaSize == 0)
+    {
+        arenaSize = (m_allocator->LargestAllocatableSize(EA::Allocator::MEM_TEMP, 16) / 2) / numWorkers;
+        arenaSize &= ~15u;
+    }
+
+    bool foundNeighbors = false;
+
+    m_allocator->Mark(EA::Allocator::MEM_TEMP);
+
+    WorkerAllocators workerAllocators;
+    if (workerAllocators.Initialize(m_allocator, numWorkers, arenaSize))
+    {
+        foundNeighbors = detail::TriangleNeighborFinder::FindTriangleNeighbors(
+            *m_triangles,
+            *m_triangleEdgeCosines,
+            *m_triangleNeighbors,
+            *m_triangleFlags,
+            *m_vertices,
+            vertexTriangleMap,
+            dispatcher,
+            workerAllocators,
+            m_allocator);
+
+        workerAllocators.Release(m_allocator);
+    }
+
+    m_allocator->Release(EA::Allocator::MEM_TEMP);
+
+    if (!foundNeighbors)
+    {
+        EAPHYSICS_MESSAGE("Parallel triangle neighbor search ran out of memory, falling back to the serial search.");
+    }
+
+    return foundNeighbors;
+}
+
+
+/**
+\brief Updates a ClusteredMesh, built by this builder, after some of its triangles have been edited.
+
+The builder must have built the mesh with Parameters::incrementalUpdate_Enable, and the edited triangles and
+vertices must have been set again with SetTriangle and SetVertex. Every triangle whose vertex indices, vertex
+positions, group ID or surface ID have changed must be in the changed set; in particular, moving a vertex
+changes every triangle which uses it.
+
+The neighbors and edge cosines are found again only for a halo around the changed triangles: the changed
+triangles, the triangles which share an edge with them, and the previous neighbors of both. The clusters
+holding changed triangles, or triangles whose edge codes have changed, are rewritten in place, and the
+KDTree branch planes, KDSubTree bounds and unit bounds are refitted to the edited units.
+All other clusters are left untouched.
+
+The update keeps the units, and their clusters and KDTree leaves, of the original build. It fails, leaving
+the mesh unchanged, when the edit would change them: a triangle becoming degenerate or valid again, a quad
+losing its shared edge, a unit changing size, or a cluster running out of vertices or changing size. The
+caller should then rebuild the mesh in full with BuildClusteredMesh. The KDTree branch planes on the paths
+from the leaves of the changed units to the root are refitted to the bounds of their children, so they
+shrink as well as grow, but the split of the units between the leaves is that of the original build.
+
+Merging with planes, unmatched edge correction, vertex smoothing and internal triangle removal can't be
+repeated in the halo, so a build using them keeps no incremental update data and the update always fails.
+
+\param clusteredMesh The mesh built by the last call to BuildClusteredMesh.
+\param buildParams The build parameters used to build the mesh.
+\param changedTriangles Indices of the edited triangles.
+\param numChangedTriangles Number of edited triangles.
+\return true if the mesh has been updated, false if it is unchanged and must be rebuilt.
+*/
+bool
+ClusteredMeshBuilder::UpdateClusteredMesh(
+    rw::collision::ClusteredMesh &clusteredMesh,
+    const Parameters &buildParams,
+    const uint32_t *const changedTriangles,
+    const uint32_t numChangedTriangles)
+{
+    EA_ASSERT_MSG(m_isBuilderValid, "Builder is in an invalid state - memory allocation has failed before this point");
+
+    if (!CanUpdateClusteredMesh(clusteredMesh))
+    {
+        return false;
+    }
+
+    if (0u == numChangedTriangles)
+    {
+        return true;
+    }
+
+    // Mark temporary heap before allocation of the update workspace
+    m_allocator->Mark(EA::Allocator::MEM_TEMP);
+
+    IDList *changed = NULL;
+    IDList *halo = NULL;
+    IDList *dirtyClusters = NULL;
+    IDList *changedUnits = NULL;
+    IDList *unitLeaves = NULL;
+    UnitCluster *updatedClusters = NULL;
+
+    // Every step up to the rewriting of the clusters can fail, and none of them writes to the mesh
+    const bool canUpdate =
+        SortChangedTriangles(changed, changedTriangles, numChangedTriangles) &&
+        WeldChangedTriangleVertices(clusteredMesh, *changed, buildParams.vertexMerge_Enable) &&
+        ValidateChangedTriangles(*changed) &&
+        FindHaloTriangles(halo, clusteredMesh, *changed) &&
+        UpdateHaloTriangleAdjacency(clusteredMesh, *halo) &&
+        UpdateHaloTriangleEdgeCodes(dirtyClusters, *halo, *changed) &&
+        PrepareUpdatedClusters(updatedClusters, clusteredMesh, *dirtyClusters) &&
+        FindChangedUnitLeaves(changedUnits, unitLeaves, clusteredMesh, *changed);
+
+    if (canUpdate)
+    {
+        ApplyClusteredMeshUpdate(clusteredMesh, *dirtyClusters, updatedClusters, *changedUnits, *unitLeaves);
+    }
+
+    // Free the update workspace
+    IDList::Free(m_allocator, unitLeaves);
+    IDList::Free(m_allocator, changedUnits);
+    if (NULL != updatedClusters)
+    {
+        m_allocator->Free(updatedClusters);
+    }
+    IDList::Free(m_allocator, dirtyClusters);
+    IDList::Free(m_allocator, halo);
+    IDList::Free(m_allocator, changed);
+
+    // Release temporary heap after freeing of the update workspace
+    m_allocator->Release(EA::Allocator::MEM_TEMP);
+
+    return canUpdate;
+}
+
+
+/**
+\brief Keeps the mapping between triangles, units, clusters and KDTree entries of the last build, and the
+bounds of the children of each KDTree branch node.
+
+The unit list, unit clusters and triangle adjacency data must have been kept after the build.
+
+\param clusteredMesh The mesh built by the last build.
+\return false if memory allocation fails.
+*/
+bool
+ClusteredMeshBuilder::InitializeIncrementalUpdateData(const rw::collision::ClusteredMesh &clusteredMesh)
+{
+    EA_ASSERT_MSG(m_incrementalUpdateDataRetained, "The build data should have been kept for incremental updates");
+
+    const uint32_t numTriangles = m_triangles->size();
+    const uint32_t numUnits = m_unitList->size();
+    const uint32_t numClusters = m_unitClusterStack.Size();
+
+    // The same shift as used for the KDTree entries by CreateClustersUsingKDTree
+    m_unitClusterIDShift = (numClusters > 65536) ? 20U : 16U;
+
+    m_triangleUnits = IDList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    m_unitEntries = IDList::Allocate(m_allocator, numUnits, EA::Allocator::MEM_PERM);
+    m_clusterFirstUnits = IDList::Allocate(m_allocator, numClusters + 1u, EA::Allocator::MEM_PERM);
+    m_unitClusters = static_cast<UnitCluster **>(
+        m_allocator->Alloc(numClusters * sizeof(UnitCluster *), "UnitClusters", EA::Allocator::MEM_PERM, 4));
+
+    if (!m_triangleUnits || !m_unitEntries || !m_clusterFirstUnits || !m_unitClusters)
+    {
+        return false;
+    }
+
+    m_triangleUnits->resize(numTriangles, CLUSTEREDMESHBUILDER_NOUNIT);
+    m_unitEntries->resize(numUnits);
+    m_clusterFirstUnits->resize(numClusters + 1u);
+
+    // Map each triangle to its unit
+    for (uint32_t unitID = 0; unitID < numUnits; ++unitID)
+    {
+        const Unit &unit = (*m_unitList)[unitID];
+        (*m_triangleUnits)[unit.tri0] = unitID;
+        if (unit.type == Unit::TYPE_QUAD)
+        {
+            (*m_triangleUnits)[unit.tri1] = unitID;
+        }
+    }
+
+    // Index the unit clusters by cluster ID
+    UnitClusterStack::ClusterIterator it = m_unitClusterStack.Begin();
+    const UnitClusterStack::ClusterIterator itEnd = m_unitClusterStack.End();
+
+    while (it != itEnd)
+    {
+        UnitCluster * unitCluster = *it;
+        EA_ASSERT(unitCluster->clusterID < numClusters);
+        m_unitClusters[unitCluster->clusterID] = unitCluster;
+        ++it;
+    }
+
+    // Find the KDTree entry of each unit, as in AdjustKDTreeNodeEntriesForCluster
+    uint32_t firstUnit = 0;
+    for (uint32_t clusterIndex = 0; clusterIndex < numClusters; ++clusterIndex)
+    {
+        const UnitCluster &unitCluster = *m_unitClusters[clusterIndex];
+        const uint32_t shiftedClusterId = clusterIndex << m_unitClusterIDShift;
+
+        (*m_clusterFirstUnits)[clusterIndex] = firstUnit;
+        firstUnit += unitCluster.numUnits;
+
+        uint32_t sizeofUnitData = 0;
+        for (uint32_t unitIndex = 0; unitIndex < unitCluster.numUnits; ++unitIndex)
+        {
+            const uint32_t unitID = unitCluster.unitIDs[unitIndex];
+            const Unit &unit = (*m_unitList)[unitID];
+
+            (*m_unitEntries)[unitID] = shiftedClusterId + sizeofUnitData;
+
+            sizeofUnitData += ClusteredMeshCluster::GetUnitSize(static_cast<uint8_t>(unit.type),
+                                                                m_unitParameters,
+                                                                (*m_triangleGroupIDs)[unit.tri0],
+                                                                (*m_triangleSurfaceIDs)[unit.tri0]);
+        }
+    }
+
+    (*m_clusterFirstUnits)[numClusters] = firstUnit;
+
+    // Bound the children of each branch node, children before parents, as the branch nodes are in depth first order
+    const rw::collision::KDTreeBase &kdtree = *clusteredMesh.GetKDTreeBase();
+    if (kdtree.m_numBranchNodes > 0u)
+    {
+        m_kdTreeChildBBoxes = static_cast<rw::collision::AABBox *>(
+            m_allocator->Alloc(2u * kdtree.m_numBranchNodes * sizeof(rw::collision::AABBox),
+                               "KDTreeChildBBoxes",
+                               EA::Allocator::MEM_PERM,
+                               RW_MATH_VECTOR3_ALIGNMENT));
+        if (!m_kdTreeChildBBoxes)
+        {
+            return false;
+        }
+
+        for (uint32_t nodeIndex = kdtree.m_numBranchNodes; nodeIndex-- > 0u; )
+        {
+            for (uint32_t side = 0; side < 2u; ++side)
+            {
+                GetKDTreeChildBBox(m_kdTreeChildBBoxes[(nodeIndex << 1u) | side], kdtree.m_branchNodes[nodeIndex].m_childRefs[side]);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+\brief Finds the bounds of the units of a KDTree leaf, grown by the rounding of adaptive compression as the
+unit boxes given to the KDTreeBuilder are.
+
+\param bbox Returned bounds, inverted if the leaf is empty.
+\param leafRef The leaf.
+*/
+void
+ClusteredMeshBuilder::GetKDTreeLeafBBox(rw::collision::AABBox &bbox, const rw::collision::KDTreeBase::NodeRef &leafRef) const
+{
+    bbox = GetEmptyBBox();
+
+    const uint32_t position = (leafRef.m_content > 0u) ? FindUnitPosition(leafRef.m_index) : CLUSTEREDMESHBUILDER_NOUNIT;
+    if (CLUSTEREDMESHBUILDER_NOUNIT == position)
+    {
+        return;
+    }
+
+    const uint32_t numUnits = m_unitList->size();
+    for (uint32_t unitIndex = position; unitIndex < position + leafRef.m_content && unitIndex < numUnits; ++unitIndex)
+    {
+        const Unit &unit = (*m_unitList)[GetUnitAtPosition(unitIndex)];
+        AddTriangleToBBox(bbox, (*m_triangles)[unit.tri0], *m_vertices);
+        if (unit.type == Unit::TYPE_QUAD)
+        {
+            AddTriangleToBBox(bbox, (*m_triangles)[unit.tri1], *m_vertices);
+        }
+    }
+
+    const rwpmath::VecFloat compressionError(GetAdaptiveCompressionError());
+    bbox.m_min -= compressionError;
+    bbox.m_max += compressionError;
+}
+
+
+/**
+\brief Finds the bounds of a child of a KDTree branch node, from the bounds kept for the children of a branch
+child, or from the units of a leaf.
+
+\param bbox Returned bounds, inverted if the child is empty.
+\param childRef The child.
+*/
+void
+ClusteredMeshBuilder::GetKDTreeChildBBox(rw::collision::AABBox &bbox, const rw::collision::KDTreeBase::NodeRef &childRef) const
+{
+    if (childRef.m_content == rwcKDTREE_BRANCH_NODE)
+    {
+        bbox = m_kdTreeChildBBoxes[childRef.m_index << 1u];
+        bbox.Union(m_kdTreeChildBBoxes[(childRef.m_index << 1u) | 1u]);
+    }
+    else
+    {
+        GetKDTreeLeafBBox(bbox, childRef);
+    }
+}
+
+
+/**
+\brief Refits the branch planes on the path from a KDTree leaf to the root to the bounds of their children,
+as the KDTreeBuilder sets them.
+
+The bounds of the leaf are found again, and those of each branch child on the path from the kept bounds of its
+children. The plane of an empty child is left as it is.
+
+\param kdtree The tree of the mesh built by the last build.
+\param leaf The index of the parent branch node of the leaf, shifted up one bit, plus the side of the leaf.
+*/
+void
+ClusteredMeshBuilder::RefitKDTreeBranchExtents(rw::collision::KDTreeBase &kdtree, const uint32_t leaf)
+{
+    rw::collision::KDTreeBase::BranchNode *const branchNodes = kdtree.m_branchNodes;
+
+    uint32_t nodeIndex = leaf >> 1u;
+    uint32_t side = leaf & 1u;
+    GetKDTreeChildBBox(m_kdTreeChildBBoxes[leaf], branchNodes[nodeIndex].m_childRefs[side]);
+
+    for (;;)
+    {
+        rw::collision::KDTreeBase::BranchNode &node = branchNodes[nodeIndex];
+        const uint16_t axis = static_cast<uint16_t>(node.m_axis);
+
+        // The left child lies below m_extents[0] and the right child above m_extents[1]
+        const rw::collision::AABBox &leftBBox = m_kdTreeChildBBoxes[nodeIndex << 1u];
+        const rw::collision::AABBox &rightBBox = m_kdTreeChildBBoxes[(nodeIndex << 1u) | 1u];
+        if (node.m_childRefs[0].m_content != 0u)
+        {
+            node.m_extents[0] = static_cast<float>(leftBBox.Max().GetComponent(axis));
+        }
+        if (node.m_childRefs[1].m_content != 0u)
+        {
+            node.m_extents[1] = static_cast<float>(rightBBox.Min().GetComponent(axis));
+        }
+
+        // The root is its own parent
+        const uint32_t parentIndex = node.m_parent;
+        if (parentIndex == nodeIndex)
+        {
+            break;
+        }
+
+        const rw::collision::KDTreeBase::NodeRef &leftRef = branchNodes[parentIndex].m_childRefs[0];
+        side = (leftRef.m_content == rwcKDTREE_BRANCH_NODE && leftRef.m_index == nodeIndex) ? 0u : 1u;
+        GetKDTreeChildBBox(m_kdTreeChildBBoxes[(parentIndex << 1u) | side], branchNodes[parentIndex].m_childRefs[side]);
+        nodeIndex = parentIndex;
+    }
+}
+
+
+/**
+\brief Frees the data kept after the last build for incremental updates, if any.
+*/
+void
+ClusteredMeshBuilder::ReleaseIncrementalUpdateData()
+{
+    if (NULL != m_kdTreeChildBBoxes)
+    {
+        m_allocator->Free(m_kdTreeChildBBoxes);
+        m_kdTreeChildBBoxes = NULL;
+    }
+
+    if (NULL != m_unitClusters)
+    {
+        m_allocator->Free(m_unitClusters);
+        m_unitClusters = NULL;
+    }
+
+    IDList::Free(m_allocator, m_clusterFirstUnits);
+    IDList::Free(m_allocator, m_unitEntries);
+    IDList::Free(m_allocator, m_triangleUnits);
+
+    if (m_incrementalUpdateDataRetained)
+    {
+        UnitList::Free(m_allocator, m_unitList);
+        m_unitClusterStack.Release();
+
+        // Free triangle adjacency data containers
+        TriangleNeighborsList::Free(m_allocator, m_triangleNeighbors);
+        TriangleEdgeCosinesList::Free(m_allocator, m_triangleEdgeCosines);
+        TriangleFlagsList::Free(m_allocator, m_triangleFlags);
+
+        // Release the permanent heap; done with triangle adjacency data containers
+        m_allocator->Release(EA::Allocator::MEM_PERM);
+
+        m_incrementalUpdateDataRetained = false;
+    }
+}
+
+
+/**
+\brief Checks that a mesh can be updated from the data kept after the last build.
+
+\param clusteredMesh The mesh to update.
+\return true if the incremental update data matches the mesh.
+*/
+bool
+ClusteredMeshBuilder::CanUpdateClusteredMesh(const rw::collision::ClusteredMesh &clusteredMesh) const
+{
+    if (NULL == m_unitClusters)
+    {
+        EAPHYSICS_MESSAGE("The builder has kept no incremental update data. Build with incrementalUpdate_Enable set, without merge planes, edge cosine correction, vertex smoothing or internal triangle removal.");
+        return false;
+    }
+
+    const rw::collision::KDTreeBase *const kdtree = clusteredMesh.GetKDTreeBase();
+
+    if (clusteredMesh.GetNumCluster() + 1u != m_clusterFirstUnits->size() ||
+        kdtree->m_numEntries != m_unitList->size())
+    {
+        EAPHYSICS_MESSAGE("The mesh was not built by the last build of this builder.");
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+\brief Finds the position of the unit at a KDTree entry, in the sequence of the units of all clusters.
+
+\param entry KDTree entry, the shifted cluster ID plus the offset of the unit in the cluster.
+\return The position of the unit, or CLUSTEREDMESHBUILDER_NOUNIT if there is no unit at the entry.
+*/
+uint32_t
+ClusteredMeshBuilder::FindUnitPosition(const uint32_t entry) const
+{
+    const uint32_t clusterIndex = entry >> m_unitClusterIDShift;
+    if (clusterIndex + 1u >= m_clusterFirstUnits->size())
+    {
+        return CLUSTEREDMESHBUILDER_NOUNIT;
+    }
+
+    const UnitCluster &unitCluster = *m_unitClusters[clusterIndex];
+
+    // The entries of the units of a cluster ascend with the unit index
+    uint32_t low = 0;
+    uint32_t high = unitCluster.numUnits;
+    while (low < high)
+    {
+        const uint32_t middle = (low + high) / 2u;
+        if ((*m_unitEntries)[unitCluster.unitIDs[middle]] < entry)
+        {
+            low = middle + 1u;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if (low == unitCluster.numUnits || (*m_unitEntries)[unitCluster.unitIDs[low]] != entry)
+    {
+        return CLUSTEREDMESHBUILDER_NOUNIT;
+    }
+
+    return (*m_clusterFirstUnits)[clusterIndex] + low;
+}
+
+
+/**
+\brief Returns the ID of the unit at a position in the sequence of the units of all clusters.
+
+\param position The position, which must be less than the number of units.
+\return The ID of the unit.
+*/
+uint32_t
+ClusteredMeshBuilder::GetUnitAtPosition(const uint32_t position) const
+{
+    EA_ASSERT(position < m_unitList->size());
+
+    // Find the last cluster starting at or before the position
+    uint32_t low = 0;
+    uint32_t high = m_clusterFirstUnits->size() - 1u;
+    while (high - low > 1u)
+    {
+        const uint32_t middle = (low + high) / 2u;
+        if ((*m_clusterFirstUnits)[middle] <= position)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return m_unitClusters[low]->unitIDs[position - (*m_clusterFirstUnits)[low]];
+}
+
+
+/**
+\brief Finds the KDTree leaf holding a unit.
+
+The branch nodes of the KDSubTree of the unit's cluster are searched first, then the whole tree.
+
+\param clusteredMesh The mesh.
+\param unitID The ID of the unit.
+\return The index of the parent branch node of the leaf, shifted up one bit, plus the side of the leaf,
+or CLUSTEREDMESHBUILDER_NOLEAF if the leaf is not found.
+*/
+uint32_t
+ClusteredMeshBuilder::FindUnitLeaf(const rw::collision::ClusteredMesh &clusteredMesh, const uint32_t unitID) const
+{
+    const rw::collision::KDTreeBase &kdtree = *clusteredMesh.GetKDTreeBase();
+    const uint32_t entry = (*m_unitEntries)[unitID];
+    const uint32_t position = FindUnitPosition(entry);
+
+    const rw::collision::KDSubTree *const subTree = clusteredMesh.GetClusterKDTree(entry >> m_unitClusterIDShift);
+    if (NULL != subTree)
+    {
+        // A single leaf KDSubTree has no branch nodes, and starts at the parent of its leaf
+        const uint32_t firstNode = subTree->GetBranchNodeOffset();
+        const uint32_t numNodes = (subTree->GetNumBranchNodes() > 0u) ? subTree->GetNumBranchNodes() : 1u;
+        const uint32_t endNode = (firstNode + numNodes < kdtree.m_numBranchNodes) ? firstNode + numNodes : kdtree.m_numBranchNodes;
+
+        const uint32_t leaf = FindUnitLeafInRange(kdtree, position, firstNode, endNode);
+        if (CLUSTEREDMESHBUILDER_NOLEAF != leaf)
+        {
+            return leaf;
+        }
+    }
+
+    return FindUnitLeafInRange(kdtree, position, 0u, kdtree.m_numBranchNodes);
+}
+
+
+/**
+\brief Finds the leaf holding a unit among the children of a range of KDTree branch nodes.
+
+\param kdtree The tree.
+\param position The position of the unit in the sequence of the units of all clusters.
+\param firstNode The index of the first branch node to search.
+\param endNode One past the index of the last branch node to search.
+\return The index of the parent branch node of the leaf, shifted up one bit, plus the side of the leaf,
+or CLUSTEREDMESHBUILDER_NOLEAF if the leaf is not found.
+*/
+uint32_t
+ClusteredMeshBuilder::FindUnitLeafInRange(
+    const rw::collision::KDTreeBase &kdtree,
+    const uint32_t position,
+    const uint32_t firstNode,
+    const uint32_t endNode) const
+{
+    for (uint32_t nodeIndex = firstNode; nodeIndex < endNode; ++nodeIndex)
+    {
+        for (uint32_t side = 0; side < 2u; ++side)
+        {
+            const rw::collision::KDTreeBase::NodeRef &childRef = kdtree.m_branchNodes[nodeIndex].m_childRefs[side];
+            if (childRef.m_content == rwcKDTREE_BRANCH_NODE || childRef.m_content == 0u)
+            {
+                continue;
+            }
+
+            // A leaf may run on into the next cluster, so compare positions rather than entries
+            const uint32_t leafPosition = FindUnitPosition(childRef.m_index);
+            if (CLUSTEREDMESHBUILDER_NOUNIT != leafPosition &&
+                leafPosition <= position &&
+                position < leafPosition + childRef.m_content)
+            {
+                return (nodeIndex << 1u) | side;
+            }
+        }
+    }
+
+    return CLUSTEREDMESHBUILDER_NOLEAF;
+}
+
+
+/**
+\brief Gathers the triangles of the units in the KDTree leaves which overlap a box.
+
+\param triangles Returned sorted list of triangle indices, allocated from the temporary heap.
+\param clusteredMesh The mesh.
+\param bbox The box.
+\param includedTriangles Optional sorted list of triangles to add to the gathered triangles.
+\return false if memory allocation fails.
+*/
+bool
+ClusteredMeshBuilder::GatherUnitTriangles(
+    IDList *&triangles,
+    const rw::collision::ClusteredMesh &clusteredMesh,
+    const rw::collision::AABBox &bbox,
+    const IDList *const includedTriangles)
+{
+    const rw::collision::KDTreeBase *const kdtree = clusteredMesh.GetKDTreeBase();
+    const uint32_t numUnits = m_unitList->size();
+
+    uint32_t entry = 0;
+    uint32_t count = 0;
+
+    // Count the units first, allowing two triangles for each
+    uint32_t maxTriangles = includedTriangles ? includedTriangles->size() : 0u;
+    {
+        rw::collision::KDTreeBBoxQuery countQuery(kdtree, bbox);
+        while (countQuery.GetNext(entry, count))
+        {
+            maxTriangles += 2u * count;
+        }
+    }
+
+    triangles = IDList::Allocate(m_allocator, maxTriangles, EA::Allocator::MEM_TEMP);
+    if (!triangles)
+    {
+        return false;
+    }
+
+    if (includedTriangles)
+    {
+        for (uint32_t index = 0; index < includedTriangles->size(); ++index)
+        {
+            triangles->push_back((*includedTriangles)[index]);
+        }
+    }
+
+    rw::collision::KDTreeBBoxQuery query(kdtree, bbox);
+    while (query.GetNext(entry, count))
+    {
+        const uint32_t position = FindUnitPosition(entry);
+        if (CLUSTEREDMESHBUILDER_NOUNIT == position)
+        {
+            continue;
+        }
+
+        for (uint32_t unitIndex = position; unitIndex < position + count && unitIndex < numUnits; ++unitIndex)
+        {
+            const Unit &unit = (*m_unitList)[GetUnitAtPosition(unitIndex)];
+            triangles->push_back(unit.tri0);
+            if (unit.type == Unit::TYPE_QUAD)
+            {
+                triangles->push_back(unit.tri1);
+            }
+        }
+    }
+
+    SortAndRemoveDuplicateIDs(*triangles);
+
+    return true;
+}
+
+
+/**
+\brief Copies the changed triangle indices into a sorted list without duplicates.
+
+\param changed Returned sorted list of changed triangles, allocated from the temporary heap.
+\param changedTriangles Indices of the changed triangles.
+\param numChangedTriangles Number of changed triangles.
+\return false if memory allocation fails or an index is out of range.
+*/
+bool
+ClusteredMeshBuilder::SortChangedTriangles(
+    IDList *&changed,
+    const uint32_t *const changedTriangles,
+    const uint32_t numChangedTriangles)
+{
+    changed = IDList::Allocate(m_allocator, numChangedTriangles, EA::Allocator::MEM_TEMP);
+    if (!changed)
+    {
+        return false;
+    }
+
+    for (uint32_t index = 0; index < numChangedTriangles; ++index)
+    {
+        if (changedTriangles[index] >= m_triangles->size())
+        {
+            EAPHYSICS_MESSAGE("Changed triangle index %d is out of range.", changedTriangles[index]);
+            return false;
+        }
+
+        changed->push_back(changedTriangles[index]);
+    }
+
+    SortAndRemoveDuplicateIDs(*changed);
+
+    return true;
+}
+
+
+/**
+\brief Merges the vertices of the changed triangles with any nearby vertices, as MergeVertexGroups does for the
+whole mesh.
+
+The vertices used by nearby unchanged triangles come first in the merged collection, so that the changed
+triangles are welded onto them rather than the reverse.
+
+\param clusteredMesh The mesh, whose KDTree is used to find the nearby triangles.
+\param changed Sorted list of changed triangles.
+\param mergeVertices Flag used to control whether or not merging takes place.
+\return false if memory allocation fails.
+*/
+bool
+ClusteredMeshBuilder::WeldChangedTriangleVertices(
+    const rw::collision::ClusteredMesh &clusteredMesh,
+    const IDList &changed,
+    const bool mergeVertices)
+{
+    if (!mergeVertices)
+    {
+        return true;
+    }
+
+    // Find the triangles within the merge tolerance of the changed triangles
+    rw::collision::AABBox bbox(GetEmptyBBox());
+    for (uint32_t index = 0; index < changed.size(); ++index)
+    {
+        AddTriangleToBBox(bbox, (*m_triangles)[changed[index]], *m_vertices);
+    }
+
+    const rwpmath::VecFloat tolerance(m_vertexMergeDistanceTolerance);
+    bbox.m_min -= tolerance;
+    bbox.m_max += tolerance;
+
+    IDList *nearby = NULL;
+    if (!GatherUnitTriangles(nearby, clusteredMesh, bbox))
+    {
+        IDList::Free(m_allocator, nearby);
+        return false;
+    }
+
+    IDList *existingVertices = IDList::Allocate(m_allocator, 3u * nearby->size(), EA::Allocator::MEM_TEMP);
+    IDList *changedVertices = IDList::Allocate(m_allocator, 3u * changed.size(), EA::Allocator::MEM_TEMP);
+    VertexList *localVertices = NULL;
+    IDList *localVertexGroups = NULL;
+    bool welded = false;
+
+    if (existingVertices && changedVertices)
+    {
+        for (uint32_t index = 0; index < nearby->size(); ++index)
+        {
+            if (!ContainsSortedID(changed, (*nearby)[index]))
+            {
+                const Triangle &triangle = (*m_triangles)[(*nearby)[index]];
+                existingVertices->push_back(triangle.vertices[0]);
+                existingVertices->push_back(triangle.vertices[1]);
+                existingVertices->push_back(triangle.vertices[2]);
+            }
+        }
+
+        SortAndRemoveDuplicateIDs(*existingVertices);
+
+        for (uint32_t index = 0; index < changed.size(); ++index)
+        {
+            const Triangle &triangle = (*m_triangles)[changed[index]];
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                if (!ContainsSortedID(*existingVertices, triangle.vertices[corner]))
+                {
+                    changedVertices->push_back(triangle.vertices[corner]);
+                }
+            }
+        }
+
+        SortAndRemoveDuplicateIDs(*changedVertices);
+
+        const uint32_t numExistingVertices = existingVertices->size();
+        const uint32_t numLocalVertices = numExistingVertices + changedVertices->size();
+
+        localVertices = VertexList::Allocate(m_allocator, numLocalVertices, EA::Allocator::MEM_TEMP);
+        localVertexGroups = IDList::Allocate(m_allocator, numLocalVertices, EA::Allocator::MEM_TEMP);
+
+        if (localVertices && localVertexGroups)
+        {
+            localVertices->resize(numLocalVertices);
+            localVertexGroups->resize(numLocalVertices);
+
+            // Initialize the local vertex bounding box to an inverted box
+            const rwpmath::VecFloat max = rwpmath::GetVecFloat_MaxValue();
+            AABBoxType localAABBox;
+            localAABBox.m_min = AABBoxType::Vector3Type(max, max, max);
+            localAABBox.m_max = AABBoxType::Vector3Type(-max, -max, -max);
+
+            for (uint32_t index = 0; index < numLocalVertices; ++index)
+            {
+                const uint32_t vertexIndex = (index < numExistingVertices) ?
+                    (*existingVertices)[index] :
+                    (*changedVertices)[index - numExistingVertices];
+                const VectorType &pos = (*m_vertices)[vertexIndex];
+
+                (*localVertices)[index] = pos;
+                (*localVertexGroups)[index] = index;
+
+                localAABBox.Set(Min(localAABBox.Min(), AABBoxType::Vector3Type(pos)),
+                                Max(localAABBox.Max(), AABBoxType::Vector3Type(pos)));
+            }
+
+            // Merge the vertices, each group taking the lowest local index among its vertices
+            welded = VertexMerger::MergeVertexGroups(
+                *localVertexGroups,
+                *m_allocator,
+                localAABBox,
+                tolerance,
+                *localVertices);
+
+            if (welded)
+            {
+                // Update only the vertex indices of the changed triangles
+                for (uint32_t index = 0; index < changed.size(); ++index)
+                {
+                    Triangle &triangle = (*m_triangles)[changed[index]];
+                    for (uint32_t corner = 0; corner < 3; ++corner)
+                    {
+                        const uint32_t existingIndex = FindSortedID(*existingVertices, triangle.vertices[corner]);
+                        const uint32_t localIndex = (existingIndex < numExistingVertices) ?
+                            existingIndex :
+                            numExistingVertices + FindSortedID(*changedVertices, triangle.vertices[corner]);
+                        const uint32_t groupIndex = (*localVertexGroups)[localIndex];
+
+                        triangle.vertices[corner] = (groupIndex < numExistingVertices) ?
+                            (*existingVertices)[groupIndex] :
+                            (*changedVertices)[groupIndex - numExistingVertices];
+                    }
+                }
+            }
+        }
+    }
+
+    IDList::Free(m_allocator, localVertexGroups);
+    VertexList::Free(m_allocator, localVertices);
+    IDList::Free(m_allocator, changedVertices);
+    IDList::Free(m_allocator, existingVertices);
+    IDList::Free(m_allocator, nearby);
+
+    return welded;
+}
+
+
+/**
+\brief Validates the changed triangles, checking that the units of the last build still hold.
+
+\param changed Sorted list of changed triangles.
+\return false if a changed triangle has become invalid or valid, or a quad no longer shares an edge.
+*/
+bool
+ClusteredMeshBuilder::ValidateChangedTriangles(const IDList &changed)
+{
+    for (uint32_t index = 0; index < changed.size(); ++index)
+    {
+        const uint32_t triangleIndex = changed[index];
+
+        ClusteredMeshBuilderMethods::ValidateTriangles(
+            *m_triangleFlags,
+            *m_triangles,
+            *m_vertices,
+            triangleIndex,
+            triangleIndex + 1u);
+
+        const uint32_t unitID = (*m_triangleUnits)[triangleIndex];
+        if ((*m_triangleFlags)[triangleIndex].enabled != (CLUSTEREDMESHBUILDER_NOUNIT != unitID))
+        {
+            EAPHYSICS_MESSAGE("Changed triangle %d has become invalid, or valid, and so changes the units of the mesh.", triangleIndex);
+            return false;
+        }
+
+        if (CLUSTEREDMESHBUILDER_NOUNIT != unitID && (*m_unitList)[unitID].type == Unit::TYPE_QUAD)
+        {
+            // The second triangle of the quad must still share the edge opposing its extra vertex
+            const Unit &unit = (*m_unitList)[unitID];
+            const Triangle &tri0 = (*m_triangles)[unit.tri0];
+            const Triangle &tri1 = (*m_triangles)[unit.tri1];
+            const uint32_t edge = unit.edgeOpposingExtraVertex;
+            const uint32_t longestEdge = unit.longestEdgeOnTri1;
+
+            if (tri0.vertices[(edge + 1u) % 3u] != tri1.vertices[longestEdge] ||
+                tri0.vertices[edge] != tri1.vertices[(longestEdge + 1u) % 3u])
+            {
+                EAPHYSICS_MESSAGE("Changed triangle %d no longer shares an edge with the other triangle of its quad.", triangleIndex);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+\brief Finds the triangles whose neighbors and edge cosines may be changed by the edit.
+
+These are the changed triangles, the unchanged triangles which share an edge with them, and the previous
+neighbors of both, together with any triangle which has a changed triangle as a neighbor.
+
+\param halo Returned sorted list of halo triangles, allocated from the temporary heap.
+\param clusteredMesh The mesh, whose KDTree is used to find the nearby triangles.
+\param changed Sorted list of changed triangles.
+\return false if memory allocation fails.
+*/
+bool
+ClusteredMeshBuilder::FindHaloTriangles(
+    IDList *&halo,
+    const rw::collision::ClusteredMesh &clusteredMesh,
+    const IDList &changed)
+{
+    const uint32_t numChanged = changed.size();
+
+    // Sort the edges of the changed triangles, and find their bounds
+    uint64_t *const edgeKeys = static_cast<uint64_t *>(
+        m_allocator->Alloc(3u * numChanged * sizeof(uint64_t), "EdgeKeys", EA::Allocator::MEM_TEMP, 8));
+    if (NULL == edgeKeys)
+    {
+        return false;
+    }
+
+    rw::collision::AABBox bbox(GetEmptyBBox());
+    for (uint32_t index = 0; index < numChanged; ++index)
+    {
+        const Triangle &triangle = (*m_triangles)[changed[index]];
+        for (uint32_t edge = 0; edge < 3; ++edge)
+        {
+            edgeKeys[3u * index + edge] = GetEdgeKey(triangle.vertices[edge], triangle.vertices[(edge + 1u) % 3u]);
+        }
+        AddTriangleToBBox(bbox, triangle, *m_vertices);
+    }
+
+    eastl::sort(edgeKeys, edgeKeys + 3u * numChanged);
+
+    // Any triangle sharing an edge with a changed triangle overlaps its bounds, and so is in a nearby leaf
+    IDList *nearby = NULL;
+    bool found = false;
+
+    if (GatherUnitTriangles(nearby, clusteredMesh, bbox))
+    {
+        halo = IDList::Allocate(m_allocator, 4u * (numChanged + nearby->size()), EA::Allocator::MEM_TEMP);
+        if (halo)
+        {
+            for (uint32_t index = 0; index < numChanged; ++index)
+            {
+                const uint32_t triangleIndex = changed[index];
+                const TriangleNeighbors &neighbors = (*m_triangleNeighbors)[triangleIndex];
+
+                halo->push_back(triangleIndex);
+                for (uint32_t edge = 0; edge < 3; ++edge)
+                {
+                    if (CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH != neighbors.neighbor[edge])
+                    {
+                        halo->push_back(neighbors.neighbor[edge]);
+                    }
+                }
+            }
+
+            for (uint32_t index = 0; index < nearby->size(); ++index)
+            {
+                const uint32_t triangleIndex = (*nearby)[index];
+                if (ContainsSortedID(changed, triangleIndex))
+                {
+                    continue;
+                }
+
+                const Triangle &triangle = (*m_triangles)[triangleIndex];
+                const TriangleNeighbors &neighbors = (*m_triangleNeighbors)[triangleIndex];
+
+                bool sharesChangedEdge = false;
+                bool neighborsChangedTriangle = false;
+                for (uint32_t edge = 0; edge < 3; ++edge)
+                {
+                    const uint64_t edgeKey = GetEdgeKey(triangle.vertices[edge], triangle.vertices[(edge + 1u) % 3u]);
+                    sharesChangedEdge |= eastl::binary_search(edgeKeys, edgeKeys + 3u * numChanged, edgeKey);
+
+                    neighborsChangedTriangle |=
+                        (CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH != neighbors.neighbor[edge]) &&
+                        ContainsSortedID(changed, neighbors.neighbor[edge]);
+                }
+
+                if (sharesChangedEdge)
+                {
+                    // The previous neighbors of this triangle may lose it to a changed triangle
+                    halo->push_back(triangleIndex);
+                    for (uint32_t edge = 0; edge < 3; ++edge)
+                    {
+                        if (CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH != neighbors.neighbor[edge])
+                        {
+                            halo->push_back(neighbors.neighbor[edge]);
+                        }
+                    }
+                }
+                else if (neighborsChangedTriangle)
+                {
+                    halo->push_back(triangleIndex);
+                }
+            }
+
+            SortAndRemoveDuplicateIDs(*halo);
+            found = true;
+        }
+    }
+
+    IDList::Free(m_allocator, nearby);
+    m_allocator->Free(edgeKeys);
+
+    return found;
+}
+
+
+/**
+\brief Finds the neighbors and edge cosines of the halo triangles again.
+
+The neighbors are found among the halo triangles and the triangles of the KDTree leaves overlapping them,
+which include every triangle sharing an edge with a halo triangle. Only the halo triangles are updated.
+
+\param clusteredMesh The mesh, whose KDTree is used to find the nearby triangles.
+\param halo Sorted list of halo triangles.
+\return false if memory allocation fails.
+*/
+bool
+ClusteredMeshBuilder::UpdateHaloTriangleAdjacency(
+    const rw::collision::ClusteredMesh &clusteredMesh,
+    const IDList &halo)
+{
+    rw::collision::AABBox bbox(GetEmptyBBox());
+    for (uint32_t index = 0; index < halo.size(); ++index)
+    {
+        AddTriangleToBBox(bbox, (*m_triangles)[halo[index]], *m_vertices);
     }
 
-    if (!IsBuilderValid())
-        return clusteredMesh;
+    IDList *local = NULL;
+    if (!GatherUnitTriangles(local, clusteredMesh, bbox, &halo))
+    {
+        IDList::Free(m_allocator, local);
+        return false;
+    }
 
-    // Encode the triangle data
-    EdgeCodeGenerator::GenerateTriangleEdgeCodes(
-        *m_triangleEdgeCodes,
-        *m_triangleEdgeCosines,
-        *m_triangleNeighbors,
-        m_edgeCosConcaveAngleTolerance);
+    // Copy the local triangles, which keep their vertex indices into the whole vertex collection
+    const uint32_t numLocal = local->size();
+    TriangleList *localTriangles = TriangleList::Allocate(m_allocator, numLocal, EA::Allocator::MEM_TEMP);
+    TriangleFlagsList *localTriangleFlags = TriangleFlagsList::Allocate(m_allocator, numLocal, EA::Allocator::MEM_TEMP);
+    TriangleEdgeCosinesList *localTriangleEdgeCosines = TriangleEdgeCosinesList::Allocate(m_allocator, numLocal, EA::Allocator::MEM_TEMP);
+    TriangleNeighborsList *localTriangleNeighbors = TriangleNeighborsList::Allocate(m_allocator, numLocal, EA::Allocator::MEM_TEMP);
+    bool found = false;
 
-    if (buildParams.vertexSmoothing_Enabled)
+    if (localTriangles && localTriangleFlags && localTriangleEdgeCosines && localTriangleNeighbors)
     {
-        ClusteredMeshBuilderMethods::SmoothVertices(
-            vertexTriangleMap,
-            *m_triangles,
-            *m_triangleEdgeCodes,
-            *m_triangleFlags,
+        localTriangles->resize(numLocal);
+        localTriangleFlags->resize(numLocal);
+        localTriangleEdgeCosines->resize(numLocal);
+        localTriangleNeighbors->resize(numLocal);
+
+        for (uint32_t localIndex = 0; localIndex < numLocal; ++localIndex)
+        {
+            (*localTriangles)[localIndex] = (*m_triangles)[(*local)[localIndex]];
+            (*localTriangleFlags)[localIndex] = (*m_triangleFlags)[(*local)[localIndex]];
+        }
+
+        detail::TriangleNeighborFinder::InitializeTriangleEdgeCosines(*localTriangleEdgeCosines);
+        detail::TriangleNeighborFinder::InitializeTriangleNeighbors(*localTriangleNeighbors);
+
+        found = detail::TriangleNeighborFinder::FindTriangleNeighborsByEdgeSort(
+            *localTriangles,
+            *localTriangleEdgeCosines,
+            *localTriangleNeighbors,
+            *localTriangleFlags,
             *m_vertices,
-            m_coplanarCosineTolerance,
-            m_cosineTolerance,
-            m_concaveCosineTolerance);
+            m_allocator);
+
+        if (found)
+        {
+            for (uint32_t index = 0; index < halo.size(); ++index)
+            {
+                const uint32_t triangleIndex = halo[index];
+                const uint32_t localIndex = FindSortedID(*local, triangleIndex);
+                const TriangleNeighbors &localNeighbors = (*localTriangleNeighbors)[localIndex];
+                TriangleNeighbors &neighbors = (*m_triangleNeighbors)[triangleIndex];
+
+                for (uint32_t edge = 0; edge < 3; ++edge)
+                {
+                    neighbors.neighbor[edge] = (CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH == localNeighbors.neighbor[edge]) ?
+                        CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH :
+                        (*local)[localNeighbors.neighbor[edge]];
+                }
+
+                (*m_triangleEdgeCosines)[triangleIndex] = (*localTriangleEdgeCosines)[localIndex];
+            }
+        }
     }
 
-    vertexTriangleMap.Release();
+    TriangleNeighborsList::Free(m_allocator, localTriangleNeighbors);
+    TriangleEdgeCosinesList::Free(m_allocator, localTriangleEdgeCosines);
+    TriangleFlagsList::Free(m_allocator, localTriangleFlags);
+    TriangleList::Free(m_allocator, localTriangles);
+    IDList::Free(m_allocator, local);
 
-    // Release temporary heap after freeing of the vertex triangle map
-    m_allocator->Release(EA::Allocator::MEM_TEMP);
+    return found;
+}
 
-    // Allocate the unit list on the temporary heap
-    m_unitList = UnitList::Allocate(m_allocator, m_numTriangles, EA::Allocator::MEM_TEMP);
-    if (!m_unitList)
+
+/**
+\brief Encodes the edges of the halo triangles again, and finds the clusters which must be rewritten.
+
+\param dirtyClusters Returned sorted list of the indices of the clusters to rewrite, allocated from the temporary heap.
+\param halo Sorted list of halo triangles.
+\param changed Sorted list of changed triangles.
+\return false if memory allocation fails.
+*/
+bool
+ClusteredMeshBuilder::UpdateHaloTriangleEdgeCodes(
+    IDList *&dirtyClusters,
+    const IDList &halo,
+    const IDList &changed)
+{
+    dirtyClusters = IDList::Allocate(m_allocator, halo.size(), EA::Allocator::MEM_TEMP);
+    if (!dirtyClusters)
     {
-        m_isBuilderValid = FALSE;
-        return clusteredMesh;
+        return false;
     }
 
-    // Create lists of units on which the clusters will be based
-    const uint32_t numUnits = BuildUnitList(buildParams.quads_Enable);
+    const rwpmath::VecFloat minConcaveEdgeCosine(m_edgeCosConcaveAngleTolerance);
 
-    // Free triangle adjacency data containers
-    TriangleNeighborsList::Free(m_allocator, m_triangleNeighbors);
-    TriangleEdgeCosinesList::Free(m_allocator, m_triangleEdgeCosines);
-    TriangleFlagsList::Free(m_allocator, m_triangleFlags);
+    for (uint32_t index = 0; index < halo.size(); ++index)
+    {
+        const uint32_t triangleIndex = halo[index];
+        const TriangleEdgeCodes previousEdgeCodes = (*m_triangleEdgeCodes)[triangleIndex];
 
-    // Release the permanent heap; done with triangle adjacency data containers
-    m_allocator->Release(EA::Allocator::MEM_PERM);
+        // The edge codes are ORed in, so reset them first
+        (*m_triangleEdgeCodes)[triangleIndex] = TriangleEdgeCodes();
+        EdgeCodeGenerator::GenerateTriangleEdgeCodes(
+            *m_triangleEdgeCodes,
+            *m_triangleEdgeCosines,
+            *m_triangleNeighbors,
+            minConcaveEdgeCosine,
+            triangleIndex,
+            triangleIndex + 1u);
 
-    if (!IsBuilderValid())
-        return clusteredMesh;
+        const uint32_t unitID = (*m_triangleUnits)[triangleIndex];
+        if (CLUSTEREDMESHBUILDER_NOUNIT == unitID)
+        {
+            continue;
+        }
 
-    // Build the KDTree, implicitly using the temporary heap
-    rw::collision::AABBoxU *unitAABBoxes = GetAllUnitBBoxes();
-    KDTreeBuilder kdTreeBuilder(*m_allocator);
+        const TriangleEdgeCodes &edgeCodes = (*m_triangleEdgeCodes)[triangleIndex];
+        if (ContainsSortedID(changed, triangleIndex) ||
+            edgeCodes.encodedEdgeCos[0] != previousEdgeCodes.encodedEdgeCos[0] ||
+            edgeCodes.encodedEdgeCos[1] != previousEdgeCodes.encodedEdgeCos[1] ||
+            edgeCodes.encodedEdgeCos[2] != previousEdgeCodes.encodedEdgeCos[2])
+        {
+            dirtyClusters->push_back((*m_unitEntries)[unitID] >> m_unitClusterIDShift);
+        }
+    }
 
-    kdTreeBuilder.BuildTree(
-        numUnits,
-        unitAABBoxes,
-        buildParams.kdTreeBuilder_SplitThreshold,
-        buildParams.kdTreeBuilder_LargeItemThreshold,
-        buildParams.kdTreeBuilder_MinChildEntriesThreshold,
-        buildParams.kdTreeBuilder_MaxEntriesPerNode,
-        buildParams.kdTreeBuilder_MinSimilarAreaThreshold);
+    SortAndRemoveDuplicateIDs(*dirtyClusters);
 
-    if (!kdTreeBuilder.SuccessfulBuild())
-        return clusteredMesh;
+    return true;
+}
 
-    // Create the Clusters using the KDTree
-    uint32_t numBranchNodes = kdTreeBuilder.GetNumBranchNodes();
-    rw::collision::AABBox rootBBox = kdTreeBuilder.GetRootBBox();
-    uint32_t numClusters = CreateClustersUsingKDTree(kdTreeBuilder);
 
-    if (!IsBuilderValid())
-        return clusteredMesh;
+/**
+\brief Finds the vertices and compression of each cluster to rewrite, checking that it fits in place.
 
-    UnitClusterStack & unitClusterStack = GetUnitClusterStack();
-    UnitClusterStack::ClusterIterator it = unitClusterStack.Begin();
-    const UnitClusterStack::ClusterIterator itEnd = unitClusterStack.End();
+\param updatedClusters Returned copies of the unit clusters of the clusters to rewrite, allocated from the temporary heap.
+\param clusteredMesh The mesh.
+\param dirtyClusters Sorted list of the indices of the clusters to rewrite.
+\return false if memory allocation fails, or a cluster no longer fits in place.
+*/
+bool
+ClusteredMeshBuilder::PrepareUpdatedClusters(
+    UnitCluster *&updatedClusters,
+    const rw::collision::ClusteredMesh &clusteredMesh,
+    const IDList &dirtyClusters)
+{
+    const uint32_t numDirtyClusters = dirtyClusters.size();
+    if (0u == numDirtyClusters)
+    {
+        return true;
+    }
 
-    // Determine the Cluster Compression modes
-    while (it != itEnd)
+    updatedClusters = static_cast<UnitCluster *>(
+        m_allocator->Alloc(numDirtyClusters * sizeof(UnitCluster), "UpdatedClusters", EA::Allocator::MEM_TEMP, 4));
+    if (NULL == updatedClusters)
     {
-        UnitCluster * unitCluster = *it;
-        DetermineClusterCompressionMode(buildParams.vertexCompression_Enable, *unitCluster);
-        ++it;
+        return false;
     }
 
-    // Determine required granularity
-    float granularityNeeded = 0.0f;
-    if (buildParams.vertexCompression_Enable)
+    const uint32_t offsetMask = (1u << m_unitClusterIDShift) - 1u;
+
+    for (uint32_t index = 0; index < numDirtyClusters; ++index)
     {
-        it = unitClusterStack.Begin();
+        const uint32_t clusterIndex = dirtyClusters[index];
+        UnitCluster &unitCluster = *new (&updatedClusters[index]) UnitCluster(*m_unitClusters[clusterIndex]);
 
-        while (it != itEnd)
+        // The units must stay at the same offsets, since these are the KDTree entries
+        uint32_t sizeofUnitData = 0;
+        for (uint32_t unitIndex = 0; unitIndex < unitCluster.numUnits; ++unitIndex)
         {
-            UnitCluster * unitCluster = *it;
+            const uint32_t unitID = unitCluster.unitIDs[unitIndex];
+            const Unit &unit = (*m_unitList)[unitID];
 
-            float minGranularityForThis = CalculateMinimumGranularityForCluster(*unitCluster);
-            if ( unitCluster->clusterID == 0 || ( minGranularityForThis > granularityNeeded ) )
+            if (((*m_unitEntries)[unitID] & offsetMask) != sizeofUnitData)
             {
-                granularityNeeded = minGranularityForThis;
+                EAPHYSICS_MESSAGE("The size of a unit in cluster %d has changed.", clusterIndex);
+                return false;
             }
-            ++it;
+
+            sizeofUnitData += ClusteredMeshCluster::GetUnitSize(static_cast<uint8_t>(unit.type),
+                                                                m_unitParameters,
+                                                                (*m_triangleGroupIDs)[unit.tri0],
+                                                                (*m_triangleSurfaceIDs)[unit.tri0]);
         }
 
-        granularityNeeded *= 2.0f;
-        EAPHYSICS_MESSAGE( "Granularity needed to fit all clusters in 16 bits: %f", granularityNeeded );
+        // Collect the vertices of the units again. The unit IDs are rewritten unchanged.
+        const bool hasVertexCodes = (0 != unitCluster.hasVertexCodes);
+        unitCluster.hasVertexCodes = 0;
+        const uint32_t maxVerticesPerUnit = 4;
+        const uint32_t numUnits = unitCluster.numUnits;
+        uint32_t numUnitsAdded = 0;
+        unitCluster.numVertices = 0;
+
+        ClusteredMeshBuilderMethods::AddOrderedUnitsToUnitCluster(
+            unitCluster.vertexIDs,
+            unitCluster.numVertices,
+            unitCluster.unitIDs,
+            numUnitsAdded,
+            unitCluster.unitIDs,
+            0u,
+            numUnits,
+            *m_triangles,
+            *m_unitList,
+            maxVerticesPerUnit);
 
-        if (granularityNeeded > buildParams.vertexCompression_Granularity)
+        if (numUnitsAdded != numUnits)
         {
-            EAPHYSICS_MESSAGE("Vertex compression granularity exceeded: needed %f, allowed %f",
-                       granularityNeeded,
-                       buildParams.vertexCompression_Granularity);
+            EAPHYSICS_MESSAGE("Cluster %d has too many vertices after the edit.", clusterIndex);
+            return false;
         }
 
-        granularityNeeded = buildParams.vertexCompression_Granularity;
+        // Number the vertices in unit order again, if the cluster was built with unit ordering
+        if (hasVertexCodes)
+        {
+            UnitClusterBuilder::AssignVertexCodesInUnitOrder(unitCluster, *m_triangles, *m_unitList);
+        }
+
+        DetermineClusterCompressionMode(m_compressVerts, unitCluster);
+
+        // The cluster must fill the same space, so that the other clusters are untouched
+        ClusterConstructionParameters parameters;
+        InitializeClusterConstructionParameters(parameters, unitCluster);
+
+        const uint32_t size = EA::Physics::SizeAlign<uint32_t>(
+            ClusteredMeshCluster::GetSize(parameters), rwcCLUSTEREDMESHCLUSTER_ALIGNMENT);
+        const uint32_t existingSize = EA::Physics::SizeAlign<uint32_t>(
+            clusteredMesh.GetClusterSize(clusteredMesh.GetCluster(clusterIndex)), rwcCLUSTEREDMESHCLUSTER_ALIGNMENT);
+
+        if (size != existingSize)
+        {
+            EAPHYSICS_MESSAGE("The size of cluster %d has changed from %d to %d bytes.", clusterIndex, existingSize, size);
+            return false;
+        }
     }
 
-    // Allocate and Create the runtime ClusteredMesh
-    EA::Physics::SizeAndAlignment resDesc = ClusteredMesh::GetResourceDescriptor(numClusters,
-                                                                                 GetClusterTotalSize(),
-                                                                                 numBranchNodes,
-                                                                                 numUnits,
-                                                                                 rootBBox,
-                                                                                 granularityNeeded,
-                                                                                 sizeof(ClusteredMesh),
-                                                                                 TRUE);
+    return true;
+}
 
-    // Allocate the resource
-    void * resource = clusteredMeshAllocator->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
-    EA::Physics::MemoryPtr rwResource(resource);
 
-    // Initialize the ClusteredMesh
-    clusteredMesh = ClusteredMesh::Initialize(rwResource,
-                                              numClusters,
-                                              GetClusterTotalSize(),
-                                              numBranchNodes,
-                                              numUnits,
-                                              rootBBox,
-                                              granularityNeeded,
-                                              sizeof(ClusteredMesh),
-                                              TRUE);
+/**
+\brief Finds the KDTree leaf of each unit holding a changed triangle.
 
-    // Check that the allocation and initialization were successful
-    if (!clusteredMesh)
+\param changedUnits Returned sorted list of the units holding changed triangles, allocated from the temporary heap.
+\param unitLeaves Returned leaf of each changed unit, as returned by FindUnitLeaf, allocated from the temporary heap.
+\param clusteredMesh The mesh.
+\param changed Sorted list of changed triangles.
+\return false if memory allocation fails, or a leaf is not found.
+*/
+bool
+ClusteredMeshBuilder::FindChangedUnitLeaves(
+    IDList *&changedUnits,
+    IDList *&unitLeaves,
+    const rw::collision::ClusteredMesh &clusteredMesh,
+    const IDList &changed)
+{
+    changedUnits = IDList::Allocate(m_allocator, changed.size(), EA::Allocator::MEM_TEMP);
+    unitLeaves = IDList::Allocate(m_allocator, changed.size(), EA::Allocator::MEM_TEMP);
+    if (!changedUnits || !unitLeaves)
     {
-        clusteredMeshAllocator->Free(resource);
-        return clusteredMesh;
+        return false;
     }
 
-    clusteredMesh->SetGroupIdSize(static_cast<uint8_t>(buildParams.groupId_NumBytes));
-    clusteredMesh->SetSurfaceIdSize(static_cast<uint8_t>(buildParams.surfaceId_NumBytes));
+    for (uint32_t index = 0; index < changed.size(); ++index)
+    {
+        const uint32_t unitID = (*m_triangleUnits)[changed[index]];
+        if (CLUSTEREDMESHBUILDER_NOUNIT != unitID)
+        {
+            changedUnits->push_back(unitID);
+        }
+    }
 
-    // Populate each Cluster of the runtime ClusteredMesh
-    it = unitClusterStack.Begin();
+    SortAndRemoveDuplicateIDs(*changedUnits);
 
-    while (it != itEnd)
+    // A tree without branch nodes is a single leaf, bounded only by the tree bounds
+    const bool hasBranchNodes = (clusteredMesh.GetKDTreeBase()->m_numBranchNodes > 0u);
+
+    for (uint32_t index = 0; index < changedUnits->size(); ++index)
     {
-        UnitCluster * unitCluster = *it;
+        const uint32_t leaf = hasBranchNodes ? FindUnitLeaf(clusteredMesh, (*changedUnits)[index]) : CLUSTEREDMESHBUILDER_NOLEAF;
+        if (hasBranchNodes && CLUSTEREDMESHBUILDER_NOLEAF == leaf)
+        {
+            EAPHYSICS_MESSAGE("The KDTree leaf of unit %d was not found.", (*changedUnits)[index]);
+            return false;
+        }
 
-        ClusterConstructionParameters parameters;
+        unitLeaves->push_back(leaf);
+    }
 
-        InitializeClusterConstructionParameters(parameters, *unitCluster);
+    return true;
+}
 
-        ClusteredMeshCluster *newcluster = clusteredMesh->AllocateNextCluster(parameters);
 
-        InitializeCluster(newcluster, *unitCluster);
+/**
+\brief Rewrites the updated clusters in place and refits the KDTree to the changed units.
 
-        ++it;
+\param clusteredMesh The mesh.
+\param dirtyClusters Sorted list of the indices of the clusters to rewrite.
+\param updatedClusters Unit clusters of the clusters to rewrite, from PrepareUpdatedClusters.
+\param changedUnits Sorted list of the units holding changed triangles.
+\param unitLeaves Leaf of each changed unit, from FindChangedUnitLeaves.
+*/
+void
+ClusteredMeshBuilder::ApplyClusteredMeshUpdate(
+    rw::collision::ClusteredMesh &clusteredMesh,
+    const IDList &dirtyClusters,
+    const UnitCluster *const updatedClusters,
+    const IDList &changedUnits,
+    const IDList &unitLeaves)
+{
+    // Rewrite each cluster in the space it already fills
+    for (uint32_t index = 0; index < dirtyClusters.size(); ++index)
+    {
+        const uint32_t clusterIndex = dirtyClusters[index];
+        UnitCluster &unitCluster = *m_unitClusters[clusterIndex];
+        unitCluster = updatedClusters[index];
+
+        ClusterConstructionParameters parameters;
+        InitializeClusterConstructionParameters(parameters, unitCluster);
+
+        rw::collision::ClusteredMeshCluster *cluster = rw::collision::ClusteredMeshCluster::Initialize(
+            reinterpret_cast<void *>(&clusteredMesh.GetCluster(clusterIndex)), parameters);
+        InitializeCluster(cluster, unitCluster);
     }
 
-    // Initialize the runtime KDTree
-    kdTreeBuilder.InitializeRuntimeKDTree(clusteredMesh->GetKDTree());
+    // Refit the leaf of each changed unit, and the branches above it, to the units once compressed
+    rw::collision::KDTreeBase &kdtree = *clusteredMesh.GetKDTreeBase();
 
-    // Update the ClusteredMesh after having populated each cluster and initalizing the KDTree
-    clusteredMesh->Update();
+    if (kdtree.m_numBranchNodes > 0u)
+    {
+        for (uint32_t index = 0; index < unitLeaves.size(); ++index)
+        {
+            RefitKDTreeBranchExtents(kdtree, unitLeaves[index]);
+        }
 
-    // Create the workspace for KDSubTree array creation
-    m_allocator->Mark(EA::Allocator::MEM_TEMP);
-    EA::Physics::SizeAndAlignment workspaceDesc(rw::collision::GetKDSubTreeWorkSpaceResourceDescriptor(*clusteredMesh));
-    void *workspace = m_allocator->Alloc(workspaceDesc.size, NULL, EA::Allocator::MEM_TEMP, workspaceDesc.alignment);
-    if (NULL == workspace)
+        // The root bounds its two children
+        kdtree.m_bbox = m_kdTreeChildBBoxes[0];
+        kdtree.m_bbox.Union(m_kdTreeChildBBoxes[1]);
+    }
+    else
     {
-        EAPHYSICS_MESSAGE("While generating the KDSubTree the builder allocator ran out of memory.");
-        m_isBuilderValid = FALSE;
-        return clusteredMesh;
+        // A tree without branch nodes is a single leaf of all the units
+        rw::collision::KDTreeBase::NodeRef leafRef;
+        leafRef.m_content = kdtree.m_numEntries;
+        leafRef.m_index = (*m_unitEntries)[GetUnitAtPosition(0u)];
+        GetKDTreeLeafBBox(kdtree.m_bbox, leafRef);
     }
 
-    EA::Physics::MemoryPtr workspaceRes(workspace);
-     
-    // Create KDSubTree array from ClusteredMesh
-    KDTreeWithSubTrees *kdSubTreeArray = static_cast<KDTreeWithSubTrees *>(static_cast<KDTreeBase *>(clusteredMesh->GetKDTree()));
-    rw::collision::CreateKDSubTreeArray(kdSubTreeArray->GetKDSubTrees(), workspaceRes, *clusteredMesh);
+    // Refit the KDSubTrees of the rewritten clusters, as CreateKDSubTreeArray does
+    KDTreeWithSubTrees &kdtreeWithSubTrees = static_cast<KDTreeWithSubTrees &>(kdtree);
+    if (kdtreeWithSubTrees.GetNumKDSubTrees() > 0u)
+    {
+        KDSubTree *const kdSubTrees = kdtreeWithSubTrees.GetKDSubTrees();
 
-    // Free KDSubTree workspace as it is no longer needed
-    m_allocator->Free(workspace);
-    m_allocator->Release(EA::Allocator::MEM_TEMP);
+        if (clusteredMesh.GetNumCluster() == 1u)
+        {
+            // special case for one cluster - just a copy of the whole KD tree
+            kdSubTrees[0].Initialize(&kdtree,
+                0,
+                kdtree.m_numBranchNodes,
+                kdtree.m_numEntries,
+                0,
+                kdtree.m_bbox);
+        }
+        else
+        {
+            const rwpmath::VecFloat compressionGranularity = clusteredMesh.GetVertexCompressionGranularity();
 
-    // Deallocate workspace data
-    UnitList::Free(m_allocator, m_unitList);
-    m_unitClusterStack.Release();
+            for (uint32_t index = 0; index < dirtyClusters.size(); ++index)
+            {
+                const uint32_t clusterIndex = dirtyClusters[index];
+                const rw::collision::ClusteredMeshCluster &cluster = clusteredMesh.GetCluster(clusterIndex);
+
+                rw::collision::AABBox clusterBBox(GetEmptyBBox());
+                for (uint8_t vertexNo = 0; vertexNo < cluster.vertexCount; ++vertexNo)
+                {
+                    clusterBBox.Union(cluster.GetVertex(vertexNo, compressionGranularity));
+                }
+                clusterBBox.m_min -= compressionGranularity;
+                clusterBBox.m_max += compressionGranularity;
+
+                KDSubTree &kdSubTree = kdSubTrees[clusterIndex];
+                kdSubTree.Initialize(&kdtree,
+                    kdSubTree.GetBranchNodeOffset(),
+                    kdSubTree.GetNumBranchNodes(),
+                    kdSubTree.m_numEntries,
+                    kdSubTree.GetDefaultEntry(),
+                    clusterBBox);
+            }
+        }
+    }
 
-    // Return the ClusteredMesh
-    return clusteredMesh;
+    // Refill the unit bounds of the rewritten clusters, if the mesh has them
+    for (uint32_t index = 0; index < dirtyClusters.size(); ++index)
+    {
+        clusteredMesh.UpdateClusterUnitBounds(dirtyClusters[index]);
+    }
+
+    // Update the ClusteredMesh after having rewritten the clusters and refitted the KDTree
+    clusteredMesh.Update();
 }
 
 
@@ -526,13 +2462,17 @@ ClusteredMeshBuilder::BuildClusteredMesh(
 \param flags_Default Default unit flags, see ClusteredMesh::UnitTypeAndFlags.
 \param group_Size 1, or 2 bytes, size of group id of each triangle.
 \param surf_Size 1, or 2 bytes, size of surface id of each triangle.
+\param vertexCompression_Adaptive Allow 8-bit and 10-bit vertex compression of small clusters.
+\param vertexCompression_MaxError Additional error allowed in each vertex component by 8-bit and 10-bit compression.
 */
 void
 ClusteredMeshBuilder::SetClusterOptions(const bool vertexCompression_Enable,
                                         const float vertexCompression_Granularity,
                                         const uint16_t flagsDefault,
                                         const uint8_t groupId_NumBytes,
-                                        const uint8_t surfaceId_NumBytes)
+                                        const uint8_t surfaceId_NumBytes,
+                                        const bool vertexCompression_Adaptive,
+                                        const float vertexCompression_MaxError)
 {
     EA_ASSERT_MSG(m_isBuilderValid, "Builder is in an invalid state - memory allocation has failed before this point");
     EA_ASSERT_MSG(!((flagsDefault != rw::collision::UNITFLAG_USEOLDTRI) && (flagsDefault & rw::collision::UNITFLAG_NORMAL)),
@@ -541,6 +2481,10 @@ ClusteredMeshBuilder::SetClusterOptions(const bool vertexCompression_Enable,
 
     m_compressVerts = vertexCompression_Enable;
     m_vertexCompressionGranularity = vertexCompression_Granularity;
+    m_adaptiveCompression = vertexCompression_Adaptive;
+    m_maxGranularityShift = VertexCompression::CalculateMaximumGranularityShift(
+        vertexCompression_Granularity,
+        vertexCompression_MaxError);
 
     // If unitFlagsdefault is set to UNITFLAG_USEOLDTRI then all flags are unset. Here UNITFLAGS_OLDTRIANGLE corresponds to 0.
     // If unitFlagsdefault is not set the UNITFLAG_USEOLDTRI then the UNITFLAG_NORMAL flag is unset.
@@ -620,6 +2564,25 @@ ClusteredMeshBuilder::SetEdgeCosConcaveAngleTolerance(float edgecosAngle)
 }
 
 
+/**
+\brief Sets the index of the first border triangle.
+
+The triangles from this index on are border triangles, copied from the neighbors of a part of a larger
+mesh. They are used to find the neighbors, edge cosines and edge codes of the other triangles, as in a
+build of the whole mesh, but are disabled before the units are built, so are not in the ClusteredMesh.
+By default there are no border triangles.
+
+\param triangleIndex Index of the first border triangle.
+*/
+void
+ClusteredMeshBuilder::SetFirstBorderTriangle(uint32_t triangleIndex)
+{
+    EA_ASSERT_MSG(triangleIndex <= m_numTriangles, "ClusteredMeshBuilder::SetFirstBorderTriangle: triangle index out of range.\n");
+
+    m_firstBorderTriangle = triangleIndex;
+}
+
+
 /**
 \brief Adjusts the tolerance used to control vertex merging.
 The complete collection of input triangle edges are measured and an average and minimum edge length is
@@ -657,9 +2620,10 @@ ClusteredMeshBuilder::AdjustVertexMergeDistanceToleranceUsingEdgeScale()
 \brief Merges vertices which are within a separation tolerance of each other.
 
 \param mergeVertices Flag used to control whether or not merging takes place.
+\param dispatcher Optional dispatcher used to search for nearby vertices in parallel.
 */
 void
-ClusteredMeshBuilder::MergeVertexGroups(bool mergeVertices)
+ClusteredMeshBuilder::MergeVertexGroups(bool mergeVertices, IParallelDispatcher *dispatcher)
 {
     EA_ASSERT_MSG(m_isBuilderValid, "Builder is in an invalid state - memory allocation has failed before this point");
     EA_ASSERT_MSG(m_triangles->size() != 0, "Input triangle count should not be zero");
@@ -693,7 +2657,8 @@ ClusteredMeshBuilder::MergeVertexGroups(bool mergeVertices)
             *m_allocator,
             m_vertAABBox,
             m_vertexMergeDistanceTolerance,
-            *m_vertices))
+            *m_vertices,
+            dispatcher))
         {
             m_isBuilderValid = false;
             return;
@@ -743,7 +2708,7 @@ ClusteredMeshBuilder::FixUnmatchedEdges(const uint32_t maxInputLimit)
 
     // Calculate how big a grid spatial map we can allocate
     const uint32_t maxBufferSize = m_allocator->LargestAllocatableSize(EA::Allocator::MEM_TEMP, 4);
-    uint32_t maxInputs = GridSpatialMap::MaxNumInputs(maxBufferSize, 16u);
+    uint32_t maxInputs = GridSpatialMap::MaxNumInputs(maxBufferSize, FIXUNMATCHEDEDGES_GRIDRESOLUTION);
 
     // Limit the actual size to a reasonable maximum, so we don't allocate all available memory!
     if (maxInputs > maxInputLimit)
@@ -752,7 +2717,7 @@ ClusteredMeshBuilder::FixUnmatchedEdges(const uint32_t maxInputLimit)
     }
 
     // The resolution of the spatial map.
-    uint32_t gridResolution = 16u;
+    uint32_t gridResolution = FIXUNMATCHEDEDGES_GRIDRESOLUTION;
 
     // Mark temporary heap before allocation of the grid spatial map
     m_allocator->Mark(EA::Allocator::MEM_TEMP);
@@ -873,11 +2838,13 @@ ClusteredMeshBuilder::BuildUnitList(bool findQuads)
         return 0;
     }
 
+    // The boxes are grown by the rounding of adaptive compression, so the KDTree contains the decoded vertices
     ClusteredMeshBuilderMethods::BuildUnitAABBoxesList(
         m_unitAABBoxList,
         *m_unitList,
         *m_triangles,
-        *m_vertices);
+        *m_vertices,
+        GetAdaptiveCompressionError());
 
     return m_unitList->size();
 }
@@ -903,10 +2870,12 @@ and the parent of the branch contains more than 256 unique vertices: create a cl
 that branch.
 
 \param kdtreeBuilder a kdtree builder object. The start index might be altered.
+\param unitOrdering_Enable Reorders the units within each leaf of a cluster, see Parameters::unitOrdering_Enable.
 \return The number of clusters found, or zero on failure.
 */
 uint32_t
-ClusteredMeshBuilder::CreateClustersUsingKDTree(rw::collision::KDTreeBuilder& kdtreeBuilder)
+ClusteredMeshBuilder::CreateClustersUsingKDTree(rw::collision::KDTreeBuilder& kdtreeBuilder,
+                                                const bool unitOrdering_Enable)
 {
     EA_ASSERT_MSG(m_isBuilderValid, "Builder is in an invalid state - memory allocation has failed before this point");
     EA_ASSERT_MSG(m_triangles->size() != 0, "m_triangles count should not be zero");
@@ -975,6 +2944,16 @@ ClusteredMeshBuilder::CreateClustersUsingKDTree(rw::collision::KDTreeBuilder& kd
                     unitCluster->clusterID,
                     unitClusterIDShift);
 
+                if (unitOrdering_Enable)
+                {
+                    ClusteredMeshBuilderMethods::OrderUnitsInCluster(
+                        *unitCluster,
+                        leafMap,
+                        *m_triangles,
+                        *m_unitList,
+                        *m_vertices);
+                }
+
                 ++it;
             }
         }
@@ -1016,8 +2995,8 @@ ClusteredMeshBuilder::CreateClustersUsingKDTree(rw::collision::KDTreeBuilder& kd
 
 
 /**
-\brief Check if this cluster's vertices fit into 16 bits given the granularity, and mark the cluster
-appropriately.
+\brief Check if this cluster's vertices fit into 16 bits given the granularity, or into 8 or 10 bits with adaptive
+compression, and mark the cluster appropriately.
 
 \param vertexCompressionOn Flag indicating whether or not vertex compression can take place.
 \param clusterid ID of cluster.
@@ -1053,12 +3032,28 @@ ClusteredMeshBuilder::DetermineClusterCompressionMode(bool vertexCompressionOn,
             firstRun = false;
         }
 
-        VertexCompression::DetermineCompressionModeAndOffsetForRange(
-            unitCluster.compressionMode,
-            unitCluster.clusterOffset,
-            x32min, x32max,
-            y32min, y32max,
-            z32min, z32max);
+        if ( m_adaptiveCompression )
+        {
+            uint32_t granularityShift = 0;
+            VertexCompression::DetermineAdaptiveCompressionModeAndOffsetForRange(
+                unitCluster.compressionMode,
+                unitCluster.clusterOffset,
+                granularityShift,
+                x32min, x32max,
+                y32min, y32max,
+                z32min, z32max,
+                m_maxGranularityShift);
+            unitCluster.granularityShift = static_cast<uint8_t>(granularityShift);
+        }
+        else
+        {
+            VertexCompression::DetermineCompressionModeAndOffsetForRange(
+                unitCluster.compressionMode,
+                unitCluster.clusterOffset,
+                x32min, x32max,
+                y32min, y32max,
+                z32min, z32max);
+        }
     }
     else
     {
@@ -1108,6 +3103,27 @@ ClusteredMeshBuilder::CalculateMinimumGranularityForCluster( const UnitCluster &
 }
 
 
+/**
+\brief Returns the largest distance by which adaptive vertex compression can move a vertex component, in addition
+to the rounding to the mesh granularity.
+
+Rounding to a cluster granularity of 2^shift mesh granules moves a vertex by at most 2^(shift-1) granules, which
+is within Parameters::vertexCompression_MaxError.
+
+\return The distance, zero when adaptive compression is not used.
+*/
+float
+ClusteredMeshBuilder::GetAdaptiveCompressionError() const
+{
+    if (!m_compressVerts || !m_adaptiveCompression || m_maxGranularityShift == 0)
+    {
+        return 0.0f;
+    }
+
+    return static_cast<float>(1u << (m_maxGranularityShift - 1u)) * m_vertexCompressionGranularity;
+}
+
+
 /**
 \brief Returns the number of bytes in the specified cluster, including vertices, etc.
 
@@ -29,6 +29,123 @@ namespace detail
 {
 
 
+namespace
+{
+
+/// Number of triangles in each range of the parallel triangle validation.
+const uint32_t VALIDATETRIANGLES_GRAINSIZE = 4096u;
+
+struct ValidateTrianglesContext
+{
+    TriangleFlagsList *triangleFlags;
+    const TriangleList *triangles;
+    const VertexList *vertices;
+};
+
+void ValidateTrianglesInRange(void *contextPtr, uint32_t /*workerIndex*/, uint32_t begin, uint32_t end)
+{
+    const ValidateTrianglesContext &context = *static_cast<const ValidateTrianglesContext *>(contextPtr);
+    ClusteredMeshBuilderMethods::ValidateTriangles(*context.triangleFlags, *context.triangles, *context.vertices, begin, end);
+}
+
+/// Largest quantized coordinate of a unit centroid, leaving room for the 10 bits of each coordinate in the Morton code.
+const float UNITORDERING_MAXCOORDINATE = 1023.0f;
+
+/**
+Spreads the low 10 bits of a value so that there are two zero bits between each bit.
+*/
+uint32_t SpreadBits(uint32_t x)
+{
+    x &= 0x000003ffu;
+    x = (x | (x << 16)) & 0x030000ffu;
+    x = (x | (x << 8)) & 0x0300f00fu;
+    x = (x | (x << 4)) & 0x030c30c3u;
+    x = (x | (x << 2)) & 0x09249249u;
+    return x;
+}
+
+/**
+Orders units on the 30 bit Morton code of the quantized centroid of their vertices, then on unit ID.
+*/
+class UnitMortonCompare
+{
+public:
+
+    UnitMortonCompare(const TriangleList &triangles,
+                      const UnitList &unitList,
+                      const VertexList &vertices,
+                      const float *minimum,
+                      const float *maximum)
+        : m_triangles(triangles)
+        , m_unitList(unitList)
+        , m_vertices(vertices)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float extent = maximum[axis] - minimum[axis];
+            m_minimum[axis] = minimum[axis];
+            m_scale[axis] = (extent > 0.0f) ? UNITORDERING_MAXCOORDINATE / extent : 0.0f;
+        }
+    }
+
+    uint32_t GetKey(const uint32_t unitID) const
+    {
+        const Unit &unit = m_unitList[unitID];
+        const Triangle &triangle = m_triangles[unit.tri0];
+
+        float centroid[3] = { 0.0f, 0.0f, 0.0f };
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            AddVertex(centroid, triangle.vertices[i]);
+        }
+
+        float numVertices = 3.0f;
+        if (unit.type == Unit::TYPE_QUAD)
+        {
+            AddVertex(centroid, m_triangles[unit.tri1].vertices[unit.extraVertex]);
+            numVertices = 4.0f;
+        }
+
+        uint32_t key = 0;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float coordinate = (centroid[axis] / numVertices - m_minimum[axis]) * m_scale[axis];
+            coordinate = (coordinate < 0.0f) ? 0.0f : ((coordinate > UNITORDERING_MAXCOORDINATE) ? UNITORDERING_MAXCOORDINATE : coordinate);
+            key |= SpreadBits(static_cast<uint32_t>(coordinate)) << axis;
+        }
+
+        return key;
+    }
+
+    bool operator()(const uint32_t &left, const uint32_t &right) const
+    {
+        const uint32_t leftKey = GetKey(left);
+        const uint32_t rightKey = GetKey(right);
+        return (leftKey < rightKey) || (leftKey == rightKey && left < right);
+    }
+
+private:
+
+    void AddVertex(float *centroid, const uint32_t vertexIndex) const
+    {
+        const meshbuilder::VectorType &v = m_vertices[vertexIndex];
+        centroid[0] += v.GetX();
+        centroid[1] += v.GetY();
+        centroid[2] += v.GetZ();
+    }
+
+    const TriangleList &m_triangles;
+    const UnitList &m_unitList;
+    const VertexList &m_vertices;
+    float m_minimum[3];
+    float m_scale[3];
+
+    UnitMortonCompare & operator = (const UnitMortonCompare & other);
+};
+
+} // namespace
+
+
 /*
 \brief Calculates the average and minimum edge lengths of a collection of triangles.
 
@@ -94,19 +211,74 @@ ClusteredMeshBuilderMethods::AdjustVertexMergeDistanceTolerance(
 \param triangleFlags collection of triangle flags
 \param triangles collection of triangles
 \param vertices collection of vertices
+\param dispatcher optional dispatcher used to validate ranges of triangles in parallel
 \return number of valid triangles
 */
 uint32_t
 ClusteredMeshBuilderMethods::ValidateTriangles(
     TriangleFlagsList & triangleFlags,
     const TriangleList & triangles,
-    const VertexList & vertices)
+    const VertexList & vertices,
+    IParallelDispatcher * dispatcher)
 {
     // This method validates the triangle data, marking degenerates as invalid
     const uint32_t numTriangles(triangles.size());
+    uint32_t numValidTriangles(0);
+
+    if (dispatcher)
+    {
+        ValidateTrianglesContext context;
+        context.triangleFlags = &triangleFlags;
+        context.triangles = &triangles;
+        context.vertices = &vertices;
+
+        IParallelDispatcher::Run(dispatcher, ValidateTrianglesInRange, &context, numTriangles, VALIDATETRIANGLES_GRAINSIZE);
+
+        for (uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+        {
+            numValidTriangles += triangleFlags[triangleIndex].enabled ? 1u : 0u;
+        }
+    }
+    else
+    {
+        numValidTriangles = ValidateTriangles(triangleFlags, triangles, vertices, 0u, numTriangles);
+    }
+
+    const uint32_t numDiscardedTriangles(numTriangles - numValidTriangles);
+
+    if (numDiscardedTriangles > 0)
+    {
+        EAPHYSICS_MESSAGE("Discarding %u of %u triangles because they have negligible area.", numDiscardedTriangles, numTriangles);
+    }
+
+    return numValidTriangles;
+}
+
+
+/**
+\brief Validates a range of the collection of builder triangles
+
+Each triangle only affects its own flags, so disjoint ranges may be validated concurrently.
+
+\param triangleFlags collection of triangle flags
+\param triangles collection of triangles
+\param vertices collection of vertices
+\param begin index of the first triangle
+\param end index one past the last triangle
+\return number of valid triangles in the range
+*/
+uint32_t
+ClusteredMeshBuilderMethods::ValidateTriangles(
+    TriangleFlagsList & triangleFlags,
+    const TriangleList & triangles,
+    const VertexList & vertices,
+    const uint32_t begin,
+    const uint32_t end)
+{
+    EA_ASSERT(end <= triangles.size());
     uint32_t numDiscardedTriangles(0);
 
-    for (uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex)
+    for (uint32_t triangleIndex = begin; triangleIndex < end; ++triangleIndex)
     {
         const Triangle &triangle = triangles[triangleIndex];
 
@@ -132,12 +304,7 @@ ClusteredMeshBuilderMethods::ValidateTriangles(
         }
     }
 
-    if (numDiscardedTriangles > 0)
-    {
-        EAPHYSICS_MESSAGE("Discarding %u of %u triangles because they have negligible area.", numDiscardedTriangles, numTriangles);
-    }
-
-    return (numTriangles - numDiscardedTriangles);
+    return (end - begin - numDiscardedTriangles);
 }
 
 
@@ -626,14 +793,17 @@ ClusteredMeshBuilderMethods::SmoothVertices(
 \param unitList collection of units
 \param triangles collection of triangles.
 \param vertices collection of vertices.
+\param padding distance by which each box is grown, to contain the vertices once compressed.
 */
 void
 ClusteredMeshBuilderMethods::BuildUnitAABBoxesList(
     AABBoxType * const unitAABBoxList,
     const UnitList & unitList,
     const TriangleList & triangles,
-    const VertexList & vertices)
+    const VertexList & vertices,
+    const float padding)
 {
+    const rwpmath::Vector3 pad(padding, padding, padding);
     const uint32_t numUnits(unitList.size());
     for (uint32_t unitIndex = 0; unitIndex < numUnits; ++unitIndex)
     {
@@ -654,8 +824,8 @@ ClusteredMeshBuilderMethods::BuildUnitAABBoxesList(
             max = rwpmath::Max(max, v3);
         }
 
-        AABBoxType::Vector3Type aabboxMin(min);
-        AABBoxType::Vector3Type aabboxMax(max);
+        AABBoxType::Vector3Type aabboxMin(min - pad);
+        AABBoxType::Vector3Type aabboxMax(max + pad);
         unitAABBoxList[unitIndex] = AABBoxType(aabboxMin, aabboxMax);
     }
 }
@@ -700,6 +870,72 @@ ClusteredMeshBuilderMethods::InitializeUnitClustersUsingKDTree(
 
 
 
+/**
+\brief Reorders the units of a cluster for locality, and numbers the cluster vertices to match.
+
+The units of each KDTree leaf must stay contiguous, in the same order of leaves, so the units are reordered
+within each leaf, along a Morton curve through their centroids quantized over the bounds of the cluster. The
+vertices are then numbered in the order they are first used by the units, so that the units of a leaf use a
+small range of the cluster vertices.
+
+This must follow AdjustKDTreeNodeEntriesForCluster, since the leaf entries are found from the first unit of
+each leaf, and the leaf offsets do not change when the units of a leaf are reordered.
+
+\param unitCluster the unit cluster.
+\param leafMap maps the ID of the first unit of each leaf to the leaf node.
+\param triangles collection of triangles.
+\param unitList collection of units.
+\param vertices collection of vertices.
+*/
+void
+ClusteredMeshBuilderMethods::OrderUnitsInCluster(
+    UnitCluster & unitCluster,
+    const LeafMap & leafMap,
+    const TriangleList & triangles,
+    const UnitList & unitList,
+    const VertexList & vertices)
+{
+    // Find the bounds of the cluster vertices
+    float minimum[3] = { rwpmath::MAX_FLOAT, rwpmath::MAX_FLOAT, rwpmath::MAX_FLOAT };
+    float maximum[3] = { -rwpmath::MAX_FLOAT, -rwpmath::MAX_FLOAT, -rwpmath::MAX_FLOAT };
+
+    for (uint32_t vertexSetIndex = 0; vertexSetIndex < unitCluster.numVertices; ++vertexSetIndex)
+    {
+        const VectorType &v = vertices[unitCluster.vertexIDs[vertexSetIndex]];
+        const float coordinates[3] = { v.GetX(), v.GetY(), v.GetZ() };
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            minimum[axis] = (coordinates[axis] < minimum[axis]) ? coordinates[axis] : minimum[axis];
+            maximum[axis] = (coordinates[axis] > maximum[axis]) ? coordinates[axis] : maximum[axis];
+        }
+    }
+
+    UnitMortonCompare compare(triangles, unitList, vertices, minimum, maximum);
+
+    // Sort the units of each leaf, which runs up to the next unit keying a leaf
+    uint32_t leafStart = 0;
+    while (leafStart < unitCluster.numUnits)
+    {
+        uint32_t leafEnd = leafStart + 1;
+        while (leafEnd < unitCluster.numUnits && leafMap.end() == leafMap.find(unitCluster.unitIDs[leafEnd]))
+        {
+            ++leafEnd;
+        }
+
+        eastl::sort<uint32_t*, UnitMortonCompare>(&unitCluster.unitIDs[leafStart],
+                                                  &unitCluster.unitIDs[leafStart] + (leafEnd - leafStart),
+                                                  compare);
+
+        leafStart = leafEnd;
+    }
+
+    UnitClusterBuilder::AssignVertexCodesInUnitOrder(unitCluster, triangles, unitList);
+}
+
+
+
+
 // Private Methods ------------------------------------------------------------------------------------
 
 
@@ -241,5 +241,37 @@ ClusteredMeshOfflineBuilder::BuildClusteredMesh()
 }
 
 
+/**
+\brief Updates a Clustered Mesh, returned by the last call to BuildClusteredMesh, after some of
+its triangles have been edited.
+
+The build parameters must have had incrementalUpdate_Enable set, with no merge planes, and without edge
+cosine correction, vertex smoothing or internal triangle removal. The edited triangles and vertices
+should be set again with SetTriangle and SetVertex before calling this method. The changed triangles
+must include every triangle using a moved vertex.
+
+\param clusteredMesh The mesh to update.
+\param changedTriangles Indices of the edited triangles.
+\param numChangedTriangles Number of edited triangles.
+
+\return true if the mesh has been updated. If false the mesh is unchanged, and should be rebuilt
+with BuildClusteredMesh.
+*/
+bool
+ClusteredMeshOfflineBuilder::UpdateClusteredMesh(
+    rw::collision::ClusteredMesh &clusteredMesh,
+    const uint32_t *changedTriangles,
+    uint32_t numChangedTriangles)
+{
+    EA_ASSERT_MSG(NULL != m_clusteredMeshBuilder, ("clusteredMeshBuilder should not be NULL"));
+
+    return m_clusteredMeshBuilder->UpdateClusteredMesh(
+        clusteredMesh,
+        m_buildParams,
+        changedTriangles,
+        numChangedTriangles);
+}
+
+
 } // namespace collision
 } // namespace rw
@@ -59,6 +59,10 @@ ClusteredMeshRuntimeBuilder::ClusteredMeshRuntimeBuilder(uint32_t           numP
     EA_ASSERT_MSG(m_buildParams.surfaceId_Default == 0u, ("SurfaceID Default is now always set to zero"));
     m_buildParams.surfaceId_Default = 0u;
 
+    // As the linear allocator cannot keep the adjacency data beyond the build
+    EA_ASSERT_MSG(m_buildParams.incrementalUpdate_Enable == false, ("Incremental update is only supported by the ClusteredMeshOfflineBuilder"));
+    m_buildParams.incrementalUpdate_Enable = false;
+
 
     // Mark the allocator heaps at start of day. We release them in Release(), to track memory usage
     m_allocator.Mark(EA::Allocator::MEM_PERM);
@@ -68,7 +72,7 @@ ClusteredMeshRuntimeBuilder::ClusteredMeshRuntimeBuilder(uint32_t           numP
     {
         // Allocate space for the plane normals
         m_mergePlaneNormals = reinterpret_cast<rwpmath::Vector3*>(m_allocator.Alloc(sizeof(rwpmath::Vector3) * m_mergePlaneCount, NULL, EA::Allocator::MEM_PERM, RW_MATH_VECTOR3_ALIGNMENT));
-        if (NULL == m_mergePlaneDistances)
+        if (NULL == m_mergePlaneNormals)
         {
             m_isValid = false;
             return;
@@ -77,7 +81,7 @@ ClusteredMeshRuntimeBuilder::ClusteredMeshRuntimeBuilder(uint32_t           numP
         // Allocate space for the plane distances
         m_mergePlaneDistances = reinterpret_cast<rwpmath::VecFloat*>(m_allocator.Alloc(sizeof(rwpmath::VecFloat) * m_mergePlaneCount, NULL, EA::Allocator::MEM_PERM, RW_MATH_VECTOR3_ALIGNMENT));
 
-        if (NULL == m_mergePlaneNormals)
+        if (NULL == m_mergePlaneDistances)
         {
             Release();
             m_isValid = false;
@@ -117,6 +121,53 @@ ClusteredMeshRuntimeBuilder::~ClusteredMeshRuntimeBuilder()
 }
 
 
+/**
+\brief Returns the size of the builder buffer needed to build a ClusteredMesh.
+
+The size covers the peak use of both heaps of the buffer over the whole build, including the merge planes
+and the ClusteredMeshBuilder. It is exact up to the construction of the units, and bounds the later stages,
+which depend on the KDTree and clusters built, by the worst case. See ClusteredMeshBuilder::GetMemoryRequirements
+for the bounds used.
+
+\note The buffer should be aligned to four bytes.
+
+\param numPrim Number of input triangles the builder expects.
+\param numVert Number of input vertices the builder expects.
+\param numMergePlanes Number of merge planes the builder expects.
+\param builderParams A collection of build parameters.
+\return The size in bytes of the builder buffer needed.
+*/
+uint32_t
+ClusteredMeshRuntimeBuilder::GetRequiredBufferSize(uint32_t           numPrim,
+                                                   uint32_t           numVert,
+                                                   uint32_t           numMergePlanes,
+                                                   const Parameters   &builderParams)
+{
+    // As the runtime builder never keeps the incremental update data
+    Parameters buildParams(builderParams);
+    buildParams.incrementalUpdate_Enable = false;
+
+    // The mark points of both heaps
+    uint32_t size = 2u * meshbuilder::detail::LinearAllocator::GetMarkSize();
+
+    // The merge planes, with the padding needed to align them
+    if (numMergePlanes > 0)
+    {
+        const uint32_t alignmentPadding = RW_MATH_VECTOR3_ALIGNMENT - 4u;
+        size += static_cast<uint32_t>(sizeof(rwpmath::Vector3) * numMergePlanes) + alignmentPadding;
+        size += static_cast<uint32_t>(sizeof(rwpmath::VecFloat) * numMergePlanes) + alignmentPadding;
+    }
+
+    // The ClusteredMeshBuilder, and the memory it uses from its construction
+    size += EA::Physics::SizeAlign<uint32_t>(static_cast<uint32_t>(sizeof(meshbuilder::detail::ClusteredMeshBuilder)), 4u);
+
+    MemoryReport requirements;
+    size += meshbuilder::detail::ClusteredMeshBuilder::GetMemoryRequirements(requirements, numPrim, numVert, buildParams);
+
+    return size;
+}
+
+
 /**
 \brief Sets the ith triangle with the given vertex indices, and group and surface IDs.
 
@@ -220,6 +271,13 @@ ClusteredMeshRuntimeBuilder::Release()
 {
     if (0 != m_clusteredMeshBuilder)
     {
+        MemoryReport report;
+        m_clusteredMeshBuilder->GetMemoryReport(report);
+        for (uint32_t stage = 0; stage < meshbuilder::detail::ClusteredMeshBuilder::BUILDSTAGE_COUNT; ++stage)
+        {
+            EAPHYSICS_MESSAGE("Peak allocated memory of build stage %d (both heaps, excluding builder setup): %d bytes", stage, report.stagePeaks[stage]);
+        }
+
         m_clusteredMeshBuilder->Release();
         m_allocator.Free(m_clusteredMeshBuilder);
         m_clusteredMeshBuilder = 0;
@@ -272,5 +330,39 @@ ClusteredMeshRuntimeBuilder::BuildClusteredMesh()
 }
 
 
+/**
+\brief Returns the peak use of the builder buffer during each stage of the last build.
+
+The peaks exclude the merge planes and the ClusteredMeshBuilder itself. This should be called before the
+builder is released.
+
+\param report Returned peak memory use of each stage.
+*/
+void
+ClusteredMeshRuntimeBuilder::GetMemoryReport(MemoryReport &report) const
+{
+    if (NULL != m_clusteredMeshBuilder)
+    {
+        m_clusteredMeshBuilder->GetMemoryReport(report);
+    }
+    else
+    {
+        report = MemoryReport();
+    }
+}
+
+
+/**
+\brief Returns the peak use of the builder buffer, over both heaps, since the builder was constructed.
+
+\return The peak memory use in bytes.
+*/
+uint32_t
+ClusteredMeshRuntimeBuilder::GetPeakMemoryUsed() const
+{
+    return m_allocator.GetPeakTotalMemoryUsed();
+}
+
+
 } // namespace collision
 } // namespace rw
@@ -0,0 +1,805 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+
+#include "rw/collision/clusteredmeshstreamingbuilder.h"
+
+#include "rw/collision/meshbuilder/detail/clusteredmeshbuilder.h"
+
+#include "rw/collision/clusteredmesh.h"
+
+#include "coreallocator/icoreallocator_interface.h"
+
+#include <EASTL/sort.h>
+
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\brief A boundary edge of a chunk, an edge of one of its triangles not shared by another of its triangles,
+with a copy of the triangle.
+*/
+struct ClusteredMeshStreamingBuilder::BoundaryEdge
+{
+    /// Positions of the triangle vertices.
+    float positions[3][3];
+    /// Indices of the triangle vertices, into the vertices of the chunk.
+    uint32_t vertexIndices[3];
+    /// Index of the triangle in the chunk.
+    uint32_t triangleIndex;
+    /// Group ID of the triangle.
+    uint32_t groupID;
+    /// Surface ID of the triangle.
+    uint32_t surfaceID;
+    /// Index of the edge, from vertex edge to vertex (edge + 1) % 3.
+    uint32_t edge;
+};
+
+
+/**
+\brief An edge keyed by the bit patterns of the positions of its vertices, in ascending order, so that the
+two triangles sharing an edge give the same key.
+*/
+struct ClusteredMeshStreamingBuilder::EdgeRef
+{
+    /// The bit patterns of the lesser then the greater vertex position.
+    uint32_t key[6];
+    /// Index of the triangle, or of the chunk, of the edge.
+    uint32_t index;
+    /// Index of the edge in the triangle, or of the boundary edge in the chunk.
+    uint32_t edge;
+};
+
+
+/**
+\brief A triangle of another chunk sharing a boundary edge of a chunk.
+*/
+struct ClusteredMeshStreamingBuilder::BorderTriangleRef
+{
+    /// Index of the chunk bordered by the triangle.
+    uint32_t chunkIndex;
+    /// Index of the chunk of the triangle.
+    uint32_t sourceChunk;
+    /// Index of the triangle in its chunk.
+    uint32_t sourceTriangle;
+    /// Index of the boundary edge, in the chunk of the triangle, shared with the bordered chunk.
+    uint32_t sourceEdge;
+    /// Index of the boundary edge, in the bordered chunk, shared with the triangle.
+    uint32_t targetEdge;
+};
+
+
+namespace
+{
+
+
+/**
+\brief Returns the bit pattern of a float, so that vertex positions are compared exactly.
+*/
+uint32_t
+GetFloatBits(const float value)
+{
+    union
+    {
+        float f;
+        uint32_t u;
+    } bits;
+
+    bits.f = value;
+    return bits.u;
+}
+
+
+/**
+\brief Sets the key of an edge from the positions of its two vertices.
+*/
+void
+SetEdgeKey(uint32_t key[6], const float *const position0, const float *const position1)
+{
+    uint32_t bits0[3] = { GetFloatBits(position0[0]), GetFloatBits(position0[1]), GetFloatBits(position0[2]) };
+    uint32_t bits1[3] = { GetFloatBits(position1[0]), GetFloatBits(position1[1]), GetFloatBits(position1[2]) };
+
+    // Order the vertices, so that both directions of the edge give the same key
+    bool swap = false;
+    for (uint32_t component = 0; component < 3; ++component)
+    {
+        if (bits0[component] != bits1[component])
+        {
+            swap = bits1[component] < bits0[component];
+            break;
+        }
+    }
+
+    for (uint32_t component = 0; component < 3; ++component)
+    {
+        key[component] = swap ? bits1[component] : bits0[component];
+        key[component + 3] = swap ? bits0[component] : bits1[component];
+    }
+}
+
+
+/**
+\brief Returns true if two positions are bit identical.
+*/
+bool
+IsSamePosition(const float *const position0, const float *const position1)
+{
+    return GetFloatBits(position0[0]) == GetFloatBits(position1[0]) &&
+           GetFloatBits(position0[1]) == GetFloatBits(position1[1]) &&
+           GetFloatBits(position0[2]) == GetFloatBits(position1[2]);
+}
+
+
+/**
+\brief Orders edge references by key, then by index.
+*/
+struct EdgeRefCompare
+{
+    template <typename EdgeRefType>
+    bool operator()(const EdgeRefType &left, const EdgeRefType &right) const
+    {
+        for (uint32_t word = 0; word < 6; ++word)
+        {
+            if (left.key[word] != right.key[word])
+            {
+                return left.key[word] < right.key[word];
+            }
+        }
+
+        return left.index < right.index;
+    }
+};
+
+
+/**
+\brief Returns true if two edge references have the same key.
+*/
+template <typename EdgeRefType>
+bool
+IsSameEdge(const EdgeRefType &left, const EdgeRefType &right)
+{
+    for (uint32_t word = 0; word < 6; ++word)
+    {
+        if (left.key[word] != right.key[word])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+\brief Orders border triangle references by bordered chunk, then by triangle.
+*/
+struct BorderTriangleRefCompare
+{
+    template <typename BorderTriangleRefType>
+    bool operator()(const BorderTriangleRefType &left, const BorderTriangleRefType &right) const
+    {
+        if (left.chunkIndex != right.chunkIndex)
+        {
+            return left.chunkIndex < right.chunkIndex;
+        }
+
+        if (left.sourceChunk != right.sourceChunk)
+        {
+            return left.sourceChunk < right.sourceChunk;
+        }
+
+        if (left.sourceTriangle != right.sourceTriangle)
+        {
+            return left.sourceTriangle < right.sourceTriangle;
+        }
+
+        return left.sourceEdge < right.sourceEdge;
+    }
+};
+
+
+} // namespace
+
+
+/**
+\brief Constructor
+
+\param builderParams A collection of build parameters, used to build each chunk. See
+ClusteredMeshBuilder::Parameters for more information.
+\param builderBuffer Buffer holding all build workspace.
+\param builderBufferSize Size of the buffer, the memory budget of the build.
+\param clusteredMeshAllocator Allocator used to allocate memory for the ClusteredMesh of each chunk.
+*/
+ClusteredMeshStreamingBuilder::ClusteredMeshStreamingBuilder(Parameters         &builderParams,
+                                                             uint8_t            *builderBuffer,
+                                                             uint32_t           builderBufferSize,
+                                                             EA::Allocator::ICoreAllocator *clusteredMeshAllocator)
+    : m_buildParams()
+    , m_allocator(builderBuffer, builderBufferSize)
+    , m_clusteredMeshAllocator(clusteredMeshAllocator)
+    , m_numChunks(0)
+    , m_chunkBoundaryEdges(NULL)
+    , m_chunkNumBoundaryEdges(NULL)
+    , m_borderTriangles(NULL)
+    , m_chunkFirstBorderTriangles(NULL)
+    , m_numBoundaryEdges(0)
+    , m_numBorderTriangles(0)
+{
+    EA_ASSERT_MSG( NULL != builderBuffer, ("builderBuffer should not be NULL"));
+    EA_ASSERT_MSG( NULL != clusteredMeshAllocator,("clusteredMeshAllocator should not be NULL"));
+
+    m_buildParams = builderParams;
+
+    // As old triangles are no longer supported
+    EA_ASSERT_MSG(m_buildParams.oldTriangles_Enable == false, ("Old triangle are no longer supported"));
+    m_buildParams.oldTriangles_Enable = false;
+
+    // As group and surface ID defaults have to be zero
+    EA_ASSERT_MSG(m_buildParams.groupId_Default == 0u, ("GroupID Default is now always set to zero"));
+    m_buildParams.groupId_Default = 0u;
+    EA_ASSERT_MSG(m_buildParams.surfaceId_Default == 0u, ("SurfaceID Default is now always set to zero"));
+    m_buildParams.surfaceId_Default = 0u;
+
+    // As the workspace of each chunk is released once the chunk has been built
+    EA_ASSERT_MSG(m_buildParams.incrementalUpdate_Enable == false, ("Incremental update is only supported by the ClusteredMeshOfflineBuilder"));
+    m_buildParams.incrementalUpdate_Enable = false;
+
+    m_chunk.numTriangles = 0;
+    m_chunk.numVertices = 0;
+    m_chunk.triangleVertexIndices = NULL;
+    m_chunk.triangleGroupIDs = NULL;
+    m_chunk.triangleSurfaceIDs = NULL;
+    m_chunk.vertices = NULL;
+}
+
+
+ClusteredMeshStreamingBuilder::~ClusteredMeshStreamingBuilder()
+{
+}
+
+
+/**
+\brief Builds the ClusteredMesh of each chunk of the input.
+
+Each chunk is read twice from the reader, and the ClusteredMesh of each chunk holding valid triangles is
+passed to the writer, in chunk order. Chunks with no triangles are skipped.
+
+\param reader Interface through which the input is read.
+\param writer Interface through which the ClusteredMesh of each chunk is written.
+\return true if every chunk has been built and written.
+*/
+bool
+ClusteredMeshStreamingBuilder::BuildClusteredMeshes(ChunkReader &reader, ChunkWriter &writer)
+{
+    // Mark the permanent heap, released once all chunks are built
+    m_allocator.Mark(EA::Allocator::MEM_PERM);
+
+    bool built = AllocateChunkBuffers(reader) &&
+                 CollectBoundaryEdges(reader) &&
+                 MatchBoundaryEdges();
+
+    for (uint32_t chunkIndex = 0; built && chunkIndex < m_numChunks; ++chunkIndex)
+    {
+        built = BuildChunk(reader, writer, chunkIndex);
+    }
+
+    m_allocator.Release(EA::Allocator::MEM_PERM);
+
+    m_chunk.triangleVertexIndices = NULL;
+    m_chunk.triangleGroupIDs = NULL;
+    m_chunk.triangleSurfaceIDs = NULL;
+    m_chunk.vertices = NULL;
+    m_chunkBoundaryEdges = NULL;
+    m_chunkNumBoundaryEdges = NULL;
+    m_borderTriangles = NULL;
+    m_chunkFirstBorderTriangles = NULL;
+
+    EAPHYSICS_MESSAGE("Boundary edges: %d, border triangles: %d", m_numBoundaryEdges, m_numBorderTriangles);
+    EAPHYSICS_MESSAGE("Peak total allocated memory (both heaps): %d bytes", m_allocator.GetPeakTotalMemoryUsed());
+
+    return built;
+}
+
+
+/**
+\brief Returns the peak memory used by the build workspace, which is never more than the budget.
+
+\return The peak number of bytes used of the builder buffer.
+*/
+uint32_t
+ClusteredMeshStreamingBuilder::GetPeakMemoryUsed() const
+{
+    return m_allocator.GetPeakTotalMemoryUsed();
+}
+
+
+/**
+\brief Returns the number of boundary edges found by the last build, over all chunks.
+
+\return The number of boundary edges.
+*/
+uint32_t
+ClusteredMeshStreamingBuilder::GetNumBoundaryEdges() const
+{
+    return m_numBoundaryEdges;
+}
+
+
+/**
+\brief Returns the number of border triangles added by the last build, over all chunks.
+
+\return The number of border triangles.
+*/
+uint32_t
+ClusteredMeshStreamingBuilder::GetNumBorderTriangles() const
+{
+    return m_numBorderTriangles;
+}
+
+
+/**
+\brief Allocates the chunk input buffers, sized for the largest chunk, and the per chunk boundary data.
+
+\param reader Interface through which the input is read.
+\return false if the buffers do not fit in the memory budget.
+*/
+bool
+ClusteredMeshStreamingBuilder::AllocateChunkBuffers(ChunkReader &reader)
+{
+    m_numChunks = reader.GetNumChunks();
+    m_numBoundaryEdges = 0;
+    m_numBorderTriangles = 0;
+
+    uint32_t maxTriangles = 0;
+    uint32_t maxVertices = 0;
+    for (uint32_t chunkIndex = 0; chunkIndex < m_numChunks; ++chunkIndex)
+    {
+        uint32_t numTriangles = 0;
+        uint32_t numVertices = 0;
+        reader.GetChunkSize(chunkIndex, numTriangles, numVertices);
+
+        maxTriangles = (numTriangles > maxTriangles) ? numTriangles : maxTriangles;
+        maxVertices = (numVertices > maxVertices) ? numVertices : maxVertices;
+    }
+
+    m_chunk.triangleVertexIndices = static_cast<uint32_t *>(
+        m_allocator.Alloc(3u * maxTriangles * sizeof(uint32_t), "ChunkTriangles", EA::Allocator::MEM_PERM, 4));
+    m_chunk.triangleGroupIDs = static_cast<uint32_t *>(
+        m_allocator.Alloc(maxTriangles * sizeof(uint32_t), "ChunkGroupIDs", EA::Allocator::MEM_PERM, 4));
+    m_chunk.triangleSurfaceIDs = static_cast<uint32_t *>(
+        m_allocator.Alloc(maxTriangles * sizeof(uint32_t), "ChunkSurfaceIDs", EA::Allocator::MEM_PERM, 4));
+    m_chunk.vertices = static_cast<rw::math::fpu::Vector3U_32 *>(
+        m_allocator.Alloc(maxVertices * sizeof(rw::math::fpu::Vector3U_32), "ChunkVertices", EA::Allocator::MEM_PERM, 4));
+
+    m_chunkBoundaryEdges = static_cast<BoundaryEdge **>(
+        m_allocator.Alloc(m_numChunks * sizeof(BoundaryEdge *), "ChunkBoundaryEdges", EA::Allocator::MEM_PERM, 4));
+    m_chunkNumBoundaryEdges = static_cast<uint32_t *>(
+        m_allocator.Alloc(m_numChunks * sizeof(uint32_t), "ChunkNumBoundaryEdges", EA::Allocator::MEM_PERM, 4));
+    m_chunkFirstBorderTriangles = static_cast<uint32_t *>(
+        m_allocator.Alloc((m_numChunks + 1u) * sizeof(uint32_t), "ChunkFirstBorderTriangles", EA::Allocator::MEM_PERM, 4));
+
+    if (!m_chunk.triangleVertexIndices || !m_chunk.triangleGroupIDs || !m_chunk.triangleSurfaceIDs ||
+        !m_chunk.vertices || !m_chunkBoundaryEdges || !m_chunkNumBoundaryEdges || !m_chunkFirstBorderTriangles)
+    {
+        EAPHYSICS_MESSAGE("The memory budget is too small for the chunk input buffers.");
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+\brief Reads each chunk, keeping a copy of the triangle of each of its boundary edges.
+
+\param reader Interface through which the input is read.
+\return false if a chunk cannot be read, or the boundary edges do not fit in the memory budget.
+*/
+bool
+ClusteredMeshStreamingBuilder::CollectBoundaryEdges(ChunkReader &reader)
+{
+    for (uint32_t chunkIndex = 0; chunkIndex < m_numChunks; ++chunkIndex)
+    {
+        reader.GetChunkSize(chunkIndex, m_chunk.numTriangles, m_chunk.numVertices);
+        m_chunkBoundaryEdges[chunkIndex] = NULL;
+        m_chunkNumBoundaryEdges[chunkIndex] = 0;
+
+        if (!reader.ReadChunk(chunkIndex, m_chunk))
+        {
+            EAPHYSICS_MESSAGE("Chunk %d could not be read.", chunkIndex);
+            return false;
+        }
+
+        const uint32_t numEdges = 3u * m_chunk.numTriangles;
+
+        // Mark temporary heap before allocation of the chunk edges
+        m_allocator.Mark(EA::Allocator::MEM_TEMP);
+
+        EdgeRef *const edges = static_cast<EdgeRef *>(
+            m_allocator.Alloc(numEdges * sizeof(EdgeRef), "ChunkEdges", EA::Allocator::MEM_TEMP, 4));
+        if (NULL == edges)
+        {
+            EAPHYSICS_MESSAGE("The memory budget is too small for the edges of chunk %d.", chunkIndex);
+            m_allocator.Release(EA::Allocator::MEM_TEMP);
+            return false;
+        }
+
+        for (uint32_t triangleIndex = 0; triangleIndex < m_chunk.numTriangles; ++triangleIndex)
+        {
+            const uint32_t *const vertexIndices = &m_chunk.triangleVertexIndices[3u * triangleIndex];
+            for (uint32_t edge = 0; edge < 3; ++edge)
+            {
+                EA_ASSERT(vertexIndices[edge] < m_chunk.numVertices);
+
+                EdgeRef &edgeRef = edges[3u * triangleIndex + edge];
+                SetEdgeKey(edgeRef.key,
+                           reinterpret_cast<const float *>(&m_chunk.vertices[vertexIndices[edge]]),
+                           reinterpret_cast<const float *>(&m_chunk.vertices[vertexIndices[(edge + 1u) % 3u]]));
+                edgeRef.index = triangleIndex;
+                edgeRef.edge = edge;
+            }
+        }
+
+        eastl::sort(edges, edges + numEdges, EdgeRefCompare());
+
+        // The edges with keys found only once are not shared by two triangles of the chunk
+        uint32_t numBoundaryEdges = 0;
+        for (uint32_t edgeIndex = 0; edgeIndex < numEdges; ++edgeIndex)
+        {
+            const bool sharedWithPrevious = (edgeIndex > 0) && IsSameEdge(edges[edgeIndex], edges[edgeIndex - 1u]);
+            const bool sharedWithNext = (edgeIndex + 1u < numEdges) && IsSameEdge(edges[edgeIndex], edges[edgeIndex + 1u]);
+            numBoundaryEdges += (sharedWithPrevious || sharedWithNext) ? 0u : 1u;
+        }
+
+        BoundaryEdge *const boundaryEdges = static_cast<BoundaryEdge *>(
+            m_allocator.Alloc(numBoundaryEdges * sizeof(BoundaryEdge), "BoundaryEdges", EA::Allocator::MEM_PERM, 4));
+        if (NULL == boundaryEdges && numBoundaryEdges > 0u)
+        {
+            EAPHYSICS_MESSAGE("The memory budget is too small for the boundary edges of chunk %d.", chunkIndex);
+            m_allocator.Release(EA::Allocator::MEM_TEMP);
+            return false;
+        }
+
+        uint32_t boundaryEdgeIndex = 0;
+        for (uint32_t edgeIndex = 0; edgeIndex < numEdges; ++edgeIndex)
+        {
+            const bool sharedWithPrevious = (edgeIndex > 0) && IsSameEdge(edges[edgeIndex], edges[edgeIndex - 1u]);
+            const bool sharedWithNext = (edgeIndex + 1u < numEdges) && IsSameEdge(edges[edgeIndex], edges[edgeIndex + 1u]);
+            if (sharedWithPrevious || sharedWithNext)
+            {
+                continue;
+            }
+
+            const uint32_t triangleIndex = edges[edgeIndex].index;
+            BoundaryEdge &boundaryEdge = boundaryEdges[boundaryEdgeIndex++];
+
+            for (uint32_t vertex = 0; vertex < 3; ++vertex)
+            {
+                const uint32_t vertexIndex = m_chunk.triangleVertexIndices[3u * triangleIndex + vertex];
+                const rw::math::fpu::Vector3U_32 &position = m_chunk.vertices[vertexIndex];
+
+                boundaryEdge.positions[vertex][0] = position.GetX();
+                boundaryEdge.positions[vertex][1] = position.GetY();
+                boundaryEdge.positions[vertex][2] = position.GetZ();
+                boundaryEdge.vertexIndices[vertex] = vertexIndex;
+            }
+
+            boundaryEdge.triangleIndex = triangleIndex;
+            boundaryEdge.groupID = m_chunk.triangleGroupIDs[triangleIndex];
+            boundaryEdge.surfaceID = m_chunk.triangleSurfaceIDs[triangleIndex];
+            boundaryEdge.edge = edges[edgeIndex].edge;
+        }
+
+        m_chunkBoundaryEdges[chunkIndex] = boundaryEdges;
+        m_chunkNumBoundaryEdges[chunkIndex] = numBoundaryEdges;
+        m_numBoundaryEdges += numBoundaryEdges;
+
+        // Release temporary heap after use of the chunk edges
+        m_allocator.Release(EA::Allocator::MEM_TEMP);
+    }
+
+    return true;
+}
+
+
+/**
+\brief Matches the boundary edges of all chunks, finding the border triangles of each chunk.
+
+\return false if the border triangle references do not fit in the memory budget.
+*/
+bool
+ClusteredMeshStreamingBuilder::MatchBoundaryEdges()
+{
+    // Mark temporary heap before allocation of the boundary edge references
+    m_allocator.Mark(EA::Allocator::MEM_TEMP);
+
+    EdgeRef *const edges = static_cast<EdgeRef *>(
+        m_allocator.Alloc(m_numBoundaryEdges * sizeof(EdgeRef), "BoundaryEdgeRefs", EA::Allocator::MEM_TEMP, 4));
+    if (NULL == edges && m_numBoundaryEdges > 0u)
+    {
+        EAPHYSICS_MESSAGE("The memory budget is too small to match the boundary edges.");
+        m_allocator.Release(EA::Allocator::MEM_TEMP);
+        return false;
+    }
+
+    uint32_t edgeIndex = 0;
+    for (uint32_t chunkIndex = 0; chunkIndex < m_numChunks; ++chunkIndex)
+    {
+        for (uint32_t boundaryEdgeIndex = 0; boundaryEdgeIndex < m_chunkNumBoundaryEdges[chunkIndex]; ++boundaryEdgeIndex)
+        {
+            const BoundaryEdge &boundaryEdge = m_chunkBoundaryEdges[chunkIndex][boundaryEdgeIndex];
+
+            EdgeRef &edgeRef = edges[edgeIndex++];
+            SetEdgeKey(edgeRef.key,
+                       boundaryEdge.positions[boundaryEdge.edge],
+                       boundaryEdge.positions[(boundaryEdge.edge + 1u) % 3u]);
+            edgeRef.index = chunkIndex;
+            edgeRef.edge = boundaryEdgeIndex;
+        }
+    }
+
+    eastl::sort(edges, edges + m_numBoundaryEdges, EdgeRefCompare());
+
+    // Count the pairs of matching boundary edges of different chunks
+    uint32_t numBorderTriangleRefs = 0;
+    for (uint32_t groupStart = 0; groupStart < m_numBoundaryEdges; )
+    {
+        uint32_t groupEnd = groupStart + 1u;
+        while (groupEnd < m_numBoundaryEdges && IsSameEdge(edges[groupStart], edges[groupEnd]))
+        {
+            ++groupEnd;
+        }
+
+        for (uint32_t target = groupStart; target < groupEnd; ++target)
+        {
+            for (uint32_t source = groupStart; source < groupEnd; ++source)
+            {
+                numBorderTriangleRefs += (edges[target].index != edges[source].index) ? 1u : 0u;
+            }
+        }
+
+        groupStart = groupEnd;
+    }
+
+    m_borderTriangles = static_cast<BorderTriangleRef *>(
+        m_allocator.Alloc(numBorderTriangleRefs * sizeof(BorderTriangleRef), "BorderTriangles", EA::Allocator::MEM_PERM, 4));
+    if (NULL == m_borderTriangles && numBorderTriangleRefs > 0u)
+    {
+        EAPHYSICS_MESSAGE("The memory budget is too small for the border triangles.");
+        m_allocator.Release(EA::Allocator::MEM_TEMP);
+        return false;
+    }
+
+    uint32_t borderTriangleIndex = 0;
+    for (uint32_t groupStart = 0; groupStart < m_numBoundaryEdges; )
+    {
+        uint32_t groupEnd = groupStart + 1u;
+        while (groupEnd < m_numBoundaryEdges && IsSameEdge(edges[groupStart], edges[groupEnd]))
+        {
+            ++groupEnd;
+        }
+
+        for (uint32_t target = groupStart; target < groupEnd; ++target)
+        {
+            for (uint32_t source = groupStart; source < groupEnd; ++source)
+            {
+                if (edges[target].index != edges[source].index)
+                {
+                    BorderTriangleRef &borderTriangle = m_borderTriangles[borderTriangleIndex++];
+                    borderTriangle.chunkIndex = edges[target].index;
+                    borderTriangle.sourceChunk = edges[source].index;
+                    borderTriangle.sourceTriangle = m_chunkBoundaryEdges[edges[source].index][edges[source].edge].triangleIndex;
+                    borderTriangle.sourceEdge = edges[source].edge;
+                    borderTriangle.targetEdge = edges[target].edge;
+                }
+            }
+        }
+
+        groupStart = groupEnd;
+    }
+
+    // Release temporary heap after use of the boundary edge references
+    m_allocator.Release(EA::Allocator::MEM_TEMP);
+
+    // Group the border triangle references by the chunk they border, then by triangle
+    eastl::sort(m_borderTriangles, m_borderTriangles + numBorderTriangleRefs, BorderTriangleRefCompare());
+
+    borderTriangleIndex = 0;
+    for (uint32_t chunkIndex = 0; chunkIndex < m_numChunks; ++chunkIndex)
+    {
+        m_chunkFirstBorderTriangles[chunkIndex] = borderTriangleIndex;
+        while (borderTriangleIndex < numBorderTriangleRefs && m_borderTriangles[borderTriangleIndex].chunkIndex == chunkIndex)
+        {
+            const bool newTriangle = (borderTriangleIndex == m_chunkFirstBorderTriangles[chunkIndex]) ||
+                m_borderTriangles[borderTriangleIndex].sourceChunk != m_borderTriangles[borderTriangleIndex - 1u].sourceChunk ||
+                m_borderTriangles[borderTriangleIndex].sourceTriangle != m_borderTriangles[borderTriangleIndex - 1u].sourceTriangle;
+            m_numBorderTriangles += newTriangle ? 1u : 0u;
+            ++borderTriangleIndex;
+        }
+    }
+    m_chunkFirstBorderTriangles[m_numChunks] = borderTriangleIndex;
+
+    return true;
+}
+
+
+/**
+\brief Builds the ClusteredMesh of a chunk, with its border triangles, and writes it.
+
+\param reader Interface through which the input is read.
+\param writer Interface through which the ClusteredMesh of the chunk is written.
+\param chunkIndex Index of the chunk.
+\return false if the chunk cannot be read, built or written.
+*/
+bool
+ClusteredMeshStreamingBuilder::BuildChunk(ChunkReader &reader, ChunkWriter &writer, const uint32_t chunkIndex)
+{
+    reader.GetChunkSize(chunkIndex, m_chunk.numTriangles, m_chunk.numVertices);
+    if (0u == m_chunk.numTriangles)
+    {
+        return true;
+    }
+
+    if (!reader.ReadChunk(chunkIndex, m_chunk))
+    {
+        EAPHYSICS_MESSAGE("Chunk %d could not be read.", chunkIndex);
+        return false;
+    }
+
+    const uint32_t firstBorderTriangleRef = m_chunkFirstBorderTriangles[chunkIndex];
+    const uint32_t endBorderTriangleRef = m_chunkFirstBorderTriangles[chunkIndex + 1u];
+    const BoundaryEdge *const chunkBoundaryEdges = m_chunkBoundaryEdges[chunkIndex];
+
+    // Each border triangle has the chunk vertices of the boundary edges it shares, and new vertices otherwise.
+    // The references are walked twice, counting the border triangles and vertices then setting them.
+    uint32_t numBorderTriangles = 0;
+    uint32_t numBorderVertices = 0;
+    meshbuilder::detail::ClusteredMeshBuilder *clusteredMeshBuilder = NULL;
+
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        uint32_t refIndex = firstBorderTriangleRef;
+        uint32_t borderVertexIndex = m_chunk.numVertices;
+        uint32_t borderTriangleIndex = m_chunk.numTriangles;
+
+        while (refIndex < endBorderTriangleRef)
+        {
+            const BorderTriangleRef &firstRef = m_borderTriangles[refIndex];
+            const BoundaryEdge &source = m_chunkBoundaryEdges[firstRef.sourceChunk][firstRef.sourceEdge];
+
+            uint32_t vertexIndices[3] = { 0xffffffff, 0xffffffff, 0xffffffff };
+
+            // Map the vertices of each boundary edge shared with the chunk to the chunk vertices
+            while (refIndex < endBorderTriangleRef &&
+                   m_borderTriangles[refIndex].sourceChunk == firstRef.sourceChunk &&
+                   m_borderTriangles[refIndex].sourceTriangle == firstRef.sourceTriangle)
+            {
+                const BorderTriangleRef &ref = m_borderTriangles[refIndex++];
+                const BoundaryEdge &sourceEdge = m_chunkBoundaryEdges[ref.sourceChunk][ref.sourceEdge];
+                const BoundaryEdge &targetEdge = chunkBoundaryEdges[ref.targetEdge];
+
+                for (uint32_t end = 0; end < 2; ++end)
+                {
+                    const uint32_t vertex = (sourceEdge.edge + end) % 3u;
+                    const bool atEdgeStart = IsSamePosition(sourceEdge.positions[vertex], targetEdge.positions[targetEdge.edge]);
+                    vertexIndices[vertex] = atEdgeStart ?
+                        targetEdge.vertexIndices[targetEdge.edge] :
+                        targetEdge.vertexIndices[(targetEdge.edge + 1u) % 3u];
+                }
+            }
+
+            for (uint32_t vertex = 0; vertex < 3; ++vertex)
+            {
+                if (0xffffffff == vertexIndices[vertex])
+                {
+                    vertexIndices[vertex] = borderVertexIndex++;
+                    if (clusteredMeshBuilder)
+                    {
+                        clusteredMeshBuilder->SetVertex(vertexIndices[vertex], rw::math::fpu::Vector3U_32(
+                            source.positions[vertex][0], source.positions[vertex][1], source.positions[vertex][2]));
+                    }
+                }
+            }
+
+            if (clusteredMeshBuilder)
+            {
+                clusteredMeshBuilder->SetTriangle(borderTriangleIndex,
+                                                  vertexIndices[0],
+                                                  vertexIndices[1],
+                                                  vertexIndices[2],
+                                                  source.groupID,
+                                                  source.surfaceID);
+            }
+            ++borderTriangleIndex;
+        }
+
+        if (0 == pass)
+        {
+            numBorderTriangles = borderTriangleIndex - m_chunk.numTriangles;
+            numBorderVertices = borderVertexIndex - m_chunk.numVertices;
+
+            // Mark the permanent heap and create the ClusteredMeshBuilder of the chunk
+            m_allocator.Mark(EA::Allocator::MEM_PERM);
+
+            clusteredMeshBuilder = reinterpret_cast<meshbuilder::detail::ClusteredMeshBuilder*>(
+                m_allocator.Alloc(sizeof(meshbuilder::detail::ClusteredMeshBuilder), NULL, EA::Allocator::MEM_PERM, 4));
+
+            if (NULL == clusteredMeshBuilder)
+            {
+                EAPHYSICS_MESSAGE("The memory budget is too small for the builder of chunk %d.", chunkIndex);
+                m_allocator.Release(EA::Allocator::MEM_PERM);
+                return false;
+            }
+
+            clusteredMeshBuilder = new (clusteredMeshBuilder) meshbuilder::detail::ClusteredMeshBuilder(
+                m_chunk.numTriangles + numBorderTriangles,
+                m_chunk.numVertices + numBorderVertices,
+                m_buildParams.vertexMerge_DistanceTolerance,
+                0.0f,
+                &m_allocator);
+
+            if (!clusteredMeshBuilder->IsBuilderValid())
+            {
+                EAPHYSICS_MESSAGE("The memory budget is too small for the input of chunk %d.", chunkIndex);
+                clusteredMeshBuilder->Release();
+                m_allocator.Release(EA::Allocator::MEM_PERM);
+                return false;
+            }
+
+            // Set the chunk input, then the border triangles on the second pass
+            for (uint32_t vertexIndex = 0; vertexIndex < m_chunk.numVertices; ++vertexIndex)
+            {
+                clusteredMeshBuilder->SetVertex(vertexIndex, m_chunk.vertices[vertexIndex]);
+            }
+
+            for (uint32_t triangleIndex = 0; triangleIndex < m_chunk.numTriangles; ++triangleIndex)
+            {
+                clusteredMeshBuilder->SetTriangle(triangleIndex,
+                                                  m_chunk.triangleVertexIndices[3u * triangleIndex],
+                                                  m_chunk.triangleVertexIndices[3u * triangleIndex + 1u],
+                                                  m_chunk.triangleVertexIndices[3u * triangleIndex + 2u],
+                                                  m_chunk.triangleGroupIDs[triangleIndex],
+                                                  m_chunk.triangleSurfaceIDs[triangleIndex]);
+            }
+        }
+    }
+
+    clusteredMeshBuilder->SetFirstBorderTriangle(m_chunk.numTriangles);
+
+    rw::collision::ClusteredMesh *clusteredMesh = clusteredMeshBuilder->BuildClusteredMesh(
+        m_buildParams,
+        0u,
+        NULL,
+        NULL,
+        &m_clusteredMeshAllocator);
+
+    bool written = false;
+    if (NULL != clusteredMesh)
+    {
+        written = writer.WriteChunkMesh(chunkIndex, *clusteredMesh);
+        m_clusteredMeshAllocator.Free(clusteredMesh);
+
+        if (!written)
+        {
+            EAPHYSICS_MESSAGE("The ClusteredMesh of chunk %d could not be written.", chunkIndex);
+        }
+    }
+    else
+    {
+        EAPHYSICS_MESSAGE("The ClusteredMesh of chunk %d could not be built.", chunkIndex);
+    }
+
+    // Release the builder and its workspace
+    clusteredMeshBuilder->Release();
+    m_allocator.Free(clusteredMeshBuilder);
+    m_allocator.Release(EA::Allocator::MEM_PERM);
+
+    return written;
+}
+
+
+} // namespace collision
+} // namespace rw
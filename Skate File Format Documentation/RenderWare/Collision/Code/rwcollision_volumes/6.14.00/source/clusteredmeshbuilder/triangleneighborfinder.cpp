@@ -7,6 +7,7 @@
 #if !defined EA_PLATFORM_PS3_SPU
 
 #include <rw/collision/meshbuilder/detail/triangleneighborfinder.h>
+#include <rw/collision/meshbuilder/detail/radixsort.h>
 
 
 namespace rw
@@ -19,6 +20,472 @@ namespace detail
 {
 
 
+namespace
+{
+
+/// Number of triangles in each range of the parallel edge search.
+const uint32_t FINDNEIGHBORS_GRAINSIZE = 1024u;
+
+/// Number of edge matches held by each block of a range match list.
+const uint32_t EDGEMATEBLOCK_SIZE = 256u;
+
+/**
+A block of the list of edge matches found by one range of the parallel edge search.
+*/
+struct EdgeMateBlock
+{
+    EdgeMateBlock *next;
+    uint32_t count;
+    TriangleNeighborFinder::EdgeMate mates[EDGEMATEBLOCK_SIZE];
+};
+
+/**
+The edge matches found by one range of the parallel edge search.
+*/
+struct EdgeMateRange
+{
+    EdgeMateBlock *first;
+    bool outOfMemory;
+};
+
+struct FindEdgeMatesContext
+{
+    const TriangleList *triangles;
+    const TriangleFlagsList *triangleFlags;
+    const VertexList *vertices;
+    const VertexTriangleMap *vertexTriangleMap;
+    WorkerAllocators *workerAllocators;
+    EdgeMateRange *ranges;
+};
+
+
+/**
+Range function of the parallel edge search. Visits the triangle pairs in the same order as
+TriangleNeighborFinder::FindTriangleNeighbors, recording each match in a list held in the arena of the worker.
+*/
+void FindEdgeMatesInRange(void *contextPtr, uint32_t workerIndex, uint32_t begin, uint32_t end)
+{
+    const FindEdgeMatesContext &context = *static_cast<const FindEdgeMatesContext *>(contextPtr);
+    const TriangleList &triangles = *context.triangles;
+    const TriangleFlagsList &triangleFlags = *context.triangleFlags;
+    const VertexTriangleMap &vertexTriangleMap = *context.vertexTriangleMap;
+    LinearAllocator &workerAllocator = context.workerAllocators->GetAllocator(workerIndex);
+
+    EdgeMateRange &range = context.ranges[begin / FINDNEIGHBORS_GRAINSIZE];
+    range.first = NULL;
+    range.outOfMemory = false;
+
+    EdgeMateBlock *last = NULL;
+
+    for (uint32_t triangle1Index = begin; triangle1Index < end; ++triangle1Index)
+    {
+        // Ignore disabled triangles
+        if (triangleFlags[triangle1Index].enabled == false)
+        {
+            continue;
+        }
+
+        const uint32_t * const vertexIndices = triangles[triangle1Index].vertices;
+
+        for (uint32_t edgeIndex = 0; edgeIndex < 3; ++edgeIndex)
+        {
+            const uint32_t vertexIndex = vertexIndices[edgeIndex];
+            VertexTriangleMap::AdjoiningTriangleIterator atIt = vertexTriangleMap.AdjoiningTriangleBegin( vertexIndex );
+            VertexTriangleMap::AdjoiningTriangleIterator atItEnd = vertexTriangleMap.AdjoiningTriangleEnd( vertexIndex );
+
+            while (atIt != atItEnd)
+            {
+                const uint32_t triangle2Index = *atIt;
+                if (triangleFlags[triangle2Index].enabled && triangle1Index > triangle2Index)
+                {
+                    TriangleNeighborFinder::EdgeMate mate;
+                    if (TriangleNeighborFinder::FindEdgeMate(triangles, *context.vertices, edgeIndex, triangle1Index, triangle2Index, mate))
+                    {
+                        // Start a new block when the current one is full
+                        if (last == NULL || last->count == EDGEMATEBLOCK_SIZE)
+                        {
+                            EdgeMateBlock *const block = static_cast<EdgeMateBlock *>(
+                                workerAllocator.Alloc(sizeof(EdgeMateBlock), "EdgeMateBlock", EA::Allocator::MEM_TEMP, 4));
+                            if (!block)
+                            {
+                                range.outOfMemory = true;
+                                return;
+                            }
+
+                            block->next = NULL;
+                            block->count = 0;
+
+                            if (last)
+                            {
+                                last->next = block;
+                            }
+                            else
+                            {
+                                range.first = block;
+                            }
+                            last = block;
+                        }
+
+                        last->mates[last->count++] = mate;
+                    }
+                }
+
+                ++atIt;
+            }
+        }
+    }
+}
+
+
+/// Number of triangles in each range of the parallel edge recording.
+const uint32_t RECORDEDGES_GRAINSIZE = 4096u;
+
+/// Vertex index of the edge records of disabled triangles, which sort after all others.
+const uint32_t EDGERECORD_DISABLED = 0xffffffffu;
+
+/**
+An edge of a triangle, keyed on its pair of vertex indices irrespective of direction.
+*/
+struct EdgeRecord
+{
+    uint32_t minVertexIndex;
+    uint32_t maxVertexIndex;
+    /// Triangle index shifted left by two, combined with the edge index.
+    uint32_t triangleEdge;
+};
+
+struct EdgeRecordMinVertexKey
+{
+    uint32_t operator()(const EdgeRecord &record) const
+    {
+        return record.minVertexIndex;
+    }
+};
+
+struct EdgeRecordMaxVertexKey
+{
+    uint32_t operator()(const EdgeRecord &record) const
+    {
+        return record.maxVertexIndex;
+    }
+};
+
+struct RecordEdgesContext
+{
+    const TriangleList *triangles;
+    const TriangleFlagsList *triangleFlags;
+    const VertexList *vertices;
+    EdgeRecord *records;
+    rwpmath::Vector3 *normals;
+};
+
+
+/**
+Range function recording the three edges and the normal of each triangle. The edges of triangle t are
+recorded at 3t to 3t+2, so the records are in triangle order before sorting.
+*/
+void RecordEdgesInRange(void *contextPtr, uint32_t /*workerIndex*/, uint32_t begin, uint32_t end)
+{
+    const RecordEdgesContext &context = *static_cast<const RecordEdgesContext *>(contextPtr);
+    const TriangleList &triangles = *context.triangles;
+    const VertexList &vertices = *context.vertices;
+
+    for (uint32_t triangleIndex = begin; triangleIndex < end; ++triangleIndex)
+    {
+        EdgeRecord *const records = context.records + triangleIndex * 3;
+        const uint32_t *const vertexIndices = triangles[triangleIndex].vertices;
+
+        if ((*context.triangleFlags)[triangleIndex].enabled == false)
+        {
+            for (uint32_t edgeIndex = 0; edgeIndex < 3; ++edgeIndex)
+            {
+                records[edgeIndex].minVertexIndex = EDGERECORD_DISABLED;
+                records[edgeIndex].maxVertexIndex = EDGERECORD_DISABLED;
+                records[edgeIndex].triangleEdge = (triangleIndex << 2) | edgeIndex;
+            }
+            continue;
+        }
+
+        context.normals[triangleIndex] = TriangleNormal::ComputeTriangleNormalFast(
+            rwpmath::Vector3(vertices[vertexIndices[0]]),
+            rwpmath::Vector3(vertices[vertexIndices[1]]),
+            rwpmath::Vector3(vertices[vertexIndices[2]]));
+
+        for (uint32_t edgeIndex = 0; edgeIndex < 3; ++edgeIndex)
+        {
+            const uint32_t edgeNextIndex = (edgeIndex < 2) ? (edgeIndex + 1) : 0;
+            const uint32_t vertexA = vertexIndices[edgeIndex];
+            const uint32_t vertexB = vertexIndices[edgeNextIndex];
+
+            records[edgeIndex].minVertexIndex = (vertexA < vertexB) ? vertexA : vertexB;
+            records[edgeIndex].maxVertexIndex = (vertexA < vertexB) ? vertexB : vertexA;
+            records[edgeIndex].triangleEdge = (triangleIndex << 2) | edgeIndex;
+        }
+    }
+}
+
+/// Number of sorted edge records in each range of the parallel edge mating.
+const uint32_t MATEEDGES_GRAINSIZE = 4096u;
+
+/**
+Finds the edge of a triangle which has a given neighbor, as TriangleNeighborFinder::ApplyEdgeMate does.
+*/
+struct NeighborEdgeFinder
+{
+    const TriangleNeighborsList *triangleNeighbors;
+
+    uint32_t operator()(const uint32_t triangleIndex, const uint32_t neighborIndex) const
+    {
+        return TriangleNeighborFinder::FindEdgeByNeighbor((*triangleNeighbors)[triangleIndex].neighbor, neighborIndex);
+    }
+};
+
+/**
+Finds the edge of a triangle which has a given neighbor among the edges of one run of sorted edge records. Every
+edge a match in the run replaces is in the same run, so the runs can be mated concurrently.
+*/
+struct RunEdgeFinder
+{
+    const TriangleNeighborsList *triangleNeighbors;
+    const EdgeRecord *records;
+    uint32_t runStart;
+    uint32_t runEnd;
+
+    uint32_t operator()(const uint32_t triangleIndex, const uint32_t neighborIndex) const
+    {
+        const uint32_t *const neighbors = (*triangleNeighbors)[triangleIndex].neighbor;
+        for (uint32_t recordIndex = runStart; recordIndex < runEnd; ++recordIndex)
+        {
+            const uint32_t triangleEdge = records[recordIndex].triangleEdge;
+            if ((triangleEdge >> 2) == triangleIndex && neighbors[triangleEdge & 3] == neighborIndex)
+            {
+                return triangleEdge & 3;
+            }
+        }
+
+        EA_FAIL_MSG(("Replaced match is not in the run of the edge"));
+        return TriangleNeighborFinder::FindEdgeByNeighbor(neighbors, neighborIndex);
+    }
+};
+
+/**
+Applies an edge match as TriangleNeighborFinder::ApplyEdgeMate does, finding the edge of each replaced match with
+the given edge finder.
+*/
+template <class EdgeFinder>
+void ApplyEdgeMateWith(
+    TriangleEdgeCosinesList & triangleEdgeCosines,
+    TriangleNeighborsList & triangleNeighbors,
+    const TriangleNeighborFinder::EdgeMate & mate,
+    const EdgeFinder & findEdge)
+{
+    const uint32_t triangle1Index = mate.triangle1Index;
+    const uint32_t triangle2Index = mate.triangle2Index;
+    const uint32_t edge1Index = mate.edge1Index;
+    const uint32_t edge2Index = mate.edge2Index;
+    const float edgeCosine = mate.edgeCosine;
+
+    float *const triangle1EdgeCosines = triangleEdgeCosines[triangle1Index].edgeCos;
+    float *const triangle2EdgeCosines = triangleEdgeCosines[triangle2Index].edgeCos;
+    uint32_t *const triangle1NeighborIndices = triangleNeighbors[triangle1Index].neighbor;
+    uint32_t *const triangle2NeighborIndices = triangleNeighbors[triangle2Index].neighbor;
+
+    if (triangle1NeighborIndices[edge1Index] == CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
+    {
+        if (triangle2NeighborIndices[edge2Index] == CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
+        {
+            triangle1NeighborIndices[edge1Index] = triangle2Index;
+            triangle2NeighborIndices[edge2Index] = triangle1Index;
+            triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
+        }
+        else
+        {
+            // t2 already has a match, try to find the least convex match
+            if (edgeCosine > triangle2EdgeCosines[edge2Index])
+            {
+                // t1-t2 is a better match than t3-t2
+                uint32_t triangle3Index = triangle2NeighborIndices[edge2Index];
+                float *triangle3EdgeCosines = triangleEdgeCosines[triangle3Index].edgeCos;
+                uint32_t *triangle3NeighborIndices = triangleNeighbors[triangle3Index].neighbor;
+
+                triangle1NeighborIndices[edge1Index] = triangle2Index;
+                triangle2NeighborIndices[edge2Index] = triangle1Index;
+                triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
+
+                // search edges of triangle3 for the edge with neighbor == triangle2
+                uint32_t edge3Index = findEdge(triangle3Index, triangle2Index);
+
+                // mark t3 as unmatched
+                triangle3NeighborIndices[edge3Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
+                triangle3EdgeCosines[edge3Index] = 1.0f;
+            }
+        }
+    }
+    else
+    {
+        if (triangle2NeighborIndices[edge2Index] == CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
+        {
+            // t1 already a match, try to find the least convex match
+            if ( edgeCosine > triangle1EdgeCosines[edge1Index] )
+            {
+                // t1-t2 is a better match than t1-t3
+                uint32_t triangle3Index = triangle1NeighborIndices[edge1Index];
+                float *triangle3EdgeCosines = triangleEdgeCosines[triangle3Index].edgeCos;
+                uint32_t *triangle3NeighborIndices = triangleNeighbors[triangle3Index].neighbor;
+
+                triangle1NeighborIndices[edge1Index] = triangle2Index;
+                triangle2NeighborIndices[edge2Index] = triangle1Index;
+                triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
+
+                // search edges of triangle3 for the edge with neighbor == triangle2
+                uint32_t edge3Index = findEdge(triangle3Index, triangle1Index);
+
+                // mark t3 as unmatched
+                triangle3NeighborIndices[edge3Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
+                triangle3EdgeCosines[edge3Index] = 1.0f;
+            }
+        }
+        else
+        {
+            // both t1 and t2 are already a matched, try to find the least convex match
+
+            uint32_t triangle3Index = triangle1NeighborIndices[edge1Index];
+            uint32_t triangle4Index = triangle2NeighborIndices[edge2Index];
+
+            if (triangle1Index != triangle4Index && triangle2Index != triangle3Index)
+            {
+                if (edgeCosine > triangle1EdgeCosines[edge1Index] && edgeCosine > triangle2EdgeCosines[edge2Index])
+                {
+                    float *triangle3EdgeCosines = triangleEdgeCosines[triangle3Index].edgeCos;
+                    uint32_t *triangle3NeighborIndices = triangleNeighbors[triangle3Index].neighbor;
+
+                    // search edges of triangle3 for the edge with neighbor == triangle1
+                    uint32_t edge3Index = findEdge(triangle3Index, triangle1Index);
+
+                    float *triangle4EdgeCosines = triangleEdgeCosines[triangle4Index].edgeCos;
+                    uint32_t *triangle4NeighborIndices = triangleNeighbors[triangle4Index].neighbor;
+
+                    // search edges of triangle4 for the edge with neighbor == triangle2
+                    uint32_t edge4Index = findEdge(triangle4Index, triangle2Index);
+
+                    // t1-t2 is a better match than t1-t3 or t2-t4
+                    triangle1NeighborIndices[edge1Index] = triangle2Index;
+                    triangle2NeighborIndices[edge2Index] = triangle1Index;
+                    triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
+
+                    // mark t3 as unmatched
+                    triangle3NeighborIndices[edge3Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
+                    triangle3EdgeCosines[edge3Index] = 1.0f;
+                    // mark t4 as unmatched
+                    triangle4NeighborIndices[edge4Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
+                    triangle4EdgeCosines[edge4Index] = 1.0f;
+                }
+            }
+        }
+    }
+}
+
+
+struct MateSortedEdgesContext
+{
+    const TriangleList *triangles;
+    const VertexList *vertices;
+    const EdgeRecord *records;
+    uint32_t numRecords;
+    const rwpmath::Vector3 *normals;
+    TriangleEdgeCosinesList *triangleEdgeCosines;
+    TriangleNeighborsList *triangleNeighbors;
+};
+
+
+/**
+Range function mating the runs of coincident sorted edge records which start in the range, running on past its
+end to finish the last run. The records of a run are in triangle order, so its matches are applied in the same
+order as TriangleNeighborFinder::FindTriangleNeighbors finds them. The candidates for each edge are the lower
+indexed triangles with an edge in the same run, which precede it in the run.
+*/
+void MateSortedEdgesInRange(void *contextPtr, uint32_t /*workerIndex*/, uint32_t begin, uint32_t end)
+{
+    const MateSortedEdgesContext &context = *static_cast<const MateSortedEdgesContext *>(contextPtr);
+    const TriangleList &triangles = *context.triangles;
+    const VertexList &vertices = *context.vertices;
+    const EdgeRecord *const records = context.records;
+    const uint32_t numRecords = context.numRecords;
+
+    // Skip the end of a run which started in the previous range
+    uint32_t runStart = begin;
+    while (runStart > 0 && runStart < end &&
+           records[runStart].minVertexIndex == records[runStart - 1].minVertexIndex &&
+           records[runStart].maxVertexIndex == records[runStart - 1].maxVertexIndex)
+    {
+        ++runStart;
+    }
+
+    // The records of disabled triangles sort last and are never mated
+    while (runStart < end && records[runStart].minVertexIndex != EDGERECORD_DISABLED)
+    {
+        uint32_t runEnd = runStart + 1;
+        while (runEnd < numRecords &&
+               records[runEnd].minVertexIndex == records[runStart].minVertexIndex &&
+               records[runEnd].maxVertexIndex == records[runStart].maxVertexIndex)
+        {
+            ++runEnd;
+        }
+
+        RunEdgeFinder findEdge;
+        findEdge.triangleNeighbors = context.triangleNeighbors;
+        findEdge.records = records;
+        findEdge.runStart = runStart;
+        findEdge.runEnd = runEnd;
+
+        for (uint32_t position = runStart + 1; position < runEnd; ++position)
+        {
+            const uint32_t triangle1Index = records[position].triangleEdge >> 2;
+            const uint32_t edge1Index = records[position].triangleEdge & 3;
+            const uint32_t edge1NextIndex = (edge1Index < 2) ? (edge1Index + 1) : 0;
+            const uint32_t *const triangle1VertexIndices = triangles[triangle1Index].vertices;
+
+            uint32_t previousTriangle2Index = triangle1Index;
+            for (uint32_t recordIndex = runStart; recordIndex < position; ++recordIndex)
+            {
+                const uint32_t triangle2Index = records[recordIndex].triangleEdge >> 2;
+                if (triangle2Index == previousTriangle2Index || triangle2Index == triangle1Index)
+                {
+                    continue;
+                }
+                previousTriangle2Index = triangle2Index;
+
+                // Test e1 of triangle i1 against all edges of triangle i2, as in FindEdgeMate
+                const uint32_t *const triangle2VertexIndices = triangles[triangle2Index].vertices;
+                for (uint32_t edge2Index = 2u, edge2NextIndex = 0u; edge2NextIndex < 3u; edge2Index = edge2NextIndex++)
+                {
+                    if (triangle1VertexIndices[edge1Index] == triangle2VertexIndices[edge2NextIndex] &&
+                        triangle2VertexIndices[edge2Index] == triangle1VertexIndices[edge1NextIndex])
+                    {
+                        TriangleNeighborFinder::EdgeMate mate;
+                        mate.triangle1Index = triangle1Index;
+                        mate.triangle2Index = triangle2Index;
+                        mate.edge1Index = edge1Index;
+                        mate.edge2Index = edge2Index;
+                        mate.edgeCosine = EdgeCosines::ComputeExtendedEdgeCosine(
+                            context.normals[triangle1Index],
+                            context.normals[triangle2Index],
+                            rwpmath::Vector3(vertices[triangle1VertexIndices[edge1NextIndex]] - vertices[triangle1VertexIndices[edge1Index]]));
+
+                        ApplyEdgeMateWith(*context.triangleEdgeCosines, *context.triangleNeighbors, mate, findEdge);
+                        break;
+                    }
+                }
+            }
+        }
+
+        runStart = runEnd;
+    }
+}
+
+} // namespace
+
+
 void TriangleNeighborFinder::FindTriangleNeighbors(
     const TriangleList & triangles,
     TriangleEdgeCosinesList & triangleEdgeCosines,
@@ -76,149 +543,262 @@ void TriangleNeighborFinder::FindTriangleNeighbors(
 }
 
 
-bool TriangleNeighborFinder::MateEdge(
+bool TriangleNeighborFinder::FindTriangleNeighborsByEdgeSort(
     const TriangleList & triangles,
     TriangleEdgeCosinesList & triangleEdgeCosines,
     TriangleNeighborsList & triangleNeighbors,
+    const TriangleFlagsList & triangleFlags,
     const VertexList & vertices,
-    const uint32_t edge1Index,
-    const uint32_t triangle1Index,
-    const uint32_t triangle2Index)
+    EA::Allocator::ICoreAllocator * allocator,
+    IParallelDispatcher * dispatcher)
 {
-    uint32_t edge1NextIndex = (edge1Index < 2) ? (edge1Index + 1) : 0;
+    EA_ASSERT_MSG(triangles.size() != 0, "triangles count should not be zero");
+    EA_ASSERT_MSG(triangleEdgeCosines.size() != 0, "triangleEdgeCosines count should not be zero");
+    EA_ASSERT_MSG(triangleNeighbors.size() != 0, "triangleNeighbors count should not be zero");
+    EA_ASSERT_MSG(triangleFlags.size() != 0, "triangleFlags count should not be zero");
+    EA_ASSERT_MSG(vertices.size() != 0, "vert count should not be zero");
 
-    const uint32_t *const triangle1VertexIndices = triangles[triangle1Index].vertices;
-    const uint32_t *const triangle2VertexIndices = triangles[triangle2Index].vertices;
+    const uint32_t numTriangles(triangles.size());
+    const uint32_t numRecords = numTriangles * 3;
+    EA_ASSERT_MSG(numTriangles < (1u << 30), "Too many triangles to record edges");
 
-    float *const triangle1EdgeCosines = triangleEdgeCosines[triangle1Index].edgeCos;
-    float *const triangle2EdgeCosines = triangleEdgeCosines[triangle2Index].edgeCos;
-    uint32_t *const triangle1NeighborIndices = triangleNeighbors[triangle1Index].neighbor;
-    uint32_t *const triangle2NeighborIndices = triangleNeighbors[triangle2Index].neighbor;
+    EdgeRecord *const records = static_cast<EdgeRecord *>(
+        allocator->Alloc(numRecords * sizeof(EdgeRecord), "EdgeRecords", EA::Allocator::MEM_TEMP, 4));
+    EdgeRecord *const scratch = static_cast<EdgeRecord *>(
+        allocator->Alloc(numRecords * sizeof(EdgeRecord), "EdgeRecordsScratch", EA::Allocator::MEM_TEMP, 4));
+    rwpmath::Vector3 *const normals = static_cast<rwpmath::Vector3 *>(
+        allocator->Alloc(numTriangles * sizeof(rwpmath::Vector3), "TriangleNormals", EA::Allocator::MEM_TEMP, 16));
 
-    const rwpmath::Vector3 t1Normal(TriangleNormal::ComputeTriangleNormalFast(
-        rwpmath::Vector3(vertices[triangle1VertexIndices[0]]),
-        rwpmath::Vector3(vertices[triangle1VertexIndices[1]]),
-        rwpmath::Vector3(vertices[triangle1VertexIndices[2]])));
+    if (!records || !scratch || !normals)
+    {
+        if (normals)
+        {
+            allocator->Free(normals);
+        }
+        if (scratch)
+        {
+            allocator->Free(scratch);
+        }
+        if (records)
+        {
+            allocator->Free(records);
+        }
+        return false;
+    }
 
-    const rwpmath::Vector3 t2Normal(TriangleNormal::ComputeTriangleNormalFast(
-        rwpmath::Vector3(vertices[triangle2VertexIndices[0]]),
-        rwpmath::Vector3(vertices[triangle2VertexIndices[1]]),
-        rwpmath::Vector3(vertices[triangle2VertexIndices[2]])));
+    // Record the edges and normals of all triangles
+    RecordEdgesContext context;
+    context.triangles = &triangles;
+    context.triangleFlags = &triangleFlags;
+    context.vertices = &vertices;
+    context.records = records;
+    context.normals = normals;
+
+    IParallelDispatcher::Run(dispatcher, RecordEdgesInRange, &context, numTriangles, RECORDEDGES_GRAINSIZE);
+
+    // Sort on the vertex pair. The sorts are stable so each run of coincident edges is in triangle order.
+    RadixSort::Sort(records, scratch, numRecords, EdgeRecordMaxVertexKey());
+    RadixSort::Sort(records, scratch, numRecords, EdgeRecordMinVertexKey());
+
+    // Mate each run of coincident edges. The matches of a run only change the edges in it, so the runs are
+    // independent, and each is mated in the order FindTriangleNeighbors would find its matches.
+    MateSortedEdgesContext mateContext;
+    mateContext.triangles = &triangles;
+    mateContext.vertices = &vertices;
+    mateContext.records = records;
+    mateContext.numRecords = numRecords;
+    mateContext.normals = normals;
+    mateContext.triangleEdgeCosines = &triangleEdgeCosines;
+    mateContext.triangleNeighbors = &triangleNeighbors;
+
+    IParallelDispatcher::Run(dispatcher, MateSortedEdgesInRange, &mateContext, numRecords, MATEEDGES_GRAINSIZE);
+
+    allocator->Free(normals);
+    allocator->Free(scratch);
+    allocator->Free(records);
+
+    return true;
+}
 
-    const rwpmath::VecFloat edgeCosine = EdgeCosines::ComputeExtendedEdgeCosine(
-        t1Normal,
-        t2Normal,
-        rwpmath::Vector3(vertices[triangle1VertexIndices[edge1NextIndex]] - vertices[triangle1VertexIndices[edge1Index]]));
 
-    // Test e1 of triangle i1 against all edges of triangle i2.
-    for (uint32_t edge2Index = 2u, edge2NextIndex = 0u; edge2NextIndex < 3u; edge2Index = edge2NextIndex++)
-    {
-        // Test e1==e2next and e2==e1next
-        if (triangle1VertexIndices[edge1Index] == triangle2VertexIndices[edge2NextIndex] &&
-             triangle2VertexIndices[edge2Index] == triangle1VertexIndices[edge1NextIndex])
-        {
-            if (triangle1NeighborIndices[edge1Index] == CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
-            {
-                if (triangle2NeighborIndices[edge2Index] == CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
-                {
-                    triangle1NeighborIndices[edge1Index] = triangle2Index;
-                    triangle2NeighborIndices[edge2Index] = triangle1Index;
-                    triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
-                }
-                else
-                {
-                    // t2 already has a match, try to find the least convex match
-                    if (edgeCosine > triangle2EdgeCosines[edge2Index])
-                    {
-                        // t1-t2 is a better match than t3-t2
-                        uint32_t triangle3Index = triangle2NeighborIndices[edge2Index];
-                        float *triangle3EdgeCosines = triangleEdgeCosines[triangle3Index].edgeCos;
-                        uint32_t *triangle3NeighborIndices = triangleNeighbors[triangle3Index].neighbor;
+uint32_t TriangleNeighborFinder::GetEdgeSortWorkspaceSize(
+    const uint32_t numTriangles)
+{
+    const uint32_t numRecords = numTriangles * 3;
 
-                        triangle1NeighborIndices[edge1Index] = triangle2Index;
-                        triangle2NeighborIndices[edge2Index] = triangle1Index;
-                        triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
+    // The edge records and the scratch records through which they are radix sorted
+    uint32_t size = 2u * numRecords * static_cast<uint32_t>(sizeof(EdgeRecord));
 
-                        // search edges of triangle3 for the edge with neighbor == triangle2
-                        uint32_t edge3Index = FindEdgeByNeighbor(triangle3NeighborIndices, triangle2Index);
+    // The triangle normals, with the padding needed to align them
+    size += numTriangles * static_cast<uint32_t>(sizeof(rwpmath::Vector3));
+    size += 16u - 4u;
 
-                        // mark t3 as unmatched
-                        triangle3NeighborIndices[edge3Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
-                        triangle3EdgeCosines[edge3Index] = 1.0f;
-                    }
-                }
-            }
-            else
-            {
-                if (triangle2NeighborIndices[edge2Index] == CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
-                {
-                    // t1 already a match, try to find the least convex match
-                    if ( edgeCosine > triangle1EdgeCosines[edge1Index] )
-                    {
-                        // t1-t2 is a better match than t1-t3
-                        uint32_t triangle3Index = triangle1NeighborIndices[edge1Index];
-                        float *triangle3EdgeCosines = triangleEdgeCosines[triangle3Index].edgeCos;
-                        uint32_t *triangle3NeighborIndices = triangleNeighbors[triangle3Index].neighbor;
+    return size;
+}
 
-                        triangle1NeighborIndices[edge1Index] = triangle2Index;
-                        triangle2NeighborIndices[edge2Index] = triangle1Index;
-                        triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
 
-                        // search edges of triangle3 for the edge with neighbor == triangle2
-                        uint32_t edge3Index = FindEdgeByNeighbor(triangle3NeighborIndices, triangle1Index );
+uint32_t TriangleNeighborFinder::GetParallelWorkspaceSize(
+    const uint32_t numTriangles)
+{
+    // The match list of each range
+    return IParallelDispatcher::GetNumRanges(numTriangles, FINDNEIGHBORS_GRAINSIZE) * static_cast<uint32_t>(sizeof(EdgeMateRange));
+}
 
-                        // mark t3 as unmatched
-                        triangle3NeighborIndices[edge3Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
-                        triangle3EdgeCosines[edge3Index] = 1.0f;
-                    }
-                }
-                else
-                {
-                    // both t1 and t2 are already a matched, try to find the least convex match
 
-                    uint32_t triangle3Index = triangle1NeighborIndices[edge1Index];
-                    uint32_t triangle4Index = triangle2NeighborIndices[edge2Index];
+uint32_t TriangleNeighborFinder::GetParallelWorkerArenaSize(
+    const uint32_t numTriangles)
+{
+    // Each edge of a triangle matches at most one lower triangle, and each range starts a new block
+    const uint32_t numRanges = IParallelDispatcher::GetNumRanges(numTriangles, FINDNEIGHBORS_GRAINSIZE);
+    const uint32_t numBlocks = (3u * numTriangles) / EDGEMATEBLOCK_SIZE + numRanges;
+    return numBlocks * static_cast<uint32_t>(sizeof(EdgeMateBlock));
+}
 
-                    if (triangle1Index != triangle4Index && triangle2Index != triangle3Index)
-                    {
-                        if (edgeCosine > triangle1EdgeCosines[edge1Index] && edgeCosine > triangle2EdgeCosines[edge2Index])
-                        {
-                            float *triangle3EdgeCosines = triangleEdgeCosines[triangle3Index].edgeCos;
-                            uint32_t *triangle3NeighborIndices = triangleNeighbors[triangle3Index].neighbor;
 
-                            // search edges of triangle3 for the edge with neighbor == triangle1
-                            uint32_t edge3Index = FindEdgeByNeighbor(triangle3NeighborIndices, triangle1Index);
+bool TriangleNeighborFinder::FindTriangleNeighbors(
+    const TriangleList & triangles,
+    TriangleEdgeCosinesList & triangleEdgeCosines,
+    TriangleNeighborsList & triangleNeighbors,
+    const TriangleFlagsList & triangleFlags,
+    const VertexList & vertices,
+    const detail::VertexTriangleMap & vertexTriangleMap,
+    IParallelDispatcher * dispatcher,
+    WorkerAllocators & workerAllocators,
+    IAllocator * allocator)
+{
+    EA_ASSERT_MSG(triangles.size() != 0, "triangles count should not be zero");
+    EA_ASSERT_MSG(triangleFlags.size() != 0, "triangleFlags count should not be zero");
+    EA_ASSERT_MSG(vertices.size() != 0, "vert count should not be zero");
+    EA_ASSERT_MSG(vertexTriangleMap.IsValid() == true, "vertexTriangleMap should be valid");
+    EA_ASSERT_MSG(dispatcher == NULL || workerAllocators.GetNumWorkers() >= dispatcher->GetNumWorkers(), "Each dispatcher worker needs an arena");
 
-                            float *triangle4EdgeCosines = triangleEdgeCosines[triangle4Index].edgeCos;
-                            uint32_t *triangle4NeighborIndices = triangleNeighbors[triangle4Index].neighbor;
+    const uint32_t numTriangles(triangles.size());
+    const uint32_t numRanges = IParallelDispatcher::GetNumRanges(numTriangles, FINDNEIGHBORS_GRAINSIZE);
 
-                            // search edges of triangle4 for the edge with neighbor == triangle2
-                            uint32_t edge4Index = FindEdgeByNeighbor(triangle4NeighborIndices, triangle2Index);
+    // Per range match lists, allocated before the dispatch so the workers never touch the main allocator
+    EdgeMateRange *const ranges = static_cast<EdgeMateRange *>(
+        allocator->Alloc(numRanges * sizeof(EdgeMateRange), "EdgeMateRanges", EA::Allocator::MEM_TEMP, 4));
+    if (!ranges)
+    {
+        return false;
+    }
 
-                            // t1-t2 is a better match than t1-t3 or t2-t4
-                            triangle1NeighborIndices[edge1Index] = triangle2Index;
-                            triangle2NeighborIndices[edge2Index] = triangle1Index;
-                            triangle1EdgeCosines[edge1Index] = triangle2EdgeCosines[edge2Index] = edgeCosine;
+    FindEdgeMatesContext context;
+    context.triangles = &triangles;
+    context.triangleFlags = &triangleFlags;
+    context.vertices = &vertices;
+    context.vertexTriangleMap = &vertexTriangleMap;
+    context.workerAllocators = &workerAllocators;
+    context.ranges = ranges;
 
-                            // mark t3 as unmatched
-                            triangle3NeighborIndices[edge3Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
-                            triangle3EdgeCosines[edge3Index] = 1.0f;
-                            // mark t4 as unmatched
-                            triangle4NeighborIndices[edge4Index] = CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH;
-                            triangle4EdgeCosines[edge4Index] = 1.0f;
-                        }
-                    }
+    IParallelDispatcher::Run(dispatcher, FindEdgeMatesInRange, &context, numTriangles, FINDNEIGHBORS_GRAINSIZE);
+
+    bool outOfMemory = false;
+    for (uint32_t rangeIndex = 0; rangeIndex < numRanges; ++rangeIndex)
+    {
+        outOfMemory = outOfMemory || ranges[rangeIndex].outOfMemory;
+    }
+
+    // Apply the matches in the order the serial search would have found them
+    if (!outOfMemory)
+    {
+        for (uint32_t rangeIndex = 0; rangeIndex < numRanges; ++rangeIndex)
+        {
+            for (const EdgeMateBlock *block = ranges[rangeIndex].first; block; block = block->next)
+            {
+                for (uint32_t mateIndex = 0; mateIndex < block->count; ++mateIndex)
+                {
+                    ApplyEdgeMate(triangleEdgeCosines, triangleNeighbors, block->mates[mateIndex]);
                 }
             }
-
-            return true;                 //  RETURN -- found match
         }
     }
 
+    allocator->Free(ranges);
+
+    return !outOfMemory;
+}
+
+
+bool TriangleNeighborFinder::MateEdge(
+    const TriangleList & triangles,
+    TriangleEdgeCosinesList & triangleEdgeCosines,
+    TriangleNeighborsList & triangleNeighbors,
+    const VertexList & vertices,
+    const uint32_t edge1Index,
+    const uint32_t triangle1Index,
+    const uint32_t triangle2Index)
+{
+    EdgeMate mate;
+    if (FindEdgeMate(triangles, vertices, edge1Index, triangle1Index, triangle2Index, mate))
+    {
+        ApplyEdgeMate(triangleEdgeCosines, triangleNeighbors, mate);
+        return true;                 //  RETURN -- found match
+    }
+
     return false;            // no match found
 }
 
 
+bool TriangleNeighborFinder::FindEdgeMate(
+    const TriangleList & triangles,
+    const VertexList & vertices,
+    const uint32_t edge1Index,
+    const uint32_t triangle1Index,
+    const uint32_t triangle2Index,
+    EdgeMate & mate)
+{
+    uint32_t edge1NextIndex = (edge1Index < 2) ? (edge1Index + 1) : 0;
+
+    const uint32_t *const triangle1VertexIndices = triangles[triangle1Index].vertices;
+    const uint32_t *const triangle2VertexIndices = triangles[triangle2Index].vertices;
+
+    // Test e1 of triangle i1 against all edges of triangle i2.
+    for (uint32_t edge2Index = 2u, edge2NextIndex = 0u; edge2NextIndex < 3u; edge2Index = edge2NextIndex++)
+    {
+        // Test e1==e2next and e2==e1next
+        if (triangle1VertexIndices[edge1Index] == triangle2VertexIndices[edge2NextIndex] &&
+             triangle2VertexIndices[edge2Index] == triangle1VertexIndices[edge1NextIndex])
+        {
+            const rwpmath::Vector3 t1Normal(TriangleNormal::ComputeTriangleNormalFast(
+                rwpmath::Vector3(vertices[triangle1VertexIndices[0]]),
+                rwpmath::Vector3(vertices[triangle1VertexIndices[1]]),
+                rwpmath::Vector3(vertices[triangle1VertexIndices[2]])));
+
+            const rwpmath::Vector3 t2Normal(TriangleNormal::ComputeTriangleNormalFast(
+                rwpmath::Vector3(vertices[triangle2VertexIndices[0]]),
+                rwpmath::Vector3(vertices[triangle2VertexIndices[1]]),
+                rwpmath::Vector3(vertices[triangle2VertexIndices[2]])));
+
+            mate.triangle1Index = triangle1Index;
+            mate.triangle2Index = triangle2Index;
+            mate.edge1Index = edge1Index;
+            mate.edge2Index = edge2Index;
+            mate.edgeCosine = EdgeCosines::ComputeExtendedEdgeCosine(
+                t1Normal,
+                t2Normal,
+                rwpmath::Vector3(vertices[triangle1VertexIndices[edge1NextIndex]] - vertices[triangle1VertexIndices[edge1Index]]));
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void TriangleNeighborFinder::ApplyEdgeMate(
+    TriangleEdgeCosinesList & triangleEdgeCosines,
+    TriangleNeighborsList & triangleNeighbors,
+    const EdgeMate & mate)
+{
+    NeighborEdgeFinder findEdge;
+    findEdge.triangleNeighbors = &triangleNeighbors;
+
+    ApplyEdgeMateWith(triangleEdgeCosines, triangleNeighbors, mate, findEdge);
+}
+
+
 } // namespace detail
 } // namespace meshbuilder
 } // collision
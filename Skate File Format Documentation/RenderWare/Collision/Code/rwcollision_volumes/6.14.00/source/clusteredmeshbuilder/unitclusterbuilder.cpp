@@ -106,6 +106,69 @@ bool UnitClusterBuilder::AddUnitToCluster(
 }
 
 
+void UnitClusterBuilder::AssignVertexCodesInUnitOrder(
+    UnitCluster & unitCluster,
+    const TriangleList & triangles,
+    const UnitList & unitList)
+{
+    const uint8_t unassigned = 0xFF;
+
+    unitCluster.hasVertexCodes = 0;
+    for (uint32_t vertexSetIndex = 0 ; vertexSetIndex < unitCluster.numVertices ; ++vertexSetIndex)
+    {
+        unitCluster.vertexCodes[vertexSetIndex] = unassigned;
+    }
+
+    uint32_t nextCode = 0;
+
+    for (uint32_t unitIndex = 0 ; unitIndex < unitCluster.numUnits ; ++unitIndex)
+    {
+        const Unit &unit = unitList[unitCluster.unitIDs[unitIndex]];
+        const Triangle &t1 = triangles[unit.tri0];
+
+        // The vertices in the order they are written to the unit, see ClusterDataBuilder
+        uint32_t unitVertices[4];
+        uint32_t numUnitVertices = 3;
+
+        if (unit.type == Unit::TYPE_QUAD)
+        {
+            const Triangle &t2 = triangles[unit.tri1];
+            unitVertices[0] = t1.vertices[(unit.edgeOpposingExtraVertex + 2) % 3];
+            unitVertices[1] = t1.vertices[unit.edgeOpposingExtraVertex];
+            unitVertices[2] = t1.vertices[(unit.edgeOpposingExtraVertex + 1) % 3];
+            unitVertices[3] = t2.vertices[unit.extraVertex];
+            numUnitVertices = 4;
+        }
+        else
+        {
+            unitVertices[0] = t1.vertices[0];
+            unitVertices[1] = t1.vertices[1];
+            unitVertices[2] = t1.vertices[2];
+        }
+
+        for (uint32_t i = 0 ; i < numUnitVertices ; ++i)
+        {
+            const uint8_t vertexSetIndex = unitCluster.GetVertexSetIndex(unitVertices[i]);
+            if (vertexSetIndex != unassigned && unitCluster.vertexCodes[vertexSetIndex] == unassigned)
+            {
+                unitCluster.vertexCodes[vertexSetIndex] = static_cast<uint8_t>(nextCode++);
+            }
+        }
+    }
+
+    // Any vertices not used by a unit follow those which are
+    for (uint32_t vertexSetIndex = 0 ; vertexSetIndex < unitCluster.numVertices ; ++vertexSetIndex)
+    {
+        if (unitCluster.vertexCodes[vertexSetIndex] == unassigned)
+        {
+            unitCluster.vertexCodes[vertexSetIndex] = static_cast<uint8_t>(nextCode++);
+        }
+    }
+
+    unitCluster.hasVertexCodes = 1;
+}
+
+
 } // namespace detail
 } // namespace meshbuilder
 } // collision
@@ -75,6 +75,73 @@ void VertexCompression::DetermineCompressionModeAndOffsetForRange(
 }
 
 
+uint32_t VertexCompression::CalculateMaximumGranularityShift(
+    const float granularity,
+    const float maxError)
+{
+    // A shift of s rounds to a granularity of 2^s, moving a vertex by at most 2^(s-1) mesh granules
+    uint32_t maxShift = 0;
+    while ((maxShift < 15u) && (static_cast<float>(1u << maxShift) * granularity <= maxError))
+    {
+        ++maxShift;
+    }
+
+    return maxShift;
+}
+
+
+void VertexCompression::DetermineAdaptiveCompressionModeAndOffsetForRange(
+    uint8_t &compressionMode,
+    rw::collision::ClusteredMeshCluster::Vertex32 &offset,
+    uint32_t &granularityShift,
+    const int32_t xMin,
+    const int32_t xMax,
+    const int32_t yMin,
+    const int32_t yMax,
+    const int32_t zMin,
+    const int32_t zMax,
+    const uint32_t maxGranularityShift)
+{
+    // As with 16-bit compression the offset is one below the minimum, allowing a tolerance of one unit
+    // at either end for floating point errors, so the values compressed lie in [0, range + 2].
+    int64_t range = static_cast<int64_t>(xMax) - xMin;
+    if (static_cast<int64_t>(yMax) - yMin > range)
+    {
+        range = static_cast<int64_t>(yMax) - yMin;
+    }
+    if (static_cast<int64_t>(zMax) - zMin > range)
+    {
+        range = static_cast<int64_t>(zMax) - zMin;
+    }
+    const int64_t maxValue = range + 2;
+
+    const uint8_t modes[2] = { rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED,
+                               rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED };
+    const int64_t limits[2] = { 0xFF, rw::collision::ClusteredMeshCluster::VERTEX10_MASK };
+
+    for (uint32_t modeIndex = 0 ; modeIndex < 2 ; ++modeIndex)
+    {
+        for (uint32_t shift = 0 ; shift <= maxGranularityShift ; ++shift)
+        {
+            // Values are rounded to the nearest multiple of the cluster granularity
+            const int64_t rounding = (shift > 0) ? (static_cast<int64_t>(1) << (shift - 1)) : 0;
+            if (((maxValue + rounding) >> shift) <= limits[modeIndex])
+            {
+                compressionMode = modes[modeIndex];
+                granularityShift = shift;
+                offset.x = xMin - 1;
+                offset.y = yMin - 1;
+                offset.z = zMin - 1;
+                return;
+            }
+        }
+    }
+
+    granularityShift = 0;
+    DetermineCompressionModeAndOffsetForRange(compressionMode, offset, xMin, xMax, yMin, yMax, zMin, zMax);
+}
+
+
 } // namespace meshbuilder
 } // collision
 } // namespace rw
@@ -7,6 +7,7 @@
 #if !defined EA_PLATFORM_PS3_SPU
 
 #include <rw/collision/meshbuilder/vertexmerger.h>
+#include <rw/collision/meshbuilder/detail/radixsort.h>
 
 
 namespace rw
@@ -17,709 +18,334 @@ namespace meshbuilder
 {
 
 
-bool VertexMerger::MergeVertexGroups(
-    IDList & vertexGroup,
-    EA::Allocator::ICoreAllocator & spatialMapAllocator,
-    const AABBoxType & aabbox,
-    const rwpmath::VecFloat & vertexMergeDistanceTolerance,
-    const VertexList & vertices)
+namespace
 {
-    // The spatial map divides the physical space into cells. Each cell has
-    // an ID which is determined by hashing its X, Y and Z coordinates. As
-    // items are added to the map their X, Y and Z coordinates are used to
-    // determine a hashed ID and they are added to the corresponding cell.
 
-    // Determine the volume of the entire bbox
-    const rwpmath::Vector3 boxsize(aabbox.Max() - aabbox.Min());
-    const rwpmath::VecFloat vol(boxsize.GetX() * boxsize.GetY() * boxsize.GetZ());
+/// Number of sorted vertices in each range of the parallel search for merge candidates.
+const uint32_t FINDCANDIDATES_GRAINSIZE = 4096u;
 
-    // Decide the best cell size. The cell count should be under 2^30 and
-    // the cell size should be at least 5*tolerance. The cell size is the
-    // Cubed root of the volume, of the bbox, divided by 2^30
-    rwpmath::VecFloat cellSize = rwpmath::Pow(vol, rwpmath::VecFloat(1.0f / 3.0f)) / rwpmath::VecFloat(1024.0f);
-    if (cellSize < rwpmath::VecFloat(5.0f) * vertexMergeDistanceTolerance)
-    {
-        cellSize = rwpmath::VecFloat(5.0f) * vertexMergeDistanceTolerance;
-    }
+/// Largest cell coordinate along each axis, leaving room for the 21 bits of each coordinate in the Morton code.
+const uint32_t MAX_CELL_COORDINATE = (1u << 21) - 2u;
+
+/**
+A vertex index keyed on the Morton code of the cell containing the vertex.
+*/
+struct CellRecord
+{
+    uint32_t keyLow;
+    uint32_t keyHigh;
+    uint32_t vertexIndex;
+};
 
-    // The cell IDs are composed by hashing the cell X, Y and Z coordinates.
-    // The hashing determines the granularity required to index the cells 
-    // along each of the principal axis.
-    rwpmath::VecFloat hashfactor = rwpmath::GetVecFloat_Half();
-    // Avoid a divide by zero
-    if (rwpmath::GetVecFloat_Zero() < cellSize)
+struct CellRecordLowKey
+{
+    uint32_t operator()(const CellRecord &record) const
     {
-        hashfactor = rwpmath::VecFloat(1.0f) / cellSize;
+        return record.keyLow;
     }
+};
 
-    // Determine how many bits are required for each dimension
-    uint32_t xDimension = HowManyBits(static_cast<uint32_t>(static_cast<float>(boxsize.GetX()) * hashfactor));
-    uint32_t yDimension = HowManyBits(static_cast<uint32_t>(static_cast<float>(boxsize.GetY()) * hashfactor));
-
-#if defined EA_ASSERT_ENABLED
-    uint32_t zDimension = HowManyBits(static_cast<uint32_t>(static_cast<float>(boxsize.GetZ()) * hashfactor));
-    EA_ASSERT(xDimension + yDimension + zDimension <= 32);
-#endif
-
-    // NOTE: This implicitly uses MEM_TEMP, the temporary heap
-    // Allocate the spatialmap
-    detail::SpatialMap spatialMap(vertices.size(), xDimension, yDimension, &spatialMapAllocator);
-    if (!spatialMap.IsValid())
+struct CellRecordHighKey
+{
+    uint32_t operator()(const CellRecord &record) const
     {
-        return false;
+        return record.keyHigh;
     }
+};
 
-    const rwpmath::VecFloat ftemp = cellSize * rwpmath::VecFloat(0.2345f);
-    const rwpmath::Vector3 hashbase = rwpmath::Vector3(aabbox.Min()) - rwpmath::Vector3(ftemp, ftemp, ftemp);
-    uint32_t hx, hy, hz, hx1, hy1, hz1, hx0, hy0, hz0;
+struct MergeContext
+{
+    detail::IDList *vertexGroup;
+    const detail::VertexList *vertices;
+    const CellRecord *records;
+    uint32_t numRecords;
+    rwpmath::Vector3 cellBase;
+    float cellScale;
+    float searchDistance;
+    rwpmath::VecFloat toleranceSquared;
+};
+
+
+/**
+Computes the 64 bit Morton code of a cell, interleaving the low 21 bits of each coordinate.
+*/
+uint64_t ComputeMortonCode(const uint32_t x, const uint32_t y, const uint32_t z)
+{
+    uint64_t coordinates[3] = { x & 0x1fffffu, y & 0x1fffffu, z & 0x1fffffu };
 
-    // Insert the entry vertices into the spatialmap along with their hashed IDs.
-    const uint32_t numVertices(vertices.size());
-    for (uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex)
+    // Spread the bits of each coordinate two bits apart
+    for (uint32_t axis = 0; axis < 3; ++axis)
     {
-        rwpmath::Vector3 v(vertices[vertexIndex]);
-
-        v -= hashbase;
-
-        hx = static_cast<uint32_t>(static_cast<float>(v.GetX()) * hashfactor);
-        hy = static_cast<uint32_t>(static_cast<float>(v.GetY()) * hashfactor);
-        hz = static_cast<uint32_t>(static_cast<float>(v.GetZ()) * hashfactor);
-
-        spatialMap.Insert(hx, hy, hz, vertexIndex);
+        uint64_t c = coordinates[axis];
+        c = (c | (c << 32)) & UINT64_C(0x001f00000000ffff);
+        c = (c | (c << 16)) & UINT64_C(0x001f0000ff0000ff);
+        c = (c | (c << 8)) & UINT64_C(0x100f00f00f00f00f);
+        c = (c | (c << 4)) & UINT64_C(0x10c30c30c30c30c3);
+        c = (c | (c << 2)) & UINT64_C(0x1249249249249249);
+        coordinates[axis] = c;
     }
 
-    // Close the Spatial Map to allow internal finalization its contents.
-    spatialMap.Close();
-
-    // Merge the vertices using the spatial map. Vertices which are within a
-    // given tolerance of each other are merged to the vertex with the lower
-    // index (the index used when adding the vertex to the ClusteredMeshBuilder).
-
-    // NOTE: vertex merging occurs almost arbitrary, therefore the current
-    // method cannot be relied upon to produce a specific result. The only
-    // guarantee is that after the merge has taken place no two remaining
-    // vertices will be within a given tolerance of each other.
-
-    // Entries are merged in two steps. The first step involves comparing
-    // all vertex pairs within a cell. The second step then compares each
-    // vertex to entries in surround cells which are within a tolerance of
-    // the vertex.
-
-    // Determine the tolerance used to decide when an entry needs to be
-    // compared to surrounding cells.
-    const rwpmath::VecFloat toleranceSquared = vertexMergeDistanceTolerance * vertexMergeDistanceTolerance;
+    return coordinates[0] | (coordinates[1] << 1) | (coordinates[2] << 2);
+}
 
-    // Obtain cell iterators
-    detail::SpatialMap::CellIterator it = spatialMap.Begin();
-    const detail::SpatialMap::CellIterator itEnd = spatialMap.End();
 
-    // Iterate through each cell
-    while (it != itEnd)
+/**
+Returns the coordinate of the cell containing the given distance along an axis from the cell base.
+*/
+EA_FORCE_INLINE uint32_t CellCoordinate(const float offset, const float cellScale)
+{
+    const float cell = offset * cellScale;
+    if (!(cell > 0.0f))
     {
-        const uint32_t cellId = it->first;
-        const uint32_t startEntry = spatialMap.GetFirstEntryInCell(cellId);
-        const uint32_t endEntry = spatialMap.GetFirstEntryInNextCell(cellId);
-
-        MergeRangeOfEntries(
-            vertexGroup,
-            spatialMap,
-            startEntry,
-            endEntry,
-            vertices,
-            toleranceSquared);
-
-        // Increment the cell iterator
-        ++it;
+        return 0u;
     }
+    if (cell >= static_cast<float>(MAX_CELL_COORDINATE))
+    {
+        return MAX_CELL_COORDINATE;
+    }
+    return static_cast<uint32_t>(cell);
+}
 
-    it = spatialMap.Begin();
 
-    while (it != itEnd)
+/**
+Finds the range [start, end) of the sorted records in the cell with the given Morton code.
+*/
+void FindCell(const MergeContext &context, const uint64_t key, uint32_t &start, uint32_t &end)
+{
+    const CellRecord *const records = context.records;
+    const uint32_t keyHigh = static_cast<uint32_t>(key >> 32);
+    const uint32_t keyLow = static_cast<uint32_t>(key);
+
+    // Lower bound
+    uint32_t low = 0;
+    uint32_t high = context.numRecords;
+    while (low < high)
     {
-        const uint32_t cellId = it->first;
-        const uint32_t startEntry = spatialMap.GetFirstEntryInCell(cellId);
-        const uint32_t endEntry = spatialMap.GetFirstEntryInNextCell(cellId);
-
-        for (uint32_t entry = startEntry; entry < endEntry; ++entry)
+        const uint32_t middle = low + ((high - low) >> 1);
+        if (records[middle].keyHigh < keyHigh || (records[middle].keyHigh == keyHigh && records[middle].keyLow < keyLow))
         {
-            // Compare the current higherVertex with all other vertices in cells within tolerance
-
-            uint32_t vertexIndex = spatialMap.GetEntry(entry);
-            rwpmath::Vector3 offsetV(vertices[vertexIndex]);
-            offsetV -= hashbase;
-            rwpmath::Vector3 v(vertices[vertexIndex]);
-
-            hx = static_cast<uint32_t>(static_cast<float>(offsetV.GetX()) * hashfactor);
-            hy = static_cast<uint32_t>(static_cast<float>(offsetV.GetY()) * hashfactor);
-            hz = static_cast<uint32_t>(static_cast<float>(offsetV.GetZ()) * hashfactor);
-            hx1 = static_cast<uint32_t>((static_cast<float>(offsetV.GetX()) + vertexMergeDistanceTolerance) * hashfactor);
-            hy1 = static_cast<uint32_t>((static_cast<float>(offsetV.GetY()) + vertexMergeDistanceTolerance) * hashfactor);
-            hz1 = static_cast<uint32_t>((static_cast<float>(offsetV.GetZ()) + vertexMergeDistanceTolerance) * hashfactor);
-            hx0 = static_cast<uint32_t>((static_cast<float>(offsetV.GetX()) - vertexMergeDistanceTolerance) * hashfactor);
-            hy0 = static_cast<uint32_t>((static_cast<float>(offsetV.GetY()) - vertexMergeDistanceTolerance) * hashfactor);
-            hz0 = static_cast<uint32_t>((static_cast<float>(offsetV.GetZ()) - vertexMergeDistanceTolerance) * hashfactor);
-
-            if (hx < hx1)
-            {
-                if (hy < hy1)
-                {
-                    if (hz < hz1)
-                    {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx1,
-                            hy1,
-                            hz1,
-                            entry,
-                            toleranceSquared);
-                    }
-                    else if (hz > hz0)
-                    {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx1,
-                            hy1,
-                            hz0,
-                            entry,
-                            toleranceSquared);
-                    }
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    start = low;
 
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx1,
-                        hy1,
-                        hz,
-                        entry,
-                        toleranceSquared);
-                }
-                else if (hy > hy0)
-                {
-                    if (hz < hz1)
-                    {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx1,
-                            hy0,
-                            hz1,
-                            entry,
-                            toleranceSquared);
-                    }
-                    else if (hz > hz0)
-                    {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx1,
-                            hy0,
-                            hz0,
-                            entry,
-                            toleranceSquared);
-                    }
+    // Upper bound
+    high = context.numRecords;
+    while (low < high)
+    {
+        const uint32_t middle = low + ((high - low) >> 1);
+        if (records[middle].keyHigh == keyHigh && records[middle].keyLow == keyLow)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    end = low;
+}
 
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx1,
-                        hy0,
-                        hz,
-                        entry,
-                        toleranceSquared);
-                }
 
-                if (hz < hz1)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx1,
-                        hy,
-                        hz1,
-                        entry,
-                        toleranceSquared);
-                }
-                else if (hz > hz0)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx1,
-                        hy,
-                        hz0,
-                        entry,
-                        toleranceSquared);
-                }
+/**
+Finds the lowest indexed vertex, lower than the given vertex and within the tolerance of it, optionally
+ignoring vertices which have already been merged to another vertex.
 
-                CompareEntryAgainstCell(
-                    vertexGroup,
-                    spatialMap,
-                    vertices,
-                    hx1,
-                    hy,
-                    hz,
-                    entry,
-                    toleranceSquared);
-            }
-            else if (hx > hx0)
+\return the index of the vertex found, or the given vertex index if there is none.
+*/
+uint32_t FindLowestMergeCandidate(const MergeContext &context, const uint32_t vertexIndex, const bool remainingOnly)
+{
+    const detail::IDList &vertexGroup = *context.vertexGroup;
+    const detail::VertexList &vertices = *context.vertices;
+    const VectorType &vertex = vertices[vertexIndex];
+    const rwpmath::Vector3 offset(rwpmath::Vector3(vertex) - context.cellBase);
+
+    const float x = static_cast<float>(offset.GetX());
+    const float y = static_cast<float>(offset.GetY());
+    const float z = static_cast<float>(offset.GetZ());
+
+    const uint32_t x0 = CellCoordinate(x - context.searchDistance, context.cellScale);
+    const uint32_t x1 = CellCoordinate(x + context.searchDistance, context.cellScale);
+    const uint32_t y0 = CellCoordinate(y - context.searchDistance, context.cellScale);
+    const uint32_t y1 = CellCoordinate(y + context.searchDistance, context.cellScale);
+    const uint32_t z0 = CellCoordinate(z - context.searchDistance, context.cellScale);
+    const uint32_t z1 = CellCoordinate(z + context.searchDistance, context.cellScale);
+
+    uint32_t lowest = vertexIndex;
+
+    // Up to three cells along each axis, inclusive of both ends of the search range
+    EA_ASSERT(x1 - x0 <= 2u && y1 - y0 <= 2u && z1 - z0 <= 2u);
+    for (uint32_t cellX = x0; cellX <= x1; ++cellX)
+    {
+        for (uint32_t cellY = y0; cellY <= y1; ++cellY)
+        {
+            for (uint32_t cellZ = z0; cellZ <= z1; ++cellZ)
             {
-                if (hy < hy1)
-                {
-                    if (hz < hz1)
-                    {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx0,
-                            hy1,
-                            hz1,
-                            entry,
-                            toleranceSquared);
-                    }
-                    else if (hz > hz0)
-                    {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx0,
-                            hy1,
-                            hz0,
-                            entry,
-                            toleranceSquared);
-                    }
+                uint32_t start = 0;
+                uint32_t end = 0;
+                FindCell(context, ComputeMortonCode(cellX, cellY, cellZ), start, end);
 
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx0,
-                        hy1,
-                        hz,
-                        entry,
-                        toleranceSquared);
-                }
-                else if (hy > hy0)
+                // The vertices of each cell are in index order, so the first found is the lowest in the cell
+                for (uint32_t recordIndex = start; recordIndex < end; ++recordIndex)
                 {
-                    if (hz < hz1)
+                    const uint32_t candidateIndex = context.records[recordIndex].vertexIndex;
+                    if (candidateIndex >= lowest)
                     {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx0,
-                            hy0,
-                            hz1,
-                            entry,
-                            toleranceSquared);
+                        break;
                     }
-                    else if (hz > hz0)
+
+                    if ((!remainingOnly || vertexGroup[candidateIndex] == candidateIndex) &&
+                        rwpmath::MagnitudeSquared(rwpmath::Vector3(vertex - vertices[candidateIndex])) < context.toleranceSquared)
                     {
-                        CompareEntryAgainstCell(
-                            vertexGroup,
-                            spatialMap,
-                            vertices,
-                            hx0,
-                            hy0,
-                            hz0,
-                            entry,
-                            toleranceSquared);
+                        lowest = candidateIndex;
+                        break;
                     }
-
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx0,
-                        hy0,
-                        hz,
-                        entry,
-                        toleranceSquared);
-                }
-
-                if (hz < hz1)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx0,
-                        hy,
-                        hz1,
-                        entry,
-                        toleranceSquared);
-                }
-                else if (hz > hz0)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx0,
-                        hy,
-                        hz0,
-                        entry,
-                        toleranceSquared);
-                }
-
-                CompareEntryAgainstCell(
-                    vertexGroup,
-                    spatialMap,
-                    vertices,
-                    hx0,
-                    hy,
-                    hz,
-                    entry,
-                    toleranceSquared);
-            }
-
-            if (hy < hy1)
-            {
-                if (hz < hz1)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx,
-                        hy1,
-                        hz1,
-                        entry,
-                        toleranceSquared);
-                }
-                else if (hz > hz0)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx,
-                        hy1,
-                        hz0,
-                        entry,
-                        toleranceSquared);
                 }
-
-                CompareEntryAgainstCell(
-                    vertexGroup,
-                    spatialMap,
-                    vertices,
-                    hx,
-                    hy1,
-                    hz,
-                    entry,
-                    toleranceSquared);
-            }
-            else if (hy > hy0)
-            {
-                if (hz < hz1)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx,
-                        hy0,
-                        hz1,
-                        entry,
-                        toleranceSquared);
-                }
-                else if (hz > hz0)
-                {
-                    CompareEntryAgainstCell(
-                        vertexGroup,
-                        spatialMap,
-                        vertices,
-                        hx,
-                        hy0,
-                        hz0,
-                        entry,
-                        toleranceSquared);
-                }
-
-                CompareEntryAgainstCell(
-                    vertexGroup,
-                    spatialMap,
-                    vertices,
-                    hx,
-                    hy0,
-                    hz,
-                    entry,
-                    toleranceSquared);
-            }
-
-            if (hz < hz1)
-            {
-                CompareEntryAgainstCell(
-                    vertexGroup,
-                    spatialMap,
-                    vertices,
-                    hx,
-                    hy,
-                    hz1,
-                    entry,
-                    toleranceSquared);
-            }
-            else if (hz > hz0)
-            {
-                CompareEntryAgainstCell(
-                    vertexGroup,
-                    spatialMap,
-                    vertices,
-                    hx,
-                    hy,
-                    hz0,
-                    entry,
-                    toleranceSquared);
             }
         }
-
-        // Increment the cell iterator
-        ++it;
     }
 
-    // spatialMap is now redundant so deallocate memory
-    spatialMap.Release();
-
-    // return success
-    return true;
+    return lowest;
 }
 
 
-EA_FORCE_INLINE uint32_t VertexMerger::HowManyBits(uint32_t val)
+/**
+Range function finding, for each vertex of a range of sorted records, the lowest indexed vertex within the
+tolerance of it. Ranges of sorted records cover nearby cells, so the cells searched by a range are mostly shared.
+*/
+void FindMergeCandidatesInRange(void *contextPtr, uint32_t /*workerIndex*/, uint32_t begin, uint32_t end)
 {
-    uint32_t i;
-    for (i = 0; val; val >>= 1, ++i) {}
-    return i;
-}
-
+    const MergeContext &context = *static_cast<const MergeContext *>(contextPtr);
+    detail::IDList &vertexGroup = *context.vertexGroup;
 
-void VertexMerger::MergeRangeOfEntries(
-    IDList & vertexGroup,
-    const detail::SpatialMap &spatialMap,
-    const uint32_t startEntry,
-    const uint32_t endEntry,
-    const VertexList &vertices,
-    const rwpmath::VecFloat & toleranceSquared)
-{
-    // Compare all pairs of entries with indices higher than the comparison vertex
-    for (uint32_t higherEntry = startEntry ; higherEntry < endEntry ; ++higherEntry)
+    for (uint32_t recordIndex = begin; recordIndex < end; ++recordIndex)
     {
-        uint32_t higherVertexIndex = spatialMap.GetEntry(higherEntry);
-        VectorType higherVertex = vertices[higherVertexIndex];
-
-        // Compare the current higherVertex with all other vertices in its cell
-        for (uint32_t lowerEntry = startEntry ; lowerEntry < higherEntry ; ++lowerEntry)
-        {
-            uint32_t lowerVertexIndex = spatialMap.GetEntry(lowerEntry);
-            if (rwpmath::MagnitudeSquared(rwpmath::Vector3(higherVertex - vertices[lowerVertexIndex])) < (toleranceSquared))
-            {
-                if (lowerVertexIndex > vertexGroup[lowerVertexIndex])
-                {
-                    lowerVertexIndex = vertexGroup[lowerVertexIndex];
-                }
-
-                EA_ASSERT(lowerVertexIndex == vertexGroup[lowerVertexIndex]);
-                vertexGroup[higherVertexIndex] = lowerVertexIndex;
-                break;
-            }
-        }
+        const uint32_t vertexIndex = context.records[recordIndex].vertexIndex;
+        vertexGroup[vertexIndex] = FindLowestMergeCandidate(context, vertexIndex, false);
     }
 }
 
+} // namespace
+
 
-void VertexMerger::CompareEntryAgainstCell(
-    IDList &vertexGroup,
-    const detail::SpatialMap &spatialMap,
-    const VertexList &vertices,
-    const uint32_t x,
-    const uint32_t y,
-    const uint32_t z,
-    const uint32_t comparisonEntry,
-    const rwpmath::VecFloat & toleranceSquared)
+bool VertexMerger::MergeVertexGroups(
+    IDList & vertexGroup,
+    EA::Allocator::ICoreAllocator & allocator,
+    const AABBoxType & aabbox,
+    const rwpmath::VecFloat & vertexMergeDistanceTolerance,
+    const VertexList & vertices,
+    detail::IParallelDispatcher * dispatcher)
 {
-    // Get the start and end entries for the cell
-    const uint32_t startEntry = spatialMap.GetFirstEntryInCell(x, y, z);
-    const uint32_t endEntry = spatialMap.GetFirstEntryInNextCell(x, y, z);
+    const uint32_t numVertices(vertices.size());
+    EA_ASSERT_MSG(vertexGroup.size() == numVertices, "vertexGroup should have an entry for each vertex");
 
-    // Check for an empty cell
-    if (startEntry == endEntry)
+    // Vertices only merge if they are strictly closer than the tolerance
+    const float tolerance = static_cast<float>(vertexMergeDistanceTolerance);
+    if (numVertices == 0 || !(tolerance > 0.0f))
     {
-        return;
+        return true;
     }
 
-    // Find the first entry with an index higher than the comparison vertex in the cell
-    uint32_t higherEntry = spatialMap.FindHigherIndexEntry(
-        x, y, z,
-        comparisonEntry);
-
-    // Merge the comparison entry with lower cell entries
-    MergeEntryWithLowerEntries(
-        vertexGroup,
-        spatialMap,
-        comparisonEntry,
-        startEntry,
-        higherEntry,
-        vertices,
-        toleranceSquared);
-
-    // Merge the comparison entry with greater cell entries
-    bool merged = MergeEntryWithHigherEntries(
-        vertexGroup,
-        spatialMap,
-        comparisonEntry,
-        higherEntry,
-        endEntry,
-        vertices,
-        toleranceSquared);
-
-    // If a merge has taken place with the higher entries then all
-    // higher entries need to be re-merged
-    if (merged)
+    // The cells are at least twice the tolerance in size, and large enough for the cell coordinates of the whole
+    // bbox to fit in 21 bits. The search distance is slightly more than the tolerance, so the search range of a
+    // vertex near the middle of a cell can reach into the cells on both sides of it, which is three cells along
+    // each axis. FindLowestMergeCandidate visits every cell from the low to the high end of the range.
+    const rwpmath::Vector3 boxsize(aabbox.Max() - aabbox.Min());
+    float maxExtent = static_cast<float>(boxsize.GetX());
+    if (static_cast<float>(boxsize.GetY()) > maxExtent)
     {
-        MergeHigherRangeOfEntries(
-            vertexGroup,
-            spatialMap,
-            higherEntry,
-            endEntry,
-            vertices,
-            toleranceSquared);
+        maxExtent = static_cast<float>(boxsize.GetY());
     }
-}
-
-
-bool VertexMerger::MergeEntryWithHigherEntries(
-    IDList & vertexGroup,
-    const detail::SpatialMap &spatialMap,
-    const uint32_t comparisonEntry,
-    const uint32_t startEntry,
-    const uint32_t endEntry,
-    const VertexList &vertices,
-    const rwpmath::VecFloat & toleranceSquared)
-{
-    uint32_t comparisonVertexIndex = spatialMap.GetEntry(comparisonEntry);
-    const VectorType & comparisonVertex = vertices[comparisonVertexIndex];
-
-    // Translate the comparison vertex index to its merged index.
-    if (comparisonVertexIndex > vertexGroup[comparisonVertexIndex])
+    if (static_cast<float>(boxsize.GetZ()) > maxExtent)
     {
-        comparisonVertexIndex = vertexGroup[comparisonVertexIndex];
+        maxExtent = static_cast<float>(boxsize.GetZ());
     }
 
-    bool merged = false;
-
-    // Compare the comparison vertex against those with a higher index
-    // if they have not already been merged to a vertex with a lower index.
-    for (uint32_t entry = startEntry ; entry < endEntry ; ++entry)
+    float cellSize = 2.0f * tolerance;
+    if (maxExtent / static_cast<float>(MAX_CELL_COORDINATE) > cellSize)
     {
-        uint32_t entryIndex = spatialMap.GetEntry(entry);
+        cellSize = maxExtent / static_cast<float>(MAX_CELL_COORDINATE);
+    }
 
-        // Check the entry has not already been merged to a vertex with a lower index
-        if (vertexGroup[entryIndex] > comparisonVertexIndex)
+    // NOTE: This uses MEM_TEMP, the temporary heap
+    CellRecord *const records = static_cast<CellRecord *>(
+        allocator.Alloc(numVertices * sizeof(CellRecord), "VertexMergerCellRecords", EA::Allocator::MEM_TEMP, 4));
+    CellRecord *const scratch = static_cast<CellRecord *>(
+        allocator.Alloc(numVertices * sizeof(CellRecord), "VertexMergerCellRecordsScratch", EA::Allocator::MEM_TEMP, 4));
+    if (!records || !scratch)
+    {
+        if (scratch)
         {
-            if (rwpmath::MagnitudeSquared(rwpmath::Vector3(comparisonVertex - vertices[entryIndex])) < (toleranceSquared))
-            {
-                vertexGroup[entryIndex] = comparisonVertexIndex;
-                merged = true;
-            }
+            allocator.Free(scratch);
+        }
+        if (records)
+        {
+            allocator.Free(records);
         }
+        return false;
     }
 
-    return merged;
-}
-
+    MergeContext context;
+    context.vertexGroup = &vertexGroup;
+    context.vertices = &vertices;
+    context.records = records;
+    context.numRecords = numVertices;
+    context.cellBase = rwpmath::Vector3(aabbox.Min());
+    context.cellScale = 1.0f / cellSize;
+    // Slightly more than the tolerance, so rounding cannot miss a cell, but less than a cell size, so the
+    // search covers at most three cells along each axis
+    context.searchDistance = tolerance * 1.01f;
+    context.toleranceSquared = vertexMergeDistanceTolerance * vertexMergeDistanceTolerance;
+
+    // Key each vertex on the Morton code of its cell
+    for (uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex)
+    {
+        const rwpmath::Vector3 offset(rwpmath::Vector3(vertices[vertexIndex]) - context.cellBase);
+        const uint64_t key = ComputeMortonCode(
+            CellCoordinate(static_cast<float>(offset.GetX()), context.cellScale),
+            CellCoordinate(static_cast<float>(offset.GetY()), context.cellScale),
+            CellCoordinate(static_cast<float>(offset.GetZ()), context.cellScale));
+
+        records[vertexIndex].keyLow = static_cast<uint32_t>(key);
+        records[vertexIndex].keyHigh = static_cast<uint32_t>(key >> 32);
+        records[vertexIndex].vertexIndex = vertexIndex;
+    }
 
-void VertexMerger::MergeEntryWithLowerEntries(
-    IDList &vertexGroup,
-    const detail::SpatialMap &spatialMap,
-    const uint32_t comparisonEntry,
-    const uint32_t startEntry,
-    const uint32_t endEntry,
-    const VertexList &vertices,
-    const rwpmath::VecFloat & toleranceSquared)
-{
-    const uint32_t comparisonVertexIndex = spatialMap.GetEntry(comparisonEntry);
-    const VectorType & comparisonVertex = vertices[comparisonVertexIndex];
+    // Sort on the Morton code. The sorts are stable so the vertices of each cell remain in index order.
+    detail::RadixSort::Sort(records, scratch, numVertices, CellRecordLowKey());
+    detail::RadixSort::Sort(records, scratch, numVertices, CellRecordHighKey());
 
-    uint32_t currentEntry = startEntry;
+    // Find the lowest indexed vertex within the tolerance of each vertex, in parallel
+    detail::IParallelDispatcher::Run(dispatcher, FindMergeCandidatesInRange, &context, numVertices, FINDCANDIDATES_GRAINSIZE);
 
-    // While there are entries to compare
-    while ((currentEntry < endEntry))
+    // Merge the vertices in index order. A vertex whose lowest candidate has itself been merged
+    // is searched again for the lowest candidate which remains, which is rare.
+    for (uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex)
     {
-        // Get the index
-        uint32_t entryIndex = spatialMap.GetEntry(currentEntry);
-
-        // Check the merge distance
-        if (rwpmath::MagnitudeSquared(rwpmath::Vector3(comparisonVertex - vertices[entryIndex])) < (toleranceSquared))
+        const uint32_t candidateIndex = vertexGroup[vertexIndex];
+        if (candidateIndex != vertexIndex && vertexGroup[candidateIndex] != candidateIndex)
         {
-            if (entryIndex > vertexGroup[entryIndex])
-            {
-                entryIndex = vertexGroup[entryIndex];
-            }
-
-            EA_ASSERT(entryIndex == vertexGroup[entryIndex]);
-
-            // If the vertex has not already been merged to a lower index
-            if (vertexGroup[comparisonVertexIndex] > entryIndex)
-            {
-                vertexGroup[comparisonVertexIndex] = entryIndex;
-                return;
-            }
+            vertexGroup[vertexIndex] = FindLowestMergeCandidate(context, vertexIndex, true);
         }
-
-        // Advance the lower entry
-        ++currentEntry;
     }
-}
-
 
-void VertexMerger::MergeHigherRangeOfEntries(
-    IDList & vertexGroup,
-    const detail::SpatialMap &spatialMap,
-    const uint32_t startEntry,
-    const uint32_t endEntry,
-    const VertexList &vertices,
-    const rwpmath::VecFloat & toleranceSquared)
-{
-    // Compare all pairs of entries with indices higher than the comparison vertex
-    for (uint32_t higherEntry = startEntry ; higherEntry < endEntry ; ++higherEntry)
-    {
-        uint32_t higherVertexIndex = spatialMap.GetEntry(higherEntry);
-        const VectorType higherVertex = vertices[higherVertexIndex];
+    allocator.Free(scratch);
+    allocator.Free(records);
 
-        // Compare the current higherVertex with all other vertices in its cell
-        for (uint32_t lowerEntry = startEntry ; lowerEntry < higherEntry ; ++lowerEntry)
-        {
-            uint32_t lowerVertexIndex = spatialMap.GetEntry(lowerEntry);
-            if (rwpmath::MagnitudeSquared(rwpmath::Vector3(higherVertex - vertices[lowerVertexIndex])) < (toleranceSquared))
-            {
-                if (lowerVertexIndex > vertexGroup[lowerVertexIndex])
-                {
-                    lowerVertexIndex = vertexGroup[lowerVertexIndex];
-                }
+    // return success
+    return true;
+}
 
-                EA_ASSERT(lowerVertexIndex == vertexGroup[lowerVertexIndex]);
 
-                // If the vertex has not already been merged to a lower index
-                if (vertexGroup[higherVertexIndex] > lowerVertexIndex)
-                {
-                    vertexGroup[higherVertexIndex] = lowerVertexIndex;
-                    break;
-                }
-            }
-        }
-    }
+uint32_t VertexMerger::GetMergeVertexGroupsWorkspaceSize(
+    const uint32_t numVertices)
+{
+    // The cell records and the scratch records through which they are radix sorted
+    return 2u * numVertices * static_cast<uint32_t>(sizeof(CellRecord));
 }
 
 
@@ -744,5 +370,3 @@ void VertexMerger::UpdateTriangleVertexIndices(
 
 
 #endif // !defined EA_PLATFORM_PS3_SPU
-
-
@@ -254,6 +254,22 @@ KDTreeMappedArray::UpdateThis(void)
 
 }
 
+#if RW_COLLISION_DETAIL_QUERY_STATS
+
+/**
+\internal Adds the KDTree branch nodes processed by a spatial map query since the last call to the counters
+of a line or bbox query.
+*/
+template <class MAPQUERY>
+static void
+AddKDTreeNodesVisited(QueryCounters &queryCounters, MAPQUERY &mapQuery)
+{
+    queryCounters.m_counts[QueryCounters::KDTREE_NODES] += mapQuery.GetNumNodesVisited();
+    mapQuery.ResetNumNodesVisited();
+}
+
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+
 // Disable "assignment within conditional" warning, as it is used intentionally below.
 #if defined(_MSC_VER)
 #pragma warning(push)
@@ -288,8 +304,8 @@ KDTreeMappedArray::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
         lineQuery->m_curSpatialMapQuery = (void*)mapQuery;
     }
 
-    // Far clip val might have been set by another volume hit
-    if (lineQuery->m_resultsSet != VolumeLineQuery::ALLLINEINTERSECTIONS)
+    // Far clip val might have been set by another volume hit, or by the visitor of VisitIntersections
+    if (lineQuery->m_endClipVal < 1.0f)
     {
         mapQuery->ClipEnd(lineQuery->m_endClipVal);
     }
@@ -298,6 +314,7 @@ KDTreeMappedArray::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
     uint32_t index = rwcKDTREE_INVALID_INDEX;
     while ( (lineQuery->m_resCount < lineQuery->m_resMax) && mapQuery->GetNext(index))
     {
+        rwcQUERYSTATS(++lineQuery->m_counters.m_counts[QueryCounters::CHILD_VOLUMES]);
         const Volume& vol = m_volumes[index];
         AABBox bbox;
 
@@ -317,11 +334,14 @@ KDTreeMappedArray::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
             // Add volume to the stack
             if (!lineQuery->AddVolumeRef(&vol, tm, tag, static_cast<uint8_t>(numTagBits)))
             {
+                rwcQUERYSTATS(AddKDTreeNodesVisited(lineQuery->m_counters, *mapQuery));
                 return FALSE; // Either primitive or Stack buffer runs out of space
             }
         }
     }
 
+    rwcQUERYSTATS(AddKDTreeNodesVisited(lineQuery->m_counters, *mapQuery));
+
     // Return false if we failed to complete query due to lack of buffer space (will resume later).
     return static_cast<RwpBool>(lineQuery->m_resCount < lineQuery->m_resMax);
 }
@@ -367,9 +387,11 @@ KDTreeMappedArray::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
         if (FALSE == mapQuery->GetNext(index))
         {
             // No more entries in the kdtree to process so return we're complete
+            rwcQUERYSTATS(AddKDTreeNodesVisited(bboxQuery->m_counters, *mapQuery));
             return TRUE;
         }
 
+        rwcQUERYSTATS(++bboxQuery->m_counters.m_counts[QueryCounters::CHILD_VOLUMES]);
         Volume *volume = &m_volumes[index];
 
         // See if the child volume is enabled
@@ -390,12 +412,15 @@ KDTreeMappedArray::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
                 //Add volume to the stack
                 if (!bboxQuery->AddVolumeRef(volume, tm, bb, tag, static_cast<uint8_t>(numTagBits)))
                 {
+                    rwcQUERYSTATS(AddKDTreeNodesVisited(bboxQuery->m_counters, *mapQuery));
                     return FALSE; // Either primitive or Stack buffer runs out of space
                 }
             }
         }
     }
 
+    rwcQUERYSTATS(AddKDTreeNodesVisited(bboxQuery->m_counters, *mapQuery));
+
     // Flag the bboxQuery to say why we're returning before completion. Note that because we're unable to
     // detect what the next entry in the kdtree is (primitive or aggregate) and we can't rewind a kdtree query
     // we have to early out as soon as we run out of space in either of the buffers
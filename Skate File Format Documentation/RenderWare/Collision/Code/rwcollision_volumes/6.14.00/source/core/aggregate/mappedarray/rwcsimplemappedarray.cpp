@@ -205,6 +205,7 @@ SimpleMappedArray::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
     {
         //Add aggregate components to stack
         childVol = GetVolume(static_cast<uint16_t>(aggIndex));
+        rwcQUERYSTATS(++lineQuery->m_counters.m_counts[QueryCounters::CHILD_VOLUMES]);
 
         AABBox bbox;
 
@@ -261,6 +262,7 @@ SimpleMappedArray::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
     {
         //Add aggregate components to stack
         Volume *childVol = GetVolume(static_cast<uint16_t>(bboxQuery->m_aggIndex));
+        rwcQUERYSTATS(++bboxQuery->m_counters.m_counts[QueryCounters::CHILD_VOLUMES]);
 
         // See if the child volume is enabled
         if (childVol->IsEnabled())
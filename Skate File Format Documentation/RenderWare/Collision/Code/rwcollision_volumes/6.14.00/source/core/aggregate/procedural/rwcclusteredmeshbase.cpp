@@ -134,9 +134,11 @@ Gets the resource requirements of a ClusteredMesh object.
 \param  maxClusters maximum number of clusters
 \param  clusterDataSize total size of all the cluster data (not including the array of pointers)
 \param  numBranchNodes number of branch nodes in the kdtree.
-\param  maxUnits maximum number of units.  This parameter is ignored.
+\param  maxUnits maximum number of units.  This parameter is only used to size the unit bounds.
 \param  bbox region of space containing the mesh.  This parameter is ignored.
 \param  classSize size of clustered mesh.
+\param  includeKDSubTrees whether to reserve space for a KDSubTree per cluster.
+\param  unitBoundsFormat the ClusterUnitBounds::Format of the quantized unit bounds to reserve space for, if any.
 
 \return a resource descriptor for the memory requirements of the proposed ClusteredMesh object.
 */
@@ -144,11 +146,12 @@ EA::Physics::SizeAndAlignment
 ClusteredMesh::GetResourceDescriptor(uint32_t maxClusters,
                                      uint32_t clusterDataSize,
                                      uint32_t numBranchNodes,
-                                     uint32_t EAPHYSICS_ASSERTARGUMENT(maxUnits),
+                                     uint32_t maxUnits,
                                      const rw::collision::AABBox & /*(bbox*/,
                                      float /*vertexCompressionGranularity*/, // this doesn't affect the size
                                      uint32_t classSize,
-                                     RwpBool includeKDSubTrees)
+                                     RwpBool includeKDSubTrees,
+                                     uint32_t unitBoundsFormat)
 {
     EA_ASSERT_FORMATTED(maxUnits >= maxClusters, ("The max number of units %d must not be more than the max number of"
                 " clusters %d.", maxUnits, maxClusters));
@@ -166,6 +169,13 @@ ClusteredMesh::GetResourceDescriptor(uint32_t maxClusters,
     uint32_t size = EA::Physics::SizeAlign<uint32_t>(classSize, rwcCLUSTEREDMESH_ALIGNMENT);
     size += EA::Physics::SizeAlign<uint32_t>(kdtree.GetSize(), rwcCLUSTEREDMESH_ALIGNMENT);
     size += EA::Physics::SizeAlign<uint32_t>(maxClusters*sizeof(ClusteredMeshCluster*), rwcCLUSTEREDMESH_ALIGNMENT);
+    if (unitBoundsFormat != ClusterUnitBounds::FORMAT_NONE)
+    {
+        ClusterUnitBounds::ObjectDescriptor unitBoundsParams(maxClusters, maxUnits, unitBoundsFormat);
+        EA::Physics::SizeAndAlignment unitBounds = ClusterUnitBounds::GetResourceDescriptor(unitBoundsParams);
+        EA_ASSERT(unitBounds.GetAlignment() <= rwcCLUSTEREDMESH_ALIGNMENT);
+        size += EA::Physics::SizeAlign<uint32_t>(unitBounds.GetSize(), rwcCLUSTEREDMESH_ALIGNMENT);
+    }
     size += clusterDataSize;
 
     return EA::Physics::SizeAndAlignment(size, rwcCLUSTEREDMESH_ALIGNMENT);
@@ -185,6 +195,9 @@ which the resource was allocated.
 \param  maxUnits maximum number of units (triangle, quad, trilist, etc) this clustered mesh can hold.
 \param  bbox region of space containing the mesh.  This is used to initialize the spatial map.
 \param  classSize size of clustered mesh
+\param  includeKDSubTrees whether to reserve space for a KDSubTree per cluster.
+\param  unitBoundsFormat the ClusterUnitBounds::Format of the quantized unit bounds to reserve space for, if any.
+        The bounds are filled in by CreateClusterUnitBounds once all the clusters have been added.
 
 \return The new ClusteredMesh.
 */
@@ -197,7 +210,8 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource,
                           const rw::collision::AABBox &bbox,
                           float vertexCompressionGranularity,
                           uint32_t classSize,
-                          RwpBool includeKDSubTrees)
+                          RwpBool includeKDSubTrees,
+                          uint32_t unitBoundsFormat)
 {
     rwcASSERTALIGN(resource.GetMemory(), rwcCLUSTEREDMESH_ALIGNMENT);
     EA_ASSERT(classSize >= sizeof(ClusteredMesh));
@@ -229,6 +243,17 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource,
     // round up the heap pointer to correct alignment
     heap.SubAlloc(0, rwcCLUSTEREDMESH_ALIGNMENT);
 
+    // allocate unit bounds, ahead of the clusters so that the cluster data stays at the end of the block
+    mesh->mUnitBounds = NULL;
+    if (unitBoundsFormat != ClusterUnitBounds::FORMAT_NONE)
+    {
+        ClusterUnitBounds::ObjectDescriptor unitBoundsParams(maxClusters, maxUnits, unitBoundsFormat);
+        EA::Physics::SizeAndAlignment unitBounds = ClusterUnitBounds::GetResourceDescriptor(unitBoundsParams);
+        mesh->mUnitBounds = ClusterUnitBounds::Initialize(
+            EA::Physics::MemoryPtr(heap.SubAlloc(unitBounds.GetSize(), unitBounds.GetAlignment())), unitBoundsParams);
+        heap.SubAlloc(0, rwcCLUSTEREDMESH_ALIGNMENT);
+    }
+
     // set offset to first cluster from mCluster array (prior to version 3 this was relative to "this")
     uintptr_t offset = heap.mem - reinterpret_cast<uintptr_t>(mesh->mCluster);
     EA_ASSERT(offset < UINT32_MAX);
@@ -241,7 +266,8 @@ ClusteredMesh::Initialize(const EA::Physics::MemoryPtr& resource,
     mesh->mSizeOfThis = ClusteredMesh::GetResourceDescriptor(maxClusters, clusterDataSize, numBranchNodes,
                                                              maxUnits, bbox,
                                                              vertexCompressionGranularity,
-                                                             classSize, includeKDSubTrees).GetSize();
+                                                             classSize, includeKDSubTrees,
+                                                             unitBoundsFormat).GetSize();
 
     // assert that the memory allocated from the heap is not greater than the size allowed.
     EA_ASSERT(mesh->mSizeOfThis >= heap.mem - reinterpret_cast<uintptr_t>(mesh));
@@ -308,6 +334,17 @@ ClusteredMesh::IsValid() const
             ok = static_cast<RwpBool>(ok && cluster.unitDataStart == cluster.normalStart + cluster.normalCount);
         }
         else
+        if ( cluster.compressionMode == ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED ||
+             cluster.compressionMode == ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED )
+        {
+            const uint32_t vertexSize = (cluster.compressionMode == ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED) ?
+                sizeof(ClusteredMeshCluster::Vertex8) : sizeof(uint32_t);
+            uint32_t bytes = sizeof(ClusteredMeshCluster::VertexHeader) + vertexSize * cluster.vertexCount;
+            bytes = EA::Physics::SizeAlign<uint32_t>( bytes, rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT );
+            ok = static_cast<RwpBool>(ok && cluster.normalStart == static_cast<uint16_t>( bytes / rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT ));
+            ok = static_cast<RwpBool>(ok && cluster.unitDataStart == cluster.normalStart + cluster.normalCount);
+        }
+        else
         if ( cluster.compressionMode == ClusteredMeshCluster::VERTICES_32BIT_COMPRESSED )
         {
             uint32_t bytes = sizeof(ClusteredMeshCluster::Vertex32) * cluster.vertexCount;
@@ -457,6 +494,13 @@ ClusteredMesh::IsValid() const
         }
     }
 
+    if (mUnitBounds)
+    {
+        ok = static_cast<RwpBool>(ok && mUnitBounds->IsValid());
+        ok = static_cast<RwpBool>(ok && mUnitBounds->GetNumClusters() == mNumClusters);
+        ok = static_cast<RwpBool>(ok && mUnitBounds->GetNumUnits() == mNumUnits);
+    }
+
     return ok;
 }
 
@@ -761,6 +805,8 @@ ClusteredMesh::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
     uint32_t unitOffset = 0;
     uint32_t unitCount = 0;
     uint32_t numTrisLeftInUnit = 0;
+    rwcQUERYSTATS(QueryCounters counters);
+    rwcQUERYSTATS(counters.Reset());
 
     // Map line into spatial map space
     const Matrix44Affine invTm(InverseOfMatrixWithOrthonormal3x3(*tm));
@@ -783,6 +829,7 @@ ClusteredMesh::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
         if (!mapQuery->GetNext(entry, unitCount))
         {
             // No more results
+            rwcQUERYSTATS(AddClusterQueryCounters(lineQuery->m_counters, counters, *mapQuery));
             return TRUE;
         }
     }
@@ -794,8 +841,8 @@ ClusteredMesh::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
         numTrisLeftInUnit = lineQuery->m_clusteredMeshRestartData.numTrisLeftInUnit;
     }
 
-    // Far clip val might have been set by another volume hit
-    if (lineQuery->m_resultsSet != VolumeLineQuery::ALLLINEINTERSECTIONS)
+    // Far clip val might have been set by another volume hit, or by the visitor of VisitIntersections
+    if (lineQuery->m_endClipVal < 1.0f)
     {
         mapQuery->ClipEnd(lineQuery->m_endClipVal);
     }
@@ -809,17 +856,42 @@ ClusteredMesh::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
     //3) there are more results from the kd tree query
     do
     {
+        rwcQUERYSTATS(++counters.m_counts[QueryCounters::KDTREE_LEAVES]);
         clusterIndex = entry >> shift;
         unitOffset = entry & mask;
 
 nextCluster:
         ClusterTriangleIterator<> cti(GetCluster(clusterIndex), mClusterParams, unitOffset, unitCount, numTrisLeftInUnit);
         EA_ASSERT(cti.IsValid());
+        rwcQUERYSTATS(++counters.m_counts[QueryCounters::CLUSTERS]);
+
+#if RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
+        // One bit per unit of the leaf, set if the unit may be hit. The last unit of the cluster is always set
+        // so that leaves which span clusters still reach the cross cluster workaround below.
+        uint32_t unitMask = ~0u;
+        if (mUnitBounds)
+        {
+            unitMask = mUnitBounds->GetLineOverlapMask(clusterIndex, mUnitBounds->FindUnit(clusterIndex, unitOffset),
+                unitCount, localLineStart, localLineDelta, lineQuery->m_endClipVal, lineQuery->m_fatness);
+        }
+#endif // RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
 
         for (; !cti.AtEnd(); cti.Next())
         {
+#if RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
+            // Step over the units whose quantized bounds miss the query without decoding their vertices
+            const uint32_t unitOrdinal = unitCount - cti.GetRemainingUnits();
+            if (unitOrdinal < ClusterUnitBounds::MAX_MASK_UNITS && !(unitMask & (1u << unitOrdinal)))
+            {
+                cti.SkipRemainingTrianglesInUnit();
+                continue;
+            }
+#endif // RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
+
             Vector3 v0, v1, v2;
             cti.GetVertices(v0, v1, v2);
+            rwcQUERYSTATS(++counters.m_counts[QueryCounters::TRIANGLES]);
+            rwcQUERYSTATS(counters.m_counts[QueryCounters::UNITS] += (cti.GetNumTrianglesLeftInCurrentUnit() <= 1) ? 1u : 0u);
 
             RwpBool hit = FALSE;
             VolumeLineSegIntersectResult tmpRes;
@@ -843,6 +915,7 @@ nextCluster:
                     lineQuery->m_clusteredMeshRestartData.unitCount = cti.GetRemainingUnits();
                     lineQuery->m_clusteredMeshRestartData.numTrisLeftInUnit = cti.GetNumTrianglesLeftInCurrentUnit();
 
+                    rwcQUERYSTATS(AddClusterQueryCounters(lineQuery->m_counters, counters, *mapQuery));
                     return FALSE;
                 }
 
@@ -917,6 +990,7 @@ nextCluster:
     }
     while (mapQuery->GetNext(entry, unitCount));
 
+    rwcQUERYSTATS(AddClusterQueryCounters(lineQuery->m_counters, counters, *mapQuery));
     return TRUE;
 }
 
@@ -942,6 +1016,8 @@ ClusteredMesh::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
     uint32_t unitOffset = 0;
     uint32_t unitCount = 0;
     uint32_t numTrisLeftInUnit = 0;
+    rwcQUERYSTATS(QueryCounters counters);
+    rwcQUERYSTATS(counters.Reset());
 
     KDTree::BBoxQuery *mapQuery = reinterpret_cast<KDTree::BBoxQuery*>(bboxQuery->m_curSpatialMapQuery);
 
@@ -979,6 +1055,7 @@ ClusteredMesh::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
         if (!mapQuery->GetNext(entry, unitCount))
         {
             // No more results
+            rwcQUERYSTATS(AddClusterQueryCounters(bboxQuery->m_counters, counters, *mapQuery));
             return TRUE;
         }
     }
@@ -999,6 +1076,7 @@ ClusteredMesh::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
     //3) there are more results from the kd tree query
     do
     {
+        rwcQUERYSTATS(++counters.m_counts[QueryCounters::KDTREE_LEAVES]);
         clusterIndex = entry >> shift;
         unitOffset = entry & mask;
 
@@ -1006,11 +1084,35 @@ nextCluster:
 
         ClusterTriangleIterator<> cti(GetCluster(clusterIndex), mClusterParams, unitOffset, unitCount, numTrisLeftInUnit);
         EA_ASSERT(cti.IsValid());
+        rwcQUERYSTATS(++counters.m_counts[QueryCounters::CLUSTERS]);
+
+#if RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
+        // One bit per unit of the leaf, set if the unit may overlap. The last unit of the cluster is always set
+        // so that leaves which span clusters still reach the cross cluster workaround below.
+        uint32_t unitMask = ~0u;
+        if (mUnitBounds)
+        {
+            unitMask = mUnitBounds->GetBBoxOverlapMask(clusterIndex, mUnitBounds->FindUnit(clusterIndex, unitOffset),
+                unitCount, mapQuery->GetBBox());
+        }
+#endif // RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
 
         for (; !cti.AtEnd(); cti.Next())
         {
+#if RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
+            // Step over the units whose quantized bounds miss the query without decoding their vertices
+            const uint32_t unitOrdinal = unitCount - cti.GetRemainingUnits();
+            if (unitOrdinal < ClusterUnitBounds::MAX_MASK_UNITS && !(unitMask & (1u << unitOrdinal)))
+            {
+                cti.SkipRemainingTrianglesInUnit();
+                continue;
+            }
+#endif // RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
+
             Vector3 v0, v1, v2;
             cti.GetVertices(v0, v1, v2);
+            rwcQUERYSTATS(++counters.m_counts[QueryCounters::TRIANGLES]);
+            rwcQUERYSTATS(counters.m_counts[QueryCounters::UNITS] += (cti.GetNumTrianglesLeftInCurrentUnit() <= 1) ? 1u : 0u);
 
             // Calculate the triangles aabbox
             const Vector3 bboxMin(Min(Min(v0, v1), v2));
@@ -1039,6 +1141,7 @@ nextCluster:
                     bboxQuery->m_clusteredMeshRestartData.unitCount = cti.GetRemainingUnits();
                     bboxQuery->m_clusteredMeshRestartData.numTrisLeftInUnit = cti.GetNumTrianglesLeftInCurrentUnit();
 
+                    rwcQUERYSTATS(AddClusterQueryCounters(bboxQuery->m_counters, counters, *mapQuery));
                     return FALSE;
                 }
 
@@ -1096,6 +1199,7 @@ nextCluster:
     }
     while (mapQuery->GetNext(entry, unitCount));
 
+    rwcQUERYSTATS(AddClusterQueryCounters(bboxQuery->m_counters, counters, *mapQuery));
     return TRUE;
 }
 
@@ -1128,13 +1232,24 @@ for the number of clusters and the maximum number of leafbranchnodes in a cluste
 EA::Physics::SizeAndAlignment
 GetKDSubTreeWorkSpaceResourceDescriptor(rw::collision::ClusteredMesh &clusteredMesh)
 {
-    uint32_t size;
-    uint32_t numBranchnodes; 
-
     //Space for Stack - Space for NodeData - sufficient for number of clusters+maxnumber of nodes containing leaves in a cluster... 
     //                - However, this would require looping through the tree, so for now just using the number of branchnodes in original tree
-    numBranchnodes = clusteredMesh.GetKDTreeBase()->GetNumBranchNodes();
-    size = (numBranchnodes+1)*sizeof(NodeData);
+    return GetKDSubTreeWorkSpaceResourceDescriptor(clusteredMesh.GetKDTreeBase()->GetNumBranchNodes());
+}
+
+/**
+\brief
+Returns a EA::Physics::SizeAndAlignment for the 'Workspace' needed to generate the KDSubTree array of a
+ClusteredMesh whose KDTree has the given number of branch nodes, before the ClusteredMesh is built.
+
+\param numBranchNodes The number of branch nodes of the KDTree of the ClusteredMesh
+
+\return EA::Physics::SizeAndAlignment for KDSubTree array
+*/
+EA::Physics::SizeAndAlignment
+GetKDSubTreeWorkSpaceResourceDescriptor(const uint32_t numBranchNodes)
+{
+    const uint32_t size = (numBranchNodes+1)*sizeof(NodeData);
 
     //Return EA::Physics::SizeAndAlignment
     return EA::Physics::SizeAndAlignment(size,16);
@@ -223,12 +223,15 @@ ClusteredMeshCluster::UnitGetOverlappingGPInstances(uint32_t offset, const AABBo
 /**
 \brief Set the vertex offset.
 
-The offset is only relevant to clusters with a vertex compression mode of VERTICES_16BIT_COMPRESSED.
+The offset is only relevant to clusters with a vertex compression mode of VERTICES_16BIT_COMPRESSED,
+VERTICES_8BIT_COMPRESSED or VERTICES_10BIT_COMPRESSED, and the granularity shift only to the last two.
 
 \param clusterOffset                The vertex offset.
+\param granularityShift             The power of two by which the cluster granularity exceeds the mesh granularity.
 */
 void
-ClusteredMeshCluster::SetVertexOffset(const rw::collision::ClusteredMeshCluster::Vertex32 clusterOffset)
+ClusteredMeshCluster::SetVertexOffset(const rw::collision::ClusteredMeshCluster::Vertex32 clusterOffset,
+                                      const uint32_t granularityShift)
 {
     if (compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_16BIT_COMPRESSED)
     {
@@ -237,6 +240,15 @@ ClusteredMeshCluster::SetVertexOffset(const rw::collision::ClusteredMeshCluster:
         rw::collision::ClusteredMeshCluster::Vertex32 *offsetData = const_cast<rw::collision::ClusteredMeshCluster::Vertex32 *>(vdUnion.m_asVertex32Ptr);
         offsetData[0] = clusterOffset;
     }
+    else if ((compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED) ||
+             (compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED))
+    {
+        CompressedVertexDataUnion vdUnion;
+        vdUnion.m_as_rwpmathVector3Ptr = vertexArray;
+        rw::collision::ClusteredMeshCluster::VertexHeader *header = const_cast<rw::collision::ClusteredMeshCluster::VertexHeader *>(vdUnion.m_asVertexHeaderPtr);
+        header->offset = clusterOffset;
+        header->granularityShift = granularityShift;
+    }
 }
 
 
@@ -281,6 +293,47 @@ ClusteredMeshCluster::SetVertex(rwpmath::Vector3::InParam v,
         EA_ASSERT_MSG(IsSimilar(v, c, 2.0f*vertexCompressionGranularity), ("Bad vertex compression."));
 #endif
     }
+    else if ((compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED) ||
+             (compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED))
+    {
+        // Get the vertex header
+        CompressedVertexDataUnion vdUnion;
+        vdUnion.m_as_rwpmathVector3Ptr = vertexArray;
+        const rw::collision::ClusteredMeshCluster::VertexHeader *header = vdUnion.m_asVertexHeaderPtr;
+        const uint32_t shift = header->granularityShift;
+        const int32_t rounding = (shift > 0) ? (1 << (shift - 1)) : 0;
+
+        // Round the granularised vertex, relative to the offset, to the cluster granularity
+        const uint32_t x = static_cast<uint32_t>((int32_t)( v.GetX() / vertexCompressionGranularity ) - header->offset.x + rounding) >> shift;
+        const uint32_t y = static_cast<uint32_t>((int32_t)( v.GetY() / vertexCompressionGranularity ) - header->offset.y + rounding) >> shift;
+        const uint32_t z = static_cast<uint32_t>((int32_t)( v.GetZ() / vertexCompressionGranularity ) - header->offset.z + rounding) >> shift;
+
+        if (compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED)
+        {
+            EA_ASSERT_MSG((x <= 0xFF) && (y <= 0xFF) && (z <= 0xFF), ("Vertex out of range of 8-bit compression."));
+
+            // Advance the pointer past the header to the first free vertex
+            rw::collision::ClusteredMeshCluster::Vertex8 *compressedVertexData =
+                reinterpret_cast<rw::collision::ClusteredMeshCluster::Vertex8 *>(const_cast<rw::collision::ClusteredMeshCluster::VertexHeader *>(header) + 1);
+            compressedVertexData += vertexCount;
+
+            // Write the compressed vertex
+            compressedVertexData->x = static_cast<uint8_t>(x);
+            compressedVertexData->y = static_cast<uint8_t>(y);
+            compressedVertexData->z = static_cast<uint8_t>(z);
+        }
+        else
+        {
+            EA_ASSERT_MSG((x <= VERTEX10_MASK) && (y <= VERTEX10_MASK) && (z <= VERTEX10_MASK), ("Vertex out of range of 10-bit compression."));
+
+            // Advance the pointer past the header to the first free vertex
+            uint32_t *compressedVertexData = const_cast<uint32_t *>(vdUnion.m_asUInt32Ptr) + 4;
+            compressedVertexData += vertexCount;
+
+            // Write the packed compressed vertex
+            *compressedVertexData = x | (y << VERTEX10_BITS) | (z << (2u * VERTEX10_BITS));
+        }
+    }
     else if (compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_32BIT_COMPRESSED )
     {
         // Get the start of the vertex array
@@ -596,6 +649,22 @@ ClusteredMeshCluster::GetVertexDataSize(const uint16_t vertexCount,
         bytes = EA::Physics::SizeAlign<uint32_t>( bytes, rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT );
         return static_cast<uint16_t>(bytes);
     }
+    else if ( vertexCompressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED )
+    {
+        // Size = the vertex header + the vertices
+        uint32_t bytes = sizeof(rw::collision::ClusteredMeshCluster::VertexHeader) +
+            ( sizeof(rw::collision::ClusteredMeshCluster::Vertex8) * vertexCount );
+        bytes = EA::Physics::SizeAlign<uint32_t>( bytes, rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT );
+        return static_cast<uint16_t>(bytes);
+    }
+    else if ( vertexCompressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED )
+    {
+        // Size = the vertex header + the packed vertices
+        uint32_t bytes = sizeof(rw::collision::ClusteredMeshCluster::VertexHeader) +
+            ( sizeof(uint32_t) * vertexCount );
+        bytes = EA::Physics::SizeAlign<uint32_t>( bytes, rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT );
+        return static_cast<uint16_t>(bytes);
+    }
     else if ( vertexCompressionMode == rw::collision::ClusteredMeshCluster::VERTICES_32BIT_COMPRESSED )
     {
         // Size = the vertices
@@ -753,6 +822,13 @@ ClusteredMeshCluster::ClusteredMeshCluster(const ClusterConstructionParameters &
         normalStart = static_cast<uint16_t>( bytes / rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT );
         unitDataStart = (uint16_t) (normalStart + normalCount);
     }
+    else if ( compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED ||
+              compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED )
+    {
+        uint32_t bytes = GetVertexDataSize(parameters.mVertexCount, compressionMode);
+        normalStart = static_cast<uint16_t>( bytes / rwcCLUSTEREDMESHCLUSTER_VERTEXDATA_ALIGNMENT );
+        unitDataStart = (uint16_t) (normalStart + normalCount);
+    }
     else if ( compressionMode == rw::collision::ClusteredMeshCluster::VERTICES_32BIT_COMPRESSED )
     {
         uint32_t bytes = sizeof(rw::collision::ClusteredMeshCluster::Vertex32) * parameters.mVertexCount;
@@ -0,0 +1,243 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwcclusteredmeshdistancequery.cpp
+
+ Purpose: Closest point queries against a ClusteredMesh.
+
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include <EAAssert/eaassert.h>
+
+#include "rw/collision/distancequery.h"
+
+#include "rw/collision/clusteredmeshbase.h"
+#include "rw/collision/clusteredmeshcluster.h"
+#include "rw/collision/clusteredmeshbase_methods.h"
+#include "rw/collision/clusteredmeshcluster_methods.h"
+#include "rw/collision/clustertriangleiterator.h"
+
+#include "rw/collision/kdtree.h"
+#include "rw/collision/kdtreedistancequery.h"
+
+using namespace rwpmath;
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\brief
+Finds the point on the mesh closest to a point, within a maximum distance.
+
+This is ClosestPointsQuery with a single result.
+
+\param result       Set to the closest point, in the query frame, when the function returns TRUE.
+\param point        The query point, in the query frame.
+\param maxDistance  Triangles further than this from the point are ignored.
+\param tm           The transform of the mesh in the query frame, or NULL.
+
+\return TRUE if a triangle lies within \a maxDistance of the point.
+
+\see ClusteredMesh::ClosestPointsQuery
+*/
+RwpBool
+ClusteredMesh::ClosestPointQuery(DistanceQueryResult &result,
+                                 rwpmath::Vector3::InParam point,
+                                 float maxDistance,
+                                 const rwpmath::Matrix44Affine *tm) const
+{
+    return ClosestPointsQuery(&result, 1u, point, maxDistance, tm) > 0u ? TRUE : FALSE;
+}
+
+
+/**
+\brief
+Finds the closest points on the nearest triangles of the mesh to a point, within a maximum distance.
+
+The KDTree is walked nearest leaf first using a KDTreeDistanceQuery. Once \a maxResults triangles have
+been found the search distance shrinks to the distance of the furthest of them, so only leaves which may
+contain a nearer triangle are visited. Each triangle is returned at most once.
+
+The query is purely geometric, the one sided flag, edge cosines and disabled vertices of the triangles
+are not considered.
+
+\param results      Array of at least \a maxResults results. Set to the closest points, in the query frame,
+                    sorted nearest first.
+\param maxResults   The number of nearest triangles to find.
+\param point        The query point, in the query frame.
+\param maxDistance  Triangles further than this from the point are ignored.
+\param tm           The transform of the mesh in the query frame, or NULL.
+
+\return The number of results, which is less than \a maxResults when fewer triangles lie within
+        \a maxDistance of the point.
+*/
+uint32_t
+ClusteredMesh::ClosestPointsQuery(DistanceQueryResult *results,
+                                  uint32_t maxResults,
+                                  rwpmath::Vector3::InParam point,
+                                  float maxDistance,
+                                  const rwpmath::Matrix44Affine *tm) const
+{
+    EA_ASSERT(results);
+    EA_ASSERT(maxResults > 0);
+
+    // Map the point into spatial map space
+    Vector3 localPoint(point);
+    if (tm)
+    {
+        localPoint = TransformPoint(point, InverseOfMatrixWithOrthonormal3x3(*tm));
+    }
+
+    const float granularityImprecision = 2.0f * mClusterParams.mVertexCompressionGranularity;
+    KDTreeDistanceQuery mapQuery(GetKDTreeBase(), localPoint, maxDistance, granularityImprecision);
+
+    const uint32_t shift = (uint32_t)(16 + (mClusterParams.mFlags & CMFLAG_20BITCLUSTERINDEX));
+    const uint32_t mask = (uint32_t)((1 << shift) - 1);
+
+    uint32_t numResults = 0;
+    uint32_t entry = 0;
+    uint32_t unitCount = 0;
+
+    while (mapQuery.GetNext(entry, unitCount))
+    {
+        uint32_t clusterIndex = entry >> shift;
+        uint32_t unitOffset = entry & mask;
+        uint32_t numTrisLeftInUnit = 0;
+
+nextCluster:
+        ClusterTriangleIterator<> cti(GetCluster(clusterIndex), mClusterParams, unitOffset, unitCount, numTrisLeftInUnit);
+        EA_ASSERT(cti.IsValid());
+
+        for (; !cti.AtEnd(); cti.Next())
+        {
+            Vector3 v0, v1, v2;
+            cti.GetVertices(v0, v1, v2);
+
+            Vector3 closestPoint;
+            const DistanceQueryResult::Feature feature = TriangleClosestPoint(closestPoint, localPoint, v0, v1, v2);
+            const float distance = Magnitude(localPoint - closestPoint);
+
+            if (distance <= mapQuery.GetMaxDistance() &&
+                (numResults < maxResults || distance < results[numResults - 1].distance))
+            {
+                // Insert into the results, which are kept sorted nearest first
+                uint32_t i = (numResults < maxResults) ? numResults++ : numResults - 1;
+                for (; i > 0 && results[i - 1].distance > distance; --i)
+                {
+                    results[i] = results[i - 1];
+                }
+
+                DistanceQueryResult &res = results[i];
+                res.position = closestPoint;
+                res.distance = distance;
+                res.feature = feature;
+                res.childIndex = GetChildIndex(
+                                     cti.GetOffset(),
+                                     cti.GetNumTrianglesLeftInCurrentUnit() - 1u,
+                                     clusterIndex);
+                res.surfaceID = cti.GetSurfaceID();
+                res.groupID = cti.GetGroupID();
+
+                const Vector3 faceNormal = Cross(v1 - v0, v2 - v0);
+                const float faceNormalLength = Magnitude(faceNormal);
+                res.normal = (faceNormalLength > 0.0f) ? faceNormal * (1.0f / faceNormalLength) : GetVector3_Zero();
+
+                // Only nearer leaves can contain a triangle closer than the furthest result
+                if (numResults == maxResults)
+                {
+                    mapQuery.ClipDistance(results[numResults - 1].distance);
+                }
+            }
+
+            // Temporary workaround in case KDTree leaf nodes span across cluster boundaries
+            if ((cti.GetNumTrianglesLeftInCurrentUnit() <= 1) &&
+                (cti.GetRemainingUnits() > 1) &&
+                (cti.GetOffset() + cti.GetUnit().GetSize() >= GetCluster(clusterIndex).unitDataSize))
+            {
+                clusterIndex++;
+                numTrisLeftInUnit = 0;
+                unitOffset = 0;
+                unitCount = cti.GetRemainingUnits()-1;
+                goto nextCluster;
+            }
+        }
+    }
+
+    if (tm)
+    {
+        // Map results back into query space
+        for (uint32_t i = 0; i < numResults; ++i)
+        {
+            results[i].position = TransformPoint(results[i].position, *tm);
+            results[i].normal = TransformVector(results[i].normal, *tm);
+        }
+    }
+
+    return numResults;
+}
+
+
+/**
+\brief
+Finds the closest point on the mesh to each of a batch of points, within a maximum distance.
+
+This is ClosestPointQuery applied to each point in turn, with the inverse of the mesh transform computed
+once for the whole batch.
+
+\param results      Array of \a numPoints results. Where no triangle lies within \a maxDistance of a point
+                    its result has distance rwpmath::MAX_FLOAT and childIndex rwcKDTREE_INVALID_INDEX.
+\param points       Array of \a numPoints query points, in the query frame.
+\param numPoints    The number of query points.
+\param maxDistance  Triangles further than this from a point are ignored.
+\param tm           The transform of the mesh in the query frame, or NULL.
+
+\return The number of points which have a triangle within \a maxDistance.
+*/
+uint32_t
+ClusteredMesh::ClosestPointQueryBatch(DistanceQueryResult *results,
+                                      const rwpmath::Vector3 *points,
+                                      uint32_t numPoints,
+                                      float maxDistance,
+                                      const rwpmath::Matrix44Affine *tm) const
+{
+    EA_ASSERT(results);
+    EA_ASSERT(points || numPoints == 0);
+
+    Matrix44Affine invTm(GetMatrix44Affine_Identity());
+    if (tm)
+    {
+        invTm = InverseOfMatrixWithOrthonormal3x3(*tm);
+    }
+
+    uint32_t numFound = 0;
+    for (uint32_t i = 0; i < numPoints; ++i)
+    {
+        const Vector3 localPoint = tm ? TransformPoint(points[i], invTm) : points[i];
+        if (ClosestPointsQuery(&results[i], 1u, localPoint, maxDistance, NULL))
+        {
+            if (tm)
+            {
+                results[i].position = TransformPoint(results[i].position, *tm);
+                results[i].normal = TransformVector(results[i].normal, *tm);
+            }
+            ++numFound;
+        }
+        else
+        {
+            results[i].distance = MAX_FLOAT;
+            results[i].childIndex = rwcKDTREE_INVALID_INDEX;
+        }
+    }
+
+    return numFound;
+}
+
+
+} // namespace collision
+} // namespace rw
@@ -0,0 +1,141 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwcclusteredmeshshapecast.cpp
+
+ Purpose: Swept shape queries against a ClusteredMesh.
+
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include <EAAssert/eaassert.h>
+
+#include "rw/collision/shapecast.h"
+
+#include "rw/collision/clusteredmeshbase.h"
+#include "rw/collision/clusteredmeshcluster.h"
+#include "rw/collision/clusteredmeshbase_methods.h"
+#include "rw/collision/clusteredmeshcluster_methods.h"
+#include "rw/collision/clustertriangleiterator.h"
+
+#include "rw/collision/kdtree.h"
+#include "rw/collision/kdtreelinequery.h"
+
+using namespace rwpmath;
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\brief
+Finds the first triangle of the mesh hit by a shape swept along \a delta.
+
+The KDTree is walked nearest leaf first with the line swept by the centre of the shape, padded by the
+bounding box of the shape, so every leaf the shape passes through is visited. Each triangle in a leaf is
+tested with TriangleShapeCast, which respects the one sided flag, edge cosines and disabled vertices of
+the triangle. Once a hit is found the rest of the line is clipped away so only nearer leaves are visited.
+
+Unlike a fat VolumeLineQuery the shape cannot pass through thin geometry however fast it moves.
+
+\param result   Set to the first contact, in the query frame, when the function returns TRUE. The childIndex
+                of the result identifies the triangle hit.
+\param shape    The shape to sweep, in the query frame.
+\param delta    The displacement of the shape over the sweep, in the query frame. Must not be zero.
+\param tm       The transform of the mesh in the query frame, or NULL.
+
+\return TRUE if the shape hits the mesh during the sweep.
+*/
+RwpBool
+ClusteredMesh::ShapeCast(ShapeCastResult &result,
+                         const CastShape &shape,
+                         rwpmath::Vector3::InParam delta,
+                         const rwpmath::Matrix44Affine *tm) const
+{
+    // Map the cast into spatial map space
+    CastShape localShape(shape);
+    Vector3 localDelta(delta);
+    if (tm)
+    {
+        const Matrix44Affine invTm(InverseOfMatrixWithOrthonormal3x3(*tm));
+        localShape = shape.Transform(invTm);
+        localDelta = TransformVector(delta, invTm);
+    }
+
+    const Vector3 localStart = localShape.GetCenter();
+    const Vector3 localEnd = localStart + localDelta;
+    const float granularityImprecision = 2.0f * mClusterParams.mVertexCompressionGranularity;
+
+    KDTree::LineQuery mapQuery(GetKDTreeBase(), localStart, localEnd, localShape.GetHalfExtents(), granularityImprecision);
+
+    const uint32_t shift = (uint32_t)(16 + (mClusterParams.mFlags & CMFLAG_20BITCLUSTERINDEX));
+    const uint32_t mask = (uint32_t)((1 << shift) - 1);
+
+    RwpBool hit = FALSE;
+    float bestLineParam = MAX_FLOAT;
+    uint32_t entry = 0;
+    uint32_t unitCount = 0;
+
+    while (mapQuery.GetNext(entry, unitCount))
+    {
+        uint32_t clusterIndex = entry >> shift;
+        uint32_t unitOffset = entry & mask;
+        uint32_t numTrisLeftInUnit = 0;
+
+nextCluster:
+        ClusterTriangleIterator<> cti(GetCluster(clusterIndex), mClusterParams, unitOffset, unitCount, numTrisLeftInUnit);
+        EA_ASSERT(cti.IsValid());
+
+        for (; !cti.AtEnd(); cti.Next())
+        {
+            Vector3 v0, v1, v2, edgeCosines;
+            uint32_t flags, id;
+            cti.GetTriangle(v0, v1, v2, edgeCosines, flags, id);
+
+            ShapeCastResult triRes;
+            if (TriangleShapeCast(triRes, localShape, localDelta, v0, v1, v2, edgeCosines, flags) &&
+                triRes.lineParam < bestLineParam)
+            {
+                result = triRes;
+                result.childIndex = GetChildIndex(
+                                        cti.GetOffset(),
+                                        cti.GetNumTrianglesLeftInCurrentUnit() - 1u,
+                                        clusterIndex);
+                bestLineParam = triRes.lineParam;
+                hit = TRUE;
+
+                // Only nearer leaves can contain an earlier hit
+                mapQuery.ClipEnd(bestLineParam);
+            }
+
+            // Temporary workaround in case KDTree leaf nodes span across cluster boundaries
+            if ((cti.GetNumTrianglesLeftInCurrentUnit() <= 1) &&
+                (cti.GetRemainingUnits() > 1) &&
+                (cti.GetOffset() + cti.GetUnit().GetSize() >= GetCluster(clusterIndex).unitDataSize))
+            {
+                clusterIndex++;
+                numTrisLeftInUnit = 0;
+                unitOffset = 0;
+                unitCount = cti.GetRemainingUnits()-1;
+                goto nextCluster;
+            }
+        }
+    }
+
+    if (hit && tm)
+    {
+        // Map result back into query space
+        result.position = TransformPoint(result.position, *tm);
+        result.normal = TransformVector(result.normal, *tm);
+    }
+
+    return hit;
+}
+
+
+} // namespace collision
+} // namespace rw
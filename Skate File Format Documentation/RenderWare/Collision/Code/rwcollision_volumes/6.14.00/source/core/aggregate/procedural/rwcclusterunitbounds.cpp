@@ -0,0 +1,474 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwcclusterunitbounds.cpp
+
+ Purpose: Quantized bounding boxes of the units in each cluster of a ClusteredMesh.
+
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include <EAAssert/eaassert.h>
+
+#include "rw/collision/clusterunitbounds.h"
+
+#include "rw/collision/clusteredmeshbase.h"
+#include "rw/collision/clusteredmeshcluster.h"
+#include "rw/collision/clusteredmeshbase_methods.h"
+#include "rw/collision/clusteredmeshcluster_methods.h"
+#include "rw/collision/clustertriangleiterator.h"
+
+using namespace rwpmath;
+
+namespace rw
+{
+namespace collision
+{
+
+
+// ***********************************************************************************************************
+// Static Functions
+
+namespace
+{
+
+/// Directions smaller than this, in grid steps, are treated as parallel to the axis by the line test.
+const float MIN_LINE_DIRECTION = 1.0e-20f;
+
+
+/**
+\internal
+Gets the largest value which can be stored in one bound.
+*/
+inline float
+GetMaxCell(uint32_t format)
+{
+    return (format == ClusterUnitBounds::FORMAT_16BIT) ? 65535.0f : 255.0f;
+}
+
+
+/**
+\internal
+Converts a coordinate to a whole number of grid steps from the origin, rounding down and clamping to the
+range of the grid. Rounding down a clamped value which is not negative is the same as truncating it.
+*/
+inline uint32_t
+GetCell(float value, float origin, float invCellSize, float maxCell)
+{
+    float cells = (value - origin) * invCellSize;
+    cells = (cells > 0.0f) ? cells : 0.0f;
+    cells = (cells < maxCell) ? cells : maxCell;
+    return static_cast<uint32_t>(cells);
+}
+
+
+/**
+\internal
+Converts a query coordinate to a whole number of grid steps from the origin, rounding down. Coordinates
+before the grid give -1 and coordinates after it give one more than the last step, so that a query which
+misses the cluster misses every unit in it.
+*/
+inline int32_t
+GetQueryCell(float value, float origin, float invCellSize, float maxCell)
+{
+    const float cells = (value - origin) * invCellSize;
+    if (cells < 0.0f)
+    {
+        return -1;
+    }
+    if (cells > maxCell)
+    {
+        return static_cast<int32_t>(maxCell) + 1;
+    }
+    return static_cast<int32_t>(cells);
+}
+
+
+/**
+\internal
+Gets a mask with the bits set for units which are not tested.
+*/
+inline uint32_t
+GetUntestedMask(uint32_t numTested)
+{
+    return (numTested >= ClusterUnitBounds::MAX_MASK_UNITS) ? 0u : ~((1u << numTested) - 1u);
+}
+
+
+/**
+\internal
+Tests the stored bounds of a run of units against a box, in grid steps.
+*/
+template <typename COMPONENT>
+uint32_t
+TestBBox(const COMPONENT *bounds,
+         uint32_t stride,
+         uint32_t firstUnit,
+         uint32_t numUnits,
+         const int32_t *queryMin,
+         const int32_t *queryMax)
+{
+    const COMPONENT *minX = bounds + firstUnit;
+    const COMPONENT *minY = minX + stride;
+    const COMPONENT *minZ = minY + stride;
+    const COMPONENT *maxX = minZ + stride;
+    const COMPONENT *maxY = maxX + stride;
+    const COMPONENT *maxZ = maxY + stride;
+
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < numUnits; ++i)
+    {
+        const uint32_t overlap =
+            static_cast<uint32_t>(static_cast<int32_t>(minX[i]) <= queryMax[0]) &
+            static_cast<uint32_t>(static_cast<int32_t>(maxX[i]) >= queryMin[0]) &
+            static_cast<uint32_t>(static_cast<int32_t>(minY[i]) <= queryMax[1]) &
+            static_cast<uint32_t>(static_cast<int32_t>(maxY[i]) >= queryMin[1]) &
+            static_cast<uint32_t>(static_cast<int32_t>(minZ[i]) <= queryMax[2]) &
+            static_cast<uint32_t>(static_cast<int32_t>(maxZ[i]) >= queryMin[2]);
+        mask |= overlap << i;
+    }
+    return mask;
+}
+
+
+/**
+\internal
+Tests the stored bounds of a run of units, grown by the padding, against a line segment, in grid steps.
+*/
+template <typename COMPONENT>
+uint32_t
+TestLine(const COMPONENT *bounds,
+         uint32_t stride,
+         uint32_t firstUnit,
+         uint32_t numUnits,
+         const float *start,
+         const float *invDirection,
+         const float *padding,
+         float lineEnd)
+{
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < numUnits; ++i)
+    {
+        float tNear = 0.0f;
+        float tFar = lineEnd;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float lo = (static_cast<float>(bounds[axis * stride + firstUnit + i]) - padding[axis] - start[axis]) * invDirection[axis];
+            const float hi = (static_cast<float>(bounds[(axis + 3) * stride + firstUnit + i]) + padding[axis] - start[axis]) * invDirection[axis];
+            const float tEnter = (lo < hi) ? lo : hi;
+            const float tExit = (lo < hi) ? hi : lo;
+            tNear = (tEnter > tNear) ? tEnter : tNear;
+            tFar = (tExit < tFar) ? tExit : tFar;
+        }
+        mask |= static_cast<uint32_t>(tNear <= tFar) << i;
+    }
+    return mask;
+}
+
+} // namespace
+
+
+// ***********************************************************************************************************
+// Class Methods
+
+/**
+\brief Fills in the bounds of every unit of a mesh. The mesh must have all of its clusters.
+
+The grid of each cluster spans the bounds of its decoded vertices. The bounds of each unit are rounded
+outwards and padded by one grid step, so that the bounds remain conservative if a query rounds differently.
+
+\param mesh The mesh, which must have no more clusters and units than this object was created for.
+*/
+void
+ClusterUnitBounds::Build(const ClusteredMesh &mesh)
+{
+    EA_ASSERT_MSG(mesh.GetNumCluster() <= m_maxClusters, ("Too many clusters for the unit bounds."));
+
+    m_numClusters = 0;
+    m_numUnits = 0;
+
+    for (uint32_t clusterIndex = 0; clusterIndex < mesh.GetNumCluster(); ++clusterIndex)
+    {
+        EA_ASSERT_MSG(m_numUnits + mesh.GetCluster(clusterIndex).unitCount <= m_maxUnits, ("Too many units for the unit bounds."));
+
+        BuildCluster(mesh, clusterIndex, m_numUnits);
+
+        m_numUnits += m_clusters[clusterIndex].m_numUnits;
+        m_numClusters = clusterIndex + 1;
+    }
+}
+
+
+/**
+\brief Refills the bounds of the units of one cluster, after the cluster has been rewritten in place.
+
+The cluster must have the same number of units, at the same offsets, as when the bounds were built.
+
+\param mesh The mesh from which the bounds were built.
+\param clusterIndex The index of the rewritten cluster.
+*/
+void
+ClusterUnitBounds::UpdateCluster(const ClusteredMesh &mesh, uint32_t clusterIndex)
+{
+    EA_ASSERT_MSG(clusterIndex < m_numClusters, ("The unit bounds have not been built for this cluster."));
+    EA_ASSERT_MSG(mesh.GetCluster(clusterIndex).unitCount == m_clusters[clusterIndex].m_numUnits,
+        ("The number of units in the cluster has changed since the unit bounds were built."));
+
+    BuildCluster(mesh, clusterIndex, m_clusters[clusterIndex].m_firstUnit);
+}
+
+
+/**
+\brief Fills in the grid of one cluster and the bounds of its units.
+
+\param mesh The mesh.
+\param clusterIndex The index of the cluster.
+\param firstUnit The index of the bounds of the first unit of the cluster.
+*/
+void
+ClusterUnitBounds::BuildCluster(const ClusteredMesh &mesh, uint32_t clusterIndex, uint32_t firstUnit)
+{
+    const ClusterParams clusterParams(mesh.GetClusterParams());
+    const float maxCell = GetMaxCell(m_format);
+    const uint32_t componentSize = GetComponentSize();
+
+    const ClusteredMeshCluster &cluster = mesh.GetCluster(clusterIndex);
+
+    // Find the bounds of the cluster
+    Vector3 clusterMin(MAX_FLOAT, MAX_FLOAT, MAX_FLOAT);
+    Vector3 clusterMax(-MAX_FLOAT, -MAX_FLOAT, -MAX_FLOAT);
+    for (ClusterTriangleIterator<> it(cluster, clusterParams); !it.AtEnd(); it.Next())
+    {
+        Vector3 v0, v1, v2;
+        it.GetVertices(v0, v1, v2);
+        clusterMin = Min(clusterMin, Min(Min(v0, v1), v2));
+        clusterMax = Max(clusterMax, Max(Max(v0, v1), v2));
+    }
+
+    ClusterEntry &entry = m_clusters[clusterIndex];
+    entry.m_firstUnit = firstUnit;
+    entry.m_numUnits = cluster.unitCount;
+
+    float invCellSize[3];
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        const float lo = static_cast<float>(clusterMin.GetComponent(static_cast<int>(axis)));
+        const float hi = static_cast<float>(clusterMax.GetComponent(static_cast<int>(axis)));
+        entry.m_origin[axis] = (cluster.unitCount > 0) ? lo : 0.0f;
+        entry.m_cellSize[axis] = (cluster.unitCount > 0 && hi > lo) ? (hi - lo) / maxCell : 1.0f;
+        invCellSize[axis] = 1.0f / entry.m_cellSize[axis];
+    }
+
+    // Store the bounds of each unit
+    uint32_t unit = firstUnit;
+    Vector3 unitMin(MAX_FLOAT, MAX_FLOAT, MAX_FLOAT);
+    Vector3 unitMax(-MAX_FLOAT, -MAX_FLOAT, -MAX_FLOAT);
+    for (ClusterTriangleIterator<> it(cluster, clusterParams); !it.AtEnd(); it.Next())
+    {
+        Vector3 v0, v1, v2;
+        it.GetVertices(v0, v1, v2);
+        unitMin = Min(unitMin, Min(Min(v0, v1), v2));
+        unitMax = Max(unitMax, Max(Max(v0, v1), v2));
+
+        if (it.GetNumTrianglesLeftInCurrentUnit() == 1)
+        {
+            m_unitOffsets[unit] = static_cast<uint16_t>(it.GetOffset());
+
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                uint32_t lo = GetCell(static_cast<float>(unitMin.GetComponent(static_cast<int>(axis))),
+                    entry.m_origin[axis], invCellSize[axis], maxCell);
+                uint32_t hi = GetCell(static_cast<float>(unitMax.GetComponent(static_cast<int>(axis))),
+                    entry.m_origin[axis], invCellSize[axis], maxCell);
+
+                // Round the maximum up, and pad both by one step
+                lo = (lo > 0u) ? lo - 1u : 0u;
+                hi = (hi + 2u < static_cast<uint32_t>(maxCell)) ? hi + 2u : static_cast<uint32_t>(maxCell);
+
+                if (componentSize == 2u)
+                {
+                    uint16_t *bounds = reinterpret_cast<uint16_t *>(m_bounds);
+                    bounds[axis * m_maxUnits + unit] = static_cast<uint16_t>(lo);
+                    bounds[(axis + 3) * m_maxUnits + unit] = static_cast<uint16_t>(hi);
+                }
+                else
+                {
+                    m_bounds[axis * m_maxUnits + unit] = static_cast<uint8_t>(lo);
+                    m_bounds[(axis + 3) * m_maxUnits + unit] = static_cast<uint8_t>(hi);
+                }
+            }
+
+            ++unit;
+            unitMin = Vector3(MAX_FLOAT, MAX_FLOAT, MAX_FLOAT);
+            unitMax = Vector3(-MAX_FLOAT, -MAX_FLOAT, -MAX_FLOAT);
+        }
+    }
+
+    EA_ASSERT(unit == entry.m_firstUnit + entry.m_numUnits);
+}
+
+
+/**
+\brief Tests the units of a KDTree leaf against a box.
+
+The result has one bit for each unit, starting with unitIndex in the least significant bit, which is
+clear if the unit cannot overlap the box. Units which are not tested always have their bit set. These are
+the units after the first MAX_MASK_UNITS and, when the leaf runs past the end of the cluster, the units in
+the next cluster and the last unit of this one, so that callers walking the leaf still reach the next
+cluster.
+
+\param clusterIndex The index of the cluster in the mesh.
+\param unitIndex The index in the cluster of the first unit of the leaf, from FindUnit.
+\param numUnits The number of units in the leaf.
+\param bbox The box in the space of the mesh.
+\return A mask of the units which may overlap the box.
+*/
+uint32_t
+ClusterUnitBounds::GetBBoxOverlapMask(uint32_t clusterIndex,
+                                      uint32_t unitIndex,
+                                      uint32_t numUnits,
+                                      const AABBox &bbox) const
+{
+    const ClusterEntry &entry = GetClusterEntry(clusterIndex);
+    if (unitIndex >= entry.m_numUnits)
+    {
+        return ~0u;
+    }
+
+    const uint32_t unitsInCluster = entry.m_numUnits - unitIndex;
+    uint32_t numTested = (numUnits < unitsInCluster) ? numUnits : unitsInCluster;
+    numTested = (numTested < MAX_MASK_UNITS) ? numTested : MAX_MASK_UNITS;
+    if (numUnits > unitsInCluster && numTested == unitsInCluster)
+    {
+        numTested--;
+    }
+
+    const float maxCell = GetMaxCell(m_format);
+    // The stored bounds are already padded, so rounding both query bounds down is conservative
+    int32_t queryMin[3];
+    int32_t queryMax[3];
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        const float invCellSize = 1.0f / entry.m_cellSize[axis];
+        queryMin[axis] = GetQueryCell(static_cast<float>(bbox.Min().GetComponent(static_cast<int>(axis))),
+            entry.m_origin[axis], invCellSize, maxCell);
+        queryMax[axis] = GetQueryCell(static_cast<float>(bbox.Max().GetComponent(static_cast<int>(axis))),
+            entry.m_origin[axis], invCellSize, maxCell);
+    }
+
+    uint32_t mask;
+    if (m_format == FORMAT_16BIT)
+    {
+        mask = TestBBox(reinterpret_cast<const uint16_t *>(m_bounds), m_maxUnits, entry.m_firstUnit + unitIndex,
+            numTested, queryMin, queryMax);
+    }
+    else
+    {
+        mask = TestBBox(m_bounds, m_maxUnits, entry.m_firstUnit + unitIndex, numTested, queryMin, queryMax);
+    }
+
+    return mask | GetUntestedMask(numTested);
+}
+
+
+/**
+\brief Tests the units of a KDTree leaf against a fat line segment.
+
+The result has one bit per unit as described for GetBBoxOverlapMask.
+
+\param clusterIndex The index of the cluster in the mesh.
+\param unitIndex The index in the cluster of the first unit of the leaf, from FindUnit.
+\param numUnits The number of units in the leaf.
+\param lineStart The start of the line in the space of the mesh.
+\param lineDelta The vector from the start to the end of the line.
+\param lineEnd The parameter of the end of the segment along lineDelta, normally 1 unless the line has been clipped.
+\param fatness The radius of the line.
+\return A mask of the units which may be hit by the line.
+*/
+uint32_t
+ClusterUnitBounds::GetLineOverlapMask(uint32_t clusterIndex,
+                                      uint32_t unitIndex,
+                                      uint32_t numUnits,
+                                      rwpmath::Vector3::InParam lineStart,
+                                      rwpmath::Vector3::InParam lineDelta,
+                                      float lineEnd,
+                                      float fatness) const
+{
+    const ClusterEntry &entry = GetClusterEntry(clusterIndex);
+    if (unitIndex >= entry.m_numUnits)
+    {
+        return ~0u;
+    }
+
+    const uint32_t unitsInCluster = entry.m_numUnits - unitIndex;
+    uint32_t numTested = (numUnits < unitsInCluster) ? numUnits : unitsInCluster;
+    numTested = (numTested < MAX_MASK_UNITS) ? numTested : MAX_MASK_UNITS;
+    if (numUnits > unitsInCluster && numTested == unitsInCluster)
+    {
+        numTested--;
+    }
+
+    // Map the line into grid steps
+    float start[3];
+    float invDirection[3];
+    float padding[3];
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        const float invCellSize = 1.0f / entry.m_cellSize[axis];
+        start[axis] = (static_cast<float>(lineStart.GetComponent(static_cast<int>(axis))) - entry.m_origin[axis]) * invCellSize;
+        float direction = static_cast<float>(lineDelta.GetComponent(static_cast<int>(axis))) * invCellSize;
+        if (direction > -MIN_LINE_DIRECTION && direction < MIN_LINE_DIRECTION)
+        {
+            direction = MIN_LINE_DIRECTION;
+        }
+        invDirection[axis] = 1.0f / direction;
+        padding[axis] = fatness * invCellSize;
+    }
+
+    uint32_t mask;
+    if (m_format == FORMAT_16BIT)
+    {
+        mask = TestLine(reinterpret_cast<const uint16_t *>(m_bounds), m_maxUnits, entry.m_firstUnit + unitIndex,
+            numTested, start, invDirection, padding, lineEnd);
+    }
+    else
+    {
+        mask = TestLine(m_bounds, m_maxUnits, entry.m_firstUnit + unitIndex, numTested, start, invDirection,
+            padding, lineEnd);
+    }
+
+    return mask | GetUntestedMask(numTested);
+}
+
+
+/**
+\brief Tests the ClusterUnitBounds for internal consistency.
+\return TRUE if the bounds of each cluster follow on from the previous cluster and the unit offsets ascend.
+*/
+RwpBool
+ClusterUnitBounds::IsValid() const
+{
+    RwpBool ok = static_cast<RwpBool>(m_format == FORMAT_8BIT || m_format == FORMAT_16BIT);
+    ok = static_cast<RwpBool>(ok && m_numClusters <= m_maxClusters && m_numUnits <= m_maxUnits);
+
+    uint32_t firstUnit = 0;
+    for (uint32_t clusterIndex = 0; ok && clusterIndex < m_numClusters; ++clusterIndex)
+    {
+        const ClusterEntry &entry = m_clusters[clusterIndex];
+        ok = static_cast<RwpBool>(ok && entry.m_firstUnit == firstUnit);
+        ok = static_cast<RwpBool>(ok && entry.m_cellSize[0] > 0.0f && entry.m_cellSize[1] > 0.0f && entry.m_cellSize[2] > 0.0f);
+        for (uint32_t unit = 1; ok && unit < entry.m_numUnits; ++unit)
+        {
+            ok = static_cast<RwpBool>(m_unitOffsets[firstUnit + unit - 1] < m_unitOffsets[firstUnit + unit]);
+        }
+        firstUnit += entry.m_numUnits;
+    }
+
+    return static_cast<RwpBool>(ok && firstUnit == m_numUnits);
+}
+
+
+} // namespace collision
+} // namespace rw
@@ -0,0 +1,1032 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwcheightfieldprocedural.cpp
+
+ Purpose: Procedural aggregate of the triangles implied by a regular grid of quantized heights.
+
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include <new>
+
+#include "rw/collision/aggregate.h"
+#include "rw/collision/volumelinequery.h"
+#include "rw/collision/volumebboxquery.h"
+#include "rw/collision/triangle.h"
+#include "rw/collision/aalineclipper.h"
+#include "rw/collision/metrics.h"
+
+#include "rw/collision/procedural.h"
+#include "rw/collision/heightfieldprocedural.h"
+
+
+using namespace rwpmath;
+
+namespace rw
+{
+namespace collision
+{
+
+
+// ***********************************************************************************************************
+// Defines + Enums + Consts
+
+/**
+\internal
+The edge cosine of the edges on the boundary of the grid, which have no neighboring triangle. This is the
+value the ClusteredMeshBuilder gives to unmatched edges.
+*/
+#define rwcHEIGHTFIELDPROCEDURAL_EDGECOS_OF_BOUNDARY_EDGE (-1.0f)
+
+/**
+\internal
+Codes of the edges of the triangles of a cell. The sides of the cell are shared with a triangle of a
+neighboring cell, and the diagonal with the other triangle of the cell, given by the corner opposite it.
+*/
+enum CellEdge
+{
+    CELLEDGE_XMIN = 0,
+    CELLEDGE_XMAX = 1,
+    CELLEDGE_ZMIN = 2,
+    CELLEDGE_ZMAX = 3,
+    CELLEDGE_DIAGONAL = 4
+};
+
+// ***********************************************************************************************************
+// Static Variables + Static Data Member Definitions
+
+/**
+\internal
+The corners of the two triangles of a cell, for each choice of diagonal. The corners are numbered
+0 = (x, z), 1 = (x + 1, z), 2 = (x, z + 1), 3 = (x + 1, z + 1), and the triangles wind so that their
+normals point up.
+*/
+static const uint8_t sCellTriangleCorners[2][2][3] =
+{
+    { { 0, 2, 3 }, { 0, 3, 1 } },
+    { { 0, 2, 1 }, { 1, 2, 3 } }
+};
+
+/**
+\internal
+The CellEdge of each edge of the two triangles of a cell, for each choice of diagonal, edge i running from
+corner i to corner i + 1 of the triangle.
+*/
+static const uint8_t sCellTriangleEdges[2][2][3] =
+{
+    { { CELLEDGE_XMIN, CELLEDGE_ZMAX, CELLEDGE_DIAGONAL + 1 }, { CELLEDGE_DIAGONAL + 2, CELLEDGE_XMAX, CELLEDGE_ZMIN } },
+    { { CELLEDGE_XMIN, CELLEDGE_DIAGONAL + 3, CELLEDGE_ZMIN }, { CELLEDGE_DIAGONAL + 0, CELLEDGE_ZMAX, CELLEDGE_XMAX } }
+};
+
+/**
+\internal
+For each side of a cell, the offset of the neighboring cell and, for each choice of diagonal of the
+neighboring cell, the offset of the vertex of its triangle on the side which is not on the side.
+*/
+static const int32_t sCellSideNeighbors[4][6] =
+{
+    // neighbor x, neighbor z, opposite x, opposite z (diagonal 0), opposite x, opposite z (diagonal 1)
+    { -1,  0, -1, 0, -1, 1 },
+    {  1,  0,  2, 1,  2, 0 },
+    {  0, -1,  0, -1, 1, -1 },
+    {  0,  1,  1, 2,  0, 2 }
+};
+
+/**
+\internal
+
+\brief The initialization of the static member variable that holds the functions pointers.
+*/
+rw::collision::Procedural::VTable HeightFieldProcedural::sm_vTable =
+{
+    RWCOBJECTTYPE_HEIGHTFIELDPROCEDURAL,
+    static_cast<rw::collision::Aggregate::GetSizeFn>              (&HeightFieldProcedural::GetSizeThis),
+    rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT,
+    TRUE,
+    static_cast<rw::collision::Aggregate::UpdateFn>               (&HeightFieldProcedural::UpdateThis),
+    static_cast<rw::collision::Aggregate::LineIntersectionQueryFn>(&HeightFieldProcedural::LineIntersectionQueryThis),
+    static_cast<rw::collision::Aggregate::BBoxOverlapQueryFn>     (&HeightFieldProcedural::BBoxOverlapQueryThis),
+    0, // rw::collision::Aggregate::GetNextVolumeFn
+    0, // rw::collision::Aggregate::ClearAllProcessedFlags
+    0  // rw::collision::Aggregate::ApplyUniformScale
+};
+
+// ***********************************************************************************************************
+// Static Functions
+
+/**
+\internal
+\return The cell containing a grid coordinate, clamped to the cells of the grid.
+*/
+static inline uint32_t
+ClampToCell(float gridCoordinate, uint32_t numCells)
+{
+    if (gridCoordinate <= 0.0f)
+    {
+        return 0u;
+    }
+    if (gridCoordinate >= static_cast<float>(numCells))
+    {
+        return numCells - 1u;
+    }
+    return static_cast<uint32_t>(gridCoordinate);
+}
+
+/**
+\internal
+\return The line parameter at which a line leaves a cell along one axis of the grid, or MAX_FLOAT if the
+line is parallel to the axis.
+*/
+static inline float
+GetCellExitParam(uint32_t cell, int32_t step, float gridStart, float gridDelta)
+{
+    if (0 == step)
+    {
+        return MAX_FLOAT;
+    }
+    return (static_cast<float>(cell + (step > 0 ? 1u : 0u)) - gridStart) / gridDelta;
+}
+
+/**
+\internal
+
+\brief Computes the edge cosine of the edge from v1 to v2 of the triangle (v0, v1, v2), whose neighbor
+across the edge is the triangle (v3, v2, v1), and whether the edge is convex.
+
+\return The edge cosine, or one if either triangle is degenerate.
+*/
+static float
+ComputeEdgeCosine(RwpBool &convex,
+                  Vector3::InParam v0,
+                  Vector3::InParam v1,
+                  Vector3::InParam v2,
+                  Vector3::InParam v3)
+{
+    const Vector3 n1 = Cross(v1 - v0, v2 - v0);
+    const Vector3 n2 = Cross(v2 - v3, v1 - v3);
+    convex = static_cast<RwpBool>(static_cast<float>(Dot(v2 - v1, Cross(n1, n2))) > 0.0f);
+
+    const float len1 = static_cast<float>(MagnitudeSquared(n1));
+    const float len2 = static_cast<float>(MagnitudeSquared(n2));
+    if (len1 < MINIMUM_RECIPROCAL || len2 < MINIMUM_RECIPROCAL)
+    {
+        return 1.0f;
+    }
+
+    const float edgeCosine = static_cast<float>(Dot(n1, n2)) / Sqrt(len1 * len2);
+    return (edgeCosine < -1.0f) ? -1.0f : ((edgeCosine > 1.0f) ? 1.0f : edgeCosine);
+}
+
+// ***********************************************************************************************************
+// Class Member Functions
+
+/**
+\brief
+Constructor for an rw::collision::HeightFieldProcedural. This should only be called from Initialize.
+
+\param numCellsX   The number of cells along x.
+\param numCellsZ   The number of cells along z.
+\param flags       The HeightFieldProcedural::Flags.
+\param vTable      Pointer to the function table.
+*/
+HeightFieldProcedural::HeightFieldProcedural(uint32_t numCellsX,
+                                             uint32_t numCellsZ,
+                                             uint32_t flags,
+                                             VTable *vTable)
+    : Procedural(2u * numCellsX * numCellsZ, vTable)
+    , m_numCellsX(numCellsX)
+    , m_numCellsZ(numCellsZ)
+    , m_flags(flags)
+    , m_originX(0.0f)
+    , m_originZ(0.0f)
+    , m_cellSizeX(1.0f)
+    , m_cellSizeZ(1.0f)
+    , m_heightOffset(0.0f)
+    , m_heightScale(1.0f)
+    , m_surfaceIDs(NULL)
+    , m_diagonalFlags(NULL)
+{
+    uintptr_t addr = reinterpret_cast<uintptr_t>(this) + sizeof(HeightFieldProcedural);
+
+    // The diagonal flags come first to keep them aligned
+    if (flags & FLAG_HASDIAGONALFLAGS)
+    {
+        m_diagonalFlags = reinterpret_cast<uint32_t *>(addr);
+        addr += ((numCellsX * numCellsZ + 31) >> 5) * sizeof(uint32_t);
+    }
+
+    m_heights = reinterpret_cast<uint16_t *>(addr);
+    addr += (numCellsX + 1) * (numCellsZ + 1) * sizeof(uint16_t);
+
+    if (flags & FLAG_HASSURFACEIDS)
+    {
+        m_surfaceIDs = reinterpret_cast<uint16_t *>(addr);
+    }
+}
+
+
+/**
+\brief Get the resource requirements of a HeightFieldProcedural.
+
+\param numCellsX The number of cells along x.
+\param numCellsZ The number of cells along z.
+\param flags The HeightFieldProcedural::Flags, which select the optional per cell data.
+\return The EA::Physics::SizeAndAlignment
+*/
+EA::Physics::SizeAndAlignment
+HeightFieldProcedural::GetResourceDescriptor(uint32_t numCellsX,
+                                             uint32_t numCellsZ,
+                                             uint32_t flags)
+{
+    const uint32_t numCells = numCellsX * numCellsZ;
+
+    // Class structure
+    uint32_t size = sizeof(HeightFieldProcedural);
+
+    // m_diagonalFlags
+    if (flags & FLAG_HASDIAGONALFLAGS)
+    {
+        size += ((numCells + 31) >> 5) * sizeof(uint32_t);
+    }
+
+    // m_heights
+    size += (numCellsX + 1) * (numCellsZ + 1) * sizeof(uint16_t);
+
+    // m_surfaceIDs
+    if (flags & FLAG_HASSURFACEIDS)
+    {
+        size += numCells * sizeof(uint16_t);
+    }
+
+    return EA::Physics::SizeAndAlignment(size, rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT);
+}
+
+
+/**
+\brief Initializes a HeightFieldProcedural into a resource.
+
+The heights, surface IDs and diagonal flags are all initialized to zero, and the grid to unit cells with
+vertex (0, 0) at the origin. After setting them the application must call Update to compute the bounding
+box.
+
+\param resource The EA::Physics::MemoryPtr the HeightFieldProcedural is initialized into.
+\param numCellsX The number of cells along x.
+\param numCellsZ The number of cells along z.
+\param flags The HeightFieldProcedural::Flags.
+
+\return The new HeightFieldProcedural.
+*/
+HeightFieldProcedural *
+HeightFieldProcedural::Initialize(const EA::Physics::MemoryPtr &resource,
+                                  uint32_t numCellsX,
+                                  uint32_t numCellsZ,
+                                  uint32_t flags)
+{
+    EA_ASSERT_MSG(numCellsX > 0 && numCellsZ > 0, ("A HeightFieldProcedural must have at least one cell."));
+    EA_ASSERT_MSG(2u * numCellsX * numCellsZ < (1u << 31), ("Too many cells for the child indices of the triangles."));
+    rwcASSERTALIGN(resource.GetMemory(), rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT);
+
+    HeightFieldProcedural *agg = new (resource.GetMemory())
+        HeightFieldProcedural(numCellsX, numCellsZ, flags, &sm_vTable);
+
+    const uint32_t numCells = numCellsX * numCellsZ;
+    const uint32_t numHeights = (numCellsX + 1) * (numCellsZ + 1);
+
+    for (uint32_t i = 0; i < numHeights; ++i)
+    {
+        agg->m_heights[i] = 0;
+    }
+
+    if (agg->m_surfaceIDs)
+    {
+        for (uint32_t i = 0; i < numCells; ++i)
+        {
+            agg->m_surfaceIDs[i] = 0;
+        }
+    }
+
+    if (agg->m_diagonalFlags)
+    {
+        for (uint32_t i = 0; i < ((numCells + 31) >> 5); ++i)
+        {
+            agg->m_diagonalFlags[i] = 0;
+        }
+    }
+
+    agg->UpdateThis();
+
+    return agg;
+}
+
+
+/**
+\brief
+Releases a block of memory that was being used for a HeightFieldProcedural.
+*/
+void
+HeightFieldProcedural::Release()
+{
+}
+
+
+/**
+\see rw::collision::Procedural::GetSize.
+ */
+uint32_t
+HeightFieldProcedural::GetSizeThis()
+{
+    return GetResourceDescriptor(m_numCellsX, m_numCellsZ, m_flags).GetSize();
+}
+
+
+/**
+\internal
+Computes the bounding box from the heights and the number of tag bits from the number of triangles.
+ */
+void
+HeightFieldProcedural::UpdateThis(void)
+{
+    const uint32_t numHeights = (m_numCellsX + 1) * (m_numCellsZ + 1);
+
+    uint16_t minHeight = m_heights[0];
+    uint16_t maxHeight = m_heights[0];
+    for (uint32_t i = 1; i < numHeights; ++i)
+    {
+        minHeight = (m_heights[i] < minHeight) ? m_heights[i] : minHeight;
+        maxHeight = (m_heights[i] > maxHeight) ? m_heights[i] : maxHeight;
+    }
+
+    m_AABB.Set(Vector3(m_originX,
+                       m_heightOffset + static_cast<float>(minHeight) * m_heightScale,
+                       m_originZ),
+               Vector3(m_originX + static_cast<float>(m_numCellsX) * m_cellSizeX,
+                       m_heightOffset + static_cast<float>(maxHeight) * m_heightScale,
+                       m_originZ + static_cast<float>(m_numCellsZ) * m_cellSizeZ));
+
+    // Set the num tag bits required to address the triangles, whose tags store the child index plus one
+    m_numTagBits = 1u;
+    while ((1u << m_numTagBits) <= m_numVolumes)
+    {
+        ++m_numTagBits;
+    }
+}
+
+
+/**
+\internal
+\return The position of a grid vertex.
+*/
+inline Vector3
+HeightFieldProcedural::GetVertex(uint32_t x, uint32_t z) const
+{
+    return Vector3(m_originX + static_cast<float>(x) * m_cellSizeX,
+                   m_heightOffset + static_cast<float>(m_heights[z * (m_numCellsX + 1) + x]) * m_heightScale,
+                   m_originZ + static_cast<float>(z) * m_cellSizeZ);
+}
+
+
+/**
+\internal
+\brief Gets the vertices of one of the two triangles of a cell.
+*/
+inline void
+HeightFieldProcedural::GetCellTriangle(uint32_t cellX,
+                                       uint32_t cellZ,
+                                       uint32_t triangle,
+                                       Vector3 &v0,
+                                       Vector3 &v1,
+                                       Vector3 &v2) const
+{
+    const uint32_t diagonal = GetCellDiagonal(cellZ * m_numCellsX + cellX) ? 1u : 0u;
+    const uint8_t *corners = sCellTriangleCorners[diagonal][triangle];
+
+    v0 = GetVertex(cellX + (corners[0] & 1u), cellZ + (corners[0] >> 1));
+    v1 = GetVertex(cellX + (corners[1] & 1u), cellZ + (corners[1] >> 1));
+    v2 = GetVertex(cellX + (corners[2] & 1u), cellZ + (corners[2] >> 1));
+}
+
+
+/**
+\internal
+\brief Gets the range of heights of the corners of a cell.
+*/
+inline void
+HeightFieldProcedural::GetCellHeightRange(uint32_t cellX, uint32_t cellZ, float &minHeight, float &maxHeight) const
+{
+    const uint16_t *row0 = &m_heights[cellZ * (m_numCellsX + 1) + cellX];
+    const uint16_t *row1 = row0 + (m_numCellsX + 1);
+
+    const uint16_t min0 = (row0[0] < row0[1]) ? row0[0] : row0[1];
+    const uint16_t min1 = (row1[0] < row1[1]) ? row1[0] : row1[1];
+    const uint16_t max0 = (row0[0] > row0[1]) ? row0[0] : row0[1];
+    const uint16_t max1 = (row1[0] > row1[1]) ? row1[0] : row1[1];
+
+    minHeight = m_heightOffset + static_cast<float>((min0 < min1) ? min0 : min1) * m_heightScale;
+    maxHeight = m_heightOffset + static_cast<float>((max0 > max1) ? max0 : max1) * m_heightScale;
+}
+
+
+/**
+\internal
+\brief Gets the vertex of the triangle across an edge of a triangle of a cell which is not on the edge.
+
+\param vertex The vertex.
+\param cellX,cellZ The cell.
+\param edge The CellEdge of the edge.
+\return FALSE if the edge is on the boundary of the grid, and so has no neighboring triangle.
+*/
+RwpBool
+HeightFieldProcedural::GetEdgeOppositeVertex(Vector3 &vertex,
+                                             uint32_t cellX,
+                                             uint32_t cellZ,
+                                             uint32_t edge) const
+{
+    if (edge >= CELLEDGE_DIAGONAL)
+    {
+        const uint32_t corner = edge - CELLEDGE_DIAGONAL;
+        vertex = GetVertex(cellX + (corner & 1u), cellZ + (corner >> 1));
+        return TRUE;
+    }
+
+    const int32_t *neighbor = sCellSideNeighbors[edge];
+    const int32_t neighborX = static_cast<int32_t>(cellX) + neighbor[0];
+    const int32_t neighborZ = static_cast<int32_t>(cellZ) + neighbor[1];
+    if (neighborX < 0 || neighborX >= static_cast<int32_t>(m_numCellsX) ||
+        neighborZ < 0 || neighborZ >= static_cast<int32_t>(m_numCellsZ))
+    {
+        return FALSE;
+    }
+
+    const uint32_t neighborDiagonal = GetCellDiagonal(static_cast<uint32_t>(neighborZ) * m_numCellsX + static_cast<uint32_t>(neighborX)) ? 1u : 0u;
+    vertex = GetVertex(static_cast<uint32_t>(static_cast<int32_t>(cellX) + neighbor[2 + 2 * neighborDiagonal]),
+                       static_cast<uint32_t>(static_cast<int32_t>(cellZ) + neighbor[3 + 2 * neighborDiagonal]));
+    return TRUE;
+}
+
+
+/**
+\internal
+\brief Computes the edge cosines of one of the two triangles of a cell from its neighboring triangles.
+
+\param cellX,cellZ The cell.
+\param triangle The index of the triangle within the cell.
+\param edgeCosines The edge cosines.
+\return The VOLUMEFLAG_TRIANGLEEDGEiCONVEX flags of the convex edges.
+*/
+uint32_t
+HeightFieldProcedural::GetCellTriangleEdgeCosines(uint32_t cellX,
+                                                  uint32_t cellZ,
+                                                  uint32_t triangle,
+                                                  Vector3 &edgeCosines) const
+{
+    const uint32_t diagonal = GetCellDiagonal(cellZ * m_numCellsX + cellX) ? 1u : 0u;
+    const uint8_t *edges = sCellTriangleEdges[diagonal][triangle];
+
+    Vector3 v[3];
+    GetCellTriangle(cellX, cellZ, triangle, v[0], v[1], v[2]);
+
+    float edgeCos[3];
+    uint32_t convexFlags = 0;
+    for (uint32_t edge = 0; edge < 3; ++edge)
+    {
+        RwpBool convex = TRUE;
+        edgeCos[edge] = rwcHEIGHTFIELDPROCEDURAL_EDGECOS_OF_BOUNDARY_EDGE;
+
+        Vector3 opposite;
+        if (GetEdgeOppositeVertex(opposite, cellX, cellZ, edges[edge]))
+        {
+            edgeCos[edge] = ComputeEdgeCosine(convex, v[(edge + 2) % 3], v[edge], v[(edge + 1) % 3], opposite);
+        }
+
+        if (convex)
+        {
+            convexFlags |= (VOLUMEFLAG_TRIANGLEEDGE0CONVEX << edge);
+        }
+    }
+
+    edgeCosines = Vector3(edgeCos[0], edgeCos[1], edgeCos[2]);
+    return convexFlags;
+}
+
+
+/**
+\internal
+\brief Sets the surface ID and flags, and optionally the edge cosines, of an instanced triangle of a cell.
+*/
+void
+HeightFieldProcedural::InitializeTriangleVolume(TriangleVolume &volume,
+                                                uint32_t cellX,
+                                                uint32_t cellZ,
+                                                uint32_t triangle,
+                                                RwpBool withEdgeCosines) const
+{
+    volume.SetSurface(GetCellSurfaceID(cellZ * m_numCellsX + cellX));
+
+    uint32_t flags = VOLUMEFLAG_TRIANGLEDEFAULT | VOLUMEFLAG_TRIANGLENORMALISDIRTY;
+    if (m_flags & FLAG_ONESIDED)
+    {
+        flags |= VOLUMEFLAG_TRIANGLEONESIDED;
+    }
+
+    if (withEdgeCosines)
+    {
+        Vector3 edgeCosines;
+        const uint32_t convexFlags = GetCellTriangleEdgeCosines(cellX, cellZ, triangle, edgeCosines);
+        flags = (flags & ~(VOLUMEFLAG_TRIANGLEEDGE0CONVEX | VOLUMEFLAG_TRIANGLEEDGE1CONVEX | VOLUMEFLAG_TRIANGLEEDGE2CONVEX)) | convexFlags;
+        volume.SetEdgeCos(edgeCosines.X(), edgeCosines.Y(), edgeCosines.Z());
+    }
+
+    volume.SetFlags(flags);
+}
+
+
+/**
+\brief Gets the vertices of the triangle referred to by a child index.
+
+\param childIndex The child index of the triangle.
+\param v0,v1,v2 The vertices of the triangle.
+*/
+void
+HeightFieldProcedural::GetTriangleVertices(uint32_t childIndex,
+                                           Vector3 &v0,
+                                           Vector3 &v1,
+                                           Vector3 &v2) const
+{
+    EA_ASSERT(childIndex < m_numVolumes);
+    const uint32_t cellIndex = childIndex >> 1;
+    GetCellTriangle(cellIndex % m_numCellsX, cellIndex / m_numCellsX, childIndex & 1u, v0, v1, v2);
+}
+
+
+/**
+\brief Fills out a triangle volume with the triangle referred to by a child index, with the edge cosines
+computed from its neighboring triangles.
+
+\param volume The triangle volume.
+\param childIndex The child index of the triangle.
+*/
+void
+HeightFieldProcedural::GetVolumeFromChildIndex(TriangleVolume &volume, uint32_t childIndex) const
+{
+    EA_ASSERT(childIndex < m_numVolumes);
+    const uint32_t cellIndex = childIndex >> 1;
+    const uint32_t cellX = cellIndex % m_numCellsX;
+    const uint32_t cellZ = cellIndex / m_numCellsX;
+
+    Vector3 v0, v1, v2;
+    GetCellTriangle(cellX, cellZ, childIndex & 1u, v0, v1, v2);
+    TriangleVolume::Initialize(EA::Physics::MemoryPtr(&volume), v0, v1, v2);
+    InitializeTriangleVolume(volume, cellX, cellZ, childIndex & 1u, TRUE);
+}
+
+
+/**
+\internal
+\brief Intersects a line with the triangles of a cell, adding the intersections to the results of a
+line query.
+
+\param lineQuery The line query.
+\param tm The transform of the heightfield.
+\param localLineStart,localLineDelta The line in the space of the heightfield.
+\param cellX,cellZ The cell.
+\param trianglesLeft The number of triangles of the cell still to intersect, one or two.
+\return FALSE if the query ran out of buffer space, having saved where to restart.
+*/
+RwpBool
+HeightFieldProcedural::LineIntersectCell(VolumeLineQuery *lineQuery,
+                                         const Matrix44Affine *tm,
+                                         Vector3::InParam localLineStart,
+                                         Vector3::InParam localLineDelta,
+                                         uint32_t cellX,
+                                         uint32_t cellZ,
+                                         uint32_t trianglesLeft) const
+{
+    const uint32_t cellIndex = cellZ * m_numCellsX + cellX;
+
+    for (uint32_t triangle = 2u - trianglesLeft; triangle < 2u; ++triangle)
+    {
+        rwcQUERYSTATS(++lineQuery->m_counters.m_counts[QueryCounters::TRIANGLES]);
+
+        Vector3 v0, v1, v2;
+        GetCellTriangle(cellX, cellZ, triangle, v0, v1, v2);
+
+        RwpBool hit = FALSE;
+        VolumeLineSegIntersectResult tmpRes;
+
+        if (m_flags & FLAG_ONESIDED)
+        {
+            hit = TriangleLineSegIntersect(tmpRes, localLineStart, localLineDelta, v0, v1, v2, lineQuery->m_fatness);
+        }
+        else
+        {
+            hit = TriangleLineSegIntersectTwoSided(tmpRes, localLineStart, localLineDelta, v0, v1, v2, lineQuery->m_fatness);
+        }
+
+        if (hit && tmpRes.lineParam <= lineQuery->m_endClipVal)
+        {
+            // Check that the query buffers are not full
+            if (lineQuery->m_resCount == lineQuery->m_resMax ||
+                lineQuery->m_instVolCount == lineQuery->m_instVolMax)
+            {
+                // Cache current position in the query so we can restart from this exact point.
+                lineQuery->m_clusteredMeshRestartData.entry = cellIndex;
+                lineQuery->m_clusteredMeshRestartData.unitCount = 0;
+                lineQuery->m_clusteredMeshRestartData.numTrisLeftInUnit = 2u - triangle;
+                return FALSE;
+            }
+
+            // Get the next free result from the query
+            VolumeLineSegIntersectResult *res = &lineQuery->m_resBuffer[lineQuery->m_resCount++];
+
+            // Instance the intersected triangle
+            Volume *vol = &lineQuery->m_instVolPool[lineQuery->m_instVolCount++];
+            TriangleVolume *triangleVolume = TriangleVolume::Initialize(EA::Physics::MemoryPtr(vol), v0, v1, v2);
+            InitializeTriangleVolume(*triangleVolume, cellX, cellZ, triangle, FALSE);
+
+            // Clip the line to min distance
+            if (lineQuery->m_resultsSet != VolumeLineQuery::ALLLINEINTERSECTIONS &&
+                tmpRes.lineParam < lineQuery->m_endClipVal)
+            {
+                lineQuery->m_endClipVal = tmpRes.lineParam;
+            }
+
+            res->inputIndex = lineQuery->m_currInput-1;
+            res->v = lineQuery->m_inputVols[res->inputIndex];
+
+            // Map intersect result back into query space
+            res->position = TransformPoint(tmpRes.position, *tm);
+            res->normal = TransformVector(tmpRes.normal, *tm);
+            res->volParam = tmpRes.volParam;
+            res->lineParam = tmpRes.lineParam;
+
+            res->vRef.volume = vol;
+            res->vRef.tmContents = *tm;
+            res->vRef.tm = &res->vRef.tmContents;
+
+            // Set up tag to this triangle
+            uint32_t tag = lineQuery->m_tag;
+            uint32_t numTagBits = lineQuery->m_numTagBits;
+            UpdateTagWithChildIndex(tag, numTagBits, 2u * cellIndex + triangle);
+            res->vRef.tag = tag;
+            res->vRef.numTagBits = static_cast<uint8_t>(numTagBits);
+        }
+    }
+
+    return TRUE;
+}
+
+
+/**
+\internal
+\see rw::collision::Aggregate::LineIntersectionQuery.
+
+A thin line walks the cells it crosses, in order along the line, with a 2D DDA, stopping at the end of the
+line or, when only the closest intersections are wanted, at the first cell it leaves beyond the closest
+intersection found. A fat line may touch cells it does not cross, so it visits every cell under the bounding
+box of the line instead. Cells whose range of heights the line does not reach are skipped.
+ */
+RwpBool
+HeightFieldProcedural::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
+                                                 const Matrix44Affine *tm)
+{
+    // Map line into heightfield space
+    Matrix44Affine invTm(*tm);
+    invTm = InverseOfMatrixWithOrthonormal3x3(invTm);
+    const Vector3 localLineStart = TransformPoint(lineQuery->m_pt1, invTm);
+    const Vector3 localLineEnd   = TransformPoint(lineQuery->m_pt2, invTm);
+    const Vector3 localLineDelta = localLineEnd - localLineStart;
+    const float fatness = lineQuery->m_fatness;
+
+    // Clip the line to the bounding box of the heightfield
+    float pa = 0.0f;
+    float pb = lineQuery->m_endClipVal;
+    AALineClipper clipper(localLineStart, localLineEnd, Vector3(fatness, fatness, fatness), m_AABB);
+    if (!clipper.ClipToAABBox(pa, pb, m_AABB))
+    {
+        return TRUE;
+    }
+
+    // The line in grid coordinates, in which the cells are of unit size
+    const float invCellSizeX = 1.0f / m_cellSizeX;
+    const float invCellSizeZ = 1.0f / m_cellSizeZ;
+    const float gridStartX = (static_cast<float>(localLineStart.GetX()) - m_originX) * invCellSizeX;
+    const float gridStartZ = (static_cast<float>(localLineStart.GetZ()) - m_originZ) * invCellSizeZ;
+    const float gridDeltaX = static_cast<float>(localLineDelta.GetX()) * invCellSizeX;
+    const float gridDeltaZ = static_cast<float>(localLineDelta.GetZ()) * invCellSizeZ;
+    const float startY = static_cast<float>(localLineStart.GetY());
+    const float deltaY = static_cast<float>(localLineDelta.GetY());
+
+    // Allow a quantization step of slack when skipping cells by height
+    const float heightPadding = fatness + m_heightScale;
+
+    uint32_t cellX = 0;
+    uint32_t cellZ = 0;
+    uint32_t trianglesLeft = 2u;
+
+    if (!lineQuery->m_curSpatialMapQuery)
+    {
+        // Set the pointer to a non-NULL value to indicate a query is in progress.
+        lineQuery->m_curSpatialMapQuery = lineQuery->m_spatialMapQueryMem;
+
+        if (fatness > 0.0f)
+        {
+            cellX = ClampToCell(Min(gridStartX + gridDeltaX * pa, gridStartX + gridDeltaX * pb) - fatness * invCellSizeX, m_numCellsX);
+            cellZ = ClampToCell(Min(gridStartZ + gridDeltaZ * pa, gridStartZ + gridDeltaZ * pb) - fatness * invCellSizeZ, m_numCellsZ);
+        }
+        else
+        {
+            cellX = ClampToCell(gridStartX + gridDeltaX * pa, m_numCellsX);
+            cellZ = ClampToCell(gridStartZ + gridDeltaZ * pa, m_numCellsZ);
+        }
+    }
+    else
+    {
+        // Restore the state of the ongoing query
+        cellX = lineQuery->m_clusteredMeshRestartData.entry % m_numCellsX;
+        cellZ = lineQuery->m_clusteredMeshRestartData.entry / m_numCellsX;
+        trianglesLeft = lineQuery->m_clusteredMeshRestartData.numTrisLeftInUnit;
+    }
+
+    if (fatness > 0.0f)
+    {
+        const uint32_t minX = ClampToCell(Min(gridStartX + gridDeltaX * pa, gridStartX + gridDeltaX * pb) - fatness * invCellSizeX, m_numCellsX);
+        const uint32_t maxX = ClampToCell(Max(gridStartX + gridDeltaX * pa, gridStartX + gridDeltaX * pb) + fatness * invCellSizeX, m_numCellsX);
+        const uint32_t maxZ = ClampToCell(Max(gridStartZ + gridDeltaZ * pa, gridStartZ + gridDeltaZ * pb) + fatness * invCellSizeZ, m_numCellsZ);
+        const float minY = Min(startY + deltaY * pa, startY + deltaY * pb) - heightPadding;
+        const float maxY = Max(startY + deltaY * pa, startY + deltaY * pb) + heightPadding;
+
+        cellX = (cellX < minX) ? minX : cellX;
+        while (cellZ <= maxZ)
+        {
+            if (cellX > maxX)
+            {
+                cellX = minX;
+                ++cellZ;
+                continue;
+            }
+
+            float minHeight, maxHeight;
+            GetCellHeightRange(cellX, cellZ, minHeight, maxHeight);
+            if (minY <= maxHeight && maxY >= minHeight)
+            {
+                if (!LineIntersectCell(lineQuery, tm, localLineStart, localLineDelta, cellX, cellZ, trianglesLeft))
+                {
+                    return FALSE;
+                }
+            }
+
+            trianglesLeft = 2u;
+            ++cellX;
+        }
+
+        return TRUE;
+    }
+
+    const int32_t stepX = (gridDeltaX > 0.0f) ? 1 : ((gridDeltaX < 0.0f) ? -1 : 0);
+    const int32_t stepZ = (gridDeltaZ > 0.0f) ? 1 : ((gridDeltaZ < 0.0f) ? -1 : 0);
+    float enterParam = pa;
+
+    for (;;)
+    {
+        const float exitParamX = GetCellExitParam(cellX, stepX, gridStartX, gridDeltaX);
+        const float exitParamZ = GetCellExitParam(cellZ, stepZ, gridStartZ, gridDeltaZ);
+        const float endParam = Min(pb, lineQuery->m_endClipVal);
+        const float exitParam = Min(Min(exitParamX, exitParamZ), endParam);
+
+        float minHeight, maxHeight;
+        GetCellHeightRange(cellX, cellZ, minHeight, maxHeight);
+        const float enterY = startY + deltaY * enterParam;
+        const float exitY = startY + deltaY * exitParam;
+        if (Min(enterY, exitY) - heightPadding <= maxHeight && Max(enterY, exitY) + heightPadding >= minHeight)
+        {
+            if (!LineIntersectCell(lineQuery, tm, localLineStart, localLineDelta, cellX, cellZ, trianglesLeft))
+            {
+                return FALSE;
+            }
+        }
+
+        // Step to the next cell along the line, unless the line ends or leaves the grid in this one. The end
+        // is checked again as the intersections in this cell may have clipped the line.
+        if (exitParam >= Min(pb, lineQuery->m_endClipVal))
+        {
+            break;
+        }
+
+        if (exitParamX < exitParamZ)
+        {
+            if ((stepX < 0 && cellX == 0) || (stepX > 0 && cellX + 1 == m_numCellsX))
+            {
+                break;
+            }
+            cellX = static_cast<uint32_t>(static_cast<int32_t>(cellX) + stepX);
+        }
+        else
+        {
+            if ((stepZ < 0 && cellZ == 0) || (stepZ > 0 && cellZ + 1 == m_numCellsZ))
+            {
+                break;
+            }
+            cellZ = static_cast<uint32_t>(static_cast<int32_t>(cellZ) + stepZ);
+        }
+
+        enterParam = exitParam;
+        trianglesLeft = 2u;
+    }
+
+    // Return True indicating we have added all intersections to the results buffer.
+    return TRUE;
+}
+
+
+/**
+\internal
+\see rw::collision::Aggregate::BBoxOverlapQuery.
+
+Visits the cells under the query box, returning the triangles whose bounding boxes overlap it with their
+edge cosines set, ready for contact generation.
+ */
+RwpBool
+HeightFieldProcedural::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
+                                            const Matrix44Affine *tm)
+{
+    // The spatial map query memory is used to store the query bbox in heightfield space.
+    AABBox *queryBBox = reinterpret_cast<AABBox*>(bboxQuery->m_spatialMapQueryMem);
+
+    uint32_t cellX = 0;
+    uint32_t cellZ = 0;
+    uint32_t trianglesLeft = 2u;
+
+    if (!bboxQuery->m_curSpatialMapQuery)
+    {
+        // Map bbox into heightfield space
+        if (tm)
+        {
+            const Matrix44Affine invTm(InverseOfMatrixWithOrthonormal3x3(*tm));
+            *queryBBox = bboxQuery->m_aabb.Transform(&invTm);
+        }
+        else
+        {
+            *queryBBox = bboxQuery->m_aabb;
+        }
+
+        if (!queryBBox->Overlaps(m_AABB))
+        {
+            return TRUE;
+        }
+
+        // Set the pointer to a non-NULL value to indicate a query is in progress.
+        bboxQuery->m_curSpatialMapQuery = bboxQuery->m_spatialMapQueryMem;
+
+        cellX = ClampToCell((static_cast<float>(queryBBox->Min().GetX()) - m_originX) / m_cellSizeX, m_numCellsX);
+        cellZ = ClampToCell((static_cast<float>(queryBBox->Min().GetZ()) - m_originZ) / m_cellSizeZ, m_numCellsZ);
+    }
+    else
+    {
+        // Resume from last saved point
+        cellX = bboxQuery->m_clusteredMeshRestartData.entry % m_numCellsX;
+        cellZ = bboxQuery->m_clusteredMeshRestartData.entry / m_numCellsX;
+        trianglesLeft = bboxQuery->m_clusteredMeshRestartData.numTrisLeftInUnit;
+    }
+
+    const uint32_t minX = ClampToCell((static_cast<float>(queryBBox->Min().GetX()) - m_originX) / m_cellSizeX, m_numCellsX);
+    const uint32_t maxX = ClampToCell((static_cast<float>(queryBBox->Max().GetX()) - m_originX) / m_cellSizeX, m_numCellsX);
+    const uint32_t maxZ = ClampToCell((static_cast<float>(queryBBox->Max().GetZ()) - m_originZ) / m_cellSizeZ, m_numCellsZ);
+    const float queryMinY = static_cast<float>(queryBBox->Min().GetY());
+    const float queryMaxY = static_cast<float>(queryBBox->Max().GetY());
+
+    while (cellZ <= maxZ)
+    {
+        float minHeight, maxHeight;
+        GetCellHeightRange(cellX, cellZ, minHeight, maxHeight);
+
+        if (queryMinY <= maxHeight && queryMaxY >= minHeight)
+        {
+            for (uint32_t triangle = 2u - trianglesLeft; triangle < 2u; ++triangle)
+            {
+                rwcQUERYSTATS(++bboxQuery->m_counters.m_counts[QueryCounters::TRIANGLES]);
+
+                Vector3 v0, v1, v2;
+                GetCellTriangle(cellX, cellZ, triangle, v0, v1, v2);
+
+                // Test the bbox of the triangle against the query bbox.
+                const AABBox triangleAABBox(Min(Min(v0, v1), v2), Max(Max(v0, v1), v2));
+                if (!queryBBox->Overlaps(triangleAABBox))
+                {
+                    continue;
+                }
+
+                // Check that the query buffers are not full
+                if (bboxQuery->m_primNext == bboxQuery->m_primBufferSize ||
+                    bboxQuery->m_instVolCount == bboxQuery->m_instVolMax)
+                {
+                    // Set flags to indicate why the query has paused
+                    if (bboxQuery->m_primNext == bboxQuery->m_primBufferSize)
+                    {
+                        bboxQuery->SetFlags(bboxQuery->GetFlags() | VolumeBBoxQuery::VOLUMEBBOXQUERY_RANOUTOFRESULTBUFFERSPACE);
+                    }
+
+                    if (bboxQuery->m_instVolCount == bboxQuery->m_instVolMax)
+                    {
+                        bboxQuery->SetFlags(bboxQuery->GetFlags() | VolumeBBoxQuery::VOLUMEBBOXQUERY_RANOUTOFINSTANCEBUFFERSPACE);
+                    }
+
+                    // Cache current position in the query so we can restart from this exact point.
+                    bboxQuery->m_clusteredMeshRestartData.entry = cellZ * m_numCellsX + cellX;
+                    bboxQuery->m_clusteredMeshRestartData.unitCount = 0;
+                    bboxQuery->m_clusteredMeshRestartData.numTrisLeftInUnit = 2u - triangle;
+                    // Return false indicating the query has not finished
+                    return FALSE;
+                }
+
+                // Instance the overlapping triangle, with its edge cosines
+                Volume *vol = &bboxQuery->m_instVolPool[bboxQuery->m_instVolCount++];
+                TriangleVolume *triangleVolume = TriangleVolume::Initialize(EA::Physics::MemoryPtr(vol), v0, v1, v2);
+                InitializeTriangleVolume(*triangleVolume, cellX, cellZ, triangle, TRUE);
+
+                // Set up tag to this triangle
+                uint32_t tag = bboxQuery->m_tag;
+                uint32_t numTagBits = bboxQuery->m_numTagBits;
+                UpdateTagWithChildIndex(tag, numTagBits, 2u * (cellZ * m_numCellsX + cellX) + triangle);
+
+                if (tm)
+                {
+                    const Vector3 v0_t(TransformPoint(v0, *tm));
+                    const Vector3 v1_t(TransformPoint(v1, *tm));
+                    const Vector3 v2_t(TransformPoint(v2, *tm));
+                    const AABBox triangleAABBox_t(Min(Min(v0_t, v1_t), v2_t), Max(Max(v0_t, v1_t), v2_t));
+
+                    bboxQuery->AddPrimitiveRef(vol, tm, triangleAABBox_t, tag, static_cast<uint8_t>(numTagBits));
+                }
+                else
+                {
+                    bboxQuery->AddPrimitiveRef(vol, tm, triangleAABBox, tag, static_cast<uint8_t>(numTagBits));
+                }
+            }
+        }
+
+        trianglesLeft = 2u;
+        if (++cellX > maxX)
+        {
+            cellX = minX;
+            ++cellZ;
+        }
+    }
+
+    // Return True indicating we have added all overlapping triangles to the primitive buffer.
+    return TRUE;
+}
+
+
+/**
+\brief Check validity of HeightFieldProcedural. Only available in debug library.
+
+\return TRUE if object is internally consistent.
+ */
+RwpBool
+HeightFieldProcedural::IsValid() const
+{
+    RwpBool isValid = TRUE;
+
+    if (m_numVolumes != 2u * m_numCellsX * m_numCellsZ)
+    {
+        EAPHYSICS_MESSAGE("Number of triangles %d does not match %d by %d cells.", m_numVolumes, m_numCellsX, m_numCellsZ);
+        isValid = FALSE;
+    }
+
+    if (!(m_cellSizeX > 0.0f) || !(m_cellSizeZ > 0.0f) || !(m_heightScale > 0.0f))
+    {
+        EAPHYSICS_MESSAGE("Cell sizes and height scale must be positive.");
+        isValid = FALSE;
+    }
+
+    if (((m_flags & FLAG_HASSURFACEIDS) != 0) != (m_surfaceIDs != NULL) ||
+        ((m_flags & FLAG_HASDIAGONALFLAGS) != 0) != (m_diagonalFlags != NULL))
+    {
+        EAPHYSICS_MESSAGE("Optional cell data does not match flags 0x%x.", m_flags);
+        isValid = FALSE;
+    }
+
+    // The bounding box must contain every vertex
+    for (uint32_t z = 0; z <= m_numCellsZ && isValid; ++z)
+    {
+        for (uint32_t x = 0; x <= m_numCellsX; ++x)
+        {
+            const Vector3 v = GetVertex(x, z);
+            if (!m_AABB.Contains(AABBox(v, v)))
+            {
+                EAPHYSICS_MESSAGE("Vertex (%d, %d) outside of bounding box, Update needs to be called.", x, z);
+                isValid = FALSE;
+                break;
+            }
+        }
+    }
+
+    return isValid;
+}
+
+
+} // namespace collision
+} // namespace rw
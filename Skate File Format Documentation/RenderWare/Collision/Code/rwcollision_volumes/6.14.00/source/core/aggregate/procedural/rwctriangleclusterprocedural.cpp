@@ -171,6 +171,7 @@ TriangleClusterProcedural::LineIntersectionQueryThis(
     {
         // Set the pointer to a non-NULL value to indicate a query is in progress.
         lineQuery->m_curSpatialMapQuery = lineQuery->m_spatialMapQueryMem;
+        rwcQUERYSTATS(++lineQuery->m_counters.m_counts[QueryCounters::CLUSTERS]);
         // Initialize the unit count to the number of units in the cluster.
         unitCount = mCluster->unitCount;
         // Initialize the unitOffset to 0, indicating the first unit in the cluster.
@@ -196,6 +197,9 @@ TriangleClusterProcedural::LineIntersectionQueryThis(
     // While there are still triangles to iterate
     for(;!cti.AtEnd(); cti.Next())
     {
+        rwcQUERYSTATS(++lineQuery->m_counters.m_counts[QueryCounters::TRIANGLES]);
+        rwcQUERYSTATS(lineQuery->m_counters.m_counts[QueryCounters::UNITS] += (cti.GetNumTrianglesLeftInCurrentUnit() <= 1) ? 1u : 0u);
+
         // Extract the vertices from the current triangle
         Vector3 v0, v1, v2;
         cti.GetVertices(v0, v1, v2);
@@ -320,6 +324,7 @@ TriangleClusterProcedural::BBoxOverlapQueryThis(
 
         // Set the pointer to a non-NULL value to indicate a query is in progress.
         bboxQuery->m_curSpatialMapQuery = bboxQuery->m_spatialMapQueryMem;
+        rwcQUERYSTATS(++bboxQuery->m_counters.m_counts[QueryCounters::CLUSTERS]);
         // Initialize the unit count to the number of units in the cluster.
         unitCount = mCluster->unitCount;
         // Initialize the unitOffset to 0, indicating the first unit in the cluster.
@@ -345,6 +350,9 @@ TriangleClusterProcedural::BBoxOverlapQueryThis(
     // While there are still triangles to iterate
     for(;!cti.AtEnd(); cti.Next())
     {
+        rwcQUERYSTATS(++bboxQuery->m_counters.m_counts[QueryCounters::TRIANGLES]);
+        rwcQUERYSTATS(bboxQuery->m_counters.m_counts[QueryCounters::UNITS] += (cti.GetNumTrianglesLeftInCurrentUnit() <= 1) ? 1u : 0u);
+
         // Extract the vertices from the current triangle
         rwpmath::Vector3 v0, v1, v2;
         cti.GetVertices(v0, v1, v2);
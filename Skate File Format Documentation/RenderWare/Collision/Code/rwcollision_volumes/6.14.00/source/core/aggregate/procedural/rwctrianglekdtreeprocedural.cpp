@@ -217,8 +217,8 @@ TriangleKDTreeProcedural::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
         lineQuery->m_curSpatialMapQuery = (void*)mapQuery;
     }
 
-    // Far clip val might have been set by another volume hit
-    if (lineQuery->m_resultsSet != VolumeLineQuery::ALLLINEINTERSECTIONS)
+    // Far clip val might have been set by another volume hit, or by the visitor of VisitIntersections
+    if (lineQuery->m_endClipVal < 1.0f)
     {
         mapQuery->ClipEnd(lineQuery->m_endClipVal);
     }
@@ -228,6 +228,7 @@ TriangleKDTreeProcedural::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
          && (lineQuery->m_instVolCount < lineQuery->m_instVolMax)
            && mapQuery->GetNext(index))
     {
+        rwcQUERYSTATS(++lineQuery->m_counters.m_counts[QueryCounters::TRIANGLES]);
         VolumeLineSegIntersectResult *res = &lineQuery->m_resBuffer[lineQuery->m_resCount];
         TriangleKDTreeProcedural::Triangle &tri = m_tris[index];
         Vector3  v0, v1, v2;
@@ -287,6 +288,11 @@ TriangleKDTreeProcedural::LineIntersectionQueryThis(VolumeLineQuery *lineQuery,
         }
     }
 
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    lineQuery->m_counters.m_counts[QueryCounters::KDTREE_NODES] += mapQuery->GetNumNodesVisited();
+    mapQuery->ResetNumNodesVisited();
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+
     // Return false if we failed to complete query due to lack of buffer space (will resume later).
     return static_cast<RwpBool>(lineQuery->m_resCount < lineQuery->m_resMax);
 }
@@ -332,6 +338,7 @@ TriangleKDTreeProcedural::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
           && (bboxQuery->m_primNext <  bboxQuery->m_primBufferSize)
            && mapQuery->GetNext(index))
     {
+        rwcQUERYSTATS(++bboxQuery->m_counters.m_counts[QueryCounters::TRIANGLES]);
         Vector3 v[3], vtemp[3], *vw;
         TriangleKDTreeProcedural::Triangle &tri = m_tris[index];
 
@@ -373,6 +380,11 @@ TriangleKDTreeProcedural::BBoxOverlapQueryThis(VolumeBBoxQuery *bboxQuery,
         bboxQuery->AddPrimitiveRef(vol, tm, bb, tag, static_cast<uint8_t>(numTagBits));
     }
 
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    bboxQuery->m_counters.m_counts[QueryCounters::KDTREE_NODES] += mapQuery->GetNumNodesVisited();
+    mapQuery->ResetNumNodesVisited();
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+
     RwpBool outOfPrimitiveSpace = static_cast<RwpBool>(bboxQuery->m_primNext >= bboxQuery->m_primBufferSize);
     RwpBool outOfInstanceSpace = static_cast<RwpBool>(bboxQuery->m_instVolCount >= bboxQuery->m_instVolMax);
     if (outOfPrimitiveSpace)
@@ -12,6 +12,7 @@ Purpose: Contain shared detail functionality between ClusteredMeshCluster techno
 #include "rw/collision/common.h"
 #include "rw/collision/triangle.h"
 #include "rw/collision/clustertriangleiterator.h"
+#include "rw/collision/metrics.h"
 
 namespace rw
 {
@@ -42,6 +43,33 @@ InitializeTriangleVolumeDetails(
     triangleVolume.SetEdgeCos(edgeCosines.X(), edgeCosines.Y(), edgeCosines.Z());
 }
 
+
+#if RW_COLLISION_DETAIL_QUERY_STATS
+
+/**
+\internal Adds the work of a cluster traversal to the counters of a query, together with the KDTree branch
+nodes processed by the spatial map query since the last call.
+
+This method is templated on the spatial map query type so that it can be used with line and bbox queries.
+
+\param queryCounters the counters of the line or bbox query.
+\param counters the work counted during the traversal.
+\param mapQuery the spatial map query of the traversal.
+*/
+template <class MAPQUERY>
+static void
+AddClusterQueryCounters(
+    QueryCounters &queryCounters,
+    QueryCounters &counters,
+    MAPQUERY &mapQuery)
+{
+    counters.m_counts[QueryCounters::KDTREE_NODES] += mapQuery.GetNumNodesVisited();
+    mapQuery.ResetNumNodesVisited();
+    queryCounters.Add(counters);
+}
+
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+
 } // namespace collision
 } // namespace rw
 
@@ -289,6 +289,266 @@ ComputeContacts_SortedGPInstancePair(GenericContactHandler& handler,
 }
 
 
+/*
+The per type pair kernels used by ComputeContactsBatch. Each is the body of one case of the sorted pair
+dispatch above, so a bucket can call it directly for every pair without switching on the types again.
+typeA of the pair must be the first type of the kernel name, typeB the second.
+*/
+#define BATCH_KERNEL_PARAMS GenericContactHandler& handler, \
+    const GPInstance& gpInstanceA, \
+    const GPInstance& gpInstanceB, \
+    VecFloatInParam minimumSeparatingDistance, \
+    VecFloatInParam cosSquaredMaximumAngleConsideredParallel, \
+    VecFloatInParam validDirectionMinimumLengthSquared, \
+    VecFloatInParam clippingLengthTolerance
+
+struct BatchKernel_SphereSphere
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(cosSquaredMaximumAngleConsideredParallel);
+        EA_UNUSED(clippingLengthTolerance);
+        return ComputeContactPointsSphereSphere_Generic(handler, SPHERE_DATA(A), SPHERE_DATA(B),
+            minimumSeparatingDistance, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_CapsuleSphere
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(cosSquaredMaximumAngleConsideredParallel);
+        EA_UNUSED(clippingLengthTolerance);
+        handler.SetCapsuleA(static_cast<const GPCapsule*>(&gpInstanceA));
+        return ComputeContactPointsCapsuleSphere_Generic(handler, CAPSULE_DATA(A), SPHERE_DATA(B),
+            minimumSeparatingDistance, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_CapsuleCapsule
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(clippingLengthTolerance);
+        handler.SetCapsuleA(static_cast<const GPCapsule*>(&gpInstanceA));
+        handler.SetCapsuleB(static_cast<const GPCapsule*>(&gpInstanceB));
+        return ComputeContactPointsCapsuleCapsule_Generic(handler, CAPSULE_DATA(A), CAPSULE_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_TriangleSphere
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(cosSquaredMaximumAngleConsideredParallel);
+        EA_UNUSED(clippingLengthTolerance);
+        handler.SetTriangleA(static_cast<const GPTriangle*>(&gpInstanceA), gpInstanceB.Fatness());
+        return ComputeContactPointsTriangleSphere_Generic(handler, TRIANGLE_DATA(A), SPHERE_DATA(B),
+            minimumSeparatingDistance, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_TriangleCapsule
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(clippingLengthTolerance);
+        handler.SetTriangleA(static_cast<const GPTriangle*>(&gpInstanceA), gpInstanceB.Fatness());
+        handler.SetCapsuleB(static_cast<const GPCapsule*>(&gpInstanceB));
+        return ComputeContactPointsTriangleCapsule_Generic(handler, TRIANGLE_DATA(A), CAPSULE_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_TriangleTriangle
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        handler.SetTriangleA(static_cast<const GPTriangle*>(&gpInstanceA), gpInstanceB.Fatness());
+        handler.SetTriangleB(static_cast<const GPTriangle*>(&gpInstanceB), gpInstanceA.Fatness());
+        return ComputeContactPointsTriangleTriangle_Generic(handler, TRIANGLE_DATA(A), TRIANGLE_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared, clippingLengthTolerance);
+    }
+};
+
+struct BatchKernel_BoxSphere
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(cosSquaredMaximumAngleConsideredParallel);
+        EA_UNUSED(clippingLengthTolerance);
+        DECLARE_BOX_DATA(A);
+        return ComputeContactPointsBoxSphere_Generic(handler, BOX_DATA(A), SPHERE_DATA(B),
+            minimumSeparatingDistance, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_BoxCapsule
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(clippingLengthTolerance);
+        DECLARE_BOX_DATA(A);
+        handler.SetCapsuleB(static_cast<const GPCapsule*>(&gpInstanceB));
+        return ComputeContactPointsBoxCapsule_Generic(handler, BOX_DATA(A), CAPSULE_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_BoxTriangle
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        DECLARE_BOX_DATA(A);
+        handler.SetTriangleB(static_cast<const GPTriangle*>(&gpInstanceB), gpInstanceA.Fatness());
+        handler.SwapAB();
+        return ComputeContactPointsTriangleBox_Generic(handler, TRIANGLE_DATA(B), BOX_DATA(A),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared, clippingLengthTolerance);
+    }
+};
+
+struct BatchKernel_BoxBox
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        DECLARE_BOX_DATA(A);
+        DECLARE_BOX_DATA(B);
+        return ComputeContactPointsBoxBox_Generic(handler, BOX_DATA(A), BOX_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared, clippingLengthTolerance);
+    }
+};
+
+struct BatchKernel_CylinderSphere
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(cosSquaredMaximumAngleConsideredParallel);
+        EA_UNUSED(clippingLengthTolerance);
+        return ComputeContactPointsCylinderSphere_Generic(handler, CYLINDER_DATA(A), SPHERE_DATA(B),
+            minimumSeparatingDistance, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_CylinderCapsule
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        EA_UNUSED(clippingLengthTolerance);
+        handler.SetCapsuleB(static_cast<const GPCapsule*>(&gpInstanceB));
+        return ComputeContactPointsCylinderCapsule_Generic(handler, CYLINDER_DATA(A), CAPSULE_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared);
+    }
+};
+
+struct BatchKernel_CylinderTriangle
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        handler.SetTriangleB(static_cast<const GPTriangle*>(&gpInstanceB), gpInstanceA.Fatness());
+        return ComputeContactPointsCylinderTriangle_Generic(handler, CYLINDER_DATA(A), TRIANGLE_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared, clippingLengthTolerance);
+    }
+};
+
+struct BatchKernel_CylinderBox
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        DECLARE_BOX_DATA(B);
+        return ComputeContactPointsCylinderBox_Generic(handler, CYLINDER_DATA(A), BOX_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared, clippingLengthTolerance);
+    }
+};
+
+struct BatchKernel_CylinderCylinder
+{
+    static EA_FORCE_INLINE uint32_t Compute(BATCH_KERNEL_PARAMS)
+    {
+        return ComputeContactPointsCylinderCylinder_Generic(handler, CYLINDER_DATA(A), CYLINDER_DATA(B),
+            minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared, clippingLengthTolerance);
+    }
+};
+
+#undef BATCH_KERNEL_PARAMS
+
+
+/**
+Run one bucket of ComputeContactsBatch through a single kernel. Every pair in the bucket has the sorted types
+of the kernel, so the only per pair decision left is whether a and b have to be swapped.
+\return the number of results written so far, including those from earlier buckets.
+*/
+template <class Kernel>
+static uint32_t
+ComputeContactsBatch_Bucket(const GPInstancePair *pairs,
+                            const uint32_t *bucketPairIndices,
+                            uint32_t bucketSize,
+                            GPInstance::VolumeType sortedTypeA,
+                            GPInstance::ContactPoints *results,
+                            uint32_t *resultPairIndices,
+                            uint32_t numResults,
+                            uint32_t maxResults,
+                            VecFloatInParam minimumSeparatingDistance,
+                            VecFloatInParam edgeCosBendNormalThreshold,
+                            VecFloatInParam convexityEpsilon,
+                            VecFloatInParam triangleFaceNormalTolerance,
+                            VecFloatInParam featureSimplificationThreshold,
+                            VecFloatInParam cosSquaredMaximumAngleConsideredParallel,
+                            VecFloatInParam validDirectionMinimumLengthSquared,
+                            VecFloatInParam clippingLengthTolerance)
+{
+    const uint32_t stride = 2;
+    const uint32_t maxCount = sizeof(results->pointPairs) / sizeof(*results->pointPairs);
+
+    for (uint32_t j = 0; j < bucketSize && numResults < maxResults; ++j)
+    {
+        const uint32_t pairIndex = bucketPairIndices[j];
+        const GPInstance &gpInstanceA = *pairs[pairIndex].a;
+        const GPInstance &gpInstanceB = *pairs[pairIndex].b;
+        GPInstance::ContactPoints &result = results[numResults];
+
+        GenericContactHandler handler(&result.normal, &result.pointPairs[0].p1, &result.pointPairs[0].p2, maxCount, stride);
+
+        handler.SetFilterToleranceValues(edgeCosBendNormalThreshold, convexityEpsilon,
+                                         triangleFaceNormalTolerance, featureSimplificationThreshold);
+
+        uint32_t ok;
+        if (gpInstanceA.Type() == sortedTypeA)
+        {
+            ok = Kernel::Compute(handler, gpInstanceA, gpInstanceB,
+                                 minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel,
+                                 validDirectionMinimumLengthSquared, clippingLengthTolerance);
+        }
+        else
+        {
+            handler.SwapAB();
+            ok = Kernel::Compute(handler, gpInstanceB, gpInstanceA,
+                                 minimumSeparatingDistance, cosSquaredMaximumAngleConsideredParallel,
+                                 validDirectionMinimumLengthSquared, clippingLengthTolerance);
+        }
+
+        if (ok)
+        {
+            result.numPoints = handler.GetNumberOfPoints();
+            if (result.numPoints > 0)
+            {
+                result.userTag1 = gpInstanceA.mUserTag;
+                result.userTag2 = gpInstanceB.mUserTag;
+                result.volumeTag1 = gpInstanceA.mVolumeTag;
+                result.volumeTag2 = gpInstanceB.mVolumeTag;
+                if (resultPairIndices)
+                {
+                    resultPairIndices[numResults] = pairIndex;
+                }
+                ++numResults;
+            }
+        }
+    }
+
+    return numResults;
+}
+
+
 /* remove macros no longer needed - to make bulkbuild safer. */
 #undef SPHERE_DATA
 #undef CAPSULE_DATA
@@ -381,6 +641,134 @@ ComputeContacts(const GPInstance& gpInstanceA, const GPInstance& gpInstanceB,
 }
 
 
+/**
+\brief Compute contact points for a batch of gp instance pairs.
+
+The pairs are first bucketed by their (sorted) pair of volume types using a counting sort into the
+workspace. The contact kernel for a bucket is chosen once, and the bucket is then processed in a loop which
+calls that kernel directly, so the per pair type dispatch of ComputeContacts is not repeated. The kernels
+themselves still process one pair at a time; the batch does not transpose the pairs into SIMD lanes.
+
+Results are written in bucket order (by the larger type of the pair, then the smaller) and in input order
+within a bucket, so the output is deterministic for a given input. Pairs which generate no contacts do not
+produce a result. Each result has the same contents ComputeContacts would have written for that pair, with
+gp instance a as the first volume.
+
+\param pairs              the array of pairs to process.
+\param numPairs           the number of pairs.
+\param results            output array of at least maxResults contact points.
+\param resultPairIndices  optional output array of at least maxResults entries, receives for each result the
+                          index into pairs of the pair that generated it. May be NULL.
+\param maxResults         the capacity of results. Processing stops when it is full.
+\param workspace          scratch array of at least ComputeContactsBatchWorkspaceSize(numPairs) entries.
+\return the number of results written.
+*/
+uint32_t
+ComputeContactsBatch(const GPInstancePair *pairs,
+                     uint32_t numPairs,
+                     GPInstance::ContactPoints *results,
+                     uint32_t *resultPairIndices,
+                     uint32_t maxResults,
+                     uint32_t *workspace,
+                     VecFloatInParam minimumSeparatingDistance,
+                     VecFloatInParam edgeCosBendNormalThreshold,
+                     VecFloatInParam convexityEpsilon,
+                     VecFloatInParam triangleFaceNormalTolerance,
+                     VecFloatInParam featureSimplificationThreshold,
+                     VecFloatInParam cosSquaredMaximumAngleConsideredParallel,
+                     VecFloatInParam validDirectionMinimumLengthSquared,
+                     VecFloatInParam clippingLengthTolerance)
+{
+    EA_ASSERT(numPairs == 0 || (pairs != NULL && workspace != NULL));
+    EA_ASSERT(maxResults == 0 || results != NULL);
+
+    const uint32_t numTypes = GPInstance::NUMINTERNALTYPES;
+    const uint32_t numBuckets = numTypes * numTypes;
+
+    // Count the pairs in each bucket. The key is (larger type, smaller type), the order of the sorted dispatch.
+    uint32_t bucketStart[numBuckets + 1];
+    for (uint32_t i = 0; i <= numBuckets; ++i)
+    {
+        bucketStart[i] = 0;
+    }
+
+    for (uint32_t i = 0; i < numPairs; ++i)
+    {
+        uint32_t typeA = static_cast<uint32_t>(pairs[i].a->Type());
+        uint32_t typeB = static_cast<uint32_t>(pairs[i].b->Type());
+        EA_ASSERT(typeA < numTypes && typeB < numTypes);
+        uint32_t key = (typeA < typeB) ? (typeB * numTypes + typeA) : (typeA * numTypes + typeB);
+        ++bucketStart[key + 1];
+    }
+
+    for (uint32_t i = 0; i < numBuckets; ++i)
+    {
+        bucketStart[i + 1] += bucketStart[i];
+    }
+
+    // Scatter the pair indices into the workspace, stable within each bucket.
+    uint32_t bucketNext[numBuckets];
+    for (uint32_t i = 0; i < numBuckets; ++i)
+    {
+        bucketNext[i] = bucketStart[i];
+    }
+
+    for (uint32_t i = 0; i < numPairs; ++i)
+    {
+        uint32_t typeA = static_cast<uint32_t>(pairs[i].a->Type());
+        uint32_t typeB = static_cast<uint32_t>(pairs[i].b->Type());
+        uint32_t key = (typeA < typeB) ? (typeB * numTypes + typeA) : (typeA * numTypes + typeB);
+        workspace[bucketNext[key]++] = i;
+    }
+
+    uint32_t numResults = 0;
+
+#define BATCH_BUCKET(TYPEA, TYPEB, KERNEL) \
+    case GPInstance::TYPEA * numTypes + GPInstance::TYPEB: \
+        numResults = ComputeContactsBatch_Bucket<KERNEL>(pairs, workspace + bucketStart[key], \
+            bucketStart[key + 1] - bucketStart[key], GPInstance::TYPEA, results, resultPairIndices, numResults, maxResults, \
+            minimumSeparatingDistance, edgeCosBendNormalThreshold, convexityEpsilon, triangleFaceNormalTolerance, \
+            featureSimplificationThreshold, cosSquaredMaximumAngleConsideredParallel, validDirectionMinimumLengthSquared, \
+            clippingLengthTolerance); \
+        break
+
+    // The kernel is resolved once per bucket. The buckets with UNUSED volumes are skipped, they never generate contacts.
+    for (uint32_t key = numTypes + 1; key < numBuckets && numResults < maxResults; ++key)
+    {
+        if (bucketStart[key] == bucketStart[key + 1])
+        {
+            continue;
+        }
+
+        switch (key)
+        {
+        BATCH_BUCKET(SPHERE, SPHERE, BatchKernel_SphereSphere);
+        BATCH_BUCKET(CAPSULE, SPHERE, BatchKernel_CapsuleSphere);
+        BATCH_BUCKET(CAPSULE, CAPSULE, BatchKernel_CapsuleCapsule);
+        BATCH_BUCKET(TRIANGLE, SPHERE, BatchKernel_TriangleSphere);
+        BATCH_BUCKET(TRIANGLE, CAPSULE, BatchKernel_TriangleCapsule);
+        BATCH_BUCKET(TRIANGLE, TRIANGLE, BatchKernel_TriangleTriangle);
+        BATCH_BUCKET(BOX, SPHERE, BatchKernel_BoxSphere);
+        BATCH_BUCKET(BOX, CAPSULE, BatchKernel_BoxCapsule);
+        BATCH_BUCKET(BOX, TRIANGLE, BatchKernel_BoxTriangle);
+        BATCH_BUCKET(BOX, BOX, BatchKernel_BoxBox);
+        BATCH_BUCKET(CYLINDER, SPHERE, BatchKernel_CylinderSphere);
+        BATCH_BUCKET(CYLINDER, CAPSULE, BatchKernel_CylinderCapsule);
+        BATCH_BUCKET(CYLINDER, TRIANGLE, BatchKernel_CylinderTriangle);
+        BATCH_BUCKET(CYLINDER, BOX, BatchKernel_CylinderBox);
+        BATCH_BUCKET(CYLINDER, CYLINDER, BatchKernel_CylinderCylinder);
+        default:
+            // A pair with an UNUSED volume.
+            break;
+        }
+    }
+
+#undef BATCH_BUCKET
+
+    return numResults;
+}
+
+
 /**
 Compute contact points between two gp instance.
 \return 1 if any contacts were generated, 0 if no contacts.
@@ -0,0 +1,111 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwcdistancequery.cpp
+
+ Purpose: Closest point on a triangle to a point.
+
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include "rw/collision/distancequery.h"
+
+using namespace rwpmath;
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\brief
+Finds the point on a triangle closest to a point.
+
+The Voronoi regions of the vertices and edges are tested in turn, so the result also identifies the feature
+of the triangle on which the closest point lies. Degenerate triangles are handled by the vertex and edge
+regions.
+
+\param closestPoint Set to the point on the triangle closest to \a point.
+\param point        The query point.
+\param v0           The first vertex of the triangle.
+\param v1           The second vertex of the triangle.
+\param v2           The third vertex of the triangle.
+
+\return The feature of the triangle on which the closest point lies.
+*/
+DistanceQueryResult::Feature
+TriangleClosestPoint(Vector3 &closestPoint,
+                     Vector3::InParam point,
+                     Vector3::InParam v0,
+                     Vector3::InParam v1,
+                     Vector3::InParam v2)
+{
+    const Vector3 e01 = v1 - v0;
+    const Vector3 e02 = v2 - v0;
+
+    // Vertex 0 region
+    const Vector3 p0 = point - v0;
+    const float d1 = Dot(e01, p0);
+    const float d2 = Dot(e02, p0);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+    {
+        closestPoint = v0;
+        return DistanceQueryResult::FEATURE_VERTEX0;
+    }
+
+    // Vertex 1 region
+    const Vector3 p1 = point - v1;
+    const float d3 = Dot(e01, p1);
+    const float d4 = Dot(e02, p1);
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+        closestPoint = v1;
+        return DistanceQueryResult::FEATURE_VERTEX1;
+    }
+
+    // Edge 0 region, from v0 to v1
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        closestPoint = v0 + e01 * (d1 / (d1 - d3));
+        return DistanceQueryResult::FEATURE_EDGE0;
+    }
+
+    // Vertex 2 region
+    const Vector3 p2 = point - v2;
+    const float d5 = Dot(e01, p2);
+    const float d6 = Dot(e02, p2);
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+        closestPoint = v2;
+        return DistanceQueryResult::FEATURE_VERTEX2;
+    }
+
+    // Edge 2 region, from v2 to v0
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        closestPoint = v0 + e02 * (d2 / (d2 - d6));
+        return DistanceQueryResult::FEATURE_EDGE2;
+    }
+
+    // Edge 1 region, from v1 to v2
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+        closestPoint = v1 + (v2 - v1) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        return DistanceQueryResult::FEATURE_EDGE1;
+    }
+
+    // Face region
+    const float denom = 1.0f / (va + vb + vc);
+    closestPoint = v0 + e01 * (vb * denom) + e02 * (vc * denom);
+    return DistanceQueryResult::FEATURE_FACE;
+}
+
+
+} // namespace collision
+} // namespace rw
@@ -13,6 +13,7 @@
 
 #include "rw/collision/primitivepairquery.h"
 #include "rw/collision/computecontacts.h"
+#include "rw/collision/metrics.h"
 
 
 /* Use platform specific maths */
@@ -37,6 +38,25 @@ VecFloat gDefaultCosSquaredMaximumAngleConsideredParallel = COMPUTECONTACTS_DEFA
 VecFloat gDefaultValidDirectionMinimumLengthSquared =       COMPUTECONTACTS_DEFAULT_ValidDirectionMinimumLengthSquared;
 VecFloat gDefaultClippingLengthTolerance =                  COMPUTECONTACTS_DEFAULT_ClippingLengthTolerance;
 
+
+/**
+\internal
+Adds a number of primitive pair tests to the optional counters passed to the batch intersection functions.
+*/
+static inline void
+AddPrimitiveTests(QueryCounters *counters, int32_t numTests)
+{
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    if (counters)
+    {
+        counters->m_counts[QueryCounters::PRIMITIVE_TESTS] += (uint32_t) numTests;
+    }
+#else // RW_COLLISION_DETAIL_QUERY_STATS
+    EA_UNUSED(counters);
+    EA_UNUSED(numTests);
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+}
+
 // ***********************************************************************************************************
 // Static Variables + Static Data Member Definitions
 
@@ -316,6 +336,7 @@ are both stored in contiguous arrays in memory.
 \param num
 \param edgeCosBendNormalThreshold  do bent-normal processing if edgecos is below this threshold
 \param convexityEpsilon  Accept the contact if the dot is within this tolerance of the edgeCos
+\param counters  Optional counters the primitive pair tests are added to, may be NULL
 
 \return The total number of intersections found.
 */
@@ -326,7 +347,8 @@ PrimitiveBatchIntersect1xN( PrimitivePairIntersectResult *resBuf,
                             const Volume *v1, const Matrix44Affine *tm1,
                             const Volume *vN, const Matrix44Affine *tmN, int32_t num,
                             float edgeCosBendNormalThreshold,
-                            float convexityEpsilon )
+                            float convexityEpsilon,
+                            QueryCounters *counters )
 {
     rwcDEPRECATED("This internal api will be removed next release.");
     int32_t vi;
@@ -343,6 +365,8 @@ PrimitiveBatchIntersect1xN( PrimitivePairIntersectResult *resBuf,
         vN[vi].CreateGPInstance( instN[vi], &tmN[vi] );
     }
 
+    AddPrimitiveTests( counters, num );
+
     return  GPInstanceBatchIntersect1xN( resBuf, resBufMaxSize, inst1, instN, num, 
         gDefaultMinimumSeparatingDistance, edgeCosBendNormalThreshold, convexityEpsilon ) ;
 }
@@ -366,6 +390,7 @@ so there is no assumption made about the arrangement of the volumes or their TMs
 \param num
 \param edgeCosBendNormalThreshold  do bent-normal processing if edgecos is below this threshold
 \param convexityEpsilon  Accept the contact if the dot is within this tolerance of the edgeCos
+\param counters  Optional counters the primitive pair tests are added to, may be NULL
 
 \return The total number of intersections found.
 */
@@ -376,7 +401,8 @@ PrimitiveBatchIntersect1xN( PrimitivePairIntersectResult *resBuf,
                             const Volume *v1, const Matrix44Affine *tm1,
                             const Volume **vN, const Matrix44Affine **tmN, int32_t num,
                             float edgeCosBendNormalThreshold,
-                            float convexityEpsilon )
+                            float convexityEpsilon,
+                            QueryCounters *counters )
 {
     rwcDEPRECATED("This internal api will be removed next release.");
     int32_t vi;
@@ -393,6 +419,8 @@ PrimitiveBatchIntersect1xN( PrimitivePairIntersectResult *resBuf,
         vN[vi]->CreateGPInstance( instN[vi], tmN[vi] );
     }
 
+    AddPrimitiveTests( counters, num );
+
     return  GPInstanceBatchIntersect1xN( resBuf, resBufMaxSize, inst1, instN, num, 
         gDefaultMinimumSeparatingDistance, edgeCosBendNormalThreshold, convexityEpsilon ) ;
 }
@@ -415,6 +443,7 @@ so there is no assumption made about the arrangement of the volumes or their TMs
 \param numM
 \param edgeCosBendNormalThreshold  do bent-normal processing if edgecos is below this threshold
 \param convexityEpsilon  Accept the contact if the dot is within this tolerance of the edgeCos
+\param counters  Optional counters the primitive pair tests are added to, may be NULL
 \return The total number of intersections found.
 
 PLEASE NOTE: the instancingSPR is a memory area used by this function to convert volumes into GPInstance,
@@ -430,7 +459,8 @@ PrimitiveBatchIntersectNxM( PrimitivePairIntersectResult *resBuf,
                             const Volume **vN, const Matrix44Affine **tmN, int32_t numN,
                             const Volume **vM, const Matrix44Affine **tmM, int32_t numM,
                             float edgeCosBendNormalThreshold,
-                            float convexityEpsilon )
+                            float convexityEpsilon,
+                            QueryCounters *counters )
 {
     int32_t vni, vmi;
 
@@ -443,6 +473,8 @@ PrimitiveBatchIntersectNxM( PrimitivePairIntersectResult *resBuf,
         vN[vni]->CreateGPInstance( instN[vni], tmN[vni] );
     }
 
+    AddPrimitiveTests( counters, numN * numM );
+
     int32_t numIntersections = 0;
     int32_t bufPos = 0;
     for ( vmi = 0;  vmi < numM;  vmi++ )
@@ -466,6 +498,259 @@ PrimitiveBatchIntersectNxM( PrimitivePairIntersectResult *resBuf,
 /**
 \internal
 
+\brief
+Instance both batches of an NxM test, the N volumes into instancingSPR[0..numN) and the M volumes into
+instancingSPR[numN..numN+numM). This is the layout PrimitiveBatchIntersectNxMTile expects.
+
+\param instancingSPR memory for at least (numN + numM) GPInstances
+\param vN
+\param tmN
+\param numN
+\param vM
+\param tmM
+\param numM
+*/
+void
+PrimitiveBatchInstanceNxM( GPInstance *instancingSPR,
+                           const Volume **vN, const Matrix44Affine **tmN, int32_t numN,
+                           const Volume **vM, const Matrix44Affine **tmM, int32_t numM )
+{
+    GPInstance *instN = instancingSPR;
+    GPInstance *instM = instancingSPR+numN;
+
+    for ( int32_t vni = 0;  vni < numN;  vni++ )
+    {
+        EA_ASSERT(IsVolumeTypeValid(vN[vni]->GetType()));
+        vN[vni]->CreateGPInstance( instN[vni], tmN[vni] );
+    }
+
+    for ( int32_t vmi = 0;  vmi < numM;  vmi++ )
+    {
+        EA_ASSERT(IsVolumeTypeValid(vM[vmi]->GetType()));
+        vM[vmi]->CreateGPInstance( instM[vmi], tmM[vmi] );
+    }
+}
+
+/**
+\internal
+
+\brief
+Returns the number of tiles an NxM test is split into, when each tile covers tileSize of the N instances
+and tileSize of the M instances.
+*/
+int32_t
+PrimitiveBatchIntersectNxMGetNumTiles( int32_t numN, int32_t numM, int32_t tileSize )
+{
+    EA_ASSERT(tileSize > 0);
+    const int32_t numNBlocks = (numN + tileSize - 1) / tileSize;
+    const int32_t numMBlocks = (numM + tileSize - 1) / tileSize;
+    return numNBlocks * numMBlocks;
+}
+
+/**
+\internal
+
+\brief
+Test one tile of an NxM batch which has been instanced with PrimitiveBatchInstanceNxM.
+
+The tiles are numbered with the N blocks varying fastest. Within a tile the pairs are tested in the same
+order as PrimitiveBatchIntersectNxM, each M instance against the tile's range of N instances, and each
+result has vNindex set to the index of the N volume in the whole batch.
+
+The function only reads instancingSPR and writes resBuf, so tiles can be run concurrently on any job
+system as long as each tile is given its own result buffer (or its own slice of a shared one), and its own
+counters if it counts its tests.
+When resBuf fills up the remaining pairs of the tile are still tested so that the return value counts
+every intersection, which lets the caller size the buffers for the next batch.
+
+\param resBuf
+\param resBufMaxSize
+\param instancingSPR instances written by PrimitiveBatchInstanceNxM
+\param numN
+\param numM
+\param tileIndex index of the tile, less than PrimitiveBatchIntersectNxMGetNumTiles(numN, numM, tileSize)
+\param tileSize
+\param edgeCosBendNormalThreshold  do bent-normal processing if edgecos is below this threshold
+\param convexityEpsilon  Accept the contact if the dot is within this tolerance of the edgeCos
+\param counters  Optional counters the primitive pair tests are added to, may be NULL
+\return The number of intersections found in the tile.
+*/
+int32_t
+PrimitiveBatchIntersectNxMTile( PrimitivePairIntersectResult *resBuf,
+                                int32_t resBufMaxSize,
+                                const GPInstance *instancingSPR,
+                                int32_t numN, int32_t numM,
+                                int32_t tileIndex,
+                                int32_t tileSize,
+                                float edgeCosBendNormalThreshold,
+                                float convexityEpsilon,
+                                QueryCounters *counters )
+{
+    EA_ASSERT(tileSize > 0);
+    EA_ASSERT(tileIndex >= 0 && tileIndex < PrimitiveBatchIntersectNxMGetNumTiles(numN, numM, tileSize));
+
+    const GPInstance *instN = instancingSPR;
+    const GPInstance *instM = instancingSPR+numN;
+
+    const int32_t numNBlocks = (numN + tileSize - 1) / tileSize;
+    const int32_t nBegin = (tileIndex % numNBlocks) * tileSize;
+    const int32_t mBegin = (tileIndex / numNBlocks) * tileSize;
+    const int32_t nEnd = Min(nBegin + tileSize, numN);
+    const int32_t mEnd = Min(mBegin + tileSize, numM);
+
+    AddPrimitiveTests( counters, (nEnd - nBegin) * (mEnd - mBegin) );
+
+    const VecFloat minimumSeparatingDistanceVec = gDefaultMinimumSeparatingDistance;
+
+    // Results which do not fit are computed here so they can still be counted.
+    PrimitivePairIntersectResult overflowResult;
+
+    int32_t numIntersections = 0;
+    for ( int32_t vmi = mBegin;  vmi < mEnd;  vmi++ )
+    {
+        for ( int32_t vni = nBegin;  vni < nEnd;  vni++ )
+        {
+            PrimitivePairIntersectResult &result = (numIntersections < resBufMaxSize) ? resBuf[numIntersections] : overflowResult;
+
+            uint32_t hit = ComputeContacts(instM[vmi], instN[vni], result, minimumSeparatingDistanceVec,
+                                            edgeCosBendNormalThreshold,
+                                            convexityEpsilon,
+                                            gDefaultTriangleFaceNormalTolerance,
+                                            gDefaultFeatureSimplificationThreshold,
+                                            gDefaultCosSquaredMaximumAngleConsideredParallel,
+                                            gDefaultValidDirectionMinimumLengthSquared,
+                                            gDefaultClippingLengthTolerance);
+
+            result.vNindex = vni;
+            numIntersections += (int32_t) hit;
+        }
+    }
+
+    return numIntersections;
+}
+
+/**
+\internal
+
+\brief
+Gather the results of the tiles of an NxM batch into a single buffer. The results are copied in tile order,
+so the output does not depend on which thread ran which tile or when.
+
+The tile result buffers may be consecutive slices of resBuf itself, in tile order, in which case the
+results are compacted in place.
+
+\param resBuf
+\param resBufMaxSize
+\param tileResBufs the result buffer passed to PrimitiveBatchIntersectNxMTile for each tile
+\param tileResBufMaxSizes the size of each tile result buffer
+\param tileNumIntersections the value returned by PrimitiveBatchIntersectNxMTile for each tile
+\param numTiles
+\param numWritten if not NULL receives the number of results written to resBuf
+\return The total number of intersections found. If this is more than the number written then
+        intersections were lost, either in the tile buffers or in resBuf.
+*/
+int32_t
+PrimitiveBatchIntersectNxMMergeTiles( PrimitivePairIntersectResult *resBuf,
+                                      int32_t resBufMaxSize,
+                                      PrimitivePairIntersectResult * const *tileResBufs,
+                                      const int32_t *tileResBufMaxSizes,
+                                      const int32_t *tileNumIntersections,
+                                      int32_t numTiles,
+                                      int32_t *numWritten )
+{
+    int32_t numIntersections = 0;
+    int32_t bufPos = 0;
+
+    for ( int32_t ti = 0;  ti < numTiles;  ti++ )
+    {
+        const int32_t numTileResults = Min(tileNumIntersections[ti], tileResBufMaxSizes[ti]);
+        const int32_t numToCopy = Min(numTileResults, resBufMaxSize - bufPos);
+        const PrimitivePairIntersectResult *src = tileResBufs[ti];
+
+        if ( src != resBuf + bufPos )
+        {
+            // Forward copy is safe when the tiles are slices of resBuf, bufPos never passes the tile start.
+            for ( int32_t i = 0;  i < numToCopy;  i++ )
+            {
+                resBuf[bufPos + i] = src[i];
+            }
+        }
+
+        bufPos += numToCopy;
+        numIntersections += tileNumIntersections[ti];
+    }
+
+    if ( numIntersections > bufPos )
+    {
+        EAPHYSICS_MESSAGE("PrimitiveBatchIntersectNxMMergeTiles: Only %d of %d intersections fitted in the result buffers...intersections will be lost.",
+            bufPos, numIntersections);
+    }
+
+    if ( numWritten )
+    {
+        *numWritten = bufPos;
+    }
+
+    return numIntersections;
+}
+
+/**
+\brief
+Given two batches of volumes, test them N-versus-M in cache sized tiles and put the results into the buffer
+provided by the caller. Each side is instanced once up front, then the tiles are run in order straight
+into resBuf. The results are the same, and in the same order, as running every tile with
+PrimitiveBatchIntersectNxMTile and gathering them with PrimitiveBatchIntersectNxMMergeTiles.
+
+\param resBuf
+\param resBufMaxSize
+\param instancingSPR memory for at least (numN + numM) GPInstances
+\param vN
+\param tmN
+\param numN
+\param vM
+\param tmM
+\param numM
+\param tileSize
+\param edgeCosBendNormalThreshold  do bent-normal processing if edgecos is below this threshold
+\param convexityEpsilon  Accept the contact if the dot is within this tolerance of the edgeCos
+\param counters  Optional counters the primitive pair tests are added to, may be NULL
+\return The total number of intersections found, more than resBufMaxSize if intersections were lost.
+*/
+int32_t
+PrimitiveBatchIntersectNxMTiled( PrimitivePairIntersectResult *resBuf,
+                                 int32_t resBufMaxSize,
+                                 GPInstance *instancingSPR,
+                                 const Volume **vN, const Matrix44Affine **tmN, int32_t numN,
+                                 const Volume **vM, const Matrix44Affine **tmM, int32_t numM,
+                                 int32_t tileSize,
+                                 float edgeCosBendNormalThreshold,
+                                 float convexityEpsilon,
+                                 QueryCounters *counters )
+{
+    PrimitiveBatchInstanceNxM( instancingSPR, vN, tmN, numN, vM, tmM, numM );
+
+    const int32_t numTiles = PrimitiveBatchIntersectNxMGetNumTiles( numN, numM, tileSize );
+
+    int32_t numIntersections = 0;
+    int32_t bufPos = 0;
+    for ( int32_t ti = 0;  ti < numTiles;  ti++ )
+    {
+        numIntersections += PrimitiveBatchIntersectNxMTile( resBuf+bufPos,
+                                                            resBufMaxSize-bufPos,
+                                                            instancingSPR, numN, numM,
+                                                            ti, tileSize,
+                                                            edgeCosBendNormalThreshold,
+                                                            convexityEpsilon,
+                                                            counters );
+        bufPos = Min(numIntersections, resBufMaxSize);
+    }
+
+    return numIntersections;
+}
+
+/**
+\internal
+
 \brief
 Given an array of VolRefPairs and a result buffer resBuf, test all the pairs for
 intersections and put the positive results into resBuf. This function accepts the maximum
@@ -479,6 +764,7 @@ number of results it's allowed to put into resBuf.
 \param minimumSeparatingDistance minimum separating distance between any two primitives for which contacts will NOT be generated.
 \param edgeCosBendNormalThreshold  do bent-normal processing if edgecos is below this threshold
 \param convexityEpsilon  Accept the contact if the dot is within this tolerance of the edgeCos
+\param counters  Optional counters the primitive pair tests are added to, may be NULL
 
 \Return The number of intersection results put into resBuf.
 */
@@ -490,7 +776,8 @@ PrimitiveBatchIntersect( PrimitivePairIntersectResult *resBuf,
                          int32_t numPairs,
                          float minimumSeparatingDistance,
                          float edgeCosBendNormalThreshold,
-                         float convexityEpsilon )
+                         float convexityEpsilon,
+                         QueryCounters *counters )
 {
     int32_t numIntersections = 0, numSpans = numPairs;
 
@@ -513,6 +800,8 @@ PrimitiveBatchIntersect( PrimitivePairIntersectResult *resBuf,
                 instancingSPR[1+overlap].mUserTag = curSpan->vRefsN[overlap]->tag;
             }
 
+            AddPrimitiveTests( counters, (int32_t)curSpan->vRefsNCount );
+
             if ( curSpan->volumesSwapped )
             {
                 numIntersections += GPInstanceBatchIntersectNx1( resBuf + numIntersections,
@@ -0,0 +1,202 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwcquerycontext.cpp
+
+ Purpose: Scratch arena handing out line, bbox and volume queries without heap allocation.
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include <new>
+
+#include "rw/collision/querycontext.h"
+#include "rw/collision/volumelinequery.h"
+#include "rw/collision/volumebboxquery.h"
+#include "rw/collision/volumevolumequery.h"
+
+
+namespace rw
+{
+namespace collision
+{
+
+
+/**
+\brief In place constructor.
+
+\note QueryContext objects should be created using QueryContext::Initialize and not constructed directly.
+
+\param arenaSize The number of bytes of scratch memory, which follows the object.
+
+\see QueryContext::GetResourceDescriptor
+*/
+QueryContext::QueryContext(uint32_t arenaSize)
+    : m_capacity(arenaSize),
+      m_used(0),
+      m_highWaterMark(0),
+      m_requiredSize(0),
+      m_numFailedRequests(0),
+      m_numRequests(0)
+{
+    m_arena = reinterpret_cast<uint8_t *>(this) +
+        EA::Physics::SizeAlign<uint32_t>(sizeof(QueryContext), rwcQUERYCONTEXT_ALIGNMENT);
+}
+
+
+/**
+\brief Gets the resource requirements of a QueryContext.
+
+\param arenaSize The number of bytes of scratch memory. The size of each query can be found from its
+       GetResourceDescriptor, plus up to its alignment in padding, or from QueryContext::GetRequiredSize
+       after running a representative workload.
+
+\return The EA::Physics::SizeAndAlignment
+*/
+EA::Physics::SizeAndAlignment
+QueryContext::GetResourceDescriptor(uint32_t arenaSize)
+{
+    uint32_t size = EA::Physics::SizeAlign<uint32_t>(sizeof(QueryContext), rwcQUERYCONTEXT_ALIGNMENT);
+    size += arenaSize;
+
+    return EA::Physics::SizeAndAlignment(size, rwcQUERYCONTEXT_ALIGNMENT);
+}
+
+
+/**
+\brief Initialize a EA::Physics::MemoryPtr as a QueryContext.
+
+\param resource The EA::Physics::MemoryPtr the QueryContext is initialized into.
+\param arenaSize The number of bytes of scratch memory.
+
+\see QueryContext::GetResourceDescriptor
+
+\return A ptr to the new QueryContext.
+*/
+QueryContext *
+QueryContext::Initialize(const EA::Physics::MemoryPtr &resource,
+                         uint32_t arenaSize)
+{
+    return new (resource.GetMemory()) QueryContext(arenaSize);
+}
+
+
+/**
+\brief Allocates scratch memory from the arena.
+
+The memory is released by QueryContext::ReleaseToMarker or QueryContext::Reset. If the arena is too
+small the request is recorded in QueryContext::GetRequiredSize and QueryContext::GetNumFailedRequests,
+and the arena is left unchanged, so later smaller requests may still succeed.
+
+\param resourceDescriptor The size and alignment of the memory.
+
+\return A ptr to the memory, or NULL if the arena is too small.
+*/
+void *
+QueryContext::Allocate(const EA::Physics::SizeAndAlignment &resourceDescriptor)
+{
+    const uint32_t alignment = resourceDescriptor.GetAlignment();
+    EA_ASSERT_MSG(alignment <= rwcQUERYCONTEXT_ALIGNMENT, ("Query context alignment is too small for the request."));
+
+    const uint32_t size = resourceDescriptor.GetSize();
+    const uint32_t start = EA::Physics::SizeAlign<uint32_t>(m_used, alignment);
+
+    // Compare against the space left so that a huge request cannot wrap the end offset
+    const uint32_t maxSize = 0xffffffffu - start;
+    const uint32_t end = (size > maxSize) ? 0xffffffffu : start + size;
+    if (end > m_requiredSize)
+    {
+        m_requiredSize = end;
+    }
+
+    if (start > m_capacity || size > m_capacity - start)
+    {
+        ++m_numFailedRequests;
+        EAPHYSICS_MESSAGE("QueryContext: Request for %u bytes failed, %u bytes are needed of %u.",
+            size, end, m_capacity);
+        return NULL;
+    }
+
+    m_used = end;
+    if (m_used > m_highWaterMark)
+    {
+        m_highWaterMark = m_used;
+    }
+    ++m_numRequests;
+
+    return m_arena + start;
+}
+
+
+/**
+\brief Creates a VolumeLineQuery in the arena.
+
+\param stackMax The max number of entries on the internal stack.
+\param resBufferSize The max number of results held in the output array.
+
+\see VolumeLineQuery::Initialize
+
+\return A ptr to the new query, or NULL if the arena is too small.
+*/
+VolumeLineQuery *
+QueryContext::CreateLineQuery(uint32_t stackMax,
+                              uint32_t resBufferSize)
+{
+    void *memory = Allocate(VolumeLineQuery::GetResourceDescriptor(stackMax, resBufferSize));
+    if (!memory)
+    {
+        return NULL;
+    }
+    return VolumeLineQuery::Initialize(EA::Physics::MemoryPtr(memory), stackMax, resBufferSize);
+}
+
+
+/**
+\brief Creates a VolumeBBoxQuery in the arena.
+
+\param stackMax The max number of entries on the internal stack.
+\param resBufferSize The max number of results held in the output array.
+
+\see VolumeBBoxQuery::Initialize
+
+\return A ptr to the new query, or NULL if the arena is too small.
+*/
+VolumeBBoxQuery *
+QueryContext::CreateBBoxQuery(uint32_t stackMax,
+                              uint32_t resBufferSize)
+{
+    void *memory = Allocate(VolumeBBoxQuery::GetResourceDescriptor(stackMax, resBufferSize));
+    if (!memory)
+    {
+        return NULL;
+    }
+    return VolumeBBoxQuery::Initialize(EA::Physics::MemoryPtr(memory), stackMax, resBufferSize);
+}
+
+
+/**
+\brief Creates a VolumeVolumeQuery in the arena.
+
+\param stackSize The max number of entries on the internal bbox query stack.
+\param resBufferSize The max number of results held in the output array.
+
+\see VolumeVolumeQuery::Initialize
+
+\return A ptr to the new query, or NULL if the arena is too small.
+*/
+VolumeVolumeQuery *
+QueryContext::CreateVolumeVolumeQuery(uint32_t stackSize,
+                                      uint32_t resBufferSize)
+{
+    void *memory = Allocate(VolumeVolumeQuery::GetResourceDescriptor(stackSize, resBufferSize));
+    if (!memory)
+    {
+        return NULL;
+    }
+    return VolumeVolumeQuery::Initialize(EA::Physics::MemoryPtr(memory), stackSize, resBufferSize);
+}
+
+
+} // namespace collision
+} // namespace rw
@@ -0,0 +1,597 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwcshapecast.cpp
+
+ Purpose: Time of impact of a swept sphere, capsule or box against a triangle.
+
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include "rw/collision/volume.h"
+#include "rw/collision/triangle.h"
+#include "rw/collision/shapecast.h"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#pragma warning(push)
+#pragma warning(disable: 4714)  // "function marked as __forceinline not inlined" may occur from eacollision headers
+#endif
+
+#include "eacollision/features/contactfiltering/filtertrianglecontact_branching.h"
+
+#if defined(EA_PLATFORM_WINDOWS)
+#pragma warning(pop)
+#endif
+
+using namespace rwpmath;
+
+namespace rw
+{
+namespace collision
+{
+
+
+// ***********************************************************************************************************
+// Static Functions
+
+
+/**
+\internal
+Finds the closest points between the segments p0-p1 and q0-q1.
+*/
+static void
+ClosestPointsSegmentSegment(Vector3 &pointOnP,
+                            Vector3 &pointOnQ,
+                            Vector3::InParam p0,
+                            Vector3::InParam p1,
+                            Vector3::InParam q0,
+                            Vector3::InParam q1)
+{
+    const Vector3 d1 = p1 - p0;
+    const Vector3 d2 = q1 - q0;
+    const Vector3 r = p0 - q0;
+    const float a = Dot(d1, d1);
+    const float e = Dot(d2, d2);
+    const float b = Dot(d1, d2);
+    const float c = Dot(d1, r);
+    const float f = Dot(d2, r);
+    const float denom = a * e - b * b;
+
+    float s = 0.0f;
+    if (denom > 1.0e-6f * a * e)
+    {
+        s = Min(Max((b * f - c * e) / denom, 0.0f), 1.0f);
+    }
+    float t = (e > 0.0f) ? (b * s + f) / e : 0.0f;
+    if (t < 0.0f)
+    {
+        t = 0.0f;
+        s = (a > 0.0f) ? Min(Max(-c / a, 0.0f), 1.0f) : 0.0f;
+    }
+    else if (t > 1.0f)
+    {
+        t = 1.0f;
+        s = (a > 0.0f) ? Min(Max((b - c) / a, 0.0f), 1.0f) : 0.0f;
+    }
+
+    pointOnP = p0 + d1 * VecFloat(s);
+    pointOnQ = q0 + d2 * VecFloat(t);
+}
+
+
+/**
+\internal
+Casts a sphere against a two sided triangle. This is the fat line test used by VolumeLineQuery.
+*/
+static RwpBool
+SphereTriangleCast(ShapeCastResult &result,
+                   Vector3::InParam center,
+                   float radius,
+                   Vector3::InParam delta,
+                   Vector3::InParam v0,
+                   Vector3::InParam v1,
+                   Vector3::InParam v2)
+{
+    VolumeLineSegIntersectResult res;
+    if (!TriangleLineSegIntersectTwoSided(res, center, delta, v0, v1, v2, radius))
+    {
+        return FALSE;
+    }
+
+    result.position = res.position;
+    result.normal = res.normal;
+    result.lineParam = res.lineParam;
+    return TRUE;
+}
+
+
+/**
+\internal
+Casts a capsule against a two sided triangle.
+
+The earliest contact is the earliest of the end cap spheres against the triangle, the triangle vertices
+against the side of the capsule and the triangle edges against the side of the capsule. Contacts between
+the side of the capsule and the triangle face always also touch an end cap so need no separate test.
+*/
+static RwpBool
+CapsuleTriangleCast(ShapeCastResult &result,
+                    Vector3::InParam center,
+                    Vector3::InParam axis,
+                    float halfHeight,
+                    float radius,
+                    Vector3::InParam delta,
+                    Vector3::InParam v0,
+                    Vector3::InParam v1,
+                    Vector3::InParam v2)
+{
+    const Vector3 verts[3] = { v0, v1, v2 };
+    const Vector3 halfAxis = axis * VecFloat(halfHeight);
+    const float radiusSq = radius * radius;
+    float bestT = MAX_FLOAT;
+
+    // Segment starts through the triangle.
+    if (halfHeight > 0.0f)
+    {
+        VolumeLineSegIntersectResult res;
+        if (TriangleLineSegIntersectTwoSided(res, center - halfAxis, halfAxis * GetVecFloat_Two(), v0, v1, v2))
+        {
+            const Vector3 faceNormal = Normalize(Cross(v1 - v0, v2 - v0));
+            result.position = res.position;
+            result.normal = (static_cast<float>(Dot(faceNormal, delta)) > 0.0f) ? -faceNormal : faceNormal;
+            result.lineParam = 0.0f;
+            return TRUE;
+        }
+    }
+
+    // End caps
+    for (uint32_t end = 0; end < 2; ++end)
+    {
+        const Vector3 capCenter = (end == 0) ? center - halfAxis : center + halfAxis;
+        ShapeCastResult capRes;
+        if (SphereTriangleCast(capRes, capCenter, radius, delta, v0, v1, v2) && capRes.lineParam < bestT)
+        {
+            result = capRes;
+            bestT = capRes.lineParam;
+        }
+    }
+
+    // Triangle vertices against the side of the capsule
+    const Vector3 perpDelta = delta - axis * Dot(delta, axis);
+    const float a = Dot(perpDelta, perpDelta);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const Vector3 w = verts[i] - center;
+        const Vector3 perpW = w - axis * Dot(w, axis);
+        const float c = Dot(perpW, perpW) - radiusSq;
+        float t;
+        if (c <= 0.0f)
+        {
+            t = 0.0f;
+        }
+        else
+        {
+            const float b = -2.0f * Dot(perpW, perpDelta);
+            const float disc = b * b - 4.0f * a * c;
+            if (a <= 0.0f || disc < 0.0f)
+            {
+                continue;
+            }
+            t = (-b - static_cast<float>(Sqrt(VecFloat(disc)))) / (2.0f * a);
+        }
+
+        if (t < 0.0f || t >= bestT)
+        {
+            continue;
+        }
+
+        const float s = Dot(w - delta * VecFloat(t), axis);
+        if (Abs(s) <= halfHeight)
+        {
+            const Vector3 sep = perpDelta * VecFloat(t) - perpW;
+            const float sepLengthSq = Dot(sep, sep);
+            if (sepLengthSq > 0.0f)
+            {
+                result.normal = sep * InvSqrt(VecFloat(sepLengthSq));
+            }
+            else
+            {
+                result.normal = -Normalize(delta);
+            }
+            result.position = verts[i];
+            result.lineParam = t;
+            bestT = t;
+        }
+    }
+
+    // Triangle edges against the side of the capsule
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const Vector3 q0 = verts[i];
+        const Vector3 edge = verts[(i + 1) % 3] - q0;
+        Vector3 n = Cross(axis, edge);
+        const float nLengthSq = Dot(n, n);
+        const float e = Dot(edge, edge);
+        if (nLengthSq <= 1.0e-6f * e)
+        {
+            // Parallel edges are handled by the vertex and end cap tests.
+            continue;
+        }
+        n *= InvSqrt(VecFloat(nLengthSq));
+
+        const float d0 = Dot(n, center - q0);
+        const float nd = Dot(n, delta);
+        float t;
+        float side;
+        if (d0 > radius)
+        {
+            if (nd >= 0.0f)
+            {
+                continue;
+            }
+            t = (radius - d0) / nd;
+            side = 1.0f;
+        }
+        else if (d0 < -radius)
+        {
+            if (nd <= 0.0f)
+            {
+                continue;
+            }
+            t = (-radius - d0) / nd;
+            side = -1.0f;
+        }
+        else
+        {
+            t = 0.0f;
+            side = (d0 != 0.0f) ? ((d0 > 0.0f) ? 1.0f : -1.0f) : ((nd > 0.0f) ? -1.0f : 1.0f);
+        }
+
+        if (t >= bestT)
+        {
+            continue;
+        }
+
+        // Closest points of the capsule axis and the edge line at the time of impact
+        const Vector3 r = center + delta * VecFloat(t) - q0;
+        const float b = Dot(axis, edge);
+        const float dd = Dot(axis, r);
+        const float f = Dot(edge, r);
+        const float denom = e - b * b;
+        const float s = (b * f - dd * e) / denom;
+        const float u = (f - b * dd) / denom;
+        if (Abs(s) <= halfHeight && u >= 0.0f && u <= 1.0f)
+        {
+            result.normal = n * VecFloat(side);
+            result.position = q0 + edge * VecFloat(u);
+            result.lineParam = t;
+            bestT = t;
+        }
+    }
+
+    return static_cast<RwpBool>(bestT <= 1.0f);
+}
+
+
+/**
+\internal
+Casts a box against a two sided triangle using the separating axis test on the 13 candidate axes.
+
+The time of impact is the latest time at which the box starts to overlap the triangle on every axis,
+provided that it is before the earliest time it stops overlapping on any axis. The contact normal is the
+axis that was last to start overlapping. The contact point is exact for vertex-face, face-vertex and
+edge-edge contacts. For face-face and edge-face contacts, where the contact is a patch, it is an
+approximation on the contact plane.
+*/
+static RwpBool
+BoxTriangleCast(ShapeCastResult &result,
+                const Matrix44Affine &boxTm,
+                Vector3::InParam halfExtents,
+                Vector3::InParam delta,
+                Vector3::InParam v0,
+                Vector3::InParam v1,
+                Vector3::InParam v2)
+{
+    const Vector3 center = boxTm.GetW();
+    const Vector3 boxAxes[3] = { boxTm.GetX(), boxTm.GetY(), boxTm.GetZ() };
+    const float boxExtents[3] = { halfExtents.GetX(), halfExtents.GetY(), halfExtents.GetZ() };
+    const Vector3 verts[3] = { v0, v1, v2 };
+    const Vector3 edges[3] = { v1 - v0, v2 - v1, v0 - v2 };
+    const Vector3 faceNormal = Normalize(Cross(edges[0], v2 - v0));
+
+    Vector3 axes[13];
+    axes[0] = faceNormal;
+    axes[1] = boxAxes[0];
+    axes[2] = boxAxes[1];
+    axes[3] = boxAxes[2];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            axes[4 + i * 3 + j] = Cross(boxAxes[i], edges[j]);
+        }
+    }
+
+    float tEnter = -MAX_FLOAT;
+    float tExit = MAX_FLOAT;
+    Vector3 normal = faceNormal;
+
+    for (uint32_t i = 0; i < 13; ++i)
+    {
+        Vector3 axis = axes[i];
+        const float axisLengthSq = Dot(axis, axis);
+        if (i >= 4 && axisLengthSq <= 1.0e-6f * Dot(edges[(i - 4) % 3], edges[(i - 4) % 3]))
+        {
+            // Degenerate cross product of parallel box axis and edge.
+            continue;
+        }
+        axis *= InvSqrt(VecFloat(axisLengthSq));
+
+        const float c = Dot(center, axis);
+        const float boxRadius = boxExtents[0] * Abs(Dot(boxAxes[0], axis)) +
+                                boxExtents[1] * Abs(Dot(boxAxes[1], axis)) +
+                                boxExtents[2] * Abs(Dot(boxAxes[2], axis));
+        const float p0 = Dot(v0, axis);
+        const float p1 = Dot(v1, axis);
+        const float p2 = Dot(v2, axis);
+        const float triMin = Min(p0, Min(p1, p2));
+        const float triMax = Max(p0, Max(p1, p2));
+        const float boxMin = c - boxRadius;
+        const float boxMax = c + boxRadius;
+        const float speed = Dot(delta, axis);
+
+        float enter, exit;
+        Vector3 axisNormal = axis;
+        if (boxMax < triMin)
+        {
+            if (speed <= 0.0f)
+            {
+                return FALSE;
+            }
+            enter = (triMin - boxMax) / speed;
+            exit = (triMax - boxMin) / speed;
+            axisNormal = -axis;
+        }
+        else if (boxMin > triMax)
+        {
+            if (speed >= 0.0f)
+            {
+                return FALSE;
+            }
+            enter = (triMax - boxMin) / speed;
+            exit = (triMin - boxMax) / speed;
+        }
+        else
+        {
+            enter = -MAX_FLOAT;
+            exit = (speed > 0.0f) ? (triMax - boxMin) / speed :
+                   (speed < 0.0f) ? (triMin - boxMax) / speed : MAX_FLOAT;
+        }
+
+        if (enter > tEnter)
+        {
+            tEnter = enter;
+            normal = axisNormal;
+        }
+        tExit = Min(tExit, exit);
+
+        if (tEnter > tExit || tEnter > 1.0f)
+        {
+            return FALSE;
+        }
+    }
+
+    if (tEnter < 0.0f)
+    {
+        // Starts overlapping, report the face normal on the side of the box centre.
+        const float side = Dot(faceNormal, center - v0);
+        const bool flip = (side != 0.0f) ? (side < 0.0f) : (static_cast<float>(Dot(faceNormal, delta)) > 0.0f);
+        result.normal = flip ? -faceNormal : faceNormal;
+        result.lineParam = 0.0f;
+        tEnter = 0.0f;
+    }
+    else
+    {
+        result.normal = normal;
+        result.lineParam = tEnter;
+    }
+
+    // Find the touching features of the box and triangle
+    const Vector3 n = result.normal;
+    const Vector3 boxCenter = center + delta * VecFloat(tEnter);
+    Vector3 boxPoint = boxCenter;
+    uint32_t numFreeBoxAxes = 0;
+    uint32_t freeBoxAxis = 0;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const float d = Dot(boxAxes[i], n);
+        if (Abs(d) > 1.0e-3f)
+        {
+            boxPoint -= boxAxes[i] * VecFloat((d > 0.0f) ? boxExtents[i] : -boxExtents[i]);
+        }
+        else
+        {
+            freeBoxAxis = i;
+            ++numFreeBoxAxes;
+        }
+    }
+
+    const float maxEdgeLengthSq = Max(Dot(edges[0], edges[0]), Max(Dot(edges[1], edges[1]), Dot(edges[2], edges[2])));
+    const float triTolerance = 1.0e-3f * static_cast<float>(Sqrt(VecFloat(maxEdgeLengthSq)));
+    const float proj[3] = { Dot(v0, n), Dot(v1, n), Dot(v2, n) };
+    const float projMax = Max(proj[0], Max(proj[1], proj[2]));
+    uint32_t numTriSupport = 0;
+    uint32_t triSupport[3];
+    Vector3 triPoint = GetVector3_Zero();
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        if (proj[i] >= projMax - triTolerance)
+        {
+            triSupport[numTriSupport++] = i;
+            triPoint += verts[i];
+        }
+    }
+    triPoint *= VecFloat(1.0f / static_cast<float>(numTriSupport));
+
+    if (numFreeBoxAxes == 0)
+    {
+        result.position = boxPoint;
+    }
+    else if (numTriSupport == 1)
+    {
+        result.position = verts[triSupport[0]];
+    }
+    else if (numFreeBoxAxes == 1 && numTriSupport == 2)
+    {
+        const Vector3 halfEdge = boxAxes[freeBoxAxis] * VecFloat(boxExtents[freeBoxAxis]);
+        Vector3 pointOnBox, pointOnTri;
+        ClosestPointsSegmentSegment(pointOnBox, pointOnTri, boxPoint - halfEdge, boxPoint + halfEdge,
+            verts[triSupport[0]], verts[triSupport[1]]);
+        result.position = pointOnTri;
+    }
+    else
+    {
+        // Contact patch, use the centre of the box feature on the contact plane.
+        result.position = boxPoint - n * Dot(n, boxPoint - triPoint);
+    }
+
+    return TRUE;
+}
+
+
+/**
+\internal
+Applies the triangle edge cosine, vertex disable and one sided filters to a shape cast contact normal, in
+the same way as contact generation does.
+
+\return FALSE if the contact should be rejected. If the normal needs bending it is replaced by the face normal.
+*/
+static RwpBool
+FilterTriangleCastNormal(Vector3 &normal,
+                         Vector3::InParam v0,
+                         Vector3::InParam v1,
+                         Vector3::InParam v2,
+                         Vector3::InParam triangleEdgeCosines,
+                         uint32_t flags,
+                         VecFloatInParam edgeCosBendNormalThreshold,
+                         VecFloatInParam convexityEpsilon,
+                         VecFloatInParam triangleFaceNormalTolerance,
+                         VecFloatInParam featureSimplificationThreshold)
+{
+    const Mask3 disableVertices(
+        (flags & GPInstance::FLAG_TRIANGLEVERT0DISABLE) != 0,
+        (flags & GPInstance::FLAG_TRIANGLEVERT1DISABLE) != 0,
+        (flags & GPInstance::FLAG_TRIANGLEVERT2DISABLE) != 0);
+    const Mask3 edgeIsConvex(
+        (flags & GPInstance::FLAG_TRIANGLEEDGE0CONVEX) != 0,
+        (flags & GPInstance::FLAG_TRIANGLEEDGE1CONVEX) != 0,
+        (flags & GPInstance::FLAG_TRIANGLEEDGE2CONVEX) != 0);
+    const MaskScalar oneSided((flags & GPInstance::FLAG_TRIANGLEONESIDED) != 0u);
+
+    const Vector3 normalTowardsTriangle = -normal;
+    const Mask3 feature = EA::Collision::ContactFiltering::ComputeFeatureFromDirection_Branching(
+        normalTowardsTriangle, v0, v1, v2, triangleFaceNormalTolerance, featureSimplificationThreshold);
+
+    MaskScalar reject;
+    if (flags & GPInstance::FLAG_TRIANGLEUSEEDGECOS)
+    {
+        MaskScalar needsNormalBending;
+        const Vector3 negOne(GetVecFloat_NegativeOne());
+        const Vector3 negTwo(GetVecFloat_NegativeTwo());
+        // Matches GenericContactHandler::RejectContactNormal
+        const Vector3 edgeCosines = Select(CompEqual(triangleEdgeCosines, negOne), negTwo, triangleEdgeCosines);
+        reject = EA::Collision::ContactFiltering::FilterTriangleContactByEdgeCosines_Branching(
+            needsNormalBending, normalTowardsTriangle, feature, v0, v1, v2, edgeCosines,
+            edgeIsConvex, disableVertices, oneSided, edgeCosBendNormalThreshold, convexityEpsilon);
+
+        if (!reject.GetBool() && needsNormalBending.GetBool())
+        {
+            const Vector3 faceNormal = Normalize(Cross(v1 - v0, v2 - v0));
+            normal = (static_cast<float>(Dot(faceNormal, normal)) < 0.0f) ? -faceNormal : faceNormal;
+        }
+    }
+    else
+    {
+        reject = EA::Collision::ContactFiltering::FilterTriangleContact_Branching(
+            normalTowardsTriangle, feature, v0, v1, v2, edgeIsConvex, disableVertices, oneSided);
+    }
+
+    return static_cast<RwpBool>(!reject.GetBool());
+}
+
+
+// ***********************************************************************************************************
+// Functions
+
+
+/**
+\brief
+Finds the first contact of a shape swept along \a delta with a triangle.
+
+The time of impact is exact for spheres, capsules and boxes. The contact normal found is filtered in the
+same way as contact generation filters triangle contacts, so contacts with the back of a one sided
+triangle, with disabled vertices or outside the range allowed by the edge cosines are rejected. If the
+shape starts touching the triangle the result has lineParam zero.
+
+\param result   Set to the first contact when the function returns TRUE.
+\param shape    The shape to sweep, in the same frame as the triangle.
+\param delta    The displacement of the shape over the sweep. Must not be zero.
+\param v0       Triangle vertex 0.
+\param v1       Triangle vertex 1.
+\param v2       Triangle vertex 2.
+\param edgeCosines  The triangle edge cosines.
+\param flags    The GPInstance triangle flags of the triangle.
+\param edgeCosBendNormalThreshold       See rw::collision::ComputeContacts.
+\param convexityEpsilon                 See rw::collision::ComputeContacts.
+\param triangleFaceNormalTolerance      See rw::collision::ComputeContacts.
+\param featureSimplificationThreshold   See rw::collision::ComputeContacts.
+
+\return TRUE if the shape hits the triangle during the sweep.
+*/
+RwpBool
+TriangleShapeCast(ShapeCastResult &result,
+                  const CastShape &shape,
+                  Vector3::InParam delta,
+                  Vector3::InParam v0,
+                  Vector3::InParam v1,
+                  Vector3::InParam v2,
+                  Vector3::InParam edgeCosines,
+                  uint32_t flags,
+                  VecFloatInParam edgeCosBendNormalThreshold,
+                  VecFloatInParam convexityEpsilon,
+                  VecFloatInParam triangleFaceNormalTolerance,
+                  VecFloatInParam featureSimplificationThreshold)
+{
+    EA_ASSERT_MSG(MagnitudeSquared(delta) > GetVecFloat_Zero(), "Shape cast delta must not be zero.");
+
+    RwpBool hit = FALSE;
+    switch (shape.m_type)
+    {
+    case CastShape::SPHERE:
+        hit = SphereTriangleCast(result, shape.GetCenter(), shape.m_radius, delta, v0, v1, v2);
+        break;
+    case CastShape::CAPSULE:
+        hit = CapsuleTriangleCast(result, shape.GetCenter(), shape.m_transform.GetX(), shape.m_halfHeight,
+            shape.m_radius, delta, v0, v1, v2);
+        break;
+    case CastShape::BOX:
+        hit = BoxTriangleCast(result, shape.m_transform, shape.m_halfExtents, delta, v0, v1, v2);
+        break;
+    default:
+        EA_FAIL_MSG(("Unknown cast shape type."));
+        break;
+    }
+
+    if (!hit)
+    {
+        return FALSE;
+    }
+
+    return FilterTriangleCastNormal(result.normal, v0, v1, v2, edgeCosines, flags, edgeCosBendNormalThreshold,
+        convexityEpsilon, triangleFaceNormalTolerance, featureSimplificationThreshold);
+}
+
+
+} // namespace collision
+} // namespace rw
@@ -18,6 +18,7 @@
 #include "rw/collision/procedural.h"
 #include "rw/collision/trianglekdtreeprocedural.h"
 #include "rw/collision/volumebboxquery.h"
+#include "rw/collision/metrics.h"
 
 using namespace rwpmath;
 
@@ -230,6 +231,15 @@ VolumeBBoxQuery::GetOverlaps()
 {
     Aggregate *agg;
     RwpBool overflow;
+
+    //Count calls which resume a query that overflowed its buffers
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    if (m_currInput > 0 || m_currVRef.volume || m_stackNext > 0)
+    {
+        ++m_counters.m_counts[QueryCounters::RESTARTS];
+    }
+#endif
+
     m_primNext = 0; //Reset results buffer
     m_instVolCount = 0;
     m_numTagBits = 0;
@@ -365,6 +375,8 @@ VolumeBBoxQuery::GetOverlaps()
         m_stackNext--;
     }
 
+    rwcQUERYSTATS(m_counters.m_counts[QueryCounters::INSTANCED_VOLUMES] += m_instVolCount);
+
     return m_primNext; //return the number of primitives
 }
 
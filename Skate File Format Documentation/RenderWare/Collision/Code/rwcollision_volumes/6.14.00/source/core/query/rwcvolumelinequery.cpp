@@ -216,6 +216,15 @@ VolumeLineQuery::GetIntersections()
 {
     Aggregate *agg;
     RwpBool overflow;
+
+    //Count calls which resume a query that overflowed its buffers
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    if (m_currInput > 0 || m_currVRef.volume || m_stackNext > 0 || m_primNext > 0)
+    {
+        ++m_counters.m_counts[QueryCounters::RESTARTS];
+    }
+#endif
+
     m_resCount = 0; //Reset results buffer
     m_instVolCount = 0;
     m_tag = 0;
@@ -337,6 +346,7 @@ VolumeLineQuery::GetIntersections()
             const Volume *vol = m_primVRefBuffer[idx].volume;
             Matrix44Affine *tm = m_primVRefBuffer[idx].tm;
             VolumeLineSegIntersectResult *res = &m_resBuffer[m_resCount];
+            rwcQUERYSTATS(++m_counters.m_counts[QueryCounters::PRIMITIVE_TESTS]);
             if(vol->LineSegIntersect(m_pt1,
                                      m_pt2,
                                      tm,
@@ -380,6 +390,8 @@ VolumeLineQuery::GetIntersections()
         }
     }
 
+    rwcQUERYSTATS(m_counters.m_counts[QueryCounters::INSTANCED_VOLUMES] += m_instVolCount);
+
     return m_resCount;
 }
 
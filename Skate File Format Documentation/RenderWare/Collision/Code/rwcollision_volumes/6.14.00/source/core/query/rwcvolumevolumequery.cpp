@@ -185,6 +185,9 @@ VolumeVolumeQuery::GetPrimitiveBBoxOverlaps()
 
     Vector3 paddingVector( m_padding, m_padding, m_padding );
 
+    //Count calls which resume a query that overflowed its buffers
+    rwcQUERYSTATS(m_counters.m_counts[QueryCounters::RESTARTS] += (m_currInput > 0) ? 1u : 0u);
+
     //Get the bounding box of the query Volume
     m_queryVol->GetBBox(m_queryMtx, 0, queryVolBBox);
     queryVolVolume = (static_cast<float>(queryVolBBox.m_max.GetX()) - static_cast<float>(queryVolBBox.m_min.GetX())) *
@@ -251,6 +254,7 @@ VolumeVolumeQuery::GetPrimitiveBBoxOverlaps()
 
         //Get all the overlaps
         numResSmallToBig = m_bBoxQueryAtoB->GetOverlaps();
+        rwcQUERYSTATS(m_counters.Add(m_bBoxQueryAtoB->GetCounters()));
 
 #ifdef EA_DEBUG
         //Issue warning if query didn't finish  - Currently we don't try to re-enter
@@ -281,6 +285,7 @@ VolumeVolumeQuery::GetPrimitiveBBoxOverlaps()
 
             //Get Second set of overlaps
             numResBigToSmall = m_bBoxQueryBtoA->GetOverlaps();
+            rwcQUERYSTATS(m_counters.Add(m_bBoxQueryBtoA->GetCounters()));
 
 #ifdef EA_DEBUG
             //Issue warning if query didn't finish  - Currently we don't try to re-enter
@@ -368,7 +373,6 @@ VolumeVolumeQuery::GetPrimitiveIntersections()
     GetPrimitiveBBoxOverlaps();
 
     rwcMETRICS(m_metrics.m_gpTime.Start());
-
     int32_t intersectionCount = detail::PrimitiveBatchIntersect( m_intersectionBuffer,
                                                          (int32_t) m_intersectionBufferMaxSize,
                                                          m_instancingSPR,
@@ -376,7 +380,8 @@ VolumeVolumeQuery::GetPrimitiveIntersections()
                                                          (int32_t)m_volRef1xNCount,
                                                          m_padding,
                                                          m_edgeCosBendNormalThreshold,
-                                                         m_convexityEpsilon );
+                                                         m_convexityEpsilon,
+                                                         &m_counters );
     rwcMETRICS(m_metrics.m_gpTime.Stop());
 
     return (uint32_t) intersectionCount;
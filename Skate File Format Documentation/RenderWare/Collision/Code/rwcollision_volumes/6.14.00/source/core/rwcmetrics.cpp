@@ -3,7 +3,7 @@
 
  File: rwcmetrics.cpp
 
- Purpose: Collision metrics services.
+ Purpose: Collision metrics services and query statistics.
 
  */
 
@@ -37,6 +37,103 @@
 // ***********************************************************************************************************
 // Static Functions
 
+namespace
+{
+
+/**
+\internal
+Writes JSON text into a fixed size buffer, counting the characters needed even when the buffer is full.
+*/
+class JSONWriter
+{
+public:
+    JSONWriter(char *buffer, uint32_t bufferSize)
+        : m_buffer(buffer),
+          m_bufferSize(bufferSize),
+          m_length(0)
+    {
+    }
+
+    void
+    Append(const char *text)
+    {
+        while (*text)
+        {
+            if (m_length + 1 < m_bufferSize)
+            {
+                m_buffer[m_length] = *text;
+            }
+            ++m_length;
+            ++text;
+        }
+    }
+
+    void
+    Append(uint64_t value)
+    {
+        char digits[24];
+        uint32_t numDigits = 0;
+        do
+        {
+            digits[numDigits++] = static_cast<char>('0' + (value % 10u));
+            value /= 10u;
+        }
+        while (value);
+
+        char text[24];
+        for (uint32_t i = 0; i < numDigits; ++i)
+        {
+            text[i] = digits[numDigits - 1 - i];
+        }
+        text[numDigits] = 0;
+        Append(text);
+    }
+
+    uint32_t
+    Finish()
+    {
+        if (m_bufferSize > 0)
+        {
+            m_buffer[(m_length < m_bufferSize) ? m_length : m_bufferSize - 1] = 0;
+        }
+        return m_length;
+    }
+
+private:
+    char     *m_buffer;
+    uint32_t m_bufferSize;
+    uint32_t m_length;
+};
+
+
+void
+AppendHistogram(JSONWriter &writer, const rw::collision::QueryStats::Histogram &histogram)
+{
+    // Trailing empty buckets are left out
+    uint32_t numBuckets = rw::collision::QueryStats::Histogram::NUM_BUCKETS;
+    while (numBuckets > 0 && histogram.m_buckets[numBuckets - 1] == 0)
+    {
+        --numBuckets;
+    }
+
+    writer.Append("{\"p50\":");
+    writer.Append(histogram.GetPercentile(0.5f));
+    writer.Append(",\"p99\":");
+    writer.Append(histogram.GetPercentile(0.99f));
+    writer.Append(",\"buckets\":[");
+    for (uint32_t i = 0; i < numBuckets; ++i)
+    {
+        if (i > 0)
+        {
+            writer.Append(",");
+        }
+        writer.Append(static_cast<uint64_t>(histogram.m_buckets[i]));
+    }
+    writer.Append("]}");
+}
+
+} // namespace
+
 
 namespace rw
 {
@@ -57,6 +154,264 @@ namespace collision
 Timer::QueryFn  Timer::m_queryFn = 0;
 #endif /* RWMETRICS */
 
+/**
+\brief Gets the name of a counter, as used in the JSON output of QueryStats.
+\param counter The counter.
+\return The name of the counter.
+*/
+const char *
+QueryCounters::GetName(Counter counter)
+{
+    static const char *names[NUM_COUNTERS] =
+    {
+        "kdtreeNodes",
+        "kdtreeLeaves",
+        "clusters",
+        "units",
+        "triangles",
+        "primitiveTests",
+        "restarts",
+        "instancedVolumes",
+        "childVolumes"
+    };
+
+    EA_ASSERT(counter < NUM_COUNTERS);
+    return names[counter];
+}
+
+
+/**
+\brief Empties the histogram.
+*/
+void
+QueryStats::Histogram::Reset()
+{
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        m_buckets[i] = 0;
+    }
+}
+
+
+/**
+\brief Adds a value to the histogram.
+\param value The value to add.
+*/
+void
+QueryStats::Histogram::Add(uint64_t value)
+{
+    uint32_t bucket = 0;
+    while (value && bucket < NUM_BUCKETS - 1)
+    {
+        value >>= 1;
+        ++bucket;
+    }
+    ++m_buckets[bucket];
+}
+
+
+/**
+\brief Adds the values of another histogram.
+\param other The histogram to add.
+*/
+void
+QueryStats::Histogram::Add(const Histogram &other)
+{
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        m_buckets[i] += other.m_buckets[i];
+    }
+}
+
+
+/**
+\brief Gets an upper bound of a percentile of the values in the histogram.
+\param fraction The fraction of values, from 0 to 1, which are no larger than the percentile.
+\return The largest value in the bucket containing the percentile, or 0 if the histogram is empty.
+*/
+uint64_t
+QueryStats::Histogram::GetPercentile(float fraction) const
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        total += m_buckets[i];
+    }
+
+    const uint64_t rank = static_cast<uint64_t>(fraction * static_cast<float>(total));
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+    {
+        count += m_buckets[i];
+        if (count > rank || (count == total && count > 0))
+        {
+            return (static_cast<uint64_t>(1) << i) - 1u;
+        }
+    }
+    return 0;
+}
+
+
+/**
+\brief Constructs empty query statistics.
+*/
+QueryStats::QueryStats()
+{
+    Reset();
+}
+
+
+/**
+\brief Clears the statistics of every query type.
+*/
+void
+QueryStats::Reset()
+{
+    for (uint32_t t = 0; t < NUM_QUERY_TYPES; ++t)
+    {
+        QueryTypeStats &stats = m_types[t];
+        stats.m_numQueries = 0;
+        for (uint32_t i = 0; i < QueryCounters::NUM_COUNTERS; ++i)
+        {
+            stats.m_totals[i] = 0;
+        }
+        stats.m_totalTicks = 0;
+        stats.m_latency.Reset();
+        stats.m_work.Reset();
+    }
+}
+
+
+/**
+\brief Records a completed query.
+
+\param type The type of the query.
+\param counters The counters of the query, from GetCounters of the query object.
+\param ticks The latency of the query, in whatever units the caller measures time.
+*/
+void
+QueryStats::Record(QueryType type,
+                   const QueryCounters &counters,
+                   uint64_t ticks)
+{
+    EA_ASSERT(type < NUM_QUERY_TYPES);
+    QueryTypeStats &stats = m_types[type];
+
+    ++stats.m_numQueries;
+    for (uint32_t i = 0; i < QueryCounters::NUM_COUNTERS; ++i)
+    {
+        stats.m_totals[i] += counters.m_counts[i];
+    }
+    stats.m_totalTicks += ticks;
+    stats.m_latency.Add(ticks);
+    stats.m_work.Add(counters.GetWork());
+}
+
+
+/**
+\brief Adds the statistics of another QueryStats, typically that of another thread.
+\param other The statistics to add.
+*/
+void
+QueryStats::Merge(const QueryStats &other)
+{
+    for (uint32_t t = 0; t < NUM_QUERY_TYPES; ++t)
+    {
+        QueryTypeStats &stats = m_types[t];
+        const QueryTypeStats &otherStats = other.m_types[t];
+
+        stats.m_numQueries += otherStats.m_numQueries;
+        for (uint32_t i = 0; i < QueryCounters::NUM_COUNTERS; ++i)
+        {
+            stats.m_totals[i] += otherStats.m_totals[i];
+        }
+        stats.m_totalTicks += otherStats.m_totalTicks;
+        stats.m_latency.Add(otherStats.m_latency);
+        stats.m_work.Add(otherStats.m_work);
+    }
+}
+
+
+/**
+\brief Writes the statistics as a JSON object.
+
+The object has a member for each type of query, holding the number of queries, the total of each counter
+and ticks, and the latency and work histograms:
+\code
+{"lineQuery":{"queries":100,"ticks":5230,"totals":{"kdtreeNodes":1210,...},
+ "latency":{"p50":63,"p99":255,"buckets":[0,0,...]},"work":{...}},"bboxQuery":{...},...}
+\endcode
+
+\param buffer The buffer to write into, which is always null terminated if not empty.
+\param bufferSize The size of the buffer.
+
+\return The length of the JSON text, excluding the terminator. If this is not less than \a bufferSize
+        the text was truncated.
+*/
+uint32_t
+QueryStats::WriteJSON(char *buffer,
+                      uint32_t bufferSize) const
+{
+    JSONWriter writer(buffer, bufferSize);
+
+    writer.Append("{");
+    for (uint32_t t = 0; t < NUM_QUERY_TYPES; ++t)
+    {
+        const QueryTypeStats &stats = m_types[t];
+
+        if (t > 0)
+        {
+            writer.Append(",");
+        }
+        writer.Append("\"");
+        writer.Append(GetName(static_cast<QueryType>(t)));
+        writer.Append("\":{\"queries\":");
+        writer.Append(static_cast<uint64_t>(stats.m_numQueries));
+        writer.Append(",\"ticks\":");
+        writer.Append(stats.m_totalTicks);
+        writer.Append(",\"totals\":{");
+        for (uint32_t i = 0; i < QueryCounters::NUM_COUNTERS; ++i)
+        {
+            if (i > 0)
+            {
+                writer.Append(",");
+            }
+            writer.Append("\"");
+            writer.Append(QueryCounters::GetName(static_cast<QueryCounters::Counter>(i)));
+            writer.Append("\":");
+            writer.Append(stats.m_totals[i]);
+        }
+        writer.Append("},\"latency\":");
+        AppendHistogram(writer, stats.m_latency);
+        writer.Append(",\"work\":");
+        AppendHistogram(writer, stats.m_work);
+        writer.Append("}");
+    }
+    writer.Append("}");
+
+    return writer.Finish();
+}
+
+
+/**
+\brief Gets the name of a query type, as used in the JSON output.
+\param type The query type.
+\return The name of the query type.
+*/
+const char *
+QueryStats::GetName(QueryType type)
+{
+    static const char *names[NUM_QUERY_TYPES] =
+    {
+        "lineQuery",
+        "bboxQuery",
+        "volumeVolumeQuery"
+    };
+
+    EA_ASSERT(type < NUM_QUERY_TYPES);
+    return names[type];
+}
+
 // Static Methods
 
 // Interface Implementations
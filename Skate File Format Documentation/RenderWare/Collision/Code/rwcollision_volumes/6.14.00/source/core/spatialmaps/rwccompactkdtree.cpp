@@ -0,0 +1,283 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+ File: rwccompactkdtree.cpp
+
+ Purpose: Read only KDTree spatial map with quantized branch nodes.
+
+ */
+
+// ***********************************************************************************************************
+// Includes
+
+#include "rw/collision/aabbox.h"
+#include "rw/collision/compactkdtree.h"
+#include "stdio.h"
+
+
+using namespace rwpmath;
+
+namespace rw
+{
+namespace collision
+{
+
+/**
+\internal
+
+This is an internal structure that is used to associate the parent id and bbox of a compact kdtree node with
+it while checking the validity of the tree.
+*/
+struct CompactValidityCheckNodeData
+{
+    KDTreeBase::NodeRef nodeRef; ///< the node
+    uint32_t parent;             ///< the index of the parent branch node
+    AABBox   bbox;               ///< the decoded region of the node
+};
+
+
+// ***********************************************************************************************************
+//                                       rw::collision::CompactKDTree CLASS
+// ***********************************************************************************************************
+
+/**
+\brief Check validity of CompactKDTree.
+
+The CompactKDTree is traversed and each branch node is checked to:
+\li ensure the branch nodes are sorted in left-to-right depth first traversal order
+\li ensure the split axis number is valid
+\li ensure the decoded child extents are within the region of the branch
+\li ensure leaf entry indices are sorted in left-to-right traversal order
+\li ensure total leaf entry count it correct
+
+\return TRUE if CompactKDTree is internally consistent.
+ */
+RwpBool
+CompactKDTree::IsValid() const
+{
+    RwpBool isValid = TRUE;
+
+    CompactValidityCheckNodeData stack[rwcKDTREE_STACK_SIZE];
+    if (m_numBranchNodes > 0)
+    {
+        stack[0].nodeRef.m_content = rwcKDTREE_BRANCH_NODE;
+        stack[0].nodeRef.m_index = 0;
+    }
+    else
+    {
+        stack[0].nodeRef.m_content = m_numEntries;
+        stack[0].nodeRef.m_index = 0;
+    }
+    stack[0].parent = 0;
+    stack[0].bbox = m_bbox;
+    uint32_t top = 1;
+
+    uint32_t leafEntryCountCheck = 0;
+    uint32_t lastLeafEntryIndex = 0;
+    uint32_t branchIndexCheck = 0;
+
+    while (top > 0)
+    {
+        const CompactValidityCheckNodeData cur = stack[--top];
+
+        if (cur.nodeRef.m_content == rwcKDTREE_BRANCH_NODE)
+        {
+            const uint32_t branchIndex = cur.nodeRef.m_index;
+
+            // Check branch index
+            if (branchIndex != branchIndexCheck || branchIndex >= m_numBranchNodes)
+            {
+                EAPHYSICS_MESSAGE("Branch node index %d is invalid (referenced from node %d).",
+                    branchIndex, cur.parent);
+                printf("Branch node index %d is invalid (referenced from node %d).",
+                    branchIndex, cur.parent);
+                return FALSE;
+            }
+            branchIndexCheck++;
+
+            KDTreeBase::BranchNode branch;
+            DecodeBranchNode(branchIndex, branch);
+
+            // Axis
+            if (branch.m_axis > 2)
+            {
+                EAPHYSICS_MESSAGE("Branch node %d has invalid split axis %d.", branchIndex, branch.m_axis);
+                printf("Branch node %d has invalid split axis %d.", branchIndex, branch.m_axis);
+                return FALSE;
+            }
+
+            // Check that child extents are contained
+            if (static_cast<float>(cur.bbox.Min().GetComponent((uint16_t)branch.m_axis)) >
+                    math::Min(branch.m_extents[0], branch.m_extents[1]) ||
+                static_cast<float>(cur.bbox.Max().GetComponent((uint16_t)branch.m_axis)) <
+                    math::Max(branch.m_extents[0], branch.m_extents[1]))
+            {
+                EAPHYSICS_MESSAGE("Branch node %d does not completely enclose its child extents.", branchIndex);
+                printf("Branch node %d does not completely enclose its child extents.\n", branchIndex);
+                isValid = FALSE;
+            }
+
+            if (top + 2 > rwcKDTREE_STACK_SIZE)
+            {
+                EAPHYSICS_MESSAGE("CompactKDTree is deeper than rwcKDTREE_MAX_DEPTH.");
+                printf("CompactKDTree is deeper than rwcKDTREE_MAX_DEPTH.");
+                return FALSE;
+            }
+
+            // Push right
+            CompactValidityCheckNodeData & right = stack[top++];
+            right.nodeRef = branch.m_childRefs[1];
+            right.parent = branchIndex;
+            right.bbox = cur.bbox;
+            right.bbox.m_min.SetComponent((uint16_t)branch.m_axis, branch.m_extents[1]);
+
+            // Push left
+            CompactValidityCheckNodeData & left = stack[top++];
+            left.nodeRef = branch.m_childRefs[0];
+            left.parent = branchIndex;
+            left.bbox = cur.bbox;
+            left.bbox.m_max.SetComponent((uint16_t)branch.m_axis, branch.m_extents[0]);
+        }
+        else if (cur.nodeRef.m_content > 0)
+        {
+            if (!(cur.nodeRef.m_index >= lastLeafEntryIndex))
+            {
+                EAPHYSICS_MESSAGE("Invalid leaf entry index (referenced from node %d).", cur.parent);
+                printf("Invalid leaf entry index (referenced from node %d).", cur.parent);
+                isValid = FALSE;
+            }
+
+            lastLeafEntryIndex = cur.nodeRef.m_index + cur.nodeRef.m_content;
+            leafEntryCountCheck += cur.nodeRef.m_content;
+        }
+    }
+
+    if (branchIndexCheck != m_numBranchNodes)
+    {
+        EAPHYSICS_MESSAGE("Number of branch nodes reached does not match actual number of branch nodes");
+        printf("Number of branch nodes reached does not match actual number of branch nodes");
+        isValid = FALSE;
+    }
+
+    if (leafEntryCountCheck != m_numEntries)
+    {
+        EAPHYSICS_MESSAGE("Sum of leaf entry counts does not match actual number of entries");
+        printf("Sum of leaf entry counts does not match actual number of entries");
+        isValid = FALSE;
+    }
+
+    return isValid;
+}
+
+
+/**
+\internal
+Quantizes a branch plane of a compact branch node so that the decoded child region contains the original.
+
+\param tree The CompactKDTree, whose bounding box defines the quantization.
+\param axis Split axis of the branch node.
+\param extent Location of the branch plane.
+\param roundUp TRUE for the left extent which bounds the left child above, FALSE for the right extent.
+\return The quantized extent.
+*/
+static uint16_t
+QuantizeCompactExtent(const CompactKDTree & tree, uint32_t axis, float extent, RwpBool roundUp)
+{
+    const float minExtent = static_cast<float>(tree.m_bbox.Min().GetComponent(static_cast<uint16_t>(axis)));
+    const float maxExtent = static_cast<float>(tree.m_bbox.Max().GetComponent(static_cast<uint16_t>(axis)));
+    const float range = maxExtent - minExtent;
+
+    uint32_t step = roundUp ? rwcCOMPACTKDTREE_EXTENT_STEPS : 0u;
+    if (range > 0.0f)
+    {
+        float scaled = (extent - minExtent) * (float(rwcCOMPACTKDTREE_EXTENT_STEPS) / range);
+        scaled = math::Max(0.0f, math::Min(scaled, float(rwcCOMPACTKDTREE_EXTENT_STEPS)));
+        step = static_cast<uint32_t>(scaled);
+    }
+
+    // Step outwards until the decoded plane is conservative, which also corrects any rounding in the decode
+    if (roundUp)
+    {
+        while (step < rwcCOMPACTKDTREE_EXTENT_STEPS && tree.DecodeExtent(axis, step) < extent)
+        {
+            ++step;
+        }
+    }
+    else
+    {
+        while (step > 0 && tree.DecodeExtent(axis, step) > extent)
+        {
+            --step;
+        }
+    }
+    return static_cast<uint16_t>(step);
+}
+
+
+/**
+\brief Checks whether a KDTree can be held as a CompactKDTree.
+
+Every leaf of the source tree must reference fewer than rwcCOMPACTKDTREE_BRANCH_NODE entries.
+\param source The KDTree to be compacted.
+\return TRUE if CompactBranchNodes can encode the source tree.
+*/
+RwpBool
+CompactKDTree::CanCompactBranchNodes(const KDTreeBase & source)
+{
+    for (uint32_t i = 0; i < source.m_numBranchNodes; ++i)
+    {
+        const KDTreeBase::BranchNode & branch = source.m_branchNodes[i];
+        for (uint32_t child = 0; child < 2; ++child)
+        {
+            const uint32_t content = branch.m_childRefs[child].m_content;
+            if (content != rwcKDTREE_BRANCH_NODE && content >= rwcCOMPACTKDTREE_BRANCH_NODE)
+            {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+
+/**
+\brief Fills in the branch nodes of a CompactKDTree from a KDTree with full branch nodes.
+
+This CompactKDTree must have been initialized with the same number of branch nodes, number of entries and
+bounding box as the source tree.  The extents are rounded outwards so that queries on the compact tree
+return every leaf returned by the same query on the source tree, and possibly some more.
+
+The source may be the tree of an aggregate.  Its branch nodes must be indexed from zero, so the KDSubTree
+of a single cluster can't be compacted on its own.
+\param source The KDTree to be compacted.
+\see CanCompactBranchNodes
+*/
+void
+CompactKDTree::CompactBranchNodes(const KDTreeBase & source)
+{
+    EA_ASSERT(m_numBranchNodes == source.m_numBranchNodes);
+    EA_ASSERT(m_numEntries == source.m_numEntries);
+    EA_ASSERT_MSG(CanCompactBranchNodes(source), ("Source KDTree leaves reference too many entries for the compact format."));
+
+    for (uint32_t i = 0; i < m_numBranchNodes; ++i)
+    {
+        const KDTreeBase::BranchNode & branch = source.m_branchNodes[i];
+        BranchNode & compact = m_branchNodes[i];
+
+        uint32_t axisAndContents = branch.m_axis;
+        for (uint32_t child = 0; child < 2; ++child)
+        {
+            const KDTreeBase::NodeRef & childRef = branch.m_childRefs[child];
+            const uint32_t content = (childRef.m_content == rwcKDTREE_BRANCH_NODE) ?
+                uint32_t(rwcCOMPACTKDTREE_BRANCH_NODE) : childRef.m_content;
+            axisAndContents |= content << (2 + 15 * child);
+            compact.m_childIndices[child] = childRef.m_index;
+        }
+        compact.m_axisAndContents = axisAndContents;
+        compact.m_extents[0] = QuantizeCompactExtent(*this, branch.m_axis, branch.m_extents[0], TRUE);
+        compact.m_extents[1] = QuantizeCompactExtent(*this, branch.m_axis, branch.m_extents[1], FALSE);
+    }
+}
+
+} // namespace collision
+} // namespace rw
@@ -1302,6 +1302,25 @@ KDTreeBuilder::BuildTree(uint32_t numEntries,
     return m_numNodes;
 }
 
+/**
+\brief Returns the size of the memory allocated from the builder allocator by BuildTree, for a tree of
+the given number of nodes. All blocks are aligned to four bytes. The entry array is freed at the end of
+BuildTree, but a linear allocator only reclaims it once the KDTreeBuilder memory is released.
+
+\param numEntries  Number of entries indexed by the KDTree.
+\param numNodes    Number of nodes in the KDTree, as returned by BuildTree.
+
+\return The size in bytes of the memory allocated by BuildTree.
+*/
+uint32_t
+KDTreeBuilder::GetBuildMemoryRequirements(uint32_t numEntries, uint32_t numNodes)
+{
+    uint32_t size = numEntries * static_cast<uint32_t>(sizeof(Entry));
+    size += numNodes * static_cast<uint32_t>(sizeof(BuildNode));
+    size += numEntries * static_cast<uint32_t>(sizeof(uint32_t));
+    return size;
+}
+
 /**
 \brief Initialise a runtime KDTree from the build tree data
 */
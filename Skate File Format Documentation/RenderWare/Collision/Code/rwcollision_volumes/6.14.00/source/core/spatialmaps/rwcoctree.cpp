@@ -13,6 +13,7 @@
 #include <new>
 
 #include "rw/collision/octree.h"
+#include "rw/collision/metrics.h"
 
 using namespace rwpmath;
 
@@ -660,6 +661,7 @@ Octree::BBoxQuery::BBoxQuery(const Octree *octree,
     // Set up iterator in finished state, ready to pop the node off the stack
     m_curResult = -1;
     m_nextEntry = rwOCTREE_END_OF_LIST;
+    m_numNodesVisited = 0;
 
 }
 
@@ -675,6 +677,7 @@ void
 Octree::BBoxQuery::ProcessNode()
 {
     EA_ASSERT(m_top > 0);
+    rwcQUERYSTATS(++m_numNodesVisited);
 
     uint32_t    entryList;
 
@@ -768,6 +771,7 @@ Octree::LineQuery::LineQuery(const Octree *octree,
     // Set up iterator in finished state, ready to pop the node off the stack
     m_curResult = -1;
     m_nextEntry = rwOCTREE_END_OF_LIST;
+    m_numNodesVisited = 0;
 
 }
 
@@ -783,6 +787,7 @@ void
 Octree::LineQuery::ProcessNode()
 {
     EA_ASSERT(m_top > 0);
+    rwcQUERYSTATS(++m_numNodesVisited);
 
     uint32_t    entryList;
 
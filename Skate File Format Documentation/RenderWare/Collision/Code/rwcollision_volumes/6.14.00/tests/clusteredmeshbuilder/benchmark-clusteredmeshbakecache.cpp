@@ -0,0 +1,309 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/clusteredmeshbakecache.h>
+#include <rw/collision/clusteredmeshofflinebuilder.h>
+
+#include <serialization/serialization.h>
+#include <serialization/binary_stream_oarchive.h>
+#include <serialization/binary_stream_iarchive.h>
+#include <eaphysics/hlserializable.h>
+
+#include "benchmark_timer.hpp"
+
+#include "SimpleStream.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+// Benchmarks of the rebuild of a world of collision models, each a bumpy grid, with and without the bake
+// cache. Between cached rebuilds one model in a hundred is changed, so that the cached rebuild loads the
+// rest from an in memory store of their high level serialization.
+
+using namespace rw::collision;
+
+namespace
+{
+
+
+const uint32_t numModels = 100;
+const uint32_t modelGridSize = 24;
+const uint32_t modelNumVertices = (modelGridSize + 1) * (modelGridSize + 1);
+const uint32_t modelNumTriangles = 2 * modelGridSize * modelGridSize;
+
+
+/**
+The input buffers of a model, a grid whose vertex heights depend on a seed.
+*/
+struct ModelInput
+{
+    void Initialize(const uint32_t seed)
+    {
+        const uint32_t rowSize = modelGridSize + 1;
+
+        for (uint32_t z = 0 ; z < rowSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < rowSize ; ++x)
+            {
+                const float height = 0.125f * static_cast<float>((x * 7u + z * 3u + seed) % 8u) + 0.0001f * static_cast<float>(seed);
+                vertices[z * rowSize + x] = rw::math::fpu::Vector3U_32(static_cast<float>(x), height, static_cast<float>(z));
+            }
+        }
+
+        uint32_t triangleIndex = 0;
+        for (uint32_t z = 0 ; z < modelGridSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < modelGridSize ; ++x)
+            {
+                const uint32_t v0 = z * rowSize + x;
+                const uint32_t indices[6] = { v0, v0 + 1, v0 + rowSize, v0 + 1, v0 + rowSize + 1, v0 + rowSize };
+                for (uint32_t i = 0 ; i < 6 ; ++i)
+                {
+                    triangleVertexIndices[3 * triangleIndex + i] = indices[i];
+                }
+                triangleIndex += 2;
+            }
+        }
+
+        input.numTriangles = modelNumTriangles;
+        input.numVertices = modelNumVertices;
+        input.triangleVertexIndices = triangleVertexIndices;
+        input.vertices = vertices;
+    }
+
+    rw::math::fpu::Vector3U_32 vertices[modelNumVertices];
+    uint32_t triangleVertexIndices[3 * modelNumTriangles];
+
+    ClusteredMeshBakeCache::Input input;
+};
+
+
+/**
+Keeps the high level serialization of each saved ClusteredMesh in memory.
+*/
+class MemoryStore : public ClusteredMeshBakeCache::Store
+{
+public:
+
+    enum
+    {
+        MAX_ITEMS = 2 * numModels
+    };
+
+    explicit MemoryStore(EA::Allocator::ICoreAllocator &allocator)
+        : m_allocator(allocator)
+    {
+        for (uint32_t i = 0 ; i < MAX_ITEMS ; ++i)
+        {
+            m_items[i].buffer = NULL;
+        }
+    }
+
+    virtual ~MemoryStore()
+    {
+        for (uint32_t i = 0 ; i < MAX_ITEMS ; ++i)
+        {
+            if (NULL != m_items[i].buffer)
+            {
+                m_allocator.Free(m_items[i].buffer);
+            }
+        }
+    }
+
+    virtual ClusteredMesh *Load(const ClusteredMeshBakeCache::Key &key, EA::Allocator::ICoreAllocator &allocator)
+    {
+        Item *item = Find(key, false);
+        if (NULL == item)
+        {
+            return NULL;
+        }
+
+        ClusteredMesh *clusteredMesh = NULL;
+        SimpleStream strm(item->buffer, item->bufferSize);
+        EA::Serialization::basic_binary_stream_iarchive<SimpleStream, EA::Serialization::Endian::LittleEndianConverter> iArchive(strm);
+        iArchive & EAPHYSICS_HL_SERIALIZABLE_WITH_ALLOCATOR(ClusteredMesh, clusteredMesh, allocator);
+        return iArchive.Close() ? clusteredMesh : NULL;
+    }
+
+    virtual bool Save(const ClusteredMeshBakeCache::Key &key, ClusteredMesh &clusteredMesh, uint32_t &storedSize)
+    {
+        Remove(key);
+        Item *item = Find(key, true);
+        if (NULL == item)
+        {
+            return false;
+        }
+
+        const uint32_t size = clusteredMesh.GetSizeThis();
+        item->key = key;
+        item->bufferSize = 2 * size + 1024;
+        item->buffer = static_cast<uint8_t *>(m_allocator.Alloc(item->bufferSize, NULL, 0, 16));
+
+        ClusteredMesh *clusteredMeshPtr = &clusteredMesh;
+        SimpleStream strm(item->buffer, item->bufferSize);
+        EA::Serialization::basic_binary_stream_oarchive<SimpleStream, EA::Serialization::Endian::LittleEndianConverter> oArchive(strm);
+        oArchive & EAPHYSICS_HL_SERIALIZABLE(ClusteredMesh, clusteredMeshPtr);
+        storedSize = size;
+        return oArchive.Close();
+    }
+
+    virtual void Remove(const ClusteredMeshBakeCache::Key &key)
+    {
+        Item *item = Find(key, false);
+        if (NULL != item)
+        {
+            m_allocator.Free(item->buffer);
+            item->buffer = NULL;
+        }
+    }
+
+private:
+
+    struct Item
+    {
+        ClusteredMeshBakeCache::Key key;
+        uint8_t *buffer;
+        uint32_t bufferSize;
+    };
+
+    /// Finds the item with a key, or if free is set, any free item.
+    Item *Find(const ClusteredMeshBakeCache::Key &key, const bool free)
+    {
+        for (uint32_t i = 0 ; i < MAX_ITEMS ; ++i)
+        {
+            if (free ? (NULL == m_items[i].buffer) : ((NULL != m_items[i].buffer) && (m_items[i].key == key)))
+            {
+                return &m_items[i];
+            }
+        }
+        return NULL;
+    }
+
+    EA::Allocator::ICoreAllocator &m_allocator;
+    Item m_items[MAX_ITEMS];
+};
+
+
+} // namespace
+
+
+class BenchmarkClusteredMeshBakeCache : public tests::TestSuiteBase
+{
+public:
+
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkClusteredMeshBakeCache");
+
+        EATEST_REGISTER("BenchmarkWorldRebuild", "Rebuilding a world of models with and without the bake cache", BenchmarkClusteredMeshBakeCache, BenchmarkWorldRebuild);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        m_allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    }
+
+private:
+
+    void BenchmarkWorldRebuild();
+
+    EA::Allocator::ICoreAllocator * m_allocator;
+
+} BenchmarkClusteredMeshBakeCacheSingleton;
+
+
+void
+BenchmarkClusteredMeshBakeCache::BenchmarkWorldRebuild()
+{
+    const uint32_t numIterations = 3;
+
+    ModelInput * models = new ModelInput[numModels];
+    for (uint32_t model = 0 ; model < numModels ; ++model)
+    {
+        models[model].Initialize(model);
+    }
+
+    ClusteredMeshBakeCache::Parameters builderParams;
+    builderParams.vertexCompression_Enable = true;
+
+    // Rebuild of the whole world without the cache
+    rw::collision::Tests::BenchmarkTimer uncachedTimer;
+    for (uint32_t iteration = 0 ; iteration < numIterations ; ++iteration)
+    {
+        uncachedTimer.Start();
+        for (uint32_t model = 0 ; model < numModels ; ++model)
+        {
+            const ClusteredMeshBakeCache::Input & input = models[model].input;
+            ClusteredMeshOfflineBuilder offlineBuilder(input.numTriangles, input.numVertices, 0, builderParams, m_allocator);
+            for (uint32_t vertexIndex = 0 ; vertexIndex < input.numVertices ; ++vertexIndex)
+            {
+                offlineBuilder.SetVertex(vertexIndex, input.vertices[vertexIndex]);
+            }
+            for (uint32_t triangleIndex = 0 ; triangleIndex < input.numTriangles ; ++triangleIndex)
+            {
+                offlineBuilder.SetTriangle(triangleIndex,
+                    input.triangleVertexIndices[3 * triangleIndex],
+                    input.triangleVertexIndices[3 * triangleIndex + 1],
+                    input.triangleVertexIndices[3 * triangleIndex + 2]);
+            }
+            ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+            EATESTAssert(NULL != clusteredMesh, ("Each model should have been built"));
+            m_allocator->Free(clusteredMesh);
+        }
+        uncachedTimer.Stop();
+    }
+
+    // Rebuild of the whole world through the cache, after changing one model in a hundred
+    MemoryStore store(*m_allocator);
+    ClusteredMeshBakeCache cache(store, MemoryStore::MAX_ITEMS, 0, m_allocator);
+
+    for (uint32_t model = 0 ; model < numModels ; ++model)
+    {
+        ClusteredMesh * clusteredMesh = cache.BuildClusteredMesh(models[model].input, builderParams);
+        EATESTAssert(NULL != clusteredMesh, ("Each model should have been built"));
+        m_allocator->Free(clusteredMesh);
+    }
+
+    const uint32_t numChangedModels = (numModels + 99) / 100;
+    rw::collision::Tests::BenchmarkTimer cachedTimer;
+    for (uint32_t iteration = 0 ; iteration < numIterations ; ++iteration)
+    {
+        for (uint32_t changed = 0 ; changed < numChangedModels ; ++changed)
+        {
+            const uint32_t model = (iteration * 37u + changed) % numModels;
+            models[model].Initialize(model + numModels * (iteration + 1));
+        }
+
+        cache.ResetStatistics();
+        cachedTimer.Start();
+        for (uint32_t model = 0 ; model < numModels ; ++model)
+        {
+            ClusteredMesh * clusteredMesh = cache.BuildClusteredMesh(models[model].input, builderParams);
+            EATESTAssert(NULL != clusteredMesh, ("Each model should have been built or loaded"));
+            m_allocator->Free(clusteredMesh);
+        }
+        cachedTimer.Stop();
+    }
+
+    const ClusteredMeshBakeCache::Statistics & statistics = cache.GetStatistics();
+
+    delete [] models;
+
+    char description[256];
+    sprintf(description, "suite:BenchmarkClusteredMeshBakeCache,benchmark:WorldRebuild,method:Uncached,description:%u models of %u triangles",
+        numModels, modelNumTriangles);
+    EATESTSendBenchmark(description, uncachedTimer.GetAverageDurationMilliseconds(), uncachedTimer.GetMinDurationMilliseconds(), uncachedTimer.GetMaxDurationMilliseconds());
+
+    sprintf(description, "suite:BenchmarkClusteredMeshBakeCache,benchmark:WorldRebuild,method:Cached,description:%u models of %u triangles"
+        " %u hits %u misses %u stored bytes",
+        numModels, modelNumTriangles, statistics.numHits, statistics.numMisses, cache.GetTotalSize());
+    EATESTSendBenchmark(description, cachedTimer.GetAverageDurationMilliseconds(), cachedTimer.GetMinDurationMilliseconds(), cachedTimer.GetMaxDurationMilliseconds());
+}
@@ -8,6 +8,7 @@
 #include <rw/collision/clusteredmeshofflinebuilder.h>
 
 #include <rw/collision/meshbuilder/detail/clusteredmeshbuilder.h>
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
 
 #include <benchmarkenvironment/allocator.h>
 #include <stdlib.h>
@@ -16,6 +17,7 @@
 #include "eaphysics/unitframework/serialization_test_helpers.hpp"
 
 #include "benchmark_timer.hpp"
+#include "thread_dispatcher.hpp"
 
 #include "stdio.h"     // for sprintf()
 
@@ -31,6 +33,7 @@ using namespace rw::collision;
 
 #define USESIMPLETEST
 
+
 class BenchmarkClusteredMeshBuilder: public tests::TestSuiteBase
 {
 public:
@@ -65,6 +68,13 @@ private:
                             const uint32_t bufferSize,
                             const char *text);
 
+    uint32_t BenchmarkGridInputBuild(const uint32_t xCount,
+                                     const uint32_t yCount,
+                                     const uint32_t zCount,
+                                     const uint32_t bufferSize,
+                                     const char *text,
+                                     const uint32_t numWorkers);
+
     void CreateBuilderInput(rw::collision::ClusteredMeshRuntimeBuilder &builder,
                             const uint32_t xCount,
                             const uint32_t yCount,
@@ -135,6 +145,26 @@ void BenchmarkClusteredMeshBuilder::BenchmarkGridInput(const uint32_t xCount,
                                                        const uint32_t zCount,
                                                        const uint32_t bufferSize,
                                                        const char *text)
+{
+    // Serial build followed by builds with increasing numbers of worker threads.
+    // The parallel builds must produce exactly the same mesh as the serial build.
+    const uint32_t serialChecksum = BenchmarkGridInputBuild(xCount, yCount, zCount, bufferSize, text, 0u);
+
+    const uint32_t workerCounts[] = { 1u, 2u, 4u, 8u };
+    for (uint32_t i = 0; i < EAArrayCount(workerCounts); ++i)
+    {
+        const uint32_t checksum = BenchmarkGridInputBuild(xCount, yCount, zCount, bufferSize, text, workerCounts[i]);
+        EATESTAssert(checksum == serialChecksum, ("Parallel build should produce the same ClusteredMesh as the serial build"));
+    }
+}
+
+
+uint32_t BenchmarkClusteredMeshBuilder::BenchmarkGridInputBuild(const uint32_t xCount,
+                                                                const uint32_t yCount,
+                                                                const uint32_t zCount,
+                                                                const uint32_t bufferSize,
+                                                                const char *text,
+                                                                const uint32_t numWorkers)
 {
     const uint32_t triangleCount = xCount * yCount * zCount * 2u;
     const uint32_t vertexCount = triangleCount * 3u;
@@ -158,8 +188,10 @@ void BenchmarkClusteredMeshBuilder::BenchmarkGridInput(const uint32_t xCount,
                                                            static_cast<benchmarkenvironment::Address>(clusteredMeshAllocatorDataBuffer),
                                                            CLUSTEREDMESH_ALLOCATOR_DATA_BUFFER_SIZE);
 
-    // Use the default builder parameters
+    // Use the default builder parameters, with a dispatcher if any workers are requested
     rw::collision::ClusteredMeshRuntimeBuilder::Parameters builderParams;
+    rw::collision::Tests::ThreadDispatcher dispatcher(numWorkers);
+    builderParams.parallelDispatcher = numWorkers ? &dispatcher : NULL;
 
     // Create the runtime builder
     rw::collision::ClusteredMeshRuntimeBuilder runtimeBuilder(triangleCount,
@@ -184,6 +216,22 @@ void BenchmarkClusteredMeshBuilder::BenchmarkGridInput(const uint32_t xCount,
 
     runtimeBuilder.Release();
 
+    // Checksum of the cluster data, which unlike the rest of the mesh holds no pointers
+    uint32_t checksum = 2166136261u;
+    if (clusteredMesh)
+    {
+        for (uint32_t clusterIndex = 0; clusterIndex < clusteredMesh->GetNumCluster(); ++clusterIndex)
+        {
+            const rw::collision::ClusteredMeshCluster &cluster = clusteredMesh->GetCluster(clusterIndex);
+            const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&cluster);
+            const uint32_t clusterSize = clusteredMesh->GetClusterSize(cluster);
+            for (uint32_t byteIndex = 0; byteIndex < clusterSize; ++byteIndex)
+            {
+                checksum = (checksum ^ bytes[byteIndex]) * 16777619u;
+            }
+        }
+    }
+
     allocator->Free(clusteredMeshAllocatorDataBuffer);
     allocator->Free(clusteredMeshAllocatorHeaderBuffer);
     allocator->Free(clusteredMeshBuilderAllocatorBuffer);
@@ -191,14 +239,27 @@ void BenchmarkClusteredMeshBuilder::BenchmarkGridInput(const uint32_t xCount,
     EATESTAssert(clusteredMesh != NULL, ("ClusteredMesh should not be NULL"));
 
     char buffer[256];
-    sprintf(buffer,
-            "suite:BenchmarkClusteredMeshBuilder,benchmark:GenerateClusteredMesh,method:BuildClusteredMesh,description:%s - Input %d - Split - %d - LargeItem - %f",
-            text,
-            triangleCount,
-            builderParams.kdTreeBuilder_SplitThreshold,
-            builderParams.kdTreeBuilder_LargeItemThreshold);
+    if (numWorkers)
+    {
+        sprintf(buffer,
+                "suite:BenchmarkClusteredMeshBuilder,benchmark:GenerateClusteredMesh,method:BuildClusteredMeshParallel,description:%s - Input %d - Workers - %d",
+                text,
+                triangleCount,
+                numWorkers);
+    }
+    else
+    {
+        sprintf(buffer,
+                "suite:BenchmarkClusteredMeshBuilder,benchmark:GenerateClusteredMesh,method:BuildClusteredMesh,description:%s - Input %d - Split - %d - LargeItem - %f",
+                text,
+                triangleCount,
+                builderParams.kdTreeBuilder_SplitThreshold,
+                builderParams.kdTreeBuilder_LargeItemThreshold);
+    }
 
     EATESTSendBenchmark(buffer, timer.GetAverageDurationMilliseconds());
+
+    return checksum;
 }
 
 
@@ -0,0 +1,140 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/clusteredmeshofflinebuilder.h>
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+// Benchmarks of the incremental update of a ClusteredMesh, comparing it with a full rebuild of the
+// same edit. The edit raises a single vertex in the middle of a flat grid of shared vertices, so the
+// cost of the update should stay roughly constant as the grid grows.
+
+using namespace rw::collision;
+
+class BenchmarkClusteredMeshIncrementalUpdate : public tests::TestSuiteBase
+{
+public:
+
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkClusteredMeshIncrementalUpdate");
+
+        EATEST_REGISTER("BenchmarkMovedVertex", "Updating grids of increasing size after moving a single vertex", BenchmarkClusteredMeshIncrementalUpdate, BenchmarkMovedVertex);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        m_allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    }
+
+private:
+
+    void BenchmarkMovedVertex();
+
+    void BenchmarkGrid(const uint32_t gridSize);
+
+    EA::Allocator::ICoreAllocator * m_allocator;
+
+} BenchmarkClusteredMeshIncrementalUpdateSingleton;
+
+
+void
+BenchmarkClusteredMeshIncrementalUpdate::BenchmarkMovedVertex()
+{
+    BenchmarkGrid(32);
+    BenchmarkGrid(128);
+    BenchmarkGrid(512);
+}
+
+
+void
+BenchmarkClusteredMeshIncrementalUpdate::BenchmarkGrid(const uint32_t gridSize)
+{
+    const uint32_t numIterations = 5;
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t numVertices = rowSize * rowSize;
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    ClusteredMeshOfflineBuilder::Parameters builderParams;
+    builderParams.incrementalUpdate_Enable = true;
+
+    ClusteredMeshOfflineBuilder offlineBuilder(numTriangles, numVertices, 0, builderParams, m_allocator);
+
+    for (uint32_t z = 0 ; z < rowSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < rowSize ; ++x)
+        {
+            offlineBuilder.SetVertex(z * rowSize + x, rw::math::fpu::Vector3U_32(static_cast<float>(x), 0.0f, static_cast<float>(z)));
+        }
+    }
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            offlineBuilder.SetTriangle(triangleIndex++, v0, v0 + 1, v0 + rowSize);
+            offlineBuilder.SetTriangle(triangleIndex++, v0 + 1, v0 + rowSize + 1, v0 + rowSize);
+        }
+    }
+
+    // The six triangles around the moved vertex in the middle of the grid
+    const uint32_t middle = gridSize / 2;
+    const uint32_t movedVertex = middle * rowSize + middle;
+    const uint32_t changedTriangles[6] =
+    {
+        2 * (middle * gridSize + middle),
+        2 * ((middle - 1) * gridSize + middle),
+        2 * ((middle - 1) * gridSize + middle) + 1,
+        2 * (middle * gridSize + middle - 1),
+        2 * (middle * gridSize + middle - 1) + 1,
+        2 * ((middle - 1) * gridSize + middle - 1) + 1
+    };
+
+    rw::collision::Tests::BenchmarkTimer buildTimer;
+    rw::collision::Tests::BenchmarkTimer updateTimer;
+
+    for (uint32_t iteration = 0 ; iteration < numIterations ; ++iteration)
+    {
+        const float height = 0.25f * static_cast<float>(iteration + 1);
+        offlineBuilder.SetVertex(movedVertex, rw::math::fpu::Vector3U_32(static_cast<float>(middle), height, static_cast<float>(middle)));
+
+        // A full rebuild of the edited input, which also keeps the data for the next update
+        buildTimer.Start();
+        ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+        buildTimer.Stop();
+
+        EATESTAssert(NULL != clusteredMesh, ("The mesh should have been built"));
+
+        offlineBuilder.SetVertex(movedVertex, rw::math::fpu::Vector3U_32(static_cast<float>(middle), -height, static_cast<float>(middle)));
+
+        updateTimer.Start();
+        const bool updated = offlineBuilder.UpdateClusteredMesh(*clusteredMesh, changedTriangles, 6);
+        updateTimer.Stop();
+
+        EATESTAssert(updated, ("The mesh should have been updated"));
+
+        m_allocator->Free(clusteredMesh);
+    }
+
+    char buffer[256];
+    sprintf(buffer, "suite:BenchmarkClusteredMeshIncrementalUpdate,benchmark:MovedVertex,method:BuildClusteredMesh,description:%u triangles",
+        numTriangles);
+    EATESTSendBenchmark(buffer, buildTimer.GetAverageDurationMilliseconds(), buildTimer.GetMinDurationMilliseconds(), buildTimer.GetMaxDurationMilliseconds());
+
+    sprintf(buffer, "suite:BenchmarkClusteredMeshIncrementalUpdate,benchmark:MovedVertex,method:UpdateClusteredMesh,description:%u triangles",
+        numTriangles);
+    EATESTSendBenchmark(buffer, updateTimer.GetAverageDurationMilliseconds(), updateTimer.GetMinDurationMilliseconds(), updateTimer.GetMaxDurationMilliseconds());
+}
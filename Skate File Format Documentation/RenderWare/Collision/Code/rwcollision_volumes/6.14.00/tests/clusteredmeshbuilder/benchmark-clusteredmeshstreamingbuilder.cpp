@@ -0,0 +1,225 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/clusteredmeshstreamingbuilder.h>
+#include <rw/collision/clusteredmeshruntimebuilder.h>
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+// Benchmarks of the streaming build of a grid split into chunks of a fixed size, comparing it with a
+// runtime build of the whole grid. The peak workspace of the streaming build, reported with its
+// timings, grows only with the boundary edges of the chunks rather than with the whole grid.
+
+using namespace rw::collision;
+
+namespace
+{
+
+
+/**
+Reads the chunks of a flat grid.
+*/
+class GridChunkReader : public ClusteredMeshStreamingBuilder::ChunkReader
+{
+public:
+
+    GridChunkReader(const uint32_t gridSize, const uint32_t chunkSize)
+        : m_chunkSize(chunkSize)
+        , m_chunksPerSide(gridSize / chunkSize)
+    {
+    }
+
+    virtual uint32_t GetNumChunks()
+    {
+        return m_chunksPerSide * m_chunksPerSide;
+    }
+
+    virtual void GetChunkSize(uint32_t /*chunkIndex*/, uint32_t &numTriangles, uint32_t &numVertices)
+    {
+        numTriangles = 2u * m_chunkSize * m_chunkSize;
+        numVertices = (m_chunkSize + 1u) * (m_chunkSize + 1u);
+    }
+
+    virtual bool ReadChunk(uint32_t chunkIndex, ClusteredMeshStreamingBuilder::Chunk &chunk)
+    {
+        const uint32_t rowSize = m_chunkSize + 1u;
+        const uint32_t chunkX = (chunkIndex % m_chunksPerSide) * m_chunkSize;
+        const uint32_t chunkZ = (chunkIndex / m_chunksPerSide) * m_chunkSize;
+
+        for (uint32_t z = 0 ; z < rowSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < rowSize ; ++x)
+            {
+                chunk.vertices[z * rowSize + x] = rw::math::fpu::Vector3U_32(
+                    static_cast<float>(chunkX + x), 0.0f, static_cast<float>(chunkZ + z));
+            }
+        }
+
+        uint32_t triangleIndex = 0;
+        for (uint32_t z = 0 ; z < m_chunkSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < m_chunkSize ; ++x)
+            {
+                const uint32_t v0 = z * rowSize + x;
+                const uint32_t vertices[6] = { v0, v0 + 1u, v0 + rowSize, v0 + 1u, v0 + rowSize + 1u, v0 + rowSize };
+                for (uint32_t i = 0 ; i < 6 ; ++i)
+                {
+                    chunk.triangleVertexIndices[3u * triangleIndex + i] = vertices[i];
+                }
+                chunk.triangleGroupIDs[triangleIndex] = 0;
+                chunk.triangleSurfaceIDs[triangleIndex++] = 0;
+                chunk.triangleGroupIDs[triangleIndex] = 0;
+                chunk.triangleSurfaceIDs[triangleIndex++] = 0;
+            }
+        }
+
+        return true;
+    }
+
+private:
+
+    uint32_t m_chunkSize;
+    uint32_t m_chunksPerSide;
+};
+
+
+/**
+Discards the ClusteredMesh of each chunk.
+*/
+class NullChunkWriter : public ClusteredMeshStreamingBuilder::ChunkWriter
+{
+public:
+
+    virtual bool WriteChunkMesh(uint32_t /*chunkIndex*/, const ClusteredMesh & /*clusteredMesh*/)
+    {
+        return true;
+    }
+};
+
+
+} // namespace
+
+
+class BenchmarkClusteredMeshStreamingBuilder : public tests::TestSuiteBase
+{
+public:
+
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkClusteredMeshStreamingBuilder");
+
+        EATEST_REGISTER("BenchmarkChunkedGrid", "Building grids of increasing size in chunks and whole", BenchmarkClusteredMeshStreamingBuilder, BenchmarkChunkedGrid);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        m_allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    }
+
+private:
+
+    void BenchmarkChunkedGrid();
+
+    void BenchmarkGrid(const uint32_t gridSize);
+
+    EA::Allocator::ICoreAllocator * m_allocator;
+
+} BenchmarkClusteredMeshStreamingBuilderSingleton;
+
+
+void
+BenchmarkClusteredMeshStreamingBuilder::BenchmarkChunkedGrid()
+{
+    BenchmarkGrid(64);
+    BenchmarkGrid(128);
+    BenchmarkGrid(256);
+}
+
+
+void
+BenchmarkClusteredMeshStreamingBuilder::BenchmarkGrid(const uint32_t gridSize)
+{
+    const uint32_t numIterations = 3;
+    const uint32_t chunkSize = 32;
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t numVertices = rowSize * rowSize;
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    // A generous buffer for the whole grid build, which the streaming build uses a fraction of
+    const uint32_t bufferSize = 1024u * numTriangles;
+    uint8_t * buffer = static_cast<uint8_t *>(m_allocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshRuntimeBuilder::Parameters builderParams;
+
+    rw::collision::Tests::BenchmarkTimer wholeTimer;
+    rw::collision::Tests::BenchmarkTimer streamingTimer;
+    uint32_t streamingPeakMemory = 0;
+
+    for (uint32_t iteration = 0 ; iteration < numIterations ; ++iteration)
+    {
+        wholeTimer.Start();
+        {
+            ClusteredMeshRuntimeBuilder runtimeBuilder(numTriangles, numVertices, 0, builderParams, buffer, bufferSize, m_allocator);
+
+            for (uint32_t z = 0 ; z < rowSize ; ++z)
+            {
+                for (uint32_t x = 0 ; x < rowSize ; ++x)
+                {
+                    runtimeBuilder.SetVertex(z * rowSize + x, rw::math::fpu::Vector3U_32(static_cast<float>(x), 0.0f, static_cast<float>(z)));
+                }
+            }
+
+            uint32_t triangleIndex = 0;
+            for (uint32_t z = 0 ; z < gridSize ; ++z)
+            {
+                for (uint32_t x = 0 ; x < gridSize ; ++x)
+                {
+                    const uint32_t v0 = z * rowSize + x;
+                    runtimeBuilder.SetTriangle(triangleIndex++, v0, v0 + 1, v0 + rowSize);
+                    runtimeBuilder.SetTriangle(triangleIndex++, v0 + 1, v0 + rowSize + 1, v0 + rowSize);
+                }
+            }
+
+            ClusteredMesh * clusteredMesh = runtimeBuilder.BuildClusteredMesh();
+            EATESTAssert(NULL != clusteredMesh, ("The whole grid should have been built"));
+            m_allocator->Free(clusteredMesh);
+        }
+        wholeTimer.Stop();
+
+        streamingTimer.Start();
+        {
+            ClusteredMeshStreamingBuilder streamingBuilder(builderParams, buffer, bufferSize, m_allocator);
+
+            GridChunkReader reader(gridSize, chunkSize);
+            NullChunkWriter writer;
+
+            const bool built = streamingBuilder.BuildClusteredMeshes(reader, writer);
+            EATESTAssert(built, ("The chunks should have been built"));
+
+            streamingPeakMemory = streamingBuilder.GetPeakMemoryUsed();
+        }
+        streamingTimer.Stop();
+    }
+
+    m_allocator->Free(buffer);
+
+    char description[256];
+    sprintf(description, "suite:BenchmarkClusteredMeshStreamingBuilder,benchmark:ChunkedGrid,method:ClusteredMeshRuntimeBuilder,description:%u triangles %u buffer bytes",
+        numTriangles, bufferSize);
+    EATESTSendBenchmark(description, wholeTimer.GetAverageDurationMilliseconds(), wholeTimer.GetMinDurationMilliseconds(), wholeTimer.GetMaxDurationMilliseconds());
+
+    sprintf(description, "suite:BenchmarkClusteredMeshStreamingBuilder,benchmark:ChunkedGrid,method:ClusteredMeshStreamingBuilder,description:%u triangles %u peak bytes",
+        numTriangles, streamingPeakMemory);
+    EATESTSendBenchmark(description, streamingTimer.GetAverageDurationMilliseconds(), streamingTimer.GetMinDurationMilliseconds(), streamingTimer.GetMaxDurationMilliseconds());
+}
@@ -0,0 +1,223 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include <rw/collision/clusteredmeshofflinebuilder.h>
+#include <rw/collision/genericclusterunit.h>
+#include <rw/collision/clusterunitwalker.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Benchmarks of bbox queries against the skate mesh rebuilt with and without unit ordering, each query
+// decoding the vertices of every triangle returned. The description of each benchmark gives the number
+// of triangles returned, the same for both builds, and the total span of cluster vertex indices used by
+// the units of each leaf visited, which unit ordering reduces.
+
+namespace
+{
+
+
+typedef GenericClusterUnit<ClusteredMeshCluster::COMPRESSION_DYNAMIC> UnitType;
+
+
+/**
+Rebuilds the triangles of a ClusteredMesh, with unit ordering enabled or disabled.
+*/
+ClusteredMesh *
+RebuildClusteredMesh(const ClusteredMesh & source, const bool unitOrdering)
+{
+    const ClusterParams & clusterParams = source.GetClusterParams();
+
+    uint32_t numTriangles = 0;
+    for (uint32_t clusterIndex = 0; clusterIndex < source.GetNumCluster(); ++clusterIndex)
+    {
+        const ClusteredMeshCluster & cluster = source.GetCluster(clusterIndex);
+        UnitType unit(cluster, clusterParams);
+        for (ClusterUnitWalker<UnitType> walker(unit, cluster.unitCount); !walker.AtEnd(); walker.Next())
+        {
+            numTriangles += unit.GetTriCount();
+        }
+    }
+
+    ClusteredMeshOfflineBuilder::Parameters params;
+    params.unitOrdering_Enable = unitOrdering;
+
+    ClusteredMeshOfflineBuilder offlineBuilder(numTriangles, 3 * numTriangles, 0, params,
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator());
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t clusterIndex = 0; clusterIndex < source.GetNumCluster(); ++clusterIndex)
+    {
+        const ClusteredMeshCluster & cluster = source.GetCluster(clusterIndex);
+        UnitType unit(cluster, clusterParams);
+        for (ClusterUnitWalker<UnitType> walker(unit, cluster.unitCount); !walker.AtEnd(); walker.Next())
+        {
+            for (uint32_t tri = 0; tri < unit.GetTriCount(); ++tri)
+            {
+                Vector3 v[3];
+                unit.GetTriVertices(v[0], v[1], v[2], tri);
+                for (uint32_t i = 0; i < 3; ++i)
+                {
+                    offlineBuilder.SetVertex(3 * triangleIndex + i,
+                        rw::math::fpu::Vector3U_32(v[i].GetX(), v[i].GetY(), v[i].GetZ()));
+                }
+                offlineBuilder.SetTriangle(triangleIndex, 3 * triangleIndex, 3 * triangleIndex + 1, 3 * triangleIndex + 2);
+                ++triangleIndex;
+            }
+        }
+    }
+
+    return offlineBuilder.BuildClusteredMesh();
+}
+
+
+} // namespace
+
+
+class BenchmarkClusteredMeshUnitOrdering : public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkClusteredMeshUnitOrdering");
+
+        EATEST_REGISTER("BenchmarkBBoxQueryDecode", "BBox queries decoding the triangles of meshes built with and without unit ordering", BenchmarkClusteredMeshUnitOrdering, BenchmarkBBoxQueryDecode);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkBBoxQueryDecode();
+
+} BenchmarkClusteredMeshUnitOrderingSingleton;
+
+
+void BenchmarkClusteredMeshUnitOrdering::BenchmarkBBoxQueryDecode()
+{
+    const uint32_t numQueries = 1024;
+    const uint32_t numIterations = 5;
+
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+
+    Volume *clusteredMeshVolume = LoadSerializedClusteredMesh("skatemesh.dat");
+    EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+    AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+    ClusteredMesh *source = static_cast<ClusteredMesh *>(aggVol->GetAggregate());
+
+    ClusteredMesh * meshes[2] = { RebuildClusteredMesh(*source, false), RebuildClusteredMesh(*source, true) };
+    const char * methodNames[2] = { "BuildOrder", "UnitOrdering" };
+    EATESTAssert(meshes[0] && meshes[1], "Failed to rebuild clustered mesh.");
+
+    const AABBox & bbox = source->GetKDTreeBase()->GetBBox();
+    const Vector3 extent = bbox.Max() - bbox.Min();
+
+    // Query positions from a fixed pseudo random sequence so the results are repeatable.
+    static Vector3 points[numQueries];
+    uint32_t seed = 12345u;
+    for (uint32_t i = 0; i < numQueries; ++i)
+    {
+        float r[3];
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            r[k] = float(seed >> 8) / float(1u << 24);
+        }
+        points[i] = bbox.Min() + Vector3(r[0] * extent.GetX(), r[1] * extent.GetY(), r[2] * extent.GetZ());
+    }
+    const Vector3 halfSize = extent * VecFloat(0.01f);
+
+    uint32_t numTriangles[2] = { 0, 0 };
+    for (uint32_t method = 0; method < 2; ++method)
+    {
+        const ClusteredMesh & mesh = *meshes[method];
+        const ClusterParams & clusterParams = mesh.GetClusterParams();
+        const uint32_t shift = 16u + (clusterParams.mFlags & CMFLAG_20BITCLUSTERINDEX);
+        const uint32_t offsetMask = (1u << shift) - 1u;
+
+        rw::collision::Tests::BenchmarkTimer timer;
+        uint32_t vertexSpan = 0;
+        Vector3 sum(GetVector3_Zero());
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            numTriangles[method] = 0;
+            vertexSpan = 0;
+            timer.Start();
+            for (uint32_t i = 0; i < numQueries; ++i)
+            {
+                KDTreeBBoxQuery query(mesh.GetKDTreeBase(), AABBox(points[i] - halfSize, points[i] + halfSize));
+                uint32_t entry = 0, count = 0;
+                while (query.GetNext(entry, count))
+                {
+                    UnitType unit(mesh.GetCluster(entry >> shift), clusterParams, entry & offsetMask);
+                    uint32_t minIndex = 0xFF;
+                    uint32_t maxIndex = 0;
+                    for (ClusterUnitWalker<UnitType> walker(unit, count); !walker.AtEnd(); walker.Next())
+                    {
+                        for (uint32_t tri = 0; tri < unit.GetTriCount(); ++tri)
+                        {
+                            Vector3 v0, v1, v2;
+                            unit.GetTriVertices(v0, v1, v2, tri);
+                            sum += v0 + v1 + v2;
+
+                            uint8_t i0, i1, i2;
+                            unit.GetTriVertexIndices(i0, i1, i2, tri);
+                            const uint8_t indices[3] = { i0, i1, i2 };
+                            for (uint32_t k = 0; k < 3; ++k)
+                            {
+                                minIndex = (indices[k] < minIndex) ? indices[k] : minIndex;
+                                maxIndex = (indices[k] > maxIndex) ? indices[k] : maxIndex;
+                            }
+                            ++numTriangles[method];
+                        }
+                    }
+                    if (minIndex <= maxIndex)
+                    {
+                        vertexSpan += maxIndex - minIndex + 1;
+                    }
+                }
+            }
+            timer.Stop();
+        }
+
+        char buffer[256];
+        sprintf(buffer, "suite:BenchmarkClusteredMeshUnitOrdering,benchmark:skatemesh.dat,method:%s,description:%u triangles from %u queries"
+            " with a leaf vertex span of %u (checksum %f)",
+            methodNames[method], numTriangles[method], numQueries, vertexSpan, static_cast<float>(sum.GetX()));
+        EATESTSendBenchmark(buffer, timer.GetAverageDurationMilliseconds(), timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+    }
+
+    EATESTAssert(numTriangles[0] == numTriangles[1], "Both builds should return the same triangles.");
+
+    allocator->Free(meshes[0]);
+    allocator->Free(meshes[1]);
+    allocator->Free(aggVol->GetAggregate());
+    allocator->Free(aggVol);
+}
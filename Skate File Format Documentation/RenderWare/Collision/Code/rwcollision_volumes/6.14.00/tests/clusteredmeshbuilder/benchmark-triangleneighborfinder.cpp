@@ -0,0 +1,167 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/meshbuilder/detail/triangleneighborfinder.h>
+#include <rw/collision/meshbuilder/detail/types.h>
+#include <rw/collision/meshbuilder/common.h>
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+// Benchmarks of the triangle neighbor finder, comparing the walk of the vertex triangle map with
+// matching sorted edge records. The meshes are grids of triangle fans, so that the number of
+// triangles sharing each fan center vertex can be varied independently of the triangle count.
+
+using namespace rw::collision::meshbuilder::detail;
+using namespace rw::collision;
+
+class BenchmarkTriangleNeighborFinder : public tests::TestSuiteBase
+{
+public:
+
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkTriangleNeighborFinder");
+
+        EATEST_REGISTER("BenchmarkFans", "Neighbor finding on grids of triangle fans", BenchmarkTriangleNeighborFinder, BenchmarkFans);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        m_allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    }
+
+private:
+
+    void BenchmarkFans();
+
+    void BenchmarkFanGrid(const uint32_t numFans, const uint32_t numFanTriangles);
+
+    EA::Allocator::ICoreAllocator * m_allocator;
+
+} BenchmarkTriangleNeighborFinderSingleton;
+
+
+void
+BenchmarkTriangleNeighborFinder::BenchmarkFans()
+{
+    // Roughly 64k triangles in each mesh, from many low valence fans to a single fan
+    BenchmarkFanGrid(4096, 16);
+    BenchmarkFanGrid(256, 256);
+    BenchmarkFanGrid(16, 4096);
+    BenchmarkFanGrid(1, 65536);
+}
+
+
+void
+BenchmarkTriangleNeighborFinder::BenchmarkFanGrid(const uint32_t numFans, const uint32_t numFanTriangles)
+{
+    const uint32_t numIterations = 5;
+    const uint32_t numVertices = numFans * (1 + numFanTriangles);
+    const uint32_t numTriangles = numFans * numFanTriangles;
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    TriangleList * triangles = TriangleList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    TriangleFlagsList * triangleFlags = TriangleFlagsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    TriangleNeighborsList * triangleNeighbors = TriangleNeighborsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    TriangleEdgeCosinesList * triangleEdgeCosines = TriangleEdgeCosinesList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices && triangles && triangleFlags && triangleNeighbors && triangleEdgeCosines, ("Lists should have been allocated"));
+
+    vertices->resize(numVertices);
+    triangles->resize(numTriangles);
+    triangleFlags->resize(numTriangles);
+    triangleNeighbors->resize(numTriangles);
+    triangleEdgeCosines->resize(numTriangles);
+
+    // Lay the fans out on a square grid, each with a closed ring of slightly bumpy triangles
+    uint32_t gridSize = 1;
+    while (gridSize * gridSize < numFans)
+    {
+        ++gridSize;
+    }
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t fanIndex = 0 ; fanIndex < numFans ; ++fanIndex)
+    {
+        const uint32_t centerIndex = fanIndex * (1 + numFanTriangles);
+        const float centerX = static_cast<float>(fanIndex % gridSize) * 3.0f;
+        const float centerZ = static_cast<float>(fanIndex / gridSize) * 3.0f;
+
+        (*vertices)[centerIndex] = meshbuilder::VectorType(centerX, 0.0f, centerZ);
+        for (uint32_t ringIndex = 0 ; ringIndex < numFanTriangles ; ++ringIndex)
+        {
+            const float angle = 6.2831853f * static_cast<float>(ringIndex) / static_cast<float>(numFanTriangles);
+            const float height = (ringIndex % 2) * 0.1f;
+            (*vertices)[centerIndex + 1 + ringIndex] = meshbuilder::VectorType(centerX + rwpmath::Cos(angle), height, centerZ + rwpmath::Sin(angle));
+
+            (*triangles)[triangleIndex].vertices[0] = centerIndex;
+            (*triangles)[triangleIndex].vertices[1] = centerIndex + 1 + (ringIndex + 1) % numFanTriangles;
+            (*triangles)[triangleIndex].vertices[2] = centerIndex + 1 + ringIndex;
+            (*triangleFlags)[triangleIndex].enabled = true;
+            ++triangleIndex;
+        }
+    }
+
+    rw::collision::Tests::BenchmarkTimer mapTimer;
+    rw::collision::Tests::BenchmarkTimer sortTimer;
+
+    for (uint32_t iteration = 0 ; iteration < numIterations ; ++iteration)
+    {
+        // The map walk is timed including building the vertex triangle map, which is its only use
+        TriangleNeighborFinder::InitializeTriangleNeighbors(*triangleNeighbors);
+        TriangleNeighborFinder::InitializeTriangleEdgeCosines(*triangleEdgeCosines);
+
+        mapTimer.Start();
+        VertexTriangleMap vertexTriangleMap;
+        vertexTriangleMap.Initialize(numTriangles, m_allocator);
+        TriangleNeighborFinder::InitializeVertexTriangleMap(vertexTriangleMap, *triangles);
+        TriangleNeighborFinder::FindTriangleNeighbors(
+            *triangles,
+            *triangleEdgeCosines,
+            *triangleNeighbors,
+            *triangleFlags,
+            *vertices,
+            vertexTriangleMap);
+        vertexTriangleMap.Release();
+        mapTimer.Stop();
+
+        TriangleNeighborFinder::InitializeTriangleNeighbors(*triangleNeighbors);
+        TriangleNeighborFinder::InitializeTriangleEdgeCosines(*triangleEdgeCosines);
+
+        sortTimer.Start();
+        const bool found = TriangleNeighborFinder::FindTriangleNeighborsByEdgeSort(
+            *triangles,
+            *triangleEdgeCosines,
+            *triangleNeighbors,
+            *triangleFlags,
+            *vertices,
+            m_allocator);
+        sortTimer.Stop();
+
+        EATESTAssert(found, ("FindTriangleNeighborsByEdgeSort should have allocated its temporary data"));
+    }
+
+    char buffer[256];
+    sprintf(buffer, "suite:BenchmarkTriangleNeighborFinder,benchmark:Fans,method:VertexTriangleMap,description:%u fans of %u triangles",
+        numFans, numFanTriangles);
+    EATESTSendBenchmark(buffer, mapTimer.GetAverageDurationMilliseconds(), mapTimer.GetMinDurationMilliseconds(), mapTimer.GetMaxDurationMilliseconds());
+
+    sprintf(buffer, "suite:BenchmarkTriangleNeighborFinder,benchmark:Fans,method:EdgeSort,description:%u fans of %u triangles",
+        numFans, numFanTriangles);
+    EATESTSendBenchmark(buffer, sortTimer.GetAverageDurationMilliseconds(), sortTimer.GetMinDurationMilliseconds(), sortTimer.GetMaxDurationMilliseconds());
+
+    TriangleEdgeCosinesList::Free(m_allocator, triangleEdgeCosines);
+    TriangleNeighborsList::Free(m_allocator, triangleNeighbors);
+    TriangleFlagsList::Free(m_allocator, triangleFlags);
+    TriangleList::Free(m_allocator, triangles);
+    VertexList::Free(m_allocator, vertices);
+}
@@ -0,0 +1,141 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/meshbuilder/vertexmerger.h>
+#include <rw/collision/meshbuilder/detail/types.h>
+#include <rw/collision/meshbuilder/common.h>
+
+#include "benchmark_timer.hpp"
+#include "thread_dispatcher.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+// Benchmarks of the vertex merger on triangle soups, in which no vertices are shared, with
+// different numbers of worker threads. The description of each benchmark gives the throughput
+// in vertices per second.
+
+using namespace rw::collision::meshbuilder::detail;
+using namespace rw::collision::meshbuilder;
+using namespace rw::collision;
+
+class BenchmarkVertexMerger : public tests::TestSuiteBase
+{
+public:
+
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkVertexMerger");
+
+        EATEST_REGISTER("BenchmarkTriangleSoup", "Merging the vertices of a 10M vertex triangle soup", BenchmarkVertexMerger, BenchmarkTriangleSoup);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        m_allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    }
+
+private:
+
+    void BenchmarkTriangleSoup();
+
+    EA::Allocator::ICoreAllocator * m_allocator;
+
+} BenchmarkVertexMergerSingleton;
+
+
+void
+BenchmarkVertexMerger::BenchmarkTriangleSoup()
+{
+    const uint32_t numIterations = 3;
+    const uint32_t gridSize = 1291u;
+    const uint32_t numVertices = gridSize * gridSize * 6u;
+    const float tolerance = 0.01f;
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    IDList * serialVertexGroup = IDList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    IDList * vertexGroup = IDList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices && serialVertexGroup && vertexGroup, ("Lists should have been allocated"));
+
+    vertices->resize(numVertices);
+    serialVertexGroup->resize(numVertices);
+    vertexGroup->resize(numVertices);
+
+    // Two unshared triangles for each cell of a gently undulating grid
+    uint32_t vertexIndex = 0;
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t cornerX[6] = { x, x + 1, x, x + 1, x + 1, x };
+            const uint32_t cornerZ[6] = { z, z, z + 1, z, z + 1, z + 1 };
+            for (uint32_t corner = 0 ; corner < 6 ; ++corner)
+            {
+                const float height = static_cast<float>((cornerX[corner] * 7u + cornerZ[corner] * 13u) % 17u) * 0.05f;
+                (*vertices)[vertexIndex++] = VectorType(static_cast<float>(cornerX[corner]), height, static_cast<float>(cornerZ[corner]));
+            }
+        }
+    }
+
+    VertexMerger::AABBoxType aabbox(
+        VertexMerger::AABBoxType::Vector3Type(0.0f, 0.0f, 0.0f),
+        VertexMerger::AABBoxType::Vector3Type(static_cast<float>(gridSize), 0.8f, static_cast<float>(gridSize)));
+
+    const uint32_t workerCounts[] = { 0u, 1u, 2u, 4u, 8u };
+    const uint32_t numWorkerCounts = sizeof(workerCounts) / sizeof(workerCounts[0]);
+
+    for (uint32_t workerCountIndex = 0 ; workerCountIndex < numWorkerCounts ; ++workerCountIndex)
+    {
+        const uint32_t numWorkers = workerCounts[workerCountIndex];
+        rw::collision::Tests::ThreadDispatcher dispatcher(numWorkers);
+        IDList * const groups = numWorkers ? vertexGroup : serialVertexGroup;
+
+        rw::collision::Tests::BenchmarkTimer timer;
+        for (uint32_t iteration = 0 ; iteration < numIterations ; ++iteration)
+        {
+            for (vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+            {
+                (*groups)[vertexIndex] = vertexIndex;
+            }
+
+            timer.Start();
+            const bool merged = VertexMerger::MergeVertexGroups(
+                *groups,
+                *m_allocator,
+                aabbox,
+                rwpmath::VecFloat(tolerance),
+                *vertices,
+                numWorkers ? &dispatcher : NULL);
+            timer.Stop();
+
+            EATESTAssert(merged, ("MergeVertexGroups should have allocated its temporary data"));
+        }
+
+        if (numWorkers)
+        {
+            for (vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+            {
+                EATESTAssert((*vertexGroup)[vertexIndex] == (*serialVertexGroup)[vertexIndex], ("Vertex groups should not depend on the number of workers"));
+            }
+        }
+
+        const double averageMilliseconds = timer.GetAverageDurationMilliseconds();
+        const double verticesPerSecond = averageMilliseconds > 0.0 ? (numVertices * 1000.0 / averageMilliseconds) : 0.0;
+
+        char buffer[256];
+        sprintf(buffer, "suite:BenchmarkVertexMerger,benchmark:TriangleSoup,method:MergeVertexGroups,description:Workers - %u - %u vertices - %.0f vertices per second",
+            numWorkers, numVertices, verticesPerSecond);
+        EATESTSendBenchmark(buffer, averageMilliseconds, timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+    }
+
+    IDList::Free(m_allocator, vertexGroup);
+    IDList::Free(m_allocator, serialVertexGroup);
+    VertexList::Free(m_allocator, vertices);
+}
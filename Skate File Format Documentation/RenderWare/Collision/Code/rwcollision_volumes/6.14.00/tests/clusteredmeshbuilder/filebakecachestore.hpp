@@ -0,0 +1,210 @@
+// (c) Electronic Arts. All Rights Reserved.
+#if !defined(RW_COLLISION_UNITTEST_FILEBAKECACHESTORE_H)
+#define RW_COLLISION_UNITTEST_FILEBAKECACHESTORE_H
+
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/clusteredmeshbakecache.h>
+#include <rw/collision/clusteredmesh.h>
+
+#include <serialization/serialization.h>
+#include <serialization/binary_stream_oarchive.h>
+#include <serialization/binary_stream_iarchive.h>
+#include <eaphysics/hlserializable.h>
+
+#include <fstream>
+#include <stdio.h>     // for fopen(), remove()
+#include <string.h>    // for strlen()
+
+namespace rw
+{
+namespace collision
+{
+namespace unittest
+{
+
+/**
+A ClusteredMeshBakeCache::Store which keeps the serialization of each ClusteredMesh in a file of a directory,
+named by the key string, and the cache index in a file named "index" in the same directory.
+
+The index holds a line for each entry with its key, stored size and time of last use. It is written after a
+bake with SaveIndex and read back into a new cache with LoadIndex, which skips the entries whose file has
+gone, so that the least recently used entries are still evicted first across bakes.
+*/
+class FileBakeCacheStore : public ClusteredMeshBakeCache::Store
+{
+public:
+
+    enum
+    {
+        MAX_PATH_SIZE = 256
+    };
+
+    /// Uses a directory, which must exist, given without a trailing separator.
+    explicit FileBakeCacheStore(const char *directory)
+        : m_directory(directory)
+    {
+        EA_ASSERT(strlen(directory) + 1u + ClusteredMeshBakeCache::Key::STRING_SIZE <= MAX_PATH_SIZE);
+    }
+
+    virtual ClusteredMesh *Load(const ClusteredMeshBakeCache::Key &key, EA::Allocator::ICoreAllocator &allocator)
+    {
+        char path[MAX_PATH_SIZE];
+        GetPath(path, key);
+
+        std::ifstream strm(path, std::ios::in | std::ios::binary);
+        if (!strm)
+        {
+            return NULL;
+        }
+
+        ClusteredMesh *clusteredMesh = NULL;
+        EA::Serialization::basic_binary_stream_iarchive<std::ifstream, EA::Serialization::Endian::LittleEndianConverter> iArchive(strm);
+        iArchive & EAPHYSICS_HL_SERIALIZABLE_WITH_ALLOCATOR(ClusteredMesh, clusteredMesh, allocator);
+        if (!iArchive.Close())
+        {
+            if (NULL != clusteredMesh)
+            {
+                allocator.Free(clusteredMesh);
+            }
+            return NULL;
+        }
+
+        return clusteredMesh;
+    }
+
+    virtual bool Save(const ClusteredMeshBakeCache::Key &key, ClusteredMesh &clusteredMesh, uint32_t &storedSize)
+    {
+        char path[MAX_PATH_SIZE];
+        GetPath(path, key);
+
+        bool saved = false;
+        {
+            std::ofstream strm(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!strm)
+            {
+                return false;
+            }
+
+            ClusteredMesh *clusteredMeshPtr = &clusteredMesh;
+            EA::Serialization::basic_binary_stream_oarchive<std::ofstream, EA::Serialization::Endian::LittleEndianConverter> oArchive(strm);
+            oArchive & EAPHYSICS_HL_SERIALIZABLE(ClusteredMesh, clusteredMeshPtr);
+            saved = oArchive.Close() && strm.good();
+            storedSize = saved ? static_cast<uint32_t>(strm.tellp()) : 0u;
+        }
+
+        if (!saved)
+        {
+            remove(path);
+        }
+
+        return saved;
+    }
+
+    virtual void Remove(const ClusteredMeshBakeCache::Key &key)
+    {
+        char path[MAX_PATH_SIZE];
+        GetPath(path, key);
+        remove(path);
+    }
+
+    /// Returns whether the file of a key exists.
+    bool Contains(const ClusteredMeshBakeCache::Key &key) const
+    {
+        char path[MAX_PATH_SIZE];
+        GetPath(path, key);
+
+        FILE *file = fopen(path, "rb");
+        if (NULL == file)
+        {
+            return false;
+        }
+
+        fclose(file);
+        return true;
+    }
+
+    /// Writes the index of a cache of this store, returning false if it cannot be written.
+    bool SaveIndex(const ClusteredMeshBakeCache &cache) const
+    {
+        char path[MAX_PATH_SIZE];
+        GetIndexPath(path);
+
+        FILE *file = fopen(path, "w");
+        if (NULL == file)
+        {
+            return false;
+        }
+
+        bool saved = true;
+        for (uint32_t entryIndex = 0 ; entryIndex < cache.GetNumEntries() ; ++entryIndex)
+        {
+            const ClusteredMeshBakeCache::Entry &entry = cache.GetEntry(entryIndex);
+
+            char keyString[ClusteredMeshBakeCache::Key::STRING_SIZE];
+            entry.key.ToString(keyString);
+            saved = saved && (fprintf(file, "%s %u %u\n", keyString, entry.size, entry.lastUse) > 0);
+        }
+
+        return (0 == fclose(file)) && saved;
+    }
+
+    /// Registers the entries of the saved index with a new cache of this store, returning the number registered.
+    uint32_t LoadIndex(ClusteredMeshBakeCache &cache) const
+    {
+        char path[MAX_PATH_SIZE];
+        GetIndexPath(path);
+
+        FILE *file = fopen(path, "r");
+        if (NULL == file)
+        {
+            return 0;
+        }
+
+        uint32_t numRegistered = 0;
+        char keyString[ClusteredMeshBakeCache::Key::STRING_SIZE];
+        unsigned int size = 0;
+        unsigned int lastUse = 0;
+        while (3 == fscanf(file, "%32s %u %u", keyString, &size, &lastUse))
+        {
+            ClusteredMeshBakeCache::Key key;
+            if (key.FromString(keyString) && Contains(key) && cache.RegisterEntry(key, size, lastUse))
+            {
+                ++numRegistered;
+            }
+        }
+
+        fclose(file);
+        return numRegistered;
+    }
+
+    /// Removes the saved index.
+    void RemoveIndex() const
+    {
+        char path[MAX_PATH_SIZE];
+        GetIndexPath(path);
+        remove(path);
+    }
+
+private:
+
+    void GetPath(char *path, const ClusteredMeshBakeCache::Key &key) const
+    {
+        char keyString[ClusteredMeshBakeCache::Key::STRING_SIZE];
+        key.ToString(keyString);
+        sprintf(path, "%s/%s", m_directory, keyString);
+    }
+
+    void GetIndexPath(char *path) const
+    {
+        sprintf(path, "%s/index", m_directory);
+    }
+
+    const char *m_directory;
+};
+
+} // namespace unittest
+} // namespace collision
+} // namespace rw
+
+#endif // !defined(RW_COLLISION_UNITTEST_FILEBAKECACHESTORE_H)
@@ -0,0 +1,822 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/clusteredmeshbakecache.h>
+#include <rw/collision/clusteredmeshofflinebuilder.h>
+
+#include <serialization/serialization.h>
+#include <serialization/binary_stream_oarchive.h>
+#include <serialization/binary_stream_iarchive.h>
+#include <eaphysics/hlserializable.h>
+
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+#include "benchmarkenvironment/allocator.h"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "SimpleStream.hpp"
+#include "thread_dispatcher.hpp"
+#include "filebakecachestore.hpp"
+
+#include <string.h>    // for memcmp(), strcmp()
+
+using namespace rw::collision;
+
+// Unit tests for the ClusteredMeshBakeCache. The input is a bumpy grid of gridSize by gridSize cells, and
+// the Store keeps the high level serialization of each mesh in memory.
+
+namespace
+{
+
+
+const uint32_t gridSize = 8;
+const uint32_t gridNumVertices = (gridSize + 1) * (gridSize + 1);
+const uint32_t gridNumTriangles = 2 * gridSize * gridSize;
+
+
+/**
+The input buffers of the test grid, with vertex heights scaled by a height scale.
+*/
+struct GridInput
+{
+    GridInput()
+    {
+        Initialize(0.25f);
+    }
+
+    void Initialize(const float heightScale)
+    {
+        const uint32_t rowSize = gridSize + 1;
+
+        for (uint32_t z = 0 ; z < rowSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < rowSize ; ++x)
+            {
+                const float height = heightScale * static_cast<float>((x * 7u + z * 3u) % 4u);
+                vertices[z * rowSize + x] = rw::math::fpu::Vector3U_32(static_cast<float>(x), height, static_cast<float>(z));
+            }
+        }
+
+        uint32_t triangleIndex = 0;
+        for (uint32_t z = 0 ; z < gridSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < gridSize ; ++x)
+            {
+                const uint32_t v0 = z * rowSize + x;
+                const uint32_t indices[6] = { v0, v0 + 1, v0 + rowSize, v0 + 1, v0 + rowSize + 1, v0 + rowSize };
+                for (uint32_t i = 0 ; i < 6 ; ++i)
+                {
+                    triangleVertexIndices[3 * triangleIndex + i] = indices[i];
+                }
+                groupIDs[triangleIndex] = 0;
+                surfaceIDs[triangleIndex++] = 0;
+                groupIDs[triangleIndex] = 0;
+                surfaceIDs[triangleIndex++] = 0;
+            }
+        }
+
+        mergePlaneNormals[0] = rwpmath::Vector3(1.0f, 0.0f, 0.0f);
+        mergePlaneDistances[0] = rwpmath::VecFloat(-100.0f);
+
+        input.numTriangles = gridNumTriangles;
+        input.numVertices = gridNumVertices;
+        input.numMergePlanes = 1;
+        input.triangleVertexIndices = triangleVertexIndices;
+        input.triangleGroupIDs = groupIDs;
+        input.triangleSurfaceIDs = surfaceIDs;
+        input.vertices = vertices;
+        input.mergePlaneNormals = mergePlaneNormals;
+        input.mergePlaneDistances = mergePlaneDistances;
+    }
+
+    rw::math::fpu::Vector3U_32 vertices[gridNumVertices];
+    uint32_t triangleVertexIndices[3 * gridNumTriangles];
+    uint32_t groupIDs[gridNumTriangles];
+    uint32_t surfaceIDs[gridNumTriangles];
+    rwpmath::Vector3 mergePlaneNormals[1];
+    rwpmath::VecFloat mergePlaneDistances[1];
+
+    ClusteredMeshBakeCache::Input input;
+
+private:
+
+    /// Private copy constructor, since the input refers to the buffers.
+    GridInput(const GridInput & other);
+    /// Private assignment operator.
+    GridInput & operator = (const GridInput & other);
+};
+
+
+/**
+Keeps the high level serialization of each saved ClusteredMesh in memory.
+*/
+class MemoryStore : public ClusteredMeshBakeCache::Store
+{
+public:
+
+    enum
+    {
+        MAX_ITEMS = 8
+    };
+
+    explicit MemoryStore(EA::Allocator::ICoreAllocator &allocator)
+        : m_allocator(allocator)
+        , m_failLoads(false)
+        , m_numLoads(0)
+    {
+        for (uint32_t i = 0 ; i < MAX_ITEMS ; ++i)
+        {
+            m_items[i].buffer = NULL;
+        }
+    }
+
+    virtual ~MemoryStore()
+    {
+        for (uint32_t i = 0 ; i < MAX_ITEMS ; ++i)
+        {
+            if (NULL != m_items[i].buffer)
+            {
+                m_allocator.Free(m_items[i].buffer);
+            }
+        }
+    }
+
+    virtual ClusteredMesh *Load(const ClusteredMeshBakeCache::Key &key, EA::Allocator::ICoreAllocator &allocator)
+    {
+        ++m_numLoads;
+
+        Item *item = Find(key);
+        if (NULL == item || m_failLoads)
+        {
+            return NULL;
+        }
+
+        ClusteredMesh *clusteredMesh = NULL;
+        SimpleStream strm(item->buffer, item->bufferSize);
+        EA::Serialization::basic_binary_stream_iarchive<SimpleStream, EA::Serialization::Endian::LittleEndianConverter> iArchive(strm);
+        iArchive & EAPHYSICS_HL_SERIALIZABLE_WITH_ALLOCATOR(ClusteredMesh, clusteredMesh, allocator);
+        if (!iArchive.Close())
+        {
+            return NULL;
+        }
+
+        return clusteredMesh;
+    }
+
+    virtual bool Save(const ClusteredMeshBakeCache::Key &key, ClusteredMesh &clusteredMesh, uint32_t &storedSize)
+    {
+        Remove(key);
+        Item *item = Find(key, true);
+        if (NULL == item)
+        {
+            return false;
+        }
+
+        const uint32_t size = clusteredMesh.GetSizeThis();
+        item->key = key;
+        item->bufferSize = 2 * size + 1024;
+        item->buffer = static_cast<uint8_t *>(m_allocator.Alloc(item->bufferSize, NULL, 0, 16));
+
+        ClusteredMesh *clusteredMeshPtr = &clusteredMesh;
+        SimpleStream strm(item->buffer, item->bufferSize);
+        EA::Serialization::basic_binary_stream_oarchive<SimpleStream, EA::Serialization::Endian::LittleEndianConverter> oArchive(strm);
+        oArchive & EAPHYSICS_HL_SERIALIZABLE(ClusteredMesh, clusteredMeshPtr);
+        if (!oArchive.Close())
+        {
+            m_allocator.Free(item->buffer);
+            item->buffer = NULL;
+            return false;
+        }
+
+        storedSize = size;
+        return true;
+    }
+
+    virtual void Remove(const ClusteredMeshBakeCache::Key &key)
+    {
+        Item *item = Find(key);
+        if (NULL != item)
+        {
+            m_allocator.Free(item->buffer);
+            item->buffer = NULL;
+        }
+    }
+
+    bool Contains(const ClusteredMeshBakeCache::Key &key)
+    {
+        return NULL != Find(key);
+    }
+
+    uint32_t GetNumItems() const
+    {
+        uint32_t numItems = 0;
+        for (uint32_t i = 0 ; i < MAX_ITEMS ; ++i)
+        {
+            numItems += (NULL != m_items[i].buffer) ? 1u : 0u;
+        }
+        return numItems;
+    }
+
+    void SetFailLoads(const bool failLoads)
+    {
+        m_failLoads = failLoads;
+    }
+
+    uint32_t GetNumLoads() const
+    {
+        return m_numLoads;
+    }
+
+private:
+
+    struct Item
+    {
+        ClusteredMeshBakeCache::Key key;
+        uint8_t *buffer;
+        uint32_t bufferSize;
+    };
+
+    /// Finds the item with a key, or if free is set, any free item.
+    Item *Find(const ClusteredMeshBakeCache::Key &key, const bool free = false)
+    {
+        for (uint32_t i = 0 ; i < MAX_ITEMS ; ++i)
+        {
+            if (free ? (NULL == m_items[i].buffer) : ((NULL != m_items[i].buffer) && (m_items[i].key == key)))
+            {
+                return &m_items[i];
+            }
+        }
+        return NULL;
+    }
+
+    EA::Allocator::ICoreAllocator &m_allocator;
+    Item m_items[MAX_ITEMS];
+    bool m_failLoads;
+    uint32_t m_numLoads;
+};
+
+
+} // namespace
+
+
+class TestClusteredMeshBakeCache : public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestClusteredMeshBakeCache");
+        EATEST_REGISTER("TestKeyInput", "Cache keys change with each part of the input", TestClusteredMeshBakeCache, TestKeyInput);
+        EATEST_REGISTER("TestKeyParameters", "Cache keys change with each build parameter", TestClusteredMeshBakeCache, TestKeyParameters);
+        EATEST_REGISTER("TestKeyString", "Cache keys written as hexadecimal strings", TestClusteredMeshBakeCache, TestKeyString);
+        EATEST_REGISTER("TestHitIdentical", "A mesh loaded from the cache is identical to a fresh build", TestClusteredMeshBakeCache, TestHitIdentical);
+        EATEST_REGISTER("TestEvictionByCount", "Least recently used entries are evicted beyond the maximum number of entries", TestClusteredMeshBakeCache, TestEvictionByCount);
+        EATEST_REGISTER("TestEvictionBySize", "Least recently used entries are evicted beyond the maximum total size", TestClusteredMeshBakeCache, TestEvictionBySize);
+        EATEST_REGISTER("TestFailedLoad", "Entries which cannot be loaded are rebuilt", TestClusteredMeshBakeCache, TestFailedLoad);
+        EATEST_REGISTER("TestRegisterEntry", "Entries of a persistent store registered with the cache", TestClusteredMeshBakeCache, TestRegisterEntry);
+        EATEST_REGISTER("TestFileStore", "Entries and index of a file store kept between caches", TestClusteredMeshBakeCache, TestFileStore);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        EA_ASSERT(mAllocator == 0);
+        mAllocator = new benchmarkenvironment::HeapAllocator();
+    }
+
+    virtual void TeardownSuite()
+    {
+        mAllocator->CheckForLeaks();
+        mAllocator->CheckForTrampling();
+        delete mAllocator;
+        mAllocator = 0;
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestKeyInput();
+    void TestKeyParameters();
+    void TestKeyString();
+    void TestHitIdentical();
+    void TestEvictionByCount();
+    void TestEvictionBySize();
+    void TestFailedLoad();
+    void TestRegisterEntry();
+    void TestFileStore();
+
+    benchmarkenvironment::HeapAllocator * mAllocator;
+
+} TestClusteredMeshBakeCacheSingleton;
+
+
+/**
+Tests that the key is repeatable, and changes with a change of a single bit of any part of the input.
+*/
+void
+TestClusteredMeshBakeCache::TestKeyInput()
+{
+    ClusteredMeshBakeCache::Parameters builderParams;
+    GridInput grid;
+
+    ClusteredMeshBakeCache::Key key;
+    ClusteredMeshBakeCache::ComputeKey(key, grid.input, builderParams);
+
+    ClusteredMeshBakeCache::Key other;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(key == other, "The same input should give the same key");
+
+    // Missing IDs are hashed as zero
+    grid.input.triangleGroupIDs = NULL;
+    grid.input.triangleSurfaceIDs = NULL;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(key == other, "Missing IDs should give the same key as IDs of zero");
+    grid.input.triangleGroupIDs = grid.groupIDs;
+    grid.input.triangleSurfaceIDs = grid.surfaceIDs;
+
+    // A vertex moved by the least amount
+    const rw::math::fpu::Vector3U_32 vertex = grid.vertices[40];
+    grid.vertices[40] = rw::math::fpu::Vector3U_32(vertex.GetX(), vertex.GetY(), vertex.GetZ() + 1.0e-6f);
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(!(key == other), "A moved vertex should change the key");
+    grid.vertices[40] = vertex;
+
+    // A triangle with a different vertex
+    grid.triangleVertexIndices[100] ^= 1u;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(!(key == other), "A changed triangle should change the key");
+    grid.triangleVertexIndices[100] ^= 1u;
+
+    grid.groupIDs[gridNumTriangles - 1] = 1;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(!(key == other), "A changed group ID should change the key");
+    grid.groupIDs[gridNumTriangles - 1] = 0;
+
+    grid.surfaceIDs[0] = 1;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(!(key == other), "A changed surface ID should change the key");
+    grid.surfaceIDs[0] = 0;
+
+    grid.mergePlaneDistances[0] = rwpmath::VecFloat(-99.0f);
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(!(key == other), "A changed merge plane should change the key");
+    grid.mergePlaneDistances[0] = rwpmath::VecFloat(-100.0f);
+
+    grid.input.numMergePlanes = 0;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(!(key == other), "A removed merge plane should change the key");
+    grid.input.numMergePlanes = 1;
+
+    // Dropping the last triangle
+    grid.input.numTriangles = gridNumTriangles - 1;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(!(key == other), "A removed triangle should change the key");
+    grid.input.numTriangles = gridNumTriangles;
+
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, builderParams);
+    EATESTAssert(key == other, "The restored input should give the original key");
+}
+
+
+/**
+Tests that the key changes with each build parameter other than the parallel dispatcher.
+*/
+void
+TestClusteredMeshBakeCache::TestKeyParameters()
+{
+    GridInput grid;
+    const ClusteredMeshBakeCache::Parameters defaultParams;
+
+    ClusteredMeshBakeCache::Key key;
+    ClusteredMeshBakeCache::ComputeKey(key, grid.input, defaultParams);
+
+    ClusteredMeshBakeCache::Parameters changedParams[25];
+    changedParams[0].vertexCompression_Enable = true;
+    changedParams[1].vertexCompression_Granularity = 0.002f;
+    changedParams[2].vertexCompression_Adaptive = true;
+    changedParams[3].vertexCompression_MaxError = 0.01f;
+    changedParams[4].oldTriangles_Enable = true;
+    changedParams[5].edgeAngles_Enable = false;
+    changedParams[6].quads_Enable = true;
+    changedParams[7].kdTreeBuilder_SplitThreshold = 16;
+    changedParams[8].kdTreeBuilder_LargeItemThreshold += 0.125f;
+    changedParams[9].kdTreeBuilder_MinChildEntriesThreshold += 0.125f;
+    changedParams[10].kdTreeBuilder_MaxEntriesPerNode += 1;
+    changedParams[11].kdTreeBuilder_MinSimilarAreaThreshold += 0.125f;
+    changedParams[12].groupId_NumBytes = 1;
+    changedParams[13].groupId_Default = 1;
+    changedParams[14].surfaceId_NumBytes = 2;
+    changedParams[15].surfaceId_Default = 1;
+    changedParams[16].vertexMerge_Enable = false;
+    changedParams[17].vertexMerge_DistanceTolerance = 0.2f;
+    changedParams[18].vertexMerge_ScaleTolerance = false;
+    changedParams[19].internalTriangleRemoval_Enabled = true;
+    changedParams[20].edgeCosineCorrection_Enabled = true;
+    changedParams[21].vertexSmoothing_Enabled = true;
+    changedParams[22].parallelDispatcher_WorkerArenaSize = 65536;
+    changedParams[23].incrementalUpdate_Enable = true;
+    changedParams[24].unitOrdering_Enable = true;
+
+    ClusteredMeshBakeCache::Key keys[25];
+    for (uint32_t i = 0 ; i < 25 ; ++i)
+    {
+        ClusteredMeshBakeCache::ComputeKey(keys[i], grid.input, changedParams[i]);
+        EATESTAssert(!(keys[i] == key), "A changed parameter should change the key");
+        for (uint32_t j = 0 ; j < i ; ++j)
+        {
+            EATESTAssert(!(keys[i] == keys[j]), "Each changed parameter should give a different key");
+        }
+    }
+
+    // The dispatcher does not change the built mesh
+    rw::collision::Tests::ThreadDispatcher dispatcher(2);
+    ClusteredMeshBakeCache::Parameters dispatcherParams;
+    dispatcherParams.parallelDispatcher = &dispatcher;
+    ClusteredMeshBakeCache::Key other;
+    ClusteredMeshBakeCache::ComputeKey(other, grid.input, dispatcherParams);
+    EATESTAssert(key == other, "The parallel dispatcher should not change the key");
+}
+
+
+/**
+Tests the hexadecimal string of a key, and the ordering of keys.
+*/
+void
+TestClusteredMeshBakeCache::TestKeyString()
+{
+    ClusteredMeshBakeCache::Key key;
+    key.words[0] = 0x0123abcdu;
+    key.words[1] = 0x00000000u;
+    key.words[2] = 0xffffffffu;
+    key.words[3] = 0x89abcdefu;
+
+    char buffer[ClusteredMeshBakeCache::Key::STRING_SIZE];
+    key.ToString(buffer);
+    EATESTAssert(0 == strcmp(buffer, "0123abcd00000000ffffffff89abcdef"), "The key string should be the words in hexadecimal");
+
+    ClusteredMeshBakeCache::Key greater = key;
+    greater.words[3] += 1;
+    EATESTAssert(key < greater, "Keys should be ordered by their last word when the others are equal");
+    EATESTAssert(!(greater < key), "Keys should be strictly ordered");
+    EATESTAssert(!(key < key), "A key should not be less than itself");
+
+    ClusteredMeshBakeCache::Key read;
+    EATESTAssert(read.FromString(buffer) && read == key, "The key string should read back as the same key");
+    EATESTAssert(read.FromString("0123ABCD00000000FFFFFFFF89ABCDEF") && read == key, "Upper case digits should be read");
+    EATESTAssert(!read.FromString("0123abcd00000000ffffffff89abcde"), "A short string should not be read");
+    EATESTAssert(!read.FromString("0123abcd00000000ffffffff89abcdef0"), "A long string should not be read");
+    EATESTAssert(!read.FromString("0123abcd00000000fffffgff89abcdef"), "A string with a non hexadecimal digit should not be read");
+    EATESTAssert(read == key, "A key should be unchanged by a string which is not read");
+}
+
+
+/**
+Tests that a mesh loaded from the cache serializes to the same image as the built mesh and as a fresh build.
+*/
+void
+TestClusteredMeshBakeCache::TestHitIdentical()
+{
+    ClusteredMeshBakeCache::Parameters builderParams;
+    builderParams.vertexCompression_Enable = true;
+    builderParams.quads_Enable = true;
+    GridInput grid;
+
+    MemoryStore store(*mAllocator);
+    ClusteredMeshBakeCache cache(store, 4, 0, mAllocator);
+
+    ClusteredMesh *builtMesh = cache.BuildClusteredMesh(grid.input, builderParams);
+    EATESTAssert(NULL != builtMesh, "The grid should have been built");
+    EATESTAssert(1 == store.GetNumItems(), "The built mesh should have been saved");
+
+    ClusteredMesh *cachedMesh = cache.BuildClusteredMesh(grid.input, builderParams);
+    EATESTAssert(NULL != cachedMesh, "The grid should have been loaded");
+    EATESTAssert(1 == store.GetNumLoads(), "The second build should have been loaded from the store");
+    EATESTAssert(cachedMesh->IsValid(), "The loaded mesh should be valid");
+
+    // A fresh build, without the cache
+    ClusteredMeshOfflineBuilder offlineBuilder(gridNumTriangles, gridNumVertices, 1, builderParams, mAllocator);
+    for (uint32_t vertexIndex = 0 ; vertexIndex < gridNumVertices ; ++vertexIndex)
+    {
+        offlineBuilder.SetVertex(vertexIndex, grid.vertices[vertexIndex]);
+    }
+    for (uint32_t triangleIndex = 0 ; triangleIndex < gridNumTriangles ; ++triangleIndex)
+    {
+        offlineBuilder.SetTriangle(triangleIndex,
+            grid.triangleVertexIndices[3 * triangleIndex],
+            grid.triangleVertexIndices[3 * triangleIndex + 1],
+            grid.triangleVertexIndices[3 * triangleIndex + 2]);
+    }
+    offlineBuilder.SetMergePlane(0, grid.mergePlaneNormals[0], grid.mergePlaneDistances[0]);
+    ClusteredMesh *freshMesh = offlineBuilder.BuildClusteredMesh();
+    offlineBuilder.Release();
+    EATESTAssert(NULL != freshMesh, "The grid should have been built afresh");
+
+    // Image each mesh
+    typedef EA::Serialization::imaging_oarchive<EA::Serialization::Endian::LittleEndianConverter> archiveType;
+
+    const uint32_t bufferSize = 65536u;
+    uint8_t *builtBuffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+    uint8_t *cachedBuffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+    uint8_t *freshBuffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    archiveType builtArchive(builtBuffer, bufferSize);
+    archiveType cachedArchive(cachedBuffer, bufferSize);
+    archiveType freshArchive(freshBuffer, bufferSize);
+
+    builtArchive & EAPHYSICS_LL_SERIALIZABLE(ClusteredMesh, builtMesh);
+    cachedArchive & EAPHYSICS_LL_SERIALIZABLE(ClusteredMesh, cachedMesh);
+    freshArchive & EAPHYSICS_LL_SERIALIZABLE(ClusteredMesh, freshMesh);
+
+    builtArchive.Close();
+    cachedArchive.Close();
+    freshArchive.Close();
+
+    const uint32_t size = builtArchive.GetFinalSize();
+    EATESTAssert(size == cachedArchive.GetFinalSize() && size == freshArchive.GetFinalSize(), "The imaged meshes should be the same size");
+    EATESTAssert(0 == memcmp(builtArchive.GetOutputBuffer(), cachedArchive.GetOutputBuffer(), size),
+                 "The cached mesh should be identical to the built mesh");
+    EATESTAssert(0 == memcmp(builtArchive.GetOutputBuffer(), freshArchive.GetOutputBuffer(), size),
+                 "The cached mesh should be identical to a fresh build");
+
+    const ClusteredMeshBakeCache::Statistics &statistics = cache.GetStatistics();
+    EATESTAssert(2 == statistics.numLookups, "There should have been two lookups");
+    EATESTAssert(1 == statistics.numHits, "There should have been one hit");
+    EATESTAssert(1 == statistics.numMisses, "There should have been one miss");
+    EATESTAssert(1 == statistics.numStores, "There should have been one store");
+    EATESTAssert(0 == statistics.numEvictions, "There should have been no evictions");
+
+    cache.ResetStatistics();
+    EATESTAssert(0 == cache.GetStatistics().numLookups, "The statistics should have been reset");
+
+    mAllocator->Free(freshBuffer);
+    mAllocator->Free(cachedBuffer);
+    mAllocator->Free(builtBuffer);
+
+    mAllocator->Free(freshMesh);
+    mAllocator->Free(cachedMesh);
+    mAllocator->Free(builtMesh);
+}
+
+
+/**
+Tests that the least recently used entry is evicted, and removed from the store, when an entry beyond
+the maximum number is saved.
+*/
+void
+TestClusteredMeshBakeCache::TestEvictionByCount()
+{
+    ClusteredMeshBakeCache::Parameters builderParams;
+    GridInput grids[3];
+    grids[1].Initialize(0.5f);
+    grids[2].Initialize(0.75f);
+    ClusteredMeshBakeCache::Key keys[3];
+    for (uint32_t i = 0 ; i < 3 ; ++i)
+    {
+        ClusteredMeshBakeCache::ComputeKey(keys[i], grids[i].input, builderParams);
+    }
+
+    MemoryStore store(*mAllocator);
+    ClusteredMeshBakeCache cache(store, 2, 0, mAllocator);
+
+    // Build 0 and 1, then use 0 again, so that 1 is the least recently used
+    const uint32_t order[4] = { 0, 1, 0, 2 };
+    for (uint32_t i = 0 ; i < 4 ; ++i)
+    {
+        ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[order[i]].input, builderParams);
+        EATESTAssert(NULL != clusteredMesh, "Each grid should have been built");
+        mAllocator->Free(clusteredMesh);
+    }
+
+    EATESTAssert(2 == cache.GetNumEntries(), "The cache should hold the maximum number of entries");
+    EATESTAssert(2 == store.GetNumItems(), "The store should hold the entries of the cache");
+    EATESTAssert(store.Contains(keys[0]) && store.Contains(keys[2]), "The recently used entries should be kept");
+    EATESTAssert(!store.Contains(keys[1]), "The least recently used entry should have been evicted");
+
+    const ClusteredMeshBakeCache::Statistics &statistics = cache.GetStatistics();
+    EATESTAssert(1 == statistics.numHits, "There should have been one hit");
+    EATESTAssert(3 == statistics.numMisses, "There should have been three misses");
+    EATESTAssert(1 == statistics.numEvictions, "There should have been one eviction");
+
+    // The entries are sorted by key
+    EATESTAssert(cache.GetEntry(0).key < cache.GetEntry(1).key, "The entries should be sorted by key");
+}
+
+
+/**
+Tests that the least recently used entries are evicted when the total size of the entries exceeds the
+maximum, and that an entry larger than the maximum is not kept.
+*/
+void
+TestClusteredMeshBakeCache::TestEvictionBySize()
+{
+    ClusteredMeshBakeCache::Parameters builderParams;
+    GridInput grids[2];
+    grids[1].Initialize(0.5f);
+
+    MemoryStore store(*mAllocator);
+
+    // Find the size of an entry
+    uint32_t entrySize = 0;
+    {
+        ClusteredMeshBakeCache cache(store, 4, 0, mAllocator);
+        ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[0].input, builderParams);
+        EATESTAssert(NULL != clusteredMesh, "The grid should have been built");
+        mAllocator->Free(clusteredMesh);
+        entrySize = cache.GetTotalSize();
+        EATESTAssert(entrySize > 0, "The entry should have a size");
+        store.Remove(cache.GetEntry(0).key);
+    }
+
+    // Room for one entry
+    {
+        ClusteredMeshBakeCache cache(store, 4, entrySize + entrySize / 2, mAllocator);
+        for (uint32_t i = 0 ; i < 2 ; ++i)
+        {
+            ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[i].input, builderParams);
+            EATESTAssert(NULL != clusteredMesh, "Each grid should have been built");
+            mAllocator->Free(clusteredMesh);
+        }
+
+        EATESTAssert(1 == cache.GetNumEntries(), "The cache should hold one entry");
+        EATESTAssert(cache.GetTotalSize() <= entrySize + entrySize / 2, "The total size should be within the maximum");
+        EATESTAssert(1 == cache.GetStatistics().numEvictions, "There should have been one eviction");
+        store.Remove(cache.GetEntry(0).key);
+    }
+
+    // No room for any entry
+    {
+        ClusteredMeshBakeCache cache(store, 4, entrySize / 2, mAllocator);
+        ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[0].input, builderParams);
+        EATESTAssert(NULL != clusteredMesh, "A mesh too large for the cache should still be built");
+        mAllocator->Free(clusteredMesh);
+
+        EATESTAssert(0 == cache.GetNumEntries(), "The cache should hold no entries");
+        EATESTAssert(0 == store.GetNumItems(), "The store should hold no entries");
+    }
+}
+
+
+/**
+Tests that an entry which cannot be loaded is removed and rebuilt.
+*/
+void
+TestClusteredMeshBakeCache::TestFailedLoad()
+{
+    ClusteredMeshBakeCache::Parameters builderParams;
+    GridInput grid;
+
+    MemoryStore store(*mAllocator);
+    ClusteredMeshBakeCache cache(store, 4, 0, mAllocator);
+
+    ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grid.input, builderParams);
+    EATESTAssert(NULL != clusteredMesh, "The grid should have been built");
+    mAllocator->Free(clusteredMesh);
+
+    store.SetFailLoads(true);
+    clusteredMesh = cache.BuildClusteredMesh(grid.input, builderParams);
+    EATESTAssert(NULL != clusteredMesh, "The grid should have been rebuilt");
+    mAllocator->Free(clusteredMesh);
+
+    const ClusteredMeshBakeCache::Statistics &statistics = cache.GetStatistics();
+    EATESTAssert(1 == statistics.numFailedLoads, "There should have been one failed load");
+    EATESTAssert(0 == statistics.numHits, "There should have been no hits");
+    EATESTAssert(2 == statistics.numMisses, "There should have been two misses");
+    EATESTAssert(2 == statistics.numStores, "The rebuilt mesh should have been saved again");
+    EATESTAssert(1 == cache.GetNumEntries(), "The cache should hold one entry");
+    EATESTAssert(1 == store.GetNumItems(), "The store should hold one entry");
+}
+
+
+/**
+Tests that registered entries are used as hits, and evicted in the order of their registered times of last use.
+*/
+void
+TestClusteredMeshBakeCache::TestRegisterEntry()
+{
+    ClusteredMeshBakeCache::Parameters builderParams;
+    GridInput grids[2];
+    grids[1].Initialize(0.5f);
+    ClusteredMeshBakeCache::Key keys[2];
+
+    MemoryStore store(*mAllocator);
+
+    // Fill the store, as a persistent store would be from an earlier run
+    {
+        ClusteredMeshBakeCache cache(store, 4, 0, mAllocator);
+        for (uint32_t i = 0 ; i < 2 ; ++i)
+        {
+            ClusteredMeshBakeCache::ComputeKey(keys[i], grids[i].input, builderParams);
+            ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[i].input, builderParams);
+            EATESTAssert(NULL != clusteredMesh, "Each grid should have been built");
+            mAllocator->Free(clusteredMesh);
+        }
+    }
+
+    // Register the most recently used entry first, so that eviction follows the restored times
+    ClusteredMeshBakeCache cache(store, 2, 0, mAllocator);
+    EATESTAssert(cache.RegisterEntry(keys[1], 200, 5), "The second entry should have been registered");
+    EATESTAssert(cache.RegisterEntry(keys[0], 100, 2), "The first entry should have been registered");
+    EATESTAssert(!cache.RegisterEntry(keys[1], 200, 5), "An entry should not be registered twice");
+    EATESTAssert(300 == cache.GetTotalSize(), "The total size should be that of the registered entries");
+    for (uint32_t i = 0 ; i < cache.GetNumEntries() ; ++i)
+    {
+        const ClusteredMeshBakeCache::Entry &entry = cache.GetEntry(i);
+        EATESTAssert(entry.lastUse == ((entry.key == keys[0]) ? 2u : 5u), "The registered times of last use should be restored");
+    }
+
+    ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[1].input, builderParams);
+    EATESTAssert(NULL != clusteredMesh, "The registered entry should have been loaded");
+    mAllocator->Free(clusteredMesh);
+    EATESTAssert(1 == cache.GetStatistics().numHits, "The registered entry should be a hit");
+
+    // A third entry evicts the first registered
+    GridInput third;
+    third.Initialize(0.75f);
+    clusteredMesh = cache.BuildClusteredMesh(third.input, builderParams);
+    EATESTAssert(NULL != clusteredMesh, "The third grid should have been built");
+    mAllocator->Free(clusteredMesh);
+
+    EATESTAssert(!store.Contains(keys[0]), "The least recently used registered entry should have been evicted");
+    EATESTAssert(store.Contains(keys[1]), "The recently used registered entry should be kept");
+
+    for (uint32_t i = 0 ; i < cache.GetNumEntries() ; ++i)
+    {
+        store.Remove(cache.GetEntry(i).key);
+    }
+}
+
+
+/**
+Tests that a file store keeps its entries and index between caches, so that a later cache loads the entries
+and evicts them in the order of their use by the earlier cache.
+*/
+void
+TestClusteredMeshBakeCache::TestFileStore()
+{
+    ClusteredMeshBakeCache::Parameters builderParams;
+    GridInput grids[3];
+    grids[1].Initialize(0.5f);
+    grids[2].Initialize(0.75f);
+    ClusteredMeshBakeCache::Key keys[3];
+    for (uint32_t i = 0 ; i < 3 ; ++i)
+    {
+        ClusteredMeshBakeCache::ComputeKey(keys[i], grids[i].input, builderParams);
+    }
+
+    rw::collision::unittest::FileBakeCacheStore store(".");
+
+    // Build 0 and 1, then use 0 again, so that 1 is the least recently used
+    uint32_t lastUse[2] = { 0, 0 };
+    {
+        ClusteredMeshBakeCache cache(store, 2, 0, mAllocator);
+        const uint32_t order[3] = { 0, 1, 0 };
+        for (uint32_t i = 0 ; i < 3 ; ++i)
+        {
+            ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[order[i]].input, builderParams);
+            EATESTAssert(NULL != clusteredMesh, "Each grid should have been built");
+            mAllocator->Free(clusteredMesh);
+        }
+        EATESTAssert(1 == cache.GetStatistics().numHits, "The grid used again should have been loaded from its file");
+        EATESTAssert(store.Contains(keys[0]) && store.Contains(keys[1]), "Each entry should have a file");
+
+        for (uint32_t i = 0 ; i < cache.GetNumEntries() ; ++i)
+        {
+            const ClusteredMeshBakeCache::Entry &entry = cache.GetEntry(i);
+            lastUse[(entry.key == keys[0]) ? 0 : 1] = entry.lastUse;
+        }
+        EATESTAssert(store.SaveIndex(cache), "The index should have been saved");
+    }
+
+    ClusteredMeshBakeCache cache(store, 2, 0, mAllocator);
+    EATESTAssert(2 == store.LoadIndex(cache), "Both entries should have been registered from the index");
+    for (uint32_t i = 0 ; i < cache.GetNumEntries() ; ++i)
+    {
+        const ClusteredMeshBakeCache::Entry &entry = cache.GetEntry(i);
+        EATESTAssert(entry.lastUse == lastUse[(entry.key == keys[0]) ? 0 : 1], "The times of last use should be restored from the index");
+    }
+
+    // A third entry evicts the least recently used in the earlier cache
+    ClusteredMesh *clusteredMesh = cache.BuildClusteredMesh(grids[2].input, builderParams);
+    EATESTAssert(NULL != clusteredMesh, "The third grid should have been built");
+    mAllocator->Free(clusteredMesh);
+    EATESTAssert(!store.Contains(keys[1]), "The least recently used entry should have been evicted");
+    EATESTAssert(store.Contains(keys[0]) && store.Contains(keys[2]), "The recently used entries should be kept");
+
+    clusteredMesh = cache.BuildClusteredMesh(grids[0].input, builderParams);
+    EATESTAssert(NULL != clusteredMesh, "The kept grid should have been loaded");
+    EATESTAssert(clusteredMesh->IsValid(), "The loaded mesh should be valid");
+    mAllocator->Free(clusteredMesh);
+    EATESTAssert(1 == cache.GetStatistics().numHits, "The kept grid should be a hit");
+
+    for (uint32_t i = 0 ; i < cache.GetNumEntries() ; ++i)
+    {
+        store.Remove(cache.GetEntry(i).key);
+    }
+    store.RemoveIndex();
+}
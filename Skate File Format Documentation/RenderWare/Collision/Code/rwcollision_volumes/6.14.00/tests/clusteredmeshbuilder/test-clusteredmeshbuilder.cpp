@@ -46,6 +46,7 @@ public:
         EATEST_REGISTER("TestUncompressibleVertexCompression_X_Z", "Testing uncompressible vertex compression along x and z axis", TestClusteredMeshBuilder, TestUncompressibleVertexCompression_X_Z);
         EATEST_REGISTER("TestUncompressibleVertexCompression_Y_Z", "Testing uncompressible vertex compression along y and z axis", TestClusteredMeshBuilder, TestUncompressibleVertexCompression_Y_Z);
         EATEST_REGISTER("TestUncompressibleVertexCompression_X_Y_Z", "Testing uncompressible vertex compression along x,y and z axis", TestClusteredMeshBuilder, TestUncompressibleVertexCompression_X_Y_Z);
+        EATEST_REGISTER("TestAdaptiveVertexCompression", "Testing queries and serialization of a mesh with lossy adaptive vertex compression", TestClusteredMeshBuilder, TestAdaptiveVertexCompression);
 
         // EdgeAngles Tests
         EATEST_REGISTER("TestEdgeAngles", "Testing EdgeAngle option", TestClusteredMeshBuilder, TestEdgeAngles);
@@ -108,6 +109,7 @@ private:
     void TestUncompressibleVertexCompression_Y_Z();
     void TestUncompressibleVertexCompression_X_Z();
     void TestUncompressibleVertexCompression_X_Y_Z();
+    void TestAdaptiveVertexCompression();
 
     void TestOldTriangles();
 
@@ -176,6 +178,14 @@ private:
                           float_t yLength,
                           float_t zLength);
 
+    void SetBumpyGridInput(ClusteredMeshOfflineBuilder &builder,
+                           uint32_t gridSize);
+
+    void CheckLineQueriesMatch(ClusteredMesh &mesh,
+                               ClusteredMesh &reference,
+                               uint32_t gridSize,
+                               float tolerance);
+
     benchmarkenvironment::HeapAllocator * mAllocator;
 
 } TestClusteredMeshBuilderSingleton;
@@ -1933,3 +1943,193 @@ void TestClusteredMeshBuilder::TestVertexSmooth_VertexDisabled_OnLimit()
     uint32_t ret = CheckNextEdge(edgeVectors[edgeAIndex], edgeVectors[edgeBIndex], edgeVectors[edgeCIndex]);
     EATESTAssert(ret == VERTEX_DISABLED, ("Vertex should have been disabled"));
 }
+
+
+/**
+Sets a grid of gridSize by gridSize cells, each split into two triangles which share the vertices of the grid.
+The vertices are moved off the compression lattice, and their heights vary, so that lossy compression moves them
+in every direction.
+*/
+void
+TestClusteredMeshBuilder::SetBumpyGridInput(ClusteredMeshOfflineBuilder &builder, uint32_t gridSize)
+{
+    const uint32_t rowSize = gridSize + 1;
+
+    for (uint32_t z = 0 ; z < rowSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < rowSize ; ++x)
+        {
+            const float jitterX = 0.013f * static_cast<float>((x * 7u + z * 3u) % 5u);
+            const float jitterZ = 0.017f * static_cast<float>((x * 3u + z * 5u) % 3u);
+            const float height = 0.1f * static_cast<float>((x * 5u + z * 3u) % 7u) + 0.0037f * static_cast<float>(x);
+            builder.SetVertex(z * rowSize + x, rw::math::fpu::Vector3U_32(static_cast<float>(x) + jitterX, height, static_cast<float>(z) + jitterZ));
+        }
+    }
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            builder.SetTriangle(triangleIndex++, v0, v0 + 1, v0 + rowSize);
+            builder.SetTriangle(triangleIndex++, v0 + 1, v0 + rowSize + 1, v0 + rowSize);
+        }
+    }
+}
+
+
+/**
+Checks that vertical lines around each interior vertex of a grid set by SetBumpyGridInput, and through the
+middle of each cell, hit the mesh where they hit the reference mesh, at a line parameter within the tolerance.
+The lines around the vertices pass where the compressed vertices may lie outside the bounds of the input.
+*/
+void
+TestClusteredMeshBuilder::CheckLineQueriesMatch(ClusteredMesh &mesh, ClusteredMesh &reference, uint32_t gridSize, float tolerance)
+{
+    const uint32_t stackMax = 1;
+    const uint32_t resBufferSize = 16;
+
+    EA::Physics::SizeAndAlignment lineResDesc = VolumeLineQuery::GetResourceDescriptor(stackMax, resBufferSize);
+    void * lineQueryMemory = mAllocator->Alloc(lineResDesc.GetSize(), NULL, 0, lineResDesc.GetAlignment());
+    VolumeLineQuery * lineQuery = VolumeLineQuery::Initialize(EA::Physics::MemoryPtr(lineQueryMemory), stackMax, resBufferSize);
+
+    Volume meshVolume;
+    AggregateVolume::Initialize(&meshVolume, &mesh);
+    Volume referenceVolume;
+    AggregateVolume::Initialize(&referenceVolume, &reference);
+    const Volume * meshVolumes[] = { &meshVolume };
+    const Volume * referenceVolumes[] = { &referenceVolume };
+
+    const float offsets[][2] = { { -0.005f, -0.005f }, { 0.005f, -0.005f }, { -0.005f, 0.005f }, { 0.005f, 0.005f }, { 0.5f, 0.5f } };
+    const uint32_t numOffsets = sizeof(offsets) / sizeof(offsets[0]);
+
+    for (uint32_t z = 1 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 1 ; x < gridSize ; ++x)
+        {
+            for (uint32_t offset = 0 ; offset < numOffsets ; ++offset)
+            {
+                const float lineX = static_cast<float>(x) + 0.013f * static_cast<float>((x * 7u + z * 3u) % 5u) + offsets[offset][0];
+                const float lineZ = static_cast<float>(z) + 0.017f * static_cast<float>((x * 3u + z * 5u) % 3u) + offsets[offset][1];
+                const rwpmath::Vector3 start(lineX, 2.0f, lineZ);
+                const rwpmath::Vector3 end(lineX, -2.0f, lineZ);
+
+                lineQuery->InitQuery(referenceVolumes, NULL, 1, start, end);
+                const VolumeLineSegIntersectResult * expected = lineQuery->GetNearestIntersection();
+                EATESTAssert(NULL != expected, "Line should hit the reference mesh");
+                const float expectedLineParam = expected ? expected->lineParam : 0.0f;
+
+                lineQuery->InitQuery(meshVolumes, NULL, 1, start, end);
+                const VolumeLineSegIntersectResult * result = lineQuery->GetNearestIntersection();
+                EATESTAssert(NULL != result, "Line should hit the compressed mesh where it hits the reference mesh");
+                if (expected && result)
+                {
+                    const float difference = result->lineParam - expectedLineParam;
+                    EATESTAssert(difference <= tolerance && difference >= -tolerance, "Line should hit the compressed mesh near the reference hit");
+                }
+            }
+        }
+    }
+
+    VolumeLineQuery::Release(lineQuery);
+    mAllocator->Free(lineQueryMemory);
+}
+
+
+/**
+Tests a mesh built with adaptive vertex compression and a non-zero error bound against the same input built
+without compression. The compressed vertices must lie within the KDTree bounds, and line queries must give the
+same hits to within the error bound. The mesh is then copied through high-level serialization, which writes
+the current versions of ClusteredMesh (7) and ClusteredMeshCluster (6), and the copy must give the same
+vertices and hits.
+*/
+void
+TestClusteredMeshBuilder::TestAdaptiveVertexCompression()
+{
+    // Small enough for a single cluster, so shared vertices are compressed alike, with several KDTree leaves
+    const uint32_t gridSize = 8;
+    const uint32_t numVertices = (gridSize + 1) * (gridSize + 1);
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    ClusteredMeshOfflineBuilder::Parameters referenceParams;
+    referenceParams.vertexMerge_Enable = false;
+
+    ClusteredMeshOfflineBuilder::Parameters builderParams(referenceParams);
+    builderParams.vertexCompression_Enable = true;
+    builderParams.vertexCompression_Granularity = 0.01f;
+    builderParams.vertexCompression_Adaptive = true;
+    builderParams.vertexCompression_MaxError = 0.04f;
+
+    ClusteredMeshOfflineBuilder referenceBuilder(numTriangles, numVertices, 0, referenceParams, mAllocator);
+    SetBumpyGridInput(referenceBuilder, gridSize);
+    ClusteredMesh * reference = referenceBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != reference, "The reference mesh should have been built");
+
+    ClusteredMeshOfflineBuilder offlineBuilder(numTriangles, numVertices, 0, builderParams, mAllocator);
+    SetBumpyGridInput(offlineBuilder, gridSize);
+    ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "The compressed mesh should have been built");
+
+    if (NULL == reference || NULL == clusteredMesh)
+    {
+        if (NULL != reference)
+            mAllocator->Free(reference);
+        if (NULL != clusteredMesh)
+            mAllocator->Free(clusteredMesh);
+        return;
+    }
+
+    EATESTAssert(1 == clusteredMesh->IsValid(), "ClusteredMesh should be valid");
+
+    // The compressed vertices should lie within the KDTree bounds
+    const float granularity = clusteredMesh->GetVertexCompressionGranularity();
+    const AABBox &kdtreeBBox = clusteredMesh->GetKDTreeBase()->GetBBox();
+    uint32_t numAdaptiveClusters = 0;
+    for (uint32_t clusterIndex = 0 ; clusterIndex < clusteredMesh->GetNumCluster() ; ++clusterIndex)
+    {
+        const ClusteredMeshCluster &cluster = clusteredMesh->GetCluster(clusterIndex);
+        if (ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED == cluster.compressionMode ||
+            ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED == cluster.compressionMode)
+        {
+            ++numAdaptiveClusters;
+        }
+
+        for (uint8_t vertexNo = 0 ; vertexNo < cluster.vertexCount ; ++vertexNo)
+        {
+            EATESTAssert(kdtreeBBox.Contains(cluster.GetVertex(vertexNo, granularity)), "The KDTree bounds should contain the compressed vertices");
+        }
+    }
+    EATESTAssert(numAdaptiveClusters > 0, "The clusters should use 8-bit or 10-bit vertex compression");
+
+    // The line parameter of the segment of length 4 is within the vertex error and the slope it causes
+    CheckLineQueriesMatch(*clusteredMesh, *reference, gridSize, 0.02f);
+
+    // The serialized copy should match the compressed mesh exactly
+    ClusteredMesh * copied = EA::Physics::UnitFramework::CopyViaHLSerialization(*clusteredMesh);
+    EATESTAssert(copied, "Failed copy via high-level serialization.");
+    if (copied)
+    {
+        EATESTAssert(1 == copied->IsValid(), "The serialized copy should be valid");
+        EATESTAssert(copied->GetNumCluster() == clusteredMesh->GetNumCluster(), "The serialized copy should have the same clusters");
+
+        for (uint32_t clusterIndex = 0 ; clusterIndex < clusteredMesh->GetNumCluster() && clusterIndex < copied->GetNumCluster() ; ++clusterIndex)
+        {
+            const ClusteredMeshCluster &cluster = clusteredMesh->GetCluster(clusterIndex);
+            const ClusteredMeshCluster &copiedCluster = copied->GetCluster(clusterIndex);
+            EATESTAssert(copiedCluster.compressionMode == cluster.compressionMode, "The serialized copy should keep the cluster compression modes");
+            EATESTAssert(copiedCluster.vertexCount == cluster.vertexCount, "The serialized copy should keep the cluster vertex counts");
+
+            for (uint8_t vertexNo = 0 ; vertexNo < cluster.vertexCount && vertexNo < copiedCluster.vertexCount ; ++vertexNo)
+            {
+                EATESTAssert(rwpmath::IsSimilar(copiedCluster.GetVertex(vertexNo, granularity), cluster.GetVertex(vertexNo, granularity), 1e-6f),
+                    "The serialized copy should decode the same vertices");
+            }
+        }
+
+        CheckLineQueriesMatch(*copied, *clusteredMesh, gridSize, 1e-5f);
+    }
+
+    mAllocator->Free(clusteredMesh);
+    mAllocator->Free(reference);
+}
@@ -43,6 +43,8 @@ public:
 
         EATEST_REGISTER("TestCalculateMinimum16BitGranularityForRange", "Check minimum granularity for range", TestClusteredMeshBuilderUtils, TestCalculateMinimum16BitGranularityForRange);
         EATEST_REGISTER("TestDetermineCompressionModeAndOffsetForRange", "Check compression mode and offset", TestClusteredMeshBuilderUtils, TestDetermineCompressionModeAndOffsetForRange);
+        EATEST_REGISTER("TestCalculateMaximumGranularityShift", "Check maximum granularity shift for error bound", TestClusteredMeshBuilderUtils, TestCalculateMaximumGranularityShift);
+        EATEST_REGISTER("TestDetermineAdaptiveCompressionModeAndOffsetForRange", "Check adaptive compression mode, offset and granularity shift", TestClusteredMeshBuilderUtils, TestDetermineAdaptiveCompressionModeAndOffsetForRange);
         EATEST_REGISTER("TestComputeExtendedEdgeCosine", "Check edge cosine", TestClusteredMeshBuilderUtils, TestComputeExtendedEdgeCosine);
         EATEST_REGISTER("TestEdgeCosineToAngleByte", "Check angle byte", TestClusteredMeshBuilderUtils, TestEdgeCosineToAngleByte);
         EATEST_REGISTER("TestEdgeProducesFeaturelessPlane", "Check featureless plane", TestClusteredMeshBuilderUtils, TestEdgeProducesFeaturelessPlane);
@@ -71,6 +73,8 @@ private:
 
     void TestCalculateMinimum16BitGranularityForRange();
     void TestDetermineCompressionModeAndOffsetForRange();
+    void TestCalculateMaximumGranularityShift();
+    void TestDetermineAdaptiveCompressionModeAndOffsetForRange();
     void TestComputeExtendedEdgeCosine();
     void TestEdgeCosineToAngleByte();
     void TestEdgeProducesFeaturelessPlane();
@@ -167,6 +171,85 @@ TestClusteredMeshBuilderUtils::TestDetermineCompressionModeAndOffsetForRange()
 }
 
 
+/**
+Tests the maximum granularity shift allowed by an error bound.
+*/
+void
+TestClusteredMeshBuilderUtils::TestCalculateMaximumGranularityShift()
+{
+    // No error allowed
+    EATESTAssert(0u == VertexCompression::CalculateMaximumGranularityShift(1.0f, 0.0f), "granularityShift should be 0");
+    // An error of less than half of the granularity is not enough for a shift
+    EATESTAssert(0u == VertexCompression::CalculateMaximumGranularityShift(1.0f, 0.25f), "granularityShift should be 0");
+    // A shift of 3 rounds to a granularity of 8, with an error of 4
+    EATESTAssert(3u == VertexCompression::CalculateMaximumGranularityShift(1.0f, 4.0f), "granularityShift should be 3");
+    EATESTAssert(3u == VertexCompression::CalculateMaximumGranularityShift(0.5f, 2.5f), "granularityShift should be 3");
+}
+
+
+/**
+Tests the adaptive compression mode, offset and granularity shift.
+*/
+void
+TestClusteredMeshBuilderUtils::TestDetermineAdaptiveCompressionModeAndOffsetForRange()
+{
+    const int32_t xMin = -256;
+    const int32_t xMax = 256;
+    const int32_t yMin = -32;
+    const int32_t yMax = 32;
+    const int32_t zMin = -64;
+    const int32_t zMax = 64;
+
+    uint8_t compressionMode = 0u;
+    uint32_t granularityShift = 0u;
+    rw::collision::ClusteredMeshCluster::Vertex32 offset;
+
+    // A range of 512 fits 10 bits without loss
+    VertexCompression::DetermineAdaptiveCompressionModeAndOffsetForRange(
+        compressionMode,
+        offset,
+        granularityShift,
+        xMin, xMax,
+        yMin, yMax,
+        zMin, zMax,
+        0u);
+
+    EATESTAssert(rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED == compressionMode, "compressionMode should be VERTICES_10BIT_COMPRESSED");
+    EATESTAssert(0u == granularityShift, "granularityShift should be 0");
+    EATESTAssert( (xMin - 1) == offset.x, "offset.x should be xMin - 1");
+    EATESTAssert( (yMin - 1) == offset.y, "offset.y should be yMin - 1");
+    EATESTAssert( (zMin - 1) == offset.z, "offset.z should be zMin - 1");
+
+    // A range of 512 fits 8 bits at a quarter of the precision
+    VertexCompression::DetermineAdaptiveCompressionModeAndOffsetForRange(
+        compressionMode,
+        offset,
+        granularityShift,
+        xMin, xMax,
+        yMin, yMax,
+        zMin, zMax,
+        3u);
+
+    EATESTAssert(rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED == compressionMode, "compressionMode should be VERTICES_8BIT_COMPRESSED");
+    EATESTAssert(2u == granularityShift, "granularityShift should be 2");
+    EATESTAssert( (xMin - 1) == offset.x, "offset.x should be xMin - 1");
+
+    // A range of 20000 fits neither without loss, and falls back to 16 bits
+    VertexCompression::DetermineAdaptiveCompressionModeAndOffsetForRange(
+        compressionMode,
+        offset,
+        granularityShift,
+        0, 20000,
+        yMin, yMax,
+        zMin, zMax,
+        0u);
+
+    EATESTAssert(rw::collision::ClusteredMeshCluster::VERTICES_16BIT_COMPRESSED == compressionMode, "compressionMode should be VERTICES_16BIT_COMPRESSED");
+    EATESTAssert(0u == granularityShift, "granularityShift should be 0");
+    EATESTAssert(-1 == offset.x, "offset.x should be -1");
+}
+
+
 /**
 Tests the edge cosine value.
 */
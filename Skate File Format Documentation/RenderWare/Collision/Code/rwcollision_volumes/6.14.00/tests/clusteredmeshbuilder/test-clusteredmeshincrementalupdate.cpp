@@ -0,0 +1,564 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/clusteredmeshofflinebuilder.h>
+
+#include "benchmarkenvironment/allocator.h"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include <string.h> // For memcmp
+
+using namespace rw::collision;
+
+// Unit tests for the incremental update of a ClusteredMesh after a localized edit of the builder input.
+// The meshes are flat grids of shared vertices, large enough to be split into several clusters.
+
+class TestClusteredMeshIncrementalUpdate : public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestClusteredMeshIncrementalUpdate");
+        EATEST_REGISTER("TestMovedVertex", "Updating a mesh after moving a single vertex", TestClusteredMeshIncrementalUpdate, TestMovedVertex);
+        EATEST_REGISTER("TestDegenerateEdit", "Updating a mesh after an edit which collapses triangles", TestClusteredMeshIncrementalUpdate, TestDegenerateEdit);
+        EATEST_REGISTER("TestNoIncrementalUpdateData", "Updating a mesh built without incremental update data", TestClusteredMeshIncrementalUpdate, TestNoIncrementalUpdateData);
+        EATEST_REGISTER("TestUnsupportedBuildOptions", "Updating a mesh built with passes not repeated by the update", TestClusteredMeshIncrementalUpdate, TestUnsupportedBuildOptions);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        EA_ASSERT(mAllocator == 0);
+        mAllocator = new benchmarkenvironment::HeapAllocator();
+    }
+
+    virtual void TeardownSuite()
+    {
+        mAllocator->CheckForLeaks();
+        mAllocator->CheckForTrampling();
+        delete mAllocator;
+        mAllocator = 0;
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestMovedVertex();
+    void TestDegenerateEdit();
+    void TestNoIncrementalUpdateData();
+    void TestUnsupportedBuildOptions();
+
+    void SetSharedGridInput(ClusteredMeshOfflineBuilder &builder, uint32_t gridSize);
+
+    bool FindTriangleEdges(uint8_t *edgeCodes, float *edgeCosines, ClusteredMesh &mesh, const rwpmath::Vector3 *corners);
+
+    void CheckEdgesMatch(ClusteredMesh &mesh, ClusteredMesh &reference, uint32_t gridSize, uint32_t movedVertex, float movedHeight);
+
+    uint32_t GetTrianglesUsingVertex(uint32_t *triangles, uint32_t gridSize, uint32_t vertexIndex);
+
+    void CheckQueriesMatch(ClusteredMesh &mesh, ClusteredMesh &reference, float centerX, float centerZ);
+
+    benchmarkenvironment::HeapAllocator * mAllocator;
+
+} TestClusteredMeshIncrementalUpdateSingleton;
+
+
+/**
+Sets a flat grid of gridSize by gridSize cells, each split into two triangles which share the
+vertices of the grid.
+*/
+void
+TestClusteredMeshIncrementalUpdate::SetSharedGridInput(ClusteredMeshOfflineBuilder &builder, uint32_t gridSize)
+{
+    const uint32_t rowSize = gridSize + 1;
+
+    for (uint32_t z = 0 ; z < rowSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < rowSize ; ++x)
+        {
+            builder.SetVertex(z * rowSize + x, rw::math::fpu::Vector3U_32(static_cast<float>(x), 0.0f, static_cast<float>(z)));
+        }
+    }
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            builder.SetTriangle(triangleIndex++, v0, v0 + 1, v0 + rowSize);
+            builder.SetTriangle(triangleIndex++, v0 + 1, v0 + rowSize + 1, v0 + rowSize);
+        }
+    }
+}
+
+
+/**
+Finds the triangles of a grid set by SetSharedGridInput which use a vertex.
+*/
+uint32_t
+TestClusteredMeshIncrementalUpdate::GetTrianglesUsingVertex(uint32_t *triangles, uint32_t gridSize, uint32_t vertexIndex)
+{
+    const uint32_t rowSize = gridSize + 1;
+    uint32_t numTriangles = 0;
+
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            const uint32_t triangleIndex = 2 * (z * gridSize + x);
+
+            if (vertexIndex == v0 || vertexIndex == v0 + 1 || vertexIndex == v0 + rowSize)
+            {
+                triangles[numTriangles++] = triangleIndex;
+            }
+            if (vertexIndex == v0 + 1 || vertexIndex == v0 + rowSize + 1 || vertexIndex == v0 + rowSize)
+            {
+                triangles[numTriangles++] = triangleIndex + 1;
+            }
+        }
+    }
+
+    return numTriangles;
+}
+
+
+/**
+Finds the triangle unit of a mesh with the given corners, in that order or rotated, returning its edge codes and
+edge cosines in the order of the given corners. The mesh must not have quads or compressed vertices.
+*/
+bool
+TestClusteredMeshIncrementalUpdate::FindTriangleEdges(uint8_t *edgeCodes, float *edgeCosines, ClusteredMesh &mesh, const rwpmath::Vector3 *corners)
+{
+    for (uint32_t clusterIndex = 0 ; clusterIndex < mesh.GetNumCluster() ; ++clusterIndex)
+    {
+        const ClusteredMeshCluster &cluster = mesh.GetCluster(clusterIndex);
+        const uint8_t *unitData = cluster.UnitData();
+
+        uint32_t offset = 0;
+        for (uint32_t unitIndex = 0 ; unitIndex < cluster.unitCount ; ++unitIndex)
+        {
+            const uint8_t *unit = unitData + offset;
+
+            Volume volumes[2];
+            uint32_t numVolumes = 0;
+            offset += mesh.GetUnitVolumes(clusterIndex, offset, volumes, numVolumes);
+
+            if (UNITTYPE_TRIANGLE != (unit[0] & UNITTYPE_MASK) || 0 == (unit[0] & UNITFLAG_EDGEANGLE))
+            {
+                continue;
+            }
+
+            const TriangleVolume *triangle = static_cast<const TriangleVolume *>(&volumes[0]);
+            rwpmath::Vector3 points[3];
+            triangle->GetPoints(points[0], points[1], points[2], NULL);
+
+            for (uint32_t rotation = 0 ; rotation < 3 ; ++rotation)
+            {
+                bool same = true;
+                for (uint32_t corner = 0 ; corner < 3 ; ++corner)
+                {
+                    same = same && rwpmath::IsSimilar(points[(rotation + corner) % 3], corners[corner], 1e-6f);
+                }
+
+                if (same)
+                {
+                    // Edge i of the unit runs from point i to point i + 1
+                    for (uint32_t edge = 0 ; edge < 3 ; ++edge)
+                    {
+                        edgeCodes[edge] = unit[4 + (rotation + edge) % 3];
+                        edgeCosines[edge] = triangle->GetEdgeCos((rotation + edge) % 3);
+                    }
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+
+/**
+Checks that the triangles in the cells around a moved vertex of a grid set by SetSharedGridInput, which are the
+edited triangles and their neighbors, have the same edge codes and edge cosines in an updated mesh as in a mesh
+rebuilt from the same input.
+*/
+void
+TestClusteredMeshIncrementalUpdate::CheckEdgesMatch(ClusteredMesh &mesh, ClusteredMesh &reference, uint32_t gridSize, uint32_t movedVertex, float movedHeight)
+{
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t movedX = movedVertex % rowSize;
+    const uint32_t movedZ = movedVertex / rowSize;
+
+    uint32_t numTriangles = 0;
+    uint32_t numMissing = 0;
+    uint32_t numDifferentCodes = 0;
+    uint32_t numDifferentCosines = 0;
+
+    for (uint32_t z = movedZ - 2 ; z < movedZ + 2 ; ++z)
+    {
+        for (uint32_t x = movedX - 2 ; x < movedX + 2 ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            const uint32_t triangleVertices[2][3] = { { v0, v0 + 1, v0 + rowSize }, { v0 + 1, v0 + rowSize + 1, v0 + rowSize } };
+
+            for (uint32_t upper = 0 ; upper < 2 ; ++upper)
+            {
+                rwpmath::Vector3 corners[3];
+                for (uint32_t corner = 0 ; corner < 3 ; ++corner)
+                {
+                    const uint32_t vertexIndex = triangleVertices[upper][corner];
+                    corners[corner] = rwpmath::Vector3(static_cast<float>(vertexIndex % rowSize),
+                                                       (vertexIndex == movedVertex) ? movedHeight : 0.0f,
+                                                       static_cast<float>(vertexIndex / rowSize));
+                }
+
+                uint8_t edgeCodes[3];
+                float edgeCosines[3];
+                uint8_t expectedEdgeCodes[3];
+                float expectedEdgeCosines[3];
+
+                ++numTriangles;
+                if (!FindTriangleEdges(edgeCodes, edgeCosines, mesh, corners) ||
+                    !FindTriangleEdges(expectedEdgeCodes, expectedEdgeCosines, reference, corners))
+                {
+                    ++numMissing;
+                    continue;
+                }
+
+                for (uint32_t edge = 0 ; edge < 3 ; ++edge)
+                {
+                    numDifferentCodes += (edgeCodes[edge] != expectedEdgeCodes[edge]) ? 1u : 0u;
+                    numDifferentCosines += rwpmath::IsSimilar(edgeCosines[edge], expectedEdgeCosines[edge], 1e-6f) ? 0u : 1u;
+                }
+            }
+        }
+    }
+
+    EATESTAssert(32 == numTriangles, "The cells around the moved vertex should hold 32 triangles");
+    EATESTAssert(0 == numMissing, "Each triangle around the moved vertex should be a unit of both meshes");
+    EATESTAssert(0 == numDifferentCodes, "The edge codes of the updated mesh should match the rebuilt mesh");
+    EATESTAssert(0 == numDifferentCosines, "The edge cosines of the updated mesh should match the rebuilt mesh");
+}
+
+
+/**
+Checks that vertical line queries and bbox queries around a point give the same results on an updated mesh
+as on a mesh rebuilt from the same input.
+*/
+void
+TestClusteredMeshIncrementalUpdate::CheckQueriesMatch(ClusteredMesh &mesh, ClusteredMesh &reference, float centerX, float centerZ)
+{
+    const uint32_t stackMax = 1;
+    const uint32_t resBufferSize = 16;
+
+    EA::Physics::SizeAndAlignment lineResDesc = VolumeLineQuery::GetResourceDescriptor(stackMax, resBufferSize);
+    void * lineQueryMemory = mAllocator->Alloc(lineResDesc.GetSize(), NULL, 0, lineResDesc.GetAlignment());
+    VolumeLineQuery * lineQuery = VolumeLineQuery::Initialize(EA::Physics::MemoryPtr(lineQueryMemory), stackMax, resBufferSize);
+
+    EA::Physics::SizeAndAlignment bboxResDesc = VolumeBBoxQuery::GetResourceDescriptor(stackMax, resBufferSize);
+    void * bboxQueryMemory = mAllocator->Alloc(bboxResDesc.GetSize(), NULL, 0, bboxResDesc.GetAlignment());
+    VolumeBBoxQuery * bboxQuery = VolumeBBoxQuery::Initialize(EA::Physics::MemoryPtr(bboxQueryMemory), stackMax, resBufferSize);
+
+    Volume meshVolume;
+    AggregateVolume::Initialize(&meshVolume, &mesh);
+    Volume referenceVolume;
+    AggregateVolume::Initialize(&referenceVolume, &reference);
+    const Volume * meshVolumes[] = { &meshVolume };
+    const Volume * referenceVolumes[] = { &referenceVolume };
+
+    // Lines on a quarter cell lattice over the cells around the point, including the slopes of the edit
+    const uint32_t numSteps = 17;
+    for (uint32_t i = 0 ; i < numSteps ; ++i)
+    {
+        for (uint32_t j = 0 ; j < numSteps ; ++j)
+        {
+            const float x = centerX - 2.0f + 0.25f * static_cast<float>(i) + 0.01f;
+            const float z = centerZ - 2.0f + 0.25f * static_cast<float>(j) + 0.02f;
+            const rwpmath::Vector3 start(x, 2.0f, z);
+            const rwpmath::Vector3 end(x, -2.0f, z);
+
+            lineQuery->InitQuery(referenceVolumes, NULL, 1, start, end);
+            const VolumeLineSegIntersectResult * expected = lineQuery->GetNearestIntersection();
+            const RwpBool expectedHit = (NULL != expected);
+            const float expectedLineParam = expectedHit ? expected->lineParam : 0.0f;
+            const rwpmath::Vector3 expectedNormal = expectedHit ? expected->normal : rwpmath::Vector3(0.0f, 0.0f, 0.0f);
+
+            lineQuery->InitQuery(meshVolumes, NULL, 1, start, end);
+            const VolumeLineSegIntersectResult * result = lineQuery->GetNearestIntersection();
+
+            EATESTAssert(expectedHit == (NULL != result), "Line should hit the updated mesh where it hits the rebuilt mesh");
+            if (expectedHit && result)
+            {
+                EATESTAssert(rwpmath::IsSimilar(result->lineParam, expectedLineParam, 1e-4f), "Line should hit the updated mesh at the same point");
+                EATESTAssert(rwpmath::IsSimilar(result->normal, expectedNormal, 1e-4f), "Line should hit the updated mesh with the same normal");
+            }
+        }
+    }
+
+    // Boxes around the point, from one just touching the raised vertex to one covering its neighbors
+    for (uint32_t k = 0 ; k < 4 ; ++k)
+    {
+        const float halfSize = 0.25f + 0.5f * static_cast<float>(k);
+        const AABBox bbox(centerX - halfSize, 0.4f - 0.125f * static_cast<float>(k), centerZ - halfSize,
+                          centerX + halfSize, 1.0f, centerZ + halfSize);
+
+        uint32_t expectedCount = 0;
+        bboxQuery->InitQuery(referenceVolumes, NULL, 1, bbox);
+        while (!bboxQuery->Finished())
+        {
+            expectedCount += bboxQuery->GetOverlaps();
+        }
+
+        uint32_t count = 0;
+        bboxQuery->InitQuery(meshVolumes, NULL, 1, bbox);
+        while (!bboxQuery->Finished())
+        {
+            count += bboxQuery->GetOverlaps();
+        }
+
+        EATESTAssert(expectedCount > 0, "Box should overlap the raised triangles");
+        EATESTAssert(count == expectedCount, "Box should overlap the same number of triangles of the updated and rebuilt meshes");
+    }
+
+    VolumeBBoxQuery::Release(bboxQuery);
+    mAllocator->Free(bboxQueryMemory);
+    VolumeLineQuery::Release(lineQuery);
+    mAllocator->Free(lineQueryMemory);
+}
+
+
+/**
+Tests that moving a single vertex updates the clusters using it, leaves the other clusters untouched,
+refits the KDTree to the moved vertex, and gives the same edge codes, edge cosines and query results as a
+full rebuild. Moving the vertex back shrinks the KDTree to its original bounds.
+*/
+void
+TestClusteredMeshIncrementalUpdate::TestMovedVertex()
+{
+    const uint32_t gridSize = 32;
+    const uint32_t numVertices = (gridSize + 1) * (gridSize + 1);
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    ClusteredMeshOfflineBuilder::Parameters builderParams;
+    builderParams.incrementalUpdate_Enable = true;
+
+    ClusteredMeshOfflineBuilder offlineBuilder(numTriangles, numVertices, 0, builderParams, mAllocator);
+    SetSharedGridInput(offlineBuilder, gridSize);
+
+    ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "clusteredMesh should not be NULL");
+    EATESTAssert(1 == clusteredMesh->IsValid(), "ClusteredMesh should be valid");
+
+    const uint32_t numClusters = clusteredMesh->GetNumCluster();
+    EATESTAssert(numClusters > 2, "The grid should be split into several clusters");
+
+    // Keep a copy of the clusters before the edit
+    uint32_t totalClusterSize = 0;
+    for (uint32_t clusterIndex = 0 ; clusterIndex < numClusters ; ++clusterIndex)
+    {
+        totalClusterSize += clusteredMesh->GetClusterSize(clusteredMesh->GetCluster(clusterIndex));
+    }
+
+    uint8_t * originalClusters = static_cast<uint8_t *>(mAllocator->Alloc(totalClusterSize, NULL, 0, 4));
+    uint8_t * originalCluster = originalClusters;
+    for (uint32_t clusterIndex = 0 ; clusterIndex < numClusters ; ++clusterIndex)
+    {
+        const uint32_t clusterSize = clusteredMesh->GetClusterSize(clusteredMesh->GetCluster(clusterIndex));
+        memcpy(originalCluster, &clusteredMesh->GetCluster(clusterIndex), clusterSize);
+        originalCluster += clusterSize;
+    }
+
+    // Raise a vertex in the middle of the grid
+    const uint32_t movedVertex = (gridSize / 2) * (gridSize + 1) + gridSize / 2;
+    const float movedHeight = 0.5f;
+    const rw::math::fpu::Vector3U_32 movedPosition(static_cast<float>(gridSize / 2), movedHeight, static_cast<float>(gridSize / 2));
+    offlineBuilder.SetVertex(movedVertex, movedPosition);
+
+    uint32_t changedTriangles[6];
+    const uint32_t numChangedTriangles = GetTrianglesUsingVertex(changedTriangles, gridSize, movedVertex);
+    EATESTAssert(6 == numChangedTriangles, "An inner grid vertex should be used by six triangles");
+
+    const bool updated = offlineBuilder.UpdateClusteredMesh(*clusteredMesh, changedTriangles, numChangedTriangles);
+    EATESTAssert(updated, "The mesh should have been updated");
+    EATESTAssert(1 == clusteredMesh->IsValid(), "ClusteredMesh should be valid after the update");
+
+    // The KDTree should contain the moved vertex
+    const AABBox &kdtreeBBox = clusteredMesh->GetKDTreeBase()->GetBBox();
+    EATESTAssert(kdtreeBBox.Max().GetY() >= movedHeight, "The KDTree bounds should contain the moved vertex");
+
+    // Only the clusters holding the moved vertex, or triangles next to it, should have changed
+    const float granularity = clusteredMesh->GetVertexCompressionGranularity();
+    uint32_t numChangedClusters = 0;
+    uint32_t numClustersWithMovedVertex = 0;
+
+    originalCluster = originalClusters;
+    for (uint32_t clusterIndex = 0 ; clusterIndex < numClusters ; ++clusterIndex)
+    {
+        const ClusteredMeshCluster &cluster = clusteredMesh->GetCluster(clusterIndex);
+        const uint32_t clusterSize = clusteredMesh->GetClusterSize(cluster);
+
+        if (0 != memcmp(originalCluster, &cluster, clusterSize))
+        {
+            ++numChangedClusters;
+        }
+        originalCluster += clusterSize;
+
+        for (uint8_t vertexIndex = 0 ; vertexIndex < cluster.vertexCount ; ++vertexIndex)
+        {
+            if (cluster.GetVertex(vertexIndex, granularity).GetY() == movedHeight)
+            {
+                ++numClustersWithMovedVertex;
+            }
+        }
+    }
+
+    EATESTAssert(numClustersWithMovedVertex > 0, "A cluster should hold the moved vertex");
+    EATESTAssert(numChangedClusters >= numClustersWithMovedVertex, "Every cluster holding the moved vertex should have changed");
+    EATESTAssert(numChangedClusters < numClusters, "Clusters far from the moved vertex should be unchanged");
+
+    // Rebuild the edited grid from scratch and compare queries against it
+    ClusteredMeshOfflineBuilder rebuildBuilder(numTriangles, numVertices, 0, builderParams, mAllocator);
+    SetSharedGridInput(rebuildBuilder, gridSize);
+    rebuildBuilder.SetVertex(movedVertex, movedPosition);
+
+    ClusteredMesh * rebuiltMesh = rebuildBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != rebuiltMesh, "rebuiltMesh should not be NULL");
+
+    CheckEdgesMatch(*clusteredMesh, *rebuiltMesh, gridSize, movedVertex, movedHeight);
+    CheckQueriesMatch(*clusteredMesh, *rebuiltMesh, static_cast<float>(gridSize / 2), static_cast<float>(gridSize / 2));
+
+    // Moving the vertex back should shrink the KDTree back to the flat grid
+    offlineBuilder.SetVertex(movedVertex, rw::math::fpu::Vector3U_32(static_cast<float>(gridSize / 2), 0.0f, static_cast<float>(gridSize / 2)));
+    EATESTAssert(offlineBuilder.UpdateClusteredMesh(*clusteredMesh, changedTriangles, numChangedTriangles), "The mesh should have been updated again");
+    EATESTAssert(1 == clusteredMesh->IsValid(), "ClusteredMesh should be valid after the second update");
+    EATESTAssert(clusteredMesh->GetKDTreeBase()->GetBBox().Max().GetY() < movedHeight, "The KDTree bounds should have shrunk back to the flat grid");
+
+    const rw::collision::KDTreeBase &kdtree = *clusteredMesh->GetKDTreeBase();
+    uint32_t numRaisedExtents = 0;
+    for (uint32_t nodeIndex = 0 ; nodeIndex < kdtree.m_numBranchNodes ; ++nodeIndex)
+    {
+        const KDTreeBase::BranchNode &node = kdtree.m_branchNodes[nodeIndex];
+        numRaisedExtents += (1u == node.m_axis && node.m_extents[0] >= movedHeight) ? 1u : 0u;
+    }
+    EATESTAssert(0 == numRaisedExtents, "No branch plane should still bound the moved vertex");
+
+    mAllocator->Free(rebuiltMesh);
+    mAllocator->Free(originalClusters);
+    mAllocator->Free(clusteredMesh);
+}
+
+
+/**
+Tests that an edit which collapses triangles, changing the units of the mesh, is refused and leaves
+the mesh unchanged.
+*/
+void
+TestClusteredMeshIncrementalUpdate::TestDegenerateEdit()
+{
+    const uint32_t gridSize = 8;
+    const uint32_t numVertices = (gridSize + 1) * (gridSize + 1);
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    ClusteredMeshOfflineBuilder::Parameters builderParams;
+    builderParams.incrementalUpdate_Enable = true;
+
+    ClusteredMeshOfflineBuilder offlineBuilder(numTriangles, numVertices, 0, builderParams, mAllocator);
+    SetSharedGridInput(offlineBuilder, gridSize);
+
+    ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "clusteredMesh should not be NULL");
+
+    const uint32_t meshSize = clusteredMesh->GetSizeThis();
+    uint8_t * originalMesh = static_cast<uint8_t *>(mAllocator->Alloc(meshSize, NULL, 0, 4));
+    memcpy(originalMesh, clusteredMesh, meshSize);
+
+    // Move a vertex onto its neighbor along the row, which welds the two and collapses triangles
+    const uint32_t movedVertex = (gridSize / 2) * (gridSize + 1) + gridSize / 2;
+    offlineBuilder.SetVertex(movedVertex, rw::math::fpu::Vector3U_32(static_cast<float>(gridSize / 2 + 1), 0.0f, static_cast<float>(gridSize / 2)));
+
+    uint32_t changedTriangles[6];
+    const uint32_t numChangedTriangles = GetTrianglesUsingVertex(changedTriangles, gridSize, movedVertex);
+
+    const bool updated = offlineBuilder.UpdateClusteredMesh(*clusteredMesh, changedTriangles, numChangedTriangles);
+    EATESTAssert(!updated, "The mesh should not have been updated");
+    EATESTAssert(0 == memcmp(originalMesh, clusteredMesh, meshSize), "The mesh should be unchanged");
+
+    mAllocator->Free(originalMesh);
+    mAllocator->Free(clusteredMesh);
+}
+
+
+/**
+Tests that a mesh built without incremental update data is refused.
+*/
+void
+TestClusteredMeshIncrementalUpdate::TestNoIncrementalUpdateData()
+{
+    const uint32_t gridSize = 4;
+    const uint32_t numVertices = (gridSize + 1) * (gridSize + 1);
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    ClusteredMeshOfflineBuilder::Parameters builderParams;
+
+    ClusteredMeshOfflineBuilder offlineBuilder(numTriangles, numVertices, 0, builderParams, mAllocator);
+    SetSharedGridInput(offlineBuilder, gridSize);
+
+    ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "clusteredMesh should not be NULL");
+
+    const uint32_t changedTriangle = 0;
+    const bool updated = offlineBuilder.UpdateClusteredMesh(*clusteredMesh, &changedTriangle, 1);
+    EATESTAssert(!updated, "The mesh should not have been updated without incremental update data");
+
+    mAllocator->Free(clusteredMesh);
+}
+
+
+/**
+Tests that a mesh built with merge planes, edge cosine correction, vertex smoothing or internal triangle removal,
+which the update can't repeat around the edit, is refused.
+*/
+void
+TestClusteredMeshIncrementalUpdate::TestUnsupportedBuildOptions()
+{
+    const uint32_t gridSize = 4;
+    const uint32_t numVertices = (gridSize + 1) * (gridSize + 1);
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    for (uint32_t option = 0 ; option < 4 ; ++option)
+    {
+        ClusteredMeshOfflineBuilder::Parameters builderParams;
+        builderParams.incrementalUpdate_Enable = true;
+        builderParams.edgeCosineCorrection_Enabled = (1 == option);
+        builderParams.vertexSmoothing_Enabled = (2 == option);
+        builderParams.internalTriangleRemoval_Enabled = (3 == option);
+        const uint32_t numMergePlanes = (0 == option) ? 1u : 0u;
+
+        ClusteredMeshOfflineBuilder offlineBuilder(numTriangles, numVertices, numMergePlanes, builderParams, mAllocator);
+        SetSharedGridInput(offlineBuilder, gridSize);
+        if (numMergePlanes > 0)
+        {
+            offlineBuilder.SetMergePlane(0, rwpmath::Vector3(0.0f, 1.0f, 0.0f), rwpmath::VecFloat(0.0f));
+        }
+
+        ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+        EATESTAssert(NULL != clusteredMesh, "clusteredMesh should not be NULL");
+
+        const uint32_t changedTriangle = 0;
+        const bool updated = offlineBuilder.UpdateClusteredMesh(*clusteredMesh, &changedTriangle, 1);
+        EATESTAssert(!updated, "The mesh should not have been updated when built with a pass the update does not repeat");
+
+        mAllocator->Free(clusteredMesh);
+    }
+}
@@ -0,0 +1,372 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/clusteredmeshruntimebuilder.h>
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
+
+#include "benchmarkenvironment/allocator.h"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+using namespace rw::collision;
+
+// Unit tests for the prediction of the builder buffer needed by a ClusteredMeshRuntimeBuilder, and for
+// the per stage memory report of a build. The input is a bumpy grid of gridSize by gridSize cells.
+
+namespace
+{
+
+
+/**
+Dispatcher which runs the ranges of each stage on the calling thread, cycling through the worker indices.
+*/
+class SerialDispatcher : public meshbuilder::detail::IParallelDispatcher
+{
+public:
+
+    virtual uint32_t GetNumWorkers() const
+    {
+        return 4u;
+    }
+
+    virtual void ParallelFor(RangeFunction function, void *context, uint32_t count, uint32_t grainSize)
+    {
+        const uint32_t numRanges = GetNumRanges(count, grainSize);
+        for (uint32_t rangeIndex = 0; rangeIndex < numRanges; ++rangeIndex)
+        {
+            const uint32_t begin = rangeIndex * grainSize;
+            const uint32_t end = (count - begin > grainSize) ? (begin + grainSize) : count;
+            function(context, rangeIndex % GetNumWorkers(), begin, end);
+        }
+    }
+};
+
+
+/**
+Sets the vertices and triangles of the test grid on a runtime builder.
+*/
+void
+SetGrid(ClusteredMeshRuntimeBuilder &runtimeBuilder, const uint32_t gridSize)
+{
+    const uint32_t rowSize = gridSize + 1;
+
+    for (uint32_t z = 0 ; z < rowSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < rowSize ; ++x)
+        {
+            const float height = 0.25f * static_cast<float>((x * 7u + z * 3u) % 4u);
+            runtimeBuilder.SetVertex(z * rowSize + x, rw::math::fpu::Vector3U_32(static_cast<float>(x), height, static_cast<float>(z)));
+        }
+    }
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            runtimeBuilder.SetTriangle(triangleIndex++, v0, v0 + 1, v0 + rowSize);
+            runtimeBuilder.SetTriangle(triangleIndex++, v0 + 1, v0 + rowSize + 1, v0 + rowSize);
+        }
+    }
+}
+
+
+/**
+Sets the vertices and triangles of a sparse test mesh on a runtime builder. Each triangle is twice as far from
+the origin as the last, so the KDTree builder cuts off many empty leaves.
+*/
+void
+SetSparseTriangles(ClusteredMeshRuntimeBuilder &runtimeBuilder, const uint32_t numTriangles)
+{
+    for (uint32_t triangleIndex = 0 ; triangleIndex < numTriangles ; ++triangleIndex)
+    {
+        const float x = static_cast<float>(1u << triangleIndex);
+        const uint32_t v0 = 3u * triangleIndex;
+        runtimeBuilder.SetVertex(v0, rw::math::fpu::Vector3U_32(x, 0.0f, 0.0f));
+        runtimeBuilder.SetVertex(v0 + 1u, rw::math::fpu::Vector3U_32(x, 0.0f, 1.0f));
+        runtimeBuilder.SetVertex(v0 + 2u, rw::math::fpu::Vector3U_32(x + 1.0f, 0.0f, 0.0f));
+        runtimeBuilder.SetTriangle(triangleIndex, v0, v0 + 1u, v0 + 2u);
+    }
+}
+
+
+} // namespace
+
+
+class TestClusteredMeshRuntimeBuilderBudget : public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestClusteredMeshRuntimeBuilderBudget");
+        EATEST_REGISTER("TestStagePeaks", "Predicted stage peaks bound the measured stage peaks", TestClusteredMeshRuntimeBuilderBudget, TestStagePeaks);
+        EATEST_REGISTER("TestRequiredBufferSize", "Build within a buffer of the predicted size", TestClusteredMeshRuntimeBuilderBudget, TestRequiredBufferSize);
+        EATEST_REGISTER("TestMergePlanes", "Build with merge planes within a buffer of the predicted size", TestClusteredMeshRuntimeBuilderBudget, TestMergePlanes);
+        EATEST_REGISTER("TestSparseInput", "Build sparse input within a buffer of the predicted size", TestClusteredMeshRuntimeBuilderBudget, TestSparseInput);
+        EATEST_REGISTER("TestParallelDispatcher", "Build with a parallel dispatcher within a buffer of the predicted size", TestClusteredMeshRuntimeBuilderBudget, TestParallelDispatcher);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        EA_ASSERT(mAllocator == 0);
+        mAllocator = new benchmarkenvironment::HeapAllocator();
+    }
+
+    virtual void TeardownSuite()
+    {
+        mAllocator->CheckForLeaks();
+        mAllocator->CheckForTrampling();
+        delete mAllocator;
+        mAllocator = 0;
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestStagePeaks();
+    void TestRequiredBufferSize();
+    void TestMergePlanes();
+    void TestSparseInput();
+    void TestParallelDispatcher();
+
+    void CheckGrid(const uint32_t gridSize, const bool quads);
+
+    benchmarkenvironment::HeapAllocator * mAllocator;
+
+} TestClusteredMeshRuntimeBuilderBudgetSingleton;
+
+
+/**
+Tests that each stage of a build of the grid, in a generous buffer, uses no more than its predicted peak,
+and that the peak of the whole build is within the predicted buffer size. The later stages are bounded by the
+worst case KDTree, so the predicted buffer size is not tight for a grid.
+*/
+void
+TestClusteredMeshRuntimeBuilderBudget::CheckGrid(const uint32_t gridSize, const bool quads)
+{
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+    const uint32_t numVertices = rowSize * rowSize;
+    const uint32_t bufferSize = 1024 * numTriangles;
+
+    ClusteredMeshRuntimeBuilder::Parameters builderParams;
+    builderParams.quads_Enable = quads;
+
+    ClusteredMeshRuntimeBuilder::MemoryReport predicted;
+    meshbuilder::detail::ClusteredMeshBuilder::GetMemoryRequirements(predicted, numTriangles, numVertices, builderParams);
+    const uint32_t requiredBufferSize = ClusteredMeshRuntimeBuilder::GetRequiredBufferSize(numTriangles, numVertices, 0, builderParams);
+
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshRuntimeBuilder runtimeBuilder(numTriangles, numVertices, 0, builderParams, buffer, bufferSize, mAllocator);
+    EATESTAssert(runtimeBuilder.IsBuilderValid(), "The builder should be valid");
+
+    SetGrid(runtimeBuilder, gridSize);
+
+    ClusteredMesh * clusteredMesh = runtimeBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "The grid should have been built");
+
+    ClusteredMeshRuntimeBuilder::MemoryReport measured;
+    runtimeBuilder.GetMemoryReport(measured);
+
+    for (uint32_t stage = 0 ; stage < meshbuilder::detail::ClusteredMeshBuilder::BUILDSTAGE_COUNT ; ++stage)
+    {
+        EATESTAssert(0 != measured.stagePeaks[stage], "Each stage should report its peak memory use");
+        EATESTAssert(measured.stagePeaks[stage] <= predicted.stagePeaks[stage], "Each stage should use no more than its predicted peak");
+    }
+
+    EATESTAssert(runtimeBuilder.GetPeakMemoryUsed() <= requiredBufferSize, "The build should use no more than the predicted buffer size");
+
+    mAllocator->Free(clusteredMesh);
+    runtimeBuilder.Release();
+
+    ClusteredMeshRuntimeBuilder::MemoryReport released;
+    runtimeBuilder.GetMemoryReport(released);
+    EATESTAssert(0 == released.GetPeak(), "A released builder should report no memory use");
+
+    mAllocator->Free(buffer);
+}
+
+
+/**
+Tests the predicted stage peaks against builds of grids of several sizes, with and without quads.
+*/
+void
+TestClusteredMeshRuntimeBuilderBudget::TestStagePeaks()
+{
+    CheckGrid(4, false);
+    CheckGrid(16, false);
+    CheckGrid(16, true);
+    CheckGrid(48, true);
+}
+
+
+/**
+Tests that a grid can be built in a buffer of exactly the predicted size.
+*/
+void
+TestClusteredMeshRuntimeBuilderBudget::TestRequiredBufferSize()
+{
+    const uint32_t gridSize = 32;
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+    const uint32_t numVertices = rowSize * rowSize;
+
+    ClusteredMeshRuntimeBuilder::Parameters builderParams;
+
+    const uint32_t bufferSize = ClusteredMeshRuntimeBuilder::GetRequiredBufferSize(numTriangles, numVertices, 0, builderParams);
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshRuntimeBuilder runtimeBuilder(numTriangles, numVertices, 0, builderParams, buffer, bufferSize, mAllocator);
+    EATESTAssert(runtimeBuilder.IsBuilderValid(), "The builder should be valid");
+
+    SetGrid(runtimeBuilder, gridSize);
+
+    ClusteredMesh * clusteredMesh = runtimeBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "The grid should have been built within the predicted buffer size");
+    EATESTAssert(clusteredMesh->IsValid(), "The ClusteredMesh should be valid");
+    EATESTAssert(runtimeBuilder.GetPeakMemoryUsed() <= bufferSize, "The peak memory used should be within the buffer");
+
+    mAllocator->Free(clusteredMesh);
+    runtimeBuilder.Release();
+    mAllocator->Free(buffer);
+}
+
+
+/**
+Tests that the merge planes are accounted for in the predicted buffer size, and that a builder with
+merge planes is valid.
+*/
+void
+TestClusteredMeshRuntimeBuilderBudget::TestMergePlanes()
+{
+    const uint32_t gridSize = 8;
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+    const uint32_t numVertices = rowSize * rowSize;
+    const uint32_t numMergePlanes = 4;
+
+    ClusteredMeshRuntimeBuilder::Parameters builderParams;
+
+    const uint32_t bufferSize = ClusteredMeshRuntimeBuilder::GetRequiredBufferSize(numTriangles, numVertices, numMergePlanes, builderParams);
+    EATESTAssert(bufferSize > ClusteredMeshRuntimeBuilder::GetRequiredBufferSize(numTriangles, numVertices, 0, builderParams),
+        "The merge planes should add to the predicted buffer size");
+
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshRuntimeBuilder runtimeBuilder(numTriangles, numVertices, numMergePlanes, builderParams, buffer, bufferSize, mAllocator);
+    EATESTAssert(runtimeBuilder.IsBuilderValid(), "The builder with merge planes should be valid");
+
+    SetGrid(runtimeBuilder, gridSize);
+
+    // Planes bounding the grid, well away from it
+    runtimeBuilder.SetMergePlane(0, rwpmath::Vector3(1.0f, 0.0f, 0.0f), rwpmath::VecFloat(-100.0f));
+    runtimeBuilder.SetMergePlane(1, rwpmath::Vector3(-1.0f, 0.0f, 0.0f), rwpmath::VecFloat(-100.0f));
+    runtimeBuilder.SetMergePlane(2, rwpmath::Vector3(0.0f, 0.0f, 1.0f), rwpmath::VecFloat(-100.0f));
+    runtimeBuilder.SetMergePlane(3, rwpmath::Vector3(0.0f, 0.0f, -1.0f), rwpmath::VecFloat(-100.0f));
+
+    ClusteredMesh * clusteredMesh = runtimeBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "The grid should have been built within the predicted buffer size");
+    EATESTAssert(runtimeBuilder.GetPeakMemoryUsed() <= bufferSize, "The peak memory used should be within the buffer");
+
+    mAllocator->Free(clusteredMesh);
+    runtimeBuilder.Release();
+    mAllocator->Free(buffer);
+}
+
+
+/**
+Tests that a mesh whose KDTree has many empty leaves, and so more leaves than clusters, can be built in a
+buffer of exactly the predicted size, with each stage within its predicted peak.
+*/
+void
+TestClusteredMeshRuntimeBuilderBudget::TestSparseInput()
+{
+    const uint32_t numTriangles = 24;
+    const uint32_t numVertices = 3 * numTriangles;
+
+    ClusteredMeshRuntimeBuilder::Parameters builderParams;
+
+    ClusteredMeshRuntimeBuilder::MemoryReport predicted;
+    meshbuilder::detail::ClusteredMeshBuilder::GetMemoryRequirements(predicted, numTriangles, numVertices, builderParams);
+    const uint32_t bufferSize = ClusteredMeshRuntimeBuilder::GetRequiredBufferSize(numTriangles, numVertices, 0, builderParams);
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshRuntimeBuilder runtimeBuilder(numTriangles, numVertices, 0, builderParams, buffer, bufferSize, mAllocator);
+    EATESTAssert(runtimeBuilder.IsBuilderValid(), "The builder should be valid");
+
+    SetSparseTriangles(runtimeBuilder, numTriangles);
+
+    ClusteredMesh * clusteredMesh = runtimeBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "The sparse mesh should have been built within the predicted buffer size");
+    EATESTAssert(clusteredMesh->IsValid(), "The ClusteredMesh should be valid");
+    EATESTAssert(runtimeBuilder.GetPeakMemoryUsed() <= bufferSize, "The peak memory used should be within the buffer");
+
+    const uint32_t numLeaves = clusteredMesh->GetKDTreeBase()->GetNumBranchNodes() + 1u;
+    EATESTAssert(numLeaves > clusteredMesh->GetNumCluster(), "The KDTree of the sparse mesh should have empty leaves");
+
+    ClusteredMeshRuntimeBuilder::MemoryReport measured;
+    runtimeBuilder.GetMemoryReport(measured);
+    for (uint32_t stage = 0 ; stage < meshbuilder::detail::ClusteredMeshBuilder::BUILDSTAGE_COUNT ; ++stage)
+    {
+        EATESTAssert(measured.stagePeaks[stage] <= predicted.stagePeaks[stage], "Each stage should use no more than its predicted peak");
+    }
+
+    mAllocator->Free(clusteredMesh);
+    runtimeBuilder.Release();
+    mAllocator->Free(buffer);
+}
+
+
+/**
+Tests that a parallel dispatcher needs no worker arenas for the neighbor search, which mates the sorted edges
+in parallel, and that a grid can be built with a dispatcher in the predicted buffer size.
+*/
+void
+TestClusteredMeshRuntimeBuilderBudget::TestParallelDispatcher()
+{
+    const uint32_t gridSize = 32;
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+    const uint32_t numVertices = rowSize * rowSize;
+
+    SerialDispatcher dispatcher;
+
+    ClusteredMeshRuntimeBuilder::Parameters serialParams;
+    ClusteredMeshRuntimeBuilder::Parameters builderParams;
+    builderParams.parallelDispatcher = &dispatcher;
+
+    ClusteredMeshRuntimeBuilder::MemoryReport serialPredicted;
+    meshbuilder::detail::ClusteredMeshBuilder::GetMemoryRequirements(serialPredicted, numTriangles, numVertices, serialParams);
+    ClusteredMeshRuntimeBuilder::MemoryReport predicted;
+    meshbuilder::detail::ClusteredMeshBuilder::GetMemoryRequirements(predicted, numTriangles, numVertices, builderParams);
+    EATESTAssert(predicted.stagePeaks[meshbuilder::detail::ClusteredMeshBuilder::BUILDSTAGE_ADJACENCY] ==
+        serialPredicted.stagePeaks[meshbuilder::detail::ClusteredMeshBuilder::BUILDSTAGE_ADJACENCY],
+        "The dispatcher should not add to the predicted adjacency stage peak");
+
+    const uint32_t bufferSize = ClusteredMeshRuntimeBuilder::GetRequiredBufferSize(numTriangles, numVertices, 0, builderParams);
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshRuntimeBuilder runtimeBuilder(numTriangles, numVertices, 0, builderParams, buffer, bufferSize, mAllocator);
+    EATESTAssert(runtimeBuilder.IsBuilderValid(), "The builder should be valid");
+
+    SetGrid(runtimeBuilder, gridSize);
+
+    ClusteredMesh * clusteredMesh = runtimeBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "The grid should have been built within the predicted buffer size");
+    EATESTAssert(clusteredMesh->IsValid(), "The ClusteredMesh should be valid");
+    EATESTAssert(runtimeBuilder.GetPeakMemoryUsed() <= bufferSize, "The peak memory used should be within the buffer");
+
+    mAllocator->Free(clusteredMesh);
+    runtimeBuilder.Release();
+    mAllocator->Free(buffer);
+}
@@ -0,0 +1,568 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/clusteredmeshstreamingbuilder.h>
+#include <rw/collision/clusteredmeshofflinebuilder.h>
+
+#include "benchmarkenvironment/allocator.h"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include <string.h>    // for memset()
+
+using namespace rw::collision;
+
+// Unit tests for the streaming build of a mesh as a ClusteredMesh for each chunk of the input.
+// The input is a bumpy grid of gridSize by gridSize cells, split into square chunks which each hold
+// their own copies of the vertices on their boundaries.
+
+namespace
+{
+
+
+/**
+Returns the height of a vertex of the test grid, so that the grid has both convex and concave edges.
+*/
+float
+GetGridHeight(const uint32_t x, const uint32_t z)
+{
+    return 0.25f * static_cast<float>((x * 7u + z * 3u) % 4u);
+}
+
+
+/**
+Reads the chunks of the test grid.
+*/
+class GridChunkReader : public ClusteredMeshStreamingBuilder::ChunkReader
+{
+public:
+
+    GridChunkReader(const uint32_t gridSize, const uint32_t chunkSize)
+        : m_gridSize(gridSize)
+        , m_chunkSize(chunkSize)
+        , m_chunksPerSide(gridSize / chunkSize)
+    {
+    }
+
+    virtual uint32_t GetNumChunks()
+    {
+        return m_chunksPerSide * m_chunksPerSide;
+    }
+
+    virtual void GetChunkSize(uint32_t /*chunkIndex*/, uint32_t &numTriangles, uint32_t &numVertices)
+    {
+        numTriangles = 2u * m_chunkSize * m_chunkSize;
+        numVertices = (m_chunkSize + 1u) * (m_chunkSize + 1u);
+    }
+
+    virtual bool ReadChunk(uint32_t chunkIndex, ClusteredMeshStreamingBuilder::Chunk &chunk)
+    {
+        const uint32_t rowSize = m_chunkSize + 1u;
+        const uint32_t chunkX = (chunkIndex % m_chunksPerSide) * m_chunkSize;
+        const uint32_t chunkZ = (chunkIndex / m_chunksPerSide) * m_chunkSize;
+
+        for (uint32_t z = 0 ; z < rowSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < rowSize ; ++x)
+            {
+                chunk.vertices[z * rowSize + x] = rw::math::fpu::Vector3U_32(
+                    static_cast<float>(chunkX + x),
+                    GetGridHeight(chunkX + x, chunkZ + z),
+                    static_cast<float>(chunkZ + z));
+            }
+        }
+
+        uint32_t triangleIndex = 0;
+        for (uint32_t z = 0 ; z < m_chunkSize ; ++z)
+        {
+            for (uint32_t x = 0 ; x < m_chunkSize ; ++x)
+            {
+                const uint32_t v0 = z * rowSize + x;
+                SetTriangle(chunk, triangleIndex++, v0, v0 + 1u, v0 + rowSize);
+                SetTriangle(chunk, triangleIndex++, v0 + 1u, v0 + rowSize + 1u, v0 + rowSize);
+            }
+        }
+
+        return true;
+    }
+
+private:
+
+    void SetTriangle(ClusteredMeshStreamingBuilder::Chunk &chunk, uint32_t triangleIndex, uint32_t v0, uint32_t v1, uint32_t v2)
+    {
+        chunk.triangleVertexIndices[3u * triangleIndex] = v0;
+        chunk.triangleVertexIndices[3u * triangleIndex + 1u] = v1;
+        chunk.triangleVertexIndices[3u * triangleIndex + 2u] = v2;
+        chunk.triangleGroupIDs[triangleIndex] = 0;
+        chunk.triangleSurfaceIDs[triangleIndex] = 0;
+    }
+
+    uint32_t m_gridSize;
+    uint32_t m_chunkSize;
+    uint32_t m_chunksPerSide;
+};
+
+
+/**
+Counts the units and convex triangle edges of each ClusteredMesh written.
+*/
+class CountingChunkWriter : public ClusteredMeshStreamingBuilder::ChunkWriter
+{
+public:
+
+    CountingChunkWriter()
+        : m_numMeshes(0)
+        , m_numInvalidMeshes(0)
+        , m_numUnits(0)
+        , m_numConvexEdges(0)
+    {
+    }
+
+    virtual bool WriteChunkMesh(uint32_t /*chunkIndex*/, const ClusteredMesh &clusteredMesh)
+    {
+        ++m_numMeshes;
+        m_numInvalidMeshes += clusteredMesh.IsValid() ? 0u : 1u;
+        m_numUnits += clusteredMesh.GetNumUnits();
+        m_numConvexEdges += CountConvexEdges(clusteredMesh);
+        return true;
+    }
+
+    static uint32_t CountConvexEdges(const ClusteredMesh &clusteredMesh)
+    {
+        uint32_t numConvexEdges = 0;
+
+        for (uint32_t clusterIndex = 0 ; clusterIndex < clusteredMesh.GetNumCluster() ; ++clusterIndex)
+        {
+            const ClusteredMeshCluster &cluster = clusteredMesh.GetCluster(clusterIndex);
+
+            uint32_t offset = 0;
+            for (uint32_t unitIndex = 0 ; unitIndex < cluster.unitCount ; ++unitIndex)
+            {
+                Volume volumes[2];
+                uint32_t numVolumes = 0;
+                offset += clusteredMesh.GetUnitVolumes(clusterIndex, offset, volumes, numVolumes);
+
+                for (uint32_t volumeIndex = 0 ; volumeIndex < numVolumes ; ++volumeIndex)
+                {
+                    const uint32_t flags = volumes[volumeIndex].GetFlags();
+                    numConvexEdges += (flags & VOLUMEFLAG_TRIANGLEEDGE0CONVEX) ? 1u : 0u;
+                    numConvexEdges += (flags & VOLUMEFLAG_TRIANGLEEDGE1CONVEX) ? 1u : 0u;
+                    numConvexEdges += (flags & VOLUMEFLAG_TRIANGLEEDGE2CONVEX) ? 1u : 0u;
+                }
+            }
+        }
+
+        return numConvexEdges;
+    }
+
+    uint32_t m_numMeshes;
+    uint32_t m_numInvalidMeshes;
+    uint32_t m_numUnits;
+    uint32_t m_numConvexEdges;
+};
+
+
+/**
+Returns the grid coordinates of a vertex of a triangle of the test grid, with the triangles numbered and
+their vertices ordered as in the input of a whole grid build.
+*/
+void
+GetGridTriangleVertex(uint32_t &x, uint32_t &z, const uint32_t gridSize, const uint32_t triangleIndex, const uint32_t vertex)
+{
+    // Lower triangle (x, z), (x + 1, z), (x, z + 1), then upper triangle (x + 1, z), (x + 1, z + 1), (x, z + 1)
+    static const uint32_t offsetX[2][3] = { { 0, 1, 0 }, { 1, 1, 0 } };
+    static const uint32_t offsetZ[2][3] = { { 0, 0, 1 }, { 0, 1, 1 } };
+
+    const uint32_t cell = triangleIndex / 2u;
+    const uint32_t upper = triangleIndex % 2u;
+    x = cell % gridSize + offsetX[upper][vertex];
+    z = cell / gridSize + offsetZ[upper][vertex];
+}
+
+
+/**
+The edge codes of a triangle of the test grid, in the order of its input edges, and the number of units
+found for it.
+*/
+struct GridTriangleEdgeCodes
+{
+    uint32_t numUnits;
+    uint8_t edgeCodes[3];
+};
+
+
+/**
+Records the edge codes of each triangle of the test grid written, by the index of the triangle in a whole
+grid build, so that the chunks can be compared triangle by triangle with the whole grid.
+*/
+class EdgeCodeChunkWriter : public ClusteredMeshStreamingBuilder::ChunkWriter
+{
+public:
+
+    EdgeCodeChunkWriter(const uint32_t gridSize, GridTriangleEdgeCodes *triangles)
+        : m_gridSize(gridSize)
+        , m_triangles(triangles)
+        , m_numUnrecordedUnits(0)
+    {
+    }
+
+    virtual bool WriteChunkMesh(uint32_t /*chunkIndex*/, const ClusteredMesh &clusteredMesh)
+    {
+        m_numUnrecordedUnits += RecordEdgeCodes(clusteredMesh, m_gridSize, m_triangles);
+        return true;
+    }
+
+    /**
+    Records the edge codes of the triangle units of a ClusteredMesh of quantized vertices on the grid,
+    returning the number of units which are not triangles of the grid with edge codes.
+    */
+    static uint32_t RecordEdgeCodes(const ClusteredMesh &clusteredMesh, const uint32_t gridSize, GridTriangleEdgeCodes *triangles)
+    {
+        const float granularity = clusteredMesh.GetVertexCompressionGranularity();
+        uint32_t numUnrecordedUnits = 0;
+
+        for (uint32_t clusterIndex = 0 ; clusterIndex < clusteredMesh.GetNumCluster() ; ++clusterIndex)
+        {
+            ClusteredMeshCluster &cluster = clusteredMesh.GetCluster(clusterIndex);
+            const uint8_t *unitData = cluster.UnitData();
+
+            uint32_t offset = 0;
+            for (uint32_t unitIndex = 0 ; unitIndex < cluster.unitCount ; ++unitIndex)
+            {
+                const uint8_t *unit = unitData + offset;
+
+                Volume volumes[2];
+                uint32_t numVolumes = 0;
+                offset += clusteredMesh.GetUnitVolumes(clusterIndex, offset, volumes, numVolumes);
+
+                if (UNITTYPE_TRIANGLE != (unit[0] & UNITTYPE_MASK) || 0 == (unit[0] & UNITFLAG_EDGEANGLE) ||
+                    !RecordTriangle(cluster, granularity, unit, gridSize, triangles))
+                {
+                    ++numUnrecordedUnits;
+                }
+            }
+        }
+
+        return numUnrecordedUnits;
+    }
+
+    uint32_t m_gridSize;
+    GridTriangleEdgeCodes *m_triangles;
+    uint32_t m_numUnrecordedUnits;
+
+private:
+
+    static bool RecordTriangle(const ClusteredMeshCluster &cluster, const float granularity, const uint8_t *unit,
+                               const uint32_t gridSize, GridTriangleEdgeCodes *triangles)
+    {
+        float vertexX[3];
+        float vertexZ[3];
+        for (uint32_t i = 0 ; i < 3 ; ++i)
+        {
+            const rwpmath::Vector3 vertex = cluster.GetVertex(unit[1 + i], granularity);
+            vertexX[i] = static_cast<float>(vertex.GetX());
+            vertexZ[i] = static_cast<float>(vertex.GetZ());
+        }
+
+        // The centroid is a third of the way across the cell from the corner of the lower or upper triangle
+        const float centroidX = (vertexX[0] + vertexX[1] + vertexX[2]) / 3.0f;
+        const float centroidZ = (vertexZ[0] + vertexZ[1] + vertexZ[2]) / 3.0f;
+        const uint32_t cellX = static_cast<uint32_t>(centroidX);
+        const uint32_t cellZ = static_cast<uint32_t>(centroidZ);
+        if (cellX >= gridSize || cellZ >= gridSize)
+        {
+            return false;
+        }
+        const uint32_t upper = (centroidX - static_cast<float>(cellX) > 0.5f) ? 1u : 0u;
+        const uint32_t triangleIndex = 2u * (cellZ * gridSize + cellX) + upper;
+
+        // Edge i of the unit runs from vertex i to vertex i + 1, so map the unit edges onto the input edges
+        GridTriangleEdgeCodes &triangle = triangles[triangleIndex];
+        for (uint32_t inputEdge = 0 ; inputEdge < 3 ; ++inputEdge)
+        {
+            uint32_t x0, z0, x1, z1;
+            GetGridTriangleVertex(x0, z0, gridSize, triangleIndex, inputEdge);
+            GetGridTriangleVertex(x1, z1, gridSize, triangleIndex, (inputEdge + 1u) % 3u);
+
+            uint32_t unitEdge = 0;
+            while (unitEdge < 3 && !(vertexX[unitEdge] == static_cast<float>(x0) && vertexZ[unitEdge] == static_cast<float>(z0)))
+            {
+                ++unitEdge;
+            }
+            const uint32_t next = (unitEdge + 1u) % 3u;
+            if (unitEdge == 3 || !(vertexX[next] == static_cast<float>(x1) && vertexZ[next] == static_cast<float>(z1)))
+            {
+                return false;
+            }
+
+            triangle.edgeCodes[inputEdge] = unit[4 + unitEdge];
+        }
+
+        ++triangle.numUnits;
+        return true;
+    }
+};
+
+
+/**
+Finds the triangle of the test grid which shares an edge of a triangle, reversed, returning false if the
+edge is on the boundary of the grid.
+*/
+bool
+FindGridNeighbor(uint32_t &neighbor, uint32_t &neighborEdge, const uint32_t gridSize, const uint32_t triangleIndex, const uint32_t edge)
+{
+    uint32_t x0, z0, x1, z1;
+    GetGridTriangleVertex(x0, z0, gridSize, triangleIndex, edge);
+    GetGridTriangleVertex(x1, z1, gridSize, triangleIndex, (edge + 1u) % 3u);
+
+    for (uint32_t other = 0 ; other < 2u * gridSize * gridSize ; ++other)
+    {
+        for (uint32_t otherEdge = 0 ; otherEdge < 3 ; ++otherEdge)
+        {
+            uint32_t u0, w0, u1, w1;
+            GetGridTriangleVertex(u0, w0, gridSize, other, otherEdge);
+            GetGridTriangleVertex(u1, w1, gridSize, other, (otherEdge + 1u) % 3u);
+            if (u0 == x1 && w0 == z1 && u1 == x0 && w1 == z0)
+            {
+                neighbor = other;
+                neighborEdge = otherEdge;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+} // namespace
+
+
+class TestClusteredMeshStreamingBuilder : public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestClusteredMeshStreamingBuilder");
+        EATEST_REGISTER("TestChunkedGrid", "Streaming build of a grid split into chunks", TestClusteredMeshStreamingBuilder, TestChunkedGrid);
+        EATEST_REGISTER("TestSeamEdges", "Edges on chunk boundaries match a build of the whole grid", TestClusteredMeshStreamingBuilder, TestSeamEdges);
+        EATEST_REGISTER("TestMemoryBudget", "Streaming build with a memory budget too small for a chunk", TestClusteredMeshStreamingBuilder, TestMemoryBudget);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        EA_ASSERT(mAllocator == 0);
+        mAllocator = new benchmarkenvironment::HeapAllocator();
+    }
+
+    virtual void TeardownSuite()
+    {
+        mAllocator->CheckForLeaks();
+        mAllocator->CheckForTrampling();
+        delete mAllocator;
+        mAllocator = 0;
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestChunkedGrid();
+    void TestSeamEdges();
+    void TestMemoryBudget();
+
+    benchmarkenvironment::HeapAllocator * mAllocator;
+
+} TestClusteredMeshStreamingBuilderSingleton;
+
+
+/**
+Tests that each chunk is built and written, with a unit for each of its triangles, and that the boundary
+edges of each chunk find the triangles of the neighboring chunks.
+*/
+void
+TestClusteredMeshStreamingBuilder::TestChunkedGrid()
+{
+    const uint32_t gridSize = 32;
+    const uint32_t chunkSize = 8;
+    const uint32_t bufferSize = 1024 * 1024;
+
+    ClusteredMeshStreamingBuilder::Parameters builderParams;
+    builderParams.quads_Enable = false;
+
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshStreamingBuilder streamingBuilder(builderParams, buffer, bufferSize, mAllocator);
+
+    GridChunkReader reader(gridSize, chunkSize);
+    CountingChunkWriter writer;
+
+    const bool built = streamingBuilder.BuildClusteredMeshes(reader, writer);
+
+    EATESTAssert(built, "The chunks should have been built");
+    EATESTAssert(16 == writer.m_numMeshes, "A ClusteredMesh should have been written for each chunk");
+    EATESTAssert(0 == writer.m_numInvalidMeshes, "Each ClusteredMesh should be valid");
+    EATESTAssert(2 * gridSize * gridSize == writer.m_numUnits, "Each triangle should be in a single unit, border triangles excluded");
+
+    // Each chunk has 4 * 8 boundary edges, of which the 24 on the grid boundary have no neighbor
+    EATESTAssert(16 * 4 * chunkSize == streamingBuilder.GetNumBoundaryEdges(), "Each chunk should have 32 boundary edges");
+    EATESTAssert(16 * 4 * chunkSize - 4 * gridSize == streamingBuilder.GetNumBorderTriangles(), "Each shared boundary edge should give a border triangle");
+
+    EATESTAssert(streamingBuilder.GetPeakMemoryUsed() <= bufferSize, "The peak memory used should be within the budget");
+
+    mAllocator->Free(buffer);
+}
+
+
+/**
+Tests that the triangles of the chunks have the same edge codes as in a build of the whole grid, so that
+the edges on the chunk boundaries are matched with the neighboring triangles in the other chunks rather than
+being treated as unmatched edges.
+*/
+void
+TestClusteredMeshStreamingBuilder::TestSeamEdges()
+{
+    const uint32_t gridSize = 16;
+    const uint32_t chunkSize = 4;
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t bufferSize = 1024 * 1024;
+
+    ClusteredMeshStreamingBuilder::Parameters builderParams;
+    builderParams.quads_Enable = false;
+
+    // Build the whole grid
+    ClusteredMeshOfflineBuilder offlineBuilder(2 * gridSize * gridSize, rowSize * rowSize, 0, builderParams, mAllocator);
+
+    for (uint32_t z = 0 ; z < rowSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < rowSize ; ++x)
+        {
+            offlineBuilder.SetVertex(z * rowSize + x, rw::math::fpu::Vector3U_32(static_cast<float>(x), GetGridHeight(x, z), static_cast<float>(z)));
+        }
+    }
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            offlineBuilder.SetTriangle(triangleIndex++, v0, v0 + 1, v0 + rowSize);
+            offlineBuilder.SetTriangle(triangleIndex++, v0 + 1, v0 + rowSize + 1, v0 + rowSize);
+        }
+    }
+
+    ClusteredMesh * clusteredMesh = offlineBuilder.BuildClusteredMesh();
+    EATESTAssert(NULL != clusteredMesh, "The whole grid should have been built");
+
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+    const uint32_t edgeCodesSize = numTriangles * sizeof(GridTriangleEdgeCodes);
+    GridTriangleEdgeCodes * wholeTriangles = static_cast<GridTriangleEdgeCodes *>(mAllocator->Alloc(edgeCodesSize, NULL, 0, 4));
+    GridTriangleEdgeCodes * chunkTriangles = static_cast<GridTriangleEdgeCodes *>(mAllocator->Alloc(edgeCodesSize, NULL, 0, 4));
+    memset(wholeTriangles, 0, edgeCodesSize);
+    memset(chunkTriangles, 0, edgeCodesSize);
+
+    const uint32_t numConvexEdges = CountingChunkWriter::CountConvexEdges(*clusteredMesh);
+    EATESTAssert(0 == EdgeCodeChunkWriter::RecordEdgeCodes(*clusteredMesh, gridSize, wholeTriangles), "Each unit of the whole grid should be a grid triangle");
+    mAllocator->Free(clusteredMesh);
+
+    // Build the grid in chunks
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    {
+        ClusteredMeshStreamingBuilder streamingBuilder(builderParams, buffer, bufferSize, mAllocator);
+
+        GridChunkReader reader(gridSize, chunkSize);
+        CountingChunkWriter writer;
+
+        EATESTAssert(streamingBuilder.BuildClusteredMeshes(reader, writer), "The chunks should have been built");
+        EATESTAssert(numConvexEdges == writer.m_numConvexEdges, "The chunks should have as many convex edges as the whole grid");
+    }
+
+    {
+        ClusteredMeshStreamingBuilder streamingBuilder(builderParams, buffer, bufferSize, mAllocator);
+
+        GridChunkReader reader(gridSize, chunkSize);
+        EdgeCodeChunkWriter writer(gridSize, chunkTriangles);
+
+        EATESTAssert(streamingBuilder.BuildClusteredMeshes(reader, writer), "The chunks should have been built");
+        EATESTAssert(0 == writer.m_numUnrecordedUnits, "Each unit of the chunks should be a grid triangle");
+    }
+
+    // Compare each triangle with the whole grid, and with its neighbors, which may be in another chunk
+    uint32_t numMissingTriangles = 0;
+    uint32_t numDifferentEdgeCodes = 0;
+    uint32_t numDifferentMatches = 0;
+    uint32_t numDifferentNeighborEdges = 0;
+    for (uint32_t triangleIndex = 0 ; triangleIndex < numTriangles ; ++triangleIndex)
+    {
+        const GridTriangleEdgeCodes & whole = wholeTriangles[triangleIndex];
+        const GridTriangleEdgeCodes & chunk = chunkTriangles[triangleIndex];
+        if (1 != whole.numUnits || 1 != chunk.numUnits)
+        {
+            ++numMissingTriangles;
+            continue;
+        }
+
+        for (uint32_t edge = 0 ; edge < 3 ; ++edge)
+        {
+            numDifferentEdgeCodes += (whole.edgeCodes[edge] != chunk.edgeCodes[edge]) ? 1u : 0u;
+
+            uint32_t neighbor = 0;
+            uint32_t neighborEdge = 0;
+            const bool hasNeighbor = FindGridNeighbor(neighbor, neighborEdge, gridSize, triangleIndex, edge);
+            const bool matched = (0 == (chunk.edgeCodes[edge] & EDGEFLAG_EDGEUNMATCHED));
+            numDifferentMatches += (hasNeighbor != matched) ? 1u : 0u;
+
+            if (hasNeighbor)
+            {
+                const uint8_t mask = EDGEFLAG_ANGLEMASK | EDGEFLAG_EDGECONVEX;
+                const uint8_t neighborCode = chunkTriangles[neighbor].edgeCodes[neighborEdge];
+                numDifferentNeighborEdges += ((chunk.edgeCodes[edge] & mask) != (neighborCode & mask)) ? 1u : 0u;
+            }
+        }
+    }
+
+    EATESTAssert(0 == numMissingTriangles, "Each triangle should be a single unit of the whole grid and of the chunks");
+    EATESTAssert(0 == numDifferentEdgeCodes, "Each triangle of the chunks should have the edge codes of the whole grid");
+    EATESTAssert(0 == numDifferentMatches, "Each edge should be matched if and only if it has a neighbor in the grid");
+    EATESTAssert(0 == numDifferentNeighborEdges, "Each edge should have the angle and convexity of the edge of its neighbor");
+
+    mAllocator->Free(buffer);
+    mAllocator->Free(chunkTriangles);
+    mAllocator->Free(wholeTriangles);
+}
+
+
+/**
+Tests that the build fails cleanly, within the budget, when the budget is too small for a chunk.
+*/
+void
+TestClusteredMeshStreamingBuilder::TestMemoryBudget()
+{
+    const uint32_t gridSize = 32;
+    const uint32_t chunkSize = 16;
+    const uint32_t bufferSize = 4 * 1024;
+
+    ClusteredMeshStreamingBuilder::Parameters builderParams;
+
+    uint8_t * buffer = static_cast<uint8_t *>(mAllocator->Alloc(bufferSize, NULL, 0, 4));
+
+    ClusteredMeshStreamingBuilder streamingBuilder(builderParams, buffer, bufferSize, mAllocator);
+
+    GridChunkReader reader(gridSize, chunkSize);
+    CountingChunkWriter writer;
+
+    EATESTAssert(!streamingBuilder.BuildClusteredMeshes(reader, writer), "The build should fail");
+    EATESTAssert(0 == writer.m_numMeshes, "No ClusteredMesh should have been written");
+    EATESTAssert(streamingBuilder.GetPeakMemoryUsed() <= bufferSize, "The peak memory used should be within the budget");
+
+    mAllocator->Free(buffer);
+}
@@ -17,6 +17,38 @@
 using namespace rw::collision::meshbuilder::detail;
 using namespace rw::collision;
 
+namespace
+{
+
+
+/**
+Dispatcher which runs the ranges of each stage on the calling thread in reverse order, cycling through the
+worker indices.
+*/
+class ReverseDispatcher : public IParallelDispatcher
+{
+public:
+
+    virtual uint32_t GetNumWorkers() const
+    {
+        return 4u;
+    }
+
+    virtual void ParallelFor(RangeFunction function, void *context, uint32_t count, uint32_t grainSize)
+    {
+        const uint32_t numRanges = GetNumRanges(count, grainSize);
+        for (uint32_t rangeIndex = numRanges; rangeIndex-- > 0;)
+        {
+            const uint32_t begin = rangeIndex * grainSize;
+            const uint32_t end = (count - begin > grainSize) ? (begin + grainSize) : count;
+            function(context, rangeIndex % GetNumWorkers(), begin, end);
+        }
+    }
+};
+
+
+} // namespace
+
 class TestTriangleNeighborFinder : public tests::TestSuiteBase
 {
 public:
@@ -38,6 +70,10 @@ public:
         EATEST_REGISTER("TestEdgeSharedByTwoPairs", "Testing an edge shared by two pairs", TestTriangleNeighborFinder, TestEdgeSharedByTwoPairs);
         EATEST_REGISTER("TestLoopUnmatchedTriangles", "Testing a loop of unmatched triangles", TestTriangleNeighborFinder, TestLoopUnmatchedTriangles);
         EATEST_REGISTER("TestLoopTrianglePairs", "Testing a loop of triangle pairs triangles", TestTriangleNeighborFinder, TestLoopTrianglePairs);
+
+        // Edge sort tests
+        EATEST_REGISTER("TestFindTriangleNeighborsByEdgeSort", "Testing FindTriangleNeighborsByEdgeSort matches FindTriangleNeighbors", TestTriangleNeighborFinder, TestFindTriangleNeighborsByEdgeSort);
+        EATEST_REGISTER("TestFindTriangleNeighborsByEdgeSortParallel", "Testing FindTriangleNeighborsByEdgeSort with a dispatcher matches FindTriangleNeighbors", TestTriangleNeighborFinder, TestFindTriangleNeighborsByEdgeSortParallel);
     }
 
     virtual void SetupSuite()
@@ -59,6 +95,9 @@ private:
     void TestLoopUnmatchedTriangles();
     void TestLoopTrianglePairs();
 
+    void TestFindTriangleNeighborsByEdgeSort();
+    void TestFindTriangleNeighborsByEdgeSortParallel();
+
     EA::Allocator::ICoreAllocator * m_allocator;
 
 } TestTriangleNeighborFinderSingleton;
@@ -1069,3 +1108,270 @@ TestTriangleNeighborFinder::TestLoopTrianglePairs()
     VertexList::Free(m_allocator, vertices);
     TriangleList::Free(m_allocator, triangles);
 }
+
+
+/**
+Tests that matching sorted edges gives exactly the same neighbors and edge cosines as walking the vertex
+triangle map. The mesh is a fan around a single high valence vertex, with a book of pages sharing one
+edge, a double sided triangle and some disabled triangles, so matches are replaced in the same order.
+*/
+void
+TestTriangleNeighborFinder::TestFindTriangleNeighborsByEdgeSort()
+{
+    const uint32_t numFanTriangles = 64;
+    const uint32_t numPages = 6;
+    const uint32_t numVertices = 1 + numFanTriangles + numPages;
+    const uint32_t numTriangles = numFanTriangles + numPages + 1;
+
+    // Initialize vertices, the fan center, a ring of vertices around it and the outer vertices of the pages
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices, ("VertexList should have been allocated"));
+    vertices->resize(numVertices);
+
+    (*vertices)[0] = meshbuilder::VectorType(0.0f, 0.0f, 0.0f);
+    for (uint32_t ringIndex = 0 ; ringIndex < numFanTriangles ; ++ringIndex)
+    {
+        const float angle = 6.2831853f * static_cast<float>(ringIndex) / static_cast<float>(numFanTriangles);
+        const float height = (ringIndex % 3) * 0.25f;
+        (*vertices)[1 + ringIndex] = meshbuilder::VectorType(rwpmath::Cos(angle), height, rwpmath::Sin(angle));
+    }
+    for (uint32_t pageIndex = 0 ; pageIndex < numPages ; ++pageIndex)
+    {
+        const float angle = 6.2831853f * static_cast<float>(pageIndex) / static_cast<float>(numPages);
+        (*vertices)[1 + numFanTriangles + pageIndex] = meshbuilder::VectorType(0.5f, rwpmath::Cos(angle), rwpmath::Sin(angle) - 0.5f);
+    }
+
+    // Initialize triangles
+    TriangleList * triangles = TriangleList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangles, ("TriangleList should have been allocated"));
+    triangles->resize(numTriangles);
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t ringIndex = 0 ; ringIndex < numFanTriangles ; ++ringIndex)
+    {
+        (*triangles)[triangleIndex].vertices[0] = 0;
+        (*triangles)[triangleIndex].vertices[1] = 1 + (ringIndex + 1) % numFanTriangles;
+        (*triangles)[triangleIndex].vertices[2] = 1 + ringIndex;
+        ++triangleIndex;
+    }
+
+    // Pages share the edge between the center and the first ring vertex, alternating in direction
+    for (uint32_t pageIndex = 0 ; pageIndex < numPages ; ++pageIndex)
+    {
+        (*triangles)[triangleIndex].vertices[0] = (pageIndex % 2) ? 1u : 0u;
+        (*triangles)[triangleIndex].vertices[1] = (pageIndex % 2) ? 0u : 1u;
+        (*triangles)[triangleIndex].vertices[2] = 1 + numFanTriangles + pageIndex;
+        ++triangleIndex;
+    }
+
+    // The back face of a fan triangle
+    (*triangles)[triangleIndex].vertices[0] = (*triangles)[5].vertices[0];
+    (*triangles)[triangleIndex].vertices[1] = (*triangles)[5].vertices[2];
+    (*triangles)[triangleIndex].vertices[2] = (*triangles)[5].vertices[1];
+    ++triangleIndex;
+
+    // Initialize triangle flags, disabling some of the triangles
+    TriangleFlagsList * triangleFlags = TriangleFlagsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangleFlags, ("TriangleFlagList should have been allocated"));
+    triangleFlags->resize(numTriangles);
+    for (triangleIndex = 0 ; triangleIndex < numTriangles ; ++triangleIndex)
+    {
+        (*triangleFlags)[triangleIndex].enabled = (triangleIndex % 11) != 7;
+    }
+
+    // Find the neighbors using the vertex triangle map
+    TriangleNeighborsList * expectedNeighbors = TriangleNeighborsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(expectedNeighbors, ("TriangleNeighborList should have been allocated"));
+    expectedNeighbors->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleNeighbors(*expectedNeighbors);
+
+    TriangleEdgeCosinesList * expectedEdgeCosines = TriangleEdgeCosinesList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(expectedEdgeCosines, ("TriangleEdgeCosineList should have been allocated"));
+    expectedEdgeCosines->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleEdgeCosines(*expectedEdgeCosines);
+
+    VertexTriangleMap vertexTriangleMap;
+    vertexTriangleMap.Initialize(numTriangles, m_allocator);
+    TriangleNeighborFinder::InitializeVertexTriangleMap(vertexTriangleMap, *triangles);
+
+    TriangleNeighborFinder::FindTriangleNeighbors(
+        *triangles,
+        *expectedEdgeCosines,
+        *expectedNeighbors,
+        *triangleFlags,
+        *vertices,
+        vertexTriangleMap);
+
+    // Find the neighbors by sorting edges
+    TriangleNeighborsList * triangleNeighbors = TriangleNeighborsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangleNeighbors, ("TriangleNeighborList should have been allocated"));
+    triangleNeighbors->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleNeighbors(*triangleNeighbors);
+
+    TriangleEdgeCosinesList * triangleEdgeCosines = TriangleEdgeCosinesList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangleEdgeCosines, ("TriangleEdgeCosineList should have been allocated"));
+    triangleEdgeCosines->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleEdgeCosines(*triangleEdgeCosines);
+
+    const bool found = TriangleNeighborFinder::FindTriangleNeighborsByEdgeSort(
+        *triangles,
+        *triangleEdgeCosines,
+        *triangleNeighbors,
+        *triangleFlags,
+        *vertices,
+        m_allocator);
+    EATESTAssert(found, ("FindTriangleNeighborsByEdgeSort should have allocated its temporary data"));
+
+    // Check every triangle edge
+    uint32_t numMatchedEdges = 0;
+    for (triangleIndex = 0 ; triangleIndex < numTriangles ; ++triangleIndex)
+    {
+        for (uint32_t edgeIndex = 0 ; edgeIndex < 3 ; ++edgeIndex)
+        {
+            EATESTAssert((*triangleNeighbors)[triangleIndex].neighbor[edgeIndex] == (*expectedNeighbors)[triangleIndex].neighbor[edgeIndex], ("Triangle Neighbor index is incorrect"));
+            EATESTAssert((*triangleEdgeCosines)[triangleIndex].edgeCos[edgeIndex] == (*expectedEdgeCosines)[triangleIndex].edgeCos[edgeIndex], ("Triangle edge cosine is incorrect"));
+
+            if ((*expectedNeighbors)[triangleIndex].neighbor[edgeIndex] != CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
+            {
+                ++numMatchedEdges;
+            }
+        }
+    }
+    EATESTAssert(numMatchedEdges > numFanTriangles, ("Fan triangles should have been matched"));
+
+    vertexTriangleMap.Release();
+    TriangleEdgeCosinesList::Free(m_allocator, triangleEdgeCosines);
+    TriangleNeighborsList::Free(m_allocator, triangleNeighbors);
+    TriangleEdgeCosinesList::Free(m_allocator, expectedEdgeCosines);
+    TriangleNeighborsList::Free(m_allocator, expectedNeighbors);
+    TriangleFlagsList::Free(m_allocator, triangleFlags);
+    TriangleList::Free(m_allocator, triangles);
+    VertexList::Free(m_allocator, vertices);
+}
+
+
+/**
+Tests that mating the sorted edges in parallel gives exactly the same neighbors and edge cosines as walking the
+vertex triangle map. The mesh is a bumpy grid with enough edges for several ranges, whose runs of coincident
+edges straddle the range boundaries, and the ranges are run in reverse order.
+*/
+void
+TestTriangleNeighborFinder::TestFindTriangleNeighborsByEdgeSortParallel()
+{
+    const uint32_t gridSize = 48;
+    const uint32_t rowSize = gridSize + 1;
+    const uint32_t numVertices = rowSize * rowSize;
+    const uint32_t numTriangles = 2 * gridSize * gridSize;
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices, ("VertexList should have been allocated"));
+    vertices->resize(numVertices);
+    for (uint32_t z = 0 ; z < rowSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < rowSize ; ++x)
+        {
+            const float height = static_cast<float>((x * 7 + z * 13) % 5) * 0.1f;
+            (*vertices)[z * rowSize + x] = meshbuilder::VectorType(static_cast<float>(x), height, static_cast<float>(z));
+        }
+    }
+
+    TriangleList * triangles = TriangleList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangles, ("TriangleList should have been allocated"));
+    triangles->resize(numTriangles);
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t z = 0 ; z < gridSize ; ++z)
+    {
+        for (uint32_t x = 0 ; x < gridSize ; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            (*triangles)[triangleIndex].vertices[0] = v0;
+            (*triangles)[triangleIndex].vertices[1] = v0 + rowSize;
+            (*triangles)[triangleIndex].vertices[2] = v0 + 1;
+            ++triangleIndex;
+            (*triangles)[triangleIndex].vertices[0] = v0 + 1;
+            (*triangles)[triangleIndex].vertices[1] = v0 + rowSize;
+            (*triangles)[triangleIndex].vertices[2] = v0 + rowSize + 1;
+            ++triangleIndex;
+        }
+    }
+
+    TriangleFlagsList * triangleFlags = TriangleFlagsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangleFlags, ("TriangleFlagList should have been allocated"));
+    triangleFlags->resize(numTriangles);
+    for (triangleIndex = 0 ; triangleIndex < numTriangles ; ++triangleIndex)
+    {
+        (*triangleFlags)[triangleIndex].enabled = (triangleIndex % 97) != 41;
+    }
+
+    // Find the neighbors using the vertex triangle map
+    TriangleNeighborsList * expectedNeighbors = TriangleNeighborsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(expectedNeighbors, ("TriangleNeighborList should have been allocated"));
+    expectedNeighbors->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleNeighbors(*expectedNeighbors);
+
+    TriangleEdgeCosinesList * expectedEdgeCosines = TriangleEdgeCosinesList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(expectedEdgeCosines, ("TriangleEdgeCosineList should have been allocated"));
+    expectedEdgeCosines->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleEdgeCosines(*expectedEdgeCosines);
+
+    VertexTriangleMap vertexTriangleMap;
+    vertexTriangleMap.Initialize(numTriangles, m_allocator);
+    TriangleNeighborFinder::InitializeVertexTriangleMap(vertexTriangleMap, *triangles);
+
+    TriangleNeighborFinder::FindTriangleNeighbors(
+        *triangles,
+        *expectedEdgeCosines,
+        *expectedNeighbors,
+        *triangleFlags,
+        *vertices,
+        vertexTriangleMap);
+
+    // Find the neighbors by sorting edges, mating the runs in parallel ranges
+    TriangleNeighborsList * triangleNeighbors = TriangleNeighborsList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangleNeighbors, ("TriangleNeighborList should have been allocated"));
+    triangleNeighbors->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleNeighbors(*triangleNeighbors);
+
+    TriangleEdgeCosinesList * triangleEdgeCosines = TriangleEdgeCosinesList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangleEdgeCosines, ("TriangleEdgeCosineList should have been allocated"));
+    triangleEdgeCosines->resize(numTriangles);
+    TriangleNeighborFinder::InitializeTriangleEdgeCosines(*triangleEdgeCosines);
+
+    ReverseDispatcher dispatcher;
+    const bool found = TriangleNeighborFinder::FindTriangleNeighborsByEdgeSort(
+        *triangles,
+        *triangleEdgeCosines,
+        *triangleNeighbors,
+        *triangleFlags,
+        *vertices,
+        m_allocator,
+        &dispatcher);
+    EATESTAssert(found, ("FindTriangleNeighborsByEdgeSort should have allocated its temporary data"));
+
+    // Check every triangle edge
+    uint32_t numMatchedEdges = 0;
+    for (triangleIndex = 0 ; triangleIndex < numTriangles ; ++triangleIndex)
+    {
+        for (uint32_t edgeIndex = 0 ; edgeIndex < 3 ; ++edgeIndex)
+        {
+            EATESTAssert((*triangleNeighbors)[triangleIndex].neighbor[edgeIndex] == (*expectedNeighbors)[triangleIndex].neighbor[edgeIndex], ("Triangle Neighbor index is incorrect"));
+            EATESTAssert((*triangleEdgeCosines)[triangleIndex].edgeCos[edgeIndex] == (*expectedEdgeCosines)[triangleIndex].edgeCos[edgeIndex], ("Triangle edge cosine is incorrect"));
+
+            if ((*expectedNeighbors)[triangleIndex].neighbor[edgeIndex] != CLUSTEREDMESHBUILDER_TRIANGLENEIGHBORINDEX_NOMATCH)
+            {
+                ++numMatchedEdges;
+            }
+        }
+    }
+    EATESTAssert(numMatchedEdges > numTriangles, ("Grid triangles should have been matched"));
+
+    vertexTriangleMap.Release();
+    TriangleEdgeCosinesList::Free(m_allocator, triangleEdgeCosines);
+    TriangleNeighborsList::Free(m_allocator, triangleNeighbors);
+    TriangleEdgeCosinesList::Free(m_allocator, expectedEdgeCosines);
+    TriangleNeighborsList::Free(m_allocator, expectedNeighbors);
+    TriangleFlagsList::Free(m_allocator, triangleFlags);
+    TriangleList::Free(m_allocator, triangles);
+    VertexList::Free(m_allocator, vertices);
+}
@@ -40,6 +40,8 @@ public:
         EATEST_REGISTER("TestAddUnitsToUnitClusterOverflowQuad", "Adding a single triangle unit to an empty cluster", TestUnitClusterBuilder, TestAddUnitsToUnitClusterOverflowQuad);
 
         EATEST_REGISTER("TestAddUnitsToUnitClusterAddMiddleUnit", "Adding a single triangle unit from the middle of a list", TestUnitClusterBuilder, TestAddUnitsToUnitClusterAddMiddleUnit);
+
+        EATEST_REGISTER("TestAssignVertexCodesInUnitOrder", "Numbering the cluster vertices in the order the units use them", TestUnitClusterBuilder, TestAssignVertexCodesInUnitOrder);
     }
 
     virtual void SetupSuite()
@@ -65,6 +67,8 @@ private:
 
     void TestAddUnitsToUnitClusterAddMiddleUnit();
 
+    void TestAssignVertexCodesInUnitOrder();
+
     static const uint32_t m_maxVerticesPerTriangle = 3u;
     static const uint32_t m_maxVerticesPerQuad = 4u;
 
@@ -1032,3 +1036,69 @@ TestUnitClusterBuilder::TestAddUnitsToUnitClusterAddMiddleUnit()
     m_allocator->Free(triangleList);
     unitClusterStack.Release();
 }
+
+
+/**
+Numbering the cluster vertices in the order the units use them, with the units out of unit ID order.
+*/
+void
+TestUnitClusterBuilder::TestAssignVertexCodesInUnitOrder()
+{
+    // The total number of units
+    const uint32_t unitCount = 2u;
+
+    // Create a UnitClusterStack
+    UnitClusterStack unitClusterStack;
+    unitClusterStack.Initialize(EA::Allocator::ICoreAllocator::GetDefaultAllocator(), unitCount);
+
+    UnitCluster * unitCluster = unitClusterStack.GetUnitCluster();
+
+    // Create two triangles sharing vertex 12
+    TriangleList * triangleList = TriangleList::Allocate(m_allocator, unitCount, EA::Allocator::MEM_PERM);
+    triangleList->resize(unitCount);
+    (*triangleList)[0].vertices[0] = 10u;
+    (*triangleList)[0].vertices[1] = 11u;
+    (*triangleList)[0].vertices[2] = 12u;
+    (*triangleList)[1].vertices[0] = 12u;
+    (*triangleList)[1].vertices[1] = 13u;
+    (*triangleList)[1].vertices[2] = 1u;
+
+    // Create a unit list containing 2 triangle units
+    UnitList * unitList = UnitList::Allocate(m_allocator, unitCount, EA::Allocator::MEM_PERM);
+    unitList->resize(unitCount);
+    for (uint32_t unitIndex = 0 ; unitIndex < unitCount ; ++unitIndex)
+    {
+        Unit & unit = (*unitList)[unitIndex];
+        unit.tri0 = unitIndex;
+        unit.tri1 = 0u; // NOT REQUIRED FOR THIS TEST
+        unit.type = Unit::TYPE_TRIANGLE;
+        unit.extraVertex = 0u;  // NOT REQUIRED FOR THIS TEST
+        unit.edgeOpposingExtraVertex = 0u;  // NOT REQUIRED FOR THIS TEST
+    }
+
+    // Add the second unit before the first
+    UnitClusterBuilder::AddUnitToCluster(unitCluster->vertexIDs, unitCluster->numVertices, unitCluster->unitIDs, unitCluster->numUnits,
+        1, *triangleList, *unitList, m_maxVerticesPerTriangle);
+    UnitClusterBuilder::AddUnitToCluster(unitCluster->vertexIDs, unitCluster->numVertices, unitCluster->unitIDs, unitCluster->numUnits,
+        0, *triangleList, *unitList, m_maxVerticesPerTriangle);
+    UnitCluster::SortAndCompressVertexSet(unitCluster->vertexIDs, unitCluster->numVertices);
+
+    EATESTAssert(unitCluster->numVertices == 5, "UnitCluster should contain 5 vertices");
+    EATESTAssert(unitCluster->GetVertexCode(1) == 0, "Vertex codes should follow the vertex set order before assignment");
+
+    UnitClusterBuilder::AssignVertexCodesInUnitOrder(*unitCluster, *triangleList, *unitList);
+
+    // Check the vertex set is unchanged, and the codes follow the units
+    EATESTAssert(unitCluster->vertexIDs[0] == 1, "The vertex set should remain sorted");
+    EATESTAssert(unitCluster->vertexIDs[4] == 13, "The vertex set should remain sorted");
+    EATESTAssert(unitCluster->GetVertexCode(12) == 0, "Vertex 12 should be the first vertex of the first unit");
+    EATESTAssert(unitCluster->GetVertexCode(13) == 1, "Vertex 13 should be the second vertex of the first unit");
+    EATESTAssert(unitCluster->GetVertexCode(1) == 2, "Vertex 1 should be the third vertex of the first unit");
+    EATESTAssert(unitCluster->GetVertexCode(10) == 3, "Vertex 10 should be the first new vertex of the second unit");
+    EATESTAssert(unitCluster->GetVertexCode(11) == 4, "Vertex 11 should be the second new vertex of the second unit");
+
+    // Release resources
+    m_allocator->Free(unitList);
+    m_allocator->Free(triangleList);
+    unitClusterStack.Release();
+}
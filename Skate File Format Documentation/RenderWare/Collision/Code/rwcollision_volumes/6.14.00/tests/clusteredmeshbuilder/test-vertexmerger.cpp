@@ -0,0 +1,415 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+
+#include <rw/collision/meshbuilder/vertexmerger.h>
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
+#include <rw/collision/meshbuilder/detail/types.h>
+#include <rw/collision/meshbuilder/common.h>
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+// Unit tests for the vertex merger
+
+using namespace rw::collision::meshbuilder::detail;
+using namespace rw::collision::meshbuilder;
+using namespace rw::collision;
+
+namespace
+{
+
+/**
+Dispatcher which runs the ranges of each stage on the calling thread in reverse order, cycling through
+the worker indices, to check that the result does not depend on the order in which ranges are run.
+*/
+class ReverseOrderDispatcher : public IParallelDispatcher
+{
+public:
+
+    virtual uint32_t GetNumWorkers() const
+    {
+        return 4u;
+    }
+
+    virtual void ParallelFor(RangeFunction function, void *context, uint32_t count, uint32_t grainSize)
+    {
+        const uint32_t numRanges = GetNumRanges(count, grainSize);
+        for (uint32_t rangeIndex = numRanges; rangeIndex-- > 0; )
+        {
+            const uint32_t begin = rangeIndex * grainSize;
+            const uint32_t end = (count - begin > grainSize) ? (begin + grainSize) : count;
+            function(context, rangeIndex % GetNumWorkers(), begin, end);
+        }
+    }
+};
+
+/**
+Returns a pseudo random float in [0, 1) from a fixed sequence, so the tests are repeatable.
+*/
+float NextRandom(uint32_t &seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+}
+
+}
+
+class TestVertexMerger : public tests::TestSuiteBase
+{
+public:
+
+    virtual void Initialize()
+    {
+        SuiteName("TestVertexMerger");
+
+        EATEST_REGISTER("TestMergeCoincidentVertices", "Testing merging of coincident vertices", TestVertexMerger, TestMergeCoincidentVertices);
+        EATEST_REGISTER("TestMergeScatteredVertices", "Testing merging of scattered vertices", TestVertexMerger, TestMergeScatteredVertices);
+        EATEST_REGISTER("TestMergeNearCellBoundaries", "Testing merging of vertices whose search range spans three cells", TestVertexMerger, TestMergeNearCellBoundaries);
+        EATEST_REGISTER("TestMergeLargeExtent", "Testing merging of vertices spread over a large extent", TestVertexMerger, TestMergeLargeExtent);
+        EATEST_REGISTER("TestMergeWithDispatcher", "Testing merging with a parallel dispatcher", TestVertexMerger, TestMergeWithDispatcher);
+        EATEST_REGISTER("TestUpdateTriangleVertexIndices", "Testing UpdateTriangleVertexIndices", TestVertexMerger, TestUpdateTriangleVertexIndices);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        m_allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    }
+
+private:
+
+    void TestMergeCoincidentVertices();
+    void TestMergeScatteredVertices();
+    void TestMergeNearCellBoundaries();
+    void TestMergeLargeExtent();
+    void TestMergeWithDispatcher();
+    void TestUpdateTriangleVertexIndices();
+
+    IDList * MergeVertices(
+        const VertexList & vertices,
+        const float tolerance,
+        IParallelDispatcher * dispatcher = NULL);
+
+    void CheckVertexGroups(
+        const IDList & vertexGroup,
+        const VertexList & vertices,
+        const float tolerance);
+
+    EA::Allocator::ICoreAllocator * m_allocator;
+
+} TestVertexMergerSingleton;
+
+
+/**
+Merges the vertices, returning the vertex groups, which should be freed by the caller.
+*/
+IDList *
+TestVertexMerger::MergeVertices(
+    const VertexList & vertices,
+    const float tolerance,
+    IParallelDispatcher * dispatcher)
+{
+    const uint32_t numVertices = vertices.size();
+
+    VertexMerger::AABBoxType aabbox(
+        VertexMerger::AABBoxType::Vector3Type(vertices[0]),
+        VertexMerger::AABBoxType::Vector3Type(vertices[0]));
+    for (uint32_t vertexIndex = 1 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        aabbox.Set(Min(aabbox.Min(), VertexMerger::AABBoxType::Vector3Type(vertices[vertexIndex])),
+                   Max(aabbox.Max(), VertexMerger::AABBoxType::Vector3Type(vertices[vertexIndex])));
+    }
+
+    IDList * vertexGroup = IDList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertexGroup, ("IDList should have been allocated"));
+    vertexGroup->resize(numVertices);
+    for (uint32_t vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        (*vertexGroup)[vertexIndex] = vertexIndex;
+    }
+
+    const bool merged = VertexMerger::MergeVertexGroups(
+        *vertexGroup,
+        *m_allocator,
+        aabbox,
+        rwpmath::VecFloat(tolerance),
+        vertices,
+        dispatcher);
+    EATESTAssert(merged, ("MergeVertexGroups should have allocated its temporary data"));
+
+    return vertexGroup;
+}
+
+
+/**
+Checks by brute force that each vertex is merged to the lowest indexed remaining vertex within tolerance of it.
+*/
+void
+TestVertexMerger::CheckVertexGroups(
+    const IDList & vertexGroup,
+    const VertexList & vertices,
+    const float tolerance)
+{
+    const uint32_t numVertices = vertices.size();
+    const rwpmath::VecFloat toleranceSquared(tolerance * tolerance);
+
+    for (uint32_t vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        uint32_t expectedIndex = vertexIndex;
+        for (uint32_t lowerIndex = 0 ; lowerIndex < vertexIndex ; ++lowerIndex)
+        {
+            if (vertexGroup[lowerIndex] == lowerIndex &&
+                rwpmath::MagnitudeSquared(rwpmath::Vector3(vertices[vertexIndex] - vertices[lowerIndex])) < toleranceSquared)
+            {
+                expectedIndex = lowerIndex;
+                break;
+            }
+        }
+
+        EATESTAssert(vertexGroup[vertexIndex] == expectedIndex, ("Vertex should be merged to the lowest remaining vertex within tolerance"));
+    }
+}
+
+
+/**
+Tests that exact duplicates, in a shuffled order, are merged to the lowest index at each position
+*/
+void
+TestVertexMerger::TestMergeCoincidentVertices()
+{
+    const uint32_t numPositions = 256u;
+    const uint32_t numDuplicates = 6u;
+    const uint32_t numVertices = numPositions * numDuplicates;
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices, ("VertexList should have been allocated"));
+    vertices->resize(numVertices);
+
+    // Positions on a unit grid, visited in a stride so duplicates are spread through the vertex list
+    for (uint32_t vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        const uint32_t position = (vertexIndex * 97u) % numPositions;
+        (*vertices)[vertexIndex] = VectorType(
+            static_cast<float>(position % 16u),
+            0.0f,
+            static_cast<float>(position / 16u));
+    }
+
+    IDList * vertexGroup = MergeVertices(*vertices, 0.1f);
+
+    uint32_t numRemaining = 0;
+    for (uint32_t vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        // The lowest index at each position is the first in the stride
+        const uint32_t groupIndex = (*vertexGroup)[vertexIndex];
+        EATESTAssert(groupIndex <= vertexIndex, ("Vertex should be merged to a lower index"));
+        EATESTAssert(groupIndex == vertexIndex % numPositions, ("Vertex should be merged to the first vertex at its position"));
+
+        if (groupIndex == vertexIndex)
+        {
+            ++numRemaining;
+        }
+    }
+    EATESTAssert(numRemaining == numPositions, ("One vertex should remain at each position"));
+
+    CheckVertexGroups(*vertexGroup, *vertices, 0.1f);
+
+    IDList::Free(m_allocator, vertexGroup);
+    VertexList::Free(m_allocator, vertices);
+}
+
+
+/**
+Tests merging of randomly scattered vertices, many of which are within tolerance of several others
+*/
+void
+TestVertexMerger::TestMergeScatteredVertices()
+{
+    const uint32_t numVertices = 1024u;
+    const float tolerance = 0.25f;
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices, ("VertexList should have been allocated"));
+    vertices->resize(numVertices);
+
+    uint32_t seed = 12345u;
+    for (uint32_t vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        const float x = NextRandom(seed) * 4.0f;
+        const float y = NextRandom(seed) * 4.0f;
+        const float z = NextRandom(seed) * 4.0f;
+        (*vertices)[vertexIndex] = VectorType(x, y, z);
+    }
+
+    IDList * vertexGroup = MergeVertices(*vertices, tolerance);
+
+    CheckVertexGroups(*vertexGroup, *vertices, tolerance);
+
+    IDList::Free(m_allocator, vertexGroup);
+    VertexList::Free(m_allocator, vertices);
+}
+
+
+/**
+Tests merging of vertices placed on and around the cell boundaries and cell centres, where the search range
+of a vertex spans three cells along an axis
+*/
+void
+TestVertexMerger::TestMergeNearCellBoundaries()
+{
+    const uint32_t numVertices = 2048u;
+    const float tolerance = 0.5f;
+
+    // Offsets from the half cell positions, either side of the search distance of 1.01 times the tolerance
+    const float offsets[7] = { -0.006f, -0.005f, -0.004f, 0.0f, 0.004f, 0.005f, 0.006f };
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices, ("VertexList should have been allocated"));
+    vertices->resize(numVertices);
+
+    // The first vertex fixes the bbox minimum, so with a cell size of twice the tolerance the cell
+    // boundaries are at whole numbers and the cell centres at the halves
+    (*vertices)[0] = VectorType(-1.0f, -1.0f, -1.0f);
+
+    uint32_t seed = 24680u;
+    for (uint32_t vertexIndex = 1 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        float coordinates[3];
+        for (uint32_t axis = 0 ; axis < 3u ; ++axis)
+        {
+            const float halfCell = 0.5f * static_cast<float>(static_cast<uint32_t>(NextRandom(seed) * 8.0f));
+            coordinates[axis] = halfCell + offsets[static_cast<uint32_t>(NextRandom(seed) * 7.0f)];
+        }
+        (*vertices)[vertexIndex] = VectorType(coordinates[0], coordinates[1], coordinates[2]);
+    }
+
+    IDList * vertexGroup = MergeVertices(*vertices, tolerance);
+
+    CheckVertexGroups(*vertexGroup, *vertices, tolerance);
+
+    IDList::Free(m_allocator, vertexGroup);
+    VertexList::Free(m_allocator, vertices);
+}
+
+
+/**
+Tests merging of pairs of nearby vertices spread over an extent too large for a cell size of the tolerance
+*/
+void
+TestVertexMerger::TestMergeLargeExtent()
+{
+    const uint32_t numPairs = 512u;
+    const uint32_t numVertices = numPairs * 2u;
+    const float tolerance = 0.1f;
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices, ("VertexList should have been allocated"));
+    vertices->resize(numVertices);
+
+    uint32_t seed = 54321u;
+    for (uint32_t pairIndex = 0 ; pairIndex < numPairs ; ++pairIndex)
+    {
+        const float x = (NextRandom(seed) - 0.5f) * 4000000.0f;
+        const float y = (NextRandom(seed) - 0.5f) * 100.0f;
+        const float z = (NextRandom(seed) - 0.5f) * 4000000.0f;
+        (*vertices)[pairIndex] = VectorType(x, y, z);
+        (*vertices)[numPairs + pairIndex] = VectorType(x, y, z);
+    }
+
+    IDList * vertexGroup = MergeVertices(*vertices, tolerance);
+
+    for (uint32_t pairIndex = 0 ; pairIndex < numPairs ; ++pairIndex)
+    {
+        EATESTAssert((*vertexGroup)[pairIndex] == pairIndex, ("First vertex of each pair should remain"));
+        EATESTAssert((*vertexGroup)[numPairs + pairIndex] == pairIndex, ("Second vertex of each pair should be merged to the first"));
+    }
+
+    IDList::Free(m_allocator, vertexGroup);
+    VertexList::Free(m_allocator, vertices);
+}
+
+
+/**
+Tests that merging with a parallel dispatcher gives the same result as merging without
+*/
+void
+TestVertexMerger::TestMergeWithDispatcher()
+{
+    const uint32_t numVertices = 20000u;
+    const float tolerance = 0.05f;
+
+    VertexList * vertices = VertexList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertices, ("VertexList should have been allocated"));
+    vertices->resize(numVertices);
+
+    // Vertices on a coarse grid, so many are coincident, with some jitter within the tolerance
+    uint32_t seed = 999u;
+    for (uint32_t vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        const float x = static_cast<float>(static_cast<uint32_t>(NextRandom(seed) * 32.0f)) * 0.1f;
+        const float y = NextRandom(seed) * 0.02f;
+        const float z = static_cast<float>(static_cast<uint32_t>(NextRandom(seed) * 32.0f)) * 0.1f;
+        (*vertices)[vertexIndex] = VectorType(x, y, z);
+    }
+
+    IDList * serialVertexGroup = MergeVertices(*vertices, tolerance);
+
+    ReverseOrderDispatcher dispatcher;
+    IDList * parallelVertexGroup = MergeVertices(*vertices, tolerance, &dispatcher);
+
+    for (uint32_t vertexIndex = 0 ; vertexIndex < numVertices ; ++vertexIndex)
+    {
+        EATESTAssert((*serialVertexGroup)[vertexIndex] == (*parallelVertexGroup)[vertexIndex], ("Vertex groups should not depend on the dispatcher"));
+    }
+
+    IDList::Free(m_allocator, parallelVertexGroup);
+    IDList::Free(m_allocator, serialVertexGroup);
+    VertexList::Free(m_allocator, vertices);
+}
+
+
+/**
+Tests that triangle vertex indices are replaced by their vertex groups
+*/
+void
+TestVertexMerger::TestUpdateTriangleVertexIndices()
+{
+    const uint32_t numVertices = 6u;
+    const uint32_t numTriangles = 2u;
+
+    IDList * vertexGroup = IDList::Allocate(m_allocator, numVertices, EA::Allocator::MEM_PERM);
+    EATESTAssert(vertexGroup, ("IDList should have been allocated"));
+    vertexGroup->resize(numVertices);
+    (*vertexGroup)[0] = 0;
+    (*vertexGroup)[1] = 1;
+    (*vertexGroup)[2] = 2;
+    (*vertexGroup)[3] = 1;
+    (*vertexGroup)[4] = 0;
+    (*vertexGroup)[5] = 5;
+
+    TriangleList * triangles = TriangleList::Allocate(m_allocator, numTriangles, EA::Allocator::MEM_PERM);
+    EATESTAssert(triangles, ("TriangleList should have been allocated"));
+    triangles->resize(numTriangles);
+    (*triangles)[0].vertices[0] = 0;
+    (*triangles)[0].vertices[1] = 1;
+    (*triangles)[0].vertices[2] = 2;
+    (*triangles)[1].vertices[0] = 3;
+    (*triangles)[1].vertices[1] = 4;
+    (*triangles)[1].vertices[2] = 5;
+
+    VertexMerger::UpdateTriangleVertexIndices(*triangles, *vertexGroup);
+
+    EATESTAssert((*triangles)[0].vertices[0] == 0, ("Triangle vertex index is incorrect"));
+    EATESTAssert((*triangles)[0].vertices[1] == 1, ("Triangle vertex index is incorrect"));
+    EATESTAssert((*triangles)[0].vertices[2] == 2, ("Triangle vertex index is incorrect"));
+    EATESTAssert((*triangles)[1].vertices[0] == 1, ("Triangle vertex index is incorrect"));
+    EATESTAssert((*triangles)[1].vertices[1] == 0, ("Triangle vertex index is incorrect"));
+    EATESTAssert((*triangles)[1].vertices[2] == 5, ("Triangle vertex index is incorrect"));
+
+    TriangleList::Free(m_allocator, triangles);
+    IDList::Free(m_allocator, vertexGroup);
+}
@@ -9,13 +9,19 @@ Purpose: unit tests to benchmark extraction of triangles from compressed cluster
 
 #include "benchmark-cluster.h"
 
+#if !defined(EA_PLATFORM_PS3_SPU)
+#include <rw/collision/clusterunitwalker.h>
+#include <rw/collision/meshbuilder/vertexcompression.h>
+#include <string.h>     // for memcpy()
+#endif // !defined(EA_PLATFORM_PS3_SPU)
+
 namespace rw
 {
     namespace collision
     {
         namespace Tests
         {
-            ClusterBenchmark gClusterBenchmarkCompressed("BenchmarkClusterCompressed", "benchmark-cluster-compressed.elf", 
+            ClusterBenchmark gClusterBenchmarkCompressed("BenchmarkClusterCompressed", "benchmark-cluster-compressed.elf",
                 rw::collision::ClusteredMeshCluster::VERTICES_16BIT_COMPRESSED, false, true);
 
 #ifdef  EA_PLATFORM_PS3_SPU
@@ -23,6 +29,261 @@ namespace rw
             EA_ALIGNED(uint8_t, ClusterBenchmark::sResultsBuffer[ClusterBenchmark::RESULTS_SIZE], 16);
 #endif
 
+#if !defined(EA_PLATFORM_PS3_SPU)
+            /// Benchmarks of the compressed mesh with its clusters re-encoded using 8-bit and 10-bit vertex compression
+            /// where they fit, reporting the memory used by all clusters and the time to decode all their triangles.
+            class AdaptiveCompressionBenchmark : public ClusteredMeshTestBase
+            {
+            public:
+
+                AdaptiveCompressionBenchmark()
+                {
+                    sprintf(mMeshFilename, UNITTEST_DATA_FILE("skatemesh_compressed.dat"));
+                }
+
+            protected:
+
+                virtual const char * GetSuiteName() const
+                {
+                    return "BenchmarkClusterAdaptiveCompression";
+                }
+                virtual const char * GetMeshFileName() const
+                {
+                    return mMeshFilename;
+                }
+
+                virtual void Initialize()
+                {
+                    EATEST_REGISTER("TestAdaptiveClusterSize", "benchmark size of clusters with adaptive compression", AdaptiveCompressionBenchmark, TestAdaptiveClusterSize);
+                    EATEST_REGISTER("TestAdaptiveDecode", "benchmark decoding all triangles with adaptive compression", AdaptiveCompressionBenchmark, TestAdaptiveDecode);
+
+                    ClusteredMeshTestBase::Initialize();
+                }
+
+                typedef rw::collision::GenericClusterUnit<rw::collision::ClusteredMeshCluster::COMPRESSION_DYNAMIC> GenericUnit;
+
+            private:
+
+                static const uint32_t NUM_MODES = 5;
+
+                /// Re-encodes every cluster of the mesh with the smallest compression mode allowed by the error bound.
+                /// Returns an array of clusters to be freed with FreeClusters.
+                rw::collision::ClusteredMeshCluster ** ReencodeClusters(const float maxError, uint32_t modeCounts[NUM_MODES])
+                {
+                    const float granularity = mMesh->GetVertexCompressionGranularity();
+                    const uint32_t maxGranularityShift =
+                        rw::collision::meshbuilder::VertexCompression::CalculateMaximumGranularityShift(granularity, maxError);
+                    const uint32_t numClusters = mMesh->GetNumCluster();
+
+                    EA::Allocator::ICoreAllocator * allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+                    rw::collision::ClusteredMeshCluster ** clusters = static_cast<rw::collision::ClusteredMeshCluster **>(
+                        allocator->Alloc(sizeof(rw::collision::ClusteredMeshCluster *) * numClusters, NULL, 0));
+
+                    memset(modeCounts, 0, sizeof(uint32_t) * NUM_MODES);
+
+                    for (uint32_t c = 0; c < numClusters; ++c)
+                    {
+                        const rw::collision::ClusteredMeshCluster & source = mMesh->GetCluster(c);
+                        EATESTAssert(0 == source.normalCount, "Clusters should have no normals");
+
+                        // Integer extents of the cluster vertices, as found by the builder
+                        int32_t minimum[3] = { 0, 0, 0 };
+                        int32_t maximum[3] = { 0, 0, 0 };
+                        for (uint8_t i = 0; i < source.vertexCount; ++i)
+                        {
+                            const rwpmath::Vector3 v = source.GetVertex(i, granularity);
+                            const int32_t integer[3] = { (int32_t)(v.GetX() / granularity), (int32_t)(v.GetY() / granularity), (int32_t)(v.GetZ() / granularity) };
+                            for (uint32_t k = 0; k < 3; ++k)
+                            {
+                                minimum[k] = (i == 0 || integer[k] < minimum[k]) ? integer[k] : minimum[k];
+                                maximum[k] = (i == 0 || integer[k] > maximum[k]) ? integer[k] : maximum[k];
+                            }
+                        }
+
+                        uint8_t compressionMode = 0;
+                        uint32_t granularityShift = 0;
+                        rw::collision::ClusteredMeshCluster::Vertex32 offset;
+                        rw::collision::meshbuilder::VertexCompression::DetermineAdaptiveCompressionModeAndOffsetForRange(
+                            compressionMode, offset, granularityShift,
+                            minimum[0], maximum[0],
+                            minimum[1], maximum[1],
+                            minimum[2], maximum[2],
+                            maxGranularityShift);
+                        ++modeCounts[compressionMode];
+
+                        rw::collision::ClusterConstructionParameters parameters;
+                        parameters.mVertexCount = source.vertexCount;
+                        parameters.mVertexCompressionMode = compressionMode;
+                        const uint32_t size = rw::collision::ClusteredMeshCluster::GetSize(parameters) + source.unitDataSize;
+
+                        void * buffer = allocator->Alloc(size, NULL, 0, rwcCLUSTEREDMESHCLUSTER_ALIGNMENT);
+                        rw::collision::ClusteredMeshCluster * cluster = rw::collision::ClusteredMeshCluster::Initialize(buffer, parameters);
+
+                        cluster->SetVertexOffset(offset, granularityShift);
+                        for (uint8_t i = 0; i < source.vertexCount; ++i)
+                        {
+                            cluster->SetVertex(source.GetVertex(i, granularity), granularity);
+                        }
+
+                        // The units are unchanged by the vertex compression
+                        memcpy(reinterpret_cast<uint8_t *>(cluster->vertexArray) + cluster->unitDataStart * 16,
+                               reinterpret_cast<const uint8_t *>(source.vertexArray) + source.unitDataStart * 16,
+                               source.unitDataSize);
+                        cluster->unitCount = source.unitCount;
+                        cluster->unitDataSize = source.unitDataSize;
+                        cluster->totalSize = static_cast<uint16_t>(size);
+
+                        clusters[c] = cluster;
+                    }
+
+                    return clusters;
+                }
+
+                void FreeClusters(rw::collision::ClusteredMeshCluster ** clusters)
+                {
+                    EA::Allocator::ICoreAllocator * allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+                    for (uint32_t c = 0; c < mMesh->GetNumCluster(); ++c)
+                    {
+                        allocator->Free(clusters[c]);
+                    }
+                    allocator->Free(clusters);
+                }
+
+                /// Benchmark the total size of the clusters, lossless and with an error of up to four granules
+                void TestAdaptiveClusterSize()
+                {
+                    const float granularity = mMesh->GetVertexCompressionGranularity();
+
+                    uint32_t originalSize = 0;
+                    for (uint32_t c = 0; c < mMesh->GetNumCluster(); ++c)
+                    {
+                        originalSize += mMesh->GetClusterSize(mMesh->GetCluster(c));
+                    }
+
+                    char str[256];
+                    sprintf(str, "mesh:%s,name:TotalSize,method:original,description:Kb to store all clusters", mMeshFilename);
+                    EATESTSendBenchmark(str, (double) originalSize / 1024.0);
+
+                    const float maxErrors[2] = { 0.0f, 4.0f * granularity };
+                    const char * methodNames[2] = { "adaptive lossless", "adaptive 4 granules" };
+                    for (uint32_t method = 0; method < 2; ++method)
+                    {
+                        uint32_t modeCounts[NUM_MODES];
+                        rw::collision::ClusteredMeshCluster ** clusters = ReencodeClusters(maxErrors[method], modeCounts);
+
+                        uint32_t adaptiveSize = 0;
+                        float largestError = 0.0f;
+                        for (uint32_t c = 0; c < mMesh->GetNumCluster(); ++c)
+                        {
+                            const rw::collision::ClusteredMeshCluster & source = mMesh->GetCluster(c);
+                            adaptiveSize += mMesh->GetClusterSize(*clusters[c]);
+
+                            for (uint8_t i = 0; i < source.vertexCount; ++i)
+                            {
+                                const rwpmath::Vector3 error = rwpmath::Abs(clusters[c]->GetVertex(i, granularity) - source.GetVertex(i, granularity));
+                                const float e = static_cast<float>(rwpmath::Max(rwpmath::Max(error.GetX(), error.GetY()), error.GetZ()));
+                                largestError = (e > largestError) ? e : largestError;
+                            }
+                        }
+
+                        // Allow for the truncation of the source vertices to the mesh granularity
+                        EATESTAssert(largestError <= maxErrors[method] + 2.0f * granularity, "Re-encoded vertices should be within the error bound");
+
+                        sprintf(str, "mesh:%s,name:TotalSize,method:%s,description:Kb to store all clusters with %u 8-bit %u 10-bit %u 16-bit %u 32-bit clusters",
+                            mMeshFilename, methodNames[method],
+                            modeCounts[rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED],
+                            modeCounts[rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED],
+                            modeCounts[rw::collision::ClusteredMeshCluster::VERTICES_16BIT_COMPRESSED],
+                            modeCounts[rw::collision::ClusteredMeshCluster::VERTICES_32BIT_COMPRESSED]);
+                        EATESTSendBenchmark(str, (double) adaptiveSize / 1024.0);
+
+                        FreeClusters(clusters);
+                    }
+                }
+
+                /// Decode every triangle of a set of clusters with the generic unit
+                void DecodeClusters(rw::collision::ClusteredMeshCluster * const * clusters, const char * parameters)
+                {
+                    const rw::collision::ClusterParams & clusterParams = mMesh->GetClusterParams();
+
+                    rwpmath::Vector3 min = GetVector3_Large();
+                    rwpmath::Vector3 max = -min;
+                    uint32_t numTriangles = 0;
+
+                    BenchmarkTimer timer;
+                    for (uint32_t iteration = 0; iteration < mNumIterations; ++iteration)
+                    {
+                        min = GetVector3_Large();
+                        max = -min;
+                        numTriangles = 0;
+
+                        timer.Start();
+                        for (uint32_t c = 0; c < mMesh->GetNumCluster(); ++c)
+                        {
+                            const rw::collision::ClusteredMeshCluster & cluster = *clusters[c];
+                            GenericUnit unit(cluster, clusterParams);
+                            for (rw::collision::ClusterUnitWalker<GenericUnit> walker(unit, cluster.unitCount); !walker.AtEnd(); walker.Next())
+                            {
+                                for (uint32_t tri = 0; tri < unit.GetTriCount(); ++tri)
+                                {
+                                    rwpmath::Vector3 v0, v1, v2;
+                                    unit.GetTriVertices(v0, v1, v2, tri);
+                                    // Do something reasonable with the results - compute bbox of triangles
+                                    min = rwpmath::Min(min, rwpmath::Min(v0, rwpmath::Min(v1, v2)));
+                                    max = rwpmath::Max(max, rwpmath::Max(v0, rwpmath::Max(v1, v2)));
+                                    ++numTriangles;
+                                }
+                            }
+                        }
+                        timer.Stop();
+                    }
+
+                    char description[100];
+                    sprintf(description, "ms to decode %u triangles", numTriangles);
+                    SendBenchmark(timer, "DecodeAllTriangles", description, parameters);
+
+                    // Check results
+                    EATESTAssert((float) min.GetX() < (float) max.GetX(), "Non-zero bounds in X");
+                    EATESTAssert((float) min.GetY() < (float) max.GetY(), "Non-zero bounds in Y");
+                    EATESTAssert((float) min.GetZ() < (float) max.GetZ(), "Non-zero bounds in Z");
+                }
+
+                /// Benchmark decoding all triangles of the original and the re-encoded clusters
+                void TestAdaptiveDecode()
+                {
+                    EA::Allocator::ICoreAllocator * allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+
+                    rw::collision::ClusteredMeshCluster ** original = static_cast<rw::collision::ClusteredMeshCluster **>(
+                        allocator->Alloc(sizeof(rw::collision::ClusteredMeshCluster *) * mMesh->GetNumCluster(), NULL, 0));
+                    for (uint32_t c = 0; c < mMesh->GetNumCluster(); ++c)
+                    {
+                        original[c] = &mMesh->GetCluster(c);
+                    }
+                    DecodeClusters(original, "method:original");
+                    allocator->Free(original);
+
+                    uint32_t modeCounts[NUM_MODES];
+                    rw::collision::ClusteredMeshCluster ** lossless = ReencodeClusters(0.0f, modeCounts);
+                    DecodeClusters(lossless, "method:adaptive lossless");
+                    FreeClusters(lossless);
+
+                    rw::collision::ClusteredMeshCluster ** lossy = ReencodeClusters(4.0f * mMesh->GetVertexCompressionGranularity(), modeCounts);
+                    DecodeClusters(lossy, "method:adaptive 4 granules");
+                    FreeClusters(lossy);
+                }
+
+                char mMeshFilename[256];
+
+                /// How many iterations to do to get a semi-reliable timing result
+#if defined(EA_PLATFORM_WINDOWS)
+                static const uint32_t mNumIterations = 50;
+#else
+                static const uint32_t mNumIterations = 10;
+#endif
+
+            } gAdaptiveCompressionBenchmark;
+#endif // !defined(EA_PLATFORM_PS3_SPU)
+
         }
     }
 }
@@ -331,6 +331,14 @@ namespace rw
                         TestExtractOneUnit<SpecificUnit<
                             rw::collision::ClusteredMeshCluster::VERTICES_UNCOMPRESSED> >(clusterInfo, "method:specific unit");
                         break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED:
+                        TestExtractOneUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED:
+                        TestExtractOneUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
                     }
                 }                    
 
@@ -493,6 +501,14 @@ namespace rw
                         TestExtractPPQUnit<SpecificUnit< 
                             rw::collision::ClusteredMeshCluster::VERTICES_UNCOMPRESSED> >(clusterInfo, "method:specific unit");
                         break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED:
+                        TestExtractPPQUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED:
+                        TestExtractPPQUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
                     }
                 }                    
 
@@ -657,6 +673,14 @@ namespace rw
                         TestExtractGPUnit<SpecificUnit<
                             rw::collision::ClusteredMeshCluster::VERTICES_UNCOMPRESSED> >(clusterInfo, "method:specific unit");
                         break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED:
+                        TestExtractGPUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED:
+                        TestExtractGPUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
                     }
                 }                    
            
@@ -790,6 +814,14 @@ namespace rw
                         TestComputeBBoxUnit<SpecificUnit<
                             rw::collision::ClusteredMeshCluster::VERTICES_UNCOMPRESSED> >(clusterInfo, "method:specific unit");
                         break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED:
+                        TestComputeBBoxUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
+                    case rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED:
+                        TestComputeBBoxUnit<SpecificUnit<
+                            rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED> >(clusterInfo, "method:specific unit");
+                        break;
                     }
                 }                    
 
@@ -0,0 +1,212 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include <rw/collision/clusterunitbounds.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace
+{
+    const char *g_unitBoundsBenchmarkFilenames[] =
+    {
+        "courtyard.dat",
+        "skatemesh_compressed_quads_ids.dat"
+    };
+
+    const char *g_unitBoundsFormatNames[] =
+    {
+        "NoUnitBounds",
+        "UnitBounds8Bit",
+        "UnitBounds16Bit"
+    };
+}
+
+// Benchmarks of line and bbox queries against clustered meshes with and without quantized unit bounds.
+// The description of each benchmark gives the memory used by the unit bounds and the triangles decoded.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+class BenchmarkClusterUnitBounds: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkClusterUnitBounds");
+
+        EATEST_REGISTER("BenchmarkLineQueries", "Line queries against clustered meshes with unit bounds", BenchmarkClusterUnitBounds, BenchmarkLineQueries);
+        EATEST_REGISTER("BenchmarkBBoxQueries", "BBox queries against clustered meshes with unit bounds", BenchmarkClusterUnitBounds, BenchmarkBBoxQueries);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkLineQueries();
+    void BenchmarkBBoxQueries();
+
+    void RunBenchmark(bool lineQueries);
+
+} BenchmarkClusterUnitBoundsSingleton;
+
+
+void BenchmarkClusterUnitBounds::BenchmarkLineQueries()
+{
+    RunBenchmark(true);
+}
+
+
+void BenchmarkClusterUnitBounds::BenchmarkBBoxQueries()
+{
+    RunBenchmark(false);
+}
+
+
+void BenchmarkClusterUnitBounds::RunBenchmark(bool lineQueries)
+{
+    const uint32_t numQueries = 1024;
+    const uint32_t numIterations = 5;
+    const uint32_t STACKSIZE = 1;
+    const uint32_t RESULTSSIZE = 256;
+    const float boxSize = 1.0f;
+
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, RESULTSSIZE);
+    VolumeBBoxQuery *bboxQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, RESULTSSIZE);
+
+    for (uint32_t cm = 0; cm < EAArrayCount(g_unitBoundsBenchmarkFilenames); ++cm)
+    {
+        //Load ClusteredMesh
+        Volume *clusteredMeshVolume = LoadSerializedClusteredMesh(g_unitBoundsBenchmarkFilenames[cm]);
+        EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+        ClusteredMesh *mesh = static_cast<ClusteredMesh *>(aggVol->GetAggregate());
+        const Volume * volumeArray[] = { clusteredMeshVolume };
+
+        AABBox bbox;
+        clusteredMeshVolume->GetBBox(0, TRUE, bbox);
+        const Vector3 extent = bbox.Max() - bbox.Min();
+
+        // Query positions from a fixed pseudo random sequence so the results are repeatable.
+        static Vector3 points[numQueries];
+        uint32_t seed = 12345u;
+        for (uint32_t i = 0; i < numQueries; ++i)
+        {
+            float r[3];
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                r[k] = float(seed >> 8) / float(1u << 24);
+            }
+            points[i] = bbox.Min() + Vector3(r[0] * extent.GetX(), r[1] * extent.GetY(), r[2] * extent.GetZ());
+        }
+        const Vector3 down(0.0f, -extent.GetY(), 0.0f);
+        const Vector3 pad(boxSize, boxSize, boxSize);
+
+        const uint32_t meshSize = mesh->GetSizeThis();
+        uint32_t baseResults = 0;
+
+        for (uint32_t format = ClusterUnitBounds::FORMAT_NONE; format <= ClusterUnitBounds::FORMAT_16BIT; ++format)
+        {
+            // Unit bounds are held outside the loaded mesh and attached to it
+            ClusterUnitBounds *unitBounds = NULL;
+            uint32_t unitBoundsSize = 0;
+            if (format != ClusterUnitBounds::FORMAT_NONE)
+            {
+                ClusterUnitBounds::ObjectDescriptor objDesc(mesh->GetNumCluster(), mesh->GetNumUnits(), format);
+                const EA::Physics::SizeAndAlignment resDesc = ClusterUnitBounds::GetResourceDescriptor(objDesc);
+                unitBoundsSize = resDesc.GetSize();
+                unitBounds = ClusterUnitBounds::Initialize(EA::Physics::MemoryPtr(
+                    allocator->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment())), objDesc);
+                unitBounds->Build(*mesh);
+            }
+            mesh->SetClusterUnitBounds(unitBounds);
+
+            rw::collision::Tests::BenchmarkTimer timer;
+            uint32_t numResults = 0;
+            uint32_t numTriangles = 0;
+            for (uint32_t it = 0; it < numIterations; ++it)
+            {
+                numResults = 0;
+                numTriangles = 0;
+                timer.Start();
+                for (uint32_t i = 0; i < numQueries; ++i)
+                {
+                    if (lineQueries)
+                    {
+                        const Vector3 start(points[i].GetX(), bbox.Max().GetY(), points[i].GetZ());
+                        lineQuery->InitQuery(volumeArray, NULL, 1, start, start + down);
+                        numResults += lineQuery->GetAllIntersections();
+#if RW_COLLISION_DETAIL_QUERY_STATS
+                        numTriangles += lineQuery->GetCounters().m_counts[QueryCounters::TRIANGLES];
+#endif
+                    }
+                    else
+                    {
+                        bboxQuery->InitQuery(volumeArray, NULL, 1, AABBox(points[i] - pad, points[i] + pad));
+                        while (!bboxQuery->Finished())
+                        {
+                            numResults += bboxQuery->GetOverlaps();
+                        }
+#if RW_COLLISION_DETAIL_QUERY_STATS
+                        numTriangles += bboxQuery->GetCounters().m_counts[QueryCounters::TRIANGLES];
+#endif
+                    }
+                }
+                timer.Stop();
+            }
+
+            if (format == ClusterUnitBounds::FORMAT_NONE)
+            {
+                baseResults = numResults;
+            }
+            EATESTAssert(numResults == baseResults, "Unit bounds should not change the query results.");
+
+            char buffer[256];
+            sprintf(buffer, "suite:BenchmarkClusterUnitBounds,benchmark:%s,method:%s%s,description:%u results from %u triangles"
+                " with %u bytes of unit bounds for a %u byte mesh",
+                g_unitBoundsBenchmarkFilenames[cm], lineQueries ? "Line" : "BBox", g_unitBoundsFormatNames[format],
+                numResults, numTriangles, unitBoundsSize, meshSize);
+            EATESTSendBenchmark(buffer, timer.GetAverageDurationMilliseconds(), timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+
+            mesh->SetClusterUnitBounds(NULL);
+            if (unitBounds)
+            {
+                unitBounds->Release();
+                allocator->Free(unitBounds);
+            }
+        }
+
+        allocator->Free(aggVol->GetAggregate());
+        allocator->Free(aggVol);
+    }
+}
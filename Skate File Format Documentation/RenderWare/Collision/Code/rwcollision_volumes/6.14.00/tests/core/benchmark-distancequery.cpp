@@ -0,0 +1,177 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace
+{
+    const char *g_distanceQueryBenchmarkFilenames[] =
+    {
+        "courtyard.dat",
+        "skatemesh_compressed_quads_ids.dat"
+    };
+}
+
+// Benchmarks of nearest surface point queries against clustered meshes. The nearest first KDTree walk
+// of ClusteredMesh::ClosestPointQuery is compared with a bbox query of the search radius followed by a
+// closest point test of every triangle returned.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+class BenchmarkDistanceQuery: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkDistanceQuery");
+
+        EATEST_REGISTER("BenchmarkClosestPointQuery", "Closest point queries against clustered meshes", BenchmarkDistanceQuery, BenchmarkClosestPointQuery);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkClosestPointQuery();
+
+} BenchmarkDistanceQuerySingleton;
+
+
+void BenchmarkDistanceQuery::BenchmarkClosestPointQuery()
+{
+    const uint32_t numPoints = 1024;
+    const uint32_t numIterations = 5;
+    const float radius = 2.0f;
+    const uint32_t STACKSIZE = 1;
+    const uint32_t RESULTSSIZE = 4096;
+
+    for (uint32_t cm = 0; cm < EAArrayCount(g_distanceQueryBenchmarkFilenames); ++cm)
+    {
+        //Load ClusteredMesh
+        Volume *clusteredMeshVolume = LoadSerializedClusteredMesh(g_distanceQueryBenchmarkFilenames[cm]);
+        EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+        ClusteredMesh *mesh = static_cast<ClusteredMesh *>(aggVol->GetAggregate());
+
+        VolumeBBoxQuery* bboxQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, RESULTSSIZE);
+        EATESTAssert(bboxQuery, "Failed to create BBox query.");
+        const Volume * volumeArray[] = { clusteredMeshVolume };
+
+        AABBox bbox;
+        clusteredMeshVolume->GetBBox(0, TRUE, bbox);
+        const Vector3 extent = bbox.Max() - bbox.Min();
+
+        // Points within the mesh bounds, from a fixed pseudo random sequence so the results are repeatable.
+        static Vector3 points[numPoints];
+        uint32_t seed = 12345u;
+        for (uint32_t i = 0; i < numPoints; ++i)
+        {
+            float r[3];
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                r[k] = float(seed >> 8) / float(1u << 24);
+            }
+            points[i] = bbox.Min() + Vector3(r[0] * extent.GetX(), r[1] * extent.GetY(), r[2] * extent.GetZ());
+        }
+
+        static DistanceQueryResult results[numPoints];
+        rw::collision::Tests::BenchmarkTimer treeTimer;
+        uint32_t numFound = 0;
+
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            treeTimer.Start();
+            numFound = mesh->ClosestPointQueryBatch(results, points, numPoints, radius, NULL);
+            treeTimer.Stop();
+        }
+
+        EATESTAssert(numFound, "No points were near the mesh.");
+
+        rw::collision::Tests::BenchmarkTimer bboxTimer;
+        uint32_t numMismatches = 0;
+
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            numMismatches = 0;
+            bboxTimer.Start();
+            for (uint32_t i = 0; i < numPoints; ++i)
+            {
+                const Vector3 pad(radius, radius, radius);
+                bboxQuery->InitQuery(volumeArray, 0, 1, AABBox(points[i] - pad, points[i] + pad));
+
+                float bestDistance = MAX_FLOAT;
+                while (!bboxQuery->Finished())
+                {
+                    const uint32_t numOverlaps = bboxQuery->GetOverlaps();
+                    const VolRef *vRefs = bboxQuery->GetOverlapResultsBuffer();
+                    for (uint32_t j = 0; j < numOverlaps; ++j)
+                    {
+                        const TriangleVolume *triangle = static_cast<const TriangleVolume *>(vRefs[j].volume);
+                        Vector3 p0, p1, p2, closest;
+                        triangle->GetPoints(p0, p1, p2, vRefs[j].tm);
+                        TriangleClosestPoint(closest, points[i], p0, p1, p2);
+                        bestDistance = Min(bestDistance, static_cast<float>(Magnitude(points[i] - closest)));
+                    }
+                }
+
+                if (bestDistance > radius)
+                {
+                    bestDistance = MAX_FLOAT;
+                }
+                if (!IsSimilar(bestDistance, results[i].distance, 1e-4f))
+                {
+                    ++numMismatches;
+                }
+            }
+            bboxTimer.Stop();
+        }
+
+        EATESTAssert(numMismatches == 0, "Closest point query should match the bbox query.");
+
+        char buffer[256];
+        sprintf(buffer, "suite:BenchmarkDistanceQuery,benchmark:%s,method:ClosestPointQueryBatch,description:%u points of which %u found",
+            g_distanceQueryBenchmarkFilenames[cm], numPoints, numFound);
+        EATESTSendBenchmark(buffer, treeTimer.GetAverageDurationMilliseconds(), treeTimer.GetMinDurationMilliseconds(), treeTimer.GetMaxDurationMilliseconds());
+
+        sprintf(buffer, "suite:BenchmarkDistanceQuery,benchmark:%s,method:VolumeBBoxQuery,description:%u points of which %u found",
+            g_distanceQueryBenchmarkFilenames[cm], numPoints, numFound);
+        EATESTSendBenchmark(buffer, bboxTimer.GetAverageDurationMilliseconds(), bboxTimer.GetMinDurationMilliseconds(), bboxTimer.GetMaxDurationMilliseconds());
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bboxQuery);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(mesh);
+    }
+}
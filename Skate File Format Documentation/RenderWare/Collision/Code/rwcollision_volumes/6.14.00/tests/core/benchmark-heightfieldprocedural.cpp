@@ -0,0 +1,346 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+#include <EABase/eabase.h>
+#include <coreallocator/icoreallocator_interface.h>
+
+#include <rw/collision/libcore.h>
+#include <rw/collision/heightfieldprocedural.h>
+
+#include <rw/collision/meshbuilder/common.h>
+#include <rw/collision/meshbuilder/triangleconnector.h>
+#include <rw/collision/meshbuilder/edgecodegenerator.h>
+#include <rw/collision/meshbuilder/unitlistbuilder.h>
+#include <rw/collision/meshbuilder/triangleclusterproceduralbuilder.h>
+
+#include <eaphysics/unitframework/creator.h>
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+// Benchmarks of the memory use and query speed of a terrain patch stored as a HeightFieldProcedural, against the
+// same triangles built into a TriangleClusterProcedural. The patch is the largest grid that fits in the 255
+// vertices of a single cluster.
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace
+{
+
+
+const uint32_t gridSize = 14;
+const uint32_t gridNumVertices = (gridSize + 1) * (gridSize + 1);
+const uint32_t gridNumTriangles = 2 * gridSize * gridSize;
+
+const uint32_t numQueries = 1000;
+const uint32_t numIterations = 10;
+const uint32_t resultsBufferSize = 64;
+
+
+/**
+The height of vertex (x, z) of the terrain, as a quantized height of step 1/16.
+*/
+uint16_t
+GetTerrainHeight(uint32_t x, uint32_t z)
+{
+    return static_cast<uint16_t>((x * 13u + z * 7u + ((x * z) % 5u) * 3u) % 32u);
+}
+
+
+/**
+Builds the terrain as a TriangleClusterProcedural, with the same triangulation as a HeightFieldProcedural
+without diagonal flags.
+*/
+TriangleClusterProcedural *
+BuildTerrainCluster(EA::Allocator::ICoreAllocator &allocator)
+{
+    typedef meshbuilder::TriangleClusterProceduralBuilder Builder;
+    typedef meshbuilder::TriangleConnector::TriangleEdgeCosinesList TriangleEdgeCosinesList;
+    typedef meshbuilder::TriangleConnector::TriangleNeighborsList TriangleNeighborsList;
+    typedef meshbuilder::TriangleConnector::TriangleFlagsList TriangleFlagsList;
+    typedef meshbuilder::UnitListBuilder::IDList IDList;
+
+    Builder::VertexList *vertices = Builder::VertexList::Allocate(&allocator, gridNumVertices, EA::Allocator::MEM_TEMP);
+    Builder::TriangleList *triangles = Builder::TriangleList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    Builder::TriangleSurfaceIDList *surfaceIDs = Builder::TriangleSurfaceIDList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    Builder::TriangleGroupIDList *groupIDs = Builder::TriangleGroupIDList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    vertices->resize(gridNumVertices);
+    triangles->resize(gridNumTriangles);
+    surfaceIDs->resize(gridNumTriangles);
+    groupIDs->resize(gridNumTriangles);
+
+    const uint32_t rowSize = gridSize + 1;
+    for (uint32_t z = 0; z < rowSize; ++z)
+    {
+        for (uint32_t x = 0; x < rowSize; ++x)
+        {
+            (*vertices)[z * rowSize + x] = meshbuilder::VectorType(static_cast<float>(x),
+                static_cast<float>(GetTerrainHeight(x, z)) * 0.0625f, static_cast<float>(z));
+        }
+    }
+
+    uint32_t triangleIndex = 0;
+    for (uint32_t z = 0; z < gridSize; ++z)
+    {
+        for (uint32_t x = 0; x < gridSize; ++x)
+        {
+            const uint32_t v0 = z * rowSize + x;
+            const uint32_t indices[6] = { v0, v0 + rowSize, v0 + rowSize + 1, v0, v0 + rowSize + 1, v0 + 1 };
+            for (uint32_t i = 0; i < 6; ++i)
+            {
+                (*triangles)[triangleIndex + i / 3].vertices[i % 3] = indices[i];
+            }
+            (*surfaceIDs)[triangleIndex] = 0;
+            (*surfaceIDs)[triangleIndex + 1] = 0;
+            (*groupIDs)[triangleIndex] = 0;
+            (*groupIDs)[triangleIndex + 1] = 0;
+            triangleIndex += 2;
+        }
+    }
+
+    TriangleEdgeCosinesList *edgeCosines = TriangleEdgeCosinesList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    TriangleNeighborsList *neighbors = TriangleNeighborsList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    TriangleFlagsList *flags = TriangleFlagsList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    edgeCosines->resize(gridNumTriangles);
+    neighbors->resize(gridNumTriangles);
+    flags->resize(gridNumTriangles);
+
+    meshbuilder::TriangleConnector::GenerateTriangleConnectivity(*edgeCosines, *neighbors, *flags, allocator, *vertices, *triangles);
+
+    Builder::TriangleEdgeCodesList *edgeCodes = Builder::TriangleEdgeCodesList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    edgeCodes->resize(gridNumTriangles);
+    meshbuilder::EdgeCodeGenerator::GenerateTriangleEdgeCodes(*edgeCodes, *edgeCosines, *neighbors, VecFloat(0.0f));
+
+    Builder::UnitList *units = Builder::UnitList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    units->reserve(gridNumTriangles);
+    IDList *compressedUnitIndex = IDList::Allocate(&allocator, gridNumTriangles, EA::Allocator::MEM_TEMP);
+    compressedUnitIndex->resize(gridNumTriangles);
+    meshbuilder::UnitListBuilder::BuildUnitListWithQuads(*units, *compressedUnitIndex, *triangles, *surfaceIDs, *groupIDs,
+        *neighbors, *flags, *vertices, 0u, 0u);
+
+    Builder::BuildParameters buildParameters;
+    buildParameters.unitParameters.unitFlagsDefault = UNITFLAG_EDGEANGLE;
+    buildParameters.vertexCompressionGranularity = 0.0625f;
+
+    TriangleClusterProcedural *cluster = Builder::Build(allocator, allocator, buildParameters,
+        *vertices, *triangles, *units, *edgeCodes, *surfaceIDs, *groupIDs);
+
+    IDList::Free(&allocator, compressedUnitIndex);
+    Builder::UnitList::Free(&allocator, units);
+    Builder::TriangleEdgeCodesList::Free(&allocator, edgeCodes);
+    TriangleFlagsList::Free(&allocator, flags);
+    TriangleNeighborsList::Free(&allocator, neighbors);
+    TriangleEdgeCosinesList::Free(&allocator, edgeCosines);
+    Builder::TriangleGroupIDList::Free(&allocator, groupIDs);
+    Builder::TriangleSurfaceIDList::Free(&allocator, surfaceIDs);
+    Builder::TriangleList::Free(&allocator, triangles);
+    Builder::VertexList::Free(&allocator, vertices);
+
+    return cluster;
+}
+
+
+/**
+Builds the terrain as a HeightFieldProcedural.
+*/
+HeightFieldProcedural *
+BuildTerrainHeightField()
+{
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(gridSize, gridSize, 0u);
+    heightField->SetHeightQuantization(0.0f, 0.0625f);
+
+    for (uint32_t z = 0; z <= gridSize; ++z)
+    {
+        for (uint32_t x = 0; x <= gridSize; ++x)
+        {
+            heightField->SetHeight(x, z, GetTerrainHeight(x, z));
+        }
+    }
+
+    heightField->Update();
+    return heightField;
+}
+
+
+/**
+A pseudo random coordinate over the terrain, repeatable across runs.
+*/
+float
+GetQueryCoordinate(uint32_t query, uint32_t axis)
+{
+    return static_cast<float>((query * (axis ? 7919u : 104729u) + axis * 31u) % 1400u) * 0.01f;
+}
+
+
+} // namespace
+
+
+class BenchmarkHeightFieldProcedural : public tests::TestSuiteBase
+{
+public:
+
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkHeightFieldProcedural");
+
+        EATEST_REGISTER("BenchmarkVerticalLineQuery", "Vertical line queries against a heightfield and a cluster of the same terrain", BenchmarkHeightFieldProcedural, BenchmarkVerticalLineQuery);
+        EATEST_REGISTER("BenchmarkLongLineQuery", "Long shallow line queries against a heightfield and a cluster of the same terrain", BenchmarkHeightFieldProcedural, BenchmarkLongLineQuery);
+        EATEST_REGISTER("BenchmarkBBoxQuery", "Small bbox queries against a heightfield and a cluster of the same terrain", BenchmarkHeightFieldProcedural, BenchmarkBBoxQuery);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+        m_allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+
+        m_cluster = BuildTerrainCluster(*m_allocator);
+        m_heightField = BuildTerrainHeightField();
+        m_clusterVolume = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(m_cluster);
+        m_heightFieldVolume = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(m_heightField);
+    }
+
+    virtual void TeardownSuite()
+    {
+        m_allocator->Free(m_heightFieldVolume);
+        m_allocator->Free(m_clusterVolume);
+        m_allocator->Free(m_heightField);
+        m_allocator->Free(m_cluster);
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkVerticalLineQuery();
+    void BenchmarkLongLineQuery();
+    void BenchmarkBBoxQuery();
+
+    void BenchmarkLineQueries(const char *benchmark, const Vector3 *lineStarts, const Vector3 *lineEnds);
+
+    EA::Allocator::ICoreAllocator * m_allocator;
+    TriangleClusterProcedural * m_cluster;
+    HeightFieldProcedural * m_heightField;
+    AggregateVolume * m_clusterVolume;
+    AggregateVolume * m_heightFieldVolume;
+
+} BenchmarkHeightFieldProceduralSingleton;
+
+
+void
+BenchmarkHeightFieldProcedural::BenchmarkLineQueries(const char *benchmark, const Vector3 *lineStarts, const Vector3 *lineEnds)
+{
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, resultsBufferSize);
+
+    const char *methods[2] = { "TriangleClusterProcedural", "HeightFieldProcedural" };
+    const Volume *volumes[2] = { m_clusterVolume, m_heightFieldVolume };
+    const uint32_t sizes[2] = { m_cluster->GetSizeThis(), m_heightField->GetSizeThis() };
+    uint32_t numHits[2] = { 0, 0 };
+
+    for (uint32_t method = 0; method < 2; ++method)
+    {
+        rw::collision::Tests::BenchmarkTimer timer;
+        for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+        {
+            numHits[method] = 0;
+            timer.Start();
+            for (uint32_t query = 0; query < numQueries; ++query)
+            {
+                lineQuery->InitQuery(&volumes[method], NULL, 1, lineStarts[query], lineEnds[query]);
+                numHits[method] += lineQuery->GetAllIntersections();
+            }
+            timer.Stop();
+        }
+
+        char description[256];
+        sprintf(description, "suite:BenchmarkHeightFieldProcedural,benchmark:%s,method:%s,description:%u queries of %u triangles in %u bytes %u hits",
+            benchmark, methods[method], numQueries, gridNumTriangles, sizes[method], numHits[method]);
+        EATESTSendBenchmark(description, timer.GetAverageDurationMilliseconds(), timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+    }
+
+    EATESTAssert(numHits[0] == numHits[1], "Heightfield and cluster should have the same number of hits");
+
+    m_allocator->Free(lineQuery);
+}
+
+
+void
+BenchmarkHeightFieldProcedural::BenchmarkVerticalLineQuery()
+{
+    Vector3 *lineStarts = new Vector3[numQueries];
+    Vector3 *lineEnds = new Vector3[numQueries];
+
+    for (uint32_t query = 0; query < numQueries; ++query)
+    {
+        const float x = GetQueryCoordinate(query, 0) + 0.003f;
+        const float z = GetQueryCoordinate(query, 1) + 0.007f;
+        lineStarts[query] = Vector3(x, 10.0f, z);
+        lineEnds[query] = Vector3(x, -10.0f, z);
+    }
+
+    BenchmarkLineQueries("VerticalLineQuery", lineStarts, lineEnds);
+
+    delete [] lineEnds;
+    delete [] lineStarts;
+}
+
+
+void
+BenchmarkHeightFieldProcedural::BenchmarkLongLineQuery()
+{
+    Vector3 *lineStarts = new Vector3[numQueries];
+    Vector3 *lineEnds = new Vector3[numQueries];
+
+    // Lines across the terrain between random points, just above the mean height, as for visibility tests
+    for (uint32_t query = 0; query < numQueries; ++query)
+    {
+        lineStarts[query] = Vector3(GetQueryCoordinate(query, 0) + 0.003f, 1.1f, GetQueryCoordinate(query, 1) + 0.007f);
+        lineEnds[query] = Vector3(GetQueryCoordinate(query + 500u, 0) + 0.005f, 0.9f, GetQueryCoordinate(query + 500u, 1) + 0.002f);
+    }
+
+    BenchmarkLineQueries("LongLineQuery", lineStarts, lineEnds);
+
+    delete [] lineEnds;
+    delete [] lineStarts;
+}
+
+
+void
+BenchmarkHeightFieldProcedural::BenchmarkBBoxQuery()
+{
+    VolumeBBoxQuery *bboxQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(1u, resultsBufferSize);
+
+    const char *methods[2] = { "TriangleClusterProcedural", "HeightFieldProcedural" };
+    const Volume *volumes[2] = { m_clusterVolume, m_heightFieldVolume };
+    const uint32_t sizes[2] = { m_cluster->GetSizeThis(), m_heightField->GetSizeThis() };
+    uint32_t numOverlaps[2] = { 0, 0 };
+
+    for (uint32_t method = 0; method < 2; ++method)
+    {
+        rw::collision::Tests::BenchmarkTimer timer;
+        for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+        {
+            numOverlaps[method] = 0;
+            timer.Start();
+            for (uint32_t query = 0; query < numQueries; ++query)
+            {
+                // A box the size of a character standing on the terrain
+                const float x = GetQueryCoordinate(query, 0);
+                const float z = GetQueryCoordinate(query, 1);
+                bboxQuery->InitQuery(&volumes[method], NULL, 1, AABBox(x - 0.5f, 0.5f, z - 0.5f, x + 0.5f, 2.5f, z + 0.5f));
+                numOverlaps[method] += bboxQuery->GetOverlaps();
+            }
+            timer.Stop();
+        }
+
+        char description[256];
+        sprintf(description, "suite:BenchmarkHeightFieldProcedural,benchmark:BBoxQuery,method:%s,description:%u queries of %u triangles in %u bytes %u overlaps",
+            methods[method], numQueries, gridNumTriangles, sizes[method], numOverlaps[method]);
+        EATESTSendBenchmark(description, timer.GetAverageDurationMilliseconds(), timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+    }
+
+    m_allocator->Free(bboxQuery);
+}
@@ -0,0 +1,185 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include <rw/collision/kdtree.h>
+#include <rw/collision/compactkdtree.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include <eaphysics/unitframework/serialization_test_helpers.hpp>
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Benchmarks of line and bbox queries against kdtrees and CompactKDTree copies of them.
+// The description of each benchmark gives the memory used by the branch nodes and the number of
+// entries returned, which is slightly higher for compact trees since their child regions are rounded outwards.
+
+class BenchmarkKDTreeCompact: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkKDTreeCompact");
+
+        EATEST_REGISTER("BenchmarkMappedArrayKDTree", "Queries against the kdtree of a KDTreeMappedArray", BenchmarkKDTreeCompact, BenchmarkMappedArrayKDTree);
+        EATEST_REGISTER("BenchmarkClusteredMeshKDTree", "Queries against the kdtree of a ClusteredMesh", BenchmarkKDTreeCompact, BenchmarkClusteredMeshKDTree);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkMappedArrayKDTree();
+    void BenchmarkClusteredMeshKDTree();
+
+    void RunBenchmark(const KDTreeBase & source, const char * name);
+
+    template <class LINEQUERY, class BBOXQUERY, class TREE>
+    void RunQueries(const TREE & kdtree, const Vector3 * points, uint32_t numQueries, const char * name,
+                    const char * formatName, uint32_t nodeBytes);
+
+} BenchmarkKDTreeCompactSingleton;
+
+
+void BenchmarkKDTreeCompact::BenchmarkMappedArrayKDTree()
+{
+    const char* filename = UNITTEST_HL_SERIALIZED_DATA_FILE("kdtreemappedarray");
+    KDTreeMappedArray* mappedArray = EA::Physics::UnitFramework::LoadHLSerializationFromFile<KDTreeMappedArray>(filename);
+    EATESTAssert(mappedArray, "Failed to load kdtree mapped array.");
+
+    RunBenchmark(*mappedArray->GetKDTreeMap(), "kdtreemappedarray.dat");
+}
+
+
+void BenchmarkKDTreeCompact::BenchmarkClusteredMeshKDTree()
+{
+    Volume *clusteredMeshVolume = LoadSerializedClusteredMesh("skatemesh.dat");
+    EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+    AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+    ClusteredMesh *mesh = static_cast<ClusteredMesh *>(aggVol->GetAggregate());
+
+    RunBenchmark(*mesh->GetKDTreeBase(), "skatemesh.dat");
+
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    allocator->Free(aggVol->GetAggregate());
+    allocator->Free(aggVol);
+}
+
+
+void BenchmarkKDTreeCompact::RunBenchmark(const KDTreeBase & source, const char * name)
+{
+    const uint32_t numQueries = 1024;
+
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+
+    // Compact copy of the source tree
+    EATESTAssert(CompactKDTree::CanCompactBranchNodes(source), "Source kdtree should be suitable for compacting.");
+    EA::Physics::SizeAndAlignment resDesc = CompactKDTree::GetResourceDescriptor(source.GetNumBranchNodes(),
+        source.GetNumEntries(), source.GetBBox());
+    CompactKDTree * compact = CompactKDTree::Initialize(EA::Physics::MemoryPtr(
+        allocator->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment())),
+        source.GetNumBranchNodes(), source.GetNumEntries(), source.GetBBox());
+    compact->CompactBranchNodes(source);
+
+    const AABBox & bbox = source.GetBBox();
+    const Vector3 extent = bbox.Max() - bbox.Min();
+
+    // Query positions from a fixed pseudo random sequence so the results are repeatable.
+    static Vector3 points[numQueries];
+    uint32_t seed = 12345u;
+    for (uint32_t i = 0; i < numQueries; ++i)
+    {
+        float r[3];
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            r[k] = float(seed >> 8) / float(1u << 24);
+        }
+        points[i] = bbox.Min() + Vector3(r[0] * extent.GetX(), r[1] * extent.GetY(), r[2] * extent.GetZ());
+    }
+
+    RunQueries<KDTreeLineQuery, KDTreeBBoxQuery>(source, points, numQueries, name, "Full",
+        source.GetNumBranchNodes() * uint32_t(sizeof(KDTreeBase::BranchNode)));
+    RunQueries<CompactKDTreeLineQuery, CompactKDTreeBBoxQuery>(*compact, points, numQueries, name, "Compact",
+        source.GetNumBranchNodes() * uint32_t(sizeof(CompactKDTree::BranchNode)));
+
+    allocator->Free(compact);
+}
+
+
+template <class LINEQUERY, class BBOXQUERY, class TREE>
+void BenchmarkKDTreeCompact::RunQueries(const TREE & kdtree, const Vector3 * points, uint32_t numQueries, const char * name,
+                                        const char * formatName, uint32_t nodeBytes)
+{
+    const uint32_t numIterations = 5;
+
+    const AABBox & bbox = kdtree.m_bbox;
+    const Vector3 extent = bbox.Max() - bbox.Min();
+    const Vector3 down(0.0f, -extent.GetY(), 0.0f);
+    const Vector3 halfSize = extent * VecFloat(0.01f);
+
+    for (uint32_t lineQueries = 0; lineQueries < 2; ++lineQueries)
+    {
+        rw::collision::Tests::BenchmarkTimer timer;
+        uint32_t numResults = 0;
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            numResults = 0;
+            timer.Start();
+            for (uint32_t i = 0; i < numQueries; ++i)
+            {
+                uint32_t entry = 0, count = 0;
+                if (lineQueries)
+                {
+                    const Vector3 start(points[i].GetX(), bbox.Max().GetY(), points[i].GetZ());
+                    LINEQUERY query(&kdtree, start, start + down);
+                    while (query.GetNext(entry, count))
+                    {
+                        numResults += count;
+                    }
+                }
+                else
+                {
+                    BBOXQUERY query(&kdtree, AABBox(points[i] - halfSize, points[i] + halfSize));
+                    while (query.GetNext(entry, count))
+                    {
+                        numResults += count;
+                    }
+                }
+            }
+            timer.Stop();
+        }
+
+        char buffer[256];
+        sprintf(buffer, "suite:BenchmarkKDTreeCompact,benchmark:%s,method:%s%s,description:%u entries from %u queries"
+            " with %u bytes of branch nodes",
+            name, lineQueries ? "Line" : "BBox", formatName, numResults, numQueries, nodeBytes);
+        EATESTSendBenchmark(buffer, timer.GetAverageDurationMilliseconds(), timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+    }
+}
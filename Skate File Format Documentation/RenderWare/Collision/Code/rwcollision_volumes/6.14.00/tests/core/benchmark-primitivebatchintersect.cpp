@@ -0,0 +1,218 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+
+#include "benchmark_timer.hpp"
+#include "thread_dispatcher.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Benchmarks of the NxM primitive batch intersection, the serial PrimitiveBatchIntersectNxM against the tiled
+// version run in order and the tiled version run on 1 to 8 EAThread workers into per worker buffers and
+// merged, which is how a job system would run it. The threaded timings include the instancing and the merge,
+// and report their speedup over the serial PrimitiveBatchIntersectNxM.
+
+class BenchmarkPrimitiveBatchIntersect: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkPrimitiveBatchIntersect");
+
+        EATEST_REGISTER("BenchmarkNxM64", "PrimitiveBatchIntersectNxM serial against tiled for 64x64 spheres", BenchmarkPrimitiveBatchIntersect, BenchmarkNxM64);
+        EATEST_REGISTER("BenchmarkNxM128", "PrimitiveBatchIntersectNxM serial against tiled for 128x128 spheres", BenchmarkPrimitiveBatchIntersect, BenchmarkNxM128);
+        EATEST_REGISTER("BenchmarkNxM256", "PrimitiveBatchIntersectNxM serial against tiled for 256x256 spheres", BenchmarkPrimitiveBatchIntersect, BenchmarkNxM256);
+#ifndef EA_PLATFORM_MOBILE
+        EATEST_REGISTER("BenchmarkNxM512", "PrimitiveBatchIntersectNxM serial against tiled for 512x512 spheres", BenchmarkPrimitiveBatchIntersect, BenchmarkNxM512);
+        EATEST_REGISTER("BenchmarkNxM1024", "PrimitiveBatchIntersectNxM serial against tiled for 1024x1024 spheres", BenchmarkPrimitiveBatchIntersect, BenchmarkNxM1024);
+#endif
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+private:
+
+    void BenchmarkNxM64()   { BenchmarkNxM(64); }
+    void BenchmarkNxM128()  { BenchmarkNxM(128); }
+    void BenchmarkNxM256()  { BenchmarkNxM(256); }
+    void BenchmarkNxM512()  { BenchmarkNxM(512); }
+    void BenchmarkNxM1024() { BenchmarkNxM(1024); }
+
+    void BenchmarkNxM(int32_t num);
+
+    struct TileJob
+    {
+        const GPInstance *instancingSPR;
+        int32_t num;
+        int32_t tileSize;
+        PrimitivePairIntersectResult *workerResBufs;
+        int32_t workerResBufMaxSize;
+        int32_t workerPos[rw::collision::Tests::ThreadDispatcher::MAX_WORKERS];
+        PrimitivePairIntersectResult **tileResBufs;
+        int32_t *tileMaxSizes;
+        int32_t *tileCounts;
+    };
+
+    static void RunTiles(void *context, uint32_t workerIndex, uint32_t begin, uint32_t end);
+
+} BenchmarkPrimitiveBatchIntersectSingleton;
+
+
+// Runs a range of tiles on one worker, appending each tile's results to that worker's buffer.
+void BenchmarkPrimitiveBatchIntersect::RunTiles(void *context, uint32_t workerIndex, uint32_t begin, uint32_t end)
+{
+    TileJob &job = *static_cast<TileJob *>(context);
+    PrimitivePairIntersectResult *workerResBuf = job.workerResBufs + workerIndex * (uint32_t) job.workerResBufMaxSize;
+    int32_t &workerPos = job.workerPos[workerIndex];
+
+    for (uint32_t ti = begin; ti < end; ++ti)
+    {
+        job.tileResBufs[ti] = workerResBuf + workerPos;
+        job.tileMaxSizes[ti] = job.workerResBufMaxSize - workerPos;
+        job.tileCounts[ti] = rw::collision::detail::PrimitiveBatchIntersectNxMTile(job.tileResBufs[ti], job.tileMaxSizes[ti],
+            job.instancingSPR, job.num, job.num, (int32_t) ti, job.tileSize);
+        workerPos += Min(job.tileCounts[ti], job.tileMaxSizes[ti]);
+    }
+}
+
+
+void BenchmarkPrimitiveBatchIntersect::BenchmarkNxM(int32_t num)
+{
+    const int32_t maxNum = 1024;
+    const int32_t tileSize = PRIMITIVEBATCHINTERSECT_DEFAULT_TileSize;
+    const uint32_t numIterations = 5;
+    EATESTAssert(num <= maxNum, "Batch too large.");
+
+    // Two rows of spheres offset so that each M sphere touches the N sphere next to it.
+    static Volume volsN[maxNum], volsM[maxNum];
+    static Matrix44Affine transformsN[maxNum], transformsM[maxNum];
+    static const Volume *vN[maxNum], *vM[maxNum];
+    static const Matrix44Affine *tN[maxNum], *tM[maxNum];
+
+    for (int32_t i = 0; i < num; ++i)
+    {
+        SphereVolume::Initialize(&volsN[i], 0.6f);
+        SphereVolume::Initialize(&volsM[i], 0.6f);
+        transformsN[i] = Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(2.0f * float(i), 0.0f, 0.0f));
+        transformsM[i] = Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(2.0f * float(i) + 0.5f, 0.5f, 0.0f));
+        vN[i] = &volsN[i];
+        vM[i] = &volsM[i];
+        tN[i] = &transformsN[i];
+        tM[i] = &transformsM[i];
+    }
+
+    const int32_t resBufMaxSize = 4 * num;
+    const int32_t numTiles = rw::collision::detail::PrimitiveBatchIntersectNxMGetNumTiles(num, num, tileSize);
+
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    PrimitivePairIntersectResult *results = static_cast<PrimitivePairIntersectResult *>(
+        allocator->Alloc(sizeof(PrimitivePairIntersectResult) * (uint32_t) resBufMaxSize, "results", 0, 16));
+    GPInstance *instancingSPR = static_cast<GPInstance *>(
+        allocator->Alloc(sizeof(GPInstance) * 2u * (uint32_t) num, "instancingSPR", 0, 16));
+    PrimitivePairIntersectResult **tileResBufs = static_cast<PrimitivePairIntersectResult **>(
+        allocator->Alloc(sizeof(PrimitivePairIntersectResult *) * (uint32_t) numTiles, "tileResBufs", 0));
+    int32_t *tileCounts = static_cast<int32_t *>(allocator->Alloc(sizeof(int32_t) * 2u * (uint32_t) numTiles, "tileCounts", 0));
+    int32_t *tileMaxSizes = tileCounts + numTiles;
+
+    // Each worker appends the tiles it runs to its own buffer, which has room for the whole result so no
+    // scheduling of the tiles can overflow it. The merge gathers the tiles back in tile order.
+    const uint32_t maxWorkers = 8;
+    PrimitivePairIntersectResult *workerResBufs = static_cast<PrimitivePairIntersectResult *>(
+        allocator->Alloc(sizeof(PrimitivePairIntersectResult) * maxWorkers * (uint32_t) resBufMaxSize, "workerResBufs", 0, 16));
+
+    rw::collision::Tests::BenchmarkTimer serialTimer, tiledTimer;
+    int32_t numSerial = 0, numTiled = 0;
+
+    for (uint32_t it = 0; it < numIterations; ++it)
+    {
+        serialTimer.Start();
+        numSerial = rw::collision::detail::PrimitiveBatchIntersectNxM(results, resBufMaxSize, instancingSPR,
+            vN, tN, num, vM, tM, num);
+        serialTimer.Stop();
+
+        tiledTimer.Start();
+        numTiled = rw::collision::detail::PrimitiveBatchIntersectNxMTiled(results, resBufMaxSize, instancingSPR,
+            vN, tN, num, vM, tM, num, tileSize);
+        tiledTimer.Stop();
+    }
+
+    EATESTAssert(numSerial > 0, "No results found.");
+    EATESTAssert(numSerial == numTiled, "Tiled batch found a different number of intersections.");
+
+    const double serialMilliseconds = serialTimer.GetAverageDurationMilliseconds();
+
+    char buffer[256];
+    sprintf(buffer, "suite:BenchmarkPrimitiveBatchIntersect,benchmark:NxM%dx%d,method:serial,description:PrimitiveBatchIntersectNxM", num, num);
+    EATESTSendBenchmark(buffer, serialMilliseconds, serialTimer.GetMinDurationMilliseconds(), serialTimer.GetMaxDurationMilliseconds());
+    sprintf(buffer, "suite:BenchmarkPrimitiveBatchIntersect,benchmark:NxM%dx%d,method:tiled,description:PrimitiveBatchIntersectNxMTiled", num, num);
+    EATESTSendBenchmark(buffer, tiledTimer.GetAverageDurationMilliseconds(), tiledTimer.GetMinDurationMilliseconds(), tiledTimer.GetMaxDurationMilliseconds());
+
+    const uint32_t workerCounts[] = { 1u, 2u, 4u, maxWorkers };
+    const uint32_t numWorkerCounts = sizeof(workerCounts) / sizeof(workerCounts[0]);
+
+    for (uint32_t workerCountIndex = 0; workerCountIndex < numWorkerCounts; ++workerCountIndex)
+    {
+        const uint32_t numWorkers = workerCounts[workerCountIndex];
+        rw::collision::Tests::ThreadDispatcher dispatcher(numWorkers);
+
+        TileJob job;
+        job.instancingSPR = instancingSPR;
+        job.num = num;
+        job.tileSize = tileSize;
+        job.workerResBufs = workerResBufs;
+        job.workerResBufMaxSize = resBufMaxSize;
+        job.tileResBufs = tileResBufs;
+        job.tileMaxSizes = tileMaxSizes;
+        job.tileCounts = tileCounts;
+
+        rw::collision::Tests::BenchmarkTimer threadedTimer;
+        int32_t numMerged = 0, numWritten = 0;
+
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            for (uint32_t w = 0; w < maxWorkers; ++w)
+            {
+                job.workerPos[w] = 0;
+            }
+
+            threadedTimer.Start();
+            rw::collision::detail::PrimitiveBatchInstanceNxM(instancingSPR, vN, tN, num, vM, tM, num);
+            rw::collision::meshbuilder::detail::IParallelDispatcher::Run(&dispatcher, RunTiles, &job, (uint32_t) numTiles, 1u);
+            numMerged = rw::collision::detail::PrimitiveBatchIntersectNxMMergeTiles(results, resBufMaxSize,
+                tileResBufs, tileMaxSizes, tileCounts, numTiles, &numWritten);
+            threadedTimer.Stop();
+        }
+
+        EATESTAssert(numSerial == numMerged, "Threaded tiles found a different number of intersections.");
+        EATESTAssert(numWritten == numMerged, "Worker result buffers overflowed.");
+
+        const double threadedMilliseconds = threadedTimer.GetAverageDurationMilliseconds();
+        const double speedup = threadedMilliseconds > 0.0 ? (serialMilliseconds / threadedMilliseconds) : 0.0;
+
+        sprintf(buffer, "suite:BenchmarkPrimitiveBatchIntersect,benchmark:NxM%dx%d,method:threaded,description:Workers - %u - %d tiles - %.2fx serial",
+            num, num, numWorkers, numTiles, speedup);
+        EATESTSendBenchmark(buffer, threadedMilliseconds, threadedTimer.GetMinDurationMilliseconds(), threadedTimer.GetMaxDurationMilliseconds());
+    }
+
+    allocator->Free(workerResBufs);
+    allocator->Free(tileCounts);
+    allocator->Free(tileResBufs);
+    allocator->Free(instancingSPR);
+    allocator->Free(results);
+}
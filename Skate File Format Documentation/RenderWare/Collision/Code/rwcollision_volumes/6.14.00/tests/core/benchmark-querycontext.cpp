@@ -0,0 +1,204 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace
+{
+    const char *g_queryContextBenchmarkFilenames[] =
+    {
+        "courtyard.dat",
+        "skatemesh_compressed_quads_ids.dat"
+    };
+}
+
+// Benchmarks of creating a query for every call, either from the heap or from a QueryContext. Each call
+// creates a line query and a bbox query, as game code does for a ground probe, and releases them after.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+class BenchmarkQueryContext: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkQueryContext");
+
+        EATEST_REGISTER("BenchmarkPerCallQueries", "Queries created for every call against clustered meshes", BenchmarkQueryContext, BenchmarkPerCallQueries);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkPerCallQueries();
+
+} BenchmarkQueryContextSingleton;
+
+
+void BenchmarkQueryContext::BenchmarkPerCallQueries()
+{
+    const uint32_t numCalls = 1024;
+    const uint32_t numIterations = 5;
+    const uint32_t STACKSIZE = 1;
+    const uint32_t RESULTSSIZE = 64;
+    const float boxSize = 1.0f;
+
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+
+    for (uint32_t cm = 0; cm < EAArrayCount(g_queryContextBenchmarkFilenames); ++cm)
+    {
+        //Load ClusteredMesh
+        Volume *clusteredMeshVolume = LoadSerializedClusteredMesh(g_queryContextBenchmarkFilenames[cm]);
+        EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+        const Volume * volumeArray[] = { clusteredMeshVolume };
+
+        AABBox bbox;
+        clusteredMeshVolume->GetBBox(0, TRUE, bbox);
+        const Vector3 extent = bbox.Max() - bbox.Min();
+
+        // Probe positions from a fixed pseudo random sequence so the results are repeatable.
+        static Vector3 points[numCalls];
+        uint32_t seed = 12345u;
+        for (uint32_t i = 0; i < numCalls; ++i)
+        {
+            float r[2];
+            for (uint32_t k = 0; k < 2; ++k)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                r[k] = float(seed >> 8) / float(1u << 24);
+            }
+            points[i] = bbox.Min() + Vector3(r[0] * extent.GetX(), extent.GetY(), r[1] * extent.GetZ());
+        }
+        const Vector3 down(0.0f, -extent.GetY(), 0.0f);
+        const Vector3 pad(boxSize, boxSize, boxSize);
+
+        const EA::Physics::SizeAndAlignment lineDesc = VolumeLineQuery::GetResourceDescriptor(STACKSIZE, RESULTSSIZE);
+        const EA::Physics::SizeAndAlignment bboxDesc = VolumeBBoxQuery::GetResourceDescriptor(STACKSIZE, RESULTSSIZE);
+
+        // Queries from the heap
+        rw::collision::Tests::BenchmarkTimer heapTimer;
+        uint32_t heapAllocations = 0;
+        uint32_t heapHits = 0;
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            heapAllocations = 0;
+            heapHits = 0;
+            heapTimer.Start();
+            for (uint32_t i = 0; i < numCalls; ++i)
+            {
+                void *lineMemory = allocator->Alloc(lineDesc.GetSize(), NULL, 0, lineDesc.GetAlignment());
+                void *bboxMemory = allocator->Alloc(bboxDesc.GetSize(), NULL, 0, bboxDesc.GetAlignment());
+                heapAllocations += 2;
+
+                VolumeLineQuery *lineQuery = VolumeLineQuery::Initialize(EA::Physics::MemoryPtr(lineMemory), STACKSIZE, RESULTSSIZE);
+                VolumeBBoxQuery *bboxQuery = VolumeBBoxQuery::Initialize(EA::Physics::MemoryPtr(bboxMemory), STACKSIZE, RESULTSSIZE);
+
+                lineQuery->InitQuery(volumeArray, NULL, 1, points[i], points[i] + down);
+                const VolumeLineSegIntersectResult *result = lineQuery->GetNearestIntersection();
+                if (result)
+                {
+                    bboxQuery->InitQuery(volumeArray, NULL, 1, AABBox(result->position - pad, result->position + pad));
+                    heapHits += bboxQuery->GetOverlaps();
+                }
+
+                VolumeBBoxQuery::Release(bboxQuery);
+                VolumeLineQuery::Release(lineQuery);
+                allocator->Free(bboxMemory);
+                allocator->Free(lineMemory);
+            }
+            heapTimer.Stop();
+        }
+
+        // Queries from a context, sized from the high water mark of a first pass
+        uint32_t arenaSize = 0;
+        {
+            QueryContext *probe = QueryContext::Initialize(EA::Physics::MemoryPtr(allocator->Alloc(
+                QueryContext::GetResourceDescriptor(0).GetSize(), NULL, 0, rwcQUERYCONTEXT_ALIGNMENT)), 0);
+            {
+                QueryContext::Scope scope(*probe);
+                probe->CreateLineQuery(STACKSIZE, RESULTSSIZE);
+                probe->CreateBBoxQuery(STACKSIZE, RESULTSSIZE);
+            }
+            arenaSize = probe->GetRequiredSize();
+            QueryContext::Release(probe);
+            allocator->Free(probe);
+        }
+
+        const EA::Physics::SizeAndAlignment contextDesc = QueryContext::GetResourceDescriptor(arenaSize);
+        void *contextMemory = allocator->Alloc(contextDesc.GetSize(), NULL, 0, contextDesc.GetAlignment());
+        QueryContext *context = QueryContext::Initialize(EA::Physics::MemoryPtr(contextMemory), arenaSize);
+
+        rw::collision::Tests::BenchmarkTimer contextTimer;
+        uint32_t contextHits = 0;
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            contextHits = 0;
+            contextTimer.Start();
+            for (uint32_t i = 0; i < numCalls; ++i)
+            {
+                QueryContext::Scope scope(*context);
+                VolumeLineQuery *lineQuery = context->CreateLineQuery(STACKSIZE, RESULTSSIZE);
+                VolumeBBoxQuery *bboxQuery = context->CreateBBoxQuery(STACKSIZE, RESULTSSIZE);
+
+                lineQuery->InitQuery(volumeArray, NULL, 1, points[i], points[i] + down);
+                const VolumeLineSegIntersectResult *result = lineQuery->GetNearestIntersection();
+                if (result)
+                {
+                    bboxQuery->InitQuery(volumeArray, NULL, 1, AABBox(result->position - pad, result->position + pad));
+                    contextHits += bboxQuery->GetOverlaps();
+                }
+            }
+            contextTimer.Stop();
+        }
+
+        EATESTAssert(contextHits == heapHits, "Context queries should match the heap queries.");
+        EATESTAssert(0 == context->GetNumFailedRequests(), "Context should be large enough.");
+        EATESTAssert(context->GetHighWaterMark() == arenaSize, "Context should be sized from its high water mark.");
+
+        char buffer[256];
+        sprintf(buffer, "suite:BenchmarkQueryContext,benchmark:%s,method:Heap,description:%u calls with %u heap allocations",
+            g_queryContextBenchmarkFilenames[cm], numCalls, heapAllocations);
+        EATESTSendBenchmark(buffer, heapTimer.GetAverageDurationMilliseconds(), heapTimer.GetMinDurationMilliseconds(), heapTimer.GetMaxDurationMilliseconds());
+
+        sprintf(buffer, "suite:BenchmarkQueryContext,benchmark:%s,method:QueryContext,description:%u calls with 0 heap allocations and a %u byte arena",
+            g_queryContextBenchmarkFilenames[cm], numCalls, arenaSize);
+        EATESTSendBenchmark(buffer, contextTimer.GetAverageDurationMilliseconds(), contextTimer.GetMinDurationMilliseconds(), contextTimer.GetMaxDurationMilliseconds());
+
+        QueryContext::Release(context);
+        allocator->Free(contextMemory);
+        allocator->Free(aggVol->GetAggregate());
+        allocator->Free(aggVol);
+    }
+}
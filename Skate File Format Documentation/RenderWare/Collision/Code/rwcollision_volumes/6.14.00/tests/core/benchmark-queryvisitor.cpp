@@ -0,0 +1,370 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace
+{
+    const char *g_queryVisitorBenchmarkFilenames[] =
+    {
+        "courtyard.dat",
+        "skatemesh_compressed_quads_ids.dat"
+    };
+
+    struct CountIntersections
+    {
+        RwpBool operator()(const VolumeLineSegIntersectResult & /*result*/, float & /*endClip*/)
+        {
+            ++m_count;
+            return TRUE;
+        }
+        uint32_t m_count;
+    };
+
+    struct AnyIntersection
+    {
+        RwpBool operator()(const VolumeLineSegIntersectResult & /*result*/, float & /*endClip*/)
+        {
+            ++m_count;
+            return FALSE;
+        }
+        uint32_t m_count;
+    };
+
+    struct CountOverlaps
+    {
+        RwpBool operator()(const VolRef & /*vRef*/)
+        {
+            ++m_count;
+            return TRUE;
+        }
+        uint32_t m_count;
+    };
+}
+
+// Benchmarks of the streaming visitor mode of the line and bbox queries against the buffered mode, for
+// "any hit" probes and for enumerating every hit.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+class BenchmarkQueryVisitor: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkQueryVisitor");
+
+        EATEST_REGISTER("BenchmarkLineAnyHit", "Any hit line queries against clustered meshes", BenchmarkQueryVisitor, BenchmarkLineAnyHit);
+        EATEST_REGISTER("BenchmarkLineEnumeration", "Line queries enumerating every hit against clustered meshes", BenchmarkQueryVisitor, BenchmarkLineEnumeration);
+        EATEST_REGISTER("BenchmarkBBoxEnumeration", "BBox queries enumerating every overlap against clustered meshes", BenchmarkQueryVisitor, BenchmarkBBoxEnumeration);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkLineAnyHit();
+    void BenchmarkLineEnumeration();
+    void BenchmarkBBoxEnumeration();
+
+    static const uint32_t NUMQUERIES = 1024;
+    static const uint32_t NUMITERATIONS = 5;
+
+    /// Gets lines crossing the mesh from above, from a fixed pseudo random sequence so the results are repeatable.
+    static void GetLines(const AABBox &bbox, Vector3 *starts, Vector3 *ends)
+    {
+        const Vector3 extent = bbox.Max() - bbox.Min();
+        uint32_t seed = 12345u;
+        for (uint32_t i = 0; i < NUMQUERIES; ++i)
+        {
+            float r[4];
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                r[k] = float(seed >> 8) / float(1u << 24);
+            }
+            starts[i] = bbox.Min() + Vector3(r[0] * extent.GetX(), extent.GetY() + 1.0f, r[1] * extent.GetZ());
+            ends[i] = bbox.Min() + Vector3(r[2] * extent.GetX(), -1.0f, r[3] * extent.GetZ());
+        }
+    }
+
+    void SendBenchmark(const char *filename, const char *method, uint32_t numHits,
+                       rw::collision::Tests::BenchmarkTimer &timer)
+    {
+        char buffer[256];
+        sprintf(buffer, "suite:BenchmarkQueryVisitor,benchmark:%s,method:%s,description:%u queries with %u hits",
+            filename, method, NUMQUERIES, numHits);
+        EATESTSendBenchmark(buffer, timer.GetAverageDurationMilliseconds(), timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+    }
+
+} BenchmarkQueryVisitorSingleton;
+
+
+void BenchmarkQueryVisitor::BenchmarkLineAnyHit()
+{
+    const uint32_t STACKSIZE = 1;
+
+    for (uint32_t cm = 0; cm < EAArrayCount(g_queryVisitorBenchmarkFilenames); ++cm)
+    {
+        //Load ClusteredMesh
+        Volume *clusteredMeshVolume = LoadSerializedClusteredMesh(g_queryVisitorBenchmarkFilenames[cm]);
+        EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+        const Volume * volumeArray[] = { clusteredMeshVolume };
+
+        AABBox bbox;
+        clusteredMeshVolume->GetBBox(0, TRUE, bbox);
+        static Vector3 starts[NUMQUERIES];
+        static Vector3 ends[NUMQUERIES];
+        GetLines(bbox, starts, ends);
+
+        VolumeLineQuery *bufferedQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 256u);
+        VolumeLineQuery *visitorQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 1u);
+
+        rw::collision::Tests::BenchmarkTimer bufferedTimer;
+        uint32_t bufferedHits = 0;
+        for (uint32_t it = 0; it < NUMITERATIONS; ++it)
+        {
+            bufferedHits = 0;
+            bufferedTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                bufferedQuery->InitQuery(volumeArray, NULL, 1, starts[i], ends[i]);
+                if (bufferedQuery->GetAnyIntersection())
+                {
+                    ++bufferedHits;
+                }
+            }
+            bufferedTimer.Stop();
+        }
+
+        rw::collision::Tests::BenchmarkTimer visitorTimer;
+        uint32_t visitorHits = 0;
+        for (uint32_t it = 0; it < NUMITERATIONS; ++it)
+        {
+            AnyIntersection visitor = { 0 };
+            visitorTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                visitorQuery->InitQuery(volumeArray, NULL, 1, starts[i], ends[i]);
+                visitorQuery->VisitIntersections(visitor);
+            }
+            visitorTimer.Stop();
+            visitorHits = visitor.m_count;
+        }
+
+        EATESTAssert(visitorHits == bufferedHits, "Visitor should find the same hits as the buffered query.");
+
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "GetAnyIntersection", bufferedHits, bufferedTimer);
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "VisitIntersections", visitorHits, visitorTimer);
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(visitorQuery);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bufferedQuery);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol->GetAggregate());
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    }
+}
+
+
+void BenchmarkQueryVisitor::BenchmarkLineEnumeration()
+{
+    const uint32_t STACKSIZE = 1;
+    const uint32_t BATCHSIZE = 16;
+
+    for (uint32_t cm = 0; cm < EAArrayCount(g_queryVisitorBenchmarkFilenames); ++cm)
+    {
+        //Load ClusteredMesh
+        Volume *clusteredMeshVolume = LoadSerializedClusteredMesh(g_queryVisitorBenchmarkFilenames[cm]);
+        EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+        const Volume * volumeArray[] = { clusteredMeshVolume };
+
+        AABBox bbox;
+        clusteredMeshVolume->GetBBox(0, TRUE, bbox);
+        static Vector3 starts[NUMQUERIES];
+        static Vector3 ends[NUMQUERIES];
+        GetLines(bbox, starts, ends);
+
+        VolumeLineQuery *bufferedQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 256u);
+        VolumeLineQuery *visitorQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, BATCHSIZE);
+
+        rw::collision::Tests::BenchmarkTimer bufferedTimer;
+        uint32_t bufferedHits = 0;
+        for (uint32_t it = 0; it < NUMITERATIONS; ++it)
+        {
+            bufferedHits = 0;
+            bufferedTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                bufferedQuery->InitQuery(volumeArray, NULL, 1, starts[i], ends[i]);
+                while (!bufferedQuery->Finished())
+                {
+                    bufferedHits += bufferedQuery->GetAllIntersections();
+                }
+            }
+            bufferedTimer.Stop();
+        }
+
+        rw::collision::Tests::BenchmarkTimer singleTimer;
+        rw::collision::Tests::BenchmarkTimer batchTimer;
+        uint32_t singleHits = 0;
+        uint32_t batchHits = 0;
+        for (uint32_t it = 0; it < NUMITERATIONS; ++it)
+        {
+            CountIntersections single = { 0 };
+            singleTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                visitorQuery->InitQuery(volumeArray, NULL, 1, starts[i], ends[i]);
+                visitorQuery->VisitIntersections(single);
+            }
+            singleTimer.Stop();
+            singleHits = single.m_count;
+
+            CountIntersections batch = { 0 };
+            batchTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                visitorQuery->InitQuery(volumeArray, NULL, 1, starts[i], ends[i]);
+                visitorQuery->VisitIntersections(batch, BATCHSIZE);
+            }
+            batchTimer.Stop();
+            batchHits = batch.m_count;
+        }
+
+        EATESTAssert(singleHits == bufferedHits, "Visitor should find the same hits as the buffered query.");
+        EATESTAssert(batchHits == bufferedHits, "Batched visitor should find the same hits as the buffered query.");
+
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "GetAllIntersections", bufferedHits, bufferedTimer);
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "VisitIntersections batch 1", singleHits, singleTimer);
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "VisitIntersections batch 16", batchHits, batchTimer);
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(visitorQuery);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bufferedQuery);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol->GetAggregate());
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    }
+}
+
+
+void BenchmarkQueryVisitor::BenchmarkBBoxEnumeration()
+{
+    const uint32_t STACKSIZE = 1;
+    const uint32_t BATCHSIZE = 16;
+    const float boxSize = 2.0f;
+
+    for (uint32_t cm = 0; cm < EAArrayCount(g_queryVisitorBenchmarkFilenames); ++cm)
+    {
+        //Load ClusteredMesh
+        Volume *clusteredMeshVolume = LoadSerializedClusteredMesh(g_queryVisitorBenchmarkFilenames[cm]);
+        EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+        const Volume * volumeArray[] = { clusteredMeshVolume };
+
+        AABBox bbox;
+        clusteredMeshVolume->GetBBox(0, TRUE, bbox);
+
+        // Boxes centred on the start of each line, which lie just above the mesh
+        static Vector3 starts[NUMQUERIES];
+        static Vector3 ends[NUMQUERIES];
+        GetLines(bbox, starts, ends);
+        static AABBox boxes[NUMQUERIES];
+        const Vector3 extent = bbox.Max() - bbox.Min();
+        for (uint32_t i = 0; i < NUMQUERIES; ++i)
+        {
+            const Vector3 centre(starts[i].GetX(), bbox.Min().GetY() + 0.5f * extent.GetY(), starts[i].GetZ());
+            const Vector3 half(boxSize, 0.5f * extent.GetY(), boxSize);
+            boxes[i] = AABBox(centre - half, centre + half);
+        }
+
+        VolumeBBoxQuery *bufferedQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, 4096u);
+        VolumeBBoxQuery *visitorQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, BATCHSIZE);
+
+        rw::collision::Tests::BenchmarkTimer bufferedTimer;
+        uint32_t bufferedHits = 0;
+        for (uint32_t it = 0; it < NUMITERATIONS; ++it)
+        {
+            bufferedHits = 0;
+            bufferedTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                bufferedQuery->InitQuery(volumeArray, NULL, 1, boxes[i]);
+                while (!bufferedQuery->Finished())
+                {
+                    bufferedHits += bufferedQuery->GetOverlaps();
+                }
+            }
+            bufferedTimer.Stop();
+        }
+
+        rw::collision::Tests::BenchmarkTimer singleTimer;
+        rw::collision::Tests::BenchmarkTimer batchTimer;
+        uint32_t singleHits = 0;
+        uint32_t batchHits = 0;
+        for (uint32_t it = 0; it < NUMITERATIONS; ++it)
+        {
+            CountOverlaps single = { 0 };
+            singleTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                visitorQuery->InitQuery(volumeArray, NULL, 1, boxes[i]);
+                visitorQuery->VisitOverlaps(single);
+            }
+            singleTimer.Stop();
+            singleHits = single.m_count;
+
+            CountOverlaps batch = { 0 };
+            batchTimer.Start();
+            for (uint32_t i = 0; i < NUMQUERIES; ++i)
+            {
+                visitorQuery->InitQuery(volumeArray, NULL, 1, boxes[i]);
+                visitorQuery->VisitOverlaps(batch, BATCHSIZE);
+            }
+            batchTimer.Stop();
+            batchHits = batch.m_count;
+        }
+
+        EATESTAssert(singleHits == bufferedHits, "Visitor should find the same overlaps as the buffered query.");
+        EATESTAssert(batchHits == bufferedHits, "Batched visitor should find the same overlaps as the buffered query.");
+
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "GetOverlaps", bufferedHits, bufferedTimer);
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "VisitOverlaps batch 1", singleHits, singleTimer);
+        SendBenchmark(g_queryVisitorBenchmarkFilenames[cm], "VisitOverlaps batch 16", batchHits, batchTimer);
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(visitorQuery);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bufferedQuery);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol->GetAggregate());
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    }
+}
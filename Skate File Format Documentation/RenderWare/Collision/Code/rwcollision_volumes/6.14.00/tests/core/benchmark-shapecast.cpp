@@ -0,0 +1,158 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "benchmark_timer.hpp"
+
+#include "stdio.h"     // for sprintf()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace
+{
+    const char *g_shapeCastBenchmarkFilenames[] =
+    {
+        "courtyard.dat",
+        "skatemesh_compressed_quads_ids.dat"
+    };
+}
+
+// Benchmarks of sphere, capsule and box casts against clustered meshes, reported as casts per second.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+class BenchmarkShapeCast: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("BenchmarkShapeCast");
+
+        EATEST_REGISTER("BenchmarkSphereCast", "Sphere casts against clustered meshes", BenchmarkShapeCast, BenchmarkSphereCast);
+        EATEST_REGISTER("BenchmarkCapsuleCast", "Capsule casts against clustered meshes", BenchmarkShapeCast, BenchmarkCapsuleCast);
+        EATEST_REGISTER("BenchmarkBoxCast", "Box casts against clustered meshes", BenchmarkShapeCast, BenchmarkBoxCast);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void BenchmarkSphereCast()  { BenchmarkCast(CastShape::SPHERE, "sphere"); }
+    void BenchmarkCapsuleCast() { BenchmarkCast(CastShape::CAPSULE, "capsule"); }
+    void BenchmarkBoxCast()     { BenchmarkCast(CastShape::BOX, "box"); }
+
+    void BenchmarkCast(CastShape::Type type, const char *typeName);
+
+} BenchmarkShapeCastSingleton;
+
+
+void BenchmarkShapeCast::BenchmarkCast(CastShape::Type type, const char *typeName)
+{
+    const uint32_t numCasts = 1024;
+    const uint32_t numIterations = 5;
+
+    for (uint32_t cm = 0; cm < EAArrayCount(g_shapeCastBenchmarkFilenames); ++cm)
+    {
+        //Load ClusteredMesh
+        Volume *clusteredMeshVolume = LoadSerializedClusteredMesh(g_shapeCastBenchmarkFilenames[cm]);
+        EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+        ClusteredMesh *mesh = static_cast<ClusteredMesh *>(aggVol->GetAggregate());
+
+        AABBox bbox;
+        clusteredMeshVolume->GetBBox(0, TRUE, bbox);
+        const Vector3 extent = bbox.Max() - bbox.Min();
+
+        // Casts from above the mesh, downwards and across, from a fixed pseudo random sequence so the
+        // results are repeatable.
+        static CastShape shapes[numCasts];
+        static Vector3 deltas[numCasts];
+        uint32_t seed = 12345u;
+        for (uint32_t i = 0; i < numCasts; ++i)
+        {
+            float r[5];
+            for (uint32_t k = 0; k < 5; ++k)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                r[k] = float(seed >> 8) / float(1u << 24);
+            }
+
+            const Vector3 start(bbox.Min().GetX() + r[0] * extent.GetX(),
+                                bbox.Max().GetY(),
+                                bbox.Min().GetZ() + r[1] * extent.GetZ());
+            deltas[i] = Vector3((r[2] - 0.5f) * 0.25f * extent.GetX(), -extent.GetY() - 1.0f, (r[3] - 0.5f) * 0.25f * extent.GetZ());
+
+            const float radius = 0.1f + 0.4f * r[4];
+            if (type == CastShape::SPHERE)
+            {
+                shapes[i] = CastShape::Sphere(start, radius);
+            }
+            else if (type == CastShape::CAPSULE)
+            {
+                shapes[i] = CastShape::Capsule(start, GetVector3_YAxis(), 2.0f * radius, radius);
+            }
+            else
+            {
+                const Matrix44Affine boxTm(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), start);
+                shapes[i] = CastShape::Box(boxTm, Vector3(radius, 2.0f * radius, radius));
+            }
+        }
+
+        rw::collision::Tests::BenchmarkTimer timer;
+        uint32_t numHits = 0;
+
+        for (uint32_t it = 0; it < numIterations; ++it)
+        {
+            numHits = 0;
+            timer.Start();
+            for (uint32_t i = 0; i < numCasts; ++i)
+            {
+                ShapeCastResult result;
+                numHits += mesh->ShapeCast(result, shapes[i], deltas[i], NULL) ? 1u : 0u;
+            }
+            timer.Stop();
+        }
+
+        EATESTAssert(numHits, "No casts hit the mesh.");
+
+        char buffer[256];
+        sprintf(buffer, "suite:BenchmarkShapeCast,benchmark:%s,method:%s,description:%u casts of which %u hit",
+            g_shapeCastBenchmarkFilenames[cm], typeName, numCasts, numHits);
+        EATESTSendBenchmark(buffer, timer.GetAverageDurationMilliseconds(), timer.GetMinDurationMilliseconds(), timer.GetMaxDurationMilliseconds());
+
+        const double castsPerSecond = (double) numCasts * 1000.0 / timer.GetAverageDurationMilliseconds();
+        sprintf(buffer, "suite:BenchmarkShapeCast,benchmark:%s,method:%s,description:casts per second",
+            g_shapeCastBenchmarkFilenames[cm], typeName);
+        EATESTSendBenchmark(buffer, castsPerSecond);
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(mesh);
+    }
+}
@@ -99,12 +99,15 @@ public:     // TestSuite overrides
         REGISTER_CLUSTER_TEST(TestSetVertexOffset16BitCompression, "Check SetVertexOffset() 16Bit Compression");
         REGISTER_CLUSTER_TEST(TestSetVertexOffset32BitCompression, "Check SetVertexOffset() 32Bit Compression");
         REGISTER_CLUSTER_TEST(TestSetVertexOffsetNoCompression, "Check SetVertexOffset() No Compression");
+        REGISTER_CLUSTER_TEST(TestSetVertexOffset8BitCompression, "Check SetVertexOffset() 8Bit Compression");
 
         // SetVertex Method unit tests
         REGISTER_CLUSTER_TEST(TestSetVertex16BitCompression, "Check SetVertex() 16Bit Compression");
         REGISTER_CLUSTER_TEST(TestSetVertex32BitCompression, "Check SetVertex() 32Bit Compression");
         REGISTER_CLUSTER_TEST(TestSetVertexNoCompressionSingle, "Check SetVertex() No Compression Single Vertex");
         REGISTER_CLUSTER_TEST(TestSetVertexNoCompressionMultiple, "Check SetVertex() No Compression Multiple Vertices");
+        REGISTER_CLUSTER_TEST(TestSetVertex8BitCompression, "Check SetVertex() 8Bit Compression");
+        REGISTER_CLUSTER_TEST(TestSetVertex10BitCompression, "Check SetVertex() 10Bit Compression");
 
         // SetTriangle Method unit tests
         REGISTER_CLUSTER_TEST(TestSetTriangle, "Check SetTriangle()");
@@ -205,12 +208,15 @@ private:
     void TestSetVertexOffset16BitCompression();
     void TestSetVertexOffset32BitCompression();
     void TestSetVertexOffsetNoCompression();
+    void TestSetVertexOffset8BitCompression();
 
     // SetVertex unit tests
     void TestSetVertex16BitCompression();
     void TestSetVertex32BitCompression();
     void TestSetVertexNoCompressionSingle();
     void TestSetVertexNoCompressionMultiple();
+    void TestSetVertex8BitCompression();
+    void TestSetVertex10BitCompression();
 
     // SetTriangle unit tests
     void TestSetTriangle();
@@ -1349,6 +1355,41 @@ TestCluster::TestSetVertexOffsetNoCompression()
     }
     }
 
+void
+TestCluster::TestSetVertexOffset8BitCompression()
+{
+    rw::collision::ClusterConstructionParameters parameters;
+
+    parameters.mVertexCount = 1;
+    parameters.mVertexCompressionMode = rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED;
+    parameters.mTriangleUnitCount = 0;
+
+    const uint16_t size = rw::collision::ClusteredMeshCluster::GetSize(parameters);
+
+    void * buffer = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(size, NULL, 0, rwcCLUSTEREDMESHCLUSTER_ALIGNMENT);
+
+    if (NULL != buffer)
+    {
+        rw::collision::ClusteredMeshCluster * cluster = rw::collision::ClusteredMeshCluster::Initialize(buffer, parameters);
+
+        rw::collision::ClusteredMeshCluster::Vertex32 expectedOffset;
+        expectedOffset.x = (uint32_t)1.0f;
+        expectedOffset.y = (uint32_t)4.0f;
+        expectedOffset.z = (uint32_t)9.0f;
+
+        cluster->SetVertexOffset(expectedOffset, 3u);
+
+        rw::collision::ClusteredMeshCluster::CompressedVertexDataUnion vdUnion;
+        vdUnion.m_as_rwpmathVector3Ptr = cluster->vertexArray;
+        const rw::collision::ClusteredMeshCluster::VertexHeader *actualHeader = vdUnion.m_asVertexHeaderPtr;
+
+        CheckValue<const rw::collision::ClusteredMeshCluster::Vertex32&>(actualHeader->offset, expectedOffset, "Cluster vertex offset");
+        CheckValue<uint32_t>(actualHeader->granularityShift, 3u, "Cluster granularity shift");
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(buffer);
+    }
+    }
+
 void
 TestCluster::TestSetVertex16BitCompression()
 {
@@ -1423,6 +1464,97 @@ TestCluster::TestSetVertex32BitCompression()
     }
     }
 
+void
+TestCluster::TestSetVertex8BitCompression()
+{
+    rw::collision::ClusterConstructionParameters parameters;
+
+    parameters.mVertexCount = 2;
+    parameters.mVertexCompressionMode = rw::collision::ClusteredMeshCluster::VERTICES_8BIT_COMPRESSED;
+    parameters.mTriangleUnitCount = 0;
+
+    const uint16_t size = rw::collision::ClusteredMeshCluster::GetSize(parameters);
+
+    void * buffer = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(size, NULL, 0, rwcCLUSTEREDMESHCLUSTER_ALIGNMENT);
+
+    if (NULL != buffer)
+    {
+        rw::collision::ClusteredMeshCluster * cluster = rw::collision::ClusteredMeshCluster::Initialize(buffer, parameters);
+
+        rw::collision::ClusteredMeshCluster::Vertex32 offset;
+        offset.x = (uint32_t)9.0f;
+        offset.y = (uint32_t)19.0f;
+        offset.z = (uint32_t)29.0f;
+
+        cluster->SetVertexOffset(offset);
+
+        float compressionGranularity(1.0f);
+        rwpmath::Vector3 expectedVertex0(10.0f, 20.0f, 30.0f);
+        rwpmath::Vector3 expectedVertex1(264.0f, 200.0f, 31.0f);
+
+        cluster->SetVertex(expectedVertex0, compressionGranularity);
+        cluster->SetVertex(expectedVertex1, compressionGranularity);
+
+        CheckValue<uint32_t>(cluster->vertexCount, 2u, "Vertex count");
+
+        rwpmath::Vector3 actualVertex0 = cluster->GetVertex(0, compressionGranularity);
+        rwpmath::Vector3 actualVertex1 = cluster->GetVertex(1, compressionGranularity);
+
+        CheckValue<rwpmath::Vector3::InParam>(actualVertex0, expectedVertex0, "Vertex 0");
+        CheckValue<rwpmath::Vector3::InParam>(actualVertex1, expectedVertex1, "Vertex 1");
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(buffer);
+    }
+    }
+
+void
+TestCluster::TestSetVertex10BitCompression()
+{
+    rw::collision::ClusterConstructionParameters parameters;
+
+    parameters.mVertexCount = 2;
+    parameters.mVertexCompressionMode = rw::collision::ClusteredMeshCluster::VERTICES_10BIT_COMPRESSED;
+    parameters.mTriangleUnitCount = 0;
+
+    const uint16_t size = rw::collision::ClusteredMeshCluster::GetSize(parameters);
+
+    void * buffer = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(size, NULL, 0, rwcCLUSTEREDMESHCLUSTER_ALIGNMENT);
+
+    if (NULL != buffer)
+    {
+        rw::collision::ClusteredMeshCluster * cluster = rw::collision::ClusteredMeshCluster::Initialize(buffer, parameters);
+
+        rw::collision::ClusteredMeshCluster::Vertex32 offset;
+        offset.x = (uint32_t)10.0f;
+        offset.y = (uint32_t)20.0f;
+        offset.z = (uint32_t)30.0f;
+
+        // A cluster granularity of four times the mesh granularity
+        cluster->SetVertexOffset(offset, 2u);
+
+        float compressionGranularity(1.0f);
+        rwpmath::Vector3 vertex0(410.0f, 822.0f, 4030.0f);
+        rwpmath::Vector3 vertex1(10.0f, 21.0f, 33.0f);
+
+        cluster->SetVertex(vertex0, compressionGranularity);
+        cluster->SetVertex(vertex1, compressionGranularity);
+
+        CheckValue<uint32_t>(cluster->vertexCount, 2u, "Vertex count");
+
+        // Components are rounded to the nearest multiple of four above the offset
+        rwpmath::Vector3 expectedVertex0(410.0f, 824.0f, 4030.0f);
+        rwpmath::Vector3 expectedVertex1(10.0f, 20.0f, 34.0f);
+
+        rwpmath::Vector3 actualVertex0 = cluster->GetVertex(0, compressionGranularity);
+        rwpmath::Vector3 actualVertex1 = cluster->GetVertex(1, compressionGranularity);
+
+        CheckValue<rwpmath::Vector3::InParam>(actualVertex0, expectedVertex0, "Vertex 0");
+        CheckValue<rwpmath::Vector3::InParam>(actualVertex1, expectedVertex1, "Vertex 1");
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(buffer);
+    }
+    }
+
 void
 TestCluster::TestSetVertexNoCompressionSingle()
 {
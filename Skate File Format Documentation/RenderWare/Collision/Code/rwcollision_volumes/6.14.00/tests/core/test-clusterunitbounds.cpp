@@ -0,0 +1,307 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include <rw/collision/clusterunitbounds.h>
+#include <rw/collision/clustertriangleiterator.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Unit tests for the quantized unit bounds of a clustered mesh.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+class TestClusterUnitBounds: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestClusterUnitBounds");
+
+#define CLUSTER_UNIT_BOUNDS_TEST(F, D) EATEST_REGISTER(#F, D, TestClusterUnitBounds, F)
+
+        CLUSTER_UNIT_BOUNDS_TEST(TestResourceDescriptor, "Test the memory reserved for unit bounds in a clustered mesh");
+        CLUSTER_UNIT_BOUNDS_TEST(TestBuild8Bit, "Test building 8 bit unit bounds for a clustered mesh");
+        CLUSTER_UNIT_BOUNDS_TEST(TestBuild16Bit, "Test building 16 bit unit bounds for a clustered mesh");
+        CLUSTER_UNIT_BOUNDS_TEST(TestLineQuery, "Test line queries find the same triangles with unit bounds");
+        CLUSTER_UNIT_BOUNDS_TEST(TestBBoxQuery, "Test bbox queries find the same triangles with unit bounds");
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+
+        m_meshVolume = LoadSerializedClusteredMesh("courtyard.dat");
+        m_meshVolume->GetBBox(0, TRUE, m_meshBBox);
+        m_mesh = static_cast<ClusteredMesh *>(static_cast<AggregateVolume *>(m_meshVolume)->GetAggregate());
+    }
+
+    virtual void TeardownSuite()
+    {
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(m_meshVolume);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol->GetAggregate());
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestResourceDescriptor();
+    void TestBuild8Bit();
+    void TestBuild16Bit();
+    void TestLineQuery();
+    void TestBBoxQuery();
+
+    ClusterUnitBounds *CreateUnitBounds(uint32_t format);
+    void DestroyUnitBounds(ClusterUnitBounds *unitBounds);
+    void CheckBuild(uint32_t format);
+    uint32_t GetLineHits(const Vector3 &start, const Vector3 &end, VolumeLineQuery *query);
+    uint32_t GetBBoxOverlaps(const AABBox &bbox, VolumeBBoxQuery *query);
+
+    Volume *m_meshVolume;
+    ClusteredMesh *m_mesh;
+    AABBox m_meshBBox;
+
+} TestClusterUnitBoundsSingleton;
+
+
+ClusterUnitBounds *
+TestClusterUnitBounds::CreateUnitBounds(uint32_t format)
+{
+    ClusterUnitBounds::ObjectDescriptor objDesc(m_mesh->GetNumCluster(), m_mesh->GetNumUnits(), format);
+    const EA::Physics::SizeAndAlignment resDesc = ClusterUnitBounds::GetResourceDescriptor(objDesc);
+    void *memory = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+    ClusterUnitBounds *unitBounds = ClusterUnitBounds::Initialize(EA::Physics::MemoryPtr(memory), objDesc);
+    unitBounds->Build(*m_mesh);
+    return unitBounds;
+}
+
+
+void
+TestClusterUnitBounds::DestroyUnitBounds(ClusterUnitBounds *unitBounds)
+{
+    unitBounds->Release();
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(unitBounds);
+}
+
+
+void TestClusterUnitBounds::TestResourceDescriptor()
+{
+    const ClusteredMesh::ObjectDescriptor plain = m_mesh->GetObjectDescriptor();
+    EATESTAssert(ClusterUnitBounds::FORMAT_NONE == plain.m_unitBoundsFormat, "Loaded mesh should have no unit bounds.");
+
+    ClusteredMesh::ObjectDescriptor with8Bit(plain);
+    with8Bit.m_unitBoundsFormat = ClusterUnitBounds::FORMAT_8BIT;
+    ClusteredMesh::ObjectDescriptor with16Bit(plain);
+    with16Bit.m_unitBoundsFormat = ClusterUnitBounds::FORMAT_16BIT;
+
+    const uint32_t plainSize = ClusteredMesh::GetResourceDescriptor(plain).GetSize();
+    const uint32_t size8Bit = ClusteredMesh::GetResourceDescriptor(with8Bit).GetSize();
+    const uint32_t size16Bit = ClusteredMesh::GetResourceDescriptor(with16Bit).GetSize();
+
+    const uint32_t boundsSize8Bit = ClusterUnitBounds::GetResourceDescriptor(
+        ClusterUnitBounds::ObjectDescriptor(plain.m_maxClusters, plain.m_maxUnits, ClusterUnitBounds::FORMAT_8BIT)).GetSize();
+    EATESTAssert(size8Bit >= plainSize + boundsSize8Bit, "Mesh should reserve space for 8 bit unit bounds.");
+    EATESTAssert(size16Bit > size8Bit, "16 bit unit bounds should be larger than 8 bit.");
+
+    // 32 bytes per cluster and 8 bytes per unit, plus the header and padding
+    EATESTAssert(boundsSize8Bit >= 32u * plain.m_maxClusters + 8u * plain.m_maxUnits, "8 bit bounds size.");
+    EATESTAssert(boundsSize8Bit <= 32u * plain.m_maxClusters + 8u * plain.m_maxUnits + 128u, "8 bit bounds size.");
+}
+
+
+void TestClusterUnitBounds::CheckBuild(uint32_t format)
+{
+    ClusterUnitBounds *unitBounds = CreateUnitBounds(format);
+
+    EATESTAssert(unitBounds->IsValid(), "Unit bounds should be valid.");
+    EATESTAssert(unitBounds->GetFormat() == format, "Unit bounds should keep their format.");
+    EATESTAssert(unitBounds->GetNumClusters() == m_mesh->GetNumCluster(), "Every cluster should have bounds.");
+    EATESTAssert(unitBounds->GetNumUnits() == m_mesh->GetNumUnits(), "Every unit should have bounds.");
+
+    const ClusterParams &clusterParams = m_mesh->GetClusterParams();
+    for (uint32_t clusterIndex = 0; clusterIndex < m_mesh->GetNumCluster(); ++clusterIndex)
+    {
+        const ClusterUnitBounds::ClusterEntry &entry = unitBounds->GetClusterEntry(clusterIndex);
+        EATESTAssert(entry.m_numUnits == m_mesh->GetNumUnitInCluster(clusterIndex), "Cluster should have bounds for all its units.");
+
+        // Each unit can be found from its offset, and its bounds contain its triangles
+        uint32_t unitIndex = 0;
+        for (ClusterTriangleIterator<> cti(m_mesh->GetCluster(clusterIndex), clusterParams); !cti.AtEnd(); cti.Next())
+        {
+            if (cti.GetNumTrianglesLeftInCurrentUnit() == cti.GetUnit().GetTriCount())
+            {
+                EATESTAssert(unitBounds->FindUnit(clusterIndex, cti.GetOffset()) == unitIndex, "Unit should be found from its offset.");
+            }
+
+            Vector3 v0, v1, v2;
+            cti.GetVertices(v0, v1, v2);
+            const AABBox triBBox(Min(Min(v0, v1), v2), Max(Max(v0, v1), v2));
+            const uint32_t mask = unitBounds->GetBBoxOverlapMask(clusterIndex, unitIndex, 1u, triBBox);
+            EATESTAssert(mask & 1u, "Unit bounds should overlap the bounds of its triangles.");
+
+            const uint32_t lineMask = unitBounds->GetLineOverlapMask(clusterIndex, unitIndex, 1u, v0, v1 - v0, 1.0f, 0.0f);
+            EATESTAssert(lineMask & 1u, "Unit bounds should be hit by an edge of its triangles.");
+
+            if (cti.GetNumTrianglesLeftInCurrentUnit() == 1u)
+            {
+                ++unitIndex;
+            }
+        }
+        EATESTAssert(unitIndex == entry.m_numUnits, "Cluster should have bounds for all its units.");
+
+        // A box outside the cluster misses all its units
+        const Vector3 outside = m_meshBBox.Max() + Vector3(10.0f, 10.0f, 10.0f);
+        const uint32_t numUnits = (entry.m_numUnits < ClusterUnitBounds::MAX_MASK_UNITS) ?
+            entry.m_numUnits : ClusterUnitBounds::MAX_MASK_UNITS;
+        const uint32_t mask = unitBounds->GetBBoxOverlapMask(clusterIndex, 0u, numUnits,
+            AABBox(outside, outside + Vector3(1.0f, 1.0f, 1.0f)));
+        const uint32_t testedMask = (numUnits < 32u) ? ((1u << numUnits) - 1u) : ~0u;
+        EATESTAssert(0 == (mask & testedMask), "Box outside the mesh should miss every unit.");
+        EATESTAssert(~0u == (mask | testedMask), "Units after the tested ones should be reported as possible overlaps.");
+    }
+
+    DestroyUnitBounds(unitBounds);
+}
+
+
+void TestClusterUnitBounds::TestBuild8Bit()
+{
+    CheckBuild(ClusterUnitBounds::FORMAT_8BIT);
+}
+
+
+void TestClusterUnitBounds::TestBuild16Bit()
+{
+    CheckBuild(ClusterUnitBounds::FORMAT_16BIT);
+}
+
+
+uint32_t
+TestClusterUnitBounds::GetLineHits(const Vector3 &start, const Vector3 &end, VolumeLineQuery *query)
+{
+    const Volume *volumes[] = { m_meshVolume };
+    query->InitQuery(volumes, NULL, 1, start, end);
+    const uint32_t numRes = query->GetAllIntersections();
+    EATESTAssert(query->Finished(), "Query should complete in one call.");
+    return numRes;
+}
+
+
+uint32_t
+TestClusterUnitBounds::GetBBoxOverlaps(const AABBox &bbox, VolumeBBoxQuery *query)
+{
+    const Volume *volumes[] = { m_meshVolume };
+    query->InitQuery(volumes, NULL, 1, bbox);
+    uint32_t numOverlaps = 0;
+    while (!query->Finished())
+    {
+        numOverlaps += query->GetOverlaps();
+    }
+    return numOverlaps;
+}
+
+
+void TestClusterUnitBounds::TestLineQuery()
+{
+    const uint32_t STACKSIZE = 1;
+    const uint32_t RESULTSSIZE = 256;
+    VolumeLineQuery *query = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, RESULTSSIZE);
+
+    ClusterUnitBounds *unitBounds[2] = { CreateUnitBounds(ClusterUnitBounds::FORMAT_8BIT),
+                                         CreateUnitBounds(ClusterUnitBounds::FORMAT_16BIT) };
+
+    // A grid of vertical and diagonal lines across the mesh
+    const Vector3 extent = m_meshBBox.Max() - m_meshBBox.Min();
+    const uint32_t gridSize = 8;
+    for (uint32_t i = 0; i < gridSize; ++i)
+    {
+        for (uint32_t j = 0; j < gridSize; ++j)
+        {
+            const float x = (float(i) + 0.5f) / float(gridSize);
+            const float z = (float(j) + 0.5f) / float(gridSize);
+            const Vector3 start = m_meshBBox.Min() + Vector3(x * extent.GetX(), extent.GetY() + 1.0f, z * extent.GetZ());
+            const Vector3 end = m_meshBBox.Min() + Vector3((1.0f - z) * extent.GetX(), -1.0f, x * extent.GetZ());
+
+            m_mesh->SetClusterUnitBounds(NULL);
+            const uint32_t numRes = GetLineHits(start, start + Vector3(0.0f, -extent.GetY() - 2.0f, 0.0f), query);
+            const uint32_t numDiagonalRes = GetLineHits(start, end, query);
+            const uint32_t numTriangles = query->GetCounters().m_counts[QueryCounters::TRIANGLES];
+
+            for (uint32_t b = 0; b < 2; ++b)
+            {
+                m_mesh->SetClusterUnitBounds(unitBounds[b]);
+                EATESTAssert(GetLineHits(start, start + Vector3(0.0f, -extent.GetY() - 2.0f, 0.0f), query) == numRes,
+                    "Vertical line should hit the same triangles with unit bounds.");
+                EATESTAssert(GetLineHits(start, end, query) == numDiagonalRes,
+                    "Diagonal line should hit the same triangles with unit bounds.");
+#if RW_COLLISION_DETAIL_QUERY_STATS && RW_COLLISION_DETAIL_CLUSTER_UNIT_BOUNDS
+                EATESTAssert(query->GetCounters().m_counts[QueryCounters::TRIANGLES] <= numTriangles,
+                    "Unit bounds should not increase the triangles tested.");
+#else
+                (void)numTriangles;
+#endif
+            }
+        }
+    }
+
+    m_mesh->SetClusterUnitBounds(NULL);
+    DestroyUnitBounds(unitBounds[1]);
+    DestroyUnitBounds(unitBounds[0]);
+}
+
+
+void TestClusterUnitBounds::TestBBoxQuery()
+{
+    const uint32_t STACKSIZE = 1;
+    const uint32_t RESULTSSIZE = 16;
+    VolumeBBoxQuery *query = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, RESULTSSIZE);
+
+    ClusterUnitBounds *unitBounds[2] = { CreateUnitBounds(ClusterUnitBounds::FORMAT_8BIT),
+                                         CreateUnitBounds(ClusterUnitBounds::FORMAT_16BIT) };
+
+    // A grid of small boxes across the mesh, with a results buffer small enough to need restarts
+    const Vector3 extent = m_meshBBox.Max() - m_meshBBox.Min();
+    const Vector3 boxSize = extent * 0.05f;
+    const uint32_t gridSize = 8;
+    for (uint32_t i = 0; i < gridSize; ++i)
+    {
+        for (uint32_t j = 0; j < gridSize; ++j)
+        {
+            const Vector3 min = m_meshBBox.Min() + Vector3(
+                extent.GetX() * float(i) / float(gridSize), 0.0f, extent.GetZ() * float(j) / float(gridSize));
+            const AABBox bbox(min, min + Vector3(boxSize.GetX(), extent.GetY(), boxSize.GetZ()));
+
+            m_mesh->SetClusterUnitBounds(NULL);
+            const uint32_t numOverlaps = GetBBoxOverlaps(bbox, query);
+
+            for (uint32_t b = 0; b < 2; ++b)
+            {
+                m_mesh->SetClusterUnitBounds(unitBounds[b]);
+                EATESTAssert(GetBBoxOverlaps(bbox, query) == numOverlaps,
+                    "Box should overlap the same triangles with unit bounds.");
+            }
+        }
+    }
+
+    m_mesh->SetClusterUnitBounds(NULL);
+    DestroyUnitBounds(unitBounds[1]);
+    DestroyUnitBounds(unitBounds[0]);
+}
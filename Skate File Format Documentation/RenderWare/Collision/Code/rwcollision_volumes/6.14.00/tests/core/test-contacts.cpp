@@ -38,6 +38,9 @@ public:
         EATEST_REGISTER("TestBoxTriangle", "Test Box vs Triangle separating distance is reasonable", TestContacts, TestBoxTriangle);
         EATEST_REGISTER("TestCylinder", "Test Cylinder vs other primitive separating distance is reasonable", TestContacts, TestCylinder);
         EATEST_REGISTER("BenchmarkComputeContacts", "Benchmark all combinations of ComputeContactPoints", TestContacts, BenchmarkComputeContacts);
+        EATEST_REGISTER("TestComputeContactsBatch", "Test ComputeContactsBatch matches ComputeContacts for mixed pairs", TestContacts, TestComputeContactsBatch);
+        EATEST_REGISTER("BenchmarkComputeContactsBatch", "Benchmark ComputeContactsBatch against ComputeContacts for capsule vs triangle", TestContacts, BenchmarkComputeContactsBatch);
+        EATEST_REGISTER("BenchmarkComputeContactsBatchMixed", "Benchmark ComputeContactsBatch against ComputeContacts for interleaved mixed types", TestContacts, BenchmarkComputeContactsBatchMixed);
     }
 
     void SetupSuite()
@@ -69,6 +72,10 @@ private:
     void TestBoxTriangle();
     void TestCylinder();
 
+    void TestComputeContactsBatch();
+    void BenchmarkComputeContactsBatch();
+    void BenchmarkComputeContactsBatchMixed();
+
 } TestContactsSingleton;
 
 #undef NUM_TEST
@@ -426,3 +433,189 @@ void TestContacts::TestCylinder()
 }
 
 
+
+
+/*
+Test ComputeContactsBatch gives the same results as calling ComputeContacts on each pair, for a batch
+with every combination of types interleaved.
+*/
+void TestContacts::TestComputeContactsBatch()
+{
+    const uint32_t numtype = 5;
+    const uint32_t numPairs = numtype * numtype * 4;
+    const float padding = 8.f;
+
+    GPInstance gps[2 * numPairs];
+    GPInstancePair pairs[numPairs];
+    GPInstance::ContactPoints results[numPairs];
+    uint32_t resultPairIndices[numPairs];
+    uint32_t workspace[numPairs];
+
+    rw::math::SeedRandom(9u);                             // SEED RANDOM NUMBER GENERATOR
+
+    for (uint32_t i = 0; i < numPairs; ++i)
+    {
+        Vector3 origin = RandomVector3(10.f);
+        InitGP(gps[2 * i], origin, RandomRotationMatrix(), 0.0f, i % numtype);
+        InitGP(gps[2 * i + 1], origin, RandomRotationMatrix(), 4.0f, (i / numtype) % numtype);
+        gps[2 * i].mUserTag = 2 * i;
+        gps[2 * i + 1].mUserTag = 2 * i + 1;
+        pairs[i].a = &gps[2 * i];
+        pairs[i].b = &gps[2 * i + 1];
+    }
+
+    uint32_t numResults = ComputeContactsBatch(pairs, numPairs, results, resultPairIndices, numPairs, workspace, padding);
+
+    uint32_t numExpected = 0;
+    bool seen[numPairs];
+    for (uint32_t i = 0; i < numPairs; ++i)
+    {
+        seen[i] = false;
+    }
+
+    for (uint32_t r = 0; r < numResults; ++r)
+    {
+        uint32_t i = resultPairIndices[r];
+        EATESTAssert(i < numPairs, "result pair index out of range.");
+        EATESTAssert(!seen[i], "pair reported twice.");
+        seen[i] = true;
+
+        GPInstance::ContactPoints expected;
+        uint32_t ok = ComputeContacts(*pairs[i].a, *pairs[i].b, expected, padding);
+        EATESTAssert(ok, "batch generated contacts for a pair ComputeContacts did not.");
+        EATESTAssert(results[r].numPoints == expected.numPoints, "wrong numpoints.");
+        EATESTAssert(results[r].userTag1 == 2 * i && results[r].userTag2 == 2 * i + 1, "wrong user tags.");
+        EATESTAssert(IsSimilar(results[r].normal, expected.normal, VecFloat(1e-5f)), "wrong normal.");
+        for (uint32_t k = 0; k < expected.numPoints; ++k)
+        {
+            EATESTAssert(IsSimilar(results[r].pointPairs[k].p1, expected.pointPairs[k].p1, VecFloat(1e-5f)), "wrong point on a.");
+            EATESTAssert(IsSimilar(results[r].pointPairs[k].p2, expected.pointPairs[k].p2, VecFloat(1e-5f)), "wrong point on b.");
+        }
+    }
+
+    for (uint32_t i = 0; i < numPairs; ++i)
+    {
+        GPInstance::ContactPoints expected;
+        if (ComputeContacts(*pairs[i].a, *pairs[i].b, expected, padding))
+        {
+            ++numExpected;
+            EATESTAssert(seen[i], "batch missed a pair with contacts.");
+        }
+    }
+    EATESTAssert(numResults == numExpected, "wrong number of results.");
+
+    // A full output stops the batch without overrunning it.
+    if (numResults > 1)
+    {
+        uint32_t numTruncated = ComputeContactsBatch(pairs, numPairs, results, NULL, numResults - 1, workspace, padding);
+        EATESTAssert(numTruncated == numResults - 1, "batch did not stop at maxResults.");
+    }
+}
+
+/*
+Benchmark a batch of capsule vs triangle pairs, the typical character against mesh case, through
+ComputeContactsBatch and through ComputeContacts one pair at a time.
+*/
+void TestContacts::BenchmarkComputeContactsBatch()
+{
+    const uint32_t numPairs = 256;
+    const float padding = 8.f;
+
+    static GPInstance gps[2 * numPairs];
+    static GPInstancePair pairs[numPairs];
+    static GPInstance::ContactPoints results[numPairs];
+    static uint32_t workspace[numPairs];
+
+    rw::math::SeedRandom(9u);                             // SEED RANDOM NUMBER GENERATOR
+
+    for (uint32_t i = 0; i < numPairs; ++i)
+    {
+        Vector3 origin = RandomVector3(10.f);
+        InitGP(gps[2 * i], origin, RandomRotationMatrix(), 0.0f, 1);
+        InitGP(gps[2 * i + 1], origin, RandomRotationMatrix(), 4.0f, 2);
+        // Alternate the order within the pair so the batch has to swap half of them.
+        pairs[i].a = &gps[2 * i + (i & 1)];
+        pairs[i].b = &gps[2 * i + 1 - (i & 1)];
+    }
+
+    const uint32_t numRuns = 10;
+    float batchTime = MAX_FLOAT;
+    float singleTime = MAX_FLOAT;
+
+    for (uint32_t run = 0; run < numRuns; ++run)
+    {
+        benchmarkenvironment::Timer timer;
+        timer.Start();
+        ComputeContactsBatch(pairs, numPairs, results, NULL, numPairs, workspace, padding);
+        timer.Stop();
+        batchTime = Min(batchTime, timer.AsSeconds() * 1e6f);   // unit = microseconds
+
+        benchmarkenvironment::Timer singleTimer;
+        singleTimer.Start();
+        for (uint32_t i = 0; i < numPairs; ++i)
+        {
+            ComputeContacts(*pairs[i].a, *pairs[i].b, results[i], padding);
+        }
+        singleTimer.Stop();
+        singleTime = Min(singleTime, singleTimer.AsSeconds() * 1e6f);
+    }
+
+    EATESTSendBenchmark("TestContacts - ComputeContactsBatch - Capsule vs Triangle",
+        (double) batchTime / numPairs, (double) batchTime / numPairs, (double) batchTime / numPairs);
+    EATESTSendBenchmark("TestContacts - ComputeContacts per pair - Capsule vs Triangle",
+        (double) singleTime / numPairs, (double) singleTime / numPairs, (double) singleTime / numPairs);
+}
+
+/*
+Benchmark a batch with every combination of types interleaved, where ComputeContacts one pair at a time
+changes type pair on every call, through ComputeContactsBatch and through ComputeContacts.
+*/
+void TestContacts::BenchmarkComputeContactsBatchMixed()
+{
+    const uint32_t numtype = 5;
+    const uint32_t numPairs = numtype * numtype * 16;
+    const float padding = 8.f;
+
+    static GPInstance gps[2 * numPairs];
+    static GPInstancePair pairs[numPairs];
+    static GPInstance::ContactPoints results[numPairs];
+    static uint32_t workspace[numPairs];
+
+    rw::math::SeedRandom(9u);                             // SEED RANDOM NUMBER GENERATOR
+
+    for (uint32_t i = 0; i < numPairs; ++i)
+    {
+        Vector3 origin = RandomVector3(10.f);
+        InitGP(gps[2 * i], origin, RandomRotationMatrix(), 0.0f, i % numtype);
+        InitGP(gps[2 * i + 1], origin, RandomRotationMatrix(), 4.0f, (i / numtype) % numtype);
+        pairs[i].a = &gps[2 * i];
+        pairs[i].b = &gps[2 * i + 1];
+    }
+
+    const uint32_t numRuns = 10;
+    float batchTime = MAX_FLOAT;
+    float singleTime = MAX_FLOAT;
+
+    for (uint32_t run = 0; run < numRuns; ++run)
+    {
+        benchmarkenvironment::Timer timer;
+        timer.Start();
+        ComputeContactsBatch(pairs, numPairs, results, NULL, numPairs, workspace, padding);
+        timer.Stop();
+        batchTime = Min(batchTime, timer.AsSeconds() * 1e6f);   // unit = microseconds
+
+        benchmarkenvironment::Timer singleTimer;
+        singleTimer.Start();
+        for (uint32_t i = 0; i < numPairs; ++i)
+        {
+            ComputeContacts(*pairs[i].a, *pairs[i].b, results[i], padding);
+        }
+        singleTimer.Stop();
+        singleTime = Min(singleTime, singleTimer.AsSeconds() * 1e6f);
+    }
+
+    EATESTSendBenchmark("TestContacts - ComputeContactsBatch - Mixed",
+        (double) batchTime / numPairs, (double) batchTime / numPairs, (double) batchTime / numPairs);
+    EATESTSendBenchmark("TestContacts - ComputeContacts per pair - Mixed",
+        (double) singleTime / numPairs, (double) singleTime / numPairs, (double) singleTime / numPairs);
+}
@@ -0,0 +1,238 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include "clusteredmeshtest_base.hpp"
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Unit tests for closest point queries against single triangles and against a ClusteredMesh.
+
+class TestDistanceQuery: public ClusteredMeshTest_Base
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestDistanceQuery");
+
+#define DISTANCE_QUERY_TEST(F, D) EATEST_REGISTER(#F, D, TestDistanceQuery, F)
+
+        DISTANCE_QUERY_TEST(TestTriangleClosestPointFace, "Test the closest point over a triangle face");
+        DISTANCE_QUERY_TEST(TestTriangleClosestPointEdges, "Test the closest point beside each triangle edge");
+        DISTANCE_QUERY_TEST(TestTriangleClosestPointVertices, "Test the closest point beyond each triangle vertex");
+
+#if !defined(EA_PLATFORM_PS3_SPU)
+        DISTANCE_QUERY_TEST(TestClusteredMeshClosestPoint, "Test closest points on a transformed clustered mesh");
+        DISTANCE_QUERY_TEST(TestClusteredMeshClosestPointMaxDistance, "Test the maximum distance of a closest point query");
+        DISTANCE_QUERY_TEST(TestClusteredMeshClosestPoints, "Test the k nearest triangles of a clustered mesh");
+        DISTANCE_QUERY_TEST(TestClusteredMeshClosestPointBatch, "Test a batch of closest point queries");
+#endif // !defined(EA_PLATFORM_PS3_SPU)
+    }
+
+private:
+
+    void TestTriangleClosestPointFace();
+    void TestTriangleClosestPointEdges();
+    void TestTriangleClosestPointVertices();
+
+#if !defined(EA_PLATFORM_PS3_SPU)
+    void TestClusteredMeshClosestPoint();
+    void TestClusteredMeshClosestPointMaxDistance();
+    void TestClusteredMeshClosestPoints();
+    void TestClusteredMeshClosestPointBatch();
+#endif // !defined(EA_PLATFORM_PS3_SPU)
+
+} TestDistanceQuerySingleton;
+
+
+namespace
+{
+
+// Flat triangle in the xz plane.
+const Vector3 g_flat0(0.0f, 0.0f, 0.0f);
+const Vector3 g_flat1(0.0f, 0.0f, 1.0f);
+const Vector3 g_flat2(1.0f, 0.0f, 0.0f);
+
+// Mesh transform used by the clustered mesh tests, rotating the flat test mesh about the x axis.
+const Matrix44Affine g_meshTm(GetVector3_XAxis(),
+                              Vector3(0.0f, 0.707106781f, -0.707106781f),
+                              Vector3(0.0f, 0.707106781f, 0.707106781f),
+                              Vector3(1.0f, 0.123456f, -2.0f));
+
+}
+
+
+void TestDistanceQuery::TestTriangleClosestPointFace()
+{
+    Vector3 closest;
+    DistanceQueryResult::Feature feature = TriangleClosestPoint(closest, Vector3(0.3f, 1.0f, 0.2f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_FACE, "Closest point should be on the face.");
+    EATESTAssert(IsSimilar(closest, Vector3(0.3f, 0.0f, 0.2f), 1e-5f), "Incorrect closest point.");
+
+    feature = TriangleClosestPoint(closest, Vector3(0.3f, -2.0f, 0.2f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_FACE, "Closest point below should be on the face.");
+    EATESTAssert(IsSimilar(closest, Vector3(0.3f, 0.0f, 0.2f), 1e-5f), "Incorrect closest point below.");
+}
+
+
+void TestDistanceQuery::TestTriangleClosestPointEdges()
+{
+    Vector3 closest;
+    DistanceQueryResult::Feature feature = TriangleClosestPoint(closest, Vector3(-1.0f, 0.5f, 0.5f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_EDGE0, "Closest point should be on edge 0.");
+    EATESTAssert(IsSimilar(closest, Vector3(0.0f, 0.0f, 0.5f), 1e-5f), "Incorrect closest point on edge 0.");
+
+    feature = TriangleClosestPoint(closest, Vector3(1.0f, 0.3f, 1.0f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_EDGE1, "Closest point should be on edge 1.");
+    EATESTAssert(IsSimilar(closest, Vector3(0.5f, 0.0f, 0.5f), 1e-5f), "Incorrect closest point on edge 1.");
+
+    feature = TriangleClosestPoint(closest, Vector3(0.5f, 0.0f, -1.0f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_EDGE2, "Closest point should be on edge 2.");
+    EATESTAssert(IsSimilar(closest, Vector3(0.5f, 0.0f, 0.0f), 1e-5f), "Incorrect closest point on edge 2.");
+}
+
+
+void TestDistanceQuery::TestTriangleClosestPointVertices()
+{
+    Vector3 closest;
+    DistanceQueryResult::Feature feature = TriangleClosestPoint(closest, Vector3(-1.0f, 0.0f, -1.0f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_VERTEX0, "Closest point should be vertex 0.");
+    EATESTAssert(IsSimilar(closest, g_flat0, 1e-5f), "Incorrect closest point at vertex 0.");
+
+    feature = TriangleClosestPoint(closest, Vector3(-0.5f, 1.0f, 2.0f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_VERTEX1, "Closest point should be vertex 1.");
+    EATESTAssert(IsSimilar(closest, g_flat1, 1e-5f), "Incorrect closest point at vertex 1.");
+
+    feature = TriangleClosestPoint(closest, Vector3(2.0f, -1.0f, -1.0f), g_flat0, g_flat1, g_flat2);
+    EATESTAssert(feature == DistanceQueryResult::FEATURE_VERTEX2, "Closest point should be vertex 2.");
+    EATESTAssert(IsSimilar(closest, g_flat2, 1e-5f), "Incorrect closest point at vertex 2.");
+}
+
+
+#if !defined(EA_PLATFORM_PS3_SPU)
+
+void TestDistanceQuery::TestClusteredMeshClosestPoint()
+{
+    const Vector3 expectedNormal = TransformVector(GetVector3_YAxis(), g_meshTm);
+
+    // Above the interior of the flat 4x4 mesh, away from the vertices and edges
+    const Vector3 localPoint(1.3f, 0.5f, 2.6f);
+    DistanceQueryResult result;
+    RwpBool found = triangleMesh->ClosestPointQuery(result, TransformPoint(localPoint, g_meshTm), 2.0f, &g_meshTm);
+
+    EATESTAssert(found, "Should find a triangle below the point.");
+    EATESTAssert(IsSimilar(result.distance, 0.5f, 1e-4f), "Incorrect distance.");
+    EATESTAssert(IsSimilar(result.position, TransformPoint(Vector3(1.3f, 0.0f, 2.6f), g_meshTm), 1e-4f), "Incorrect closest point.");
+    EATESTAssert(IsSimilar(result.normal, expectedNormal, 1e-4f), "Incorrect normal.");
+    EATESTAssert(result.feature == DistanceQueryResult::FEATURE_FACE, "Closest point should be on a face.");
+
+    Volume volume;
+    TriangleVolume *triangle = TriangleVolume::Initialize(EA::Physics::MemoryPtr(&volume),
+        GetVector3_Zero(), GetVector3_Zero(), GetVector3_Zero());
+    triangleMesh->GetVolumeFromChildIndex(*triangle, result.childIndex);
+    Vector3 p0, p1, p2;
+    triangle->GetPoints(p0, p1, p2, NULL);
+    Vector3 closest;
+    TriangleClosestPoint(closest, localPoint, p0, p1, p2);
+    EATESTAssert(IsSimilar(closest, Vector3(1.3f, 0.0f, 2.6f), 1e-4f), "Closest point should be on the triangle reported.");
+
+    // Beside the mesh the closest point is on the boundary edge
+    found = triangleMesh->ClosestPointQuery(result, Vector3(5.0f, 0.0f, 2.3f), 2.0f, NULL);
+    EATESTAssert(found, "Should find the edge of the mesh.");
+    EATESTAssert(IsSimilar(result.distance, 1.0f, 1e-4f), "Incorrect distance to the edge.");
+    EATESTAssert(IsSimilar(result.position, Vector3(4.0f, 0.0f, 2.3f), 1e-4f), "Incorrect closest point on the edge.");
+    EATESTAssert(result.feature != DistanceQueryResult::FEATURE_FACE, "Closest point should be on an edge.");
+}
+
+
+void TestDistanceQuery::TestClusteredMeshClosestPointMaxDistance()
+{
+    DistanceQueryResult result;
+
+    RwpBool found = triangleMesh->ClosestPointQuery(result, Vector3(2.2f, 1.5f, 2.1f), 1.0f, NULL);
+    EATESTAssert(!found, "Mesh is beyond the maximum distance.");
+
+    found = triangleMesh->ClosestPointQuery(result, Vector3(2.2f, 0.9f, 2.1f), 1.0f, NULL);
+    EATESTAssert(found, "Mesh is within the maximum distance.");
+    EATESTAssert(IsSimilar(result.distance, 0.9f, 1e-4f), "Incorrect distance.");
+}
+
+
+void TestDistanceQuery::TestClusteredMeshClosestPoints()
+{
+    // Directly above an interior vertex every triangle using the vertex is equally close,
+    // and the triangles of the surrounding cells are further away.
+    const Vector3 point(2.0f, 0.5f, 2.0f);
+    DistanceQueryResult results[32];
+
+    uint32_t numResults = triangleMesh->ClosestPointsQuery(results, 3, point, 2.0f, NULL);
+    EATESTAssert(numResults == 3, "Should find three triangles.");
+    for (uint32_t i = 0; i < numResults; ++i)
+    {
+        EATESTAssert(IsSimilar(results[i].distance, 0.5f, 1e-4f), "Nearest triangles should touch the vertex.");
+        EATESTAssert(IsSimilar(results[i].position, Vector3(2.0f, 0.0f, 2.0f), 1e-4f), "Incorrect closest point.");
+        for (uint32_t j = 0; j < i; ++j)
+        {
+            EATESTAssert(results[i].childIndex != results[j].childIndex, "Each triangle should be returned once.");
+        }
+    }
+
+    // Within a small distance only the triangles using the vertex are found
+    numResults = triangleMesh->ClosestPointsQuery(results, 32, point, 0.6f, NULL);
+    EATESTAssert(numResults >= 4 && numResults <= 8, "Should find only the triangles using the vertex.");
+
+    // With a larger distance the results are sorted nearest first
+    numResults = triangleMesh->ClosestPointsQuery(results, 32, point, 10.0f, NULL);
+    EATESTAssert(numResults == 32, "Should fill the results.");
+    for (uint32_t i = 1; i < numResults; ++i)
+    {
+        EATESTAssert(results[i - 1].distance <= results[i].distance, "Results should be sorted nearest first.");
+    }
+}
+
+
+void TestDistanceQuery::TestClusteredMeshClosestPointBatch()
+{
+    const Vector3 localPoints[4] =
+    {
+        Vector3(0.3f, 0.25f, 0.4f),
+        Vector3(3.7f, -0.5f, 1.1f),
+        Vector3(2.0f, 5.0f, 2.0f),
+        Vector3(4.5f, 0.0f, 4.5f)
+    };
+    const float expectedDistances[4] = { 0.25f, 0.5f, MAX_FLOAT, 0.707106781f };
+
+    Vector3 points[4];
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        points[i] = TransformPoint(localPoints[i], g_meshTm);
+    }
+
+    DistanceQueryResult results[4];
+    const uint32_t numFound = triangleMesh->ClosestPointQueryBatch(results, points, 4, 1.0f, &g_meshTm);
+    EATESTAssert(numFound == 3, "Three points should be within the maximum distance.");
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        if (expectedDistances[i] == MAX_FLOAT)
+        {
+            EATESTAssert(results[i].distance == MAX_FLOAT, "Point beyond the maximum distance should have no result.");
+            EATESTAssert(results[i].childIndex == rwcKDTREE_INVALID_INDEX, "Point beyond the maximum distance should have no triangle.");
+            continue;
+        }
+
+        DistanceQueryResult single;
+        RwpBool found = triangleMesh->ClosestPointQuery(single, points[i], 1.0f, &g_meshTm);
+        EATESTAssert(found, "Single query should match the batch.");
+        EATESTAssert(IsSimilar(results[i].distance, expectedDistances[i], 1e-4f), "Incorrect batch distance.");
+        EATESTAssert(IsSimilar(results[i].distance, single.distance, 1e-5f), "Batch distance should match single query.");
+        EATESTAssert(IsSimilar(results[i].position, single.position, 1e-5f), "Batch point should match single query.");
+    }
+}
+
+#endif // !defined(EA_PLATFORM_PS3_SPU)
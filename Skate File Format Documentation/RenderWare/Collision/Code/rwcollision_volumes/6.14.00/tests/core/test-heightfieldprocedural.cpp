@@ -0,0 +1,751 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include <rw/collision/heightfieldprocedural.h>
+#include <rw/collision/detail/fpu/heightfieldprocedural.h>
+
+#include <eaphysics/unitframework/creator.h>
+#include <eaphysics/unitframework/serialization_test_helpers.hpp>
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Unit tests for HeightFieldProcedurals. The line and bbox queries are checked against brute force tests of
+// every triangle of the grid.
+
+namespace
+{
+
+
+const uint32_t MAX_RESULTS = 256;
+
+
+/**
+Creates a heightfield whose heights follow a bumpy pattern, of quantization step 0.25.
+*/
+HeightFieldProcedural *
+CreateBumpyHeightField(uint32_t numCellsX, uint32_t numCellsZ, uint32_t flags)
+{
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(numCellsX, numCellsZ, flags);
+    heightField->SetHeightQuantization(0.0f, 0.25f);
+
+    for (uint32_t z = 0; z <= numCellsZ; ++z)
+    {
+        for (uint32_t x = 0; x <= numCellsX; ++x)
+        {
+            heightField->SetHeight(x, z, static_cast<uint16_t>((x * 7u + z * 3u) % 5u));
+        }
+    }
+
+    heightField->Update();
+    return heightField;
+}
+
+
+/**
+Sets the heights along x of a heightfield with one row of cells.
+*/
+void
+SetRowHeights(HeightFieldProcedural *heightField, const uint16_t *heights)
+{
+    for (uint32_t x = 0; x <= heightField->GetNumCellsX(); ++x)
+    {
+        heightField->SetHeight(x, 0, heights[x]);
+        heightField->SetHeight(x, 1, heights[x]);
+    }
+    heightField->Update();
+}
+
+
+/**
+Gets the tags of the triangles of a heightfield hit by a line, by testing every triangle.
+\return The number of triangles hit.
+*/
+uint32_t
+GetBruteForceLineTags(uint32_t *tags,
+                      const HeightFieldProcedural &heightField,
+                      Vector3::InParam lineStart,
+                      Vector3::InParam lineEnd,
+                      float fatness)
+{
+    uint32_t numHits = 0;
+    for (uint32_t childIndex = 0; childIndex < heightField.GetVolumeCount(); ++childIndex)
+    {
+        Vector3 v0, v1, v2;
+        heightField.GetTriangleVertices(childIndex, v0, v1, v2);
+
+        VolumeLineSegIntersectResult result;
+        if (TriangleLineSegIntersectTwoSided(result, lineStart, lineEnd - lineStart, v0, v1, v2, fatness))
+        {
+            tags[numHits++] = childIndex + 1;
+        }
+    }
+    return numHits;
+}
+
+
+/**
+Gets the tags of the triangles of a heightfield whose bounding boxes overlap a box, by testing every triangle.
+\return The number of triangles overlapping.
+*/
+uint32_t
+GetBruteForceBBoxTags(uint32_t *tags, const HeightFieldProcedural &heightField, const AABBox &bbox)
+{
+    uint32_t numOverlaps = 0;
+    for (uint32_t childIndex = 0; childIndex < heightField.GetVolumeCount(); ++childIndex)
+    {
+        Vector3 v0, v1, v2;
+        heightField.GetTriangleVertices(childIndex, v0, v1, v2);
+
+        if (bbox.Overlaps(AABBox(Min(Min(v0, v1), v2), Max(Max(v0, v1), v2))))
+        {
+            tags[numOverlaps++] = childIndex + 1;
+        }
+    }
+    return numOverlaps;
+}
+
+
+bool
+ContainsTag(const uint32_t *tags, uint32_t numTags, uint32_t tag)
+{
+    for (uint32_t i = 0; i < numTags; ++i)
+    {
+        if (tags[i] == tag)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+TriangleVolume *
+CreateTriangleVolume()
+{
+    return EA::Physics::UnitFramework::Creator<TriangleVolume>().New(GetVector3_Zero(), GetVector3_Zero(), GetVector3_Zero());
+}
+
+
+} // namespace
+
+
+class TestHeightFieldProcedural : public rw::collision::tests::TestSuiteBase
+{
+public:
+
+#define HEIGHTFIELD_PROCEDURAL_TEST(F, D) EATEST_REGISTER(#F, D, TestHeightFieldProcedural, F)
+
+    virtual void Initialize()
+    {
+        SuiteName("TestHeightFieldProcedural");
+
+        HEIGHTFIELD_PROCEDURAL_TEST(TestGetResourceDescriptor, "Check GetResourceDescriptor() with and without the optional cell data");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestInitialize, "Check Initialize()");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestUpdateThis, "Check UpdateThis() computes the bounding box from the grid and heights");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestLineQuerySingleHit, "Check a vertical line query hits the triangle below it");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestLineQueryOneSided, "Check a one sided heightfield is not hit from below");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestLineQueryBruteForce, "Check line queries against testing every triangle");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestLineQueryRestart, "Check a line query can be restarted with a small results buffer");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestLineQueryTransformed, "Check a line query against a transformed heightfield");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestDiagonalFlags, "Check the diagonal flags select the triangulation of a cell");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestSurfaceIDs, "Check the surface IDs of the cells are given to their triangles");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestBBoxQueryBruteForce, "Check bbox queries against testing every triangle");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestBBoxQueryRestart, "Check a bbox query can be restarted with a small results buffer");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestEdgeCosines, "Check the edge cosines and convex flags of ridges, valleys and boundaries");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestHLSerialization, "Check HL Serialization");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestLLFpuSerialization, "Check LL fpu Serialization");
+        HEIGHTFIELD_PROCEDURAL_TEST(TestLLFpuFileSerialization, "Check LL fpu file Serialization");
+    }
+
+    virtual void SetupSuite()
+    {
+        rw::collision::tests::TestSuiteBase::SetupSuite();
+        rw::collision::InitializeVTables();
+    }
+
+private:
+
+    void TestGetResourceDescriptor();
+    void TestInitialize();
+    void TestUpdateThis();
+    void TestLineQuerySingleHit();
+    void TestLineQueryOneSided();
+    void TestLineQueryBruteForce();
+    void TestLineQueryRestart();
+    void TestLineQueryTransformed();
+    void TestDiagonalFlags();
+    void TestSurfaceIDs();
+    void TestBBoxQueryBruteForce();
+    void TestBBoxQueryRestart();
+    void TestEdgeCosines();
+    void TestHLSerialization();
+    void TestLLFpuSerialization();
+    void TestLLFpuFileSerialization();
+
+    HeightFieldProcedural * CreateSerializationHeightField();
+    void CheckCopy(HeightFieldProcedural *original, HeightFieldProcedural *copied);
+
+    void CheckLineQuery(HeightFieldProcedural *heightField, Vector3::InParam lineStart, Vector3::InParam lineEnd, float fatness);
+
+} TestHeightFieldProceduralSingleton;
+
+
+void
+TestHeightFieldProcedural::CheckLineQuery(HeightFieldProcedural *heightField,
+                                          Vector3::InParam lineStart,
+                                          Vector3::InParam lineEnd,
+                                          float fatness)
+{
+    uint32_t expectedTags[MAX_RESULTS];
+    const uint32_t numExpected = GetBruteForceLineTags(expectedTags, *heightField, lineStart, lineEnd, fatness);
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, MAX_RESULTS);
+
+    const Volume *vol = aggVol;
+    lineQuery->InitQuery(&vol, NULL, 1, lineStart, lineEnd, fatness);
+    const uint32_t numRes = lineQuery->GetAllIntersections();
+
+    EATESTAssert(lineQuery->Finished(), "Line query should be finished.");
+    EATESTAssert(numRes == numExpected, "Line query should hit the same number of triangles as the brute force test.");
+
+    const VolumeLineSegIntersectResult *results = lineQuery->GetIntersectionResultsBuffer();
+    for (uint32_t i = 0; i < numRes; ++i)
+    {
+        EATESTAssert(ContainsTag(expectedTags, numExpected, results[i].vRef.tag), "Line query hit a triangle the brute force test did not.");
+        EATESTAssert(results[i].vRef.volume->GetType() == VOLUMETYPETRIANGLE, "Intersected volume type should be triangle");
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(lineQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+}
+
+
+void
+TestHeightFieldProcedural::TestGetResourceDescriptor()
+{
+    const uint32_t numCellsX = 7;
+    const uint32_t numCellsZ = 5;
+    const uint32_t numHeights = (numCellsX + 1) * (numCellsZ + 1);
+    const uint32_t numCells = numCellsX * numCellsZ;
+
+    EA::Physics::SizeAndAlignment resDesc = HeightFieldProcedural::GetResourceDescriptor(numCellsX, numCellsZ, 0);
+    EATESTAssert(resDesc.GetSize() == sizeof(HeightFieldProcedural) + numHeights * sizeof(uint16_t), "Size should be the class and the heights.");
+    EATESTAssert(resDesc.GetAlignment() == rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT, "Alignment should be rwcHEIGHTFIELDPROCEDURAL_ALIGNMENT.");
+
+    resDesc = HeightFieldProcedural::GetResourceDescriptor(numCellsX, numCellsZ,
+        HeightFieldProcedural::FLAG_HASSURFACEIDS | HeightFieldProcedural::FLAG_HASDIAGONALFLAGS);
+    EATESTAssert(resDesc.GetSize() == sizeof(HeightFieldProcedural) + numHeights * sizeof(uint16_t) +
+        numCells * sizeof(uint16_t) + ((numCells + 31) / 32) * sizeof(uint32_t), "Size should include the optional cell data.");
+
+    const HeightFieldProcedural::ObjectDescriptor objDesc(numCellsX, numCellsZ, HeightFieldProcedural::FLAG_HASSURFACEIDS);
+    EATESTAssert(HeightFieldProcedural::GetResourceDescriptor(objDesc).GetSize() ==
+        HeightFieldProcedural::GetResourceDescriptor(numCellsX, numCellsZ, HeightFieldProcedural::FLAG_HASSURFACEIDS).GetSize(),
+        "Size from object descriptor should match.");
+}
+
+
+void
+TestHeightFieldProcedural::TestInitialize()
+{
+    const uint32_t flags = HeightFieldProcedural::FLAG_HASSURFACEIDS | HeightFieldProcedural::FLAG_HASDIAGONALFLAGS;
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(3u, 2u, flags);
+
+    EATESTAssert(heightField->GetType() == RWCOBJECTTYPE_HEIGHTFIELDPROCEDURAL, "Incorrect type for HeightFieldProcedural");
+    EATESTAssert(heightField->IsProcedural(), "HeightFieldProcedural should be procedural");
+    EATESTAssert(heightField->GetVolumeCount() == 12u, "Volume count should be two triangles per cell");
+    EATESTAssert(heightField->GetNumCellsX() == 3u && heightField->GetNumCellsZ() == 2u, "Incorrect number of cells");
+    EATESTAssert(heightField->GetFlags() == flags, "Incorrect flags");
+    EATESTAssert(heightField->GetSizeThis() == HeightFieldProcedural::GetResourceDescriptor(3u, 2u, flags).GetSize(), "Incorrect size");
+
+    for (uint32_t cellIndex = 0; cellIndex < 6u; ++cellIndex)
+    {
+        EATESTAssert(heightField->GetCellSurfaceID(cellIndex) == 0, "Surface IDs should be initialized to zero");
+        EATESTAssert(!heightField->GetCellDiagonal(cellIndex), "Diagonal flags should be initialized to zero");
+    }
+    EATESTAssert(heightField->GetHeight(3u, 2u) == 0, "Heights should be initialized to zero");
+    EATESTAssert(heightField->IsValid(), "HeightFieldProcedural should be valid");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestUpdateThis()
+{
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(4u, 3u, 0u);
+    heightField->SetGrid(10.0f, 20.0f, 2.0f, 3.0f);
+    heightField->SetHeightQuantization(-5.0f, 0.5f);
+    heightField->SetHeight(1u, 1u, heightField->QuantizeHeight(-1.0f));
+    heightField->SetHeight(2u, 3u, heightField->QuantizeHeight(4.0f));
+    heightField->SetHeight(0u, 0u, 4u);
+    heightField->Update();
+
+    EATESTAssert(heightField->GetHeight(1u, 1u) == 8u, "Height -1 should quantize to 8");
+    EATESTAssert(heightField->GetHeight(2u, 3u) == 18u, "Height 4 should quantize to 18");
+
+    const AABBox expectedBBox(10.0f, -5.0f, 20.0f, 18.0f, 4.0f, 29.0f);
+    EATESTAssert(IsSimilar(heightField->GetBBox().Min(), expectedBBox.Min()), "Incorrect bounding box minimum");
+    EATESTAssert(IsSimilar(heightField->GetBBox().Max(), expectedBBox.Max()), "Incorrect bounding box maximum");
+    EATESTAssert(heightField->IsValid(), "HeightFieldProcedural should be valid");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestLineQuerySingleHit()
+{
+    // Flat 2 by 2 cells, so 8 triangles and 4 tag bits
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(2u, 2u, 0u);
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, 4u);
+
+    const Volume *vol = aggVol;
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(0.25f, 10.0f, 0.75f), Vector3(0.25f, -10.0f, 0.75f));
+
+    const uint32_t numRes = lineQuery->GetAllIntersections();
+    EATESTAssert(1 == numRes, "Result count should be 1");
+    EATESTAssert(lineQuery->Finished(), "Line query should be finished.");
+
+    const VolumeLineSegIntersectResult *results = lineQuery->GetIntersectionResultsBuffer();
+    EATESTAssert(results[0].v == aggVol, "Result should refer to the input volume");
+    EATESTAssert(results[0].vRef.volume->GetType() == VOLUMETYPETRIANGLE, "Intersected volume type should be triangle");
+    EATESTAssert(IsSimilar(results[0].lineParam, 0.5f), "Line param should be 0.5f");
+    EATESTAssert(IsSimilar(results[0].normal, Vector3(0.0f, 1.0f, 0.0f)), "Intersection normal should be (0.0f, 1.0f, 0.0f)");
+    EATESTAssert(IsSimilar(results[0].position, Vector3(0.25f, 0.0f, 0.75f)), "Intersection point should be (0.25f, 0.0f, 0.75f)");
+    EATESTAssert(results[0].vRef.tag == 1, "Intersection tag should be 1, the first triangle of the first cell");
+    EATESTAssert(results[0].vRef.numTagBits == 4, "Intersection num tag bits should be 4");
+
+    // Miss the grid
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(2.5f, 10.0f, 0.75f), Vector3(2.5f, -10.0f, 0.75f));
+    EATESTAssert(0 == lineQuery->GetAllIntersections(), "Line outside the grid should not hit");
+    EATESTAssert(lineQuery->Finished(), "Line query should be finished.");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(lineQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestLineQueryOneSided()
+{
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(2u, 2u, HeightFieldProcedural::FLAG_ONESIDED);
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, 4u);
+
+    const Volume *vol = aggVol;
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(1.25f, 10.0f, 0.5f), Vector3(1.25f, -10.0f, 0.5f));
+    EATESTAssert(1 == lineQuery->GetAllIntersections(), "Line from above should hit");
+
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(1.25f, -10.0f, 0.5f), Vector3(1.25f, 10.0f, 0.5f));
+    EATESTAssert(0 == lineQuery->GetAllIntersections(), "Line from below should not hit a one sided heightfield");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(lineQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestLineQueryBruteForce()
+{
+    HeightFieldProcedural *heightField = CreateBumpyHeightField(9u, 7u, 0u);
+
+    // Shallow lines along the terrain, in every direction, some starting or ending outside the grid
+    CheckLineQuery(heightField, Vector3(-0.5f, 0.6f, 0.3f), Vector3(9.7f, 0.4f, 6.1f), 0.0f);
+    CheckLineQuery(heightField, Vector3(8.9f, 0.5f, 6.8f), Vector3(0.2f, 0.55f, 0.1f), 0.0f);
+    CheckLineQuery(heightField, Vector3(0.3f, 0.45f, 7.5f), Vector3(8.6f, 0.5f, -1.0f), 0.0f);
+    CheckLineQuery(heightField, Vector3(4.37f, 0.5f, -2.0f), Vector3(4.37f, 0.5f, 9.0f), 0.0f);
+    CheckLineQuery(heightField, Vector3(10.0f, 0.52f, 3.61f), Vector3(-1.0f, 0.48f, 3.61f), 0.0f);
+    CheckLineQuery(heightField, Vector3(2.3f, 5.0f, 1.7f), Vector3(6.1f, -1.0f, 5.9f), 0.0f);
+
+    // Lines above and below the terrain
+    CheckLineQuery(heightField, Vector3(-1.0f, 1.5f, -1.0f), Vector3(10.0f, 1.5f, 8.0f), 0.0f);
+    CheckLineQuery(heightField, Vector3(-1.0f, -0.5f, 8.0f), Vector3(10.0f, -0.5f, -1.0f), 0.0f);
+
+    // Fat lines
+    CheckLineQuery(heightField, Vector3(-0.5f, 1.2f, 0.3f), Vector3(9.7f, 1.1f, 6.1f), 0.2f);
+    CheckLineQuery(heightField, Vector3(4.37f, 1.3f, -2.0f), Vector3(4.37f, 1.3f, 9.0f), 0.35f);
+    CheckLineQuery(heightField, Vector3(2.3f, 5.0f, 1.7f), Vector3(2.3f, -1.0f, 1.7f), 0.6f);
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestLineQueryRestart()
+{
+    HeightFieldProcedural *heightField = CreateBumpyHeightField(9u, 7u, 0u);
+    const Vector3 lineStart(-0.5f, 0.6f, 0.3f);
+    const Vector3 lineEnd(9.7f, 0.4f, 6.1f);
+
+    uint32_t expectedTags[MAX_RESULTS];
+    const uint32_t numExpected = GetBruteForceLineTags(expectedTags, *heightField, lineStart, lineEnd, 0.0f);
+    EATESTAssert(numExpected > 2, "Line should hit several triangles");
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, 1u);
+
+    const Volume *vol = aggVol;
+    lineQuery->InitQuery(&vol, NULL, 1, lineStart, lineEnd);
+
+    uint32_t numTotal = 0;
+    uint32_t lastTag = 0;
+    while (!lineQuery->Finished())
+    {
+        const uint32_t numRes = lineQuery->GetAllIntersections();
+        if (numRes > 0)
+        {
+            const uint32_t tag = lineQuery->GetIntersectionResultsBuffer()[0].vRef.tag;
+            EATESTAssert(ContainsTag(expectedTags, numExpected, tag), "Restarted query hit a triangle the brute force test did not.");
+            EATESTAssert(tag != lastTag, "Restarted query should not repeat a triangle.");
+            lastTag = tag;
+        }
+        numTotal += numRes;
+    }
+
+    EATESTAssert(numTotal == numExpected, "Restarted query should hit the same number of triangles as the brute force test.");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(lineQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestLineQueryTransformed()
+{
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(2u, 2u, 0u);
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, 4u);
+
+    // Stand the heightfield up in the x-y plane, facing +z, and move it
+    const Matrix44Affine tm(Vector3(1.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, 1.0f), Vector3(0.0f, -1.0f, 0.0f), Vector3(5.0f, 0.0f, 0.0f));
+    const Matrix44Affine *tmPtr = &tm;
+
+    const Volume *vol = aggVol;
+    lineQuery->InitQuery(&vol, &tmPtr, 1, Vector3(5.5f, -1.5f, 4.0f), Vector3(5.5f, -1.5f, -4.0f));
+
+    EATESTAssert(1 == lineQuery->GetAllIntersections(), "Result count should be 1");
+    const VolumeLineSegIntersectResult *results = lineQuery->GetIntersectionResultsBuffer();
+    EATESTAssert(IsSimilar(results[0].lineParam, 0.5f), "Line param should be 0.5f");
+    EATESTAssert(IsSimilar(results[0].normal, Vector3(0.0f, 0.0f, 1.0f)), "Intersection normal should be (0.0f, 0.0f, 1.0f)");
+    EATESTAssert(IsSimilar(results[0].position, Vector3(5.5f, -1.5f, 0.0f)), "Intersection point should be (5.5f, -1.5f, 0.0f)");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(lineQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestDiagonalFlags()
+{
+    // One cell with a raised corner at (1, 1)
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(1u, 1u, HeightFieldProcedural::FLAG_HASDIAGONALFLAGS);
+    heightField->SetHeight(1u, 1u, 4u);
+    heightField->Update();
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, 4u);
+    const Volume *vol = aggVol;
+
+    // Split along the raised diagonal, the point is on the sloping triangle
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(0.6f, 10.0f, 0.2f), Vector3(0.6f, -10.0f, 0.2f));
+    EATESTAssert(1 == lineQuery->GetAllIntersections(), "Result count should be 1");
+    EATESTAssert(IsSimilar(lineQuery->GetIntersectionResultsBuffer()[0].position, Vector3(0.6f, 0.8f, 0.2f)), "Intersection point should be on the sloping triangle");
+    EATESTAssert(lineQuery->GetIntersectionResultsBuffer()[0].vRef.tag == 2, "Intersection tag should be 2, the second triangle of the cell");
+
+    // Split along the other diagonal, the point is on the flat triangle
+    heightField->SetCellDiagonal(0u, 0u, TRUE);
+    EATESTAssert(heightField->GetCellDiagonal(0u), "Cell diagonal should be flipped");
+
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(0.6f, 10.0f, 0.2f), Vector3(0.6f, -10.0f, 0.2f));
+    EATESTAssert(1 == lineQuery->GetAllIntersections(), "Result count should be 1");
+    EATESTAssert(IsSimilar(lineQuery->GetIntersectionResultsBuffer()[0].position, Vector3(0.6f, 0.0f, 0.2f)), "Intersection point should be on the flat triangle");
+    EATESTAssert(lineQuery->GetIntersectionResultsBuffer()[0].vRef.tag == 1, "Intersection tag should be 1, the first triangle of the cell");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(lineQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestSurfaceIDs()
+{
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(2u, 1u, HeightFieldProcedural::FLAG_HASSURFACEIDS);
+    heightField->SetCellSurfaceID(1u, 0u, 7u);
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(1u, 4u);
+    const Volume *vol = aggVol;
+
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(1.5f, 10.0f, 0.25f), Vector3(1.5f, -10.0f, 0.25f));
+    EATESTAssert(1 == lineQuery->GetAllIntersections(), "Result count should be 1");
+    EATESTAssert(lineQuery->GetIntersectionResultsBuffer()[0].vRef.volume->GetSurface() == 7u, "Triangle should have the surface ID of its cell");
+
+    lineQuery->InitQuery(&vol, NULL, 1, Vector3(0.5f, 10.0f, 0.25f), Vector3(0.5f, -10.0f, 0.25f));
+    EATESTAssert(1 == lineQuery->GetAllIntersections(), "Result count should be 1");
+    EATESTAssert(lineQuery->GetIntersectionResultsBuffer()[0].vRef.volume->GetSurface() == 0u, "Triangle should have the surface ID of its cell");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(lineQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestBBoxQueryBruteForce()
+{
+    HeightFieldProcedural *heightField = CreateBumpyHeightField(9u, 7u, 0u);
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeBBoxQuery *bboxQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(1u, MAX_RESULTS);
+    const Volume *vol = aggVol;
+
+    const AABBox queryBBoxes[] =
+    {
+        AABBox(2.3f, 0.1f, 1.7f, 4.6f, 0.6f, 3.2f),
+        AABBox(-1.0f, -1.0f, -1.0f, 0.5f, 2.0f, 0.5f),
+        AABBox(-1.0f, 0.95f, -1.0f, 10.0f, 2.0f, 8.0f),
+        AABBox(8.5f, -1.0f, 6.5f, 12.0f, 0.3f, 9.0f),
+        AABBox(3.0f, 0.0f, 3.0f, 3.0f, 0.0f, 3.0f)
+    };
+
+    for (uint32_t i = 0; i < EAArrayCount(queryBBoxes); ++i)
+    {
+        uint32_t expectedTags[MAX_RESULTS];
+        const uint32_t numExpected = GetBruteForceBBoxTags(expectedTags, *heightField, queryBBoxes[i]);
+
+        bboxQuery->InitQuery(&vol, NULL, 1, queryBBoxes[i]);
+        const uint32_t numRes = bboxQuery->GetOverlaps();
+        EATESTAssert(bboxQuery->Finished(), "BBox query should be finished.");
+        EATESTAssert(numRes == numExpected, "BBox query should find the same number of triangles as the brute force test.");
+
+        const VolRef *results = bboxQuery->GetOverlapResultsBuffer();
+        for (uint32_t j = 0; j < numRes; ++j)
+        {
+            EATESTAssert(ContainsTag(expectedTags, numExpected, results[j].tag), "BBox query found a triangle the brute force test did not.");
+            EATESTAssert(results[j].volume->GetType() == VOLUMETYPETRIANGLE, "Overlapped volume type should be triangle");
+        }
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bboxQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestBBoxQueryRestart()
+{
+    HeightFieldProcedural *heightField = CreateBumpyHeightField(9u, 7u, 0u);
+    const AABBox queryBBox(2.3f, 0.1f, 1.7f, 5.6f, 0.6f, 4.2f);
+
+    uint32_t expectedTags[MAX_RESULTS];
+    const uint32_t numExpected = GetBruteForceBBoxTags(expectedTags, *heightField, queryBBox);
+    EATESTAssert(numExpected > 2, "BBox should overlap several triangles");
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeBBoxQuery *bboxQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(1u, 1u);
+    const Volume *vol = aggVol;
+
+    bboxQuery->InitQuery(&vol, NULL, 1, queryBBox);
+
+    uint32_t foundTags[MAX_RESULTS];
+    uint32_t numTotal = 0;
+    while (!bboxQuery->Finished())
+    {
+        const uint32_t numRes = bboxQuery->GetOverlaps();
+        for (uint32_t i = 0; i < numRes && numTotal < MAX_RESULTS; ++i)
+        {
+            const uint32_t tag = bboxQuery->GetOverlapResultsBuffer()[i].tag;
+            EATESTAssert(ContainsTag(expectedTags, numExpected, tag), "Restarted query found a triangle the brute force test did not.");
+            EATESTAssert(!ContainsTag(foundTags, numTotal, tag), "Restarted query should not repeat a triangle.");
+            foundTags[numTotal++] = tag;
+        }
+    }
+
+    EATESTAssert(numTotal == numExpected, "Restarted query should find the same number of triangles as the brute force test.");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bboxQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+void
+TestHeightFieldProcedural::TestEdgeCosines()
+{
+    // Two cells along x, whose shared side is a ridge or a valley with faces at right angles
+    HeightFieldProcedural *heightField = EA::Physics::UnitFramework::Creator<HeightFieldProcedural>().New(2u, 1u, 0u);
+    TriangleVolume *triangle = CreateTriangleVolume();
+
+    const uint16_t ridge[3] = { 0, 4, 0 };
+    heightField->SetHeightQuantization(0.0f, 0.25f);
+    SetRowHeights(heightField, ridge);
+
+    // The second triangle of the first cell has edges along the diagonal, the ridge and the boundary
+    heightField->GetVolumeFromChildIndex(*triangle, 1u);
+    EATESTAssert(IsSimilar(triangle->GetEdgeCos(0), 1.0f), "Edge cosine of the flat diagonal should be 1");
+    EATESTAssert(IsSimilar(triangle->GetEdgeCos(1), 0.0f), "Edge cosine of the right angled ridge should be 0");
+    EATESTAssert(IsSimilar(triangle->GetEdgeCos(2), -1.0f), "Edge cosine of the boundary should be -1");
+    EATESTAssert(0 != (triangle->GetFlags() & VOLUMEFLAG_TRIANGLEEDGE1CONVEX), "The ridge should be convex");
+    EATESTAssert(0 != (triangle->GetFlags() & VOLUMEFLAG_TRIANGLEEDGE2CONVEX), "The boundary should be convex");
+
+    const uint16_t valley[3] = { 4, 0, 4 };
+    SetRowHeights(heightField, valley);
+
+    heightField->GetVolumeFromChildIndex(*triangle, 1u);
+    EATESTAssert(IsSimilar(triangle->GetEdgeCos(1), 0.0f), "Edge cosine of the right angled valley should be 0");
+    EATESTAssert(0 == (triangle->GetFlags() & VOLUMEFLAG_TRIANGLEEDGE1CONVEX), "The valley should not be convex");
+
+    // The triangles of bbox queries have the same edge data
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(heightField);
+    VolumeBBoxQuery *bboxQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(1u, 4u);
+    const Volume *vol = aggVol;
+
+    bboxQuery->InitQuery(&vol, NULL, 1, AABBox(0.6f, -1.0f, 0.1f, 0.9f, 2.0f, 0.2f));
+    const uint32_t numRes = bboxQuery->GetOverlaps();
+    EATESTAssert(numRes > 0, "BBox query should find triangles");
+
+    const VolRef *results = bboxQuery->GetOverlapResultsBuffer();
+    for (uint32_t i = 0; i < numRes; ++i)
+    {
+        if (results[i].tag == 2u)
+        {
+            const TriangleVolume *found = static_cast<const TriangleVolume *>(results[i].volume);
+            EATESTAssert(IsSimilar(found->GetEdgeCosVector(), triangle->GetEdgeCosVector()), "BBox query triangle should have the edge cosines");
+            EATESTAssert(found->GetFlags() == triangle->GetFlags(), "BBox query triangle should have the edge flags");
+        }
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bboxQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(triangle);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(heightField);
+}
+
+
+/**
+Creates a heightfield with all of the optional cell data, for the serialization tests.
+*/
+HeightFieldProcedural *
+TestHeightFieldProcedural::CreateSerializationHeightField()
+{
+    HeightFieldProcedural *heightField = CreateBumpyHeightField(5u, 4u,
+        HeightFieldProcedural::FLAG_HASSURFACEIDS | HeightFieldProcedural::FLAG_HASDIAGONALFLAGS);
+    heightField->SetGrid(-3.0f, 2.0f, 1.5f, 0.5f);
+    heightField->SetCellSurfaceID(2u, 3u, 42u);
+    heightField->SetCellDiagonal(4u, 1u, TRUE);
+    heightField->Update();
+    return heightField;
+}
+
+
+/**
+Checks that a serialized copy of a heightfield has the same triangles as the original.
+*/
+void
+TestHeightFieldProcedural::CheckCopy(HeightFieldProcedural *original, HeightFieldProcedural *copied)
+{
+    EATESTAssert(copied->GetType() == RWCOBJECTTYPE_HEIGHTFIELDPROCEDURAL, "Incorrect type for copy");
+    EATESTAssert(copied->GetSizeThis() == original->GetSizeThis(), "Sizes of original and copy do not match.");
+    EATESTAssert(IsSimilar(copied->GetBBox().Min(), original->GetBBox().Min()) &&
+                 IsSimilar(copied->GetBBox().Max(), original->GetBBox().Max()), "Bounding boxes of original and copy do not match.");
+    EATESTAssert(copied->IsValid(), "Copy should be valid");
+
+    TriangleVolume *originalTriangle = CreateTriangleVolume();
+    TriangleVolume *copiedTriangle = CreateTriangleVolume();
+    for (uint32_t childIndex = 0; childIndex < original->GetVolumeCount(); ++childIndex)
+    {
+        original->GetVolumeFromChildIndex(*originalTriangle, childIndex);
+        copied->GetVolumeFromChildIndex(*copiedTriangle, childIndex);
+
+        Vector3 ov0, ov1, ov2, cv0, cv1, cv2;
+        originalTriangle->GetPoints(ov0, ov1, ov2);
+        copiedTriangle->GetPoints(cv0, cv1, cv2);
+
+        EATESTAssert(IsSimilar(ov0, cv0) && IsSimilar(ov1, cv1) && IsSimilar(ov2, cv2), "Triangles of original and copy do not match.");
+        EATESTAssert(originalTriangle->GetSurface() == copiedTriangle->GetSurface(), "Surface IDs of original and copy do not match.");
+        EATESTAssert(originalTriangle->GetFlags() == copiedTriangle->GetFlags(), "Triangle flags of original and copy do not match.");
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(copiedTriangle);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(originalTriangle);
+}
+
+
+void
+TestHeightFieldProcedural::TestHLSerialization()
+{
+    HeightFieldProcedural *original = CreateSerializationHeightField();
+
+    HeightFieldProcedural *copied = EA::Physics::UnitFramework::CopyViaHLSerialization(*original);
+    EATESTAssert(copied, "Failed copy via high-level serialization.");
+
+    CheckCopy(original, copied);
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(copied);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(original);
+}
+
+
+void
+TestHeightFieldProcedural::TestLLFpuSerialization()
+{
+    HeightFieldProcedural *original = CreateSerializationHeightField();
+
+#if !defined(RWP_NO_VPU_MATH)
+    HeightFieldProcedural *copied = EA::Physics::UnitFramework::CopyViaLLFpuSerialization<HeightFieldProcedural, rw::collision::detail::fpu::HeightFieldProcedural>(*original);
+#else // if defined(RWP_NO_VPU_MATH)
+    HeightFieldProcedural *copied = EA::Physics::UnitFramework::CopyViaLLFpuSerialization(*original);
+#endif // defined(RWP_NO_VPU_MATH)
+
+    EATESTAssert(copied, "Failed copy via low-level fpu serialization.");
+
+    CheckCopy(original, copied);
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(original);
+}
+
+
+void
+TestHeightFieldProcedural::TestLLFpuFileSerialization()
+{
+    HeightFieldProcedural *original = CreateSerializationHeightField();
+
+    const char* filename = UNITTEST_LL_FPU_SERIALIZED_DATA_FILE("heightfieldprocedural");
+
+#if !defined(RWP_NO_VPU_MATH)
+    EA::Physics::UnitFramework::SaveLLFpuSerializationToFile<HeightFieldProcedural, rw::collision::detail::fpu::HeightFieldProcedural>(*original, filename);
+#else // if defined(RWP_NO_VPU_MATH)
+    EA::Physics::UnitFramework::SaveLLFpuSerializationToFile<HeightFieldProcedural>(*original, filename);
+#endif // defined(RWP_NO_VPU_MATH)
+
+#if !defined(RWP_NO_VPU_MATH)
+    HeightFieldProcedural *copied = EA::Physics::UnitFramework::LoadLLFpuSerializationFromFile<HeightFieldProcedural, rw::collision::detail::fpu::HeightFieldProcedural>(filename);
+#else // if defined(RWP_NO_VPU_MATH)
+    HeightFieldProcedural *copied = EA::Physics::UnitFramework::LoadLLFpuSerializationFromFile<HeightFieldProcedural>(filename);
+#endif // defined(RWP_NO_VPU_MATH)
+
+    EATESTAssert(copied, "Failed copy via low-level fpu file serialization.");
+
+    CheckCopy(original, copied);
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(original);
+}
@@ -0,0 +1,242 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include <rw/collision/kdtree.h>
+#include <rw/collision/compactkdtree.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include <eaphysics/unitframework/serialization_test_helpers.hpp>
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include "stdlib.h"    // for qsort()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+namespace
+{
+    const uint32_t MAX_QUERY_ENTRIES = 16384;
+
+    int CompareEntries(const void * a, const void * b)
+    {
+        const uint32_t ea = *static_cast<const uint32_t *>(a);
+        const uint32_t eb = *static_cast<const uint32_t *>(b);
+        return (ea < eb) ? -1 : ((ea > eb) ? 1 : 0);
+    }
+}
+
+// Tests of CompactKDTrees, created from the kdtree of a KDTreeMappedArray and the kdtree of a ClusteredMesh.
+// Queries on a compact tree must return every entry returned by the same query on the original tree.
+
+class TestKDTreeCompact: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestKDTreeCompact");
+
+        EATEST_REGISTER("TestResourceDescriptor", "CompactKDTree resource descriptor", TestKDTreeCompact, TestResourceDescriptor);
+        EATEST_REGISTER("TestCompactMappedArrayKDTree", "Compact copy of a KDTreeMappedArray kdtree", TestKDTreeCompact, TestCompactMappedArrayKDTree);
+        EATEST_REGISTER("TestCompactClusteredMeshKDTree", "Compact copy of a ClusteredMesh kdtree", TestKDTreeCompact, TestCompactClusteredMeshKDTree);
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    virtual void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestResourceDescriptor();
+    void TestCompactMappedArrayKDTree();
+    void TestCompactClusteredMeshKDTree();
+
+    CompactKDTree * CreateCompactKDTree(const KDTreeBase & source);
+    void CheckCompactKDTree(const KDTreeBase & source);
+    template <class LINEQUERY, class TREE>
+    uint32_t CollectLineQueryEntries(const TREE & kdtree, Vector3::InParam start, Vector3::InParam end, uint32_t * entries);
+    template <class BBOXQUERY, class TREE>
+    uint32_t CollectBBoxQueryEntries(const TREE & kdtree, const AABBox & bbox, uint32_t * entries);
+    bool ContainsEntries(uint32_t * entries, uint32_t numEntries, uint32_t * subsetEntries, uint32_t numSubsetEntries);
+
+} TestKDTreeCompactSingleton;
+
+
+CompactKDTree * TestKDTreeCompact::CreateCompactKDTree(const KDTreeBase & source)
+{
+    EA::Physics::SizeAndAlignment resDesc = CompactKDTree::GetResourceDescriptor(source.GetNumBranchNodes(),
+        source.GetNumEntries(), source.GetBBox());
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    void * memory = allocator->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+    EATESTAssert(memory, "Failed to allocate compact kdtree.");
+
+    CompactKDTree * compact = CompactKDTree::Initialize(EA::Physics::MemoryPtr(memory), source.GetNumBranchNodes(),
+        source.GetNumEntries(), source.GetBBox());
+    compact->CompactBranchNodes(source);
+    return compact;
+}
+
+
+template <class LINEQUERY, class TREE>
+uint32_t TestKDTreeCompact::CollectLineQueryEntries(const TREE & kdtree, Vector3::InParam start, Vector3::InParam end,
+                                                    uint32_t * entries)
+{
+    uint32_t numEntries = 0;
+    uint32_t entry = 0;
+    LINEQUERY query(&kdtree, start, end);
+    while (query.GetNext(entry) && numEntries < MAX_QUERY_ENTRIES)
+    {
+        entries[numEntries++] = entry;
+    }
+    qsort(entries, numEntries, sizeof(uint32_t), CompareEntries);
+    return numEntries;
+}
+
+
+template <class BBOXQUERY, class TREE>
+uint32_t TestKDTreeCompact::CollectBBoxQueryEntries(const TREE & kdtree, const AABBox & bbox, uint32_t * entries)
+{
+    uint32_t numEntries = 0;
+    uint32_t entry = 0;
+    BBOXQUERY query(&kdtree, bbox);
+    while (query.GetNext(entry) && numEntries < MAX_QUERY_ENTRIES)
+    {
+        entries[numEntries++] = entry;
+    }
+    qsort(entries, numEntries, sizeof(uint32_t), CompareEntries);
+    return numEntries;
+}
+
+
+bool TestKDTreeCompact::ContainsEntries(uint32_t * entries, uint32_t numEntries, uint32_t * subsetEntries, uint32_t numSubsetEntries)
+{
+    uint32_t i = 0;
+    for (uint32_t s = 0; s < numSubsetEntries; ++s)
+    {
+        while (i < numEntries && entries[i] < subsetEntries[s])
+        {
+            ++i;
+        }
+        if (i == numEntries || entries[i] != subsetEntries[s])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void TestKDTreeCompact::CheckCompactKDTree(const KDTreeBase & source)
+{
+    EATESTAssert(CompactKDTree::CanCompactBranchNodes(source), "Source kdtree should be suitable for compacting.");
+
+    CompactKDTree * compact = CreateCompactKDTree(source);
+    EATESTAssert(compact->IsValid(), "Compact kdtree is not valid.");
+
+    // Leaf structure is unchanged, only the extents are quantized
+    KDTreeBase::BranchNode node;
+    for (uint32_t i = 0; i < source.GetNumBranchNodes(); ++i)
+    {
+        const KDTreeBase::BranchNode & original = source.m_branchNodes[i];
+        compact->DecodeBranchNode(i, node);
+        EATESTAssert(node.m_axis == original.m_axis, "Axis should be preserved.");
+        EATESTAssert(node.m_childRefs[0].m_content == original.m_childRefs[0].m_content, "Left content should be preserved.");
+        EATESTAssert(node.m_childRefs[0].m_index == original.m_childRefs[0].m_index, "Left index should be preserved.");
+        EATESTAssert(node.m_childRefs[1].m_content == original.m_childRefs[1].m_content, "Right content should be preserved.");
+        EATESTAssert(node.m_childRefs[1].m_index == original.m_childRefs[1].m_index, "Right index should be preserved.");
+        EATESTAssert(node.m_extents[0] >= original.m_extents[0], "Left extent should be rounded up.");
+        EATESTAssert(node.m_extents[1] <= original.m_extents[1], "Right extent should be rounded down.");
+    }
+
+    // Queries from a fixed pseudo random sequence so the results are repeatable
+    static uint32_t fullEntries[MAX_QUERY_ENTRIES];
+    static uint32_t compactEntries[MAX_QUERY_ENTRIES];
+    const AABBox & bbox = source.GetBBox();
+    const Vector3 extent = bbox.Max() - bbox.Min();
+    uint32_t seed = 12345u;
+    for (uint32_t q = 0; q < 256; ++q)
+    {
+        Vector3 points[2];
+        for (uint32_t p = 0; p < 2; ++p)
+        {
+            float r[3];
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                r[k] = float(seed >> 8) / float(1u << 24);
+            }
+            points[p] = bbox.Min() + Vector3(r[0] * extent.GetX(), r[1] * extent.GetY(), r[2] * extent.GetZ());
+        }
+
+        uint32_t numFull = CollectLineQueryEntries<KDTreeLineQuery>(source, points[0], points[1], fullEntries);
+        uint32_t numCompact = CollectLineQueryEntries<CompactKDTreeLineQuery>(*compact, points[0], points[1], compactEntries);
+        EATESTAssert(ContainsEntries(compactEntries, numCompact, fullEntries, numFull),
+            "Compact line query missed an entry.");
+
+        const Vector3 halfSize = extent * VecFloat(0.02f);
+        const AABBox queryBBox(points[0] - halfSize, points[0] + halfSize);
+        numFull = CollectBBoxQueryEntries<KDTreeBBoxQuery>(source, queryBBox, fullEntries);
+        numCompact = CollectBBoxQueryEntries<CompactKDTreeBBoxQuery>(*compact, queryBBox, compactEntries);
+        EATESTAssert(ContainsEntries(compactEntries, numCompact, fullEntries, numFull),
+            "Compact bbox query missed an entry.");
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(compact);
+}
+
+
+void TestKDTreeCompact::TestResourceDescriptor()
+{
+    EATESTAssert(sizeof(CompactKDTree::BranchNode) == 16, "Compact branch nodes should be 16 bytes.");
+    EATESTAssert(2 * sizeof(CompactKDTree::BranchNode) == sizeof(KDTreeBase::BranchNode), "Compact branch nodes should be half the size.");
+
+    const AABBox bbox(Vector3(0.0f, 0.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f));
+    const uint32_t numBranchNodes = 100;
+    EA::Physics::SizeAndAlignment full = KDTree::GetResourceDescriptor(numBranchNodes, 1000, bbox);
+    EA::Physics::SizeAndAlignment compact = CompactKDTree::GetResourceDescriptor(numBranchNodes, 1000, bbox);
+    EATESTAssert(compact.GetSize() < full.GetSize(), "Compact kdtree should use less memory.");
+    EATESTAssert(full.GetAlignment() == compact.GetAlignment(), "Alignment should match the full kdtree.");
+}
+
+
+void TestKDTreeCompact::TestCompactMappedArrayKDTree()
+{
+    const char* filename = UNITTEST_HL_SERIALIZED_DATA_FILE("kdtreemappedarray");
+    KDTreeMappedArray* mappedArray = EA::Physics::UnitFramework::LoadHLSerializationFromFile<KDTreeMappedArray>(filename);
+    EATESTAssert(mappedArray, "Failed to load kdtree mapped array.");
+
+    CheckCompactKDTree(*mappedArray->GetKDTreeMap());
+}
+
+
+void TestKDTreeCompact::TestCompactClusteredMeshKDTree()
+{
+    Volume *clusteredMeshVolume = LoadSerializedClusteredMesh("skatemesh.dat");
+    EATESTAssert(clusteredMeshVolume, "Failed to load clustered mesh.");
+    AggregateVolume *aggVol = static_cast<AggregateVolume *>(clusteredMeshVolume);
+    ClusteredMesh *mesh = static_cast<ClusteredMesh *>(aggVol->GetAggregate());
+
+    CheckCompactKDTree(*mesh->GetKDTreeBase());
+
+    EA::Allocator::ICoreAllocator *allocator = EA::Allocator::ICoreAllocator::GetDefaultAllocator();
+    allocator->Free(aggVol->GetAggregate());
+    allocator->Free(aggVol);
+}
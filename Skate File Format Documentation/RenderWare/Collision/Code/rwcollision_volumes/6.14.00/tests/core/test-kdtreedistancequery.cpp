@@ -0,0 +1,244 @@
+// (c) Electronic Arts. All Rights Reserved.
+#ifdef _MSC_VER
+#pragma warning(disable: 4700)
+#endif
+
+#include <new>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+
+#include <rw/collision/initialize.h>
+#include <rw/collision/aabbox.h>
+#include <rw/collision/kdtree.h>
+#include <rw/collision/kdtreedistancequery.h>
+
+#include "unit/unit.h"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "fakekdtree.hpp"
+
+using namespace rwpmath;
+using namespace rw::collision;
+using namespace rw::collision::unittest;
+
+namespace
+{
+
+class TestKDTreeDistanceQuery : public tests::TestSuiteBase
+{
+public:
+    TestKDTreeDistanceQuery()
+    {
+    }
+
+    virtual ~TestKDTreeDistanceQuery()
+    {
+    }
+
+    virtual void Initialize()
+    {
+        rw::collision::InitializeVTables();
+
+        SuiteName("TestKDTreeDistanceQuery");
+        EATEST_REGISTER("TestKDTreeWithNoBranchNodes",
+                        "Test the KDTreeDistanceQuery with a KDTree with no branch nodes.",
+                        TestKDTreeDistanceQuery,
+                        TestKDTreeWithNoBranchNodes);
+        EATEST_REGISTER("TestNearestFirstOrder",
+                        "Test the KDTreeDistanceQuery returns leaves nearest first.",
+                        TestKDTreeDistanceQuery,
+                        TestNearestFirstOrder);
+        EATEST_REGISTER("TestMaxDistance",
+                        "Test the KDTreeDistanceQuery skips leaves beyond the maximum distance.",
+                        TestKDTreeDistanceQuery,
+                        TestMaxDistance);
+        EATEST_REGISTER("TestClipDistance",
+                        "Test shrinking the distance of a KDTreeDistanceQuery during the query.",
+                        TestKDTreeDistanceQuery,
+                        TestClipDistance);
+        EATEST_REGISTER("TestPadding",
+                        "Test the KDTreeDistanceQuery padding expands the leaf boxes.",
+                        TestKDTreeDistanceQuery,
+                        TestPadding);
+        EATEST_REGISTER("TestHeapOverflow",
+                        "Test the KDTreeDistanceQuery returns every leaf when more nodes are pending than fit in the heap.",
+                        TestKDTreeDistanceQuery,
+                        TestHeapOverflow);
+    }
+
+    void TestKDTreeWithNoBranchNodes()
+    {
+        KDTree *kdtree = GetKDTreeWithNoBranchNodes();
+        KDTreeHolder kdtreeHolder(kdtree);
+
+        uint32_t entry = 0xcdcdcdcd, count = 0xefefeeff;
+
+        KDTreeDistanceQuery query(kdtree, Vector3(1.0f, 0.0f, 0.0f), 1.0f);
+        RwpBool more = query.GetNext(entry, count);
+        EATESTAssert(more, "Should return leaf within the distance");
+        EATESTAssert(kdtree->GetNumEntries() == count, "Should return all leaf entries");
+        EATESTAssert(0 == entry, "Should return first entry");
+        EATESTAssert(IsSimilar(query.GetLeafDistanceSquared(), 0.25f, 1e-6f), "Incorrect leaf distance");
+        EATESTAssert(!query.GetNext(entry, count), "Should be nothing more if no branches");
+
+        KDTreeDistanceQuery farQuery(kdtree, Vector3(2.0f, 0.0f, 0.0f), 1.0f);
+        EATESTAssert(!farQuery.GetNext(entry, count), "Tree should be beyond the maximum distance");
+    }
+
+    // The tree from GetKDTreeWithBranchNodes has four leaves:
+    //   A: x <= 0, y <= 0     entry 0, count 1
+    //   B: x <= 0, y >= -0.1  entry 1, count 2
+    //   C: x >= 0, y <= 0.1   entry 3, count 3
+    //   D: x >= 0, y >= 0     entry 6, count 4
+    // From the point (0.4, 0.4, 0) the squared leaf distances are D 0, C 0.09, B 0.16 and A 0.32.
+
+    void TestNearestFirstOrder()
+    {
+        KDTree *kdtree = GetKDTreeWithBranchNodes();
+        KDTreeHolder kdtreeHolder(kdtree);
+        KDTreeDistanceQuery query(kdtree, Vector3(0.4f, 0.4f, 0.0f), 1.0f);
+
+        const uint32_t expectedEntries[4] = { 6, 3, 1, 0 };
+        const uint32_t expectedCounts[4] = { 4, 3, 2, 1 };
+        const float expectedDistSq[4] = { 0.0f, 0.09f, 0.16f, 0.32f };
+
+        uint32_t entry = 0, count = 0;
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            EATESTAssert(query.GetNext(entry, count), "Should return all four leaves");
+            EATESTAssert(expectedEntries[i] == entry, "Leaves should be returned nearest first");
+            EATESTAssert(expectedCounts[i] == count, "Incorrect leaf count");
+            EATESTAssert(IsSimilar(query.GetLeafDistanceSquared(), expectedDistSq[i], 1e-6f), "Incorrect leaf distance");
+        }
+        EATESTAssert(!query.GetNext(entry, count), "Should be no more leaves");
+    }
+
+    void TestMaxDistance()
+    {
+        KDTree *kdtree = GetKDTreeWithBranchNodes();
+        KDTreeHolder kdtreeHolder(kdtree);
+        KDTreeDistanceQuery query(kdtree, Vector3(0.4f, 0.4f, 0.0f), 0.35f);
+
+        uint32_t entry = 0, count = 0;
+        EATESTAssert(query.GetNext(entry, count) && 6 == entry, "Should return leaf containing the point");
+        EATESTAssert(query.GetNext(entry, count) && 3 == entry, "Should return leaf within the distance");
+        EATESTAssert(!query.GetNext(entry, count), "Should skip leaves beyond the distance");
+    }
+
+    void TestClipDistance()
+    {
+        KDTree *kdtree = GetKDTreeWithBranchNodes();
+        KDTreeHolder kdtreeHolder(kdtree);
+        KDTreeDistanceQuery query(kdtree, Vector3(0.4f, 0.4f, 0.0f), 1.0f);
+
+        uint32_t entry = 0, count = 0;
+        EATESTAssert(query.GetNext(entry, count) && 6 == entry, "Should return leaf containing the point");
+
+        query.ClipDistance(0.2f);
+        EATESTAssert(IsSimilar(query.GetMaxDistance(), 0.2f, 1e-6f), "Distance should shrink");
+        EATESTAssert(!query.GetNext(entry, count), "Should skip leaves beyond the clipped distance");
+
+        query.ClipDistance(0.5f);
+        EATESTAssert(IsSimilar(query.GetMaxDistance(), 0.2f, 1e-6f), "Distance should not grow");
+    }
+
+    void TestPadding()
+    {
+        KDTree *kdtree = GetKDTreeWithBranchNodes();
+        KDTreeHolder kdtreeHolder(kdtree);
+
+        // Leaf C is 0.3 away, so is only within 0.25 when padded by 0.1
+        KDTreeDistanceQuery query(kdtree, Vector3(0.4f, 0.4f, 0.0f), 0.25f, 0.1f);
+
+        uint32_t entry = 0, count = 0;
+        EATESTAssert(query.GetNext(entry, count) && 6 == entry, "Should return leaf containing the point");
+        EATESTAssert(query.GetNext(entry, count) && 3 == entry, "Should return padded leaf within the distance");
+        EATESTAssert(IsSimilar(query.GetLeafDistanceSquared(), 0.04f, 1e-6f), "Incorrect padded leaf distance");
+    }
+
+    // Builds a balanced tree of depth 9 with 512 single entry leaves. Every branch box contains the origin, and
+    // leaf k lies (k + 1) / 1024 from the origin along the x axis. All 511 branches are nearer than any leaf,
+    // so the query has every leaf within the maximum distance pending at once.
+    KDTree *CreateWideKDTree()
+    {
+        const uint32_t numBranchNodes = 511;
+        const uint32_t firstLeafParent = 255;
+        const uint32_t numLeaves = 512;
+        const AABBox bbox(-1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f);
+
+        EA::Physics::SizeAndAlignment resDesc = KDTree::GetResourceDescriptor(numBranchNodes, numLeaves, bbox);
+        void *memory = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+        KDTree *kdtree = KDTree::Initialize(EA::Physics::MemoryPtr(memory), numBranchNodes, numLeaves, bbox);
+
+        for (uint32_t i = 0; i < numBranchNodes; ++i)
+        {
+            KDTree::BranchNode &node = kdtree->m_branchNodes[i];
+            node.m_parent = (i > 0) ? (i - 1) / 2 : 0;
+            node.m_axis = 0;
+            if (i < firstLeafParent)
+            {
+                // Both children have the same box as the parent
+                for (uint32_t child = 0; child < 2; ++child)
+                {
+                    node.m_childRefs[child].m_content = rwcKDTREE_BRANCH_NODE;
+                    node.m_childRefs[child].m_index = 2 * i + 1 + child;
+                }
+                node.m_extents[0] = 1.0f;
+                node.m_extents[1] = -1.0f;
+            }
+            else
+            {
+                const uint32_t leaf = 2 * (i - firstLeafParent);
+                for (uint32_t child = 0; child < 2; ++child)
+                {
+                    node.m_childRefs[child].m_content = 1;
+                    node.m_childRefs[child].m_index = leaf + child;
+                }
+                node.m_extents[0] = -static_cast<float>(leaf + 1) / 1024.0f;
+                node.m_extents[1] = static_cast<float>(leaf + 2) / 1024.0f;
+            }
+        }
+
+        return kdtree;
+    }
+
+    void TestHeapOverflow()
+    {
+        KDTree *kdtree = CreateWideKDTree();
+        const uint32_t numLeaves = kdtree->GetNumEntries();
+        EATESTAssert(numLeaves > rwcKDTREE_DISTANCEQUERY_HEAP_SIZE, "Tree should have more leaves than fit in the heap");
+
+        const float maxDistances[2] = { 1.0f, 0.25f };
+        for (uint32_t q = 0; q < 2; ++q)
+        {
+            uint32_t found[512] = { 0 };
+            uint32_t numFound = 0;
+
+            KDTreeDistanceQuery query(kdtree, Vector3(0.0f, 0.0f, 0.0f), maxDistances[q]);
+            uint32_t entry = 0, count = 0;
+            while (query.GetNext(entry, count))
+            {
+                EATESTAssert(entry < numLeaves && 1 == count, "Incorrect leaf");
+                const float distance = static_cast<float>(entry + 1) / 1024.0f;
+                EATESTAssert(distance <= maxDistances[q], "Leaf should be within the maximum distance");
+                EATESTAssert(IsSimilar(query.GetLeafDistanceSquared(), distance * distance, 1e-6f), "Incorrect leaf distance");
+                ++found[entry];
+                ++numFound;
+            }
+
+            const uint32_t numExpected = static_cast<uint32_t>(maxDistances[q] * 1024.0f);
+            EATESTAssert(numExpected == numFound, "Should return every leaf within the maximum distance");
+            for (uint32_t leaf = 0; leaf < numExpected; ++leaf)
+            {
+                EATESTAssert(1 == found[leaf], "Each leaf should be returned exactly once");
+            }
+        }
+
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(kdtree);
+    }
+
+} testKDTreeDistanceQuery;
+
+}
@@ -27,6 +27,8 @@ public:
                         TestPrimitivePairIntersect, TestBatch1xN);
         EATEST_REGISTER("TestBatchNxM", "Test PrimitivePair intersect for NxM Batches",
                         TestPrimitivePairIntersect, TestBatchNxM);
+        EATEST_REGISTER("TestBatchNxMTiled", "Test tiled PrimitivePair intersect for NxM Batches matches the serial version",
+                        TestPrimitivePairIntersect, TestBatchNxMTiled);
         EATEST_REGISTER("TestCapsuleEndCaps", "Check contacts with disabled capsule vertices are discarded", 
                         TestPrimitivePairIntersect, TestCapsuleEndCaps);
     }
@@ -48,6 +50,7 @@ public:
 
     void TestBatch1xN();
     void TestBatchNxM();
+    void TestBatchNxMTiled();
     void TestCapsuleEndCaps();
 
 } TestPrimitivePairIntersectSingleton;
@@ -120,6 +123,93 @@ void TestPrimitivePairIntersect::TestBatchNxM()
     EATESTAssert(numResults == 3, "Number of results incorrect");
 }
 
+void TestPrimitivePairIntersect::TestBatchNxMTiled()
+{
+    Volume vols1[2];
+    SphereVolume::Initialize(&vols1[0], 0.5f);
+    SphereVolume::Initialize(&vols1[1], 1.0f);
+    Matrix44Affine transforms1[] =
+    {
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(1.0f, 0.0f, 0.0f)),
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(5.0f, 0.0f, 0.0f)),
+    };
+    const Volume* v1[] = { &vols1[0], &vols1[1] };
+    const Matrix44Affine* t1[] = { &transforms1[0], &transforms1[1] };
+
+    Volume vols2[3];
+    SphereVolume::Initialize(&vols2[0], 1.0f);
+    SphereVolume::Initialize(&vols2[1], 0.1f);
+    SphereVolume::Initialize(&vols2[2], 2.0f);
+    Matrix44Affine transforms2[] =
+    {
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(1.3f, 0.0f, 0.0f)),
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(2.0f, 0.0f, 0.0f)),
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(2.3f, 0.0f, 0.0f)),
+    };
+    const Volume* v2[] = { &vols2[0], &vols2[1], &vols2[2] };
+    const Matrix44Affine* t2[] = { &transforms2[0], &transforms2[1], &transforms2[2] };
+
+    PrimitivePairIntersectResult serialResults[10];
+    PrimitivePairIntersectResult results[10];
+    GPInstance instancingSPR[10];
+
+    int32_t numSerial = rw::collision::detail::PrimitiveBatchIntersectNxM(serialResults, 10, instancingSPR, v1, t1, 2, v2, t2, 3);
+
+    // Every tile size, including ones which do not divide the batch, must find the same pairs.
+    for (int32_t tileSize = 1; tileSize <= 3; ++tileSize)
+    {
+        int32_t numResults = rw::collision::detail::PrimitiveBatchIntersectNxMTiled(results, 10, instancingSPR, v1, t1, 2, v2, t2, 3, tileSize);
+        EATESTAssert(numResults == numSerial, "Number of results incorrect");
+
+        for (int32_t i = 0; i < numResults; ++i)
+        {
+            bool found = false;
+            for (int32_t j = 0; j < numSerial; ++j)
+            {
+                found = found || (results[i].v1 == serialResults[j].v1 && results[i].v2 == serialResults[j].v2 &&
+                                  results[i].vNindex == serialResults[j].vNindex);
+            }
+            EATESTAssert(found, "Tiled result does not match a serial result");
+        }
+    }
+
+    // Run the tiles one result per buffer and merge them, the merged results must be in tile order.
+    const int32_t tileSize = 1;
+    const int32_t numTiles = rw::collision::detail::PrimitiveBatchIntersectNxMGetNumTiles(3, 2, tileSize);
+    EATESTAssert(numTiles == 6, "Number of tiles incorrect");
+
+    PrimitivePairIntersectResult tileResults[6];
+    PrimitivePairIntersectResult *tileResBufs[6];
+    int32_t tileMaxSizes[6];
+    int32_t tileCounts[6];
+
+    rw::collision::detail::PrimitiveBatchInstanceNxM(instancingSPR, v2, t2, 3, v1, t1, 2);
+    for (int32_t ti = numTiles - 1; ti >= 0; --ti)
+    {
+        tileResBufs[ti] = &tileResults[ti];
+        tileMaxSizes[ti] = 1;
+        tileCounts[ti] = rw::collision::detail::PrimitiveBatchIntersectNxMTile(tileResBufs[ti], tileMaxSizes[ti], instancingSPR, 3, 2, ti, tileSize);
+    }
+
+    int32_t numWritten = 0;
+    int32_t numMerged = rw::collision::detail::PrimitiveBatchIntersectNxMMergeTiles(results, 10, tileResBufs, tileMaxSizes, tileCounts, numTiles, &numWritten);
+    EATESTAssert(numMerged == numSerial, "Number of merged results incorrect");
+    EATESTAssert(numWritten == numMerged, "Merged results lost");
+
+    int32_t previousIndex = -1;
+    for (int32_t i = 0; i < numWritten; ++i)
+    {
+        int32_t index = (int32_t)(results[i].v1 - &vols1[0]) * 3 + results[i].vNindex;
+        EATESTAssert(index > previousIndex, "Merged results are not in tile order");
+        previousIndex = index;
+    }
+
+    // Overflow in the merged buffer is reported.
+    numMerged = rw::collision::detail::PrimitiveBatchIntersectNxMMergeTiles(results, 1, tileResBufs, tileMaxSizes, tileCounts, numTiles, &numWritten);
+    EATESTAssert(numMerged == numSerial, "Number of merged results incorrect");
+    EATESTAssert(numWritten == 1, "Merged results overran the buffer");
+}
+
 void TestPrimitivePairIntersect::TestExpectedPair(const rw::collision::Volume & volumeA, const rw::collision::Volume & volumeB, float padding, uint32_t numExpectedContacts)
 {
     PrimitivePairIntersectResult result;
@@ -0,0 +1,185 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+#include <rw/collision/libcore.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+using namespace rw::collision;
+using namespace rwpmath;
+
+// ***********************************************************************************************************
+// Test suite
+
+class TestQueryContext : public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestQueryContext");
+
+        EATEST_REGISTER("TestCreateQueries", "Create each kind of query from a context", TestQueryContext, TestCreateQueries);
+        EATEST_REGISTER("TestScope", "Release queries to a marker when a scope exits", TestQueryContext, TestScope);
+        EATEST_REGISTER("TestHighWaterMark", "Track the high water mark and required size of a context", TestQueryContext, TestHighWaterMark);
+    }
+
+    void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+
+        // Initialise the collision system
+        Volume::InitializeVTable();
+    }
+
+    void TeardownSuite()
+    {
+        EA::Physics::UnitFramework::ResetAllocator();
+        Volume::ReleaseVTable();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+    void TestCreateQueries();
+    void TestScope();
+    void TestHighWaterMark();
+
+    QueryContext *CreateContext(uint32_t arenaSize)
+    {
+        EA::Physics::SizeAndAlignment resDesc = QueryContext::GetResourceDescriptor(arenaSize);
+        void *memory = EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Alloc(resDesc.GetSize(), NULL, 0, resDesc.GetAlignment());
+        return QueryContext::Initialize(EA::Physics::MemoryPtr(memory), arenaSize);
+    }
+
+    void FreeContext(QueryContext *context)
+    {
+        QueryContext::Release(context);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(context);
+    }
+
+} TestQueryContextSingleton;
+
+
+void TestQueryContext::TestCreateQueries()
+{
+    const uint32_t stackMax = 4;
+    const uint32_t resBufferSize = 8;
+    const uint32_t arenaSize = VolumeLineQuery::GetResourceDescriptor(stackMax, resBufferSize).GetSize() +
+                               VolumeBBoxQuery::GetResourceDescriptor(stackMax, resBufferSize).GetSize() +
+                               VolumeVolumeQuery::GetResourceDescriptor(stackMax, resBufferSize).GetSize() +
+                               3 * rwcQUERYCONTEXT_ALIGNMENT;
+    QueryContext *context = CreateContext(arenaSize);
+
+    VolumeLineQuery *lineQuery = context->CreateLineQuery(stackMax, resBufferSize);
+    VolumeBBoxQuery *bboxQuery = context->CreateBBoxQuery(stackMax, resBufferSize);
+    VolumeVolumeQuery *volumeQuery = context->CreateVolumeVolumeQuery(stackMax, resBufferSize);
+
+    EATESTAssert(lineQuery && bboxQuery && volumeQuery, "Context should have room for each query.");
+    EATESTAssert(0 == (reinterpret_cast<uintptr_t>(lineQuery) % RWMATH_VECTOR3_ALIGNMENT), "Line query should be aligned.");
+    EATESTAssert(0 == (reinterpret_cast<uintptr_t>(bboxQuery) % RWMATH_VECTOR3_ALIGNMENT), "BBox query should be aligned.");
+    EATESTAssert(0 == (reinterpret_cast<uintptr_t>(volumeQuery) % RWMATH_VECTOR3_ALIGNMENT), "Volume query should be aligned.");
+    EATESTAssert(3 == context->GetNumRequests(), "Each query should be a single request.");
+    EATESTAssert(context->GetUsed() <= arenaSize, "Used size should be within the arena.");
+
+    // Run a query to check it was set up correctly
+    Volume sphere;
+    SphereVolume::Initialize(EA::Physics::MemoryPtr(&sphere), 1.0f);
+    const Volume *volumes[] = { &sphere };
+
+    lineQuery->InitQuery(volumes, NULL, 1, Vector3(-2.0f, 0.0f, 0.0f), Vector3(2.0f, 0.0f, 0.0f));
+    const VolumeLineSegIntersectResult *result = lineQuery->GetNearestIntersection();
+    EATESTAssert(result, "Line should hit the sphere.");
+    EATESTAssert(IsSimilar(result->lineParam, 0.25f, 1e-5f), "Line should hit the near side of the sphere.");
+
+    bboxQuery->InitQuery(volumes, NULL, 1, AABBox(Vector3(0.5f, 0.5f, 0.5f), Vector3(2.0f, 2.0f, 2.0f)));
+    EATESTAssert(1 == bboxQuery->GetOverlaps(), "Box should overlap the sphere.");
+
+    // Nothing more fits
+    EATESTAssert(NULL == context->CreateLineQuery(stackMax, resBufferSize), "Arena should be full.");
+    EATESTAssert(1 == context->GetNumFailedRequests(), "Failed request should be counted.");
+
+    context->Reset();
+    EATESTAssert(0 == context->GetUsed(), "Reset should release everything.");
+    EATESTAssert(NULL != context->CreateLineQuery(stackMax, resBufferSize), "Arena should have room after a reset.");
+
+    FreeContext(context);
+}
+
+
+void TestQueryContext::TestScope()
+{
+    QueryContext *context = CreateContext(4096);
+
+    VolumeBBoxQuery *outer = context->CreateBBoxQuery(1, 4);
+    EATESTAssert(outer, "Context should have room for the query.");
+    const uint32_t marker = context->GetMarker();
+
+    VolumeLineQuery *inner = NULL;
+    {
+        QueryContext::Scope scope(*context);
+        inner = context->CreateLineQuery(1, 4);
+        EATESTAssert(inner, "Context should have room for the query.");
+        EATESTAssert(context->GetUsed() > marker, "Query should use the arena.");
+    }
+    EATESTAssert(context->GetUsed() == marker, "Scope should release the inner query.");
+
+    {
+        QueryContext::Scope scope(*context);
+        VolumeLineQuery *reused = context->CreateLineQuery(1, 4);
+        EATESTAssert(reused == inner, "Released memory should be reused.");
+    }
+
+    FreeContext(context);
+}
+
+
+void TestQueryContext::TestHighWaterMark()
+{
+    const uint32_t arenaSize = 1024;
+    QueryContext *context = CreateContext(arenaSize);
+
+    EA::Physics::SizeAndAlignment small(100, 4);
+    EA::Physics::SizeAndAlignment large(2000, 16);
+
+    {
+        QueryContext::Scope scope(*context);
+        EATESTAssert(context->Allocate(small), "Small request should fit.");
+        EATESTAssert(context->Allocate(small), "Small request should fit.");
+    }
+    EATESTAssert(0 == context->GetUsed(), "Scope should release the requests.");
+    EATESTAssert(200 == context->GetHighWaterMark(), "High water mark should be the peak usage.");
+    EATESTAssert(200 == context->GetRequiredSize(), "Required size should be the peak usage.");
+
+    {
+        QueryContext::Scope scope(*context);
+        EATESTAssert(context->Allocate(small), "Small request should fit.");
+        EATESTAssert(NULL == context->Allocate(large), "Large request should not fit.");
+        EATESTAssert(100 == context->GetUsed(), "Failed request should not take space in the arena.");
+        EATESTAssert(context->Allocate(small), "Small request should fit after a failed request.");
+    }
+    EATESTAssert(200 == context->GetHighWaterMark(), "Failed request should not change the high water mark.");
+    EATESTAssert(112 + 2000 == context->GetRequiredSize(), "Required size should include the aligned failed request.");
+    EATESTAssert(1 == context->GetNumFailedRequests(), "Failed request should be counted.");
+    EATESTAssert(4 == context->GetNumRequests(), "Successful requests should be counted.");
+
+    {
+        QueryContext::Scope scope(*context);
+        EATESTAssert(context->Allocate(small), "Small request should fit.");
+        EA::Physics::SizeAndAlignment huge(0xfffffff0u, 16);
+        EATESTAssert(NULL == context->Allocate(huge), "Request wrapping the end offset should not fit.");
+        EATESTAssert(100 == context->GetUsed(), "Failed request should not take space in the arena.");
+    }
+    EATESTAssert(0xffffffffu == context->GetRequiredSize(), "Required size should saturate.");
+
+    context->ResetStatistics();
+    EATESTAssert(0 == context->GetHighWaterMark(), "Statistics should be cleared.");
+    EATESTAssert(0 == context->GetRequiredSize(), "Statistics should be cleared.");
+    EATESTAssert(0 == context->GetNumFailedRequests(), "Statistics should be cleared.");
+    EATESTAssert(0 == context->GetNumRequests(), "Statistics should be cleared.");
+
+    FreeContext(context);
+}
@@ -0,0 +1,340 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+#include <string.h>    // for strlen(), strstr(), strncmp()
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Unit tests for the per query counters and the QueryStats histograms.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+class TestQueryStats: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestQueryStats");
+
+#define QUERY_STATS_TEST(F, D) EATEST_REGISTER(#F, D, TestQueryStats, F)
+
+        QUERY_STATS_TEST(TestLineQueryCounters, "Test the work of a line query against a clustered mesh is counted");
+        QUERY_STATS_TEST(TestBBoxQueryCounters, "Test the work of a bbox query against a clustered mesh is counted");
+        QUERY_STATS_TEST(TestMappedArrayCounters, "Test the child volumes of a mapped array are counted");
+        QUERY_STATS_TEST(TestPrimitiveBatchCounters, "Test the primitive tests of NxM batches are counted");
+        QUERY_STATS_TEST(TestHistogram, "Test the power of two buckets and percentiles of a histogram");
+        QUERY_STATS_TEST(TestRecordAndMerge, "Test recording queries and merging the statistics of two threads");
+        QUERY_STATS_TEST(TestWriteJSON, "Test writing the statistics as JSON into small and large buffers");
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+
+        m_meshVolume = LoadSerializedClusteredMesh("courtyard.dat");
+        m_meshVolume->GetBBox(0, TRUE, m_meshBBox);
+    }
+
+    virtual void TeardownSuite()
+    {
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(m_meshVolume);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol->GetAggregate());
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestLineQueryCounters();
+    void TestBBoxQueryCounters();
+    void TestMappedArrayCounters();
+    void TestPrimitiveBatchCounters();
+    void TestHistogram();
+    void TestRecordAndMerge();
+    void TestWriteJSON();
+
+    Volume *m_meshVolume;
+    AABBox m_meshBBox;
+
+} TestQueryStatsSingleton;
+
+
+void TestQueryStats::TestLineQueryCounters()
+{
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    const uint32_t STACKSIZE = 1;
+    VolumeLineQuery *largeQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 256u);
+    VolumeLineQuery *smallQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 1u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    // A line down through the middle of the mesh
+    const Vector3 centre = (m_meshBBox.Min() + m_meshBBox.Max()) * 0.5f;
+    const Vector3 start(centre.GetX(), m_meshBBox.Max().GetY() + 1.0f, centre.GetZ());
+    const Vector3 end(centre.GetX(), m_meshBBox.Min().GetY() - 1.0f, centre.GetZ());
+
+    largeQuery->InitQuery(volumes, NULL, 1, start, end);
+    const uint32_t numRes = largeQuery->GetAllIntersections();
+    EATESTAssert(numRes > 0, "Line should hit the mesh.");
+
+    const QueryCounters &counters = largeQuery->GetCounters();
+    EATESTAssert(counters.m_counts[QueryCounters::KDTREE_NODES] > 0, "KDTree nodes should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::KDTREE_LEAVES] > 0, "KDTree leaves should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::CLUSTERS] > 0, "Clusters should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::UNITS] > 0, "Units should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::TRIANGLES] >= numRes, "Each hit triangle should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::TRIANGLES] >= counters.m_counts[QueryCounters::UNITS], "Each unit has a triangle.");
+    EATESTAssert(counters.m_counts[QueryCounters::INSTANCED_VOLUMES] == numRes, "Each hit instances a triangle.");
+    EATESTAssert(0 == counters.m_counts[QueryCounters::RESTARTS], "Query should complete in one call.");
+    EATESTAssert(counters.GetWork() > 0, "Work should be counted.");
+
+    // The same query with a single result buffer restarts after every hit
+    smallQuery->InitQuery(volumes, NULL, 1, start, end);
+    uint32_t numCalls = 0;
+    while (!smallQuery->Finished())
+    {
+        smallQuery->GetAllIntersections();
+        ++numCalls;
+    }
+    EATESTAssert(numCalls > 1, "Query should need more than one call.");
+    EATESTAssert(smallQuery->GetCounters().m_counts[QueryCounters::RESTARTS] == numCalls - 1, "Each call after the first should be a restart.");
+    EATESTAssert(smallQuery->GetCounters().m_counts[QueryCounters::INSTANCED_VOLUMES] == numRes, "Restarts should not change the hits.");
+
+    // Initializing the query again clears the counters
+    smallQuery->InitQuery(volumes, NULL, 1, start, start);
+    EATESTAssert(0 == smallQuery->GetCounters().m_counts[QueryCounters::TRIANGLES], "InitQuery should reset the counters.");
+    EATESTAssert(0 == smallQuery->GetCounters().m_counts[QueryCounters::RESTARTS], "InitQuery should reset the counters.");
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+}
+
+
+void TestQueryStats::TestBBoxQueryCounters()
+{
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    const uint32_t STACKSIZE = 1;
+    VolumeBBoxQuery *query = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, 4u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    // A column a quarter of the width of the mesh through the middle of it
+    const Vector3 extent = m_meshBBox.Max() - m_meshBBox.Min();
+    const Vector3 min = m_meshBBox.Min() + Vector3(0.375f * extent.GetX(), 0.0f, 0.375f * extent.GetZ());
+    query->InitQuery(volumes, NULL, 1, AABBox(min, min + Vector3(0.25f * extent.GetX(), extent.GetY(), 0.25f * extent.GetZ())));
+
+    uint32_t numOverlaps = 0;
+    uint32_t numCalls = 0;
+    while (!query->Finished())
+    {
+        numOverlaps += query->GetOverlaps();
+        ++numCalls;
+    }
+    EATESTAssert(numOverlaps > 0, "Box should overlap the mesh.");
+
+    const QueryCounters &counters = query->GetCounters();
+    EATESTAssert(counters.m_counts[QueryCounters::KDTREE_LEAVES] > 0, "KDTree leaves should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::CLUSTERS] > 0, "Clusters should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::TRIANGLES] >= numOverlaps, "Each overlapping triangle should be counted.");
+    EATESTAssert(counters.m_counts[QueryCounters::INSTANCED_VOLUMES] == numOverlaps, "Each overlap instances a triangle.");
+    EATESTAssert(counters.m_counts[QueryCounters::RESTARTS] == numCalls - 1, "Each call after the first should be a restart.");
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+}
+
+
+void TestQueryStats::TestMappedArrayCounters()
+{
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    const uint32_t NUMPRIMS = 3;
+    const uint32_t STACKSIZE = 2;
+    const uint32_t RESBUFFERSIZE = 8;
+
+    // Three unit spheres spaced along the x axis
+    SimpleMappedArray *mappedArray = EA::Physics::UnitFramework::Creator<SimpleMappedArray>().New(NUMPRIMS);
+    for (uint16_t i = 0; i < NUMPRIMS; ++i)
+    {
+        SphereVolume::Initialize(EA::Physics::MemoryPtr(mappedArray->GetVolume(i)), 1.0f);
+        mappedArray->GetVolume(i)->SetLocalTransform(Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(),
+                                                                   Vector3(10.0f * static_cast<float>(i), 0.0f, 0.0f)));
+    }
+    mappedArray->UpdateThis();
+
+    AggregateVolume *aggVol = EA::Physics::UnitFramework::Creator<AggregateVolume>().New(mappedArray);
+    const Volume *volumes[] = { aggVol };
+
+    // A line along the x axis through all the spheres
+    VolumeLineQuery *lineQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, RESBUFFERSIZE);
+    lineQuery->InitQuery(volumes, NULL, 1, Vector3(-5.0f, 0.0f, 0.0f), Vector3(25.0f, 0.0f, 0.0f));
+    EATESTAssert(NUMPRIMS == lineQuery->GetAllIntersections(), "Line should hit every sphere.");
+    EATESTAssert(NUMPRIMS == lineQuery->GetCounters().m_counts[QueryCounters::CHILD_VOLUMES], "Each child volume should be counted.");
+    EATESTAssert(lineQuery->GetCounters().GetWork() >= NUMPRIMS, "Child volumes should be part of the work.");
+
+    // A box around the first sphere still tests every child of a simple mapped array
+    VolumeBBoxQuery *bboxQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, RESBUFFERSIZE);
+    bboxQuery->InitQuery(volumes, NULL, 1, AABBox(Vector3(-1.0f, -1.0f, -1.0f), Vector3(1.0f, 1.0f, 1.0f)));
+    EATESTAssert(1 == bboxQuery->GetOverlaps(), "Box should overlap the first sphere.");
+    EATESTAssert(NUMPRIMS == bboxQuery->GetCounters().m_counts[QueryCounters::CHILD_VOLUMES], "Each child volume should be counted.");
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+}
+
+
+void TestQueryStats::TestPrimitiveBatchCounters()
+{
+#if RW_COLLISION_DETAIL_QUERY_STATS
+    Volume vols1[2];
+    SphereVolume::Initialize(&vols1[0], 0.5f);
+    SphereVolume::Initialize(&vols1[1], 1.0f);
+    Matrix44Affine transforms1[] =
+    {
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(1.0f, 0.0f, 0.0f)),
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(5.0f, 0.0f, 0.0f)),
+    };
+    const Volume* v1[] = { &vols1[0], &vols1[1] };
+    const Matrix44Affine* t1[] = { &transforms1[0], &transforms1[1] };
+
+    Volume vols2[3];
+    SphereVolume::Initialize(&vols2[0], 1.0f);
+    SphereVolume::Initialize(&vols2[1], 0.1f);
+    SphereVolume::Initialize(&vols2[2], 2.0f);
+    Matrix44Affine transforms2[] =
+    {
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(1.3f, 0.0f, 0.0f)),
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(2.0f, 0.0f, 0.0f)),
+        Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(2.3f, 0.0f, 0.0f)),
+    };
+    const Volume* v2[] = { &vols2[0], &vols2[1], &vols2[2] };
+    const Matrix44Affine* t2[] = { &transforms2[0], &transforms2[1], &transforms2[2] };
+
+    PrimitivePairIntersectResult results[10];
+    GPInstance instancingSPR[10];
+
+    // Every pair of the batch is tested, whether or not it intersects
+    QueryCounters counters;
+    counters.Reset();
+    rw::collision::detail::PrimitiveBatchIntersectNxM(results, 10, instancingSPR, v1, t1, 2, v2, t2, 3,
+        COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold, COMPUTECONTACTS_DEFAULT_ConvexityEpsilon, &counters);
+    EATESTAssert(6 == counters.m_counts[QueryCounters::PRIMITIVE_TESTS], "Each pair of the batch should be counted.");
+
+    // Tiling the batch tests the same pairs, however the tiles divide it
+    for (int32_t tileSize = 1; tileSize <= 3; ++tileSize)
+    {
+        counters.Reset();
+        rw::collision::detail::PrimitiveBatchIntersectNxMTiled(results, 10, instancingSPR, v1, t1, 2, v2, t2, 3, tileSize,
+            COMPUTECONTACTS_DEFAULT_EdgeCosBendNormalThreshold, COMPUTECONTACTS_DEFAULT_ConvexityEpsilon, &counters);
+        EATESTAssert(6 == counters.m_counts[QueryCounters::PRIMITIVE_TESTS], "Each pair of the tiled batch should be counted once.");
+    }
+
+    // Counting is optional
+    rw::collision::detail::PrimitiveBatchIntersectNxM(results, 10, instancingSPR, v1, t1, 2, v2, t2, 3);
+#endif // RW_COLLISION_DETAIL_QUERY_STATS
+}
+
+
+void TestQueryStats::TestHistogram()
+{
+    QueryStats::Histogram histogram;
+    histogram.Reset();
+    EATESTAssert(0 == histogram.GetPercentile(0.5f), "Empty histogram should have a zero percentile.");
+
+    histogram.Add(0);
+    histogram.Add(1);
+    histogram.Add(2);
+    histogram.Add(3);
+    histogram.Add(1000);
+    EATESTAssert(1 == histogram.m_buckets[0], "Zero should be in the first bucket.");
+    EATESTAssert(1 == histogram.m_buckets[1], "One should be in the second bucket.");
+    EATESTAssert(2 == histogram.m_buckets[2], "Two and three should share a bucket.");
+    EATESTAssert(1 == histogram.m_buckets[10], "1000 should be in the bucket up to 1023.");
+
+    EATESTAssert(3 == histogram.GetPercentile(0.5f), "Median should be in the bucket up to 3.");
+    EATESTAssert(1023 == histogram.GetPercentile(0.99f), "99th percentile should be in the bucket up to 1023.");
+    EATESTAssert(1023 == histogram.GetPercentile(1.0f), "Maximum should be in the bucket up to 1023.");
+
+    // Very large values go in the last bucket
+    histogram.Add(~static_cast<uint64_t>(0));
+    EATESTAssert(1 == histogram.m_buckets[QueryStats::Histogram::NUM_BUCKETS - 1], "Large values should be in the last bucket.");
+}
+
+
+void TestQueryStats::TestRecordAndMerge()
+{
+    QueryCounters counters;
+    counters.Reset();
+    counters.m_counts[QueryCounters::KDTREE_NODES] = 10;
+    counters.m_counts[QueryCounters::TRIANGLES] = 20;
+    counters.m_counts[QueryCounters::PRIMITIVE_TESTS] = 2;
+    counters.m_counts[QueryCounters::RESTARTS] = 1;
+    EATESTAssert(32 == counters.GetWork(), "Work should be nodes, triangles and primitive tests.");
+
+    // Two threads each record their own queries
+    QueryStats threadStats[2];
+    threadStats[0].Record(QueryStats::LINE_QUERY, counters, 100);
+    threadStats[0].Record(QueryStats::LINE_QUERY, counters, 300);
+    threadStats[1].Record(QueryStats::LINE_QUERY, counters, 200);
+    threadStats[1].Record(QueryStats::BBOX_QUERY, counters, 50);
+
+    QueryStats frameStats;
+    frameStats.Merge(threadStats[0]);
+    frameStats.Merge(threadStats[1]);
+
+    const QueryStats::QueryTypeStats &lineStats = frameStats.GetQueryTypeStats(QueryStats::LINE_QUERY);
+    EATESTAssert(3 == lineStats.m_numQueries, "Line queries of both threads should be merged.");
+    EATESTAssert(600 == lineStats.m_totalTicks, "Ticks should be totalled.");
+    EATESTAssert(60 == lineStats.m_totals[QueryCounters::TRIANGLES], "Counters should be totalled.");
+    EATESTAssert(3 == lineStats.m_totals[QueryCounters::RESTARTS], "Counters should be totalled.");
+    EATESTAssert(3 == lineStats.m_work.m_buckets[6], "Work of 32 should be in the bucket up to 63.");
+    EATESTAssert(255 == lineStats.m_latency.GetPercentile(0.5f), "Median latency should be in the bucket up to 255.");
+    EATESTAssert(511 == lineStats.m_latency.GetPercentile(0.99f), "Slowest latency should be in the bucket up to 511.");
+
+    EATESTAssert(1 == frameStats.GetQueryTypeStats(QueryStats::BBOX_QUERY).m_numQueries, "BBox queries should be kept separately.");
+    EATESTAssert(0 == frameStats.GetQueryTypeStats(QueryStats::VOLUMEVOLUME_QUERY).m_numQueries, "No volume queries were recorded.");
+
+    frameStats.Reset();
+    EATESTAssert(0 == frameStats.GetQueryTypeStats(QueryStats::LINE_QUERY).m_numQueries, "Reset should clear the statistics.");
+    EATESTAssert(0 == frameStats.GetQueryTypeStats(QueryStats::LINE_QUERY).m_latency.GetPercentile(1.0f), "Reset should clear the histograms.");
+}
+
+
+void TestQueryStats::TestWriteJSON()
+{
+    QueryCounters counters;
+    counters.Reset();
+    counters.m_counts[QueryCounters::TRIANGLES] = 12345;
+
+    QueryStats stats;
+    stats.Record(QueryStats::VOLUMEVOLUME_QUERY, counters, 7);
+
+    char buffer[4096];
+    const uint32_t length = stats.WriteJSON(buffer, sizeof(buffer));
+    EATESTAssert(length < sizeof(buffer), "JSON should fit in the buffer.");
+    EATESTAssert(length == strlen(buffer), "Length should match the text.");
+    EATESTAssert('{' == buffer[0] && '}' == buffer[length - 1], "JSON should be an object.");
+    EATESTAssert(strstr(buffer, "\"lineQuery\":{\"queries\":0"), "Each query type should be written.");
+    EATESTAssert(strstr(buffer, "\"volumeVolumeQuery\":{\"queries\":1,\"ticks\":7"), "Queries and ticks should be written.");
+    EATESTAssert(strstr(buffer, "\"triangles\":12345"), "Counter totals should be written.");
+    EATESTAssert(strstr(buffer, "\"latency\":{\"p50\":7,\"p99\":7,\"buckets\":[0,0,0,1]}"), "Latency histogram should be written.");
+
+    // A small buffer is truncated but still terminated, and the full length is returned
+    char smallBuffer[16];
+    const uint32_t truncatedLength = stats.WriteJSON(smallBuffer, sizeof(smallBuffer));
+    EATESTAssert(truncatedLength == length, "Full length should be returned when truncated.");
+    EATESTAssert(sizeof(smallBuffer) - 1 == strlen(smallBuffer), "Truncated text should be terminated.");
+    EATESTAssert(0 == strncmp(buffer, smallBuffer, sizeof(smallBuffer) - 1), "Truncated text should be the start of the JSON.");
+
+    EATESTAssert(length == stats.WriteJSON(NULL, 0), "Length should be returned without a buffer.");
+}
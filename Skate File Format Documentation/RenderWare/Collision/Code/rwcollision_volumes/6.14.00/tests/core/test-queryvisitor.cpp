@@ -0,0 +1,383 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+
+#include <eaphysics/unitframework/allocator.h> // For ResetAllocator
+#include <eaphysics/unitframework/creator.h> // For Creator
+#include "eaphysics/unitframework/serialization_test_helpers.hpp"
+
+#include "testsuitebase.h" // For TestSuiteBase
+
+#include "clusteredmesh_test_helpers.hpp"
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Unit tests for the streaming visitor mode of VolumeLineQuery and VolumeBBoxQuery, which are checked
+// against the buffered mode of the same queries.
+// This package is unable to easily create ClusteredMesh objects for testing so these
+// tests rely on data files which have been created by the rwphysics_conditioning package.
+
+namespace
+{
+
+const uint32_t NUMLINES = 16;
+
+/// Counts every intersection and sums the line parameters.
+struct CountIntersections
+{
+    CountIntersections() : m_count(0), m_lineParamSum(0.0f) {}
+
+    RwpBool operator()(const VolumeLineSegIntersectResult &result, float & /*endClip*/)
+    {
+        ++m_count;
+        m_lineParamSum += result.lineParam;
+        return TRUE;
+    }
+
+    uint32_t m_count;
+    float    m_lineParamSum;
+};
+
+/// Stops at the first intersection.
+struct AnyIntersection
+{
+    RwpBool operator()(const VolumeLineSegIntersectResult & /*result*/, float & /*endClip*/)
+    {
+        return FALSE;
+    }
+};
+
+/// Clips the line to each intersection to find the nearest.
+struct NearestIntersection
+{
+    NearestIntersection() : m_lineParam(MAX_FLOAT) {}
+
+    RwpBool operator()(const VolumeLineSegIntersectResult &result, float &endClip)
+    {
+        EATESTAssert(result.lineParam <= endClip, "Intersection beyond the clipped line should not be visited.");
+        m_lineParam = result.lineParam;
+        endClip = result.lineParam;
+        return TRUE;
+    }
+
+    float m_lineParam;
+};
+
+/// Counts every overlap and sums the tags.
+struct CountOverlaps
+{
+    CountOverlaps() : m_count(0), m_tagSum(0) {}
+
+    RwpBool operator()(const VolRef &vRef)
+    {
+        ++m_count;
+        m_tagSum += vRef.tag;
+        return TRUE;
+    }
+
+    uint32_t m_count;
+    uint32_t m_tagSum;
+};
+
+/// Stops at the first overlap.
+struct AnyOverlap
+{
+    RwpBool operator()(const VolRef & /*vRef*/)
+    {
+        return FALSE;
+    }
+};
+
+}
+
+
+class TestQueryVisitor: public tests::TestSuiteBase
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestQueryVisitor");
+
+#define QUERY_VISITOR_TEST(F, D) EATEST_REGISTER(#F, D, TestQueryVisitor, F)
+
+        QUERY_VISITOR_TEST(TestLineVisitorEnumeration, "Test visiting every line intersection matches the buffered query");
+        QUERY_VISITOR_TEST(TestLineVisitorAnyHit, "Test a line visitor stopping at the first intersection");
+        QUERY_VISITOR_TEST(TestLineVisitorClip, "Test a line visitor clipping the line to find the nearest intersection");
+        QUERY_VISITOR_TEST(TestLineVisitorResume, "Test a buffered line query resumes after a visitor stops");
+        QUERY_VISITOR_TEST(TestBBoxVisitorEnumeration, "Test visiting every bbox overlap matches the buffered query");
+        QUERY_VISITOR_TEST(TestBBoxVisitorAnyHit, "Test a bbox visitor stopping at the first overlap");
+    }
+
+    virtual void SetupSuite()
+    {
+        tests::TestSuiteBase::SetupSuite();
+        // Initialise the collision system
+        Volume::InitializeVTable();
+
+        m_meshVolume = LoadSerializedClusteredMesh("courtyard.dat");
+        m_meshVolume->GetBBox(0, TRUE, m_meshBBox);
+    }
+
+    virtual void TeardownSuite()
+    {
+        AggregateVolume *aggVol = static_cast<AggregateVolume *>(m_meshVolume);
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol->GetAggregate());
+        EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(aggVol);
+
+        EA::Physics::UnitFramework::ResetAllocator();
+        tests::TestSuiteBase::TeardownSuite();
+    }
+
+private:
+
+    void TestLineVisitorEnumeration();
+    void TestLineVisitorAnyHit();
+    void TestLineVisitorClip();
+    void TestLineVisitorResume();
+    void TestBBoxVisitorEnumeration();
+    void TestBBoxVisitorAnyHit();
+
+    /// Gets a line crossing the mesh from above, from a fixed pseudo random sequence.
+    void GetLine(uint32_t index, Vector3 &start, Vector3 &end) const
+    {
+        const Vector3 extent = m_meshBBox.Max() - m_meshBBox.Min();
+        const float u = float((index * 7u) % NUMLINES) / float(NUMLINES);
+        const float v = float((index * 11u) % NUMLINES) / float(NUMLINES);
+        start = m_meshBBox.Min() + Vector3(u * extent.GetX(), extent.GetY() + 1.0f, v * extent.GetZ());
+        end = m_meshBBox.Min() + Vector3((1.0f - v) * extent.GetX(), -1.0f, (1.0f - u) * extent.GetZ());
+    }
+
+    /// Gets a box within the mesh bounds an eighth of the size of the mesh.
+    AABBox GetBox(uint32_t index) const
+    {
+        const Vector3 extent = m_meshBBox.Max() - m_meshBBox.Min();
+        const float u = float((index * 7u) % NUMLINES) / float(NUMLINES);
+        const float v = float((index * 11u) % NUMLINES) / float(NUMLINES);
+        const Vector3 min = m_meshBBox.Min() + Vector3(0.875f * u * extent.GetX(), 0.0f, 0.875f * v * extent.GetZ());
+        return AABBox(min, min + Vector3(0.125f * extent.GetX(), extent.GetY(), 0.125f * extent.GetZ()));
+    }
+
+    Volume *m_meshVolume;
+    AABBox m_meshBBox;
+
+} TestQueryVisitorSingleton;
+
+
+void TestQueryVisitor::TestLineVisitorEnumeration()
+{
+    const uint32_t STACKSIZE = 1;
+    VolumeLineQuery *bufferedQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 256u);
+    VolumeLineQuery *smallQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 1u);
+    VolumeLineQuery *batchQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 8u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < NUMLINES; ++i)
+    {
+        Vector3 start, end;
+        GetLine(i, start, end);
+
+        uint32_t bufferedCount = 0;
+        float bufferedSum = 0.0f;
+        bufferedQuery->InitQuery(volumes, NULL, 1, start, end);
+        while (!bufferedQuery->Finished())
+        {
+            const uint32_t numRes = bufferedQuery->GetAllIntersections();
+            const VolumeLineSegIntersectResult *results = bufferedQuery->GetIntersectionResultsBuffer();
+            for (uint32_t r = 0; r < numRes; ++r)
+            {
+                bufferedSum += results[r].lineParam;
+            }
+            bufferedCount += numRes;
+        }
+
+        CountIntersections streamed;
+        smallQuery->InitQuery(volumes, NULL, 1, start, end);
+        const uint32_t numVisited = smallQuery->VisitIntersections(streamed);
+        EATESTAssert(numVisited == streamed.m_count, "Visited count should match the visitor.");
+        EATESTAssert(streamed.m_count == bufferedCount, "Single result visitor should see every intersection.");
+        EATESTAssert(IsSimilar(streamed.m_lineParamSum, bufferedSum, 1e-3f), "Single result visitor should see the same intersections.");
+        EATESTAssert(smallQuery->Finished(), "Query should be finished.");
+
+        CountIntersections batched;
+        batchQuery->InitQuery(volumes, NULL, 1, start, end);
+        batchQuery->VisitIntersections(batched, 8u);
+        EATESTAssert(batched.m_count == bufferedCount, "Batched visitor should see every intersection.");
+        EATESTAssert(IsSimilar(batched.m_lineParamSum, bufferedSum, 1e-3f), "Batched visitor should see the same intersections.");
+
+        total += bufferedCount;
+    }
+    EATESTAssert(total > 0, "Lines should hit the mesh.");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(batchQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(smallQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bufferedQuery);
+}
+
+
+void TestQueryVisitor::TestLineVisitorAnyHit()
+{
+    const uint32_t STACKSIZE = 1;
+    VolumeLineQuery *query = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 1u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    for (uint32_t i = 0; i < NUMLINES; ++i)
+    {
+        Vector3 start, end;
+        GetLine(i, start, end);
+
+        query->InitQuery(volumes, NULL, 1, start, end);
+        const RwpBool anyBuffered = query->GetAnyIntersection() != NULL;
+
+        AnyIntersection visitor;
+        query->InitQuery(volumes, NULL, 1, start, end);
+        const uint32_t numVisited = query->VisitIntersections(visitor);
+        EATESTAssert(numVisited == (anyBuffered ? 1u : 0u), "Visitor should stop at the first intersection.");
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(query);
+}
+
+
+void TestQueryVisitor::TestLineVisitorClip()
+{
+    const uint32_t STACKSIZE = 1;
+    VolumeLineQuery *bufferedQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 256u);
+    VolumeLineQuery *query = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 1u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    for (uint32_t i = 0; i < NUMLINES; ++i)
+    {
+        Vector3 start, end;
+        GetLine(i, start, end);
+
+        bufferedQuery->InitQuery(volumes, NULL, 1, start, end);
+        const VolumeLineSegIntersectResult *nearest = bufferedQuery->GetNearestIntersection();
+
+        CountIntersections all;
+        query->InitQuery(volumes, NULL, 1, start, end);
+        const uint32_t allCount = query->VisitIntersections(all);
+
+        NearestIntersection visitor;
+        query->InitQuery(volumes, NULL, 1, start, end);
+        const uint32_t numVisited = query->VisitIntersections(visitor);
+
+        EATESTAssert(numVisited <= allCount, "Clipping should not visit more intersections.");
+        if (nearest)
+        {
+            EATESTAssert(IsSimilar(visitor.m_lineParam, nearest->lineParam, 1e-5f), "Clipping visitor should find the nearest intersection.");
+        }
+        else
+        {
+            EATESTAssert(numVisited == 0, "Line should not hit the mesh.");
+        }
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(query);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bufferedQuery);
+}
+
+
+void TestQueryVisitor::TestLineVisitorResume()
+{
+    const uint32_t STACKSIZE = 1;
+    VolumeLineQuery *bufferedQuery = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 256u);
+    VolumeLineQuery *query = EA::Physics::UnitFramework::Creator<VolumeLineQuery>().New(STACKSIZE, 8u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    for (uint32_t i = 0; i < NUMLINES; ++i)
+    {
+        Vector3 start, end;
+        GetLine(i, start, end);
+
+        uint32_t bufferedCount = 0;
+        bufferedQuery->InitQuery(volumes, NULL, 1, start, end);
+        while (!bufferedQuery->Finished())
+        {
+            bufferedCount += bufferedQuery->GetAllIntersections();
+        }
+
+        AnyIntersection visitor;
+        query->InitQuery(volumes, NULL, 1, start, end);
+        uint32_t count = query->VisitIntersections(visitor);
+        while (!query->Finished())
+        {
+            count += query->GetAllIntersections();
+        }
+        EATESTAssert(count == bufferedCount, "Buffered query should return the intersections the visitor did not see.");
+    }
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(query);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bufferedQuery);
+}
+
+
+void TestQueryVisitor::TestBBoxVisitorEnumeration()
+{
+    const uint32_t STACKSIZE = 1;
+    VolumeBBoxQuery *bufferedQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, 4096u);
+    VolumeBBoxQuery *smallQuery = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, 1u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < NUMLINES; ++i)
+    {
+        const AABBox box = GetBox(i);
+
+        uint32_t bufferedCount = 0;
+        uint32_t bufferedTagSum = 0;
+        bufferedQuery->InitQuery(volumes, NULL, 1, box);
+        while (!bufferedQuery->Finished())
+        {
+            const uint32_t numRes = bufferedQuery->GetOverlaps();
+            const VolRef *results = bufferedQuery->GetOverlapResultsBuffer();
+            for (uint32_t r = 0; r < numRes; ++r)
+            {
+                bufferedTagSum += results[r].tag;
+            }
+            bufferedCount += numRes;
+        }
+
+        CountOverlaps streamed;
+        smallQuery->InitQuery(volumes, NULL, 1, box);
+        const uint32_t numVisited = smallQuery->VisitOverlaps(streamed);
+        EATESTAssert(numVisited == bufferedCount, "Visitor should see every overlap.");
+        EATESTAssert(streamed.m_tagSum == bufferedTagSum, "Visitor should see the same overlaps.");
+
+        CountOverlaps batched;
+        bufferedQuery->InitQuery(volumes, NULL, 1, box);
+        bufferedQuery->VisitOverlaps(batched, 64u);
+        EATESTAssert(batched.m_count == bufferedCount, "Batched visitor should see every overlap.");
+        EATESTAssert(batched.m_tagSum == bufferedTagSum, "Batched visitor should see the same overlaps.");
+        EATESTAssert(bufferedQuery->m_primBufferSize == 4096u, "Visitor should restore the results buffer size.");
+
+        total += bufferedCount;
+    }
+    EATESTAssert(total > 0, "Boxes should overlap the mesh.");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(smallQuery);
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(bufferedQuery);
+}
+
+
+void TestQueryVisitor::TestBBoxVisitorAnyHit()
+{
+    const uint32_t STACKSIZE = 1;
+    VolumeBBoxQuery *query = EA::Physics::UnitFramework::Creator<VolumeBBoxQuery>().New(STACKSIZE, 64u);
+    const Volume *volumes[] = { m_meshVolume };
+
+    AnyOverlap visitor;
+    query->InitQuery(volumes, NULL, 1, m_meshBBox);
+    const uint32_t numVisited = query->VisitOverlaps(visitor);
+    EATESTAssert(numVisited == 1, "Visitor should stop at the first overlap.");
+    EATESTAssert(!query->Finished(), "Query should have stopped early.");
+    EATESTAssert(query->m_primBufferSize == 64u, "Visitor should restore the results buffer size.");
+
+    EA::Allocator::ICoreAllocator::GetDefaultAllocator()->Free(query);
+}
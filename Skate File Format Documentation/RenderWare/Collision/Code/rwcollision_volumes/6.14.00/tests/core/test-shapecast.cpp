@@ -0,0 +1,374 @@
+// (c) Electronic Arts. All Rights Reserved.
+
+#include <unit/unit.h>
+
+#include <EABase/eabase.h>
+#include <eaphysics/base.h>
+
+#include <rw/collision/libcore.h>
+#include "clusteredmeshtest_base.hpp"
+
+using namespace rwpmath;
+using namespace rw::collision;
+
+// Unit tests for shape casts against single triangles and against a ClusteredMesh.
+
+class TestShapeCast: public ClusteredMeshTest_Base
+{
+public:
+    virtual void Initialize()
+    {
+        SuiteName("TestShapeCast");
+
+#define SHAPE_CAST_TEST(F, D) EATEST_REGISTER(#F, D, TestShapeCast, F)
+
+        SHAPE_CAST_TEST(TestSphereCastFace, "Test a sphere cast onto a triangle face");
+        SHAPE_CAST_TEST(TestSphereCastThinRail, "Test a fast sphere cast does not pass through a thin rail");
+        SHAPE_CAST_TEST(TestSphereCastOneSided, "Test a sphere cast against the back of a one sided triangle is rejected");
+        SHAPE_CAST_TEST(TestSphereCastMiss, "Test a sphere cast passing beside a triangle");
+        SHAPE_CAST_TEST(TestCapsuleCastFace, "Test a capsule cast onto a triangle face");
+        SHAPE_CAST_TEST(TestCapsuleCastEdge, "Test the side of a capsule cast onto a triangle edge");
+        SHAPE_CAST_TEST(TestCapsuleCastVertex, "Test the side of a capsule cast onto a triangle vertex");
+        SHAPE_CAST_TEST(TestBoxCastFace, "Test a box cast onto a triangle face");
+        SHAPE_CAST_TEST(TestBoxCastEdge, "Test the edge of a box cast onto a triangle edge");
+        SHAPE_CAST_TEST(TestBoxCastStartsOverlapping, "Test a box cast which starts touching a triangle");
+        SHAPE_CAST_TEST(TestBoxCastMiss, "Test a box cast passing beside a triangle");
+
+#if !defined(EA_PLATFORM_PS3_SPU)
+        SHAPE_CAST_TEST(TestClusteredMeshSphereCast, "Test sphere casts against a clustered mesh");
+        SHAPE_CAST_TEST(TestClusteredMeshCapsuleCast, "Test capsule casts against a clustered mesh");
+        SHAPE_CAST_TEST(TestClusteredMeshBoxCast, "Test box casts against a clustered mesh");
+        SHAPE_CAST_TEST(TestClusteredMeshCastMiss, "Test a shape cast missing a clustered mesh");
+#endif // !defined(EA_PLATFORM_PS3_SPU)
+    }
+
+private:
+
+    void TestSphereCastFace();
+    void TestSphereCastThinRail();
+    void TestSphereCastOneSided();
+    void TestSphereCastMiss();
+    void TestCapsuleCastFace();
+    void TestCapsuleCastEdge();
+    void TestCapsuleCastVertex();
+    void TestBoxCastFace();
+    void TestBoxCastEdge();
+    void TestBoxCastStartsOverlapping();
+    void TestBoxCastMiss();
+
+#if !defined(EA_PLATFORM_PS3_SPU)
+    void TestClusteredMeshSphereCast();
+    void TestClusteredMeshCapsuleCast();
+    void TestClusteredMeshBoxCast();
+    void TestClusteredMeshCastMiss();
+
+    void ClusteredMeshCastTester(const CastShape &localShape, float bottom, bool checkChildIndex);
+#endif // !defined(EA_PLATFORM_PS3_SPU)
+
+} TestShapeCastSingleton;
+
+
+namespace
+{
+
+const uint32_t g_triangleFlags = GPInstance::FLAG_TRIANGLEDEFAULT;
+const Vector3 g_edgeCosines(-1.0f, -1.0f, -1.0f);
+
+// Flat triangle in the xz plane with its face normal pointing up the y axis.
+const Vector3 g_flat0(0.0f, 0.0f, 0.0f);
+const Vector3 g_flat1(0.0f, 0.0f, 1.0f);
+const Vector3 g_flat2(1.0f, 0.0f, 0.0f);
+
+// Vertical triangle in the xy plane with its top edge, from rail2 to rail0, along the x axis.
+const Vector3 g_rail0(-1.0f, 0.0f, 0.0f);
+const Vector3 g_rail1(0.0f, -1.0f, 0.0f);
+const Vector3 g_rail2(1.0f, 0.0f, 0.0f);
+
+}
+
+
+void TestShapeCast::TestSphereCastFace()
+{
+    const CastShape sphere = CastShape::Sphere(Vector3(0.25f, 1.0f, 0.25f), 0.25f);
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, sphere, Vector3(0.0f, -2.0f, 0.0f),
+        g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+
+    EATESTAssert(hit, "Sphere should hit the triangle.");
+    EATESTAssert(IsSimilar(result.lineParam, 0.375f, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, 1.0f, 0.0f), 1e-5f), "Incorrect contact normal.");
+    EATESTAssert(IsSimilar(result.position, Vector3(0.25f, 0.0f, 0.25f), 1e-5f), "Incorrect contact position.");
+}
+
+
+void TestShapeCast::TestSphereCastThinRail()
+{
+    // Moving 100 units in one cast, the sphere is well clear of the rail at both ends of the sweep.
+    const CastShape sphere = CastShape::Sphere(Vector3(0.3f, 5.0f, 0.05f), 0.1f);
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, sphere, Vector3(0.0f, -100.0f, 0.0f),
+        g_rail0, g_rail1, g_rail2, g_edgeCosines, g_triangleFlags);
+
+    // Sphere touches the rail edge when its centre is sqrt(0.1^2 - 0.05^2) above it.
+    const float expectedLineParam = (5.0f - 0.0866025f) / 100.0f;
+    EATESTAssert(hit, "Sphere should hit the rail.");
+    EATESTAssert(IsSimilar(result.lineParam, expectedLineParam, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.position, Vector3(0.3f, 0.0f, 0.0f), 1e-4f), "Contact should be on the rail edge.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, 0.866025f, 0.5f), 1e-4f), "Incorrect contact normal.");
+}
+
+
+void TestShapeCast::TestSphereCastOneSided()
+{
+    const uint32_t oneSidedFlags = g_triangleFlags | GPInstance::FLAG_TRIANGLEONESIDED;
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, CastShape::Sphere(Vector3(0.25f, 1.0f, 0.25f), 0.25f),
+        Vector3(0.0f, -2.0f, 0.0f), g_flat0, g_flat1, g_flat2, g_edgeCosines, oneSidedFlags);
+    EATESTAssert(hit, "Sphere should hit the front of the one sided triangle.");
+    EATESTAssert(IsSimilar(result.lineParam, 0.375f, 1e-5f), "Incorrect time of impact.");
+
+    hit = TriangleShapeCast(result, CastShape::Sphere(Vector3(0.25f, -1.0f, 0.25f), 0.25f),
+        Vector3(0.0f, 2.0f, 0.0f), g_flat0, g_flat1, g_flat2, g_edgeCosines, oneSidedFlags);
+    EATESTAssert(!hit, "Sphere should not hit the back of the one sided triangle.");
+
+    hit = TriangleShapeCast(result, CastShape::Sphere(Vector3(0.25f, -1.0f, 0.25f), 0.25f),
+        Vector3(0.0f, 2.0f, 0.0f), g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+    EATESTAssert(hit, "Sphere should hit the back of the two sided triangle.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, -1.0f, 0.0f), 1e-5f), "Incorrect contact normal.");
+}
+
+
+void TestShapeCast::TestSphereCastMiss()
+{
+    ShapeCastResult result;
+    RwpBool hit = TriangleShapeCast(result, CastShape::Sphere(Vector3(2.0f, 1.0f, 2.0f), 0.25f),
+        Vector3(0.0f, -2.0f, 0.0f), g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+    EATESTAssert(!hit, "Sphere should miss the triangle.");
+
+    hit = TriangleShapeCast(result, CastShape::Sphere(Vector3(0.25f, 1.0f, 0.25f), 0.25f),
+        Vector3(0.0f, -0.5f, 0.0f), g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+    EATESTAssert(!hit, "Sphere should stop short of the triangle.");
+}
+
+
+void TestShapeCast::TestCapsuleCastFace()
+{
+    const CastShape capsule = CastShape::Capsule(Vector3(0.3f, 1.0f, 0.3f), GetVector3_XAxis(), 0.1f, 0.2f);
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, capsule, Vector3(0.0f, -2.0f, 0.0f),
+        g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+
+    EATESTAssert(hit, "Capsule should hit the triangle.");
+    EATESTAssert(IsSimilar(result.lineParam, 0.4f, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, 1.0f, 0.0f), 1e-5f), "Incorrect contact normal.");
+    EATESTAssert(IsSimilar(result.position.GetY(), 0.0f, 1e-5f), "Contact should be on the triangle.");
+}
+
+
+void TestShapeCast::TestCapsuleCastEdge()
+{
+    // A capsule lying across the rail, the end caps are too far from the rail to touch it.
+    const CastShape capsule = CastShape::Capsule(Vector3(0.2f, 1.0f, 0.0f), GetVector3_ZAxis(), 1.0f, 0.25f);
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, capsule, Vector3(0.0f, -2.0f, 0.0f),
+        g_rail0, g_rail1, g_rail2, g_edgeCosines, g_triangleFlags);
+
+    EATESTAssert(hit, "Capsule should hit the rail.");
+    EATESTAssert(IsSimilar(result.lineParam, 0.375f, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, 1.0f, 0.0f), 1e-5f), "Incorrect contact normal.");
+    EATESTAssert(IsSimilar(result.position, Vector3(0.2f, 0.0f, 0.0f), 1e-5f), "Incorrect contact position.");
+}
+
+
+void TestShapeCast::TestCapsuleCastVertex()
+{
+    // A capsule along the z axis swept sideways into the pointed bottom vertex of the rail.
+    const CastShape capsule = CastShape::Capsule(Vector3(2.0f, -1.0f, 0.0f), GetVector3_ZAxis(), 1.0f, 0.5f);
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, capsule, Vector3(-4.0f, 0.0f, 0.0f),
+        g_rail0, g_rail1, g_rail2, g_edgeCosines, g_triangleFlags);
+
+    // The capsule side meets the rail edge from rail1 to rail2 before it reaches the vertex.
+    // The edge is at 45 degrees so the contact is where the capsule centre is 0.5*sqrt(2) from the edge line.
+    const float expectedLineParam = (2.0f - 0.5f * 1.41421356f) / 4.0f;
+    EATESTAssert(hit, "Capsule should hit the rail.");
+    EATESTAssert(IsSimilar(result.lineParam, expectedLineParam, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.70710678f, -0.70710678f, 0.0f), 1e-5f), "Incorrect contact normal.");
+
+    // Sweeping straight up into the pointed bottom vertex hits the vertex.
+    hit = TriangleShapeCast(result, CastShape::Capsule(Vector3(0.0f, -3.0f, 0.0f), GetVector3_ZAxis(), 1.0f, 0.5f),
+        Vector3(0.0f, 4.0f, 0.0f), g_rail0, g_rail1, g_rail2, g_edgeCosines, g_triangleFlags);
+    EATESTAssert(hit, "Capsule should hit the rail vertex.");
+    EATESTAssert(IsSimilar(result.lineParam, 1.5f / 4.0f, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, -1.0f, 0.0f), 1e-5f), "Incorrect contact normal.");
+    EATESTAssert(IsSimilar(result.position, g_rail1, 1e-5f), "Contact should be at the rail vertex.");
+}
+
+
+void TestShapeCast::TestBoxCastFace()
+{
+    const Matrix44Affine boxTm(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(0.25f, 1.0f, 0.25f));
+    const CastShape box = CastShape::Box(boxTm, Vector3(0.1f, 0.2f, 0.1f));
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, box, Vector3(0.0f, -2.0f, 0.0f),
+        g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+
+    EATESTAssert(hit, "Box should hit the triangle.");
+    EATESTAssert(IsSimilar(result.lineParam, 0.4f, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, 1.0f, 0.0f), 1e-5f), "Incorrect contact normal.");
+    EATESTAssert(IsSimilar(result.position, Vector3(0.25f, 0.0f, 0.25f), 1e-5f), "Incorrect contact position.");
+}
+
+
+void TestShapeCast::TestBoxCastEdge()
+{
+    // A cube rotated 45 degrees about z so that its lowest edge crosses the rail edge.
+    const float c = 0.70710678f;
+    const Matrix44Affine boxTm(Vector3(c, c, 0.0f), Vector3(-c, c, 0.0f), GetVector3_ZAxis(), Vector3(0.1f, 2.0f, 0.0f));
+    const CastShape box = CastShape::Box(boxTm, Vector3(0.5f, 0.5f, 0.5f));
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, box, Vector3(0.0f, -2.0f, 0.0f),
+        g_rail0, g_rail1, g_rail2, g_edgeCosines, g_triangleFlags);
+
+    EATESTAssert(hit, "Box should hit the rail.");
+    EATESTAssert(IsSimilar(result.lineParam, (2.0f - c) / 2.0f, 1e-5f), "Incorrect time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, 1.0f, 0.0f), 1e-5f), "Incorrect contact normal.");
+    EATESTAssert(IsSimilar(result.position, Vector3(0.1f, 0.0f, 0.0f), 1e-5f), "Incorrect contact position.");
+}
+
+
+void TestShapeCast::TestBoxCastStartsOverlapping()
+{
+    const Matrix44Affine boxTm(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(0.25f, 0.05f, 0.25f));
+    const CastShape box = CastShape::Box(boxTm, Vector3(0.1f, 0.1f, 0.1f));
+    ShapeCastResult result;
+
+    RwpBool hit = TriangleShapeCast(result, box, Vector3(0.0f, 2.0f, 0.0f),
+        g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+
+    EATESTAssert(hit, "Box should start touching the triangle.");
+    EATESTAssert(result.lineParam == 0.0f, "Overlapping box should have zero time of impact.");
+    EATESTAssert(IsSimilar(result.normal, Vector3(0.0f, 1.0f, 0.0f), 1e-5f), "Normal should face the box centre.");
+}
+
+
+void TestShapeCast::TestBoxCastMiss()
+{
+    const Matrix44Affine boxTm(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(0.9f, 1.0f, 0.9f));
+    const CastShape box = CastShape::Box(boxTm, Vector3(0.1f, 0.1f, 0.1f));
+    ShapeCastResult result;
+
+    // The box passes over the hypotenuse of the triangle without touching it.
+    RwpBool hit = TriangleShapeCast(result, box, Vector3(0.0f, -2.0f, 0.0f),
+        g_flat0, g_flat1, g_flat2, g_edgeCosines, g_triangleFlags);
+    EATESTAssert(!hit, "Box should miss the triangle.");
+}
+
+
+#if !defined(EA_PLATFORM_PS3_SPU)
+
+/**
+Casts the shape down onto the flat 4x4 test mesh from a grid of start points, with the mesh under a rotated
+transform, and checks the time of impact and normal against the analytic result.
+
+\param localShape   The shape in the frame of the mesh, positioned with its centre 2 units above the mesh.
+\param bottom       The distance from the shape centre to the lowest point of the shape.
+\param checkChildIndex Whether the contact point is unique, so should lie on the reported triangle.
+*/
+void TestShapeCast::ClusteredMeshCastTester(const CastShape &localShape, float bottom, bool checkChildIndex)
+{
+    const float cos45 = 0.707106781f;
+    const float sin45 = 0.707106781f;
+    const Matrix44Affine tm(GetVector3_XAxis(),
+        Vector3(0.0f, cos45, -sin45),
+        Vector3(0.0f, sin45, cos45),
+        Vector3(1.0f, 0.123456f, -2.0f));
+    const Matrix44Affine invTm(InverseOfMatrixWithOrthonormal3x3(tm));
+
+    const Vector3 localDelta(0.3f, -4.0f, -0.2f);
+    const Vector3 delta = TransformVector(localDelta, tm);
+    const Vector3 expectedNormal = TransformVector(GetVector3_YAxis(), tm);
+    const float expectedLineParam = (2.0f - bottom) / 4.0f;
+
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        for (uint32_t j = 0; j < 6; ++j)
+        {
+            // Start points over the interior of the mesh, offset from the vertices.
+            const Vector3 offset(0.6f + 0.5f * float(i) + 0.01f, 0.0f, 0.6f + 0.5f * float(j) + 0.37f);
+            const CastShape shape = localShape.Transform(
+                Matrix44Affine(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), offset)).Transform(tm);
+
+            ShapeCastResult result;
+            RwpBool hit = triangleMesh->ShapeCast(result, shape, delta, &tm);
+
+            EATESTAssert(hit, "Shape cast should hit the mesh.");
+            EATESTAssert(IsSimilar(result.lineParam, expectedLineParam, 1e-4f), "Incorrect time of impact.");
+            EATESTAssert(IsSimilar(result.normal, expectedNormal, 1e-4f), "Incorrect contact normal.");
+
+            const Vector3 localPosition = TransformPoint(result.position, invTm);
+            EATESTAssert(IsSimilar(localPosition.GetY(), 0.0f, 1e-4f), "Contact should be on the mesh.");
+
+            if (checkChildIndex)
+            {
+                Volume volume;
+                TriangleVolume *triangle = TriangleVolume::Initialize(EA::Physics::MemoryPtr(&volume),
+                    GetVector3_Zero(), GetVector3_Zero(), GetVector3_Zero());
+                triangleMesh->GetVolumeFromChildIndex(*triangle, result.childIndex);
+                Vector3 p0, p1, p2;
+                triangle->GetPoints(p0, p1, p2, NULL);
+                const Vector3 triMin = Min(p0, Min(p1, p2)) - Vector3(1e-4f, 1e-4f, 1e-4f);
+                const Vector3 triMax = Max(p0, Max(p1, p2)) + Vector3(1e-4f, 1e-4f, 1e-4f);
+                EATESTAssert(localPosition.GetX() >= triMin.GetX() && localPosition.GetX() <= triMax.GetX() &&
+                             localPosition.GetZ() >= triMin.GetZ() && localPosition.GetZ() <= triMax.GetZ(),
+                             "Contact should be on the triangle reported.");
+            }
+        }
+    }
+}
+
+
+void TestShapeCast::TestClusteredMeshSphereCast()
+{
+    ClusteredMeshCastTester(CastShape::Sphere(Vector3(0.0f, 2.0f, 0.0f), 0.3f), 0.3f, true);
+}
+
+
+void TestShapeCast::TestClusteredMeshCapsuleCast()
+{
+    const Vector3 axis = Normalize(Vector3(1.0f, 0.0f, 1.0f));
+    ClusteredMeshCastTester(CastShape::Capsule(Vector3(0.0f, 2.0f, 0.0f), axis, 0.4f, 0.2f), 0.2f, false);
+}
+
+
+void TestShapeCast::TestClusteredMeshBoxCast()
+{
+    const Matrix44Affine boxTm(GetVector3_XAxis(), GetVector3_YAxis(), GetVector3_ZAxis(), Vector3(0.0f, 2.0f, 0.0f));
+    ClusteredMeshCastTester(CastShape::Box(boxTm, Vector3(0.2f, 0.25f, 0.3f)), 0.25f, false);
+}
+
+
+void TestShapeCast::TestClusteredMeshCastMiss()
+{
+    ShapeCastResult result;
+
+    // Beside the mesh
+    RwpBool hit = triangleMesh->ShapeCast(result, CastShape::Sphere(Vector3(6.0f, 2.0f, 2.0f), 0.5f),
+        Vector3(0.0f, -4.0f, 0.0f), NULL);
+    EATESTAssert(!hit, "Shape cast beside the mesh should miss.");
+
+    // Moving away from the mesh
+    hit = triangleMesh->ShapeCast(result, CastShape::Sphere(Vector3(2.0f, 2.0f, 2.0f), 0.5f),
+        Vector3(0.0f, 4.0f, 0.0f), NULL);
+    EATESTAssert(!hit, "Shape cast away from the mesh should miss.");
+}
+
+#endif // !defined(EA_PLATFORM_PS3_SPU)
@@ -0,0 +1,127 @@
+// (c) Electronic Arts. All Rights Reserved.
+/*************************************************************************************************************
+
+File: thread_dispatcher.hpp
+
+Purpose: Parallel dispatcher running parallel stages on EAThread threads, for tests and benchmarks
+
+*/
+
+#ifndef THREAD_DISPATCHER_H
+#define THREAD_DISPATCHER_H
+
+#include <EABase/eabase.h>
+
+#include <eathread/eathread_thread.h>
+#include <eathread/eathread_atomic.h>
+
+#include <rw/collision/meshbuilder/detail/iparalleldispatcher.h>
+
+// ***********************************************************************************************************
+
+namespace rw
+{
+namespace collision
+{
+namespace Tests
+{
+
+/**
+Simple dispatcher which runs the ranges of each parallel stage on a set of threads started for that stage.
+Each worker takes the next unclaimed range until all ranges have been run.
+*/
+class ThreadDispatcher : public rw::collision::meshbuilder::detail::IParallelDispatcher
+{
+public:
+
+    static const uint32_t MAX_WORKERS = 16;
+
+    explicit ThreadDispatcher(const uint32_t numWorkers)
+        : m_numWorkers(numWorkers < MAX_WORKERS ? numWorkers : MAX_WORKERS)
+    {
+    }
+
+    virtual uint32_t GetNumWorkers() const
+    {
+        return m_numWorkers;
+    }
+
+    virtual void ParallelFor(RangeFunction function, void *context, uint32_t count, uint32_t grainSize)
+    {
+        Stage stage;
+        stage.function = function;
+        stage.context = context;
+        stage.count = count;
+        stage.grainSize = grainSize;
+        stage.numRanges = GetNumRanges(count, grainSize);
+
+        Worker workers[MAX_WORKERS];
+        EA::Thread::Thread threads[MAX_WORKERS];
+
+        for (uint32_t workerIndex = 0; workerIndex < m_numWorkers; ++workerIndex)
+        {
+            workers[workerIndex].stage = &stage;
+            workers[workerIndex].workerIndex = workerIndex;
+        }
+
+        // The calling thread is worker zero
+        for (uint32_t workerIndex = 1; workerIndex < m_numWorkers; ++workerIndex)
+        {
+            threads[workerIndex].Begin(RunWorker, &workers[workerIndex]);
+        }
+
+        RunWorker(&workers[0]);
+
+        for (uint32_t workerIndex = 1; workerIndex < m_numWorkers; ++workerIndex)
+        {
+            threads[workerIndex].WaitForEnd();
+        }
+    }
+
+private:
+
+    struct Stage
+    {
+        RangeFunction function;
+        void *context;
+        uint32_t count;
+        uint32_t grainSize;
+        uint32_t numRanges;
+        EA::Thread::AtomicInt32 nextRange;
+    };
+
+    struct Worker
+    {
+        Stage *stage;
+        uint32_t workerIndex;
+    };
+
+    static intptr_t RunWorker(void *workerPtr)
+    {
+        const Worker &worker = *static_cast<const Worker *>(workerPtr);
+        Stage &stage = *worker.stage;
+
+        for (;;)
+        {
+            const uint32_t rangeIndex = static_cast<uint32_t>(stage.nextRange.Increment() - 1);
+            if (rangeIndex >= stage.numRanges)
+            {
+                break;
+            }
+
+            const uint32_t begin = rangeIndex * stage.grainSize;
+            const uint32_t end = (stage.count - begin > stage.grainSize) ? (begin + stage.grainSize) : stage.count;
+            stage.function(stage.context, worker.workerIndex, begin, end);
+        }
+
+        return 0;
+    }
+
+    uint32_t m_numWorkers;
+};
+
+} // namespace Tests
+} // namespace collision
+} // namespace rw
+
+#endif // THREAD_DISPATCHER_H